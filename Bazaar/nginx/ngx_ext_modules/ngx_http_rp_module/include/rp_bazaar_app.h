@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include "cJSON.h"
+#include <rp_sdk/rp_signal_ring.h>
 
 /** Structure which describes parameters supported by the application.
  * Each application includes an parameters table which includes the following
@@ -64,6 +65,7 @@ typedef const char     *(*rp_ws_get_signals_func)(void);
 typedef int		(*rp_ws_set_params_func)(const char *_params);
 typedef int		(*rp_ws_set_signals_func)(const char *_signals);
 typedef void	(*rp_ws_gzip_func)(const char *_in, void* _data, size_t* _size);
+typedef const void     *(*rp_ws_get_signals_binary_func)(size_t* _size, int _keyframe);
 
 typedef struct rp_bazaar_app_s {
     /* Initialization function - called when app. is loaded */
@@ -83,6 +85,8 @@ typedef struct rp_bazaar_app_s {
     rp_get_params_func       get_params_func;
     /* Retrieves last good signals from the application */
     rp_get_signals_func      get_signals_func;
+    /* Optional, ring the application publishes its signals to */
+    rp_get_signal_ring_func  get_signal_ring_func;
 
 	/*WebSocket Server part*/
 
@@ -98,6 +102,7 @@ typedef struct rp_bazaar_app_s {
 	rp_ws_set_params_interval_func ws_set_params_demo_func;
 	rp_ws_set_params_func verify_app_license_func;
 	rp_ws_gzip_func ws_gzip_func;
+	rp_ws_get_signals_binary_func ws_get_signals_binary_func; /* optional */
 
     /* Dynamic library handle */
     void            *handle;
@@ -41,6 +41,8 @@ int rp_data_set_signals(ngx_http_request_t *r, cJSON **json_root);
 int rp_data_get_signals(ngx_http_request_t *r, cJSON **json_root);
 /* Clear dirty flag in case of re-send */
 void rp_data_clear_signals_dirty();
+/* Answer requests waiting for signals and stop watching the signal ring */
+void rp_data_signals_release();
 
 /* Helper functions */
 int rp_data_parse_and_set_params(cJSON *params_root);
@@ -24,6 +24,7 @@
 
 #include "rp_bazaar_cmd.h"
 #include "rp_bazaar_app.h"
+#include "rp_data_cmd.h"
 
 #include <ws_server.h>
 
@@ -36,6 +37,7 @@ const char *c_rp_set_params_str   = "rp_set_params";
 const char *c_rp_get_params_str   = "rp_get_params";
 const char *c_rp_set_signals_str  = "rp_set_signals";
 const char *c_rp_get_signals_str  = "rp_get_signals";
+const char *c_rp_get_signal_ring_str = "rp_get_signal_ring";
 
 //start web socket function str
 
@@ -48,6 +50,7 @@ const char *c_ws_get_params_str   = "ws_get_params";
 const char *c_ws_set_signals_str  = "ws_set_signals";
 const char *c_ws_get_signals_str  = "ws_get_signals";
 const char* c_ws_gzip_str = "ws_gzip";
+const char* c_ws_get_signals_binary_str = "ws_get_signals_binary";
 // end web socket function str
 
 /** Get MAC address of a specific NIC via sysfs */
@@ -401,6 +404,9 @@ int rp_bazaar_app_load_module(const char *app_file, rp_bazaar_app_t *app)
     if(!app->get_signals_func)
         return -7;
 
+    /* Applications without a signal ring are polled through get_signals_func */
+    app->get_signal_ring_func = dlsym(app->handle, c_rp_get_signal_ring_str);
+
     // start web socket functionality
     app->ws_api_supported = 1;
     app->ws_set_params_interval_func = dlsym(app->handle, c_ws_set_params_interval_str);
@@ -466,6 +472,9 @@ int rp_bazaar_app_load_module(const char *app_file, rp_bazaar_app_t *app)
         fprintf(stderr, "Cannot resolve '%s' function.\n", c_ws_gzip_str);
     }
 
+    /* Binary signal frames are optional, older applications only send JSON */
+    app->ws_get_signals_binary_func = dlsym(app->handle, c_ws_get_signals_binary_str);
+
     // end web socket functionality
 
     app->file_name = (char *)malloc(strlen(app_file)+1);
@@ -481,6 +490,9 @@ int rp_bazaar_app_load_module(const char *app_file, rp_bazaar_app_t *app)
 int rp_bazaar_app_unload_module(rp_bazaar_app_t *app)
 {
     stop_ws_server();
+    /* Waiting requests read from the ring owned by the running application */
+    if(app == &rp_module_ctx.app)
+        rp_data_signals_release();
     if(app->handle) {
         if(app->initialized && app->exit_func) {
             app->exit_func();
@@ -24,6 +24,17 @@
 /* last good result container */
 static float **rp_signals = NULL;
 static int     rp_signals_dirty = 0;
+static int     rp_signals_len = 0;
+
+/* Applications which publish through a signal ring are not polled, requests
+ * wait on the ring's eventfd in the nginx event loop instead.
+ */
+#define RP_DATA_SIGNALS_TIMEOUT 200 /* [ms] */
+
+static rp_signal_ring_t *rp_signals_ring = NULL;
+static ngx_connection_t *rp_signals_conn = NULL;
+static ngx_queue_t       rp_signals_waiting;
+static uint64_t          rp_signals_seen = 0;
 
 #define TRACE(args...) fprintf(stderr, args)
 
@@ -35,8 +46,17 @@ static int     rp_signals_dirty = 0;
 typedef struct rp_data_ctx_s {
     cJSON *json_root;
     int    finalize_on_post_handler;
+
+    /* GET waiting for the signal ring */
+    ngx_http_request_t *request;
+    ngx_event_t         timeout;
+    ngx_queue_t         queue;
+    int                 waiting;
 } rp_data_ctx_t;
 
+static int rp_data_signals_watch(void);
+static ngx_int_t rp_data_get_signals_async(ngx_http_request_t *r, cJSON *json_root);
+
 
 /*----------------------------------------------------------------------------*/
 /**
@@ -121,6 +141,10 @@ ngx_int_t rp_data_cmd_handler(ngx_http_request_t *r)
         return rc;
     }
 
+    if(rp_data_signals_watch() == 0) {
+        return rp_data_get_signals_async(r, json_root);
+    }
+
     ret_val = rp_data_get_signals(r, &json_root);
     rp_data_get_params(r, &json_root);
 
@@ -409,20 +433,74 @@ int rp_data_get_params(ngx_http_request_t *r, cJSON **json_root)
 }
 
 
+/*----------------------------------------------------------------------------*/
+static int rp_data_alloc_signals(void)
+{
+    int i;
+
+    if(rp_signals != NULL)
+        return 0;
+
+    rp_signals = (float **)malloc(RP_SIGNAL_RING_MAX_NUM * sizeof(float *));
+    if(rp_signals == NULL)
+        return -1;
+    for(i = 0; i < RP_SIGNAL_RING_MAX_NUM; i++) {
+        rp_signals[i] = (float *)malloc(RP_SIGNAL_RING_MAX_LEN * sizeof(float));
+    }
+    return 0;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Appends the last good signals to the 'datasets' object.
+ *
+ * @param[in]  ret_val  result of the last signal read, -1 if nothing new arrived
+ * @retval     0        signals are complete, or the old ones are sent again
+ * @retval     <0       client should ask again
+ */
+static int rp_data_add_signals(ngx_http_request_t *r, cJSON *data_root,
+                               int ret_val)
+{
+    cJSON *sig_root, *g1;
+
+    /* In case we are repeating the transmission */
+    if((rp_signals_dirty == 0) && (ret_val == -1))
+        ret_val = 0;
+    rp_signals_dirty = 1;
+
+    cJSON_AddItemToObject(data_root, "g1",
+                          g1=cJSON_CreateArray(r->pool), r->pool);
+
+    cJSON_AddItemToObject(g1, "g1", 
+                          sig_root=cJSON_CreateObject(r->pool), r->pool);
+    cJSON_AddItemToObject(sig_root, "data",
+                          cJSON_Create2dFloatArray(&rp_signals[0][0], &rp_signals[1][0],
+                                                   rp_signals_len, r->pool),
+                          r->pool);
+    cJSON_AddItemToObject(g1, "g1", 
+                          sig_root=cJSON_CreateObject(r->pool), r->pool);
+    cJSON_AddItemToObject(sig_root, "data",
+                          cJSON_Create2dFloatArray(&rp_signals[0][0], &rp_signals[2][0],
+                                                   rp_signals_len, r->pool),
+                          r->pool);
+
+    return ret_val;
+}
+
+
 /*----------------------------------------------------------------------------*/
 int rp_data_get_signals(ngx_http_request_t *r, cJSON **json_root)
 {
     int rp_sig_num, rp_sig_len, ret_val;
-    cJSON *data_root, *sig_root, *d1, *d2, *g1;
+    cJSON *data_root;
     /* TODO: Make it configurable */
     int retries = 200; /* Approx in [ms] */
 
-    if(rp_signals == NULL) {
-        int i;
-        rp_signals = (float **)malloc(3 * sizeof(float *));
-        for(i = 0; i < 3; i++) {
-            rp_signals[i] = (float *)malloc(2048 * sizeof(float));
-        }
+    if(rp_data_alloc_signals() < 0) {
+        return rp_module_cmd_error(json_root, 
+                                   "Can not allocate signals", NULL, 
+                                   r->pool);
     }
 
     data_root = cJSON_GetObjectItem(*json_root, "datasets");
@@ -450,31 +528,230 @@ int rp_data_get_signals(ngx_http_request_t *r, cJSON **json_root)
             usleep(1000);
         }
     }
-    ret_val = ret_val;
-    /* In case we are repeating the transmission */
-    if((rp_signals_dirty == 0) && (ret_val == -1))
-        ret_val = 0;
-    rp_signals_dirty = 1;
+    rp_signals_len = rp_sig_len;
 
-    cJSON_AddItemToObject(data_root, "g1",
-                          g1=cJSON_CreateArray(r->pool), r->pool);
+    return rp_data_add_signals(r, data_root, ret_val);
+}
 
-    cJSON_AddItemToObject(g1, "g1", 
-                          sig_root=cJSON_CreateObject(r->pool), r->pool);
-    cJSON_AddItemToObject(sig_root, "data",
-                   d1=cJSON_Create2dFloatArray(&rp_signals[0][0], &rp_signals[1][0],
-                                               rp_sig_len, r->pool),
-                          r->pool);
-    cJSON_AddItemToObject(g1, "g1", 
-                          sig_root=cJSON_CreateObject(r->pool), r->pool);
-    cJSON_AddItemToObject(sig_root, "data",
-                   d2=cJSON_Create2dFloatArray(&rp_signals[0][0], &rp_signals[2][0],
-                                               rp_sig_len, r->pool),
-                          r->pool);
 
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Copies the newest frame of the signal ring into the last good result.
+ *
+ * @retval -1     no frame was published since the last read
+ * @retval other  rp_get_signals() compatible status of the frame
+ */
+static int rp_data_read_ring(void)
+{
+    int num, len, ret_val;
+
+    ret_val = rp_signal_ring_read(rp_signals_ring, &rp_signals_seen,
+                                  rp_signals, &num, &len, RP_SIGNAL_RING_MAX_LEN);
+    if(ret_val != -1)
+        rp_signals_len = len;
     return ret_val;
 }
 
+
+/*----------------------------------------------------------------------------*/
+static ngx_int_t rp_data_send_signals(ngx_http_request_t *r, cJSON **json_root,
+                                      int ret_val)
+{
+    cJSON *data_root = cJSON_GetObjectItem(*json_root, "datasets");
+
+    ret_val = rp_data_add_signals(r, data_root, ret_val);
+    rp_data_get_params(r, json_root);
+
+    if(ret_val == 0) {
+        rp_module_cmd_ok(json_root, r->pool);
+    } else {
+        rp_module_cmd_again(json_root, r->pool);
+    }
+    return rp_module_send_response(r, json_root);
+}
+
+
+/*----------------------------------------------------------------------------*/
+static void rp_data_signals_answer(rp_data_ctx_t *ctx, int ret_val)
+{
+    ngx_http_request_t *r = ctx->request;
+    ngx_connection_t   *c = r->connection;
+
+    ngx_queue_remove(&ctx->queue);
+    ctx->waiting = 0;
+    if(ctx->timeout.timer_set) {
+        ngx_del_timer(&ctx->timeout);
+    }
+
+    ngx_http_finalize_request(r, rp_data_send_signals(r, &ctx->json_root, ret_val));
+    ngx_http_run_posted_requests(c);
+}
+
+
+/*----------------------------------------------------------------------------*/
+static void rp_data_signals_wake(int ret_val)
+{
+    while(!ngx_queue_empty(&rp_signals_waiting)) {
+        ngx_queue_t *q = ngx_queue_head(&rp_signals_waiting);
+        rp_data_signals_answer(ngx_queue_data(q, rp_data_ctx_t, queue), ret_val);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Read handler of the signal ring eventfd.
+ */
+static void rp_data_signals_event(ngx_event_t *ev)
+{
+    ngx_connection_t *c = ev->data;
+    uint64_t cnt;
+    int ret_val;
+
+    /* One read resets the counter, however many frames were published */
+    if((read(c->fd, &cnt, sizeof(cnt)) < 0) && (errno != EAGAIN)) {
+        rp_error(c->log, "Reading signal ring event failed: %s", strerror(errno));
+    }
+    if(ngx_handle_read_event(ev, 0) != NGX_OK) {
+        rp_error(c->log, "Can not re-arm signal ring event");
+    }
+
+    /* Leave the frame for the next request if nobody is waiting */
+    if(ngx_queue_empty(&rp_signals_waiting))
+        return;
+
+    ret_val = rp_data_read_ring();
+    if(ret_val != -1)
+        rp_data_signals_wake(ret_val);
+}
+
+
+/*----------------------------------------------------------------------------*/
+static void rp_data_signals_timeout(ngx_event_t *ev)
+{
+    /* Use old signals */
+    rp_data_signals_answer(ev->data, -1);
+}
+
+
+/*----------------------------------------------------------------------------*/
+static void rp_data_signals_cleanup(void *data)
+{
+    rp_data_ctx_t *ctx = data;
+
+    if(ctx->waiting) {
+        ngx_queue_remove(&ctx->queue);
+        ctx->waiting = 0;
+    }
+    if(ctx->timeout.timer_set) {
+        ngx_del_timer(&ctx->timeout);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Starts watching the signal ring of the loaded application.
+ *
+ * @retval  0  application publishes through a ring, which is being watched
+ * @retval -1  application has to be polled with get_signals_func
+ */
+static int rp_data_signals_watch(void)
+{
+    rp_signal_ring_t *ring;
+    ngx_connection_t *c;
+    int fd;
+
+    if(rp_signals_conn)
+        return 0;
+    if(!rp_module_ctx.app.get_signal_ring_func || rp_data_alloc_signals() < 0)
+        return -1;
+
+    ring = rp_module_ctx.app.get_signal_ring_func();
+    if((ring == NULL) || (ring->efd < 0))
+        return -1;
+
+    /* Own descriptor, closing the connection must leave the application's eventfd open */
+    fd = dup(ring->efd);
+    if(fd < 0)
+        return -1;
+
+    c = ngx_get_connection(fd, ngx_cycle->log);
+    if(c == NULL) {
+        close(fd);
+        return -1;
+    }
+    c->read->handler = rp_data_signals_event;
+    c->read->log = ngx_cycle->log;
+    if(ngx_handle_read_event(c->read, 0) != NGX_OK) {
+        ngx_close_connection(c);
+        return -1;
+    }
+
+    ngx_queue_init(&rp_signals_waiting);
+    rp_signals_ring = ring;
+    rp_signals_seen = 0;
+    rp_signals_conn = c;
+    return 0;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Answers GET right away when a new frame is in the ring, otherwise
+ * parks the request until the next frame or RP_DATA_SIGNALS_TIMEOUT.
+ */
+static ngx_int_t rp_data_get_signals_async(ngx_http_request_t *r, cJSON *json_root)
+{
+    rp_data_ctx_t *ctx;
+    ngx_pool_cleanup_t *cln;
+    int ret_val;
+
+    ret_val = rp_data_read_ring();
+    if(ret_val != -1) {
+        return rp_data_send_signals(r, &json_root, ret_val);
+    }
+
+    ctx = ngx_pcalloc(r->pool, sizeof(rp_data_ctx_t));
+    cln = ngx_pool_cleanup_add(r->pool, 0);
+    if((ctx == NULL) || (cln == NULL)) {
+        return NGX_HTTP_INTERNAL_SERVER_ERROR;
+    }
+    ctx->json_root = json_root;
+    ctx->request = r;
+    ctx->timeout.handler = rp_data_signals_timeout;
+    ctx->timeout.data = ctx;
+    ctx->timeout.log = r->connection->log;
+    cln->handler = rp_data_signals_cleanup;
+    cln->data = ctx;
+    ngx_http_set_ctx(r, ctx, ngx_http_rp_module);
+
+    ngx_queue_insert_tail(&rp_signals_waiting, &ctx->queue);
+    ctx->waiting = 1;
+    ngx_add_timer(&ctx->timeout, RP_DATA_SIGNALS_TIMEOUT);
+
+    r->main->count++;
+    return NGX_DONE;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Answers waiting requests with the last signals and stops watching
+ * the signal ring, must be called before the application is unloaded.
+ */
+void rp_data_signals_release()
+{
+    if(rp_signals_conn == NULL)
+        return;
+
+    rp_data_signals_wake(-1);
+    ngx_close_connection(rp_signals_conn);
+    rp_signals_conn = NULL;
+    rp_signals_ring = NULL;
+    rp_signals_seen = 0;
+}
+
 /*----------------------------------------------------------------------------*/
 /**
  * @brief Clear Signal Dirty flag
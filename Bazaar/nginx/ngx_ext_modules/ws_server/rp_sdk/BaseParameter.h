@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include <libjson.h>
 
 class CBaseParameter  //base class for parameter and signal
@@ -17,6 +18,15 @@ public:
 		AccessModes
 	};
 
+	// Sample encoding of a signal inside a binary signal frame
+	enum SignalEncoding
+	{
+		NOT_BINARY = -1,	// signal can only be sent as JSON
+		FLOAT32 = 0,		// raw float32 samples
+		INT16,			// int16 quantized, value = offset + q * scale
+		INT16_DELTA		// like INT16, int8 deltas to the previous frame when they fit
+	};
+
 	virtual ~CBaseParameter(){};
 	virtual const char* GetName() const = 0;
 	virtual void Update() = 0;		//apply change of value
@@ -27,4 +37,6 @@ public:
 	virtual bool IsNewValue() const = 0;
 	virtual void ClearNewValue() = 0;
 	virtual bool NeedSend(bool _no_need=false) const { return _no_need; };
+	virtual SignalEncoding GetEncoding() const { return NOT_BINARY; };
+	virtual void GetSamples(std::vector<float>& _out) const { _out.clear(); };	// signal samples converted to float for binary frames
 };
@@ -186,11 +186,13 @@ template <typename Type> class CCustomSignal : public CParameter<Type, std::vect
 public:
 	CCustomSignal(std::string _name, int _size, Type _def_value)
 		:CParameter<Type, std::vector<Type> >(_name, CBaseParameter::RO, std::vector<Type>(_size, _def_value)),
-		m_Dirty(true){}
+		m_Dirty(true),
+		m_Encoding(CBaseParameter::FLOAT32){}
 
 	CCustomSignal(std::string _name, CBaseParameter::AccessMode _access_mode, int _size, Type _def_value)
 		:CParameter<Type, std::vector<Type> >(_name, _access_mode, std::vector<Type>(_size, _def_value)),
-		m_Dirty(true) {}
+		m_Dirty(true),
+		m_Encoding(CBaseParameter::FLOAT32) {}
 
 	~CCustomSignal()
 	{
@@ -270,8 +272,25 @@ public:
 		m_Dirty = true;
 		return true;
 	}
+
+	// Encoding used when the signal goes out in a binary frame
+	void SetEncoding(CBaseParameter::SignalEncoding _encoding)
+	{
+		m_Encoding = _encoding;
+	}
+
+	CBaseParameter::SignalEncoding GetEncoding() const
+	{
+		return m_Encoding;
+	}
+
+	void GetSamples(std::vector<float>& _out) const
+	{
+		_out.assign(this->m_Value.value.begin(), this->m_Value.value.end());
+	}
 private:
 	bool m_Dirty;
+	CBaseParameter::SignalEncoding m_Encoding;
 };
 
 //custom CIntParameter
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <cstring>
+#include <cmath>
 #include <map>
 #include "DataManager.h"
 #include "CustomParameters.h"
@@ -10,6 +11,36 @@
 CStringParameter InCommandParam("in_command", CBaseParameter::WO, "", 1);
 CStringParameter OutCommandParam("out_command", CBaseParameter::RO, "", 1);
 
+namespace {
+
+struct SignalFrameHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t count;
+	uint32_t sequence;
+};
+
+struct SignalEntryHeader {
+	uint8_t name_len;
+	uint8_t type;
+	uint16_t reserved;
+	uint32_t samples;
+	float scale;
+	float offset;
+};
+
+static_assert(sizeof(SignalFrameHeader) == 12, "Unexpected signal frame header size");
+static_assert(sizeof(SignalEntryHeader) == 16, "Unexpected signal entry header size");
+
+inline void Append(std::vector<uint8_t>& _buf, const void* _data, size_t _size)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(_data);
+	_buf.insert(_buf.end(), p, p + _size);
+	_buf.resize((_buf.size() + 3) & ~size_t(3), 0);
+}
+
+}
+
 int dbg_printf(const char * format, ...)
 {
 	static FILE* log = fopen("/var/log/redpitaya_nginx/rp_sdk.log", "wt");
@@ -37,6 +68,13 @@ inline bool CDataManager::NeedSend(const CBaseParameter& param) const
 CDataManager::CDataManager()
 	: m_params()
 	, m_signals()
+	, m_params_index()
+	, m_signals_index()
+	, m_signals_state()
+	, m_frame()
+	, m_samples()
+	, m_quantized()
+	, m_frame_seq(0)
 	, m_param_interval(20)
 	, m_signal_interval(20)
 	, m_send_all_params(true)
@@ -53,6 +91,8 @@ void CDataManager::RegisterParam(CBaseParameter * _param)
 {
 	dbg_printf("RegisterParam: %s\n", _param->GetName());
 	m_params.push_back(_param);
+	if(!m_params_index.emplace(_param->GetName(), _param).second)
+		dbg_printf("Duplicate param: %s\n", _param->GetName());
 	dbg_printf("Registered params: %d\n", m_params.size());
 }
 
@@ -60,35 +100,53 @@ void CDataManager::RegisterSignal(CBaseParameter * _signal)
 {
 	dbg_printf("RegisterSignal: %s\n", _signal->GetName());
 	m_signals.push_back(_signal);
+	if(!m_signals_index.emplace(_signal->GetName(), _signal).second)
+		dbg_printf("Duplicate signal: %s\n", _signal->GetName());
 	dbg_printf("Registered signals: %d\n", m_signals.size());
 }
 
-void CDataManager::UnRegisterParam(const char * _name)
+void CDataManager::Unregister(std::vector<CBaseParameter*>& _list, std::unordered_map<std::string, CBaseParameter*>& _index, const char * _name)
 {
-	for (std::vector<CBaseParameter *>::iterator it =  m_params.begin() ; it !=  m_params.end(); ++it)
+	auto it = _index.find(_name);
+	if(it == _index.end())
+		return;
+
+	for (std::vector<CBaseParameter *>::iterator p = _list.begin(); p != _list.end(); ++p)
 	{
-		if(strcmp((*it)->GetName(),_name)==0)
+		if(*p == it->second)
 		{
-			m_params.erase(it);
-			dbg_printf("UnRegisterParam: %s\n", _name);
-			return;
+			_list.erase(p);
+			break;
 		}
 	}
-}
+	_index.erase(it);
 
-void CDataManager::UnRegisterSignal(const char * _name)
-{
-	for (std::vector<CBaseParameter *>::iterator it =  m_signals.begin() ; it !=  m_params.end(); ++it)
+	// A duplicate registered under the same name takes over the index entry
+	for (auto p : _list)
 	{
-		if(strcmp((*it)->GetName(),_name)==0)
+		if(strcmp(p->GetName(), _name) == 0)
 		{
-			m_signals.erase(it);
-			dbg_printf("UnRegisterSignal: %s\n", _name);
-			return;
+			_index.emplace(_name, p);
+			break;
 		}
 	}
 }
 
+void CDataManager::UnRegisterParam(const char * _name)
+{
+	Unregister(m_params, m_params_index, _name);
+	dbg_printf("UnRegisterParam: %s\n", _name);
+}
+
+void CDataManager::UnRegisterSignal(const char * _name)
+{
+	auto it = m_signals_index.find(_name);
+	if(it != m_signals_index.end())
+		m_signals_state.erase(it->second);
+	Unregister(m_signals, m_signals_index, _name);
+	dbg_printf("UnRegisterSignal: %s\n", _name);
+}
+
 void CDataManager::UpdateAllParams()
 {
 	for(size_t i=0; i < m_params.size(); i++) {
@@ -145,6 +203,120 @@ std::string CDataManager::GetSignalsJson()
 	return data_node.write();
 }
 
+void CDataManager::EncodeSignal(const CBaseParameter& _signal, bool _keyframe)
+{
+	_signal.GetSamples(m_samples);
+	const size_t count = m_samples.size();
+	const std::string name = _signal.GetName();
+	CBaseParameter::SignalEncoding encoding = _signal.GetEncoding();
+
+	SignalEntryHeader h;
+	h.name_len = name.size() < 255 ? name.size() : 255;
+	h.type = SIGNAL_FRAME_FLOAT32;
+	h.reserved = 0;
+	h.samples = count;
+	h.scale = 1.f;
+	h.offset = 0.f;
+
+	float min = 0.f;
+	float max = 0.f;
+	if(encoding != CBaseParameter::FLOAT32 && count) {
+		min = max = m_samples[0];
+		for(size_t i = 1; i < count; i++) {
+			min = std::fmin(min, m_samples[i]);
+			max = std::fmax(max, m_samples[i]);
+		}
+		// Infinities cannot be quantized, such signals stay float
+		if(!std::isfinite(min) || !std::isfinite(max))
+			encoding = CBaseParameter::FLOAT32;
+	}
+
+	if(encoding == CBaseParameter::FLOAT32 || count == 0) {
+		m_signals_state.erase(&_signal);
+		Append(m_frame, &h, sizeof(h));
+		Append(m_frame, name.data(), h.name_len);
+		Append(m_frame, m_samples.data(), count * sizeof(float));
+		return;
+	}
+
+	// Deltas reuse the scale of the last int16 entry as long as the signal
+	// still fits into its range and has not shrunk much below it
+	if(encoding == CBaseParameter::INT16_DELTA && !_keyframe) {
+		auto it = m_signals_state.find(&_signal);
+		if(it != m_signals_state.end() && it->second.q.size() == count && it->second.scale > 0.f) {
+			SignalState& st = it->second;
+			bool fits = (max - min) / st.scale > 16383.f;
+			m_quantized.resize(count);
+			for(size_t i = 0; fits && i < count; i++) {
+				float q = std::round((m_samples[i] - st.offset) / st.scale);
+				fits = std::fabs(q) <= 32767.f && std::fabs(q - st.q[i]) <= 127.f;
+				if(fits)
+					m_quantized[i] = (int16_t)q;
+			}
+			if(fits) {
+				h.type = SIGNAL_FRAME_INT8_DELTA;
+				h.scale = st.scale;
+				h.offset = st.offset;
+				Append(m_frame, &h, sizeof(h));
+				Append(m_frame, name.data(), h.name_len);
+				size_t pos = m_frame.size();
+				m_frame.resize(pos + ((count + 3) & ~size_t(3)), 0);
+				for(size_t i = 0; i < count; i++)
+					m_frame[pos + i] = (uint8_t)(int8_t)(m_quantized[i] - st.q[i]);
+				st.q.swap(m_quantized);
+				return;
+			}
+		}
+	}
+
+	h.type = SIGNAL_FRAME_INT16;
+	h.offset = min * 0.5f + max * 0.5f;
+	h.scale = (max - min) / 65534.f;
+	m_quantized.resize(count);
+	for(size_t i = 0; i < count; i++) {
+		float q = h.scale > 0.f ? std::round((m_samples[i] - h.offset) / h.scale) : 0.f;
+		m_quantized[i] = (int16_t)std::fmax(-32767.f, std::fmin(32767.f, q));
+	}
+	Append(m_frame, &h, sizeof(h));
+	Append(m_frame, name.data(), h.name_len);
+	Append(m_frame, m_quantized.data(), count * sizeof(int16_t));
+
+	if(encoding == CBaseParameter::INT16_DELTA) {
+		SignalState& st = m_signals_state[&_signal];
+		st.scale = h.scale;
+		st.offset = h.offset;
+		st.q = m_quantized;
+	}
+}
+
+const std::vector<uint8_t>* CDataManager::GetSignalsBinary(bool _keyframe)
+{
+	for(size_t i=0; i < m_signals.size(); i++) {
+		if(m_signals[i]->GetEncoding() == CBaseParameter::NOT_BINARY)
+			return nullptr;
+	}
+
+	UpdateSignals();
+	SignalFrameHeader h;
+	h.magic = SIGNAL_FRAME_MAGIC;
+	h.version = SIGNAL_FRAME_VERSION;
+	h.count = 0;
+	h.sequence = m_frame_seq++;
+
+	m_frame.clear();
+	m_frame.resize(sizeof(h));
+	for(size_t i=0; i < m_signals.size(); i++) {
+		if(NeedSend(*m_signals[i])) {
+			EncodeSignal(*m_signals[i], _keyframe);
+			m_signals[i]->Update();
+			h.count++;
+		}
+	}
+	memcpy(m_frame.data(), &h, sizeof(h));
+	PostUpdateSignals();
+	return &m_frame;
+}
+
 void CDataManager::OnNewParams(std::string _params)
 {
 	JSONNode n(JSON_NODE);
@@ -157,17 +329,9 @@ void CDataManager::OnNewParams(std::string _params)
 	for (size_t i=0; i < n.size(); ++i)
 	{
 		m = n.at(i);
-		std::string name = m.name();
-
-		for (size_t j=0; j < m_params.size(); ++j)
-		{
-			if (m_params[j]->GetAccessMode() != CBaseParameter::AccessMode::RO)
-			{
-				std::string param_name = m_params[j]->GetName();
-				if (name == param_name)
-					m_params[j]->SetValueFromJSON(m);
-			}
-		}
+		auto it = m_params_index.find(m.name());
+		if (it != m_params_index.end() && it->second->GetAccessMode() != CBaseParameter::AccessMode::RO)
+			it->second->SetValueFromJSON(m);
 	}
 
 	if(InCommandParam.IsNewValue())
@@ -188,16 +352,9 @@ void CDataManager::OnNewSignals(std::string _signals)
 
 	for(size_t i=0; i < n.size(); i++) {
 		m = n.at(i);
-		const char* name = m.name().c_str();
-
-		for(size_t j=0; j < m_signals.size(); j++) {
-			if(m_signals[j]->GetAccessMode() != CBaseParameter::AccessMode::RO)
-			{
-				const char* param_name = m_signals[j]->GetName();
-				if(!strcmp(param_name, name))
-					m_signals[j]->SetValueFromJSON(m);
-			}
-		}
+		auto it = m_signals_index.find(m.name());
+		if(it != m_signals_index.end() && it->second->GetAccessMode() != CBaseParameter::AccessMode::RO)
+			it->second->SetValueFromJSON(m);
 	}
 
 	::OnNewSignals();
@@ -289,6 +446,19 @@ extern "C" const char* ws_get_signals(void)
 	return res.c_str();
 }
 
+extern "C" const void* ws_get_signals_binary(size_t* _size, int _keyframe)
+{
+	CDataManager * man = CDataManager::GetInstance();
+	const std::vector<uint8_t>* frame = man ? man->GetSignalsBinary(_keyframe != 0) : nullptr;
+	if(frame == nullptr)
+	{
+		*_size = 0;
+		return nullptr;
+	}
+	*_size = frame->size();
+	return frame->data();
+}
+
 extern "C" void ws_set_params_interval(int _interval)
 {
 	CDataManager * man = CDataManager::GetInstance();
@@ -2,6 +2,9 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <string>
+#include <stdint.h>
 #include "BaseParameter.h"
 
 struct Data {
@@ -9,6 +12,29 @@ struct Data {
 	size_t size;
 };
 
+/*
+ * Binary signal frame, all fields little endian.
+ *
+ * Frame header (12 bytes):
+ *   u32 magic "RPSB", u16 version, u16 signal count, u32 sequence number
+ * Each signal (header 16 bytes):
+ *   u8 name length, u8 type, u16 reserved, u32 samples, f32 scale, f32 offset,
+ *   name padded to 4 bytes, samples padded to 4 bytes.
+ *
+ * Types:
+ *   SIGNAL_FRAME_FLOAT32    float32 samples
+ *   SIGNAL_FRAME_INT16      int16 q, value = offset + q * scale
+ *   SIGNAL_FRAME_INT8_DELTA int8 d, q = previous q of the signal + d, value = offset + q * scale
+ *
+ * Delta entries always follow an INT16 entry of the same signal with the same
+ * scale and offset, a keyframe request restarts every signal with INT16.
+ */
+#define SIGNAL_FRAME_MAGIC      0x42535052
+#define SIGNAL_FRAME_VERSION    1
+#define SIGNAL_FRAME_FLOAT32    0
+#define SIGNAL_FRAME_INT16      1
+#define SIGNAL_FRAME_INT8_DELTA 2
+
 class CDataManager
 {
 private:
@@ -17,9 +43,25 @@ private:
 	CDataManager& operator=( CDataManager& );
 
 	inline bool NeedSend(const CBaseParameter& param) const;
+	void EncodeSignal(const CBaseParameter& _signal, bool _keyframe);
+	static void Unregister(std::vector<CBaseParameter*>& _list, std::unordered_map<std::string, CBaseParameter*>& _index, const char * _name);
+
+	// Quantization state of an INT16_DELTA signal, deltas are taken against it
+	struct SignalState {
+		float scale;
+		float offset;
+		std::vector<int16_t> q;
+	};
 
 	std::vector<CBaseParameter*> m_params;
 	std::vector<CBaseParameter*> m_signals;
+	std::unordered_map<std::string, CBaseParameter*> m_params_index;
+	std::unordered_map<std::string, CBaseParameter*> m_signals_index;
+	std::unordered_map<const CBaseParameter*, SignalState> m_signals_state;
+	std::vector<uint8_t> m_frame; // last binary signal frame
+	std::vector<float> m_samples;
+	std::vector<int16_t> m_quantized;
+	uint32_t m_frame_seq;
 	int m_param_interval; //parameters send time interval in milliseconds
 	int m_signal_interval; //signals send time interval in milliseconds
 	bool m_send_all_params;
@@ -33,14 +75,12 @@ public:
 	
 	template<class T>
 	T* GetByName(std::string _name){
-		for (auto x : m_params) { 
-			if (std::string(x->GetName()) == _name)
-				return dynamic_cast<T*>(x);
-		}
-		for (auto x : m_signals) { 
-			if (std::string(x->GetName()) == _name)
-				return dynamic_cast<T*>(x);
-		}
+		auto it = m_params_index.find(_name);
+		if (it != m_params_index.end())
+			return dynamic_cast<T*>(it->second);
+		it = m_signals_index.find(_name);
+		if (it != m_signals_index.end())
+			return dynamic_cast<T*>(it->second);
 		return nullptr;
 	}
 	const std::vector<CBaseParameter*>* GetParametersList() {return &m_params;}
@@ -51,6 +91,7 @@ public:
 
 	std::string GetParamsJson(); //get all parameters in JSON-formatted string
 	std::string GetSignalsJson(); //get all signals in JSON-formatted string
+	const std::vector<uint8_t>* GetSignalsBinary(bool _keyframe); //get all signals as binary frame, nullptr if some signal has no binary form
 
 	void OnNewParams(std::string _params); //is involved when new data received from server, data is JSON-formatted string
 	void OnNewSignals(std::string _signals); //is involved when new data received from server, data is JSON-formatted string
@@ -83,6 +124,7 @@ extern "C" int ws_get_params_interval(void);
 extern "C" int ws_get_signals_interval(void);
 extern "C" const char * ws_get_params(void);
 extern "C" const char * ws_get_signals(void);
+extern "C" const void * ws_get_signals_binary(size_t* _size, int _keyframe);
 extern "C" int ws_set_params(const char *_params);
 extern "C" int ws_set_signals(const char *_signals);
 extern "C" void ws_gzip(const char* _in, void* _out, size_t* size_);
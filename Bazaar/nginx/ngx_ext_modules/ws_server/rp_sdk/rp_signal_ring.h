@@ -0,0 +1,142 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya signal ring shared between an application and the web server.
+ *
+ * The application worker publishes every new set of signals into a small ring
+ * of frames and signals an eventfd. The web server waits on the eventfd in its
+ * event loop and copies the newest frame, so no side polls the other.
+ *
+ * There is a single producer. Readers use a sequence counter per frame and
+ * retry when the producer overwrote the frame while it was being copied.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __RP_SIGNAL_RING_H
+#define __RP_SIGNAL_RING_H
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#define RP_SIGNAL_RING_SLOTS    4
+#define RP_SIGNAL_RING_MAX_NUM  3
+#define RP_SIGNAL_RING_MAX_LEN  2048
+#define RP_SIGNAL_RING_RETRIES  4
+
+typedef struct rp_signal_frame_s {
+    /* Odd while the producer writes the frame */
+    volatile uint32_t seq;
+    /* Value rp_get_signals() would return for this frame: 0 complete, -2 not finished */
+    int32_t  status;
+    int32_t  sig_num;
+    int32_t  sig_len;
+    float    data[RP_SIGNAL_RING_MAX_NUM][RP_SIGNAL_RING_MAX_LEN];
+} rp_signal_frame_t;
+
+typedef struct rp_signal_ring_s {
+    /* Number of published frames, frame n lives in slot n % RP_SIGNAL_RING_SLOTS */
+    volatile uint64_t head;
+    /* Incremented on every publish, non-blocking */
+    int efd;
+    rp_signal_frame_t frame[RP_SIGNAL_RING_SLOTS];
+} rp_signal_ring_t;
+
+/* Exported by applications which publish their signals through a ring */
+typedef rp_signal_ring_t *(*rp_get_signal_ring_func)(void);
+
+static inline int rp_signal_ring_init(rp_signal_ring_t *ring)
+{
+    memset(ring, 0, sizeof(rp_signal_ring_t));
+    ring->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return ring->efd < 0 ? -1 : 0;
+}
+
+static inline void rp_signal_ring_release(rp_signal_ring_t *ring)
+{
+    if(ring->efd >= 0)
+        close(ring->efd);
+    ring->efd = -1;
+}
+
+/**
+ * Copies num signals of len samples into the next frame and wakes up the readers.
+ */
+static inline void rp_signal_ring_publish(rp_signal_ring_t *ring, float **signals,
+                                          int num, int len, int status)
+{
+    uint64_t n = ring->head;
+    rp_signal_frame_t *f = &ring->frame[n % RP_SIGNAL_RING_SLOTS];
+    uint64_t one = 1;
+    int i;
+
+    if(num > RP_SIGNAL_RING_MAX_NUM)
+        num = RP_SIGNAL_RING_MAX_NUM;
+    if(len > RP_SIGNAL_RING_MAX_LEN)
+        len = RP_SIGNAL_RING_MAX_LEN;
+
+    __atomic_store_n(&f->seq, f->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    f->status = status;
+    f->sig_num = num;
+    f->sig_len = len;
+    for(i = 0; i < num; i++)
+        memcpy(&f->data[i][0], signals[i], len * sizeof(float));
+    __atomic_store_n(&f->seq, f->seq + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->head, n + 1, __ATOMIC_RELEASE);
+
+    if(write(ring->efd, &one, sizeof(one)) < 0) {
+        /* Counter overflow only, readers still see the new head */
+    }
+}
+
+/**
+ * Copies the newest frame into signals when one was published after *last.
+ * Signals longer than max_len are cut to max_len samples.
+ *
+ * @retval -1  no new frame, or it kept changing while copied
+ * @retval >=0 or -2 status of the copied frame
+ */
+static inline int rp_signal_ring_read(rp_signal_ring_t *ring, uint64_t *last,
+                                      float **signals, int *num, int *len,
+                                      int max_len)
+{
+    int retry, i;
+
+    for(retry = 0; retry < RP_SIGNAL_RING_RETRIES; retry++) {
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        rp_signal_frame_t *f;
+        uint32_t seq;
+        int status;
+
+        if(head == *last)
+            return -1;
+
+        f = &ring->frame[(head - 1) % RP_SIGNAL_RING_SLOTS];
+        seq = __atomic_load_n(&f->seq, __ATOMIC_ACQUIRE);
+        if(seq & 1)
+            continue;
+
+        status = f->status;
+        *num = f->sig_num;
+        *len = f->sig_len < max_len ? f->sig_len : max_len;
+        for(i = 0; i < *num; i++)
+            memcpy(signals[i], &f->data[i][0], *len * sizeof(float));
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&f->seq, __ATOMIC_RELAXED) != seq)
+            continue;
+
+        *last = head;
+        return status;
+    }
+    return -1;
+}
+
+#endif /* __RP_SIGNAL_RING_H */
@@ -21,12 +21,14 @@ using websocketpp::lib::bind;
 
 rp_websocket_server::rp_websocket_server()
     : m_params(NULL)
+    , m_keyframe(true)
     , m_OnClosed(false)
 {
 }
 
 rp_websocket_server::rp_websocket_server(struct server_parameters* params)
     : m_params(params)
+    , m_keyframe(true)
 {
     // set up access channels to only log interesting things
     m_endpoint.clear_access_channels(websocketpp::log::alevel::all);
@@ -123,6 +125,32 @@ void rp_websocket_server::on_signal_timer(websocketpp::lib::error_code const & e
 		return;
 	}
 
+	// Binary frames are only used when every client asked for them, the
+	// application marks signals as sent so one frame has to serve all
+	const void* frame = NULL;
+	size_t size = 0;
+	if (m_params->get_signals_binary_func && !m_connections.empty()
+		&& m_binary_connections.size() == m_connections.size()) {
+		frame = m_params->get_signals_binary_func(&size, m_keyframe);
+	}
+
+	if (frame) {
+		m_keyframe = false;
+		con_list::iterator it;
+		for (it = m_connections.begin(); it != m_connections.end(); ++it) {
+			m_endpoint.send(*it, frame, size, websocketpp::frame::opcode::binary);
+		}
+	} else {
+		// Clients did not see these values as deltas, restart from a keyframe
+		m_keyframe = true;
+		send_signals_json();
+	}
+	// set timer for next check
+	set_signal_timer();
+}
+
+void rp_websocket_server::send_signals_json() {
+
 	con_list::iterator it;
 	const char* signals = m_params->get_signals_func();
 
@@ -144,8 +172,6 @@ void rp_websocket_server::on_signal_timer(websocketpp::lib::error_code const & e
 			m_endpoint.send(*it, buf, size, websocketpp::frame::opcode::binary);
 		}
 	}
-	// set timer for next check
-	set_signal_timer();
 }
 
 void rp_websocket_server::on_param_timer(websocketpp::lib::error_code const & ec) {
@@ -237,6 +263,7 @@ void rp_websocket_server::on_open(connection_hdl hdl)
 void rp_websocket_server::on_close(connection_hdl hdl) {
 	m_endpoint.get_alog().write(websocketpp::log::alevel::app, "ws server connection closed");
 	m_connections.erase(hdl);
+	m_binary_connections.erase(hdl);
 
 	if (!m_OnClosed) {
 		exit(-1);
@@ -266,6 +293,16 @@ void rp_websocket_server::on_message(connection_hdl hdl, server::message_ptr msg
 		set_signal_timer();
 		m_params->set_signals_func(data_str);
 	}
+	else if(name == "binary_signals")
+	{
+		// {"binary_signals": true} switches this client to binary signal frames
+		if (child.as_bool()) {
+			m_binary_connections.insert(hdl);
+			m_keyframe = true;
+		} else {
+			m_binary_connections.erase(hdl);
+		}
+	}
 
 }
 
@@ -40,6 +40,7 @@ public:
     void on_open(connection_hdl hdl);
     void on_close(connection_hdl hdl);
     void on_message(connection_hdl hdl, server::message_ptr msg);
+    void send_signals_json();
 
 private:
     typedef std::set<connection_hdl,std::owner_less<connection_hdl>> con_list;
@@ -47,6 +48,8 @@ private:
     struct server_parameters* m_params;
     server m_endpoint;
     con_list m_connections;
+    con_list m_binary_connections; // clients which asked for binary signal frames
+    bool m_keyframe; // next binary frame must not contain deltas
     server::timer_ptr m_signal_timer;
     server::timer_ptr m_param_timer;
     websocketpp::lib::thread m_thread;
@@ -21,15 +21,14 @@
 #include <sys/ioctl.h>
 #include <stdio.h>
 #include <math.h>
+#include <time.h>
+#include <sched.h>
 #include <pthread.h>
+#include <deque>
+#include <algorithm>
 //#include <mutex>
 #include "ba_api.h"
-#include <chrono>
-#include "arm_neon.h"
-
-using namespace std::chrono;
-
-typedef double data_t;
+#include "rp_dsp_kernels.h"
 
 #define EXEC_CHECK_MUTEX(x, mutex){ \
  		int retval = (x); \
@@ -43,315 +42,74 @@ typedef double data_t;
 static std::vector<float> calib_data;
 static pthread_mutex_t mutex;
 
-data_t RMS(const std::vector<float> &data, int size){
-    data_t result = 0;
-    for(int i = 0; i < size; i++){
-		int x = data[i] * 1000;
-		double d = (double)x / 1000.0; 
-        result += d * d;
-    }
-    result =  sqrt(result / (double)size);
-    return result;
-}
-
-float ba_trapezoidalApprox(double *data, float T, int size) 
-{
-        double result = 0;
-
-        for(int i = 0; i < size - 1; i++){
-                result += data[i] + data[i+1];
-        }
-        result = ((T / 2.0) * result);
-        return result;
-}
-
-
 float l_inter(float a, float b, float f){
     return a + f * (b - a);
 }
 
-data_t InterpolateLagrangePolynomial (data_t x, data_t* x_values, data_t* y_values, int size)
+/* Decimation which fits _periods_number periods into a quarter of the buffer */
+static int rp_BaDecimation(float _freq, int _periods_number)
 {
-	data_t lagrange_pol = 0;
-	data_t basics_pol;
-
-	for (int i = 0; i < size; i++)
-	{
-		basics_pol = 1;
-		for (int j = 0; j < size; j++)
-		{
-			if (j == i) continue;
-			basics_pol *= (x - x_values[j])/(x_values[i] - x_values[j]);		
-		}
-		lagrange_pol += basics_pol*y_values[i];
-	}
-	return lagrange_pol;
-}
-
-data_t calcPoint(data_t *a, data_t *b,int lenghtArray,int index){
-	data_t x = 0;
-	int j = 0;
-	int i = index - lenghtArray > 0 ? index - lenghtArray : 0;
-	for (; i < lenghtArray && i <= index; i++) {
-		j = index - i;
-		x +=a[i]*b[lenghtArray - j - 1];
-	}
-	return x;
-}
-
-data_t getMaxArg(data_t *a, data_t *b,int start,int stop, int step,int lenghtArray){
-	int len = lenghtArray / step;
-	if (stop == 0)  stop = len;
-	data_t packBufA[len];
-	data_t packBufB[len];
-	data_t corralate[len];
-	int    corralateIndex[len];
+    int size_buff_limit = ADC_BUFFER_SIZE / 4;
+	int sampls = size_buff_limit / _periods_number;
+	int decimation = ADC_SAMPLE_RATE / (sampls * _freq);
+	decimation = decimation < 1 ? 1 : decimation;
 	
-	for(auto k = 0; k < len ; k++){
-		packBufA[k] = a[k*step];
-		packBufB[k] = b[k*step];
-		corralateIndex[k] = -1;
-	}
-
-	for(auto k = start; k <stop ; k++){
-		corralate[k] = calcPoint(packBufA,packBufB,len,k);
-		corralateIndex[k] = k;
-	}
-	int maxK = 0;
-	int maxCor = 0;
-	bool init = true;
-	for(auto k = 0; k < len ; k++){
-		if (corralateIndex[k] != -1)
-			if (corralate[k] > maxCor || init){
-				init = false;
-				maxCor = corralate[k];
-				maxK = k;
-			}
-	}
-	return maxK * step;
-}
-
-data_t crossCorrelation(data_t *xSignalArray, data_t *ySignalArray, int lenghtArray,int sepm_Per)
-{
-    data_t argmax = 0;
-    data_t *a = xSignalArray;
-	data_t *b = ySignalArray;
-	int step = log2(lenghtArray);
-	int maxK = -1;
-	int start = 0;
-	int stop  = 0;
-	while(step>=1){
-		maxK =getMaxArg(a,b,start/step,stop/step,step,lenghtArray);
-		start = maxK - step * 10 < 0 ? 0 : maxK - step * 10;
-		stop  = maxK + step * 10 > (lenghtArray * 2 + 1) ? (lenghtArray * 2 + 1) : maxK + step * 10;
-		step /=2;
-	}
-
-	argmax = maxK;
-
-	if (argmax > 0 && argmax < lenghtArray * 2){
-		data_t x_axis[] = { 0 , 1 , 2};
-		data_t y_axis[3];
-
-		for(int i = argmax-1,j=0; i <= argmax+1 ;i++,j++){
-			y_axis[j] = calcPoint(a,b,lenghtArray,i);
-		}
-		data_t eps = 0.0001;
-		data_t start = 0;
-		data_t stop = 2;
-		data_t y_start = InterpolateLagrangePolynomial(start,x_axis,y_axis,3);
-		data_t y_stop  = InterpolateLagrangePolynomial(stop,x_axis,y_axis,3);
-		data_t max_inter = 0;
-		while(eps  < (stop - start)){
-			data_t z = (stop - start)/2.0 + start;
-			data_t y_sub  = InterpolateLagrangePolynomial(z,x_axis,y_axis,3);
-			if (y_sub > y_start || y_sub > y_stop){
-				if (y_start > y_stop){
-					stop = z;
-					y_stop = y_sub;
-				}else{
-					start = z;
-					y_start = y_sub;
-				}
-				max_inter = z;
-			}
-			else{
-				max_inter = y_stop > y_start? stop : start;
-				break;
-			}
-		}
-		argmax = argmax-1 + max_inter;
-	}
-    return argmax;
-}
-
-data_t phaseCalculator(data_t freq_HZ, data_t samplesPerSecond, int numSamples,int sepm_Per, data_t *xSamples, data_t *ySamples)
-{
-    data_t timeShift, phaseShift, timeLine;
-    auto argmax = crossCorrelation(xSamples, ySamples, numSamples,sepm_Per);
-
-    timeLine = ((numSamples - 1) / samplesPerSecond);
-    timeShift = ((timeLine * argmax) / (numSamples - 1)) + (-timeLine);
-    phaseShift = ((2 * M_PI) * fmod((freq_HZ * timeShift), 1.0)) - M_PI;
-    if (phaseShift <= -M_PI/2) 
-		phaseShift += M_PI;
-	else if (phaseShift >= M_PI/2) 
-		phaseShift -= M_PI;
-	return phaseShift;
+	if (decimation < 16){
+        if (decimation >= 8)
+            decimation = 8;
+        else
+            if (decimation >= 4)
+                decimation = 4;
+            else
+                if (decimation >= 2)
+                    decimation = 2;
+                else 
+                    decimation = 1;
+    }
+    if (decimation > 65536){
+        decimation = 65536;
+    }
+    return decimation;
 }
 
-int rp_BaDataAnalysisTrap(const rp_ba_buffer_t &buffer,
-                                        uint32_t size,
-                                        float _freq, // 2*pi*f
-                                        int decimation,
-                                        float *gain,
-                                        float *phase_out,
-                                        float input_threshold) 
+int rp_BaDataAnalysis(const rp_ba_buffer_t &buffer,
+                      uint32_t size,
+                      float _freq,
+                      int decimation,
+                      float *gain,
+                      float *phase_out,
+                      float input_threshold)
 {
-
-		float w_out = _freq*2 * M_PI;
-
-        double ang, u_dut_1_phase, u_dut_2_phase, phase;
-
-        double T = (decimation / ADC_SAMPLE_RATE);
-        double u_dut_1[size];
-        double u_dut_2[size];
-
-        double u_dut_1_s[2][size];
-        double u_dut_2_s[2][size];
-
-        double component_lock_in[2][2];
         int ret_value = RP_OK;
+        rp_dsp_lockin_t in, out;
 
-        for (size_t i = 0; i < size; i++){
-                u_dut_1[i] = ceil(buffer.ch2[i] * 1000.0) / 1000.0;
-                u_dut_2[i] = ceil(buffer.ch1[i] * 1000.0) / 1000.0;
-        }
-
-        if (size > 0){
-                double u1_max = u_dut_1[0];
-                double u1_min = u_dut_1[0];
-                double u2_max = u_dut_2[0];
-                double u2_min = u_dut_2[0];
-                for (size_t i = 1; i < size; i++){
-                        if (u1_max < u_dut_1[i]) u1_max = u_dut_1[i];
-                        if (u2_max < u_dut_2[i]) u2_max = u_dut_2[i];
-                        if (u1_min > u_dut_1[i]) u1_min = u_dut_1[i];
-                        if (u2_min > u_dut_2[i]) u2_min = u_dut_2[i];
-                }
-                if ((u1_max - u1_min) < input_threshold) ret_value = RP_EIPV;
-                if ((u2_max - u2_min) < input_threshold) ret_value = RP_EIPV;
-
-        }
-
-        for (size_t i = 0; i < size; i++){
-                ang = (i * T * w_out);
-
-                u_dut_1_s[0][i] = u_dut_1[i] * sin(ang);
-                u_dut_1_s[1][i] = u_dut_1[i] * sin(ang + (M_PI / 2));
+        if (size == 0)
+                return RP_EOOR;
 
-                u_dut_2_s[0][i] = u_dut_2[i] * sin(ang);
-                u_dut_2_s[1][i] = u_dut_2[i] * sin(ang + (M_PI / 2));
-        }
-
-        /* Trapezoidal approximation */
-        component_lock_in[0][0] = ba_trapezoidalApprox(u_dut_1_s[0], T, size); //U_X
-        component_lock_in[0][1] = ba_trapezoidalApprox(u_dut_1_s[1], T, size); //U_Y
-        component_lock_in[1][0] = ba_trapezoidalApprox(u_dut_2_s[0], T, size); //I_X
-        component_lock_in[1][1] = ba_trapezoidalApprox(u_dut_2_s[1], T, size); //I_Y
-
-        /* Calculating voltage amplitude and phase */
-        // u_dut_1_ampl = 2.0 * (sqrtf(powf(component_lock_in[0][0], 2.0) + powf(component_lock_in[0][1], 2.0)));
+        /* Both channels against one NCO reference in a single pass, ch1 is the
+         * excitation and ch2 the response */
+        double cycles = static_cast<double>(_freq) * size * decimation / ADC_SAMPLE_RATE;
+        if (rp_dsp_lockin(buffer.ch1.data(), buffer.ch2.data(), size, cycles, &in, &out) != 0)
+                return RP_EOOR;
 
-        u_dut_1_phase = atan2f(component_lock_in[0][1], component_lock_in[0][0]);
+        if ((in.max - in.min) < input_threshold) ret_value = RP_EIPV;
+        if ((out.max - out.min) < input_threshold) ret_value = RP_EIPV;
 
-        /* Calculating current amplitude and phase */
-        // u_dut_2_ampl = 2.0 * (sqrtf(powf(component_lock_in[1][0], 2.0) + powf(component_lock_in[1][1], 2.0)));
-
-        u_dut_2_phase = atan2f(component_lock_in[1][1], component_lock_in[1][0]);
-
-        phase = u_dut_1_phase - u_dut_2_phase;
+        double phase = out.phase - in.phase;
 
         /* Phase has to be limited between M_PI and -M_PI. */
-        if (phase <= -M_PI) 
+        if (phase <= -M_PI)
                 phase += 2*M_PI;
-        else if (phase >= M_PI) 
+        else if (phase >= M_PI)
                 phase -= 2*M_PI;
 
         *phase_out = phase * (180.0 / M_PI);
-		// Old logic
-        // *gain = u_dut_1_ampl / u_dut_2_ampl;
-	
-		data_t sig1_rms =  RMS(buffer.ch1,size);	
-		data_t sig2_rms =  RMS(buffer.ch2,size);
-		*gain = sig2_rms / sig1_rms;
+        *gain = out.amp / in.amp;
 
         return ret_value;
 }
 
 
-int rp_BaDataAnalysis(const rp_ba_buffer_t &buffer,
-					uint32_t size,
-					float samplesPerSecond,
-					float _freq, 
-					float samples_period,
-					float *gain,
-					float *phase_out,
-					float input_threshold) 
-{
-	int ret_value = RP_OK;
-	data_t buf1[size];
-	data_t buf2[size];
-	data_t max_ch1 = -100000;
-	data_t max_ch2 = -100000;
-	data_t min_ch1 = 100000;
-	data_t min_ch2 = 100000;
-
-	for (size_t i = 0; i < size; i++){
-		buf1[i] = buffer.ch1[i];
-		buf2[i] = buffer.ch2[i];
-
-		// 
-		if ((buf1[i]) > max_ch1) {
-			max_ch1 = (buf1[i]);
-		}
-		if ((buf2[i]) > max_ch2) {
-			max_ch2 = (buf2[i]);
-		}
-		if ((buf1[i]) < min_ch1) {
-			min_ch1 = (buf1[i]);
-		}
-		if ((buf2[i]) < min_ch2) {
-			min_ch2 = (buf2[i]);
-		}
-	}
-
-	data_t sig1_rms =  RMS(buffer.ch1,size);
-	data_t sig2_rms =  RMS(buffer.ch2,size);
-	
-	fprintf(stderr,"freq %f\n",_freq);
-	fprintf(stderr,"RMS 1 %f min %f max %f\n",sig1_rms, min_ch1, max_ch1);
-	fprintf(stderr,"RMS 2 %f min %f max %f\n",sig2_rms, min_ch2, max_ch2);
-
-	
-	*gain = sig2_rms / sig1_rms;
-	
-	if ((max_ch1 - min_ch1) < input_threshold) ret_value = RP_EIPV;
-	if ((max_ch2 - min_ch2) < input_threshold) ret_value = RP_EIPV;
-	auto phase2 = phaseCalculator(_freq,samplesPerSecond, size ,samples_period,buf1,buf2);
-
-	/* Phase has to be limited between M_PI and -M_PI. */
-	if (phase2 <= -M_PI) 
-		phase2 += 2*M_PI;
-	else if (phase2 >= M_PI) 
-		phase2 -= 2*M_PI;
-
-	*phase_out = phase2 *  (180.0 / M_PI) ;
-	return ret_value;
-}
-
-
-
 float rp_BaCalibGain(float _freq, float _ampl)
 {
     for (size_t i = 3; i < calib_data.size(); i += 3) // 3 - freq, ampl, phase
@@ -517,26 +275,7 @@ int rp_BaGetAmplPhase(float _amplitude_in, float _dc_bias, int _periods_number,
 
     //Generate a sinusoidal wave form
     rp_BaSafeThreadGen(RP_CH_1, _freq, _amplitude_in, _dc_bias);
-    int size_buff_limit = ADC_BUFFER_SIZE / 4;
-	int sampls = size_buff_limit / _periods_number;
-	int decimation = ADC_SAMPLE_RATE / (sampls * _freq);
-	decimation = decimation < 1 ? 1 : decimation;
-	
-	if (decimation < 16){
-        if (decimation >= 8)
-            decimation = 8;
-        else
-            if (decimation >= 4)
-                decimation = 4;
-            else
-                if (decimation >= 2)
-                    decimation = 2;
-                else 
-                    decimation = 1;
-    }
-    if (decimation > 65536){
-        decimation = 65536;
-    }
+	int decimation = rp_BaDecimation(_freq, _periods_number);
 	
 	acq_size = round((static_cast<float>(_periods_number) * ADC_SAMPLE_RATE) / (_freq * decimation));
 
@@ -544,8 +283,7 @@ int rp_BaGetAmplPhase(float _amplitude_in, float _dc_bias, int _periods_number,
 
     rp_BaSafeThreadAcqData(_buffer,decimation, acq_size,_amplitude_in);
     rp_GenOutDisable(RP_CH_1);
-    //int ret = rp_BaDataAnalysis(_buffer, acq_size, ADC_SAMPLE_RATE / decimation,_freq, samples_period,  &gain, &phase_out,_input_threshold);
-	int ret = rp_BaDataAnalysisTrap(_buffer, acq_size, _freq, decimation,  &gain, &phase_out,_input_threshold);
+	int ret = rp_BaDataAnalysis(_buffer, acq_size, _freq, decimation, &gain, &phase_out, _input_threshold);
 
     *_amplitude = 10.*logf(gain);
     *_phase = phase_out;
@@ -553,3 +291,333 @@ int rp_BaGetAmplPhase(float _amplitude_in, float _dc_bias, int _periods_number,
     return ret;
 }
 
+
+/* Sweep scheduler
+ *
+ * The sweep is split between two threads. The acquire thread owns the hardware:
+ * it changes the generator frequency as soon as the last acquisition of a point
+ * is read out, waits for the settle time of the new point and acquires into one
+ * of BA_SWEEP_BUFFERS buffers. The DSP thread runs on the second core, analyses
+ * the filled buffers, averages them and queues one result per point. So the
+ * settle and acquisition of point N+1 overlap the analysis of point N.
+ *
+ * By default every point gets the requested periods and waits BA_SWEEP_SETTLE_US
+ * after the frequency change, as the unpipelined sweep did. The fast sweep cuts
+ * low frequency points to BA_SWEEP_FAST_MAX_ACQ_TIME and settles for
+ * BA_SWEEP_FAST_SETTLE_PERIODS periods only, which costs accuracy at low frequencies
+ * (fewer periods to average) and for slow settling DUTs. */
+
+struct rp_ba_sweep_job_t{
+	uint32_t         point;
+	int              status;
+	rp_ba_buffer_t  *buffer;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+	pthread_t       acq_thread;
+	pthread_t       dsp_thread;
+	bool            running;
+	bool            stop;
+	bool            acq_done;
+	bool            dsp_done;
+	float           ampl;
+	float           dc_bias;
+	float           threshold;
+	int             averaging;
+	uint32_t        done;
+	struct timespec start;
+	double          elapsed;
+	std::vector<rp_ba_sweep_point_t>  plan;
+	std::vector<rp_ba_buffer_t>       buffers;
+	std::deque<rp_ba_buffer_t *>      free_buffers;
+	std::deque<rp_ba_sweep_job_t>     jobs;
+	std::deque<rp_ba_sweep_result_t>  results;
+} sweep = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+static double rp_BaElapsed(const struct timespec &_start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - _start.tv_sec) + (now.tv_nsec - _start.tv_nsec) * 1e-9;
+}
+
+static int rp_BaSafeThreadFreq(rp_channel_t _channel, float _frequency)
+{
+	pthread_mutex_lock(&mutex);
+	EXEC_CHECK_MUTEX(rp_GenFreq(_channel, _frequency), mutex);
+	pthread_mutex_unlock(&mutex);
+	return RP_OK;
+}
+
+int rp_BaSweepPlan(float _freq, int _periods_number, bool _fast, rp_ba_sweep_point_t *_point)
+{
+	if (_freq <= 0 || _periods_number < 1 || _point == nullptr)
+		return RP_EIPV;
+
+	int periods = _periods_number;
+
+	/* Low frequencies: do not spend more than BA_SWEEP_FAST_MAX_ACQ_TIME on one acquisition */
+	if (_fast && periods / _freq > BA_SWEEP_FAST_MAX_ACQ_TIME){
+		int limit = ceil(_freq * BA_SWEEP_FAST_MAX_ACQ_TIME);
+		periods = std::max(limit, std::min(_periods_number, BA_SWEEP_FAST_MIN_PERIODS));
+	}
+
+	/* High frequencies in fast mode: without decimation more periods fit into the buffer at no cost */
+	int decimation = rp_BaDecimation(_freq, periods);
+	if (_fast && decimation == 1){
+		int fit = (ADC_BUFFER_SIZE / 4) * _freq / ADC_SAMPLE_RATE;
+		periods = std::max(periods, std::min(fit, BA_SWEEP_MAX_PERIODS));
+	}
+
+	int acq_size = round((static_cast<float>(periods) * ADC_SAMPLE_RATE) / (_freq * decimation));
+	acq_size = std::min(std::max(acq_size, 1), ADC_BUFFER_SIZE);
+
+	double settle = BA_SWEEP_SETTLE_US;
+	if (_fast){
+		settle = BA_SWEEP_FAST_SETTLE_PERIODS * 1e6 / _freq;
+		settle = std::min(std::max(settle, static_cast<double>(BA_SWEEP_FAST_SETTLE_MIN_US)), static_cast<double>(BA_SWEEP_SETTLE_US));
+	}
+
+	_point->freq = _freq;
+	_point->periods = periods;
+	_point->decimation = decimation;
+	_point->acq_size = acq_size;
+	_point->settle_us = settle;
+	return RP_OK;
+}
+
+static void *rp_BaSweepAcqThread(void *)
+{
+	for (uint32_t p = 0; p < sweep.plan.size(); ++p){
+		const rp_ba_sweep_point_t &point = sweep.plan[p];
+		struct timespec changed;
+
+		if (p == 0){
+			/* Full generator setup, it includes its own settle time */
+			rp_BaSafeThreadGen(RP_CH_1, point.freq, sweep.ampl, sweep.dc_bias);
+		}else{
+			rp_BaSafeThreadFreq(RP_CH_1, point.freq);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &changed);
+
+		for (int a = 0; a < sweep.averaging; ++a){
+			rp_ba_buffer_t *buffer;
+
+			pthread_mutex_lock(&sweep.lock);
+			while (sweep.free_buffers.empty() && !sweep.stop)
+				pthread_cond_wait(&sweep.cond, &sweep.lock);
+			if (sweep.stop){
+				pthread_mutex_unlock(&sweep.lock);
+				goto exit;
+			}
+			buffer = sweep.free_buffers.front();
+			sweep.free_buffers.pop_front();
+			pthread_mutex_unlock(&sweep.lock);
+
+			if (a == 0 && p != 0){
+				double left = point.settle_us - rp_BaElapsed(changed) * 1e6;
+				if (left > 0)
+					usleep(left);
+			}
+
+			rp_ba_sweep_job_t job;
+			job.point = p;
+			job.buffer = buffer;
+			job.status = rp_BaSafeThreadAcqData(*buffer, point.decimation, point.acq_size, sweep.ampl);
+
+			pthread_mutex_lock(&sweep.lock);
+			sweep.jobs.push_back(job);
+			pthread_cond_broadcast(&sweep.cond);
+			pthread_mutex_unlock(&sweep.lock);
+		}
+	}
+
+exit:
+	rp_GenOutDisable(RP_CH_1);
+	pthread_mutex_lock(&sweep.lock);
+	sweep.acq_done = true;
+	pthread_cond_broadcast(&sweep.cond);
+	pthread_mutex_unlock(&sweep.lock);
+	return nullptr;
+}
+
+static void *rp_BaSweepDspThread(void *)
+{
+	float ampl_sum = 0, phase_sum = 0, phase_first = 0;
+	int valid = 0, count = 0, status = RP_OK;
+
+	for (;;){
+		pthread_mutex_lock(&sweep.lock);
+		while (sweep.jobs.empty() && !sweep.acq_done)
+			pthread_cond_wait(&sweep.cond, &sweep.lock);
+		if (sweep.jobs.empty()){
+			pthread_mutex_unlock(&sweep.lock);
+			break;
+		}
+		rp_ba_sweep_job_t job = sweep.jobs.front();
+		sweep.jobs.pop_front();
+		pthread_mutex_unlock(&sweep.lock);
+
+		const rp_ba_sweep_point_t &point = sweep.plan[job.point];
+		float gain = 0, phase = 0;
+		int ret = job.status;
+		if (ret == RP_OK)
+			ret = rp_BaDataAnalysis(*job.buffer, point.acq_size, point.freq, point.decimation, &gain, &phase, sweep.threshold);
+
+		pthread_mutex_lock(&sweep.lock);
+		sweep.free_buffers.push_back(job.buffer);
+		pthread_cond_broadcast(&sweep.cond);
+		pthread_mutex_unlock(&sweep.lock);
+
+		float amplitude = 10.*logf(gain);
+		if (ret == RP_OK || ret == RP_EIPV){
+			if (std::isnan(amplitude) || std::isinf(amplitude)){
+				ret = RP_EOOR;
+			}else{
+				/* Average the phase relative to the first measurement, so results
+				 * around +-180 deg do not cancel out */
+				if (valid == 0)
+					phase_first = phase;
+				float delta = phase - phase_first;
+				if (delta > 180) delta -= 360;
+				else if (delta < -180) delta += 360;
+				ampl_sum += amplitude;
+				phase_sum += phase_first + delta;
+				++valid;
+				if (ret == RP_EIPV)
+					status = RP_EIPV;
+			}
+		}
+
+		if (++count < sweep.averaging)
+			continue;
+
+		rp_ba_sweep_result_t result;
+		result.index = job.point;
+		result.freq = point.freq;
+		result.amplitude = valid ? ampl_sum / valid : 0;
+		result.phase = valid ? phase_sum / valid : 0;
+		result.status = valid ? status : RP_EOOR;
+		if (result.phase > 180) result.phase -= 360;
+		else if (result.phase < -180) result.phase += 360;
+
+		ampl_sum = phase_sum = 0;
+		valid = count = 0;
+		status = RP_OK;
+
+		pthread_mutex_lock(&sweep.lock);
+		sweep.results.push_back(result);
+		sweep.done++;
+		sweep.elapsed = rp_BaElapsed(sweep.start);
+		pthread_cond_broadcast(&sweep.cond);
+		pthread_mutex_unlock(&sweep.lock);
+	}
+
+	pthread_mutex_lock(&sweep.lock);
+	sweep.dsp_done = true;
+	pthread_cond_broadcast(&sweep.cond);
+	pthread_mutex_unlock(&sweep.lock);
+	return nullptr;
+}
+
+int rp_BaSweepStart(const std::vector<float> &_freqs, float _amplitude_in, float _dc_bias, int _periods_number, int _averaging, float _input_threshold, bool _fast)
+{
+	if (sweep.running || _freqs.empty() || _averaging < 1)
+		return RP_EIPV;
+
+	sweep.plan.resize(_freqs.size());
+	for (size_t i = 0; i < _freqs.size(); ++i){
+		int ret = rp_BaSweepPlan(_freqs[i], _periods_number, _fast, &sweep.plan[i]);
+		if (ret != RP_OK)
+			return ret;
+	}
+
+	sweep.buffers.assign(BA_SWEEP_BUFFERS, rp_ba_buffer_t(ADC_BUFFER_SIZE));
+	sweep.free_buffers.clear();
+	for (auto &buffer : sweep.buffers)
+		sweep.free_buffers.push_back(&buffer);
+	sweep.jobs.clear();
+	sweep.results.clear();
+	sweep.ampl = _amplitude_in;
+	sweep.dc_bias = _dc_bias;
+	sweep.threshold = _input_threshold;
+	sweep.averaging = _averaging;
+	sweep.done = 0;
+	sweep.elapsed = 0;
+	sweep.stop = false;
+	sweep.acq_done = false;
+	sweep.dsp_done = false;
+	clock_gettime(CLOCK_MONOTONIC, &sweep.start);
+
+	if (pthread_create(&sweep.acq_thread, nullptr, rp_BaSweepAcqThread, nullptr) != 0)
+		return RP_EOOR;
+	if (pthread_create(&sweep.dsp_thread, nullptr, rp_BaSweepDspThread, nullptr) != 0){
+		/* The acquire thread may wait for a free buffer */
+		pthread_mutex_lock(&sweep.lock);
+		sweep.stop = true;
+		pthread_cond_broadcast(&sweep.cond);
+		pthread_mutex_unlock(&sweep.lock);
+		pthread_join(sweep.acq_thread, nullptr);
+		return RP_EOOR;
+	}
+
+	/* The acquire thread stays on the first core, the analysis goes to the second one */
+	if (sysconf(_SC_NPROCESSORS_ONLN) > 1){
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(0, &cpus);
+		pthread_setaffinity_np(sweep.acq_thread, sizeof(cpus), &cpus);
+		CPU_ZERO(&cpus);
+		CPU_SET(1, &cpus);
+		pthread_setaffinity_np(sweep.dsp_thread, sizeof(cpus), &cpus);
+	}
+
+	sweep.running = true;
+	return RP_OK;
+}
+
+bool rp_BaSweepGetResult(rp_ba_sweep_result_t *_result)
+{
+	if (!sweep.running)
+		return false;
+
+	pthread_mutex_lock(&sweep.lock);
+	while (sweep.results.empty() && !sweep.dsp_done)
+		pthread_cond_wait(&sweep.cond, &sweep.lock);
+	if (sweep.results.empty()){
+		pthread_mutex_unlock(&sweep.lock);
+		return false;
+	}
+	*_result = sweep.results.front();
+	sweep.results.pop_front();
+	pthread_mutex_unlock(&sweep.lock);
+	return true;
+}
+
+int rp_BaSweepProgress(uint32_t *_done, uint32_t *_total, double *_points_per_s)
+{
+	pthread_mutex_lock(&sweep.lock);
+	if (_done) *_done = sweep.done;
+	if (_total) *_total = sweep.plan.size();
+	if (_points_per_s) *_points_per_s = sweep.elapsed > 0 ? sweep.done / sweep.elapsed : 0;
+	pthread_mutex_unlock(&sweep.lock);
+	return RP_OK;
+}
+
+int rp_BaSweepStop()
+{
+	if (!sweep.running)
+		return RP_OK;
+
+	pthread_mutex_lock(&sweep.lock);
+	sweep.stop = true;
+	pthread_cond_broadcast(&sweep.cond);
+	pthread_mutex_unlock(&sweep.lock);
+
+	pthread_join(sweep.acq_thread, nullptr);
+	pthread_join(sweep.dsp_thread, nullptr);
+	sweep.running = false;
+	return RP_OK;
+}
@@ -24,6 +24,16 @@
 
 #define BA_CALIB_FILENAME "/tmp/ba_calib.data"
 
+/* Sweep scheduler limits */
+#define BA_SWEEP_BUFFERS             3       // acquisitions in flight between the acquire and DSP threads
+#define BA_SWEEP_MAX_PERIODS         256     // fast sweep, upper bound when the buffer allows more periods
+#define BA_SWEEP_SETTLE_US           10000   // settle time after a frequency change, as in the unpipelined sweep
+
+/* Fast sweep only, trades accuracy at low frequencies for sweep time */
+#define BA_SWEEP_FAST_MIN_PERIODS    2       // lower bound when the acquisition time is limited
+#define BA_SWEEP_FAST_MAX_ACQ_TIME   0.1     // [s] longest acquisition of one point
+#define BA_SWEEP_FAST_SETTLE_PERIODS 10      // generator periods to wait after a frequency change
+#define BA_SWEEP_FAST_SETTLE_MIN_US  100
 
 
 struct rp_ba_buffer_t{
@@ -32,12 +42,36 @@ struct rp_ba_buffer_t{
 	explicit rp_ba_buffer_t(size_t size): ch1(size), ch2(size) {}
 };
 
-  int rp_BaDataAnalysis(const rp_ba_buffer_t &buffer,uint32_t size, float samplesPerSecond,float _freq,  int  samples_period, float *gain, float *phase_out);
+/* Acquisition parameters of one sweep point, computed before the sweep starts */
+struct rp_ba_sweep_point_t{
+	float    freq;
+	int      periods;
+	int      decimation;
+	int      acq_size;
+	uint32_t settle_us;
+};
+
+/* One averaged sweep point as delivered by rp_BaSweepGetResult() */
+struct rp_ba_sweep_result_t{
+	uint32_t index;
+	float    freq;
+	float    amplitude;   // [dB], same scale as rp_BaGetAmplPhase()
+	float    phase;       // [deg]
+	int      status;      // RP_OK, RP_EIPV below the input threshold, RP_EOOR no valid measurement
+};
+
+  int rp_BaDataAnalysis(const rp_ba_buffer_t &buffer, uint32_t size, float _freq, int decimation, float *gain, float *phase_out, float input_threshold);
   int rp_BaSafeThreadAcqPrepare();
   int rp_BaSafeThreadGen(rp_channel_t _channel, float _frequency, float _ampl, float _dc_bias);
   int rp_BaSafeThreadAcqData(rp_ba_buffer_t &_buffer, rp_acq_decimation_t _decimation, int _acq_size, int _dec, float _trigger);
   int rp_BaGetAmplPhase(float _amplitude_in, float _dc_bias, int _periods_number, rp_ba_buffer_t &_buffer, float* _amplitude, float* _phase, float _freq,float _input_threshold);
 
+  int rp_BaSweepPlan(float _freq, int _periods_number, bool _fast, rp_ba_sweep_point_t *_point);
+  int rp_BaSweepStart(const std::vector<float> &_freqs, float _amplitude_in, float _dc_bias, int _periods_number, int _averaging, float _input_threshold, bool _fast);
+ bool rp_BaSweepGetResult(rp_ba_sweep_result_t *_result);
+  int rp_BaSweepProgress(uint32_t *_done, uint32_t *_total, double *_points_per_s);
+  int rp_BaSweepStop();
+
 float rp_BaCalibGain(float _freq, float _ampl);
 float rp_BaCalibPhase(float _freq, float _phase);
   int rp_BaResetCalibration();
@@ -54,7 +54,8 @@ void usage() {
                        "[count/steps] "
                        "[start freq] "
                        "[stop freq] "
-                       "[scale type]\n"
+                       "[scale type] "
+                       "[fast]\n"
             "or\n"
             "\t%s -calib\n"
             "\n"
@@ -67,6 +68,8 @@ void usage() {
             "\tstart freq         Lower frequency limit in Hz [3 - 62.5e6].\n"
             "\tstop freq          Upper frequency limit in Hz [3 - 62.5e6].\n"
             "\tscale type         0 - linear, 1 - logarithmic.\n"
+            "\tfast               Optional, 1 - shorter settle time and fewer periods at low\n"
+            "\t                   frequencies, less accurate there. 0 (default) - accurate sweep.\n"
             "\t-calib             Starts calibration mode. The calibration values will be saved in:"
             BA_CALIB_FILENAME
             "\n"
@@ -87,6 +90,7 @@ int main(int argc, char *argv[]) {
     double start_frequency = 100;
     double end_frequency = ADC_SAMPLE_RATE / 2.0;
     unsigned int scale_type = 1;
+    bool fast = false;
     int ignored __attribute__((unused));
 	
     /** Set program name */
@@ -181,6 +185,16 @@ int main(int argc, char *argv[]) {
             usage();
             return -1;
         }
+        /// Fast sweep (optional)
+        if (argc > 9) {
+            unsigned int fast_arg = strtod(argv[9], NULL);
+            if ( fast_arg > 1 ) {
+                fprintf(stderr, "Invalid fast value!\n\n");
+                usage();
+                return -1;
+            }
+            fast = fast_arg == 1;
+        }
     }
 
     /** Parameters initialization and calculation */
@@ -188,8 +202,6 @@ int main(int argc, char *argv[]) {
     double a,b,c;
     uint32_t  periods_number  = 8; // max 20
 
-    rp_ba_buffer_t buffer(ADC_BUFFER_SIZE);
-
     /* We try to open a data file */
     FILE *try_open = fopen("/tmp/bode_data/data_frequency", "w");
 
@@ -235,7 +247,6 @@ int main(int argc, char *argv[]) {
     }
 
 
-    int cur_step = 0;
     float freq_step = 0;
     
     if (scale_type)
@@ -249,59 +260,53 @@ int main(int argc, char *argv[]) {
         freq_step = (static_cast<float>(end_frequency) - static_cast<float>(start_frequency)) / (steps - 1);
     }
 
-   // fprintf(stderr, "a %f b %f c %f\n", a, b, c);
-
-    float old_freq = start_frequency;
-    //float old_steps = steps;
-    rp_Init();
-    rp_BaSafeThreadAcqPrepare();
-
-    while(steps > 0) {
-
-
-        float amplitude = 0, phase_out = 0;
-        float current_freq = 0.;
-        //float next_freq = 0.;
-
+    /* All frequencies are known up front, so the sweep scheduler can plan the
+     * acquisitions and change the generator while the previous point is analysed */
+    std::vector<float> frequencies(steps);
+    for (unsigned int cur_step = 0; cur_step < steps; cur_step++) {
         if (scale_type) {
             // Log
-            current_freq = pow(10.f, c * cur_step + a);
-         //   next_freq = pow(10.f, c * (cur_step + 1) + a);
+            frequencies[cur_step] = pow(10.f, c * cur_step + a);
         } else {
             // Linear
-            current_freq = static_cast<float>(old_freq) + freq_step * cur_step;
-          //  next_freq = static_cast<float>(old_freq) + freq_step * (cur_step + 1);
+            frequencies[cur_step] = static_cast<float>(start_frequency) + freq_step * cur_step;
         }
+    }
 
-        for (unsigned int i = 0; i < averaging_num; ++i)
-        {
-            float ampl_out = 0;
+    rp_Init();
+    rp_BaSafeThreadAcqPrepare();
 
-            if (rp_BaGetAmplPhase(ampl, DC_bias,periods_number, buffer, &ampl_out, &phase_out, current_freq,0) ==  RP_EOOR) // isnan && isinf
-            {
-                --steps;
-                continue;
-            }
-            amplitude += ampl_out;
-        }
-        amplitude /= averaging_num;
-   
-        --steps;
-        cur_step++;
-        float calib_ampl = rp_BaCalibGain(current_freq, amplitude);
-        float calib_phase = rp_BaCalibPhase(current_freq, phase_out);
-        fprintf(file_frequency, "%.5f\n", current_freq);
+    if (rp_BaSweepStart(frequencies, ampl, DC_bias, periods_number, averaging_num, 0, fast) != RP_OK) {
+        fprintf(stderr, "Failed to start the sweep!\n");
+        rp_Release();
+        return -1;
+    }
+
+    rp_ba_sweep_result_t result;
+    while (rp_BaSweepGetResult(&result)) {
+        if (result.status == RP_EOOR) // isnan && isinf
+            continue;
+
+        float calib_ampl = rp_BaCalibGain(result.freq, result.amplitude);
+        float calib_phase = rp_BaCalibPhase(result.freq, result.phase);
+        fprintf(file_frequency, "%.5f\n", result.freq);
         fprintf(file_amplitude, "%.5f\n", calib_ampl);
         fprintf(file_phase,     "%.5f\n", calib_phase);
             
         if (calibMode) // save data in calibration mode
         {
-			rp_BaWriteCalib(current_freq,amplitude,phase_out);
+			rp_BaWriteCalib(result.freq, result.amplitude, result.phase);
         }
 
-        printf("%.2f    %.5f    %.5f\n", current_freq, calib_phase, calib_ampl);
+        printf("%.2f    %.5f    %.5f\n", result.freq, calib_phase, calib_ampl);
     }
 
+    uint32_t done, total;
+    double points_per_s;
+    rp_BaSweepProgress(&done, &total, &points_per_s);
+    rp_BaSweepStop();
+    fprintf(stderr, "Sweep: %u/%u points, %.2f points/s\n", done, total, points_per_s);
+
     rp_Release();
     /* Closing files */
     fclose(file_frequency);
@@ -35,6 +35,8 @@
 #include "fpga_osc.h"
 #include "fpga_awg.h"
 #include "redpitaya/version.h"
+#include "lcr_results.h"
+#include "rp_dsp_kernels.h"
 
 #define M_PI 3.14159265358979323846
 
@@ -96,6 +98,15 @@ int LCR_data_analysis(float **s,
                       double w_out,
                       int f);
 
+void LCR_point_result(float complex Z_short,
+                      float complex Z_open,
+                      float complex Z_load,
+                      float complex Z_measure,
+                      double complex Z_load_ref,
+                      unsigned int calib_function,
+                      double w_out,
+                      lcr_result_t *res);
+
 int i2c_set_shunt (int k);
 
 /** Print usage information */
@@ -182,19 +193,6 @@ float max_array(float *arrayptr, int numofelements) {
   return max;
 }
 
-/** Trapezoidal method for integration */
-float trapz(float *arrayptr, float T, int size1) {
-  float result = 0;
-  int i;
-
-  for (i =0; i < size1 - 1 ; i++) {
-    result += ( arrayptr[i] + arrayptr[ i+1 ]  );
-  }
-
-  result = (T / (float)2) * result;
-  return result;
-}
-
 /** Finds a mean value of an array */
 float mean_array(float *arrayptr, int numofelements) {
   int i = 1;
@@ -221,6 +219,62 @@ float mean_array_column(float **arrayptr, int length, int column) {
     return result;
 }
 
+/**
+ * Calculates all the output quantities of one sweep point.
+ *
+ * Applies the selected calibration to the measured impedance and derives
+ * the admittance and the series/parallel equivalent circuit values.
+ *
+ * @param Z_short, Z_open, Z_load  Calibration measurements of this point.
+ * @param Z_measure       Measured impedance.
+ * @param Z_load_ref      Reference impedance of the load calibration.
+ * @param calib_function  0 - none, 1 - open, short and load, 2 - open and short.
+ * @param w_out           Angular velocity of the point.
+ * @param res             Returned results, frequency is left to the caller.
+ */
+void LCR_point_result(float complex Z_short,
+                      float complex Z_open,
+                      float complex Z_load,
+                      float complex Z_measure,
+                      double complex Z_load_ref,
+                      unsigned int calib_function,
+                      double w_out,
+                      lcr_result_t *res) {
+    float complex Z_final;
+    float complex Y;
+
+    if ( calib_function == 1 ) { // calib. was made including Z_load
+        Z_final = ( ( ( Z_short - Z_measure) * (Z_load - Z_open) ) / ( (Z_measure - Z_open) * (Z_short - Z_load) ) ) * Z_load_ref;
+    }
+    else if ( calib_function == 2 ) { // calibration without Z_load
+        Z_final = ( ( Z_short - Z_measure) * ( Z_open) ) / ( (Z_measure - Z_open) * (Z_short - Z_load) );
+    }
+    else { // no calib. were made, outputing data from measurements
+        Z_final = Z_measure;
+    }
+
+    res->phase = ( 180 / M_PI) * (atan2f( cimag(Z_final), creal(Z_final) ));
+    res->amplitude = sqrtf( powf( creal(Z_final), 2 ) + powf( cimag(Z_final), 2 ) );
+
+    res->R_s = creal(Z_final);//R_s=real(Z);
+    res->X_s = cimag(Z_final);//X_s=imag(Z);
+
+    Y = 1 / Z_final;//Y=1/Z;
+    res->Y_abs = sqrtf( powf( creal(Y), 2 ) + powf( cimag(Y), 2 ) );//Y_abs=abs(Y);
+    res->phaseY = -res->phase;// PhaseY=-Phase_rad;
+    res->G_p = creal(Y);//G_p=real(Y);
+    res->B_p = cimag(Y);//B_p=imag(Y);
+
+    res->C_s = -1 / (w_out * res->X_s);//C_s=-1/(w*X_s);
+    res->C_p = res->B_p / w_out;//C_p=B_p/w;
+    res->L_s = res->X_s / w_out;//L_s=X_s/w;
+    res->L_p = -1 / (w_out * res->B_p);//L_p=-1/(w*B_p);
+    res->R_p = 1 / res->G_p; //R_p=1/G_p;
+
+    res->Q = res->X_s / res->R_s; //Q=X_s/R_s;
+    res->D = -1 / res->Q; //D=-1/Q;
+}
+
 /** LCR meter  main function it includea all the functionality */
 int main(int argc, char *argv[]) {
 
@@ -501,117 +555,15 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
-    float *calib_data_combine = (float *)malloc( 2 * sizeof(float)); // 0=f, 1=Zreal, 2=Zimag
-    if (calib_data_combine == NULL){
-        fprintf(stderr,"error allocating memory for calib_data_combine\n");
-        return -1;
-    }
-    float complex *Z_final  = (float complex *)malloc( end_results_dimension * sizeof(float complex));
-    if (Z_final == NULL){
-        fprintf(stderr,"error allocating memory for Z_final\n");
-        return -1;
-    }
-
-    float *PhaseZ = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (PhaseZ == NULL){
-        fprintf(stderr,"error allocating memory for PhaseZ\n");
-        return -1;
-    }
-
-    float *PhaseY = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (PhaseY == NULL){
-        fprintf(stderr,"error allocating memory for PhaseY\n");
-        return -1;
-    }
-
-    float *AmplitudeZ = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (AmplitudeZ == NULL){
-        fprintf(stderr,"error allocating memory for AmplitudeZ\n");
-        return -1;
-    }
-
     float *Frequency = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
     if (Frequency == NULL){
         fprintf(stderr,"error allocating memory for Frequency\n");
         return -1;
     }
 
-    float *R_s = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (R_s == NULL){
-        fprintf(stderr,"error allocating memory for R_s\n");
-        return -1;
-    }
-
-    float *X_s = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (X_s == NULL){
-        fprintf(stderr,"error allocating memory for X_s\n");
-        return -1;
-    }
-
-    float complex *Y  = (float complex *)malloc( end_results_dimension * sizeof(float complex));
-    if (Y == NULL){
-        fprintf(stderr,"error allocating memory for Z_final\n");
-        return -1;
-    }
-
-
-    float *Y_abs  = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (Y_abs == NULL){
-        fprintf(stderr,"error allocating memory for Y_abs\n");
-        return -1;
-    }
-
-    float *G_p = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (G_p == NULL){
-        fprintf(stderr,"error allocating memory for G_p\n");
-        return -1;
-    }
-
-    float *B_p = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (B_p == NULL){
-        fprintf(stderr,"error allocating memory for B_p\n");
-        return -1;
-    }
-
-    float *C_s = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (C_s == NULL){
-        fprintf(stderr,"error allocating memory for C_s\n");
-        return -1;
-    }
-
-    float *C_p = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (C_p == NULL){
-        fprintf(stderr,"error allocating memory for C_p\n");
-        return -1;
-    }
-
-    float *L_s = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (L_s == NULL){
-        fprintf(stderr,"error allocating memory for L_s\n");
-        return -1;
-    }
-
-    float *L_p = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (L_p == NULL){
-        fprintf(stderr,"error allocating memory for L_p\n");
-        return -1;
-    }
-
-    float *R_p = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (R_p == NULL){
-        fprintf(stderr,"error allocating memory for R_p\n");
-        return -1;
-    }
-
-    float *Q = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (Q == NULL){
-        fprintf(stderr,"error allocating memory for Q\n");
-        return -1;
-    }
-
-    float *D = (float *)malloc((end_results_dimension + 1) * sizeof(float) );
-    if (D == NULL){
-        fprintf(stderr,"error allocating memory for D\n");
+    lcr_result_t *Results = (lcr_result_t *)malloc( end_results_dimension * sizeof(lcr_result_t) );
+    if (Results == NULL){
+        fprintf(stderr,"error allocating memory for Results\n");
         return -1;
     }
 
@@ -630,6 +582,14 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
+    /* Points are handed to the impedance analyzer as soon as they are measured */
+    lcr_results_t *shared_results = lcr_results_open(1);
+    if (shared_results == NULL) {
+        fprintf(stderr, "lcr_results_open() failed, results are only printed\n");
+    } else {
+        lcr_results_begin(shared_results);
+    }
+
     /** User is inquired to correctly set the connections. */
     /*
     if (inquire_user_wait() < 0) {
@@ -642,7 +602,6 @@ int main(int argc, char *argv[]) {
     * there are 4 sorts of measurement purposes , 3 pof them reprisent calibration sequence
     * [h=0] - calibration open connections, [h=1] - calibration short circuited, [h=2] calibration load, [h=3] actual measurment
     */
-    //FILE *progress_file = fopen("/tmp/lcr_data/progress.txt", "w");
     for (h = 0; h <= 3 ; h++) {
         if (!calib_function) {
             h = 3;
@@ -742,18 +701,8 @@ int main(int argc, char *argv[]) {
 
                 }
 
-                // writing data to a file
-                FILE *progress_file = fopen("/tmp/progress", "w");
-                if (progress_int <= 100){
-                    fprintf(progress_file , "%d \n" ,  progress_int );
-
-                    //sprintf(command, "/opt/redpitaya/bin/monitor 0x40000030 0x%x", (1 << (8*progress_int/100)) - 1);
-                    //system(command);
-                    fprintf(progress_file , "%d \n" ,  progress_int );
-                    //system("clear");
-                    //printf(" progress: %d  \n",progress_int);
-                     
-                    fclose(progress_file);
+                if (shared_results && progress_int <= 100) {
+                    lcr_results_progress(shared_results, progress_int);
                 }
 
                 int repeat = 0;
@@ -891,6 +840,19 @@ int main(int argc, char *argv[]) {
 
                 Z_measure[dimension_step] = Calib_data_measure[i][1] + Calib_data_measure[i][2] *I;
 
+                /* Calibration passes are over, so the point is final and can be published
+                 * right away. Transient effect elimination steps are dropped. */
+                if (h == 3 && !transientEffectFlag) {
+                    LCR_point_result( Z_short[dimension_step], Z_open[dimension_step], Z_load[dimension_step],
+                                      Z_measure[dimension_step], Z_load_ref, calib_function,
+                                      2 * M_PI * ( sweep_function ? Frequency[ fr ] : start_frequency ),
+                                      &Results[dimension_step] );
+                    Results[dimension_step].frequency = Frequency[ sweep_function ? fr : 0 ];
+                    if (shared_results) {
+                        lcr_results_set(shared_results, dimension_step, &Results[dimension_step]);
+                    }
+                }
+
             } // measurement sweep loop ends here
 
         } // frequency sweep loop ends here
@@ -911,227 +873,33 @@ int main(int argc, char *argv[]) {
     }
     */
 
-    /** Opening frequency data */
-    FILE *try_open = fopen("/tmp/lcr_data/data_frequency", "w");
-
-    /* If files don't exists yet, we first have to create them (First boot), as we are storing them in /tmp */
-    if(try_open == NULL){
-
-        int f_number;
-        char command[100];
-
-        strcpy(command, "mkdir /tmp/lcr_data");
-        system(command);
-
-        /* We loop X (Where X is the number of data we want to have) times and create a file for each data type */
-        for(f_number = 0; f_number < 16; f_number++){
-            switch(f_number){
-                case  0:  strcpy(command, "touch /tmp/lcr_data/data_frequency");  break;
-                case  1:  strcpy(command, "touch /tmp/lcr_data/data_amplitude");  break;
-                case  2:  strcpy(command, "touch /tmp/lcr_data/data_phase");      break;
-                case  3:  strcpy(command, "touch /tmp/lcr_data/data_R_s");        break;
-                case  4:  strcpy(command, "touch /tmp/lcr_data/data_X_s");        break;
-                case  5:  strcpy(command, "touch /tmp/lcr_data/data_G_p");        break;
-                case  6:  strcpy(command, "touch /tmp/lcr_data/data_B_p");        break;
-                case  7:  strcpy(command, "touch /tmp/lcr_data/data_C_s");        break;
-                case  8:  strcpy(command, "touch /tmp/lcr_data/data_C_p");        break;
-                case  9:  strcpy(command, "touch /tmp/lcr_data/data_L_s");        break;
-                case 10:  strcpy(command, "touch /tmp/lcr_data/data_L_p");        break;
-                case 11:  strcpy(command, "touch /tmp/lcr_data/data_R_p");        break;
-                case 12:  strcpy(command, "touch /tmp/lcr_data/data_Q");          break;
-                case 13:  strcpy(command, "touch /tmp/lcr_data/data_D");          break;
-                case 14:  strcpy(command, "touch /tmp/lcr_data/data_Y_abs");      break;
-                case 15:  strcpy(command, "touch /tmp/lcr_data/data_phaseY");     break;
-            }
-        }
-        /* We change the mode to write and add permission. */
-        system(command);
-        strcpy(command, "chmod -R 777 /tmp/lcr_data");
-
-        /* Command execution for before the next loop */
-        system(command);
-    }
-
-    /** Opening files */
-    FILE *file_frequency = fopen("/tmp/lcr_data/data_frequency", "w");
-    FILE *file_phase     = fopen("/tmp/lcr_data/data_phase", "w");
-    FILE *file_amplitude = fopen("/tmp/lcr_data/data_amplitude", "w");
-    FILE *file_Y_abs     = fopen("/tmp/lcr_data/data_Y_abs", "w");
-    FILE *file_PhaseY    = fopen("/tmp/lcr_data/data_phaseY", "w");
-    FILE *file_R_s       = fopen("/tmp/lcr_data/data_R_s", "w");
-    FILE *file_X_s       = fopen("/tmp/lcr_data/data_X_s", "w");
-    FILE *file_G_p       = fopen("/tmp/lcr_data/data_G_p", "w");
-    FILE *file_B_p       = fopen("/tmp/lcr_data/data_B_p", "w");
-    FILE *file_C_s       = fopen("/tmp/lcr_data/data_C_s", "w");
-    FILE *file_C_p       = fopen("/tmp/lcr_data/data_C_p", "w");
-    FILE *file_L_s       = fopen("/tmp/lcr_data/data_L_s", "w");
-    FILE *file_L_p       = fopen("/tmp/lcr_data/data_L_p", "w");
-    FILE *file_R_p       = fopen("/tmp/lcr_data/data_R_p", "w");
-    FILE *file_Q         = fopen("/tmp/lcr_data/data_Q", "w");
-    FILE *file_D         = fopen("/tmp/lcr_data/data_D", "w");
-
-    /** Combining all the data and printing it to stdout
-     * depending on calibration argument output data is calculated
-     */
+    /** Printing all the data to stdout */
     for ( i = 0; i < end_results_dimension ; i++ ) {
-
-        if ( calib_function == 1 ) { // calib. was made including Z_load
-            calib_data_combine[ 1 ] = creal( ( ( ( Z_short[i] - Z_measure[i]) * (Z_load[i] - Z_open[i]) ) / ( (Z_measure[i] - Z_open[i]) * (Z_short[i] - Z_load[i]) ) ) * Z_load_ref );
-            calib_data_combine[ 2 ] = cimag( ( ( ( Z_short[i] - Z_measure[i]) * (Z_load[i] - Z_open[i]) ) / ( (Z_measure[i] - Z_open[i]) * (Z_short[i] - Z_load[i]) ) ) * Z_load_ref );
-        }
-
-        else if ( calib_function == 0 ) { // no calib. were made, outputing data from measurements
-            calib_data_combine[ 1 ] = creal( Z_measure[ i ]);
-            calib_data_combine[ 2 ] = cimag( Z_measure[ i ]);
-        }
-
-        else if ( calib_function == 2 ) { // calibration without Z_load
-            calib_data_combine[ 1 ] = creal( ( ( ( Z_short[i] - Z_measure[i]) * ( Z_open[i]) ) / ( (Z_measure[i] - Z_open[i]) * (Z_short[i] - Z_load[i]) ) ) );
-            calib_data_combine[ 2 ] = cimag( ( ( ( Z_short[i] - Z_measure[i]) * ( Z_open[i]) ) / ( (Z_measure[i] - Z_open[i]) * (Z_short[i] - Z_load[i]) ) ) );
-        }
-        
-
-        if (sweep_function==0) 
-        {
-        w_out = 2 * M_PI * start_frequency; // angular velocity
-        }
-        else {
-        w_out = 2 * M_PI * Frequency[ i ]; // angular velocity
-        }  
-
-        PhaseZ[ i ] = ( 180 / M_PI) * (atan2f( calib_data_combine[ 2 ], calib_data_combine[ 1 ] ));
-        AmplitudeZ[ i ] = sqrtf( powf( calib_data_combine[ 1 ], 2 ) + powf(calib_data_combine[ 2 ], 2 ) );
-
-        Z_final[ i ] = calib_data_combine[ 1 ] + calib_data_combine[ 2 ]*I;//Z=Z_abs*exp(i*Phase_rad);;
-        R_s[ i ] =  calib_data_combine[ 1 ];//R_s=real(Z);
-        X_s[ i ] = calib_data_combine[ 2 ];//X_s=imag(Z);
-
-        Y [ i ] = 1 / Z_final[ i ];//Y=1/Z;
-        Y_abs [ i ] = sqrtf( powf( creal(Y[ i ]), 2 ) + powf(cimag(Y[ i ]), 2 ) );//Y_abs=abs(Y);
-        PhaseY[ i ] = -PhaseZ[ i ];// PhaseY=-Phase_rad;
-        G_p [ i ] = creal(Y[ i ]);//G_p=real(Y);;
-        B_p [ i ] = cimag(Y[ i ]);//B_p=imag(Y);
-
-        C_s [ i ] = -1 / (w_out * X_s[ i ]);//C_s=-1/(w*X_s);
-        C_p [ i ] = B_p[ i ] / w_out;//C_p=B_p/w; //inf
-        L_s [ i ] = X_s[ i ] / w_out;//L_s=X_s/w; //inf
-        L_p [ i ] = -1 / (w_out * B_p[ i ]);//L_p=-1/(w*B_p); //inf
-        R_p [ i ] = 1 / G_p [ i ]; //R_p=1/G_p;
-
-        Q[ i ] =X_s[ i ] / R_s[ i ]; //Q=X_s/R_s;
-        D[ i ] = -1 / Q [ i ]; //D=-1/Q;
-
-        /// Output
-        /*printf(" %.1f    %.3f    %.1f    %.10f    %.10f    %.10f    %.10f    %.10f    %.10f    %.10f    %.10f    %.10f    %.10f    %.10f    %.10f    %.10f\n",*/
-         printf(" %.1f    %.3e    %.2f    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.2f\n",  
-        
-        /*"Output:\tFrequency [Hz], |Z| [Ohm], P [deg], Ls [H], Cs [F], Rs [Ohm], Lp [H], Cp [F], Rp [Ohm], Q, D, Xs [H], Gp [S], Bp [S], |Y| [S], -P [deg]\n";*/   
-         
-            Frequency[ !sweep_function ? 0 : i ],
-            AmplitudeZ[ i ],
-            PhaseZ[ i ],
-            L_s[ i ],
-            C_s[ i ],
-            R_s[ i ],
-            L_p[ i ],
-            C_p[ i ],
-            R_p[ i ],
-            Q[ i ],
-            D[ i ],
-            X_s[ i ],               
-            G_p[ i ],
-            B_p[ i ],           
-            Y_abs[ i ],
-            PhaseY[ i ]
+        /*"Output:\tFrequency [Hz], |Z| [Ohm], P [deg], Ls [H], Cs [F], Rs [Ohm], Lp [H], Cp [F], Rp [Ohm], Q, D, Xs [H], Gp [S], Bp [S], |Y| [S], -P [deg]\n";*/
+        printf(" %.1f    %.3e    %.2f    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.3e    %.2f\n",
+            Results[ i ].frequency,
+            Results[ i ].amplitude,
+            Results[ i ].phase,
+            Results[ i ].L_s,
+            Results[ i ].C_s,
+            Results[ i ].R_s,
+            Results[ i ].L_p,
+            Results[ i ].C_p,
+            Results[ i ].R_p,
+            Results[ i ].Q,
+            Results[ i ].D,
+            Results[ i ].X_s,
+            Results[ i ].G_p,
+            Results[ i ].B_p,
+            Results[ i ].Y_abs,
+            Results[ i ].phaseY
             );
-
-
- 
-        /** Saving files */
-        if (!sweep_function) {
-            fprintf(file_frequency, "%.1f\n", Frequency[0]);
-        } else {
-            fprintf(file_frequency, "%.1f\n", Frequency[i]);
-            
-        }
-
-        fprintf(file_amplitude, "%.3f\n", AmplitudeZ[i]);        
-        fprintf(file_phase, "%.2f\n", PhaseZ[i]);
-        
-        fprintf(file_L_s, "%.15f\n", L_s[i]);
-        fprintf(file_C_s, "%.15f\n", C_s[i]);
-        fprintf(file_R_s, "%.15f\n", R_s[i]);
-
-        fprintf(file_L_p, "%.15f\n", L_p[i]);
-        fprintf(file_C_p, "%.15f\n", C_p[i]);
-        fprintf(file_R_p, "%.15f\n", R_p[i]);
-
-        fprintf(file_Q, "%.15f\n", Q[i]);
-        fprintf(file_D, "%.15f\n", D[i]);
-
-        fprintf(file_X_s, "%.15f\n", X_s[i]);
-        fprintf(file_G_p, "%.15f\n", G_p[i]);
-        fprintf(file_B_p, "%.15f\n", B_p[i]);
-
-        fprintf(file_Y_abs, "%.15f\n", Y_abs[i]);
-        fprintf(file_PhaseY, "%.15f\n", PhaseY[i]);
-
-        /*Dummy data*/
-        
-/*
-        fprintf(file_amplitude, "%.15f\n", 1.0e-15*powf((i-5),3.0));        
-        fprintf(file_phase, "%.2f\n", -90.0);
-        
-        fprintf(file_L_s, "%.15f\n", 1.0e12*powf((i-5),3.0));
-        fprintf(file_C_s, "%.15f\n", -110.0);
-        fprintf(file_R_s, "%.15f\n", 90.0);
-
-        fprintf(file_L_p, "%.15f\n", 100.0);
-        fprintf(file_C_p, "%.15f\n", 80.0);
-        fprintf(file_R_p, "%.15f\n", 99.0);
-
-        fprintf(file_Q, "%.15f\n", -95.0);
-        fprintf(file_D, "%.15f\n", -1000.0);
-
-        fprintf(file_X_s, "%.15f\n", 1100.0);
-        fprintf(file_G_p, "%.15f\n", 1200.0);
-        fprintf(file_B_p, "%.15f\n", 1300.0);
-
-        fprintf(file_Y_abs, "%.15f\n", 1400.0);
-        fprintf(file_PhaseY, "%.15f\n", 1500.0);*/
-          
-        
-        
-      
     }
 
-
-    /** Closing files */
-    fclose(file_frequency);
-    
-    fclose(file_amplitude);
-    fclose(file_phase);
-
-    fclose(file_L_s);
-    fclose(file_C_s);
-    fclose(file_R_s);
-
-    fclose(file_L_p);
-    fclose(file_C_p);
-    fclose(file_R_p);
-
-    fclose(file_Q);
-    fclose(file_D);
-    
-    fclose(file_X_s);
-    fclose(file_G_p);
-    fclose(file_B_p);
-    
-    fclose(file_Y_abs);
-    fclose(file_PhaseY);
-    
-    
-    
+    if (shared_results) {
+        lcr_results_end(shared_results);
+        lcr_results_close(shared_results);
+    }
 
     /** All's well that ends well. */
     return 1;
@@ -1367,60 +1135,26 @@ int LCR_data_analysis(float **s,
                       float complex *Z,
                       double w_out,
                       int f) {
-    int i2, i3;
-    float **U_acq = create_2D_table_size(SIGNALS_NUM, SIGNAL_LENGTH);
-    /* Used for storing the Voltage and current on the load */
-    float *U_dut = create_table_size( SIGNAL_LENGTH );
-    float *I_dut = create_table_size( SIGNAL_LENGTH );
-    /* Signals multiplied by the reference signal (sin) */
-    float *U_dut_sampled_X = (float *) malloc( size * sizeof( float ) );
-    float *U_dut_sampled_Y = (float *) malloc( size * sizeof( float ) );
-    float *I_dut_sampled_X = (float *) malloc( size * sizeof( float ) );
-    float *I_dut_sampled_Y = (float *) malloc( size * sizeof( float ) );
-    /* Signals return by trapezoidal method in complex */
-    float *X_component_lock_in_1 = (float *) malloc( size * sizeof( float ) );
-    float *X_component_lock_in_2 = (float *) malloc( size * sizeof( float ) );
-    float *Y_component_lock_in_1 = (float *) malloc( size * sizeof( float ) );
-    float *Y_component_lock_in_2 = (float *) malloc( size * sizeof( float ) );
+    rp_dsp_lockin_t in1, in2;
     /* Voltage, current and their phases calculated */
-    float U_dut_amp;
-    float Phase_U_dut_amp;
-    float I_dut_amp;
-    float Phase_I_dut_amp;
+    float complex U_dut;
+    float complex I_dut;
     float Phase_Z_rad;
     float Z_amp;
-    //float Z_phase_deg_imag;  // may cuse errors because not complex
     float T; // Sampling time in seconds
-    float *t = create_table_size(16384);
 
     T = ( g_dec[ f ] / 125e6 );
-    //printf("T = %f;\n",T );
 
-    for( i2 = 0; i2 < ( size - 1 ); i2++ ) {
-        t[ i2 ] = i2;
+    /* Both inputs are demodulated in one pass against the reference signal (lock in metod),
+     * the DC component is removed by the demodulator */
+    if (rp_dsp_lockin(s[ 1 ], s[ 2 ], size, w_out * T * size / ( 2 * M_PI ), &in1, &in2) < 0) {
+        return -1;
     }
 
     /* Transform signals from  AD - 14 bit to voltage [ ( s / 2^14 ) * 2 ] */
-    for ( i2 = 0; i2 < SIGNALS_NUM; i2++) { // only the 1 and 2 are used for i2
-        for( i3 = 0; i3 < size; i3 ++ ) {
-            //division comes after multiplication, this way no accuracy is lost
-            U_acq[i2][i3] = ( ( s[ i2 ][ i3 ] ) * (float)( 2 ) ) / (float)16384 ;
-            /*printf("%f\n",U_acq[i2][i3]);*/
-        }
-    }
-
-        int i;
-        float sum_buff_in1;
-        float sum_buff_in2;
-
-        for(i = 0; i < size; i++){
-
-        sum_buff_in1 += U_acq[1][i];
-        sum_buff_in2 += U_acq[2][i];
-               
-        }
-        float mean_buff_in1=sum_buff_in1/size;
-        float mean_buff_in2=sum_buff_in2/size;
+    const float scale = (float)2 / (float)16384;
+    float complex U_in1 = ( in1.re + in1.im * I ) * scale;
+    float complex U_in2 = ( in2.re + in2.im * I ) * scale;
 
       // MANUAL CORRECTION
       double C_cable=460E-12;
@@ -1440,46 +1174,14 @@ int LCR_data_analysis(float **s,
       else if   (R_shunt==10.0)          {  R_shunt=R_shunt*1.15;  C_cable=100E-12;  }
        /////// 
 
-   
-
-
     /* Voltage and current on the load can be calculated from gathered data */
-    for (i2 = 0; i2 < size; i2++) {
-        U_dut[ i2 ] = (((U_acq[ 1 ][ i2 ])- mean_buff_in1) - ((U_acq[ 2 ][ i2 ])- mean_buff_in2)); // potencial difference gives the voltage
-        // Curent trough the load is the same as trough thr R_shunt. ohm's law is used to calculate the current
-        I_dut[ i2 ] = (((U_acq[ 2 ][ i2 ])- mean_buff_in2) / ((R_shunt*(1.0/(w_out*C_cable)))/(R_shunt+(1.0/(w_out*C_cable)))));
-    }
-
-    /* Acquired signals must be multiplied by the reference signals, used for lock in metod */
-    float ang;
-    for( i2 = 0; i2 < size; i2++) {
-        ang = (i2 * T * w_out);
-        //printf("ang(%d) = %f \n", (i2+1), ang);
-        U_dut_sampled_X[ i2 ] = U_dut[ i2 ] * sin( ang );
-        U_dut_sampled_Y[ i2 ] = U_dut[ i2 ] * sin( ang+ ( M_PI/2 ) );
-
-        I_dut_sampled_X[ i2 ] = I_dut[ i2 ] * sin( ang );
-        I_dut_sampled_Y[ i2 ] = I_dut[ i2 ] * sin( ang +( M_PI/2 ) );
-    }
-
-    /* Trapezoidal method for calculating the approximation of an integral */
-    X_component_lock_in_1[ 1 ] = trapz( U_dut_sampled_X, (float)T, size );
-    Y_component_lock_in_1[ 1 ] = trapz( U_dut_sampled_Y, (float)T, size );
-
-    X_component_lock_in_2[ 1 ] = trapz( I_dut_sampled_X, (float)T, size );
-    Y_component_lock_in_2[ 1 ] = trapz( I_dut_sampled_Y, (float)T, size );
-
-    /* Calculating voltage amplitude and phase */
-    U_dut_amp = (float)2 * (sqrtf( powf( X_component_lock_in_1[ 1 ] , (float)2 ) + powf( Y_component_lock_in_1[ 1 ] , (float)2 )));
-    Phase_U_dut_amp = atan2f( Y_component_lock_in_1[ 1 ], X_component_lock_in_1[ 1 ] );
-
-    /* Calculating current amplitude and phase */
-    I_dut_amp = (float)2 * (sqrtf( powf( X_component_lock_in_2[ 1 ], (float)2 ) + powf( Y_component_lock_in_2[ 1 ] , (float)2 ) ) );
-    Phase_I_dut_amp = atan2f( Y_component_lock_in_2[1], X_component_lock_in_2[1] );
+    U_dut = U_in1 - U_in2; // potencial difference gives the voltage
+    // Curent trough the load is the same as trough thr R_shunt. ohm's law is used to calculate the current
+    I_dut = U_in2 / ((R_shunt*(1.0/(w_out*C_cable)))/(R_shunt+(1.0/(w_out*C_cable))));
 
     /* Asigning impedance  values (complex value) */
-    Phase_Z_rad =  Phase_U_dut_amp - Phase_I_dut_amp;
-    Z_amp = U_dut_amp / I_dut_amp; // forming resistance
+    Phase_Z_rad = cargf( U_dut ) - cargf( I_dut );
+    Z_amp = cabsf( U_dut ) / cabsf( I_dut ); // forming resistance
 
 
     /* Phase has to be limited between 180 and -180 deg. */
@@ -0,0 +1,197 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya LCR meter result table shared with the impedance analyzer.
+ *
+ * The lcr measurement core publishes every finished sweep point into a POSIX
+ * shared memory table, the impedance analyzer worker maps the same table and
+ * plots the points while the sweep is still running.
+ *
+ * There is a single writer. A point is written before the count covering it
+ * is stored with release semantics, so a reader which loads the count with
+ * acquire semantics may copy every point below it without locking. A point
+ * can be rewritten while it is below the count, so each one carries a
+ * sequence stamp which is odd while the writer updates it and the reader
+ * copies it again when the stamp changed. The run counter changes when a new
+ * sweep starts and lets readers detect that the table was reset underneath
+ * them.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __LCR_RESULTS_H
+#define __LCR_RESULTS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LCR_RESULTS_SHM    "/rp_lcr_results"
+#define LCR_RESULTS_MAGIC  0x3252434c /* "LCR2" */
+#define LCR_RESULTS_MAX    1024
+/* Copies of a point the reader tries while the writer keeps changing it */
+#define LCR_RESULTS_RETRY  16
+
+/** One sweep point, the same quantities lcr prints to stdout */
+typedef struct lcr_result_s {
+    float frequency;    // [Hz]
+    float amplitude;    // |Z| [Ohm]
+    float phase;        // [deg]
+    float Y_abs;        // |Y| [S]
+    float phaseY;       // [deg]
+    float R_s;
+    float X_s;
+    float G_p;
+    float B_p;
+    float C_s;
+    float C_p;
+    float L_s;
+    float L_p;
+    float R_p;
+    float Q;
+    float D;
+} lcr_result_t;
+
+typedef struct lcr_results_s {
+    uint32_t          magic;
+    /* Incremented when a sweep starts */
+    volatile uint32_t run;
+    /* Points of the current run which are ready */
+    volatile uint32_t count;
+    /* Set when the current run finished */
+    volatile uint32_t done;
+    /* Sweep progress [0 - 100] */
+    volatile int32_t  progress;
+    /* Per point stamp, odd while the point is written */
+    volatile uint32_t seq[LCR_RESULTS_MAX];
+    lcr_result_t      point[LCR_RESULTS_MAX];
+} lcr_results_t;
+
+/**
+ * Maps the shared result table, the writer creates it when it does not exist.
+ *
+ * @retval NULL when the table does not exist (reader) or cannot be mapped
+ */
+static inline lcr_results_t *lcr_results_open(int create)
+{
+    lcr_results_t *r;
+    int fd;
+
+    fd = shm_open(LCR_RESULTS_SHM, create ? (O_RDWR | O_CREAT) : O_RDWR, 0666);
+    if(fd < 0)
+        return NULL;
+    if(create && ftruncate(fd, sizeof(lcr_results_t)) < 0) {
+        close(fd);
+        return NULL;
+    }
+    r = (lcr_results_t *)mmap(NULL, sizeof(lcr_results_t), PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, 0);
+    close(fd);
+    if(r == MAP_FAILED)
+        return NULL;
+
+    if(r->magic != LCR_RESULTS_MAGIC) {
+        if(!create) {
+            munmap(r, sizeof(lcr_results_t));
+            return NULL;
+        }
+        memset(r, 0, sizeof(lcr_results_t));
+        r->magic = LCR_RESULTS_MAGIC;
+    }
+    return r;
+}
+
+static inline void lcr_results_close(lcr_results_t *r)
+{
+    if(r)
+        munmap(r, sizeof(lcr_results_t));
+}
+
+/** Writer: empties the table for a new sweep */
+static inline void lcr_results_begin(lcr_results_t *r)
+{
+    uint32_t i;
+
+    /* A writer killed in the middle of a point leaves its stamp odd */
+    for(i = 0; i < LCR_RESULTS_MAX; i++) {
+        if(r->seq[i] & 1)
+            __atomic_store_n(&r->seq[i], r->seq[i] + 1, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&r->count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->done, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->progress, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->run, r->run + 1, __ATOMIC_RELEASE);
+    /* Points of the new run must not become visible before the run changes */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/** Writer: publishes point idx, all points below it must be published already */
+static inline void lcr_results_set(lcr_results_t *r, uint32_t idx, const lcr_result_t *p)
+{
+    uint32_t seq;
+
+    if(idx >= LCR_RESULTS_MAX)
+        return;
+    seq = r->seq[idx];
+    __atomic_store_n(&r->seq[idx], seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    r->point[idx] = *p;
+    __atomic_store_n(&r->seq[idx], seq + 2, __ATOMIC_RELEASE);
+    if(idx + 1 > r->count)
+        __atomic_store_n(&r->count, idx + 1, __ATOMIC_RELEASE);
+}
+
+static inline void lcr_results_progress(lcr_results_t *r, int progress)
+{
+    __atomic_store_n(&r->progress, progress, __ATOMIC_RELAXED);
+}
+
+static inline void lcr_results_end(lcr_results_t *r)
+{
+    __atomic_store_n(&r->progress, 100, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->done, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Reader: copies up to max points of the current run into out.
+ *
+ * @retval -1  the table was reset or a point kept changing while copying, try
+ *             again later
+ * @retval >=0 number of copied points
+ */
+static inline int lcr_results_read(lcr_results_t *r, lcr_result_t *out, uint32_t max)
+{
+    uint32_t run = __atomic_load_n(&r->run, __ATOMIC_ACQUIRE);
+    uint32_t count = __atomic_load_n(&r->count, __ATOMIC_ACQUIRE);
+    uint32_t i, seq, tries;
+
+    if(count > max)
+        count = max;
+    for(i = 0; i < count; i++) {
+        for(tries = 0; ; tries++) {
+            if(tries == LCR_RESULTS_RETRY)
+                return -1;
+            seq = __atomic_load_n(&r->seq[i], __ATOMIC_ACQUIRE);
+            if(seq & 1)
+                continue;
+            out[i] = r->point[i];
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if(__atomic_load_n(&r->seq[i], __ATOMIC_RELAXED) == seq)
+                break;
+        }
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if(__atomic_load_n(&r->run, __ATOMIC_RELAXED) != run)
+        return -1;
+    return count;
+}
+
+#endif /* __LCR_RESULTS_H */
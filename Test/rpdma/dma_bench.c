@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "rp2.h"
+#include "la_acq.h"
+#include "rp_dma.h"
+
+// Sustained cyclic RX throughput over the api2 DMA ring. The logic analyzer
+// runs in continuous mode as the data source, every segment is read once
+// (or copied with -m) and released. Reports MB/s and the segment drop rate.
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-c segments] [-s segment bytes] [-d decimation] [-t seconds] [-m]\n", name);
+}
+
+int main(int argc, char *argv[]) {
+    rp_handle_uio_t handle;
+    rp_dma_ring_t ring;
+    uint32_t cnt = RP_SGMNT_CNT;
+    uint32_t size = RP_SGMNT_SIZE;
+    uint32_t dec = 1;
+    double seconds = 10;
+    int copy = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:s:d:t:m")) != -1) {
+        switch (opt) {
+            case 'c': cnt = strtoul(optarg, NULL, 0); break;
+            case 's': size = strtoul(optarg, NULL, 0); break;
+            case 'd': dec = strtoul(optarg, NULL, 0); break;
+            case 't': seconds = atof(optarg); break;
+            case 'm': copy = 1; break;
+            default: usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (dec < 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (rp_LaAcqOpen("/dev/uio/la", &handle) != RP_OK) {
+        fprintf(stderr, "Red Pitaya API init failed!\n");
+        return EXIT_FAILURE;
+    }
+
+    // 16 bit samples at 125 MS/s / dec
+    double byte_rate = 125e6 / dec * sizeof(int16_t);
+    if (rp_DmaRingOpen(&handle, &ring, cnt, size, byte_rate) != RP_OK) {
+        fprintf(stderr, "Invalid segment geometry %u x %u\n", cnt, size);
+        rp_LaAcqClose(&handle);
+        return EXIT_FAILURE;
+    }
+    // the write counter of the logic analyzer finds completions the driver did not report
+    rp_DmaRingSetPosition(&handle, &ring, rp_LaAcqGetRLECurrent, sizeof(int16_t));
+    uint8_t *dst = copy ? malloc(size) : NULL;
+
+    rp_la_decimation_regset_t d = { .dec = dec - 1 };
+    rp_LaAcqStopAcq(&handle);
+    rp_LaAcqReset(&handle);
+    rp_LaAcqSetDecimation(&handle, d);
+    rp_LaAcqDisableRLE(&handle);
+    rp_LaAcqGlobalTrigSet(&handle, RP_TRG_ALL_MASK);
+    rp_LaAcqSetConfig(&handle, RP_LA_ACQ_CFG_CONT_MASK | RP_LA_ACQ_CFG_AUTO_MASK);
+
+    printf("segments %u x %u bytes, source %.1f MB/s\n", cnt, size, byte_rate / 1e6);
+
+    uint64_t segments = 0, overruns = 0, sum = 0;
+    double start = now(), t = start;
+    // rp_LaAcqRunAcq() starts cyclic RX
+    rp_DmaRingReset(&ring);
+    rp_LaAcqRunAcq(&handle);
+
+    while (t - start < seconds) {
+        uint32_t seg;
+        if (rp_DmaRingWait(&handle, &ring, 1000, &seg, &overruns) != RP_OK) {
+            fprintf(stderr, "wait failed\n");
+            break;
+        }
+        if (seg == RP_DMA_NO_SGMNT) {
+            fprintf(stderr, "no data\n");
+            break;
+        }
+        const uint8_t *src = RP_DMA_SGMNT(&ring, seg);
+        if (dst) {
+            memcpy(dst, src, size);
+            sum += dst[size - 1];
+        } else {
+            for (uint32_t i = 0; i < size; i += 64) {
+                sum += src[i];
+            }
+        }
+        rp_DmaRingRelease(&ring);
+        segments++;
+        t = now();
+    }
+    double elapsed = now() - start;
+
+    rp_LaAcqStopAcq(&handle);
+    rp_LaAcqSetConfig(&handle, 0);
+
+    printf("%llu segments in %.2f s, %.1f MB/s sustained\n", (unsigned long long) segments, elapsed,
+           segments * (double) size / elapsed / 1e6);
+    printf("dropped %llu segments, drop rate %.4f %%\n", (unsigned long long) overruns,
+           segments + overruns ? 100.0 * overruns / (segments + overruns) : 0.0);
+    printf("checksum %llu\n", (unsigned long long) sum);
+
+    free(dst);
+    rp_DmaRingClose(&handle, &ring);
+    rp_LaAcqClose(&handle);
+    return overruns ? 2 : EXIT_SUCCESS;
+}
@@ -13,7 +13,9 @@ std::string cli_help_string() {
     "-a, --average: average the measurement from 10 times (default: enabled)\n"
     "-n, --no-average: disable average the measurement from 10 times\n"
     "-C, --csv: print values by columns Frequency (Hz), ch0 (dB), ch1 (dB)\n"
-    "-L, --csv-limit: print values by columns Frequency (Hz), ch0 min (dB), ch0 max (dB), ch1 min (dB), ch1 max (dB)\n";
+    "-L, --csv-limit: print values by columns Frequency (Hz), ch0 min (dB), ch0 max (dB), ch1 min (dB), ch1 max (dB)\n"
+    "-W, --welch: average the given number of overlapped segments into a power spectral density in dBm/Hz (default: 0, disabled)\n"
+    "-S, --segment: Welch segment length in samples (default: 4096)\n";
 }
 
 const struct option long_opt[] = {
@@ -25,6 +27,8 @@ const struct option long_opt[] = {
         { "no-average", no_argument,        0, 'n' },
         { "csv",        no_argument,        0, 'C' },
         { "csv-limit",  no_argument,        0, 'L' },
+        { "welch",      required_argument,  0, 'W' },
+        { "segment",    required_argument,  0, 'S' },
         { 0,            0,                  0,  0  }
     };
 
@@ -35,7 +39,7 @@ bool cli_parse_args(int argc, char * const argv[], cli_args_t &out_args) {
     try {
         int short_opt;
         int option_index = 0;
-        while ((short_opt = getopt_long(argc, argv, "hm:M:c:anCLt", long_opt, &option_index)) != -1) {            
+        while ((short_opt = getopt_long(argc, argv, "hm:M:c:anCLtW:S:", long_opt, &option_index)) != -1) {            
             switch (short_opt) {
             case 'h':
                 args.help = true;
@@ -79,6 +83,19 @@ bool cli_parse_args(int argc, char * const argv[], cli_args_t &out_args) {
                 args.csv_limit = true;
                 break;
 
+            case 'W':
+                args.welch = std::stoi(optarg);
+
+                if (args.welch < 0) {
+                    throw std::out_of_range("welch");
+                }
+
+                break;
+
+            case 'S':
+                args.segment = std::stoul(optarg);
+                break;
+
             // case '?':
             default:
                 throw std::logic_error("");
@@ -94,6 +111,10 @@ bool cli_parse_args(int argc, char * const argv[], cli_args_t &out_args) {
             throw std::logic_error("--csv and --csv-limit: only one can be used");
         }
 
+        if (args.welch && args.csv_limit) {
+            throw std::logic_error("--welch can not be used with --csv-limit");
+        }
+
         if (args.csv && (args.count != 1)) {
             throw std::logic_error("--count can not be used with --csv");
         }
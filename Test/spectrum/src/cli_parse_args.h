@@ -9,6 +9,8 @@ struct cli_args_t {
     bool average_for_10 = true;
     bool csv = false;
     bool csv_limit = false;
+    int welch = 0;
+    unsigned int segment = 4096;
     bool help = false;
 };
 
@@ -10,6 +10,7 @@
 #include <version.h>
 #include <rp.h>
 #include <rp_dsp.h>
+#include <rp_psd.h>
 
 #include "cli_parse_args.h"
 
@@ -22,6 +23,7 @@
 namespace {
 
 static rp_dsp_api::CDSP g_dsp(MAX_CHANNELS,ADC_BUFFER_SIZE,ADC_SAMPLE_RATE);
+static rp_dsp_api::CPSD g_psd(MAX_CHANNELS,ADC_BUFFER_SIZE);
 static sig_atomic_t     g_quit_requested = 0;
 
 static void quit_handler(int) {
@@ -82,13 +84,27 @@ static void spectrum_worker(cli_args_t args) {
         peak_pw_freq_max[ch] = std::numeric_limits<float>::lowest();
     }
 
+    const bool welch = args.welch > 0;
+    auto psd = createArray<float>(ADC_BUFFER_SIZE / 2 + 1);
+
+    if (welch) {
+        g_psd.setSampleRate((double)ADC_SAMPLE_RATE / decimation);
+        if (g_psd.setSegmentLength(args.segment)
+            || g_psd.setOverlap(0.5)
+            || g_psd.setAveraging(rp_dsp_api::CPSD::LINEAR, args.welch)
+            || g_psd.init()) {
+            fprintf(stderr,"Error in g_psd.init\n");
+            return;
+        }
+    }
+
     int count = args.count;
 
     if (args.csv) {
         count = 1;
         std::cout << "Frequency (Hz)";
         for(uint32_t ch = 0; ch < MAX_CHANNELS; ch++){
-            std::cout << ", ch"<< ch << " (dB)";
+            std::cout << ", ch"<< ch << (welch ? " (dBm/Hz)" : " (dB)");
         }
         std::cout << "\n";
     } else if (args.csv_limit) {        
@@ -132,15 +148,38 @@ static void spectrum_worker(cli_args_t args) {
         rp_AcqGetDataV2D(trig_pos,&buffer_size, data->in[0], data->in[1]);
 #endif
 
-        g_dsp.windowFilter(data);
+        if (welch) {
+            // Acquisitions are not contiguous, segments must not span two of them
+            g_psd.discardPending();
+            g_psd.push(data->in, buffer_size);
+            if (g_psd.getSegmentsAveraged() < (uint32_t)args.welch) {
+                continue;
+            }
 
-        if (g_dsp.fft(data)){
-            fprintf(stderr,"Error in g_dsp.fft\n");
-            return;
-        }
+            const double bin = g_psd.getBinWidth();
+            const uint32_t bin_min = std::ceil(args.freq_min / bin);
+            const uint32_t bin_max = std::min<uint32_t>(std::floor(args.freq_max / bin), g_psd.getBins() - 1);
+            for(uint32_t ch = 0; ch < MAX_CHANNELS; ch++){
+                g_psd.getPSDdBm(ch, psd[ch], g_psd.getBins());
+                data->peak_power[ch] = std::numeric_limits<float>::lowest();
+                for (uint32_t i = bin_min; i <= bin_max; ++i) {
+                    if (psd[ch][i] > data->peak_power[ch]) {
+                        data->peak_power[ch] = psd[ch][i];
+                        data->peak_freq[ch] = i * bin;
+                    }
+                }
+            }
+        } else {
+            g_dsp.windowFilter(data);
+
+            if (g_dsp.fft(data)){
+                fprintf(stderr,"Error in g_dsp.fft\n");
+                return;
+            }
 
-        g_dsp.decimate(data,g_dsp.getOutSignalMaxLength(),g_dsp.getOutSignalMaxLength());
-        g_dsp.cnvToDBMMaxValueRanged(data,decimation,args.freq_min,args.freq_max);
+            g_dsp.decimate(data,g_dsp.getOutSignalMaxLength(),g_dsp.getOutSignalMaxLength());
+            g_dsp.cnvToDBMMaxValueRanged(data,decimation,args.freq_min,args.freq_max);
+        }
 
         // Summary peak calculation
         if (peak_set) {
@@ -173,7 +212,7 @@ static void spectrum_worker(cli_args_t args) {
 
         if (!args.csv && !args.csv_limit) {
             for(uint32_t i = 0; i < MAX_CHANNELS; i++){
-                std::cout << "ch" << i << " peak: " << data->peak_freq[i] << " Hz, " << data->peak_power[i] << " dB\n";
+                std::cout << "ch" << i << " peak: " << data->peak_freq[i] << " Hz, " << data->peak_power[i] << (welch ? " dBm/Hz\n" : " dB\n");
             }
         }
 
@@ -191,7 +230,18 @@ static void spectrum_worker(cli_args_t args) {
 
     if (peak_set) {
 
-        if (args.csv) {
+        if (args.csv && welch) {
+            const double bin = g_psd.getBinWidth();
+            const uint32_t bin_min = std::ceil(args.freq_min / bin);
+            const uint32_t bin_max = std::min<uint32_t>(std::floor(args.freq_max / bin), g_psd.getBins() - 1);
+            for (uint32_t i = bin_min; i <= bin_max; ++i) {
+                std::cout << (bin * i);
+                for(uint32_t ch = 0; ch < MAX_CHANNELS; ch++){
+                    std::cout << ", " << psd[ch][i];
+                }
+                std::cout << "\n";
+            }
+        } else if (args.csv) {
             for (size_t i = 0; i < (freq_index_max - freq_index_min + 1); ++i) {
                 std::cout << (freq_step * (freq_index_min + i));
                 for(uint32_t ch = 0; ch < MAX_CHANNELS; ch++){
@@ -216,6 +266,7 @@ static void spectrum_worker(cli_args_t args) {
 
     std::cout << std::flush;
 
+    deleteArray<float>(psd);
     deleteArray<float>(max_signals);
     deleteArray<float>(min_signals);
     g_dsp.deleteData(data);
@@ -985,6 +985,11 @@ int rp_get_signals(float ***s, int *sig_num, int *sig_len)
     return 0;
 }
 
+rp_signal_ring_t *rp_get_signal_ring(void)
+{
+    return rp_osc_get_signal_ring();
+}
+
 int rp_create_signals(float ***a_signals)
 {
     int i;
@@ -22,7 +22,7 @@
 #include "main.h"
 #include "fpga.h"
 #include "dsp.h"
-#include "kiss_fftr.h"
+#include "rp_dsp_kernels.h"
 
 
 /* length of output signals: floor(SPECTR_FPGA_SIG_LEN/2) */
@@ -30,9 +30,7 @@ const int c_dsp_sig_len = SPECTR_FPGA_SIG_LEN / 2;
 
 /* Internal structures used in DSP  */
 double               *rp_hann_window   = NULL;
-kiss_fft_cpx         *rp_kiss_fft_out1 = NULL;
-kiss_fft_cpx         *rp_kiss_fft_out2 = NULL;
-kiss_fftr_cfg         rp_kiss_fft_cfg  = NULL;
+rp_dsp_fftr_t        *rp_fft           = NULL;
 
 /* constants - calibration dependant */
 /* Power calc. impedance*/
@@ -84,6 +82,26 @@ int rp_resp_prepare_freq_vector(float **freq_out, double f_s,
 }
 
 
+static void resp_calc_ch(const kiss_fft_cpx *fft, int k1, double scale, int kstp, int II,
+                         double *out)
+{
+    int i;
+    /* Saturate to -200 dB */
+    const double c_min_response = 1e-10;
+    const int bins = SPECTR_FPGA_SIG_LEN / 2 + 1;
+
+    for(i = 0; i < II; i++) {
+        const int k = (k1 + i) * kstp;
+        out[k1 + i] = c_min_response;
+        if (k < bins) {
+            out[k1 + i] = sqrt(fft[k].r * fft[k].r + fft[k].i * fft[k].i) * scale;
+        }
+        if (out[k1 + i] < c_min_response)
+            out[k1 + i] = c_min_response;
+    }
+}
+
+
 int rp_resp_calc(double *cha_in, double *chb_in, int k1, double scale, int kstp, int II,
                  double **cha_out, double **chb_out)
 {
@@ -92,32 +110,16 @@ int rp_resp_calc(double *cha_in, double *chb_in, int k1, double scale, int kstp,
     double *cha_o = *cha_out;
     double *chb_o = *chb_out;
 
-    int i;
     if(!cha_in || !chb_in ||  !*cha_out ||  !*chb_out )
         return -1;
 
-    if(!rp_kiss_fft_out1 || !rp_kiss_fft_out2 || !rp_kiss_fft_cfg) {
+    if(!rp_fft) {
         fprintf(stderr, "rp_spect_fft not initialized");
         return -1;
     }
 
-    kiss_fftr(rp_kiss_fft_cfg, (kiss_fft_scalar *)cha_in, rp_kiss_fft_out1);
-    kiss_fftr(rp_kiss_fft_cfg, (kiss_fft_scalar *)chb_in, rp_kiss_fft_out2);
-
-    for(i = 0; i < II; i++) {
-
-        cha_o[k1 + i] = sqrt(pow(rp_kiss_fft_out1[(k1 + i) * kstp].r, 2) +
-                pow(rp_kiss_fft_out1[(k1 + i) * kstp].i, 2)) * scale;
-        chb_o[k1 + i] = sqrt(pow(rp_kiss_fft_out2[(k1 + i) * kstp].r, 2) +
-                pow(rp_kiss_fft_out2[(k1 + i) * kstp].i, 2)) * scale;
-
-        /* Saturate to -200 dB */
-        const double c_min_response = 1e-10;
-        if (cha_o[k1 + i] < c_min_response)
-            cha_o[k1 + i] = c_min_response;
-        if (chb_o[k1 + i] < c_min_response)
-            chb_o[k1 + i] = c_min_response;
-    }
+    resp_calc_ch(rp_dsp_fftr(rp_fft, cha_in), k1, scale, kstp, II, cha_o);
+    resp_calc_ch(rp_dsp_fftr(rp_fft, chb_in), k1, scale, kstp, II, chb_o);
 
     return 0;
 }
@@ -125,16 +127,13 @@ int rp_resp_calc(double *cha_in, double *chb_in, int k1, double scale, int kstp,
 
 int rp_spectr_fft_init()
 {
-    if(rp_kiss_fft_out1 || rp_kiss_fft_out2 || rp_kiss_fft_cfg) {
-        rp_spectr_fft_clean();
-    }
-
-    rp_kiss_fft_out1 = 
-        (kiss_fft_cpx *)malloc(SPECTR_FPGA_SIG_LEN * sizeof(kiss_fft_cpx));
-    rp_kiss_fft_out2 =
-        (kiss_fft_cpx *)malloc(SPECTR_FPGA_SIG_LEN * sizeof(kiss_fft_cpx));
+    rp_spectr_fft_clean();
 
-    rp_kiss_fft_cfg = kiss_fftr_alloc(SPECTR_FPGA_SIG_LEN, 0, NULL, NULL);
+    rp_fft = rp_dsp_fftr_alloc(SPECTR_FPGA_SIG_LEN);
+    if(!rp_fft) {
+        fprintf(stderr, "rp_spectr_fft_init() can not allocate mem\n");
+        return -1;
+    }
 
     return 0;
 }
@@ -142,19 +141,8 @@ int rp_spectr_fft_init()
 
 int rp_spectr_fft_clean()
 {
-    kiss_fft_cleanup();
-    if(rp_kiss_fft_out1) {
-        free(rp_kiss_fft_out1);
-        rp_kiss_fft_out1 = NULL;
-    }
-    if(rp_kiss_fft_out2) {
-        free(rp_kiss_fft_out2);
-        rp_kiss_fft_out2 = NULL;
-    }
-    if(rp_kiss_fft_cfg) {
-        free(rp_kiss_fft_cfg);
-        rp_kiss_fft_cfg = NULL;
-    }
+    rp_dsp_fftr_free(rp_fft);
+    rp_fft = NULL;
     return 0;
 }
 
@@ -16,9 +16,17 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
 
 #include "worker.h"
 #include "fpga.h"
+#include "rp_dsp_kernels.h"
+#include "lcr_results.h"
+
+#define LCR_BIN "/opt/redpitaya/www/apps/impedance_analyzer/lcr"
+
+extern char **environ;
 
 pthread_t *rp_osc_thread_handler = NULL;
 void *rp_osc_worker_thread(void *args);
@@ -30,21 +38,24 @@ int                   rp_osc_params_dirty;
 int                   rp_osc_params_fpga_update;
 
 pthread_mutex_t       rp_osc_sig_mutex = PTHREAD_MUTEX_INITIALIZER;
-float               **rp_osc_signals;
-int                   rp_osc_signals_dirty = 0;
-int                   rp_osc_sig_last_idx = 0;
 float               **rp_tmp_signals; /* used for calculation, only from worker */
+rp_signal_ring_t      rp_osc_signal_ring; /* signals published to the web server */
+uint64_t              rp_osc_signals_seen = 0; /* last frame returned by rp_osc_get_signals() */
 
 /* Signals directly pointing at the FPGA mem space */
 int                  *rp_fpga_cha_signal, *rp_fpga_chb_signal;
 
 /* Calibration parameters read from EEPROM */
 rp_calib_params_t *rp_calib_params = NULL;
-int counter = 0;
 int measure_counter = 0;
 int steps_counter = 0;
 int measure_method = 0;
 
+/* Running lcr measurement core and the result table it fills */
+pid_t                 lcr_pid = 0;
+lcr_results_t        *lcr_results = NULL;
+lcr_result_t          lcr_points[LCR_RESULTS_MAX];
+
 /*----------------------------------------------------------------------------------*/
 int rp_osc_worker_init(rp_app_params_t *params, int params_len,
                        rp_calib_params_t *calib_params)
@@ -57,18 +68,18 @@ int rp_osc_worker_init(rp_app_params_t *params, int params_len,
 
     rp_copy_params(params, (rp_app_params_t **)&rp_osc_params);
 
-    rp_cleanup_signals(&rp_osc_signals);
-    if(rp_create_signals(&rp_osc_signals) < 0)
+    if(rp_signal_ring_init(&rp_osc_signal_ring) < 0)
         return -1;
+    rp_osc_signals_seen = 0;
 
     rp_cleanup_signals(&rp_tmp_signals);
     if(rp_create_signals(&rp_tmp_signals) < 0) {
-        rp_cleanup_signals(&rp_osc_signals);
+        rp_signal_ring_release(&rp_osc_signal_ring);
         return -1;
     }
 
     if(osc_fpga_init() < 0) {
-        rp_cleanup_signals(&rp_osc_signals);
+        rp_signal_ring_release(&rp_osc_signal_ring);
         rp_cleanup_signals(&rp_tmp_signals);
         return -1;
     }
@@ -79,7 +90,7 @@ int rp_osc_worker_init(rp_app_params_t *params, int params_len,
 
     rp_osc_thread_handler = (pthread_t *)malloc(sizeof(pthread_t));
     if(rp_osc_thread_handler == NULL) {
-        rp_cleanup_signals(&rp_osc_signals);
+        rp_signal_ring_release(&rp_osc_signal_ring);
         rp_cleanup_signals(&rp_tmp_signals);
         return -1;
     }
@@ -88,7 +99,7 @@ int rp_osc_worker_init(rp_app_params_t *params, int params_len,
     if(ret_val != 0) {
         osc_fpga_exit();
 
-        rp_cleanup_signals(&rp_osc_signals);
+        rp_signal_ring_release(&rp_osc_signal_ring);
         rp_cleanup_signals(&rp_tmp_signals);
         fprintf(stderr, "pthread_create() failed: %s\n", 
                 strerror(errno));
@@ -114,9 +125,17 @@ int rp_osc_worker_exit(void)
         fprintf(stderr, "pthread_join() failed: %s\n", 
                 strerror(errno));
     }
+    /* Let a running sweep finish, it still drives the FPGA */
+    if(lcr_pid > 0) {
+        waitpid(lcr_pid, NULL, 0);
+        lcr_pid = 0;
+    }
+    lcr_results_close(lcr_results);
+    lcr_results = NULL;
+
     osc_fpga_exit();
 
-    rp_cleanup_signals(&rp_osc_signals);
+    rp_signal_ring_release(&rp_osc_signal_ring);
     rp_cleanup_signals(&rp_tmp_signals);
 
     rp_clean_params(rp_osc_params);
@@ -165,8 +184,9 @@ int rp_osc_worker_update_params(rp_app_params_t *params, int fpga_update)
 /*----------------------------------------------------------------------------------*/
 int rp_osc_clean_signals(void)
 {
+    /* Frames published so far count as already returned */
     pthread_mutex_lock(&rp_osc_sig_mutex);
-    rp_osc_signals_dirty = 0;
+    rp_osc_signals_seen = __atomic_load_n(&rp_osc_signal_ring.head, __ATOMIC_ACQUIRE);
     pthread_mutex_unlock(&rp_osc_sig_mutex);
     return 0;
 }
@@ -175,39 +195,84 @@ int rp_osc_clean_signals(void)
 /*----------------------------------------------------------------------------------*/
 int rp_osc_get_signals(float ***signals, int *sig_idx)
 {
-    float **s = *signals;
+    int num, len, ret_val;
+
+    /* Frames only keep whether they are finished, so a not finished one reports index -1 */
     pthread_mutex_lock(&rp_osc_sig_mutex);
-    if(rp_osc_signals_dirty == 0) {
-        *sig_idx = rp_osc_sig_last_idx;
-        pthread_mutex_unlock(&rp_osc_sig_mutex);
+    ret_val = rp_signal_ring_read(&rp_osc_signal_ring, &rp_osc_signals_seen,
+                                  *signals, &num, &len, ((int)rp_get_params_lcr(1)));
+    pthread_mutex_unlock(&rp_osc_sig_mutex);
+
+    if(ret_val == -1) {
+        *sig_idx = -1;
         return -1;
     }
+    *sig_idx = (ret_val == 0) ? len-1 : -1;
+    return 0;
+}
 
-    memcpy(&s[0][0], &rp_osc_signals[0][0], sizeof(float)*((int)rp_get_params_lcr(1)));
-    memcpy(&s[1][0], &rp_osc_signals[1][0], sizeof(float)*((int)rp_get_params_lcr(1)));
-    memcpy(&s[2][0], &rp_osc_signals[2][0], sizeof(float)*((int)rp_get_params_lcr(1)));
 
-    *sig_idx = rp_osc_sig_last_idx;
+/*----------------------------------------------------------------------------------*/
+int rp_osc_set_signals(float **source, int index)
+{
+    /* Complete frames are reported with 0, like rp_get_signals() does */
+    rp_signal_ring_publish(&rp_osc_signal_ring, source, SIGNALS_NUM, ((int)rp_get_params_lcr(1)),
+                           index == ((int)rp_get_params_lcr(1))-1 ? 0 : -2);
 
-    rp_osc_signals_dirty = 0;
-    pthread_mutex_unlock(&rp_osc_sig_mutex);
     return 0;
 }
 
 
 /*----------------------------------------------------------------------------------*/
-int rp_osc_set_signals(float **source, int index)
+rp_signal_ring_t *rp_osc_get_signal_ring(void)
 {
-    pthread_mutex_lock(&rp_osc_sig_mutex);
+    return &rp_osc_signal_ring;
+}
 
-    memcpy(&rp_osc_signals[0][0], &source[0][0], sizeof(float)*((int)rp_get_params_lcr(1)));
-    memcpy(&rp_osc_signals[1][0], &source[1][0], sizeof(float)*((int)rp_get_params_lcr(1)));
-    memcpy(&rp_osc_signals[2][0], &source[2][0], sizeof(float)*((int)rp_get_params_lcr(1)));
-    rp_osc_sig_last_idx = index;
 
-    rp_osc_signals_dirty = 1;
-    pthread_mutex_unlock(&rp_osc_sig_mutex);
+/*----------------------------------------------------------------------------------*/
+int lcr_start_sweep(float amp, float dc_bias, float r_shunt, float avg,
+                    float load_re, float load_im, float steps, int sweep_mode,
+                    float start_freq, float end_freq, float scale)
+{
+    float values[] = { amp, dc_bias, r_shunt, avg, 0, load_re, load_im, steps,
+                       sweep_mode, start_freq, end_freq, scale, 0 };
+    const int values_num = sizeof(values) / sizeof(values[0]);
+    char  args[sizeof(values) / sizeof(values[0])][20];
+    char *argv[sizeof(values) / sizeof(values[0]) + 3];
+    int   i, ret_val;
+
+    argv[0] = LCR_BIN;
+    argv[1] = "1";
+    for(i = 0; i < values_num; i++) {
+        snprintf(args[i], sizeof(args[i]), "%f", values[i]);
+        argv[i + 2] = args[i];
+    }
+    argv[values_num + 2] = NULL;
 
+    ret_val = posix_spawn(&lcr_pid, LCR_BIN, NULL, NULL, argv, environ);
+    if(ret_val != 0) {
+        fprintf(stderr, "posix_spawn(%s) failed: %s\n", LCR_BIN, strerror(ret_val));
+        lcr_pid = 0;
+        return -1;
+    }
+    return 0;
+}
+
+
+/*----------------------------------------------------------------------------------*/
+int lcr_sweep_running(void)
+{
+    pid_t ret_val;
+
+    if(lcr_pid <= 0)
+        return 0;
+
+    ret_val = waitpid(lcr_pid, NULL, WNOHANG);
+    if(ret_val == 0)
+        return 1;
+    /* Exited, or already reaped by the server's SIGCHLD handler */
+    lcr_pid = 0;
     return 0;
 }
 
@@ -321,157 +386,37 @@ void *rp_osc_worker_thread(void *args)
 
         /* Start lcr measurment */
         float measure_option = rp_get_params_lcr(0);
-        /* Set max command lenght */
-        char command[100];
-        /* Frequency sweep */
-        if(measure_option == 1){
-
-
-            float lcr_steps = rp_get_params_lcr(1);
-            float lcr_amp = rp_get_params_lcr(2);
-            float lcr_avg = rp_get_params_lcr(3);
-            float lcr_dc_bias = rp_get_params_lcr(4);
-            float lcr_r_shunt = rp_get_params_lcr(5);
-            float start_freq = rp_get_params_lcr(6);
-            float end_freq = rp_get_params_lcr(7);
-            float lcr_Scale = rp_get_params_lcr(8);
-            float lcr_load_re = rp_get_params_lcr(9);
-            float lcr_load_im = rp_get_params_lcr(10);
-            float lcr_calibration = rp_get_params_lcr(11);
-
-            char steps[10];
-            char sF[20];
-            char eF[20];
-            char amp[20];
-            char avg[20];
-            char dc_bias[20];
-            char r_shunt[20];
-            char scale[20];
-            char re[10];
-            char im[10];
-            char calib[1];
-
-            snprintf(steps, 10, "%f", lcr_steps);
-            printf("STEPS: %s\n", steps);
-            snprintf(sF, 20, "%f", start_freq);
-            snprintf(eF, 20, "%f", end_freq);
-            snprintf(amp, 20, "%f", lcr_amp);
-            snprintf(avg, 20, "%f", lcr_avg);
-            snprintf(dc_bias, 20, "%f", lcr_dc_bias);
-            snprintf(r_shunt, 20, "%f", lcr_r_shunt);
-            snprintf(scale, 20, "%f", lcr_Scale);
-            snprintf(re, 10, "%f", lcr_load_re);
-            snprintf(im, 10, "%f", lcr_load_im);
-            snprintf(calib, 1, "%f", lcr_calibration);
-            
-            strcpy(command, "/opt/redpitaya/www/apps/impedance_analyzer/lcr 1 ");
-            strcat(command, amp);
-            strcat(command, " ");
+        if(lcr_pid > 0) {
+            /* Sweep in progress, its points are plotted below as they arrive */
+            if(!lcr_sweep_running())
+                rp_set_params_lcr(0, 0);
+            else if(lcr_results)
+                rp_set_params_lcr(1, lcr_results->progress);
 
-            strcat(command, dc_bias);
-            strcat(command, " ");
-
-            strcat(command, r_shunt);
-            strcat(command, " ");
-
-            strcat(command, avg);
-
-            strcat(command, " 0 ");
-
-            strcat(command, re);
-            strcat(command, " ");
-            strcat(command, im);
-            strcat(command, " ");
-            strcat(command, steps);
-            strcat(command, " 1 ");
-
-            strcat(command, sF);
-            strcat(command, " ");
-            strcat(command, eF);
-            strcat(command, " ");
-            strcat(command, scale);
-            strcat(command, " 0");
-
-            system(command);
+        /* Frequency sweep */
+        }else if(measure_option == 1){
+
+            if(lcr_start_sweep(rp_get_params_lcr(2), rp_get_params_lcr(4),
+                               rp_get_params_lcr(5), rp_get_params_lcr(3),
+                               rp_get_params_lcr(9), rp_get_params_lcr(10),
+                               rp_get_params_lcr(1), 1,
+                               rp_get_params_lcr(6), rp_get_params_lcr(7),
+                               rp_get_params_lcr(8)) < 0)
+                rp_set_params_lcr(0, 0);
             measure_method = 2;
-            rp_set_params_lcr(0, 0);
-
 
         /* Measurment sweep */
         }else if(measure_option == 2){
 
-            float lcr_counts = rp_get_params_lcr(1);
-            float lcr_amp = rp_get_params_lcr(2);
-            float lcr_avg = rp_get_params_lcr(3);
-            float lcr_dc_bias = rp_get_params_lcr(4);
-            float lcr_r_shunt = rp_get_params_lcr(5);
-            float start_freq = rp_get_params_lcr(6);
-            float end_freq = rp_get_params_lcr(7);
-            float lcr_Scale = rp_get_params_lcr(8);
-            float lcr_load_re = rp_get_params_lcr(9);
-            float lcr_load_im = rp_get_params_lcr(10);
-            float lcr_calibration = rp_get_params_lcr(11);
-
-
-            char ms_counts[20];
-            char sF[20];
-            char eF[20];
-            char amp[20];
-            char avg[20];
-            char dc_bias[20];
-            char r_shunt[20];
-            char scale[20];
-            char re[10];
-            char im[10];
-            char calib[1];
-
-
-            snprintf(ms_counts, 20, "%f", lcr_counts);
-            snprintf(sF, 20, "%f", start_freq);
-            snprintf(eF, 20, "%f", end_freq);
-            snprintf(amp, 20, "%f", lcr_amp);
-            snprintf(avg, 20, "%f", lcr_avg);
-            snprintf(dc_bias, 20, "%f", lcr_dc_bias);
-            snprintf(r_shunt, 20, "%f", lcr_r_shunt);
-            snprintf(scale, 20, "%f", lcr_Scale);
-            snprintf(re, 10, "%f", lcr_load_re);
-            snprintf(im, 10, "%f", lcr_load_im);
-            snprintf(calib, 1, "%f", lcr_calibration);
-
-            char command[100];
-            
-            strcpy(command, "/opt/redpitaya/www/apps/impedance_analyzer/lcr 1 "); 
-            
-            strcat(command, amp);
-            strcat(command, " ");
-
-            strcat(command, dc_bias);
-            strcat(command, " ");
-
-            strcat(command, r_shunt);
-            strcat(command, " ");
-            
-            strcat(command, avg);
-            strcat(command, " 0 ");
-
-            strcat(command, re);
-            strcat(command, " ");
-            strcat(command, im);
-            strcat(command, " ");
-
-            strcat(command, ms_counts);
-            strcat(command, " 0 ");
-
-            strcat(command, sF);
-            strcat(command, " ");
-            strcat(command, " 1000 ");
-            strcat(command, scale);
-            strcat(command, " 0");
-            
-            system(command);
+            if(lcr_start_sweep(rp_get_params_lcr(2), rp_get_params_lcr(4),
+                               rp_get_params_lcr(5), rp_get_params_lcr(3),
+                               rp_get_params_lcr(9), rp_get_params_lcr(10),
+                               rp_get_params_lcr(1), 0,
+                               rp_get_params_lcr(6), 1000,
+                               rp_get_params_lcr(8)) < 0)
+                rp_set_params_lcr(0, 0);
             measure_method = 1; // MS
-            rp_set_params_lcr(0, 0);
-            
+
         }
         
         /* request to stop worker thread, we will shut down */
@@ -480,6 +425,16 @@ void *rp_osc_worker_thread(void *args)
             return 0;
         }
 
+        /* The sweep owns the FPGA until it finishes, only show its points */
+        if(lcr_pid > 0) {
+            if(lcr_start_Measure((float **)&rp_tmp_signals[1], &rp_fpga_cha_signal[0],
+                                 (float **)&rp_tmp_signals[2], &rp_fpga_chb_signal[0],
+                                 (float **)&rp_tmp_signals[0]) == 0 && steps_counter > 0)
+                rp_osc_set_signals(rp_tmp_signals, steps_counter - 1);
+            usleep(10000);
+            continue;
+        }
+
         if(state == rp_osc_auto_set_state) {
             /* Auto-set algorithm was selected - run it */
             rp_osc_auto_set(curr_params, ch1_max_adc_v, ch2_max_adc_v,
@@ -795,7 +750,12 @@ int lcr_start_Measure(float **cha_signal, int *in_cha_signal,
 
     /* rp_tmp_signal[0] for X-coordinate set to frequency */
     float *t = *time_signal;
-    float *frequency = *time_signal;
+
+    int steps = (int)rp_get_params_lcr(1);
+    int len;
+
+    if(steps > LCR_RESULTS_MAX)
+        steps = LCR_RESULTS_MAX;
 
     /* If we are in first boot, start_measure will always be set to -1 
      * rp_get_params_lcr(0):
@@ -805,206 +765,69 @@ int lcr_start_Measure(float **cha_signal, int *in_cha_signal,
      *           2 --> Measurment sweep  */
 
     if(rp_get_params_lcr(0) == -1){
+        steps_counter = 0;
+        return 0;
+    }
 
+    /* The table is created by lcr on its first sweep */
+    if(lcr_results == NULL)
+        lcr_results = lcr_results_open(0);
+    if(lcr_results == NULL) {
+        steps_counter = 0;
+        return 0;
+    }
 
-        for(out_idx=0; out_idx < counter; out_idx++) {
-            cha_s[out_idx] = 0;
-            chb_s[out_idx] = 0;
-            t[out_idx] = out_idx;
-        }
-    }else{
-
-
-        /* Opening files */
-        FILE *file_frequency = fopen("/tmp/lcr_data/data_frequency", "r");
-        FILE *file_phase = fopen("/tmp/lcr_data/data_phase", "r");
-        FILE *file_amplitude = fopen("/tmp/lcr_data/data_amplitude", "r");
-        FILE *file_Y_abs = fopen("/tmp/lcr_data/data_Y_abs", "r");
-        FILE *file_PhaseY = fopen("/tmp/lcr_data/data_phaseY", "r");
-        FILE *file_R_s = fopen("/tmp/lcr_data/data_R_s", "r");
-        FILE *file_X_s = fopen("/tmp/lcr_data/data_X_s", "r");
-        FILE *file_G_p = fopen("/tmp/lcr_data/data_G_p", "r");
-        FILE *file_B_p = fopen("/tmp/lcr_data/data_B_p", "r");
-        FILE *file_C_s = fopen("/tmp/lcr_data/data_C_s", "r");
-        FILE *file_C_p = fopen("/tmp/lcr_data/data_C_p", "r");
-        FILE *file_L_s = fopen("/tmp/lcr_data/data_L_s", "r");
-        FILE *file_L_p = fopen("/tmp/lcr_data/data_L_p", "r");
-        FILE *file_R_p = fopen("/tmp/lcr_data/data_R_p", "r");
-        FILE *file_Q = fopen("/tmp/lcr_data/data_Q", "r");
-        FILE *file_D = fopen("/tmp/lcr_data/data_D", "r");
-        
-
-        while(!feof(file_frequency)){
-            fscanf(file_frequency, "%f", &frequency[counter]);
-            counter++;
-        }
-
-        
-
-        /* Allocationg memory. TODO: Free up memory after use */
-        float *phase = malloc(counter * sizeof(float));
-        float *amplitude = malloc(counter * sizeof(float));
-        float *Y_abs = malloc(counter * sizeof(float));
-        float *R_s = malloc(counter * sizeof(float));
-        float *phaseY = malloc(counter * sizeof(float));
-        float *X_s = malloc(counter * sizeof(float));
-        float *G_p = malloc(counter * sizeof(float));
-        float *B_p = malloc(counter * sizeof(float));
-        float *C_s = malloc(counter * sizeof(float));
-        float *C_p = malloc(counter * sizeof(float));
-        float *L_s = malloc(counter * sizeof(float));
-        float *L_p = malloc(counter * sizeof(float));
-        float *R_p = malloc(counter * sizeof(float));
-        float *Q = malloc(counter * sizeof(float));
-        float *D = malloc(counter * sizeof(float));
-
-        /* Reading data from files into mem-allocated variables */
-        int B_p_counter = 0;
-        while(!feof(file_B_p)){
-            fscanf(file_B_p, "%f", &B_p[B_p_counter]);
-            B_p_counter++;
-        }
-
-        int C_s_counter = 0;
-        while(!feof(file_C_s)){
-            fscanf(file_C_s, "%f", &C_s[C_s_counter]);
-            C_s_counter++;
-        }
-
-        int C_p_counter = 0;
-        while(!feof(file_C_p)){
-            fscanf(file_C_p, "%f", &C_p[C_p_counter]);
-            C_p_counter++;
-        }
-
-        int L_s_counter = 0;
-        while(!feof(file_L_s)){
-            fscanf(file_L_s, "%f", &L_s[L_s_counter]);
-            L_s_counter++;
-        }
+    /* Table was reset by a new sweep while copying, keep the old signals */
+    len = lcr_results_read(lcr_results, lcr_points, steps);
+    if(len < 0)
+        return -1;
 
-        int L_p_counter = 0;
-        while(!feof(file_L_p)){
-            fscanf(file_L_p, "%f", &L_p[L_p_counter]);
-            L_p_counter++;
-        }
+    float scale = rp_get_params_lcr(15);
 
-        int R_p_counter = 0;
-        while(!feof(file_R_p)){
-            fscanf(file_R_p, "%f", &R_p[R_p_counter]);
-            R_p_counter++;
-        }
+    for(out_idx = 0; out_idx < steps; out_idx++) {
+        const lcr_result_t *p;
 
-        int q_counter = 0;
-        while(!feof(file_Q)){
-            fscanf(file_Q, "%f", &Q[q_counter]);
-            q_counter++;
+        if(len == 0) {
+            cha_s[out_idx] = 0;
+            chb_s[out_idx] = 0;
+            t[out_idx] = out_idx;
+            continue;
         }
 
-        int d_counter = 0;
-        while(!feof(file_D)){
-            fscanf(file_D, "%f", &D[d_counter]);
-            d_counter++;
-        }
-        
-        int p_counter = 0;
-        while(!feof(file_phase)){
-            fscanf(file_phase, "%f", &phase[p_counter]);
-            p_counter++;
+        /* Points which are not measured yet repeat the last one */
+        p = &lcr_points[out_idx < len ? out_idx : len - 1];
+
+        switch((int)scale) {
+        case  0: cha_s[out_idx] = p->amplitude; break;
+        case  1: cha_s[out_idx] = p->phase;     break;
+        case  2: cha_s[out_idx] = p->Y_abs;     break;
+        case  3: cha_s[out_idx] = p->phaseY;    break;
+        case  4: cha_s[out_idx] = p->R_s;       break;
+        case  5: cha_s[out_idx] = p->R_p;       break;
+        case  6: cha_s[out_idx] = p->X_s;       break;
+        case  7: cha_s[out_idx] = p->G_p;       break;
+        case  8: cha_s[out_idx] = p->B_p;       break;
+        case  9: cha_s[out_idx] = p->C_s;       break;
+        case 10: cha_s[out_idx] = p->C_p;       break;
+        case 11: cha_s[out_idx] = p->L_s;       break;
+        case 12: cha_s[out_idx] = p->L_p;       break;
+        case 13: cha_s[out_idx] = p->Q;         break;
+        case 14: cha_s[out_idx] = p->D;         break;
         }
 
-        int a_counter = 0;
-        while(!feof(file_amplitude)){
-            fscanf(file_amplitude, "%f", &amplitude[a_counter]);
-            a_counter++;
-        }
-        
-        int y_abs_counter = 0;
-        while(!feof(file_Y_abs)){
-            fscanf(file_Y_abs, "%f", &Y_abs[y_abs_counter]);
-            y_abs_counter++;
-        }
+        chb_s[out_idx] = 0;
 
-        
-        int phaseY_counter = 0;
-        while(!feof(file_PhaseY)){
-            fscanf(file_PhaseY, "%f", &phaseY[phaseY_counter]);
-            phaseY_counter++;
-        }
-        
-        int R_s_counter = 0;
-        while(!feof(file_R_s)){
-            fscanf(file_R_s, "%f", &R_s[R_s_counter]);
-            R_s_counter++;
-        }
-        
-        int X_s_counter = 0;
-        while(!feof(file_X_s)){
-            fscanf(file_X_s, "%f", &X_s[X_s_counter]);
-            X_s_counter++;
-        }
+        /* Measurment sweep */
+        if(measure_method == 1){
+            t[out_idx] = out_idx < len ? out_idx : len - 1;
 
-        int G_p_counter = 0;
-        while(!feof(file_G_p)){
-            fscanf(file_G_p, "%f", &G_p[G_p_counter]);
-            G_p_counter++;
+        /* Frequency sweep */
+        }else if(measure_method == 2){
+            t[out_idx] = p->frequency;
         }
-        
-        /* Closing all the files */
-        fclose(file_frequency);
-        fclose(file_amplitude);
-        fclose(file_phase);
-        fclose(file_Y_abs);
-        fclose(file_PhaseY);
-        fclose(file_R_s);
-        fclose(file_X_s);
-        fclose(file_G_p);
-        fclose(file_B_p);
-        fclose(file_C_s);
-        fclose(file_C_p);
-        fclose(file_L_s);
-        fclose(file_L_p);
-        fclose(file_R_p);
-        fclose(file_Q);
-        fclose(file_D);
-        
-        for(out_idx=0; out_idx < counter; out_idx++) {
-
-            /* Data check: TODO add switch statment for a niftier code */
-
-            float scale = rp_get_params_lcr(15);
-            if      (scale ==  0) cha_s[out_idx] = amplitude[out_idx];
-            else if (scale ==  1) cha_s[out_idx] = phase[out_idx]; 
-            else if (scale ==  2) cha_s[out_idx] = Y_abs[out_idx];
-            else if (scale ==  3) cha_s[out_idx] = phaseY[out_idx];
-            else if (scale ==  4) cha_s[out_idx] = R_s[out_idx];
-            else if (scale ==  5) cha_s[out_idx] = R_p[out_idx];
-            else if (scale ==  6) cha_s[out_idx] = X_s[out_idx];
-            else if (scale ==  7) cha_s[out_idx] = G_p[out_idx];
-            else if (scale ==  8) cha_s[out_idx] = B_p[out_idx];
-            else if (scale ==  9) cha_s[out_idx] = C_s[out_idx];
-            else if (scale == 10) cha_s[out_idx] = C_p[out_idx];
-            else if (scale == 11) cha_s[out_idx] = L_s[out_idx];
-            else if (scale == 12) cha_s[out_idx] = L_p[out_idx];
-            else if (scale == 13) cha_s[out_idx] = Q[out_idx];
-            else if (scale == 14) cha_s[out_idx] = D[out_idx];
-   
-            chb_s[out_idx] = 0;
-
-            /* Measurment sweep */
-            if(measure_method == 1){
-                t[out_idx] = out_idx;
-        
-            /* Frequency sweep */
-            }else if(measure_method == 2){
-                t[out_idx] = frequency[out_idx];
-            }
-        }     
-        
     }
-    
-    steps_counter = out_idx;
-    counter = 0;
+
+    steps_counter = len;
 
     return 0;
 }
@@ -1122,7 +945,8 @@ int rp_osc_auto_set(rp_app_params_t *orig_params,
      * 1 - Channel B 
      */
     int channel; 
-    int i, smpl_cnt;
+    int i;
+    int32_t smpl_min, smpl_max;
     int iter;
 
     for (iter=0; iter < 10; iter++) {
@@ -1159,26 +983,20 @@ int rp_osc_auto_set(rp_app_params_t *orig_params,
             usleep(500);
         }
 
-        /* Get the signals - available at rp_fpga_chX_signal vectors */
-        for(smpl_cnt = 0; smpl_cnt < OSC_FPGA_SIG_LEN; smpl_cnt++) {
-            int cha_smpl = rp_fpga_cha_signal[smpl_cnt];
-            int chb_smpl = rp_fpga_chb_signal[smpl_cnt];
-
-            // TWO'S COMPLEMENT
-            if(cha_smpl & (1<<(c_osc_fpga_adc_bits-1)))
-                cha_smpl = -1 * ((cha_smpl ^ ((1<<c_osc_fpga_adc_bits)-1))+1);
-            if(chb_smpl & (1<<(c_osc_fpga_adc_bits-1)))
-                chb_smpl = -1 * ((chb_smpl ^ ((1<<c_osc_fpga_adc_bits)-1))+1);
-
-            cha_smpl=cha_smpl+rp_calib_params->fe_ch1_dc_offs;
-            chb_smpl=chb_smpl+rp_calib_params->fe_ch2_dc_offs;
-
-            /* Get min/maxes */
-            max_cha = (max_cha < cha_smpl) ? cha_smpl : max_cha;
-            min_cha = (min_cha > cha_smpl) ? cha_smpl : min_cha;
-            max_chb = (max_chb < chb_smpl) ? chb_smpl : max_chb;
-            min_chb = (min_chb > chb_smpl) ? chb_smpl : min_chb;
-        }
+        /* Get min/maxes of the signals - available at rp_fpga_chX_signal vectors */
+        rp_dsp_envelope(rp_fpga_cha_signal, OSC_FPGA_SIG_LEN, 0, OSC_FPGA_SIG_LEN,
+                        c_osc_fpga_adc_bits, &smpl_min, &smpl_max, NULL, 1);
+        smpl_min += rp_calib_params->fe_ch1_dc_offs;
+        smpl_max += rp_calib_params->fe_ch1_dc_offs;
+        max_cha = (max_cha < smpl_max) ? smpl_max : max_cha;
+        min_cha = (min_cha > smpl_min) ? smpl_min : min_cha;
+
+        rp_dsp_envelope(rp_fpga_chb_signal, OSC_FPGA_SIG_LEN, 0, OSC_FPGA_SIG_LEN,
+                        c_osc_fpga_adc_bits, &smpl_min, &smpl_max, NULL, 1);
+        smpl_min += rp_calib_params->fe_ch2_dc_offs;
+        smpl_max += rp_calib_params->fe_ch2_dc_offs;
+        max_chb = (max_chb < smpl_max) ? smpl_max : max_chb;
+        min_chb = (min_chb > smpl_min) ? smpl_min : min_chb;
     }
     /* Check the Y axis amplitude on both channels and select the channel with 
      * the larger one.
@@ -12,6 +12,7 @@
 
 #include "main.h"
 #include "calib.h"
+#include "rp_signal_ring.h"
 
 typedef enum rp_osc_worker_state_e {
     rp_osc_idle_state = 0, /* do nothing */
@@ -42,6 +43,8 @@ int rp_osc_get_signals(float ***signals, int *sig_idx);
  * and marks it dirty 
  */
 int rp_osc_set_signals(float **source, int index);
+/* Ring every new set of signals is published to */
+rp_signal_ring_t *rp_osc_get_signal_ring(void);
 
 /* Prepares time vector (only where there is a need for it) */
 int rp_osc_prepare_time_vector(float **out_signal, int dec_factor,
@@ -60,6 +63,13 @@ int lcr_start_Measure(float **cha_signal, int *in_cha_signal,
                     float **chb_signal, int *in_chb_signal,
                     float **time_signal);
 
+/* Runs lcr in the background, it publishes the points into the shared
+ * result table which lcr_start_Measure() reads */
+int lcr_start_sweep(float amp, float dc_bias, float r_shunt, float avg,
+                    float load_re, float load_im, float steps, int sweep_mode,
+                    float start_freq, float end_freq, float scale);
+int lcr_sweep_running(void);
+
 int rp_osc_decimate_partial(float **cha_out_signal, int *cha_in_signal, 
                             float **chb_out_signal, int *chb_in_signal,
                             float **time_out_signal, int *next_wr_ptr, 
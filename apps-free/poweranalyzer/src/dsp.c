@@ -24,7 +24,7 @@
 #include "main.h"
 #include "fpga.h"
 #include "dsp.h"
-#include "kiss_fftr.h"
+#include "rp_dsp_kernels.h"
 
 extern float g_pwr_fpga_adc_max_v;
 extern const int c_pwr_fpga_adc_bits;
@@ -35,20 +35,15 @@ const int pwr_dft_harmonic_num = 100;
 
 /* Internal structures used in DSP  */
 double            *rp_hann_window  = NULL;
-kiss_fft_cpx      *rp_kiss_fft_out = NULL;
-kiss_fftr_cfg      rp_kiss_fft_cfg = NULL;
+rp_dsp_fftr_t     *rp_fft          = NULL;
 double            *rp_dft_out_re_U = NULL;
 double            *rp_dft_out_im_U = NULL;
 double            *rp_dft_out_re_I = NULL;
 double            *rp_dft_out_im_I = NULL; 
 
-const double PI2 = 2 * M_PI;
-
 
 int rp_pwr_hann_init(int length)
 {
-    int i;
-
     rp_pwr_hann_clean();
 
     rp_hann_window = (double *)malloc(length * sizeof(double));
@@ -57,12 +52,7 @@ int rp_pwr_hann_init(int length)
         return -1;
     }
     
-    for(i = 0; i < length; i++) {
-        rp_hann_window[i] = RP_PWR_HANN_AMP * 
-            (1 - cos(PI2 * i / (double)(length-1)));
-    }
-
-    return 0;
+    return rp_dsp_hann(RP_PWR_HANN_AMP, rp_hann_window, length);
 }
 
 int rp_pwr_hann_clean()
@@ -77,43 +67,40 @@ int rp_pwr_hann_clean()
 
 int rp_pwr_hann_filter(double *ch_in, double *ch_out, int length)
 {
-    int i;
-    
-    if(!ch_in || !ch_out)
+    if(!ch_in || !ch_out || !rp_hann_window)
         return -1;
-    for(i = 0; i < length; i++) {
-        ch_out[i] = ch_in[i] * rp_hann_window[i];
-    }
 
+    rp_dsp_apply_window(ch_in, rp_hann_window, ch_out, length);
     return 0;
 }
 
+static inline double bin_amp(const kiss_fft_cpx *bin)
+{
+    return sqrt(bin->r * bin->r + bin->i * bin->i);
+}
+
 int rp_pwr_fft_init(int length)
 {
-    if(rp_kiss_fft_out || rp_kiss_fft_cfg) {
-        rp_pwr_fft_clean();
+    /* Length follows the signal period, keep the plan while it does not change */
+    if(rp_fft && rp_dsp_fftr_len(rp_fft) == (uint32_t)length) {
+        return 0;
     }
 
-    rp_kiss_fft_out = 
-        (kiss_fft_cpx *)malloc(length * sizeof(kiss_fft_cpx));
-    
-    rp_kiss_fft_cfg = kiss_fftr_alloc(length, 0, NULL, NULL);
+    rp_pwr_fft_clean();
+
+    rp_fft = rp_dsp_fftr_alloc(length);
+    if(!rp_fft) {
+        fprintf(stderr, "rp_pwr_fft_init() can not allocate FFT of length %d\n", length);
+        return -1;
+    }
 
     return 0;
 }
 
 int rp_pwr_fft_clean()
 {
-    kiss_fft_cleanup();
-    if(rp_kiss_fft_out) {
-        free(rp_kiss_fft_out);
-        rp_kiss_fft_out = NULL;
-    }
-
-    if(rp_kiss_fft_cfg) {
-        free(rp_kiss_fft_cfg);
-        rp_kiss_fft_cfg = NULL;
-    }
+    rp_dsp_fftr_free(rp_fft);
+    rp_fft = NULL;
     return 0;
 }
 
@@ -122,27 +109,25 @@ int rp_pwr_fft(double *ch_in, double *max_amp_bin_1,
                double *arg_max_bin, int *max_bin_num, int half_length)
 {
     int i;
-    double bin_amp = 0;
+    double amp = 0;
     double bin_max_amp = 0;
     int bin_num = 0;
+    const kiss_fft_cpx *out;
     
     if(!ch_in)
         return -1;
 
-    if(!rp_kiss_fft_out || !rp_kiss_fft_cfg) {
+    if(!rp_fft) {
         fprintf(stderr, "rp_pwr_fft not initialized");
         return -1;
     }
 
-    kiss_fftr(rp_kiss_fft_cfg, (kiss_fft_scalar *)ch_in, rp_kiss_fft_out);
+    out = rp_dsp_fftr(rp_fft, ch_in);
 
     for(i = 0; i < half_length; i++) {                     // FFT limited to fs/2, specter of amplitudes        
-      
-        bin_amp = sqrt(pow(rp_kiss_fft_out[i].r, 2) + 
-                        pow(rp_kiss_fft_out[i].i, 2));
-                        
-        if(bin_amp > bin_max_amp){
-            bin_max_amp = bin_amp;
+        amp = bin_amp(&out[i]);
+        if(amp > bin_max_amp){
+            bin_max_amp = amp;
             bin_num = i;
         }        
     }
@@ -156,23 +141,16 @@ int rp_pwr_fft(double *ch_in, double *max_amp_bin_1,
     
     } else if(bin_num == 1) {
      *max_amp_bin_1 = bin_max_amp;
-     *max_amp_bin_2 = sqrt(pow(rp_kiss_fft_out[bin_num + 1].r, 2) + 
-                          pow(rp_kiss_fft_out[bin_num + 1].i, 2));
+     *max_amp_bin_2 = bin_amp(&out[bin_num + 1]);
      *max_amp_bin_3 = 0;
      *max_bin_num = bin_num;
-     *arg_max_bin = atan2(rp_kiss_fft_out[bin_num].i, rp_kiss_fft_out[bin_num].r);
+     *arg_max_bin = atan2(out[bin_num].i, out[bin_num].r);
      
     } else {
-     *max_amp_bin_1 = sqrt(pow(rp_kiss_fft_out[bin_num - 1].r, 2) + 
-                         pow(rp_kiss_fft_out[bin_num - 1].i, 2));
-                       
-     *max_amp_bin_2 = bin_max_amp;                   
-                        
-     *max_amp_bin_3 = sqrt(pow(rp_kiss_fft_out[bin_num + 1].r, 2) + 
-                          pow(rp_kiss_fft_out[bin_num + 1].i, 2));
-                        
-     *arg_max_bin = atan2(rp_kiss_fft_out[bin_num].i, rp_kiss_fft_out[bin_num].r);
-    
+     *max_amp_bin_1 = bin_amp(&out[bin_num - 1]);
+     *max_amp_bin_2 = bin_max_amp;
+     *max_amp_bin_3 = bin_amp(&out[bin_num + 1]);
+     *arg_max_bin = atan2(out[bin_num].i, out[bin_num].r);
      *max_bin_num = bin_num; 
     }
       
@@ -222,14 +200,7 @@ int rp_pwr_dft(double *cha_in, double *chb_in, int length, float rel_freq,
                double *amp_U, double *amp_I, double *fi_U, double *fi_I)
 {
     int k;
-    int n;
-    double K;
-    double angle = 0;
-    double sum_re_U = 0;
-    double sum_im_U = 0;
-    double sum_re_I = 0;
-    double sum_im_I = 0; 
-         
+
     if(!cha_in || !chb_in ||  !*amp_U ||  !*amp_I || !*fi_U || !*fi_I)
          return -1;
 
@@ -238,40 +209,21 @@ int rp_pwr_dft(double *cha_in, double *chb_in, int length, float rel_freq,
          return -1;
     }
 
+    /* Goertzel per harmonic, the harmonics are not on FFT bins */
     for(k = 0; k < pwr_dft_harmonic_num; k++ ) {
-     
-        sum_re_U = 0;
-        sum_im_U = 0;
-        sum_re_I = 0;
-        sum_im_I = 0; 
-         
-         K = (k + 1) * PI2 * rel_freq / length;	
-
-         for(n = 0; n < length; n++) { 
-             
-             angle = n * K;
-             
-             sum_re_U += cha_in[n] * cos(angle);
-             sum_im_U += -cha_in[n] * sin(angle);
-             sum_re_I += chb_in[n] * cos(angle);
-             sum_im_I += -chb_in[n] * sin(angle);
-         }
-
-         rp_dft_out_re_U[k] = sum_re_U;
-         rp_dft_out_im_U[k] = sum_im_U;
-         rp_dft_out_re_I[k] = sum_re_I;
-         rp_dft_out_im_I[k] = sum_im_I;
-
-         amp_U[k] = sqrt(pow(rp_dft_out_re_U[k], 2) + 
-                         pow(rp_dft_out_im_U[k], 2)) *
+
+         rp_dsp_goertzel(cha_in, length, (k + 1) * rel_freq, &rp_dft_out_re_U[k], &rp_dft_out_im_U[k]);
+         rp_dsp_goertzel(chb_in, length, (k + 1) * rel_freq, &rp_dft_out_re_I[k], &rp_dft_out_im_I[k]);
+
+         amp_U[k] = sqrt(rp_dft_out_re_U[k] * rp_dft_out_re_U[k] +
+                         rp_dft_out_im_U[k] * rp_dft_out_im_U[k]) *
                     2 / length;
-         amp_I[k] = sqrt(pow(rp_dft_out_re_I[k], 2) + 
-                         pow(rp_dft_out_im_I[k], 2)) *
+         amp_I[k] = sqrt(rp_dft_out_re_I[k] * rp_dft_out_re_I[k] +
+                         rp_dft_out_im_I[k] * rp_dft_out_im_I[k]) *
                     2 / length;
          fi_U[k] = atan2(rp_dft_out_im_U[k], rp_dft_out_re_U[k]);
          fi_I[k] = atan2(rp_dft_out_im_I[k], rp_dft_out_re_I[k]);
-
-        }
+    }
      
      return 0;
 }     
@@ -26,6 +26,7 @@
 
 #include "worker.h"
 #include "fpga.h"
+#include "rp_dsp_kernels.h"
 
 pthread_t *rp_osc_thread_handler = NULL;
 void *rp_osc_worker_thread(void *args);
@@ -37,10 +38,9 @@ int                   rp_osc_params_dirty;
 int                   rp_osc_params_fpga_update;
 
 pthread_mutex_t       rp_osc_sig_mutex = PTHREAD_MUTEX_INITIALIZER;
-float               **rp_osc_signals;
-int                   rp_osc_signals_dirty = 0;
-int                   rp_osc_sig_last_idx = 0;
 float               **rp_tmp_signals; /* used for calculation, only from worker */
+rp_signal_ring_t      rp_osc_signal_ring; /* signals published to the web server */
+uint64_t              rp_osc_signals_seen = 0; /* last frame returned by rp_osc_get_signals() */
 
 /* Signals directly pointing at the FPGA mem space */
 int                  *rp_fpga_cha_signal, *rp_fpga_chb_signal;
@@ -61,18 +61,18 @@ int rp_osc_worker_init(rp_app_params_t *params, int params_len,
 
     rp_copy_params(params, (rp_app_params_t **)&rp_osc_params);
 
-    rp_cleanup_signals(&rp_osc_signals);
-    if(rp_create_signals(&rp_osc_signals) < 0)
+    if(rp_signal_ring_init(&rp_osc_signal_ring) < 0)
         return -1;
+    rp_osc_signals_seen = 0;
 
     rp_cleanup_signals(&rp_tmp_signals);
     if(rp_create_signals(&rp_tmp_signals) < 0) {
-        rp_cleanup_signals(&rp_osc_signals);
+        rp_signal_ring_release(&rp_osc_signal_ring);
         return -1;
     }
 
     if(osc_fpga_init() < 0) {
-        rp_cleanup_signals(&rp_osc_signals);
+        rp_signal_ring_release(&rp_osc_signal_ring);
         rp_cleanup_signals(&rp_tmp_signals);
         return -1;
     }
@@ -83,7 +83,7 @@ int rp_osc_worker_init(rp_app_params_t *params, int params_len,
 
     rp_osc_thread_handler = (pthread_t *)malloc(sizeof(pthread_t));
     if(rp_osc_thread_handler == NULL) {
-        rp_cleanup_signals(&rp_osc_signals);
+        rp_signal_ring_release(&rp_osc_signal_ring);
         rp_cleanup_signals(&rp_tmp_signals);
         return -1;
     }
@@ -92,7 +92,7 @@ int rp_osc_worker_init(rp_app_params_t *params, int params_len,
     if(ret_val != 0) {
         osc_fpga_exit();
 
-        rp_cleanup_signals(&rp_osc_signals);
+        rp_signal_ring_release(&rp_osc_signal_ring);
         rp_cleanup_signals(&rp_tmp_signals);
         fprintf(stderr, "pthread_create() failed: %s\n", 
                 strerror(errno));
@@ -120,7 +120,7 @@ int rp_osc_worker_exit(void)
     }
     osc_fpga_exit();
 
-    rp_cleanup_signals(&rp_osc_signals);
+    rp_signal_ring_release(&rp_osc_signal_ring);
     rp_cleanup_signals(&rp_tmp_signals);
 
     rp_clean_params(rp_osc_params);
@@ -169,8 +169,9 @@ int rp_osc_worker_update_params(rp_app_params_t *params, int fpga_update)
 /*----------------------------------------------------------------------------------*/
 int rp_osc_clean_signals(void)
 {
+    /* Frames published so far count as already returned */
     pthread_mutex_lock(&rp_osc_sig_mutex);
-    rp_osc_signals_dirty = 0;
+    rp_osc_signals_seen = __atomic_load_n(&rp_osc_signal_ring.head, __ATOMIC_ACQUIRE);
     pthread_mutex_unlock(&rp_osc_sig_mutex);
     return 0;
 }
@@ -179,25 +180,19 @@ int rp_osc_clean_signals(void)
 /*----------------------------------------------------------------------------------*/
 int rp_osc_get_signals(float ***signals, int *sig_idx)
 {
-    float **s = *signals;
+    int num, len, ret_val;
+
+    /* Frames only keep whether they are finished, so a not finished one reports index -1 */
     pthread_mutex_lock(&rp_osc_sig_mutex);
-    if(rp_osc_signals_dirty == 0) {
-        *sig_idx = rp_osc_sig_last_idx;
-        pthread_mutex_unlock(&rp_osc_sig_mutex);
+    ret_val = rp_signal_ring_read(&rp_osc_signal_ring, &rp_osc_signals_seen,
+                                  *signals, &num, &len, SIGNAL_LENGTH);
+    pthread_mutex_unlock(&rp_osc_sig_mutex);
+
+    if(ret_val == -1) {
+        *sig_idx = -1;
         return -1;
     }
-
-    memcpy(&s[0][0], &rp_osc_signals[0][0], sizeof(float)*SIGNAL_LENGTH);
-    memcpy(&s[1][0], &rp_osc_signals[1][0], sizeof(float)*SIGNAL_LENGTH);
-    //memcpy(&s[2][0], &rp_osc_signals[2][0], sizeof(float)*SIGNAL_LENGTH);
-    memcpy(&s[2][0], &IST_PWR_out[0], sizeof(float)*SIGNAL_LENGTH);
-				
-	ISTcnt = 0;	//reset the ist buffer counter
-
-    *sig_idx = rp_osc_sig_last_idx;
-
-    rp_osc_signals_dirty = 0;
-    pthread_mutex_unlock(&rp_osc_sig_mutex);
+    *sig_idx = (ret_val == 0) ? len-1 : -1;
     return 0;
 }
 
@@ -205,21 +200,24 @@ int rp_osc_get_signals(float ***signals, int *sig_idx)
 /*----------------------------------------------------------------------------------*/
 int rp_osc_set_signals(float **source, int index)
 {
-    pthread_mutex_lock(&rp_osc_sig_mutex);
+    /* Third signal is the IST power, its buffer restarts with every published frame */
+    float *signals[SIGNALS_NUM] = { source[0], source[1], IST_PWR_out };
 
-    memcpy(&rp_osc_signals[0][0], &source[0][0], sizeof(float)*SIGNAL_LENGTH);
-    memcpy(&rp_osc_signals[1][0], &source[1][0], sizeof(float)*SIGNAL_LENGTH);
-    //memcpy(&rp_osc_signals[2][0], &source[2][0], sizeof(float)*SIGNAL_LENGTH);
-    //memcpy(&IST_PWR_out[0], &source[2][0], sizeof(float)*SIGNAL_LENGTH);
-    rp_osc_sig_last_idx = index;
-
-    rp_osc_signals_dirty = 1;
-    pthread_mutex_unlock(&rp_osc_sig_mutex);
+    rp_signal_ring_publish(&rp_osc_signal_ring, signals, SIGNALS_NUM, SIGNAL_LENGTH,
+                           index == SIGNAL_LENGTH-1 ? 0 : -2);
+    ISTcnt = 0;
 
     return 0;
 }
 
 
+/*----------------------------------------------------------------------------------*/
+rp_signal_ring_t *rp_osc_get_signal_ring(void)
+{
+    return &rp_osc_signal_ring;
+}
+
+
 /*----------------------------------------------------------------------------------*/
 int rp_osc_set_meas_data(rp_osc_meas_res_t ch1_meas, rp_osc_meas_res_t ch2_meas)
 {
@@ -833,7 +831,7 @@ int rp_osc_auto_set(rp_app_params_t *orig_params,
      * 1 - Channel B 
      */
     int channel; 
-    int smpl_cnt;
+    int32_t smpl_min, smpl_max;
     int iter;
     int time_range = 0;
 
@@ -871,26 +869,20 @@ int rp_osc_auto_set(rp_app_params_t *orig_params,
             usleep(500);
         }
 
-        /* Get the signals - available at rp_fpga_chX_signal vectors */
-        for(smpl_cnt = 0; smpl_cnt < OSC_FPGA_SIG_LEN; smpl_cnt++) {
-            int cha_smpl = rp_fpga_cha_signal[smpl_cnt];
-            int chb_smpl = rp_fpga_chb_signal[smpl_cnt];
-
-            // TWO'S COMPLEMENT
-            if(cha_smpl & (1<<(c_osc_fpga_adc_bits-1)))
-                cha_smpl = -1 * ((cha_smpl ^ ((1<<c_osc_fpga_adc_bits)-1))+1);
-            if(chb_smpl & (1<<(c_osc_fpga_adc_bits-1)))
-                chb_smpl = -1 * ((chb_smpl ^ ((1<<c_osc_fpga_adc_bits)-1))+1);
-
-            cha_smpl = cha_smpl + rp_calib_params->fe_ch1_dc_offs;
-            chb_smpl = chb_smpl + rp_calib_params->fe_ch2_dc_offs;
-
-            /* Get min/maxes */
-            max_cha = (max_cha < cha_smpl) ? cha_smpl : max_cha;
-            min_cha = (min_cha > cha_smpl) ? cha_smpl : min_cha;
-            max_chb = (max_chb < chb_smpl) ? chb_smpl : max_chb;
-            min_chb = (min_chb > chb_smpl) ? chb_smpl : min_chb;
-        }
+        /* Get min/maxes of the signals - available at rp_fpga_chX_signal vectors */
+        rp_dsp_envelope(rp_fpga_cha_signal, OSC_FPGA_SIG_LEN, 0, OSC_FPGA_SIG_LEN,
+                        c_osc_fpga_adc_bits, &smpl_min, &smpl_max, NULL, 1);
+        smpl_min += rp_calib_params->fe_ch1_dc_offs;
+        smpl_max += rp_calib_params->fe_ch1_dc_offs;
+        max_cha = (max_cha < smpl_max) ? smpl_max : max_cha;
+        min_cha = (min_cha > smpl_min) ? smpl_min : min_cha;
+
+        rp_dsp_envelope(rp_fpga_chb_signal, OSC_FPGA_SIG_LEN, 0, OSC_FPGA_SIG_LEN,
+                        c_osc_fpga_adc_bits, &smpl_min, &smpl_max, NULL, 1);
+        smpl_min += rp_calib_params->fe_ch2_dc_offs;
+        smpl_max += rp_calib_params->fe_ch2_dc_offs;
+        max_chb = (max_chb < smpl_max) ? smpl_max : max_chb;
+        min_chb = (min_chb > smpl_min) ? smpl_min : min_chb;
 
         dy[0] = max_cha - min_cha;
         dy[1] = max_chb - min_chb;
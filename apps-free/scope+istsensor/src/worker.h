@@ -20,6 +20,7 @@
 
 #include "main.h"
 #include "calib.h"
+#include "rp_signal_ring.h"
 #include "pid.h"
 #include "ISTctrl.h"
 
@@ -52,6 +53,8 @@ int rp_osc_get_signals(float ***signals, int *sig_idx);
  * and marks it dirty 
  */
 int rp_osc_set_signals(float **source, int index);
+/* Ring every new set of signals is published to */
+rp_signal_ring_t *rp_osc_get_signal_ring(void);
 /* Fills the output measuremenet data with last measurements
  */
 int rp_osc_set_meas_data(rp_osc_meas_res_t ch1_meas, rp_osc_meas_res_t ch2_meas);
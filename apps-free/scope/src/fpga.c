@@ -575,7 +575,6 @@ float osc_fpga_cnv_cnt_to_v(int cnts, float adc_max_v,
                             int calib_dc_off, float user_dc_off)
 {
     int m;
-    float ret_val;
 
     /* check sign */
     if(cnts & (1<<(c_osc_fpga_adc_bits-1))) {
@@ -586,6 +585,28 @@ float osc_fpga_cnv_cnt_to_v(int cnts, float adc_max_v,
         m = cnts;
     }
 
+    return osc_fpga_cnv_signed_cnt_to_v(m, adc_max_v, calib_dc_off, user_dc_off);
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Converts sign extended ADC counts to voltage [V]
+ *
+ * Same as osc_fpga_cnv_cnt_to_v() for counts which were already sign extended,
+ * e.g. min/max values of a decimated signal.
+ *
+ * @param[in] m              Captured Signal Value, expressed in signed ADC counts
+ * @param[in] adc_max_v      Maximal ADC voltage, specified in [V]
+ * @param[in] calib_dc_off   Calibrated DC offset, specified in ADC counts
+ * @param[in] user_dc_off    User specified DC offset, specified in [V]
+ * @retval    float          Signal Value, expressed in user units [V]
+ */
+float osc_fpga_cnv_signed_cnt_to_v(int m, float adc_max_v,
+                                   int calib_dc_off, float user_dc_off)
+{
+    float ret_val;
+
     /* adopt ADC count with calibrated DC offset */
     m += calib_dc_off;
 
@@ -24,7 +24,7 @@
 #include "main.h"
 #include "fpga.h"
 #include "dsp.h"
-#include "kiss_fftr.h"
+#include "rp_dsp_kernels.h"
 
 extern float g_spectr_fpga_adc_max_v;
 extern const int c_spectr_fpga_adc_bits;
@@ -34,9 +34,7 @@ const int c_dsp_sig_len = SPECTR_FPGA_SIG_LEN>>1;
 
 /* Internal structures used in DSP  */
 double                *rp_hann_window   = NULL;
-kiss_fft_cpx         *rp_kiss_fft_out1 = NULL;
-kiss_fft_cpx         *rp_kiss_fft_out2 = NULL;
-kiss_fftr_cfg         rp_kiss_fft_cfg  = NULL;
+rp_dsp_fftr_t         *rp_fft           = NULL;
 
 /* constants - calibration dependant */
 /* Power calc. impedance*/
@@ -87,8 +85,6 @@ int rp_spectr_prepare_freq_vector(float **freq_out, double f_s, float freq_range
 
 int rp_spectr_hann_init()
 {
-    int i;
-
     rp_spectr_hann_clean(rp_hann_window);
 
     rp_hann_window = (double *)malloc(SPECTR_FPGA_SIG_LEN * sizeof(double));
@@ -97,12 +93,7 @@ int rp_spectr_hann_init()
         return -1;
     }
     
-    for(i = 0; i < SPECTR_FPGA_SIG_LEN; i++) {
-        rp_hann_window[i] = RP_SPECTR_HANN_AMP * 
-            (1 - cos(2*M_PI*i / (double)(SPECTR_FPGA_SIG_LEN-1)));
-    }
-
-    return 0;
+    return rp_dsp_hann(RP_SPECTR_HANN_AMP, rp_hann_window, SPECTR_FPGA_SIG_LEN);
 }
 
 int rp_spectr_hann_clean()
@@ -118,77 +109,51 @@ int rp_spectr_hann_clean()
 int rp_spectr_hann_filter(double *cha_in, double *chb_in,
                           double **cha_out, double **chb_out)
 {
-    int i;
-    double *cha_o = *cha_out;
-    double *chb_o = *chb_out;
-
-    if(!cha_in || !chb_in || !*cha_out || !*chb_out)
+    if(!cha_in || !chb_in || !*cha_out || !*chb_out || !rp_hann_window)
         return -1;
-    for(i = 0; i < SPECTR_FPGA_SIG_LEN; i++) {
-        cha_o[i] = cha_in[i] * rp_hann_window[i];
-        chb_o[i] = chb_in[i] * rp_hann_window[i];
-    }
+
+    rp_dsp_apply_window(cha_in, rp_hann_window, *cha_out, SPECTR_FPGA_SIG_LEN);
+    rp_dsp_apply_window(chb_in, rp_hann_window, *chb_out, SPECTR_FPGA_SIG_LEN);
 
     return 0;
 }
 
 int rp_spectr_fft_init()
 {
-    if(rp_kiss_fft_out1 || rp_kiss_fft_out2 || rp_kiss_fft_cfg) {
-        rp_spectr_fft_clean();
-    }
+    rp_spectr_fft_clean();
 
-    rp_kiss_fft_out1 = 
-        (kiss_fft_cpx *)malloc(SPECTR_FPGA_SIG_LEN * sizeof(kiss_fft_cpx));
-    rp_kiss_fft_out2 =
-        (kiss_fft_cpx *)malloc(SPECTR_FPGA_SIG_LEN * sizeof(kiss_fft_cpx));
-
-    rp_kiss_fft_cfg = kiss_fftr_alloc(SPECTR_FPGA_SIG_LEN, 0, NULL, NULL);
+    rp_fft = rp_dsp_fftr_alloc(SPECTR_FPGA_SIG_LEN);
+    if(!rp_fft) {
+        fprintf(stderr, "rp_spectr_fft_init() can not allocate mem\n");
+        return -1;
+    }
 
     return 0;
 }
 
 int rp_spectr_fft_clean()
 {
-    kiss_fft_cleanup();
-    if(rp_kiss_fft_out1) {
-        free(rp_kiss_fft_out1);
-        rp_kiss_fft_out1 = NULL;
-    }
-    if(rp_kiss_fft_out2) {
-        free(rp_kiss_fft_out2);
-        rp_kiss_fft_out2 = NULL;
-    }
-    if(rp_kiss_fft_cfg) {
-        free(rp_kiss_fft_cfg);
-        rp_kiss_fft_cfg = NULL;
-    }
+    rp_dsp_fftr_free(rp_fft);
+    rp_fft = NULL;
     return 0;
 }
 
 int rp_spectr_fft(double *cha_in, double *chb_in, 
                   double **cha_out, double **chb_out)
 {
-    double *cha_o = *cha_out;
-    double *chb_o = *chb_out;
-    int i;
     if(!cha_in || !chb_in || !*cha_out || !*chb_out)
         return -1;
 
-    if(!rp_kiss_fft_out1 || !rp_kiss_fft_out2 || !rp_kiss_fft_cfg) {
+    if(!rp_fft) {
         fprintf(stderr, "rp_spect_fft not initialized");
         return -1;
     }
 
-    kiss_fftr(rp_kiss_fft_cfg, (kiss_fft_scalar *)cha_in, rp_kiss_fft_out1);
-    kiss_fftr(rp_kiss_fft_cfg, (kiss_fft_scalar *)chb_in, rp_kiss_fft_out2);
+    // FFT limited to fs/2, specter of amplitudes
+    if(rp_dsp_fftr_mag(rp_fft, cha_in, *cha_out, c_dsp_sig_len) ||
+       rp_dsp_fftr_mag(rp_fft, chb_in, *chb_out, c_dsp_sig_len))
+        return -1;
 
-    for(i = 0; i < c_dsp_sig_len; i++) {                     // FFT limited to fs/2, specter of amplitudes
-        cha_o[i] = sqrt(pow(rp_kiss_fft_out1[i].r, 2) + 
-                        pow(rp_kiss_fft_out1[i].i, 2));
-        chb_o[i] = sqrt(pow(rp_kiss_fft_out2[i].r, 2) + 
-                        pow(rp_kiss_fft_out2[i].i, 2));
-    }
     return 0;
 }
 
@@ -196,44 +161,21 @@ int rp_spectr_decimate(double *cha_in, double *chb_in,
                        float **cha_out, float **chb_out,
                        int in_len, int out_len)
 {
-    int step;
-    int i, j;
-    float *cha_o = *cha_out;
-    float *chb_o = *chb_out;
-
     if(!cha_in || !chb_in || !*cha_out || !*chb_out)
         return -1;
 
-    step = (int)round((float)in_len / (float)out_len);
-    if(step < 1)
-        step = 1;
+    /* Conversion factor from ADC counts to Volts */
+    double c2v = g_spectr_fpga_adc_max_v/(float)((int)(1<<(c_spectr_fpga_adc_bits-1)));
 
-    for(i = 0, j = 0; i < out_len; i++, j+=step) {
-        int k=j;
+    /* Conversion to power (Watts), c_imp = 50 Ohms is the transmission line impedance,
+     * x 2 for unilateral spectral density representation. Powers of all FFT bins
+     * folded into one output sample are summed. */
+    double scale = c2v * c2v / c_imp /
+        (double)SPECTR_FPGA_SIG_LEN / (double)SPECTR_FPGA_SIG_LEN * 2;
 
-        if(j >= in_len) {
-            fprintf(stderr, "rp_spectr_decimate() index too high\n");
-            return -1;
-        }
-        cha_o[i] = 0;
-        chb_o[i] = 0;
-	
-	/* Conversion factor from ADC counts to Volts */
-    	double c2v = g_spectr_fpga_adc_max_v/(float)((int)(1<<(c_spectr_fpga_adc_bits-1)));
-	
-        for(k=j; k < j+step; k++) {
-	
-	/* Conversion to power (Watts) */  
-        double cha_p = pow(cha_in[k] * c2v, 2) / c_imp /
-            (double)SPECTR_FPGA_SIG_LEN / (double)SPECTR_FPGA_SIG_LEN * 2; // x 2 for unilateral spectral density representation
-        double chb_p = pow(chb_in[k] * c2v, 2) / c_imp /                   // c_imp = 50 Ohms, is the transmission line impdeance   
-            (double)SPECTR_FPGA_SIG_LEN / (double)SPECTR_FPGA_SIG_LEN * 2;
-	  
-	  
-            cha_o[i] += (float)cha_p;  // Summing the power expressed in Watts associated to each FFT bin
-            chb_o[i] += (float)chb_p;
-        }
-    }
+    if(rp_dsp_decimate_power(cha_in, in_len, *cha_out, out_len, scale) ||
+       rp_dsp_decimate_power(chb_in, in_len, *chb_out, out_len, scale))
+        return -1;
 
     return 0;
 }
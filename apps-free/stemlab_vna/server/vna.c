@@ -5,18 +5,32 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <math.h>
+#include <time.h>
+#include <poll.h>
 #include <pthread.h>
 #include <sys/mman.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
+/* Points per send() and FIFO words read per burst */
+#define BATCH_POINTS 512
+#define BURST_WORDS 4096
+
+/* Limits of one wait for the FIFO when no interrupt is available */
+#define WAIT_MIN_NS 20000
+#define WAIT_MAX_NS 1000000
+
 volatile uint16_t *rx_cntr;
 volatile float *rx_data;
 
 int sock_thread = -1;
 uint32_t rate_thread = 5;
 uint32_t size_thread = 6000;
+uint32_t frame_thread = 0;
+
+/* UIO device signalling the result FIFO level, -1 when not available */
+int uio_fd = -1;
 
 void *read_handler(void *arg);
 
@@ -31,11 +45,20 @@ int main(int argc, char *argv[])
   volatile int16_t *tx_level[2];
   volatile uint8_t *rst, *gpio;
   struct sockaddr_in addr;
-  uint32_t command, freq, rate, size, i;
+  uint32_t command, freq, rate, size, frame, i;
   int32_t value, corr;
   int64_t start, stop;
   int yes = 1;
 
+  /* optional UIO device with the FIFO level interrupt, e.g. /dev/uio0 */
+  if(argc > 1)
+  {
+    if((uio_fd = open(argv[1], O_RDWR)) < 0)
+    {
+      perror("open uio");
+    }
+  }
+
   if((fd = open("/dev/mem", O_RDWR)) < 0)
   {
     perror("open");
@@ -68,6 +91,7 @@ int main(int argc, char *argv[])
   size = 6000;
   rate = 5;
   corr = 0;
+  frame = 0;
 
   *rst &= ~3;
   *rst |= 4;
@@ -174,6 +198,7 @@ int main(int argc, char *argv[])
           *rst |= 2;
           rate_thread = rate;
           size_thread = size;
+          frame_thread = frame;
           sock_thread = sock_client;
           if(pthread_create(&thread, &attr, read_handler, NULL) < 0)
           {
@@ -195,6 +220,11 @@ int main(int argc, char *argv[])
           *rst |= 4;
           sock_thread = -1;
           break;
+        case 12:
+          /* set framing, 1 - every send starts with the payload length */
+          if(value < 0 || value > 1) continue;
+          frame = value;
+          break;
       }
     }
 
@@ -210,55 +240,136 @@ int main(int argc, char *argv[])
   return EXIT_SUCCESS;
 }
 
+static int64_t time_ns()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/* Waits until the FIFO should hold wanted more words, entry_ns is the measured time per 4 words */
+static void wait_fifo(uint32_t wanted, int64_t entry_ns)
+{
+  struct timespec t;
+  struct pollfd pfd;
+  uint32_t value;
+  int64_t ns;
+
+  if(uio_fd >= 0)
+  {
+    /* unmask the interrupt and wait for it, the timeout catches cancel requests */
+    value = 1;
+    if(write(uio_fd, &value, 4) == 4)
+    {
+      pfd.fd = uio_fd;
+      pfd.events = POLLIN;
+      if(poll(&pfd, 1, 10) > 0 && read(uio_fd, &value, 4) == 4) return;
+    }
+  }
+
+  ns = entry_ns > 0 ? entry_ns * ((wanted + 3) / 4) : WAIT_MIN_NS;
+  if(ns < WAIT_MIN_NS) ns = WAIT_MIN_NS;
+  if(ns > WAIT_MAX_NS) ns = WAIT_MAX_NS;
+  t.tv_sec = 0;
+  t.tv_nsec = ns;
+  clock_nanosleep(CLOCK_MONOTONIC, 0, &t, NULL);
+}
+
+static int send_points(uint32_t *frame, uint32_t points, uint32_t framed)
+{
+  uint32_t size = points * 16;
+
+  if(points == 0) return 0;
+
+  /* frame[0] is the length prefix, the points follow it */
+  frame[0] = size;
+  if(framed) size += 4;
+  return send(sock_thread, framed ? (void *)frame : (void *)(frame + 1), size, MSG_NOSIGNAL) < 0 ? -1 : 0;
+}
+
 void *read_handler(void *arg)
 {
-  uint32_t i, j, cntr;
+  uint32_t i, j, k, n, words, points, cntr, total, wanted;
   uint32_t rate = rate_thread;
   uint32_t size = size_thread;
-  float buffer[4];
+  uint32_t framed = frame_thread;
+  int64_t first, entry_ns;
+  float sum[4];
+  float burst[BURST_WORDS];
+  uint32_t frame[1 + BATCH_POINTS * 4];
+  float *out = (float *)(frame + 1);
 
   i = 0;
   cntr = 0;
-  while(cntr < size * (rate + 5))
+  points = 0;
+  first = 0;
+  entry_ns = 0;
+  total = size * (rate + 5);
+  memset(sum, 0, sizeof(sum));
+
+  while(cntr < total)
   {
     if(sock_thread < 0) break;
 
-    if(*rx_cntr < 4)
+    words = *rx_cntr & ~3;
+    if(words == 0)
     {
-      usleep(1000);
+      /* no data, flush what is ready and sleep until the rest of the batch should be there */
+      if(send_points(frame, points, framed) < 0) break;
+      points = 0;
+      wanted = (BATCH_POINTS - (cntr / (rate + 5)) % BATCH_POINTS) * (rate + 5);
+      if(wanted > total - cntr) wanted = total - cntr;
+      wait_fifo(wanted * 4, entry_ns);
       continue;
     }
 
-    if(i < 5)
+    /* measure the FIFO fill rate from the first data of the sweep */
+    if(first == 0) first = time_ns();
+    else if(cntr > 0) entry_ns = (time_ns() - first) / cntr;
+
+    if(words > BURST_WORDS) words = BURST_WORDS;
+    if(words / 4 > total - cntr) words = (total - cntr) * 4;
+    for(k = 0; k < words; k += 4)
     {
-      for(j = 0; j < 4; ++j)
-      {
-        buffer[j] = *rx_data;
-      }
-      memset(buffer, 0, 16);
+      burst[k + 0] = *rx_data;
+      burst[k + 1] = *rx_data;
+      burst[k + 2] = *rx_data;
+      burst[k + 3] = *rx_data;
     }
-    else
+
+    for(n = 0; n < words; n += 4)
     {
-      for(j = 0; j < 4; ++j)
+      /* the first 5 entries of every point are dropped, the next rate entries are averaged */
+      if(i >= 5)
       {
-        buffer[j] += *rx_data;
+        for(j = 0; j < 4; ++j)
+        {
+          sum[j] += burst[n + j];
+        }
       }
-    }
 
-    ++i;
-    ++cntr;
+      ++i;
+      ++cntr;
 
-    if(i < rate + 5) continue;
+      if(i < rate + 5) continue;
 
-    i = 0;
+      i = 0;
 
-    for(j = 0; j < 4; ++j)
-    {
-      buffer[j] /= rate;
-    }
+      for(j = 0; j < 4; ++j)
+      {
+        out[points * 4 + j] = sum[j] / rate;
+        sum[j] = 0.0f;
+      }
+
+      if(++points < BATCH_POINTS) continue;
 
-    if(send(sock_thread, buffer, 16, MSG_NOSIGNAL) < 0) break;
+      if(send_points(frame, points, framed) < 0) break;
+      points = 0;
+    }
+    if(n < words) break;
   }
 
+  if(sock_thread >= 0) send_points(frame, points, framed);
+
   return NULL;
 }
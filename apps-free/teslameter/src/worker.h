@@ -17,6 +17,7 @@
 
 #include "main.h"
 #include "calib.h"
+#include "rp_signal_ring.h"
 
 typedef enum rp_osc_worker_state_e {
     rp_osc_idle_state = 0, /* do nothing */
@@ -47,6 +48,8 @@ int rp_osc_get_signals(float ***signals, int *sig_idx);
  * and marks it dirty 
  */
 int rp_osc_set_signals(float **source, int index);
+/* Ring every new set of signals is published to */
+rp_signal_ring_t *rp_osc_get_signal_ring(void);
 /* Fills the output measuremenet data with last measurements
  */
 int rp_osc_set_meas_data(rp_osc_meas_res_t ch1_meas, rp_osc_meas_res_t ch2_meas, int tesla_fd);
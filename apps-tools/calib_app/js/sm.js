@@ -25,6 +25,11 @@
     SM.param_callbacks = {};
     SM.parameterStack = [];
     SM.signalStack = [];
+    // Last quantized values of delta encoded signals and sequence of the last binary frame
+    SM.binarySignals = {
+        q: {},
+        sequence: -1
+    };
     // Parameters cache
     SM.parametersCache = {};
 
@@ -128,6 +133,10 @@
                 console.log('Socket opened');
 
                 SM.state.socket_opened = true;
+                SM.binarySignals.q = {};
+                SM.binarySignals.sequence = -1;
+                // Signals come as binary frames, parameters stay gzipped JSON
+                SM.ws.send(JSON.stringify({ binary_signals: true }));
                 SM.sendParameters();
                 SM.unexpectedClose = true;
                 $('body').addClass('loaded');
@@ -150,6 +159,15 @@
 
             SM.ws.onmessage = function(ev) {
                 try {
+                    var signals = SM.decodeBinarySignals(ev.data);
+                    if (signals !== null) {
+                        if (signals.wave !== undefined && signals.wave.size > 0) {
+                            SM.signalStack.push(signals);
+                            signalsHandler();
+                        }
+                        return;
+                    }
+
                     var data = new Uint8Array(ev.data);
                     //   BA.compressed_data += data.length;
                     var inflate = pako.inflate(data);
@@ -183,6 +201,76 @@
         }
     };
 
+    // Decodes a binary signal frame ("RPSB", see rp_sdk/DataManager.h) into the
+    // same { name: { size, value } } form as JSON signals. Returns null for other frames.
+    SM.decodeBinarySignals = function(buffer) {
+        if (buffer.byteLength < 12)
+            return null;
+        var view = new DataView(buffer);
+        if (view.getUint32(0, true) != 0x42535052)
+            return null;
+        if (view.getUint16(4, true) != 1) {
+            console.log('Unsupported binary signal frame version');
+            return {};
+        }
+
+        var count = view.getUint16(6, true);
+        var sequence = view.getUint32(8, true);
+        // Deltas after a lost frame can not be applied, the server is asked for a keyframe
+        if (SM.binarySignals.sequence >= 0 && sequence != ((SM.binarySignals.sequence + 1) >>> 0))
+            SM.binarySignals.q = {};
+        SM.binarySignals.sequence = sequence;
+        var needKeyframe = false;
+
+        var signals = {};
+        var pos = 12;
+        for (var i = 0; i < count; i++) {
+            var nameLen = view.getUint8(pos);
+            var type = view.getUint8(pos + 1);
+            var samples = view.getUint32(pos + 4, true);
+            var scale = view.getFloat32(pos + 8, true);
+            var offset = view.getFloat32(pos + 12, true);
+            pos += 16;
+            var name = String.fromCharCode.apply(null, new Uint8Array(buffer, pos, nameLen));
+            pos += (nameLen + 3) & ~3;
+
+            var value = new Array(samples);
+            if (type == 0) {
+                var f = new Float32Array(buffer.slice(pos, pos + samples * 4));
+                for (var j = 0; j < samples; j++)
+                    value[j] = f[j];
+                pos += samples * 4;
+                delete SM.binarySignals.q[name];
+            } else if (type == 1) {
+                var q = new Int16Array(buffer.slice(pos, pos + samples * 2));
+                for (var j = 0; j < samples; j++)
+                    value[j] = offset + q[j] * scale;
+                pos += (samples * 2 + 3) & ~3;
+                SM.binarySignals.q[name] = q;
+            } else if (type == 2) {
+                var prev = SM.binarySignals.q[name];
+                var d = new Int8Array(buffer, pos, samples);
+                pos += (samples + 3) & ~3;
+                if (prev === undefined || prev.length != samples) {
+                    needKeyframe = true;
+                    continue;
+                }
+                for (var j = 0; j < samples; j++) {
+                    prev[j] += d[j];
+                    value[j] = offset + prev[j] * scale;
+                }
+            } else {
+                console.log('Unknown binary signal type ' + type);
+                return signals;
+            }
+            signals[name] = { size: samples, value: value };
+        }
+
+        if (needKeyframe && SM.state.socket_opened)
+            SM.ws.send(JSON.stringify({ binary_signals: true }));
+        return signals;
+    };
+
     // For Firefox
     function fireEvent(obj, evt) {
         var fireOnThis = obj;
@@ -48,6 +48,10 @@ auto ClientNetConfigManager::removeHadlers() -> void{
     serverDacStoppedSDEmptyNofiy.disconnect_all();
     serverDacStoppedSDBrokenNofiy.disconnect_all();
     serverDacStoppedSDMissingNofiy.disconnect_all();
+    serverDacStatsNofiy.disconnect_all();
+    serverAdcStatsNofiy.disconnect_all();
+    serverAdcSpectrumNofiy.disconnect_all();
+    serverLocalRingFailNofiy.disconnect_all();
 
     serverLoopbackStartedNofiy.disconnect_all();
     serverLoopbackStoppedNofiy.disconnect_all();
@@ -318,6 +322,10 @@ auto ClientNetConfigManager::receiveCommand(uint32_t command,std::weak_ptr<Clien
     if (c == CNetConfigManager::ECommands::CONFIG_FILE_MISSED){
         configFileMissedNotify(sender->m_manager->getHost());
     }
+
+    if (c == CNetConfigManager::ECommands::SERVER_LOCAL_RING_FAIL){
+        serverLocalRingFailNofiy(sender->m_manager->getHost());
+    }
 }
 
 auto ClientNetConfigManager::isServersConnected() -> bool{
@@ -339,6 +347,9 @@ auto ClientNetConfigManager::receiveValueStr(std::string key,std::string value,s
         if (!sender->m_client_settings.setValue(key,value)){
             errorNofiy(Errors::CANNT_SET_DATA_TO_CONFIG,sender->m_manager->getHost(),std::error_code());
         }
+    }else if (key.rfind(ADC_STATS_PREFIX,0) == 0){
+        auto host = sender->m_manager->getHost();
+        serverAdcSpectrumNofiy(host,key,value);
     }
 }
 
@@ -349,6 +360,9 @@ auto ClientNetConfigManager::receiveValueInt(std::string key,uint32_t value,std:
         if (!sender->m_client_settings.setValue(key,(int64_t)value)){
             errorNofiy(Errors::CANNT_SET_DATA_TO_CONFIG,sender->m_manager->getHost(),std::error_code());
         }
+    }else if (key == DAC_STATS_UNDERRUNS || key == DAC_STATS_LATE_BUFFERS){
+        auto host = sender->m_manager->getHost();
+        serverDacStatsNofiy(host,key,value);
     }
 }
 
@@ -359,6 +373,9 @@ auto ClientNetConfigManager::receiveValueDouble(std::string key,double value,std
         if (!sender->m_client_settings.setValue(key,value)){
             errorNofiy(Errors::CANNT_SET_DATA_TO_CONFIG,sender->m_manager->getHost(),std::error_code());
         }
+    }else if (key.rfind(ADC_STATS_PREFIX,0) == 0){
+        auto host = sender->m_manager->getHost();
+        serverAdcStatsNofiy(host,key,value);
     }
 }
 
@@ -442,6 +459,25 @@ auto ClientNetConfigManager::sendConfig(std::shared_ptr<Clients> _client, bool _
         if (!_client->m_manager->sendData("loopback_mode",static_cast<uint32_t>(getLoopbackMode()),_async)) return false;
         if (!_client->m_manager->sendData("loopback_channels",static_cast<uint32_t>(getLoopbackChannels()),_async)) return false;
 
+        // Older servers do not know the event, statistics and local ring keys, they are only sent when used
+        if (isEventMode()){
+            if (!_client->m_manager->sendData("event_ch1_type",static_cast<uint32_t>(getEventType(CStreamSettings::CH1)),_async)) return false;
+            if (!_client->m_manager->sendData("event_ch1_level",static_cast<uint32_t>(getEventLevel(CStreamSettings::CH1)),_async)) return false;
+            if (!_client->m_manager->sendData("event_ch1_level2",static_cast<uint32_t>(getEventLevel2(CStreamSettings::CH1)),_async)) return false;
+            if (!_client->m_manager->sendData("event_ch2_type",static_cast<uint32_t>(getEventType(CStreamSettings::CH2)),_async)) return false;
+            if (!_client->m_manager->sendData("event_ch2_level",static_cast<uint32_t>(getEventLevel(CStreamSettings::CH2)),_async)) return false;
+            if (!_client->m_manager->sendData("event_ch2_level2",static_cast<uint32_t>(getEventLevel2(CStreamSettings::CH2)),_async)) return false;
+            if (!_client->m_manager->sendData("event_pre",static_cast<uint32_t>(getEventPreSamples()),_async)) return false;
+            if (!_client->m_manager->sendData("event_post",static_cast<uint32_t>(getEventPostSamples()),_async)) return false;
+            if (!_client->m_manager->sendData("event_holdoff",static_cast<uint32_t>(getEventHoldoffSamples()),_async)) return false;
+        }
+        if (getStatsRate()){
+            if (!_client->m_manager->sendData("stats_rate",static_cast<uint32_t>(getStatsRate()),_async)) return false;
+        }
+        if (getLocalSlots()){
+            if (!_client->m_manager->sendData("local_slots",static_cast<uint32_t>(getLocalSlots()),_async)) return false;
+        }
+
         if (!_client->m_manager->sendData(CNetConfigManager::ECommands::END_SEND_SETTING,_async)) return false;
         return true;
     }
@@ -479,6 +515,24 @@ auto ClientNetConfigManager::sendTestConfig(std::shared_ptr<Clients> _client, bo
         if (!_client->m_manager->sendData("loopback_mode",static_cast<uint32_t>(settings.getLoopbackMode()),_async)) return false;
         if (!_client->m_manager->sendData("loopback_channels",static_cast<uint32_t>(settings.getLoopbackChannels()),_async)) return false;
 
+        if (settings.isEventMode()){
+            if (!_client->m_manager->sendData("event_ch1_type",static_cast<uint32_t>(settings.getEventType(CStreamSettings::CH1)),_async)) return false;
+            if (!_client->m_manager->sendData("event_ch1_level",static_cast<uint32_t>(settings.getEventLevel(CStreamSettings::CH1)),_async)) return false;
+            if (!_client->m_manager->sendData("event_ch1_level2",static_cast<uint32_t>(settings.getEventLevel2(CStreamSettings::CH1)),_async)) return false;
+            if (!_client->m_manager->sendData("event_ch2_type",static_cast<uint32_t>(settings.getEventType(CStreamSettings::CH2)),_async)) return false;
+            if (!_client->m_manager->sendData("event_ch2_level",static_cast<uint32_t>(settings.getEventLevel(CStreamSettings::CH2)),_async)) return false;
+            if (!_client->m_manager->sendData("event_ch2_level2",static_cast<uint32_t>(settings.getEventLevel2(CStreamSettings::CH2)),_async)) return false;
+            if (!_client->m_manager->sendData("event_pre",static_cast<uint32_t>(settings.getEventPreSamples()),_async)) return false;
+            if (!_client->m_manager->sendData("event_post",static_cast<uint32_t>(settings.getEventPostSamples()),_async)) return false;
+            if (!_client->m_manager->sendData("event_holdoff",static_cast<uint32_t>(settings.getEventHoldoffSamples()),_async)) return false;
+        }
+        if (settings.getStatsRate()){
+            if (!_client->m_manager->sendData("stats_rate",static_cast<uint32_t>(settings.getStatsRate()),_async)) return false;
+        }
+        if (settings.getLocalSlots()){
+            if (!_client->m_manager->sendData("local_slots",static_cast<uint32_t>(settings.getLocalSlots()),_async)) return false;
+        }
+
         if (!_client->m_manager->sendData(CNetConfigManager::ECommands::END_SEND_TEST_SETTING,_async)) return false;
         return true;
     }
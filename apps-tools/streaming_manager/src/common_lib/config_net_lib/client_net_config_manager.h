@@ -89,6 +89,11 @@ public:
     sigslot::signal<std::string&> serverDacStoppedSDEmptyNofiy;
     sigslot::signal<std::string&> serverDacStoppedSDBrokenNofiy;
     sigslot::signal<std::string&> serverDacStoppedSDMissingNofiy;
+    // host, DAC_STATS_UNDERRUNS or DAC_STATS_LATE_BUFFERS, value
+    sigslot::signal<std::string&,std::string&,uint32_t> serverDacStatsNofiy;
+    // host, key with ADC_STATS_PREFIX, value. The spectrum is a comma separated list of dBFS values
+    sigslot::signal<std::string&,std::string&,double> serverAdcStatsNofiy;
+    sigslot::signal<std::string&,std::string&,std::string&> serverAdcSpectrumNofiy;
 
     sigslot::signal<std::string&> serverLoopbackStartedNofiy;
     sigslot::signal<std::string&> serverLoopbackStoppedNofiy;
@@ -103,6 +108,7 @@ public:
     sigslot::signal<std::string&> startDACDoneNofiy;
 
     sigslot::signal<std::string&> configFileMissedNotify;
+    sigslot::signal<std::string&> serverLocalRingFailNofiy;
 
 
     sigslot::signal<ClientNetConfigManager::Errors,std::string,error_code> errorNofiy;
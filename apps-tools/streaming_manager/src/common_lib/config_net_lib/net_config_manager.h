@@ -7,6 +7,13 @@
 #include "data_lib/signal.hpp"
 #include "data_lib/thread_cout.h"
 
+// Keys of the DAC playback counters sent by the server while streaming
+#define DAC_STATS_UNDERRUNS    "dac_underruns"
+#define DAC_STATS_LATE_BUFFERS "dac_late_buffers"
+// Prefix of the ADC signal statistics sent by the server while streaming,
+// the keys are adc_stats_ch<N>_<min|max|mean|rms|clipped|samples|step|spectrum>
+#define ADC_STATS_PREFIX       "adc_stats_"
+
 class CNetConfigManager
 {
 public:
@@ -76,7 +83,8 @@ public:
         GET_SERVER_MODE                     =   51,
         GET_SERVER_TEST_MODE                =   52,
 
-        CONFIG_FILE_MISSED                  =   53
+        CONFIG_FILE_MISSED                  =   53,
+        SERVER_LOCAL_RING_FAIL              =   54         // Streaming runs without the shared memory ring
     };
 
     using Ptr = std::shared_ptr<CNetConfigManager>;
@@ -360,6 +360,40 @@ auto ServerNetConfigManager::sendStreamServerBusy() -> bool{
     return m_pNetConfManager->sendData(CNetConfigManager::ECommands::SERVER_LOOPBACK_BUSY);
 }
 
+auto ServerNetConfigManager::sendLocalRingFail() -> bool{
+    return m_pNetConfManager->sendData(CNetConfigManager::ECommands::SERVER_LOCAL_RING_FAIL);
+}
+
+auto ServerNetConfigManager::sendDACStats(uint32_t underruns,uint32_t lateBuffers) -> bool{
+    bool ret = m_pNetConfManager->sendData(DAC_STATS_UNDERRUNS,underruns);
+    ret = ret && m_pNetConfManager->sendData(DAC_STATS_LATE_BUFFERS,lateBuffers);
+    return ret;
+}
+
+auto ServerNetConfigManager::sendADCStats(uint32_t channel,double min,double max,double mean,double rms,uint64_t clipped,uint64_t samples) -> bool{
+    auto prefix = std::string(ADC_STATS_PREFIX) + "ch" + std::to_string(channel) + "_";
+    bool ret = m_pNetConfManager->sendData(prefix + "min",min);
+    ret = ret && m_pNetConfManager->sendData(prefix + "max",max);
+    ret = ret && m_pNetConfManager->sendData(prefix + "mean",mean);
+    ret = ret && m_pNetConfManager->sendData(prefix + "rms",rms);
+    ret = ret && m_pNetConfManager->sendData(prefix + "clipped",(double)clipped);
+    ret = ret && m_pNetConfManager->sendData(prefix + "samples",(double)samples);
+    return ret;
+}
+
+auto ServerNetConfigManager::sendADCSpectrum(uint32_t channel,double stepHz,const std::vector<float> &spectrum) -> bool{
+    auto prefix = std::string(ADC_STATS_PREFIX) + "ch" + std::to_string(channel) + "_";
+    std::string value;
+    char buff[16];
+    for(size_t i = 0; i < spectrum.size(); i++){
+        snprintf(buff,sizeof(buff),i ? ",%.1f" : "%.1f",spectrum[i]);
+        value += buff;
+    }
+    bool ret = m_pNetConfManager->sendData(prefix + "step",stepHz);
+    ret = ret && m_pNetConfManager->sendData(prefix + "spectrum",value);
+    return ret;
+}
+
 auto ServerNetConfigManager::sendConfig(bool sendTest,bool _async) -> bool{
     if (m_pNetConfManager->isConnected()) {
         CStreamSettings s = sendTest ? m_testSettings : m_settings;
@@ -393,6 +427,25 @@ auto ServerNetConfigManager::sendConfig(bool sendTest,bool _async) -> bool{
         if (!m_pNetConfManager->sendData("loopback_mode",static_cast<uint32_t>(s.getLoopbackMode()),_async)) return false;
         if (!m_pNetConfManager->sendData("loopback_channels",static_cast<uint32_t>(s.getLoopbackChannels()),_async)) return false;
 
+        // Older clients do not know the event, statistics and local ring keys, they are only sent when used
+        if (s.isEventMode()){
+            if (!m_pNetConfManager->sendData("event_ch1_type",static_cast<uint32_t>(s.getEventType(CStreamSettings::CH1)),_async)) return false;
+            if (!m_pNetConfManager->sendData("event_ch1_level",static_cast<uint32_t>(s.getEventLevel(CStreamSettings::CH1)),_async)) return false;
+            if (!m_pNetConfManager->sendData("event_ch1_level2",static_cast<uint32_t>(s.getEventLevel2(CStreamSettings::CH1)),_async)) return false;
+            if (!m_pNetConfManager->sendData("event_ch2_type",static_cast<uint32_t>(s.getEventType(CStreamSettings::CH2)),_async)) return false;
+            if (!m_pNetConfManager->sendData("event_ch2_level",static_cast<uint32_t>(s.getEventLevel(CStreamSettings::CH2)),_async)) return false;
+            if (!m_pNetConfManager->sendData("event_ch2_level2",static_cast<uint32_t>(s.getEventLevel2(CStreamSettings::CH2)),_async)) return false;
+            if (!m_pNetConfManager->sendData("event_pre",static_cast<uint32_t>(s.getEventPreSamples()),_async)) return false;
+            if (!m_pNetConfManager->sendData("event_post",static_cast<uint32_t>(s.getEventPostSamples()),_async)) return false;
+            if (!m_pNetConfManager->sendData("event_holdoff",static_cast<uint32_t>(s.getEventHoldoffSamples()),_async)) return false;
+        }
+        if (s.getStatsRate()){
+            if (!m_pNetConfManager->sendData("stats_rate",static_cast<uint32_t>(s.getStatsRate()),_async)) return false;
+        }
+        if (s.getLocalSlots()){
+            if (!m_pNetConfManager->sendData("local_slots",static_cast<uint32_t>(s.getLocalSlots()),_async)) return false;
+        }
+
         if (!m_pNetConfManager->sendData(sendTest ? CNetConfigManager::ECommands::END_SEND_TEST_SETTING : CNetConfigManager::ECommands::END_SEND_SETTING,_async)) return false;
         return true;
     }
@@ -1,6 +1,8 @@
 #ifndef CONFIG_NET_LIB_SNCM_H
 #define CONFIG_NET_LIB_SNCM_H
 
+#include <vector>
+
 #include "settings_lib/stream_settings.h"
 #include "broadcast_lib/asio_broadcast_socket.h"
 #include "net_config_manager.h"
@@ -55,6 +57,11 @@ public:
     auto sendServerStartedLoopBackMode() -> bool;
     auto sendServerStoppedLoopBackMode() -> bool;
     auto sendStreamServerBusy() -> bool;
+    auto sendLocalRingFail() -> bool;
+    auto sendDACStats(uint32_t underruns,uint32_t lateBuffers) -> bool;
+    // Channel numbers start with 1, values are volts and the spectrum is in dBFS
+    auto sendADCStats(uint32_t channel,double min,double max,double mean,double rms,uint64_t clipped,uint64_t samples) -> bool;
+    auto sendADCSpectrum(uint32_t channel,double stepHz,const std::vector<float> &spectrum) -> bool;
     
     auto getSettingsRef() -> CStreamSettings&;
     auto getSettings() -> const CStreamSettings;
@@ -1,12 +1,26 @@
+#include <algorithm>
 #include "dac_net_controller.h"
 #include "data_lib/thread_cout.h"
 #include "data_lib/neon_asm.h"
 
 #define UNUSED(x) [&x]{}()
 constexpr char DAC_ID_PACK[] = "#DAC_STREAM_PACK";
+constexpr char DAC_ID_CREDIT[] = "#DAC_CREDIT_PACK";
+constexpr char DAC_ID_SEGMENT[] = "#DAC_SEGMNT_PACK";
+constexpr char DAC_ID_SEQUENCE[] = "#DAC_SEQNCE_PACK";
+constexpr char DAC_ID_TRIGGER[] = "#DAC_TRIGGR_PACK";
 
 #define  SOCKET_BUFFER_SIZE 65536
 #define  FIFO_BUFFER_SIZE  SOCKET_BUFFER_SIZE * 3
+#define  PACK_HEADER_SIZE  28   // ID, index and pack size
+#define  CREDIT_PACK_SIZE  40
+#define  CREDIT_HISTORY    1024 // send times kept for the latency measurement
+#define  CREDIT_HELLO_TIMEOUT_MS 500
+#define  SEGMENT_PREFIX_SIZE 52  // header, channel sizes, offset and total size
+#define  SEGMENT_CHUNK_SIZE  32768 // bytes per channel in one segment pack
+#define  SEQUENCE_PREFIX_SIZE 32 // header and step count
+#define  SEQUENCE_STEP_SIZE  20
+#define  SEQUENCE_FLAG_START 0x1
 
 using namespace dac_streaming_lib;
 
@@ -20,12 +34,25 @@ CDACAsioNetController::CDACAsioNetController():
     m_pos_last_in_fifo(0),
     m_stopFlag(false),
     m_bufferdeq(),
-    m_recieve_mutex()
+    m_pool(nullptr),
+    m_poolRelease(),
+    m_sequencer(nullptr),
+    m_recieve_mutex(),
+    m_creditsEnabled(false),
+    m_connected(false),
+    m_lastAck(0),
+    m_sendLimit(0),
+    m_helloTime(),
+    m_sendTime(CREDIT_HISTORY),
+    m_flow(),
+    m_credit_mutex(),
+    m_creditCond()
 {
     m_tcp_fifo_buffer = new uint8_t[FIFO_BUFFER_SIZE];
 }
 
 CDACAsioNetController::~CDACAsioNetController() {
+    m_poolRelease.disconnect();
     stopAsioNet();
     delete [] m_tcp_fifo_buffer;
     for (auto obj:m_bufferdeq) {
@@ -40,60 +67,97 @@ bool CDACAsioNetController::startAsioNet(net_lib::EMode _mode, std::string _host
     m_mode = _mode;
     m_host = _host;
     m_port = _port;
-    m_index = 0;
+    {
+        const std::lock_guard<std::mutex> lock(m_credit_mutex);
+        m_index = 0;
+        m_flow = FlowStats();
+    }
     m_stopFlag = false;
     if (m_host == ""  || m_port == "")
         return false;
     return start();
 }
 
-bool CDACAsioNetController::stopAsioNet(){
-    m_stopFlag = true;
-    if (m_asionet) {
-        m_asionet->disconnect();
-        delete m_asionet;
+auto CDACAsioNetController::releaseAsioNet() -> bool{
+    net_lib::CAsioNetSimple *asionet = nullptr;
+    {
+        // Waits for a credit being sent from the generator thread, later ones see no socket
+        const std::lock_guard<std::mutex> lock(m_credit_mutex);
+        m_creditsEnabled = false;
+        asionet = m_asionet;
         m_asionet = nullptr;
+    }
+    m_creditCond.notify_all();
+    if (asionet) {
+        asionet->disconnect();
+        delete asionet;
         return true;
     }
     return false;
 }
 
+bool CDACAsioNetController::stopAsioNet(){
+    m_stopFlag = true;
+    return releaseAsioNet();
+}
+
 auto CDACAsioNetController::start() -> bool{
     if (m_host == ""  || m_port == "")
         return false;
 
-    if (m_asionet){
-        delete m_asionet;
-        m_asionet = nullptr;
-    }
-    m_asionet = new net_lib::CAsioNetSimple(m_mode, m_host, m_port);
-    m_asionet->connectNotify.connect([=](std::string &host){
+    releaseAsioNet();
+    auto asionet = new net_lib::CAsioNetSimple(m_mode, m_host, m_port);
+    asionet->connectNotify.connect([=](std::string &host){
+        {
+            const std::lock_guard<std::mutex> lock(m_credit_mutex);
+            m_connected = true;
+            m_creditsEnabled = false;
+            m_lastAck = 0;
+            m_sendLimit = 0;
+            m_helloTime = std::chrono::steady_clock::now();
+        }
+        if (m_mode == net_lib::M_CLIENT){
+            // Empty credit pack asks the board for credits
+            size_t size = 0;
+            auto buf = BuildCreditPack(0,0,0,0,size);
+            asionet->sendData(false,std::shared_ptr<uint8_t[]>(buf),size);
+        }
         connectedNotify(host);
     });
 
-    m_asionet->disconnectNotify.connect([=](std::string &host)
+    asionet->disconnectNotify.connect([=](std::string &host)
     {
+        {
+            const std::lock_guard<std::mutex> lock(m_credit_mutex);
+            m_connected = false;
+            m_creditsEnabled = false;
+        }
+        m_creditCond.notify_all();
         disconnectedNotify(host);
     });
 
-    m_asionet->errorNotify.connect([=](std::error_code error)
+    asionet->errorNotify.connect([=](std::error_code error)
     {
         errorNotify(error);
     });
 
-    m_asionet->connectTimeoutNotify.connect([=](std::error_code error)
+    asionet->connectTimeoutNotify.connect([=](std::error_code error)
     {
         timeoutNotify(error);
     });
 
-    m_asionet->sendNotify.connect([this](std::error_code,size_t)
+    asionet->sendNotify.connect([this](std::error_code,size_t)
     {
         sendNotify();
     });
 
-    m_asionet->recivedNotify.connect(std::bind(&CDACAsioNetController::receiveHandler, this, std::placeholders::_1,std::placeholders::_2,std::placeholders::_3));
+    asionet->recivedNotify.connect(std::bind(&CDACAsioNetController::receiveHandler, this, std::placeholders::_1,std::placeholders::_2,std::placeholders::_3));
 
-    m_asionet->start();
+    {
+        const std::lock_guard<std::mutex> lock(m_credit_mutex);
+        m_asionet = asionet;
+    }
+    asionet->start();
     return true;
 }
 
@@ -113,23 +177,31 @@ void CDACAsioNetController::receiveHandler(std::error_code error,uint8_t* _buff,
         bool find_all_flag = false;
 
         do{
+            if (m_pos_last_in_fifo < PACK_HEADER_SIZE)
+                break;
 
-            for (uint32_t i = 0; i < m_pos_last_in_fifo - size_id; ++i) {
-                bool find_flag = false;
-                for (int j = 0; j < size_id; ++j) {
-                    if (m_tcp_fifo_buffer[i + j] == DAC_ID_PACK[j]) {
-                        find_flag = true;
-                    } else {
-                        find_flag = false;
-                        break;
-                    }
-                }
+            for (uint32_t i = 0; i + size_id <= m_pos_last_in_fifo; ++i) {
+                auto type = GetPackType(m_tcp_fifo_buffer + i);
                 //                   std::cout << i << " pos " <<  m_pos_last_in_fifo << "\n";
 
-                if (find_flag) {
+                if (type != PackType::NONE) {
+                    if (i + PACK_HEADER_SIZE > m_pos_last_in_fifo) {
+                        find_all_flag = false;
+                        break;
+                    }
                     uint32_t pack_size = ((uint32_t *) (m_tcp_fifo_buffer + i))[6];
                     if ((pack_size + i) <= m_pos_last_in_fifo) {
-                        extractBuffer(m_tcp_fifo_buffer + i, (size_t)pack_size);
+                        switch(type){
+                            case PackType::DATA:
+                                extractBuffer(m_tcp_fifo_buffer + i, (size_t)pack_size);
+                            break;
+                            case PackType::CREDIT:
+                                extractCredit(m_tcp_fifo_buffer + i, (size_t)pack_size);
+                            break;
+                            default:
+                                extractSequence(type, m_tcp_fifo_buffer + i, (size_t)pack_size);
+                            break;
+                        }
 
                         for(auto z = 0u; z < m_pos_last_in_fifo - pack_size - i; ++z){
                             m_tcp_fifo_buffer[z] = (m_tcp_fifo_buffer + i + pack_size)[z];
@@ -159,30 +231,214 @@ void CDACAsioNetController::receiveHandler(std::error_code error,uint8_t* _buff,
 
 auto CDACAsioNetController::extractBuffer(uint8_t* buff,size_t size) -> void{
     if (m_stopFlag) return;
+    if (m_pool){
+        // Blocks the receive handler while the pool is full, the client is throttled by TCP
+        DataLib::CDACBufferPool::Block *block = nullptr;
+        while(!block){
+            if (m_stopFlag || m_pool->isStopped()) return;
+            block = m_pool->acquire(100000);
+        }
+        if (ExtractPack(buff,size,*block,m_pool->getBlockSize())){
+            m_lastAck = block->index + 1;
+            m_pool->submit(block);
+            sendCredit(m_lastAck);
+        }else{
+            m_pool->cancel(block);
+        }
+        return;
+    }
     while(m_bufferdeq.size() > m_bufferLimit){
         if (m_stopFlag) return;
     }
-    const std::lock_guard<std::mutex> lock(m_recieve_mutex);
-    BufferPack obj;
-    if (ExtractPack(buff,size,obj.index,obj.ch1,obj.size_ch1,obj.ch2,obj.size_ch2)){
+    {
+        const std::lock_guard<std::mutex> lock(m_recieve_mutex);
+        BufferPack obj;
+        if (!ExtractPack(buff,size,obj.index,obj.ch1,obj.size_ch1,obj.ch2,obj.size_ch2)){
+            return;
+        }
         obj.empty = false;
+        m_lastAck = obj.index + 1;
         m_bufferdeq.push_front(obj);
     }
+    sendCredit(m_lastAck);
+}
+
+auto CDACAsioNetController::extractSequence(PackType type,uint8_t* buff,size_t size) -> void{
+    if (m_stopFlag || m_mode != net_lib::M_SERVER) return;
+    auto sequencer = m_sequencer;
+    if (!sequencer){
+        aprintf(stderr,"[CDACAsioNetController] Sequenced playback is not available\n");
+        return;
+    }
+    switch(type){
+        case PackType::SEGMENT:{
+            if (size < SEGMENT_PREFIX_SIZE) return;
+            uint32_t id = (uint32_t)((uint64_t*)buff)[2];
+            size_t size_ch1 = ((uint32_t*)buff)[7];
+            size_t size_ch2 = ((uint32_t*)buff)[8];
+            uint64_t offset = 0;
+            uint64_t total = 0;
+            memcpy(&offset,buff + 36,sizeof(uint64_t));
+            memcpy(&total,buff + 44,sizeof(uint64_t));
+            if (SEGMENT_PREFIX_SIZE + size_ch1 + size_ch2 != size){
+                aprintf(stderr,"[CDACAsioNetController] Broken segment pack\n");
+                return;
+            }
+            sequencer->addSegment(id,offset,total,buff + SEGMENT_PREFIX_SIZE,size_ch1,buff + SEGMENT_PREFIX_SIZE + size_ch1,size_ch2);
+        }
+        break;
+        case PackType::SEQUENCE:{
+            if (size < SEQUENCE_PREFIX_SIZE) return;
+            uint64_t flags = ((uint64_t*)buff)[2];
+            uint32_t count = ((uint32_t*)buff)[7];
+            if (SEQUENCE_PREFIX_SIZE + (size_t)count * SEQUENCE_STEP_SIZE != size){
+                aprintf(stderr,"[CDACAsioNetController] Broken sequence pack\n");
+                return;
+            }
+            std::vector<CDACSequencer::Step> steps(count);
+            auto table = (uint32_t*)(buff + SEQUENCE_PREFIX_SIZE);
+            for(uint32_t i = 0; i < count; ++i, table += SEQUENCE_STEP_SIZE / sizeof(uint32_t)){
+                steps[i].segment = table[0];
+                steps[i].repeat = table[1];
+                steps[i].next = (int32_t)table[2];
+                steps[i].loops = table[3];
+                steps[i].jump = (int32_t)table[4];
+            }
+            sequencer->setSequence(steps);
+            if (flags & SEQUENCE_FLAG_START){
+                sequencer->start();
+            }
+        }
+        break;
+        case PackType::TRIGGER:
+            sequencer->trigger();
+        break;
+        default:
+        break;
+    }
+}
+
+auto CDACAsioNetController::extractCredit(uint8_t* buff,size_t size) -> void{
+    if (m_stopFlag || size != CREDIT_PACK_SIZE) return;
+    if (m_mode == net_lib::M_SERVER){
+        // Client hello, from now on every received and played pack is answered
+        {
+            const std::lock_guard<std::mutex> lock(m_credit_mutex);
+            m_creditsEnabled = true;
+        }
+        sendCredit(m_lastAck);
+        return;
+    }
+    uint64_t ack = ((uint64_t*)buff)[2];
+    uint32_t free_slots = ((uint32_t*)buff)[7];
+    auto now = std::chrono::steady_clock::now();
+    {
+        const std::lock_guard<std::mutex> lock(m_credit_mutex);
+        m_creditsEnabled = true;
+        m_sendLimit = ack + free_slots;
+        m_flow.filled = ((uint32_t*)buff)[8];
+        m_flow.capacity = ((uint32_t*)buff)[9];
+        if (ack > m_flow.acked && ack <= m_index){
+            if (ack + m_sendTime.size() > m_index){
+                double latency = std::chrono::duration<double,std::milli>(now - m_sendTime[(ack - 1) % m_sendTime.size()]).count();
+                m_flow.latency_ms = m_flow.latency_ms == 0 ? latency : m_flow.latency_ms + (latency - m_flow.latency_ms) / 8;
+                m_flow.latency_max_ms = std::max(m_flow.latency_max_ms,latency);
+            }
+            m_flow.acked = ack;
+        }
+    }
+    m_creditCond.notify_all();
+}
+
+auto CDACAsioNetController::sendCredit(uint64_t ack) -> void{
+    uint32_t free_slots = 0;
+    uint32_t filled = 0;
+    uint32_t capacity = 0;
+    if (m_pool){
+        free_slots = m_pool->getFreeCount();
+        filled = m_pool->getFilledCount();
+        capacity = m_pool->getCount();
+    }else{
+        const std::lock_guard<std::mutex> lock(m_recieve_mutex);
+        capacity = m_bufferLimit + 1;
+        filled = m_bufferdeq.size();
+        free_slots = capacity > filled ? capacity - filled : 0;
+    }
+    // Called from the io thread and from the generator thread (pool release), the
+    // asynchronous send only queues the pack to the io thread, which writes it
+    const std::lock_guard<std::mutex> lock(m_credit_mutex);
+    if (!m_creditsEnabled || !m_asionet) return;
+    size_t size = 0;
+    auto buf = BuildCreditPack(ack,free_slots,filled,capacity,size);
+    m_asionet->sendData(true,std::shared_ptr<uint8_t[]>(buf),size);
+}
+
+auto CDACAsioNetController::waitCredit(uint64_t &index) -> bool{
+    std::unique_lock<std::mutex> lock(m_credit_mutex);
+    if (m_mode == net_lib::M_CLIENT){
+        auto blocked = [this]{
+            if (m_creditsEnabled) return m_index >= m_sendLimit;
+            // Gives the board time to answer the hello, an old server never sends credits
+            return std::chrono::steady_clock::now() - m_helloTime < std::chrono::milliseconds(CREDIT_HELLO_TIMEOUT_MS);
+        };
+        if (blocked()){
+            auto begin = std::chrono::steady_clock::now();
+            while(blocked()){
+                if (m_stopFlag || !m_asionet || !m_connected) return false;
+                m_creditCond.wait_for(lock,std::chrono::milliseconds(10));
+            }
+            if (m_creditsEnabled){
+                m_flow.stalls++;
+                m_flow.stall_ms += std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - begin).count();
+            }
+        }
+        m_sendTime[m_index % m_sendTime.size()] = std::chrono::steady_clock::now();
+    }
+    index = m_index++;
+    return true;
+}
+
+auto CDACAsioNetController::getFlowStats() -> FlowStats{
+    const std::lock_guard<std::mutex> lock(m_credit_mutex);
+    FlowStats stats = m_flow;
+    stats.enabled = m_creditsEnabled;
+    stats.sent = m_index;
+    stats.window = m_sendLimit > m_index ? m_sendLimit - m_index : 0;
+    return stats;
 }
 
 auto CDACAsioNetController::getBuffer() -> BufferPack{
-    const std::lock_guard<std::mutex> lock(m_recieve_mutex);
-    if (m_bufferdeq.size() > 0){
-        auto buf = m_bufferdeq.back();
+    if (m_pool){
+        BufferPack pack;
+        auto block = m_pool->next(0);
+        if (block){
+            pack.ch1 = block->size_ch1 ? block->ch1 : nullptr;
+            pack.ch2 = block->size_ch2 ? block->ch2 : nullptr;
+            pack.size_ch1 = block->size_ch1;
+            pack.size_ch2 = block->size_ch2;
+            pack.index = block->index;
+            pack.block = block;
+            pack.empty = false;
+        }
+        return pack;
+    }
+    BufferPack buf;
+    {
+        const std::lock_guard<std::mutex> lock(m_recieve_mutex);
+        if (m_bufferdeq.size() == 0){
+            return buf;
+        }
+        buf = m_bufferdeq.back();
         m_bufferdeq.pop_back();
-        return buf;
     }
-    return BufferPack();
+    sendCredit(m_lastAck);
+    return buf;
 }
 
 bool CDACAsioNetController::isConnected(){
-    if (!m_asionet) return false;
-    return m_asionet->isConnected();
+    // Set once the connect handler reset the credits and sent the hello
+    const std::lock_guard<std::mutex> lock(m_credit_mutex);
+    return m_asionet && m_connected;
 }
 
 auto CDACAsioNetController::getHost() -> std::string{
@@ -198,17 +454,106 @@ auto CDACAsioNetController::setReceivedBufferLimit(uint16_t count) -> void{
     m_bufferLimit = count;
 }
 
+auto CDACAsioNetController::setBufferPool(DataLib::CDACBufferPool::Ptr pool) -> void{
+    const std::lock_guard<std::mutex> lock(m_recieve_mutex);
+    m_pool = pool;
+    m_poolRelease.disconnect();
+    if (m_pool){
+        // A played block frees a slot on the board, the client gets a new credit
+        m_poolRelease = m_pool->releaseNotify.connect([this](){
+            sendCredit(m_lastAck);
+        });
+    }
+}
+
+auto CDACAsioNetController::setSequencer(CDACSequencer::Ptr sequencer) -> void{
+    m_sequencer = sequencer;
+}
+
+auto CDACAsioNetController::sendSegment(uint32_t id,const uint8_t *buffer_ch1,size_t size_ch1,const uint8_t *buffer_ch2,size_t size_ch2) -> bool{
+    if (!m_asionet || !m_asionet->isConnected()) return false;
+    if (size_ch1 && size_ch2 && size_ch1 != size_ch2) return false;
+    uint64_t total = std::max(size_ch1,size_ch2);
+    if (total == 0) return false;
+    // Large segments are split, a pack has to fit into the receive FIFO of the board
+    for(uint64_t offset = 0; offset < total; offset += SEGMENT_CHUNK_SIZE){
+        size_t chunk = std::min<uint64_t>(SEGMENT_CHUNK_SIZE,total - offset);
+        size_t chunk_ch1 = size_ch1 ? chunk : 0;
+        size_t chunk_ch2 = size_ch2 ? chunk : 0;
+        size_t size = SEGMENT_PREFIX_SIZE + chunk_ch1 + chunk_ch2;
+        auto buffer = new uint8_t[size];
+        memcpy(buffer,DAC_ID_SEGMENT,16);
+        ((uint64_t*)buffer)[2] = id;
+        ((uint32_t*)buffer)[6] = (uint32_t)size;
+        ((uint32_t*)buffer)[7] = (uint32_t)chunk_ch1;
+        ((uint32_t*)buffer)[8] = (uint32_t)chunk_ch2;
+        memcpy(buffer + 36,&offset,sizeof(uint64_t));
+        memcpy(buffer + 44,&total,sizeof(uint64_t));
+        if (chunk_ch1){
+            memcpy_neon(buffer + SEGMENT_PREFIX_SIZE,buffer_ch1 + offset,chunk_ch1);
+        }
+        if (chunk_ch2){
+            memcpy_neon(buffer + SEGMENT_PREFIX_SIZE + chunk_ch1,buffer_ch2 + offset,chunk_ch2);
+        }
+        if (!m_asionet->sendData(false,std::shared_ptr<uint8_t[]>(buffer),size)){
+            return false;
+        }
+    }
+    return true;
+}
+
+auto CDACAsioNetController::sendSequence(const std::vector<CDACSequencer::Step> &steps,bool start) -> bool{
+    if (!m_asionet || !m_asionet->isConnected()) return false;
+    size_t size = SEQUENCE_PREFIX_SIZE + steps.size() * SEQUENCE_STEP_SIZE;
+    if (size > SOCKET_BUFFER_SIZE) return false;
+    auto buffer = new uint8_t[size];
+    memcpy(buffer,DAC_ID_SEQUENCE,16);
+    ((uint64_t*)buffer)[2] = start ? SEQUENCE_FLAG_START : 0;
+    ((uint32_t*)buffer)[6] = (uint32_t)size;
+    ((uint32_t*)buffer)[7] = (uint32_t)steps.size();
+    auto table = (uint32_t*)(buffer + SEQUENCE_PREFIX_SIZE);
+    for(auto &step : steps){
+        table[0] = step.segment;
+        table[1] = step.repeat;
+        table[2] = (uint32_t)step.next;
+        table[3] = step.loops;
+        table[4] = (uint32_t)step.jump;
+        table += SEQUENCE_STEP_SIZE / sizeof(uint32_t);
+    }
+    return m_asionet->sendData(false,std::shared_ptr<uint8_t[]>(buffer),size);
+}
+
+auto CDACAsioNetController::sendTrigger() -> bool{
+    if (!m_asionet || !m_asionet->isConnected()) return false;
+    auto buffer = new uint8_t[PACK_HEADER_SIZE];
+    memcpy(buffer,DAC_ID_TRIGGER,16);
+    ((uint64_t*)buffer)[2] = 0;
+    ((uint32_t*)buffer)[6] = PACK_HEADER_SIZE;
+    return m_asionet->sendData(false,std::shared_ptr<uint8_t[]>(buffer),PACK_HEADER_SIZE);
+}
+
 auto CDACAsioNetController::sendBuffer(uint8_t *buffer_ch1,size_t size_ch1,uint8_t *buffer_ch2,size_t size_ch2) -> bool{
     if (!m_asionet) return false;
     if (m_asionet->isConnected()){
+        uint64_t index = 0;
+        if (!waitCredit(index)) return false;
         size_t size = 0;
-        auto buf = BuildPack(m_index++,buffer_ch1,size_ch1,buffer_ch2,size_ch2,size);
+        auto buf = BuildPack(index,buffer_ch1,size_ch1,buffer_ch2,size_ch2,size);
         auto ret = m_asionet->sendData(false,std::shared_ptr<uint8_t[]>(buf),size);
         return ret;
     }
     return false;
 }
 
+auto CDACAsioNetController::GetPackType(const uint8_t* _buffer) -> PackType{
+    if (memcmp(_buffer,DAC_ID_PACK,16) == 0) return PackType::DATA;
+    if (memcmp(_buffer,DAC_ID_CREDIT,16) == 0) return PackType::CREDIT;
+    if (memcmp(_buffer,DAC_ID_SEGMENT,16) == 0) return PackType::SEGMENT;
+    if (memcmp(_buffer,DAC_ID_SEQUENCE,16) == 0) return PackType::SEQUENCE;
+    if (memcmp(_buffer,DAC_ID_TRIGGER,16) == 0) return PackType::TRIGGER;
+    return PackType::NONE;
+}
+
 uint8_t* CDACAsioNetController::BuildPack(
         uint64_t _id ,
         const uint8_t *_ch1 ,
@@ -243,6 +588,54 @@ uint8_t* CDACAsioNetController::BuildPack(
     return buffer;
 }
 
+uint8_t* CDACAsioNetController::BuildCreditPack(
+        uint64_t _ack ,
+        uint32_t _free ,
+        uint32_t _filled ,
+        uint32_t _capacity ,
+        size_t &_buffer_size ){
+    auto buffer = new uint8_t[CREDIT_PACK_SIZE];
+    memcpy(buffer,DAC_ID_CREDIT,16);
+    ((uint64_t*)buffer)[2] = _ack;      // index of the next expected pack
+    ((uint32_t*)buffer)[6] = CREDIT_PACK_SIZE;
+    ((uint32_t*)buffer)[7] = _free;     // free slots on the board
+    ((uint32_t*)buffer)[8] = _filled;   // packs waiting for the generator
+    ((uint32_t*)buffer)[9] = _capacity;
+    _buffer_size = CREDIT_PACK_SIZE;
+    return buffer;
+}
+
+bool CDACAsioNetController::ExtractPack(
+        uint8_t* _buffer ,
+        size_t _size ,
+        DataLib::CDACBufferPool::Block &_block ,
+        size_t _blockSize){
+    if (strncmp((const char*)_buffer,DAC_ID_PACK,16) == 0){
+        if (_size != ((uint32_t*)_buffer)[6]){
+            aprintf(stderr,"[FATAL ERROR] CDACAsioNetController::ExtractPack\n");
+            exit(5);
+        }
+        size_t size_ch1 = ((uint32_t*)_buffer)[7];
+        size_t size_ch2 = ((uint32_t*)_buffer)[8];
+        if (size_ch1 > _blockSize || size_ch2 > _blockSize){
+            aprintf(stderr,"[CDACAsioNetController] Pack is larger than the DAC buffer (%zu, %zu > %zu)\n",size_ch1,size_ch2,_blockSize);
+            return false;
+        }
+        uint16_t prefix = 36;
+        _block.index = ((uint64_t*)_buffer)[2];
+        _block.size_ch1 = size_ch1;
+        _block.size_ch2 = size_ch2;
+        if (size_ch1 > 0) {
+            memcpy_neon(_block.ch1,_buffer + prefix,size_ch1);
+        }
+        if (size_ch2 > 0) {
+            memcpy_neon(_block.ch2,_buffer + prefix + size_ch1,size_ch2);
+        }
+        return true;
+    }
+    return false;
+}
+
 bool CDACAsioNetController::ExtractPack(
         uint8_t* _buffer ,
         size_t _size ,
@@ -2,8 +2,14 @@
 #define STREAMING_ROOT_DACASIONETCONTROLLER_H
 
 #include <mutex>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <condition_variable>
 #include "net_lib/asio_net_simple.h"
 #include "data_lib/signal.hpp"
+#include "data_lib/dac_buffer_pool.h"
+#include "dac_sequencer.h"
 
 namespace dac_streaming_lib {
 
@@ -27,6 +33,23 @@ public:
         size_t   size_ch2 = 0;
         uint64_t index = 0;
         bool     empty = true;
+        DataLib::CDACBufferPool::Block *block = nullptr; // owner of ch1/ch2 when a pool is used
+    };
+
+    // Credit flow control. The board answers the client hello and every received or
+    // played pack with a credit pack: the client may send packs while their index is
+    // below ack + free. Old peers ignore the credit packs and fall back to TCP throttling.
+    struct FlowStats{
+        bool     enabled = false;     // board advertises credits
+        uint64_t sent = 0;            // packs sent
+        uint64_t acked = 0;           // packs received by the board
+        uint64_t window = 0;          // packs that may be sent now
+        uint32_t filled = 0;          // packs queued on the board
+        uint32_t capacity = 0;        // board buffer size in packs
+        double   latency_ms = 0;      // smoothed time from send to acknowledge
+        double   latency_max_ms = 0;
+        uint64_t stalls = 0;          // sends which waited for credits
+        double   stall_ms = 0;        // total time waited for credits
     };
 
     using Ptr = std::shared_ptr<CDACAsioNetController>;
@@ -47,9 +70,19 @@ public:
     auto getBuffer() -> BufferPack;
 
     auto setReceivedBufferLimit(uint16_t count) -> void;
+    // Received packs are copied into pool blocks instead of allocated buffers
+    auto setBufferPool(DataLib::CDACBufferPool::Ptr pool) -> void;
 
-    // syncSend
+    // syncSend, in client mode waits for a credit when the board advertises them
     auto sendBuffer(uint8_t *buffer_ch1, size_t size_ch1,uint8_t *buffer_ch2, size_t size_ch2) -> bool;
+    auto getFlowStats() -> FlowStats;
+
+    // Sequenced playback. Segments are uploaded once and cached on the board,
+    // the step table and the triggers select what the board plays from them.
+    auto setSequencer(CDACSequencer::Ptr sequencer) -> void;
+    auto sendSegment(uint32_t id,const uint8_t *buffer_ch1,size_t size_ch1,const uint8_t *buffer_ch2,size_t size_ch2) -> bool;
+    auto sendSequence(const std::vector<CDACSequencer::Step> &steps,bool start) -> bool;
+    auto sendTrigger() -> bool;
 
     sigslot::signal<string&> connectedNotify;
     sigslot::signal<string&> disconnectedNotify;
@@ -62,9 +95,25 @@ public:
 
 private:
 
+    enum class PackType{
+        NONE,
+        DATA,
+        CREDIT,
+        SEGMENT,
+        SEQUENCE,
+        TRIGGER
+    };
+
     auto start() -> bool;
+    auto releaseAsioNet() -> bool;
     auto receiveHandler(std::error_code error,uint8_t*,size_t) -> void;
     auto extractBuffer(uint8_t*,size_t) -> void;
+    auto extractCredit(uint8_t*,size_t) -> void;
+    auto extractSequence(PackType,uint8_t*,size_t) -> void;
+    auto sendCredit(uint64_t ack) -> void;
+    auto waitCredit(uint64_t &index) -> bool;
+
+    static auto GetPackType(const uint8_t* _buffer) -> PackType;
 
     static uint8_t* BuildPack(
             uint64_t _id ,
@@ -74,6 +123,19 @@ private:
             size_t _size_ch2 ,
             size_t &_buffer_size );
 
+    static uint8_t* BuildCreditPack(
+            uint64_t _ack ,
+            uint32_t _free ,
+            uint32_t _filled ,
+            uint32_t _capacity ,
+            size_t &_buffer_size );
+
+    static bool ExtractPack(
+            uint8_t* _buffer ,
+            size_t _size ,
+            DataLib::CDACBufferPool::Block &_block ,
+            size_t _blockSize);
+
     static bool ExtractPack(
             uint8_t* _buffer ,
             size_t _size ,
@@ -96,7 +158,23 @@ private:
     uint32_t                         m_pos_last_in_fifo;
     std::atomic_bool                 m_stopFlag;
     std::deque<BufferPack>           m_bufferdeq;
+    DataLib::CDACBufferPool::Ptr     m_pool;
+    sigslot::scoped_connection       m_poolRelease;
+    CDACSequencer::Ptr               m_sequencer;
     std::mutex                       m_recieve_mutex;
+
+    // m_asionet, m_connected and m_creditsEnabled change under m_credit_mutex. Credits
+    // are queued to the io thread without the socket lock, so the socket callbacks
+    // may take m_credit_mutex.
+    std::atomic_bool                 m_creditsEnabled;
+    bool                             m_connected;
+    std::atomic<uint64_t>            m_lastAck;
+    uint64_t                         m_sendLimit;
+    std::chrono::steady_clock::time_point m_helloTime;
+    std::vector<std::chrono::steady_clock::time_point> m_sendTime;
+    FlowStats                        m_flow;
+    std::mutex                       m_credit_mutex;
+    std::condition_variable          m_creditCond;
 };
 
 }
@@ -0,0 +1,285 @@
+#include <string.h>
+#include <algorithm>
+#include "dac_sequencer.h"
+#include "data_lib/thread_cout.h"
+#include "data_lib/neon_asm.h"
+
+// A single segment is kept in board memory, larger waveforms have to be streamed
+#define SEQ_MAX_SEGMENT_SIZE (64 * 1024 * 1024)
+// All cached and uploading segments, both channels
+#define SEQ_MAX_MEMORY       (128 * 1024 * 1024)
+
+using namespace dac_streaming_lib;
+
+auto CDACSequencer::Create(DataLib::CDACBufferPool::Ptr pool) -> CDACSequencer::Ptr{
+    return std::make_shared<CDACSequencer>(pool);
+}
+
+CDACSequencer::CDACSequencer(DataLib::CDACBufferPool::Ptr pool):
+    m_pool(pool),
+    m_segments(),
+    m_uploads(),
+    m_steps(),
+    m_loopCount(),
+    m_present{false,false},
+    m_step(0),
+    m_repeat(0),
+    m_pos(0),
+    m_ended(false),
+    m_index(0),
+    m_trigger(false),
+    m_run(false),
+    m_thread(),
+    m_mutex()
+{
+}
+
+CDACSequencer::~CDACSequencer(){
+    stop();
+}
+
+auto CDACSequencer::addSegment(uint32_t id,uint64_t offset,uint64_t total,const uint8_t *ch1,size_t size_ch1,const uint8_t *ch2,size_t size_ch2) -> bool{
+    if (total == 0 || total % 2 || total > SEQ_MAX_SEGMENT_SIZE){
+        aprintf(stderr,"[CDACSequencer] Wrong size of segment %d: %llu\n",id,(unsigned long long)total);
+        return false;
+    }
+    if ((size_ch1 && size_ch2 && size_ch1 != size_ch2) || offset + std::max(size_ch1,size_ch2) > total){
+        aprintf(stderr,"[CDACSequencer] Broken part of segment %d\n",id);
+        return false;
+    }
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    auto &upload = m_uploads[id];
+    if (!upload || upload->size != total){
+        upload = std::make_shared<Segment>();
+        upload->size = total;
+    }
+    const uint8_t *src[2] = {ch1,ch2};
+    size_t size[2] = {size_ch1,size_ch2};
+    for(int ch = 0; ch < 2; ch++){
+        if (!size[ch] || upload->present[ch]) continue;
+        if (memoryUsage() + total > SEQ_MAX_MEMORY){
+            aprintf(stderr,"[CDACSequencer] No memory left for segment %d\n",id);
+            m_uploads.erase(id);
+            return false;
+        }
+        upload->ch[ch].resize(total,0);
+        upload->present[ch] = true;
+    }
+    for(int ch = 0; ch < 2; ch++){
+        if (size[ch]){
+            memcpy_neon(upload->ch[ch].data() + offset,src[ch],size[ch]);
+        }
+    }
+    if (addRange(*upload,offset,offset + std::max(size_ch1,size_ch2))){
+        m_segments[id] = upload;
+        m_uploads.erase(id);
+    }
+    return true;
+}
+
+auto CDACSequencer::addRange(Segment &segment,uint64_t begin,uint64_t end) -> bool{
+    // Merges the range with the overlapping and adjacent ones, a part sent twice is counted once
+    auto &ranges = segment.received;
+    auto it = ranges.upper_bound(begin);
+    if (it != ranges.begin() && std::prev(it)->second >= begin){
+        --it;
+        begin = it->first;
+        end = std::max(end,it->second);
+        it = ranges.erase(it);
+    }
+    while(it != ranges.end() && it->first <= end){
+        end = std::max(end,it->second);
+        it = ranges.erase(it);
+    }
+    ranges[begin] = end;
+    return ranges.size() == 1 && ranges.begin()->first == 0 && ranges.begin()->second >= segment.size;
+}
+
+auto CDACSequencer::memoryUsage() -> uint64_t{
+    uint64_t size = 0;
+    for(auto map : {&m_segments,&m_uploads}){
+        for(auto &kv : *map){
+            size += kv.second->ch[0].size() + kv.second->ch[1].size();
+        }
+    }
+    return size;
+}
+
+auto CDACSequencer::clearSegments() -> void{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_segments.clear();
+    m_uploads.clear();
+}
+
+auto CDACSequencer::setSequence(const std::vector<Step> &steps) -> void{
+    stop();
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_steps = steps;
+    m_loopCount.assign(m_steps.size(),0);
+    goTo(0);
+    m_ended = false;
+}
+
+auto CDACSequencer::validate() -> bool{
+    if (m_steps.empty()){
+        aprintf(stderr,"[CDACSequencer] Sequence is empty\n");
+        return false;
+    }
+    m_present[0] = m_present[1] = false;
+    for(size_t i = 0; i < m_steps.size(); i++){
+        auto &step = m_steps[i];
+        auto it = m_segments.find(step.segment);
+        if (it == m_segments.end()){
+            aprintf(stderr,"[CDACSequencer] Step %zu uses missing segment %d\n",i,step.segment);
+            return false;
+        }
+        if (step.next >= (int32_t)m_steps.size() || step.jump >= (int32_t)m_steps.size()){
+            aprintf(stderr,"[CDACSequencer] Step %zu points behind the end of the sequence\n",i);
+            return false;
+        }
+        m_present[0] |= it->second->present[0];
+        m_present[1] |= it->second->present[1];
+    }
+    return true;
+}
+
+auto CDACSequencer::start() -> bool{
+    stop();
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        if (!validate()) return false;
+        m_loopCount.assign(m_steps.size(),0);
+        goTo(0);
+        m_ended = false;
+        m_index = 0;
+    }
+    m_trigger = false;
+    m_pool->clearEnd();
+    m_run = true;
+    m_thread = std::thread(&CDACSequencer::worker, this);
+    return true;
+}
+
+auto CDACSequencer::stop() -> void{
+    m_run = false;
+    if (m_thread.joinable()){
+        m_thread.join();
+    }
+}
+
+auto CDACSequencer::isRunning() -> bool{
+    return m_run;
+}
+
+auto CDACSequencer::trigger() -> void{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_run && !m_ended && m_step < m_steps.size() && m_steps[m_step].jump >= 0){
+        m_trigger = true;
+    }
+}
+
+auto CDACSequencer::goTo(size_t step) -> void{
+    m_step = step;
+    m_repeat = 0;
+    m_pos = 0;
+}
+
+auto CDACSequencer::advance() -> void{
+    auto &step = m_steps[m_step];
+    if (step.next < 0){
+        goTo(m_step + 1);
+        return;
+    }
+    if (step.loops == 0){
+        goTo(step.next);
+        return;
+    }
+    if (m_loopCount[m_step] < step.loops){
+        m_loopCount[m_step]++;
+        goTo(step.next);
+    }else{
+        m_loopCount[m_step] = 0;
+        goTo(m_step + 1);
+    }
+}
+
+auto CDACSequencer::fillBlock(DataLib::CDACBufferPool::Block &block) -> size_t{
+    auto blockSize = m_pool->getBlockSize();
+    uint8_t *dst[2] = {block.ch1,block.ch2};
+    size_t filled = 0;
+    while(filled < blockSize && !m_ended){
+        if (m_step >= m_steps.size()){
+            m_ended = true;
+            break;
+        }
+        auto &step = m_steps[m_step];
+        auto it = m_segments.find(step.segment);
+        if (it == m_segments.end()){
+            aprintf(stderr,"[CDACSequencer] Segment %d was removed while playing\n",step.segment);
+            m_ended = true;
+            break;
+        }
+        auto &segment = *it->second;
+        if (m_pos < segment.size){
+            size_t size = std::min<uint64_t>(blockSize - filled,segment.size - m_pos);
+            for(int ch = 0; ch < 2; ch++){
+                if (!m_present[ch]) continue;
+                if (segment.present[ch]){
+                    memcpy_neon(dst[ch] + filled,segment.ch[ch].data() + m_pos,size);
+                }else{
+                    memset(dst[ch] + filled,0,size);
+                }
+            }
+            filled += size;
+            m_pos += size;
+        }
+        if (m_pos >= segment.size){
+            m_pos = 0;
+            m_repeat++;
+            if (m_trigger && step.jump >= 0){
+                m_trigger = false;
+                goTo(step.jump);
+            }else if (step.repeat && m_repeat >= step.repeat){
+                advance();
+            }
+        }
+    }
+    return filled;
+}
+
+auto CDACSequencer::worker() -> void{
+    auto blockSize = m_pool->getBlockSize();
+    bool ended = false;
+    while(m_run){
+        auto block = m_pool->acquire(100000);
+        if (!block) continue;
+        size_t filled = 0;
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            filled = fillBlock(*block);
+            ended = m_ended;
+        }
+        if (filled == 0){
+            m_pool->cancel(block);
+            ended = true;
+            break;
+        }
+        // The last block is padded, the generator always plays whole blocks
+        for(int ch = 0; ch < 2; ch++){
+            uint8_t *dst = ch == 0 ? block->ch1 : block->ch2;
+            if (m_present[ch] && filled < blockSize){
+                memset(dst + filled,0,blockSize - filled);
+            }
+        }
+        block->size_ch1 = m_present[0] ? blockSize : 0;
+        block->size_ch2 = m_present[1] ? blockSize : 0;
+        block->index = m_index++;
+        m_pool->submit(block);
+        if (ended) break;
+    }
+    // The generator plays the queued blocks, then the manager reports the end
+    if (ended){
+        m_pool->setEnd();
+    }
+    m_run = false;
+}
@@ -0,0 +1,99 @@
+#ifndef STREAMING_ROOT_DACSEQUENCER_H
+#define STREAMING_ROOT_DACSEQUENCER_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "data_lib/dac_buffer_pool.h"
+
+namespace dac_streaming_lib {
+
+/**
+ * Builds DAC blocks on the board from cached segments.
+ * Segments are uploaded once, then a small step table selects which segment
+ * is played, how often, where to continue and where to jump on a trigger.
+ * Segments are concatenated sample exactly across block boundaries, so the
+ * only data sent while playing is the table and the triggers.
+ */
+
+class CDACSequencer
+{
+    public:
+
+        struct Step{
+            uint32_t segment = 0;
+            uint32_t repeat  = 1;   // 0 - repeats until a trigger jump or stop
+            int32_t  next    = -1;  // step after the last repeat, -1 - following step
+            uint32_t loops   = 0;   // how often next is taken before falling through, 0 - always
+            int32_t  jump    = -1;  // step taken at the end of a repeat after a trigger, -1 - none
+        };
+
+        using Ptr = std::shared_ptr<CDACSequencer>;
+
+        static auto Create(DataLib::CDACBufferPool::Ptr pool) -> Ptr;
+        CDACSequencer(DataLib::CDACBufferPool::Ptr pool);
+        ~CDACSequencer();
+
+        // Stores a part of a segment, sizes are bytes per channel. A segment
+        // replaces an older one with the same id once all bytes have arrived,
+        // parts may be sent again. Cached and uploading segments share one budget.
+        auto addSegment(uint32_t id,uint64_t offset,uint64_t total,const uint8_t *ch1,size_t size_ch1,const uint8_t *ch2,size_t size_ch2) -> bool;
+        auto clearSegments() -> void;
+
+        // Stops the playback, start() begins with the first step. When the last
+        // step of a finite sequence was played the pool is set to the end.
+        auto setSequence(const std::vector<Step> &steps) -> void;
+        auto start() -> bool;
+        auto stop() -> void;
+        auto isRunning() -> bool;
+
+        // Handled at the end of the current repeat of the step being assembled,
+        // blocks already queued in the pool are played first. A trigger is only
+        // latched while that step has a jump, otherwise it is ignored.
+        auto trigger() -> void;
+
+    private:
+
+        struct Segment{
+            std::vector<uint8_t> ch[2];
+            bool     present[2] = {false,false};
+            uint64_t size = 0;      // bytes per channel
+            std::map<uint64_t,uint64_t> received;  // begin -> end of the received ranges
+        };
+
+        CDACSequencer(const CDACSequencer &) = delete;
+        CDACSequencer(CDACSequencer &&) = delete;
+        CDACSequencer& operator=(const CDACSequencer&) = delete;
+        CDACSequencer& operator=(const CDACSequencer&&) = delete;
+
+        auto validate() -> bool;
+        auto memoryUsage() -> uint64_t;
+        static auto addRange(Segment &segment,uint64_t begin,uint64_t end) -> bool;
+        auto worker() -> void;
+        auto fillBlock(DataLib::CDACBufferPool::Block &block) -> size_t;
+        auto advance() -> void;
+        auto goTo(size_t step) -> void;
+
+        DataLib::CDACBufferPool::Ptr            m_pool;
+        std::map<uint32_t,std::shared_ptr<Segment>> m_segments;
+        std::map<uint32_t,std::shared_ptr<Segment>> m_uploads;
+        std::vector<Step>                       m_steps;
+        std::vector<uint32_t>                   m_loopCount;
+        bool                                    m_present[2];
+        size_t                                  m_step;
+        uint64_t                                m_repeat;
+        uint64_t                                m_pos;      // bytes in the current segment
+        bool                                    m_ended;
+        uint64_t                                m_index;
+        std::atomic_bool                        m_trigger;
+        std::atomic_bool                        m_run;
+        std::thread                             m_thread;
+        std::mutex                              m_mutex;
+};
+
+}
+
+#endif
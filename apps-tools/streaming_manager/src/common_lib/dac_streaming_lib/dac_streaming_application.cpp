@@ -3,7 +3,7 @@
 #include <fstream>
 #include <functional>
 #include <cstdlib>
-#include <deque>
+#include <algorithm>
 
 #include "data_lib/thread_cout.h"
 #include "dac_streaming_application.h"
@@ -19,6 +19,9 @@ CDACStreamingApplication::CDACStreamingApplication(CDACStreamingManager::Ptr _st
     m_ReadyToPass(0),
     m_isRun(false),
     m_isRunNonBloking(false),
+    m_underruns(0),
+    m_lateBuffers(0),
+    m_writtenBuffers(0),
     m_testMode(false),
     m_verbMode(false)
 {
@@ -81,40 +84,73 @@ auto CDACStreamingApplication::stop(bool wait) -> bool{
 
 void CDACStreamingApplication::genWorker()
 {
-    int64_t counter = 0;
-//    uintmax_t passCounter = 0;
-    //uint8_t   skipBuffs = 0;
-    //bool isFirstBufferInit = false;
-    //bool isSecondBufferInit = false;
+    m_underruns = 0;
+    m_lateBuffers = 0;
+    m_writtenBuffers = 0;
     m_gen->prepare();
     m_gen->start();
-    
-    std::deque<CDACAsioNetController::BufferPack> packs;
+
+    // Time to play one half of the DAC buffer, the next block must be written within it
+    uint32_t halfUs = (uint64_t)(uio_lib::dac_buf_size / sizeof(int16_t)) * 1000000 / std::max<uint32_t>(m_gen->getDacHz(),1);
+    uint32_t waitUs = std::max<uint32_t>(halfUs / 4,1);
+
+    CDACAsioNetController::BufferPack pack;
+    bool starved = false;
+    bool waitData = false;
+    uint64_t lastUnderruns = 0;
+    uint64_t lastLate = 0;
+    auto lastStats = std::chrono::steady_clock::now();
 try{
     while (m_GenThreadRun.test_and_set())
     {
-        if (packs.size() < 10){
-            auto buf = m_streamingManager->getBuffer();
-            if (!buf.empty)
-                packs.push_back(buf);
+        // Both halves are played empty until the first two blocks are written
+        bool counting = m_writtenBuffers >= 2 && !m_streamingManager->isEnded();
+
+        if (pack.empty){
+            pack = m_streamingManager->getBuffer(waitUs);
+            if (pack.empty){
+                if (counting && m_gen->isWriteReady()){
+                    waitData = true;
+                }
+            }else if (waitData){
+                m_lateBuffers++;
+                waitData = false;
+            }
+        }
+
+        bool isStarved = counting && m_gen->isStarved();
+        if (isStarved && !starved){
+            m_underruns++;
         }
+        starved = isStarved;
 
-        if (packs.size() > 0) {
-            auto pack = packs[0];
+        if (!pack.empty){
             if (m_gen->write(pack.ch1,pack.ch2,pack.size_ch1,pack.size_ch2)){
-                counter++;
-                if (pack.ch1){
-                    delete[] pack.ch1;
-                }
+                m_streamingManager->releaseBuffer(pack);
+                pack = CDACAsioNetController::BufferPack();
+                m_writtenBuffers++;
+            }else{
+                m_gen->wait(waitUs);
+            }
+        }
 
-                if (pack.ch2){
-                    delete[] pack.ch2;
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastStats >= std::chrono::seconds(1)){
+            lastStats = now;
+            if (m_underruns != lastUnderruns || m_lateBuffers != lastLate){
+                lastUnderruns = m_underruns;
+                lastLate = m_lateBuffers;
+                if (m_verbMode){
+                    aprintf(stderr,"[DAC] underruns %llu late buffers %llu written %llu\n",(unsigned long long)lastUnderruns,(unsigned long long)lastLate,(unsigned long long)m_writtenBuffers);
                 }
-                packs.pop_front();
+                statsNotify(lastUnderruns,lastLate);
             }
         }
     }
-    
+    if (!pack.empty){
+        m_streamingManager->releaseBuffer(pack);
+    }
+
 }catch (std::exception& e)
 	{
 		std::cerr << "Error: oscWorker() " << e.what() << std::endl ;
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "uio_lib/generator.h"
+#include "data_lib/signal.hpp"
 #include "dac_streaming_manager.h"
 
 namespace dac_streaming_lib {
@@ -28,6 +29,15 @@ public:
     auto setTestMode(bool mode) -> void;
     auto setVerbousMode(bool mode) -> void;
 
+    // Episodes where both DAC half buffers were played without new data
+    auto getUnderruns() -> uint64_t {return m_underruns;}
+    // Buffers that arrived after the DMA was already waiting for them
+    auto getLateBuffers() -> uint64_t {return m_lateBuffers;}
+    auto getWrittenBuffers() -> uint64_t {return m_writtenBuffers;}
+
+    // underruns, late buffers; at most once per second while the counters change
+    sigslot::signal<uint64_t,uint64_t> statsNotify;
+
 private:
     int m_PerformanceCounterPeriod = 10;
 
@@ -39,6 +49,9 @@ private:
     std::atomic_int  m_ReadyToPass;
     std::atomic_bool m_isRun;
     std::atomic_bool m_isRunNonBloking;
+    std::atomic<uint64_t> m_underruns;
+    std::atomic<uint64_t> m_lateBuffers;
+    std::atomic<uint64_t> m_writtenBuffers;
     static_assert(ATOMIC_INT_LOCK_FREE == 2,"this implementation does not guarantee that std::atomic<int> is always lock free.");
     bool             m_testMode;
     bool             m_verbMode;
@@ -8,6 +8,9 @@
 #include "data_lib/thread_cout.h"
 #include "dac_streaming_manager.h"
 
+// Blocks of one DAC half buffer (CReaderController::getMaxBufferSize()) per channel
+#define DAC_POOL_BLOCKS 16
+
 using namespace dac_streaming_lib;
 
 CDACStreamingManager::Ptr CDACStreamingManager::Create(DACStream_FileType _fileType, std::string _filePath,CStreamSettings::DACRepeat _repeat,int32_t _rep_count,int64_t memoryCacheSize){
@@ -25,7 +28,13 @@ CDACStreamingManager::CDACStreamingManager(DACStream_FileType _fileType, std::st
     m_repeat(_repeat),
     m_rep_count(_rep_count),
     m_memoryCacheSize(memoryCacheSize),
-    m_readerController(nullptr)
+    m_readerController(nullptr),
+    m_pool(DataLib::CDACBufferPool::Create(DAC_POOL_BLOCKS,CReaderController::getMaxBufferSize())),
+    m_sequencer(nullptr),
+    m_readerThread(),
+    m_readerRun(false),
+    m_endReason(NR_ENDED),
+    m_endNotified(false)
 {
     if (m_fileType == DACStream_FileType::TDMS_TYPE){
         m_readerController = new CReaderController(CStreamSettings::TDMS,m_filePath,m_repeat,m_rep_count,m_memoryCacheSize);
@@ -50,7 +59,13 @@ CDACStreamingManager::CDACStreamingManager(std::string _host, std::string _port)
     m_repeat(CStreamSettings::DAC_REP_OFF),
     m_rep_count(0),
     m_memoryCacheSize(0),
-    m_readerController(nullptr)
+    m_readerController(nullptr),
+    m_pool(DataLib::CDACBufferPool::Create(DAC_POOL_BLOCKS,CReaderController::getMaxBufferSize())),
+    m_sequencer(CDACSequencer::Create(m_pool)),
+    m_readerThread(),
+    m_readerRun(false),
+    m_endReason(NR_ENDED),
+    m_endNotified(false)
 {
 }
 
@@ -66,6 +81,8 @@ CDACStreamingManager::~CDACStreamingManager(){
 auto CDACStreamingManager::startServer() -> void{
     m_asionet = nullptr;
     m_asionet = std::make_shared<CDACAsioNetController>();
+    m_asionet->setBufferPool(m_pool);
+    m_asionet->setSequencer(m_sequencer);
     m_asionet->connectedNotify.connect([](std::string &host){
         aprintf(stdout,"Client connected to DAC streaming server %s\n", host.c_str());
     });
@@ -80,69 +97,99 @@ auto CDACStreamingManager::stopServer() -> void {
     m_asionet = nullptr;
 }
 
+auto CDACStreamingManager::setReadAheadRate(uint64_t samplesPerSec) -> void {
+    if (m_readerController){
+        m_readerController->setSampleRate(samplesPerSec);
+    }
+}
+
 auto CDACStreamingManager::run() -> void {
+    m_pool->reset();
+    m_endNotified = false;
     if (!m_use_local_file){
         this->startServer();
+    }else{
+        m_readerRun = true;
+        m_readerThread = std::thread(&CDACStreamingManager::readerWorker, this);
     }
 }
 
 auto CDACStreamingManager::stop() -> void {
+    m_readerRun = false;
+    m_pool->stop();
+    if (m_sequencer){
+        m_sequencer->stop();
+    }
+    if (m_readerThread.joinable()){
+        m_readerThread.join();
+    }
     if (!m_use_local_file){
         this->stopServer();
     }
 }
 
-auto CDACStreamingManager::getBuffer() -> const CDACAsioNetController::BufferPack {
-    if (m_use_local_file){
-        CDACAsioNetController::BufferPack pack;
-        if (m_readerController){
-            auto isOpen = m_readerController->isOpen();
-            if (isOpen != CReaderController::OR_OK){
-                if (isOpen == CReaderController::OR_CLOSE){
-                    notifyStop(CDACStreamingManager::NR_MISSING_FILE);
-                    return CDACAsioNetController::BufferPack();
-                }
-                notifyStop(CDACStreamingManager::NR_BROKEN);
-                return CDACAsioNetController::BufferPack();
-            }
-            uint8_t *ch1_read = nullptr;
-            uint8_t *ch2_read = nullptr;
-            size_t size1_read = 0;
-            size_t size2_read = 0;
-            auto res = m_readerController->getBufferPrepared(&ch1_read,&size1_read,&ch2_read,&size2_read);
-            if (size1_read != 0 || size2_read != 0){
-                pack.ch1 = ch1_read;
-                pack.ch2 = ch2_read;
-                pack.size_ch1 = size1_read;
-                pack.size_ch2 = size2_read;
-                if (pack.size_ch1 || pack.size_ch2){
-                    pack.empty = false;
-                }
-            }else{
-                auto sendRes = CDACStreamingManager::NR_STOP;
-                switch(res){
-                    case CReaderController::BR_BROKEN:
-                        sendRes = CDACStreamingManager::NR_BROKEN;
-                    break;
-                    case CReaderController::BR_EMPTY:
-                        sendRes = CDACStreamingManager::NR_EMPTY;
-                    break;
-                    case CReaderController::BR_ENDED:
-                        sendRes = CDACStreamingManager::NR_ENDED;
-                    break;
-                    default:
-                    break;
-                }
-
-                notifyStop(sendRes);
+auto CDACStreamingManager::readerWorker() -> void {
+    uint64_t index = 0;
+    while(m_readerRun){
+        if (!m_readerController || m_readerController->isOpen() != CReaderController::OR_OK){
+            m_endReason = (m_readerController && m_readerController->isOpen() != CReaderController::OR_CLOSE) ? NR_BROKEN : NR_MISSING_FILE;
+            break;
+        }
+        auto block = m_pool->acquire(100000);
+        if (!block) continue;
+        auto res = m_readerController->getBufferPrepared(block->ch1,&block->size_ch1,block->ch2,&block->size_ch2);
+        if (block->size_ch1 || block->size_ch2){
+            block->index = index++;
+            m_pool->submit(block);
+        }else{
+            m_pool->cancel(block);
+        }
+        if (res != CReaderController::BR_OK){
+            switch(res){
+                case CReaderController::BR_BROKEN:
+                    m_endReason = NR_BROKEN;
+                break;
+                case CReaderController::BR_EMPTY:
+                    m_endReason = NR_EMPTY;
+                break;
+                default:
+                    m_endReason = NR_ENDED;
+                break;
             }
+            break;
         }
-        return pack;
-    } else{
-        if (m_asionet)
-            return m_asionet->getBuffer();
     }
-    return CDACAsioNetController::BufferPack();
+    m_pool->setEnd();
+}
+
+auto CDACStreamingManager::getBuffer(int64_t timeout_us) -> const CDACAsioNetController::BufferPack {
+    CDACAsioNetController::BufferPack pack;
+    auto block = m_pool->next(timeout_us);
+    if (block){
+        pack.ch1 = block->size_ch1 ? block->ch1 : nullptr;
+        pack.ch2 = block->size_ch2 ? block->ch2 : nullptr;
+        pack.size_ch1 = block->size_ch1;
+        pack.size_ch2 = block->size_ch2;
+        pack.index = block->index;
+        pack.block = block;
+        pack.empty = false;
+        m_endNotified = false;
+    }else if (!m_endNotified && m_pool->isEnded()){
+        // A finished file or, on the network server, the end of a finite sequence
+        m_endNotified = true;
+        notifyStop(m_use_local_file ? m_endReason : NR_STOP);
+    }
+    return pack;
+}
+
+auto CDACStreamingManager::releaseBuffer(const CDACAsioNetController::BufferPack &pack) -> void {
+    if (pack.block){
+        m_pool->release(pack.block);
+    }
+}
+
+auto CDACStreamingManager::isEnded() -> bool {
+    return m_pool->isEnded();
 }
 
 auto CDACStreamingManager::isLocalMode() -> bool{
@@ -14,6 +14,7 @@
 #include "settings_lib/dac_settings.h"
 #include "reader_lib/reader_controller.h"
 #include "data_lib/signal.hpp"
+#include "data_lib/dac_buffer_pool.h"
 
 namespace dac_streaming_lib {
 
@@ -49,7 +50,13 @@ class CDACStreamingManager
         auto run() -> void;
         auto stop() -> void;
         auto isLocalMode() -> bool;
-        auto getBuffer() -> const CDACAsioNetController::BufferPack;
+        // DAC rate in samples per second, sizes the read ahead of the file reader
+        auto setReadAheadRate(uint64_t samplesPerSec) -> void;
+        // Waits up to timeout_us for the next block, hand it back with releaseBuffer()
+        auto getBuffer(int64_t timeout_us = 0) -> const CDACAsioNetController::BufferPack;
+        auto releaseBuffer(const CDACAsioNetController::BufferPack &pack) -> void;
+        // All data of the file or of a finite sequence was handed out
+        auto isEnded() -> bool;
 
         sigslot::signal<NotifyResult> notifyStop;
         
@@ -65,9 +72,16 @@ private:
                     int32_t m_rep_count;
                     int64_t m_memoryCacheSize;
          CReaderController *m_readerController;
+DataLib::CDACBufferPool::Ptr m_pool;
+         CDACSequencer::Ptr m_sequencer;
+                std::thread m_readerThread;
+           std::atomic_bool m_readerRun;
+               NotifyResult m_endReason;
+                       bool m_endNotified;
 
         auto startServer() -> void;
         auto stopServer() -> void;
+        auto readerWorker() -> void;
 };
 
 }
@@ -13,6 +13,8 @@ CDataBuffersPack::CDataBuffersPack():
      m_buffers()
     ,m_oscRate(0)
     ,m_adc_bits(0)
+    ,m_sampleIndex(0)
+    ,m_eventId(0)
 {
 }
 
@@ -50,6 +52,22 @@ auto CDataBuffersPack::getADCBits() -> uint8_t{
     return m_adc_bits;
 }
 
+auto CDataBuffersPack::setSampleIndex(uint64_t index) -> void{
+    m_sampleIndex = index;
+}
+
+auto CDataBuffersPack::getSampleIndex() -> uint64_t{
+    return m_sampleIndex;
+}
+
+auto CDataBuffersPack::setEventId(uint64_t id) -> void{
+    m_eventId = id;
+}
+
+auto CDataBuffersPack::getEventId() -> uint64_t{
+    return m_eventId;
+}
+
 auto CDataBuffersPack::checkBuffersEqual() -> bool{
     size_t size = 0;
     uint8_t bits = 0;
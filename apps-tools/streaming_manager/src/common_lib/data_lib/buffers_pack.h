@@ -33,6 +33,12 @@ public:
     auto getOSCRate() -> uint64_t;
     auto setADCBits(uint8_t bits) -> void;
     auto getADCBits() -> uint8_t;
+    // Index of the first sample since the start of the acquisition
+    auto setSampleIndex(uint64_t index) -> void;
+    auto getSampleIndex() -> uint64_t;
+    // Event window the pack belongs to, 0 in continuous mode
+    auto setEventId(uint64_t id) -> void;
+    auto getEventId() -> uint64_t;
 
     auto checkBuffersEqual() -> bool;
     auto getBuffersLenght() -> size_t;
@@ -51,6 +57,8 @@ private:
     std::map<EDataBuffersPackChannel,CDataBuffer::Ptr> m_buffers;
     uint64_t m_oscRate; // Decimation
     uint8_t  m_adc_bits;
+    uint64_t m_sampleIndex;
+    uint64_t m_eventId;
 };
 
 }
@@ -0,0 +1,153 @@
+#include <chrono>
+#include "dac_buffer_pool.h"
+
+using namespace DataLib;
+
+auto CDACBufferPool::Create(size_t count,size_t blockSize) -> CDACBufferPool::Ptr{
+    return std::make_shared<CDACBufferPool>(count,blockSize);
+}
+
+CDACBufferPool::CDACBufferPool(size_t count,size_t blockSize):
+    m_blockSize(blockSize),
+    m_memory(count * blockSize * 2),
+    m_blocks(count),
+    m_free(),
+    m_filled(count,nullptr),
+    m_filledHead(0),
+    m_filledCount(0),
+    m_end(false),
+    m_stop(false),
+    m_mutex(),
+    m_freeCond(),
+    m_filledCond()
+{
+    m_free.reserve(count);
+    for(size_t i = 0; i < count; i++){
+        m_blocks[i].ch1 = m_memory.data() + i * blockSize * 2;
+        m_blocks[i].ch2 = m_blocks[i].ch1 + blockSize;
+        m_free.push_back(&m_blocks[i]);
+    }
+}
+
+CDACBufferPool::~CDACBufferPool(){
+    stop();
+}
+
+auto CDACBufferPool::getBlockSize() const -> size_t{
+    return m_blockSize;
+}
+
+auto CDACBufferPool::getCount() const -> size_t{
+    return m_blocks.size();
+}
+
+auto CDACBufferPool::getFilledCount() -> size_t{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_filledCount;
+}
+
+auto CDACBufferPool::getFreeCount() -> size_t{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_free.size();
+}
+
+auto CDACBufferPool::waitFor(std::unique_lock<std::mutex> &lock,int64_t timeout_us,bool free) -> bool{
+    auto &cond = free ? m_freeCond : m_filledCond;
+    auto ready = [&]{
+        return m_stop || (free ? !m_free.empty() : (m_filledCount > 0 || m_end));
+    };
+    if (timeout_us < 0){
+        cond.wait(lock,ready);
+        return true;
+    }
+    return cond.wait_for(lock,std::chrono::microseconds(timeout_us),ready);
+}
+
+auto CDACBufferPool::acquire(int64_t timeout_us) -> Block*{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!waitFor(lock,timeout_us,true) || m_stop){
+        return nullptr;
+    }
+    auto block = m_free.back();
+    m_free.pop_back();
+    block->size_ch1 = 0;
+    block->size_ch2 = 0;
+    return block;
+}
+
+auto CDACBufferPool::submit(Block *block) -> void{
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_filled[(m_filledHead + m_filledCount) % m_filled.size()] = block;
+        m_filledCount++;
+    }
+    m_filledCond.notify_one();
+}
+
+auto CDACBufferPool::cancel(Block *block) -> void{
+    release(block);
+}
+
+auto CDACBufferPool::next(int64_t timeout_us) -> Block*{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!waitFor(lock,timeout_us,false) || m_stop || m_filledCount == 0){
+        return nullptr;
+    }
+    auto block = m_filled[m_filledHead];
+    m_filledHead = (m_filledHead + 1) % m_filled.size();
+    m_filledCount--;
+    return block;
+}
+
+auto CDACBufferPool::release(Block *block) -> void{
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(block);
+    }
+    m_freeCond.notify_one();
+    releaseNotify();
+}
+
+auto CDACBufferPool::setEnd() -> void{
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_end = true;
+    }
+    m_filledCond.notify_all();
+}
+
+auto CDACBufferPool::clearEnd() -> void{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_end = false;
+}
+
+auto CDACBufferPool::isEnded() -> bool{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_end && m_filledCount == 0;
+}
+
+auto CDACBufferPool::stop() -> void{
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_freeCond.notify_all();
+    m_filledCond.notify_all();
+}
+
+auto CDACBufferPool::isStopped() -> bool{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stop;
+}
+
+auto CDACBufferPool::reset() -> void{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.clear();
+    for(auto &b : m_blocks){
+        m_free.push_back(&b);
+    }
+    m_filledHead = 0;
+    m_filledCount = 0;
+    m_end = false;
+    m_stop = false;
+}
@@ -0,0 +1,88 @@
+#ifndef DATA_LIB_DAC_BUFFER_POOL_H
+#define DATA_LIB_DAC_BUFFER_POOL_H
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <condition_variable>
+#include "data_lib/signal.hpp"
+
+namespace DataLib {
+
+// Fixed set of DAC blocks allocated once. Producers (network controller, file reader)
+// take a free block, fill it and submit it; the generator worker takes filled blocks
+// in order and releases them after they were written to the DMA buffer.
+// Nothing is allocated after construction.
+
+class CDACBufferPool final{
+
+public:
+
+    struct Block{
+        uint8_t *ch1 = nullptr;
+        uint8_t *ch2 = nullptr;
+        size_t   size_ch1 = 0;
+        size_t   size_ch2 = 0;
+        uint64_t index = 0;
+    };
+
+    using Ptr = std::shared_ptr<DataLib::CDACBufferPool>;
+
+    static auto Create(size_t count,size_t blockSize) -> CDACBufferPool::Ptr;
+
+    CDACBufferPool(size_t count,size_t blockSize);
+    ~CDACBufferPool();
+
+    auto getBlockSize() const -> size_t;
+    auto getCount() const -> size_t;
+    auto getFilledCount() -> size_t;
+    auto getFreeCount() -> size_t;
+
+    // timeout_us < 0 waits until a block is available or the pool is stopped
+    auto acquire(int64_t timeout_us) -> Block*;
+    auto submit(Block *block) -> void;
+    auto cancel(Block *block) -> void;
+
+    auto next(int64_t timeout_us) -> Block*;
+    auto release(Block *block) -> void;
+
+    // Producer will not submit more blocks, next() returns nullptr once the pool is drained
+    auto setEnd() -> void;
+    // The producer submits blocks again after setEnd()
+    auto clearEnd() -> void;
+    auto isEnded() -> bool;
+
+    auto stop() -> void;
+    auto isStopped() -> bool;
+    auto reset() -> void;
+
+    // Emitted outside the lock every time a block is returned to the free list
+    sigslot::signal<> releaseNotify;
+
+private:
+
+    CDACBufferPool(const CDACBufferPool &) = delete;
+    CDACBufferPool(CDACBufferPool &&) = delete;
+    CDACBufferPool& operator=(const CDACBufferPool&) =delete;
+    CDACBufferPool& operator=(const CDACBufferPool&&) =delete;
+
+    auto waitFor(std::unique_lock<std::mutex> &lock,int64_t timeout_us,bool free) -> bool;
+
+    size_t                  m_blockSize;
+    std::vector<uint8_t>    m_memory;
+    std::vector<Block>      m_blocks;
+    std::vector<Block*>     m_free;
+    std::vector<Block*>     m_filled;   // ring, m_filledHead is the oldest block
+    size_t                  m_filledHead;
+    size_t                  m_filledCount;
+    bool                    m_end;
+    bool                    m_stop;
+    std::mutex              m_mutex;
+    std::condition_variable m_freeCond;
+    std::condition_variable m_filledCond;
+};
+
+}
+
+#endif
@@ -13,12 +13,15 @@ auto CFileLogger::create(std::string _filePath,bool testMode) -> CFileLogger::Pt
 CFileLogger::CFileLogger(std::string _filePath,bool testMode):
 m_filePath(_filePath),
 m_filePathLost(_filePath + ".lost"),
+m_filePathEvents(_filePath + ".events"),
 m_file_open(false),
 m_oscRate(0),
 m_udpLostRate(0),
 m_fileSystemLostRate(0),
 m_reciveData(0),
 m_out_of_memory(0),
+m_lastEventId(0),
+m_events(0),
 m_testMode(testMode),
 m_channels(),
 m_current_sample()
@@ -100,6 +103,26 @@ auto CFileLogger::addMetric(DataLib::CDataBuffersPack::Ptr pack) -> void {
     }
 }
 
+auto CFileLogger::addEvent(DataLib::CDataBuffersPack::Ptr pack) -> void {
+    const std::lock_guard<std::mutex> lock(m_mtx);
+    auto id = pack->getEventId();
+    if (id == 0 || id == m_lastEventId || !m_file_open || m_testMode) return;
+    m_lastEventId = id;
+    if (!m_fileEvents.is_open()){
+        m_fileEvents.open(m_filePathEvents , std::ios_base::app | std::ios_base::out);
+        if (!m_fileEvents.is_open()) return;
+        m_fileEvents << "event,sample_index,file_sample\n";
+    }
+    for(auto i = (int)DataLib::CH1; i < (int)DataLib::CH4; i++){
+        DataLib::EDataBuffersPackChannel ch = (DataLib::EDataBuffersPackChannel)i;
+        if (pack->getBuffer(ch)){
+            m_fileEvents << id << "," << pack->getSampleIndex() << "," << m_current_sample[ch] << "\n";
+            m_events++;
+            break;
+        }
+    }
+}
+
 auto CFileLogger::addMetric(DataLib::EDataBuffersPackChannel channel,uint64_t _value,uint64_t _lostFPGA,uint32_t _lostBUFFER,uint64_t _samples) -> void{
     const std::lock_guard<std::mutex> lock(m_mtx);
     if (m_channels.find(channel) != m_channels.end()){
@@ -126,6 +149,9 @@ void CFileLogger::dumpToFile(){
         if (m_fileLost.is_open()){
             m_fileLost.close();
         }
+        if (m_fileEvents.is_open()){
+            m_fileEvents.close();
+        }
 
         std::ofstream log(m_filePath , std::ios_base::app | std::ios_base::out);
 
@@ -143,6 +169,9 @@ void CFileLogger::dumpToFile(){
         log << "Lost data during transfer by UDP network:\t" << m_udpLostRate << "\n";
         log << "Lost data due to file write buffer overflow:\t" << m_fileSystemLostRate << "\n";
         log << "Loss of data due to lack of memory:\t" << m_out_of_memory << "\n";
+        if (m_events){
+            log << "Recorded events:\t" << m_events << "\n";
+        }
         log << "\n";
         log << "Total amount of data transferred:\n";
         log << "\t-" << m_reciveData << "b \n";
@@ -28,6 +28,8 @@ public:
     auto addMetric(CFileLogger::EMetric _metric, uint64_t _value) -> void;
     auto addMetric(DataLib::CDataBuffersPack::Ptr pack) -> void;
     auto addMetric(DataLib::EDataBuffersPackChannel channel,uint64_t _value,uint64_t _lostFPGA,uint32_t _lostBUFFER,uint64_t _samples) -> void;
+    // Writes the start of a new event window, must be called before addMetric(pack)
+    auto addEvent(DataLib::CDataBuffersPack::Ptr pack) -> void;
 
     auto dumpToFile() -> void;
 
@@ -52,6 +54,7 @@ private:
 
     std::string m_filePath;
     std::string m_filePathLost;
+    std::string m_filePathEvents;
     std::mutex  m_mtx;
     bool        m_file_open;
     uint64_t    m_oscRate;
@@ -60,6 +63,9 @@ private:
     uint64_t    m_reciveData;
     uint64_t    m_out_of_memory;
     std::ofstream m_fileLost;
+    std::ofstream m_fileEvents;
+    uint64_t    m_lastEventId;
+    uint64_t    m_events;
     bool        m_testMode;
     std::map<DataLib::EDataBuffersPackChannel,ChStat> m_channels;
     std::map<DataLib::EDataBuffersPackChannel,uint64_t> m_current_sample;
@@ -43,8 +43,10 @@ auto createBeginPack(uint64_t _id,DataLib::CDataBuffersPack::Ptr pack) -> AsioBu
         uint64_t oscRate = pack->getOSCRate();
         uint64_t adcBits = pack->getADCBits();
         uint64_t buffersSize = pack->getLenghtAllBuffers();
+        uint64_t sampleIndex = pack->getSampleIndex();
+        uint64_t eventId = pack->getEventId();
 
-        buffer_lenght += sizeof(uint64_t) * 5;
+        buffer_lenght += sizeof(uint64_t) * 7;
         // auto buff = std::shared_ptr<uint8_t[]>(new uint8_t[buffer_lenght]);
         // memcpy_neon(buff.get() ,net_lib::ID_PACK,16);
         memcpy_neon(bh.header,net_lib::ID_PACK,16);
@@ -53,7 +55,9 @@ auto createBeginPack(uint64_t _id,DataLib::CDataBuffersPack::Ptr pack) -> AsioBu
         buff64[3] = packId;
         buff64[4] = oscRate;
         buff64[5] = adcBits;
-        buff64[6] = buffersSize;          
+        buff64[6] = buffersSize;
+        buff64[7] = sampleIndex;
+        buff64[8] = eventId;
         bh.headerLen = buffer_lenght;
         return bh;
     } catch (const std::bad_alloc& e) {
@@ -85,6 +89,11 @@ auto net_lib::extractBeginPack(uint8_t* _buffer,size_t _length,uint64_t *_id,siz
     auto pack = DataLib::CDataBuffersPack::Create();
     pack->setADCBits(adcBits);
     pack->setOSCRate(oscRate);
+    // Older servers send the pack without the sample index and the event id
+    if (buff_size >= sizeof(int8_t) * 16 + sizeof(uint64_t) * 7){
+        pack->setSampleIndex(buff64[7]);
+        pack->setEventId(buff64[8]);
+    }
 
     *_id = packId;
     *_allBuffersSize = buffersSize;
@@ -19,6 +19,10 @@ CAsioService::CAsioService():
 }
 
 CAsioService::~CAsioService(){
+    stop();
+}
+
+auto CAsioService::stop() -> void{
     m_Ios.reset();
     m_Ios.stop();
     if (m_asio_th){
@@ -15,6 +15,8 @@ public:
 
 //    static auto instance() -> CAsioService*;
     auto getIO() -> asio::io_service&;
+    // Stops the io thread, the io objects of the owner can then be destroyed before the service
+    auto stop() -> void;
 
     CAsioService();
     ~CAsioService();
@@ -29,7 +29,9 @@ CAsioSocketSimple::CAsioSocketSimple(std::string host, std::string port) :
 CAsioSocketSimple::~CAsioSocketSimple() {
     m_disableRestartServer = true;
     closeSocket();
-    delete m_asio;
+    m_asio->stop();
+    m_tcp_acceptor = nullptr;
+    m_tcp_socket = nullptr;
     delete[] m_SocketReadBuffer;
 }
 
@@ -58,8 +60,8 @@ auto CAsioSocketSimple::initClient() -> void {
     asio::ip::tcp::resolver::query query(m_host, m_port);
     asio::ip::tcp::resolver::iterator iter = resolver.resolve(query);
     m_tcp_endpoint = *iter;
-    m_tcp_socket->async_connect(m_tcp_endpoint, std::bind(&CAsioSocketSimple::handlerConnect, this, std::placeholders::_1 , iter));
     m_mode = EMode::M_CLIENT;
+    // Armed before the connect, a fast connect cancels it from the io thread
     m_timoutTimer.expires_after(std::chrono::seconds(CONNECT_TIMEOUT));
     m_timoutTimer.async_wait([this](std::error_code er){
         if (er.value() != asio::error::operation_aborted) {
@@ -72,6 +74,7 @@ auto CAsioSocketSimple::initClient() -> void {
             connectTimeoutNotify(er);
         }
     });
+    m_tcp_socket->async_connect(m_tcp_endpoint, std::bind(&CAsioSocketSimple::handlerConnect, this, std::placeholders::_1 , iter));
 }
 
 auto CAsioSocketSimple::handlerConnect(const asio::error_code &_error, asio::ip::tcp::resolver::iterator endpoint_iterator) -> void {
@@ -184,36 +187,62 @@ auto CAsioSocketSimple::handlerAccept(const asio::error_code &_error) -> void {
 }
 
 auto CAsioSocketSimple::sendBuffer(bool async, net_buffer _buffer, size_t _size) -> bool{
+    if (async) {
+        // Queued on the io thread, so senders from other threads never start a write
+        // on the socket concurrently and do not need the socket lock
+        asio::post(m_asio->getIO(),[this,_buffer,_size](){
+            m_sendQueue.emplace_back(_buffer,_size);
+            if (m_sendQueue.size() == 1){
+                sendNext();
+            }
+        });
+        return true;
+    }
     std::lock_guard<std::mutex> lock(m_mtx);
     asio::error_code _error;
     if (m_tcp_socket && m_tcp_socket->is_open()) {
-        if (!async) {
-            size_t offset = 0;
-            while(offset < _size){
-                size_t send_size = m_tcp_socket->send(asio::buffer((uint8_t*)(&(*_buffer.get())+offset), _size-offset), 0, _error);
-                if (_error.value() != 0){
-                    return false;
-                }
-                offset += send_size;
+        size_t offset = 0;
+        while(offset < _size){
+            size_t send_size = m_tcp_socket->send(asio::buffer((uint8_t*)(&(*_buffer.get())+offset), _size-offset), 0, _error);
+            if (_error.value() != 0){
+                return false;
             }
-            this->handlerSend(_error,offset);
-        }else {            
-            m_sendbufersSSId++;
-            m_sendbuffersSS[m_sendbufersSSId] = _buffer;
-            m_tcp_socket->async_send(asio::buffer(_buffer.get(),_size),
-                                        std::bind(&CAsioSocketSimple::handlerSend2, this, std::placeholders::_1 ,std::placeholders::_2,m_sendbufersSSId));
+            offset += send_size;
         }
+        this->handlerSend(_error,offset);
         return  true;
     }
     return false;
 }
 
-auto CAsioSocketSimple::handlerSend2(const asio::error_code &_error, size_t _bytesTransferred, uint64_t bufferId) -> void{
+auto CAsioSocketSimple::sendNext() -> void{
+    std::shared_ptr<asio::ip::tcp::socket> socket;
     {
         std::lock_guard<std::mutex> lock(m_mtx);
-        m_sendbuffersSS.erase(bufferId);
+        socket = m_tcp_socket;
+    }
+    if (!socket || !socket->is_open()){
+        m_sendQueue.clear();
+        return;
+    }
+    auto &front = m_sendQueue.front();
+    // async_write completes only when the whole buffer is sent, the socket is kept alive until then
+    asio::async_write(*socket,asio::buffer(front.first.get(),front.second),
+                      [this,socket](const asio::error_code &_error, size_t _bytesTransferred){
+                          handlerSendQueued(_error,_bytesTransferred);
+                      });
+}
+
+auto CAsioSocketSimple::handlerSendQueued(const asio::error_code &_error, size_t _bytesTransferred) -> void{
+    if (_error){
+        m_sendQueue.clear();
+    }else{
+        m_sendQueue.pop_front();
     }
     handlerSend(_error,_bytesTransferred);
+    if (!m_sendQueue.empty()){
+        sendNext();
+    }
 }
 
 auto CAsioSocketSimple::handlerSend(const asio::error_code &_error, size_t _bytesTransferred) -> void{
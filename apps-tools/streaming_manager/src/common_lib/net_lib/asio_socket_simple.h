@@ -58,7 +58,8 @@ private:
     auto handlerAccept(const asio::error_code &_error) -> void;
     auto handlerConnect(const asio::error_code &_error, asio::ip::tcp::resolver::iterator endpoint_iterator) -> void;
     auto handlerSend(const asio::error_code &_error, size_t _bytesTransferred) -> void;
-    auto handlerSend2(const asio::error_code &_error, size_t _bytesTransferred, uint64_t bufferId) -> void;
+    auto handlerSendQueued(const asio::error_code &_error, size_t _bytesTransferred) -> void;
+    auto sendNext() -> void;
     auto handlerReceiveFromServer(const asio::error_code &ErrorCode, size_t bytes_transferred) -> void;
 
     net_lib::EMode m_mode;
@@ -68,14 +69,14 @@ private:
     std::shared_ptr<asio::ip::tcp::socket> m_tcp_socket;
     std::shared_ptr<asio::ip::tcp::acceptor> m_tcp_acceptor;
     asio::ip::tcp::endpoint m_tcp_endpoint;
-    CAsioService *m_asio;
+    std::unique_ptr<CAsioService> m_asio; // destroyed after the timer and the send queue
     asio::steady_timer  m_timoutTimer;
     uint8_t *m_SocketReadBuffer;
     bool m_disableRestartServer;
     std::mutex m_mtx;
 
-    uint64_t m_sendbufersSSId = 0;
-    std::map<uint64_t,net_buffer> m_sendbuffersSS;
+    // Asynchronous sends, only touched from the io thread. One write is in flight at a time.
+    std::deque<std::pair<net_buffer,size_t>> m_sendQueue;
 
 };
 
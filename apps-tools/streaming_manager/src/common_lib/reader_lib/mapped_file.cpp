@@ -0,0 +1,162 @@
+#define _FILE_OFFSET_BITS 64
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mapped_file.h"
+
+#define MAPPED_WINDOW_SIZE (16 * 1024 * 1024)
+
+CMappedFile::CMappedFile():
+#ifdef _WIN32
+    m_file(INVALID_HANDLE_VALUE),
+    m_mapping(NULL),
+#else
+    m_fd(-1),
+#endif
+    m_size(0),
+    m_granularity(4096),
+    m_window(nullptr),
+    m_windowOffset(0),
+    m_windowSize(0)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    m_granularity = info.dwAllocationGranularity;
+#else
+    m_granularity = sysconf(_SC_PAGE_SIZE);
+#endif
+}
+
+CMappedFile::~CMappedFile(){
+    close();
+}
+
+auto CMappedFile::getMaxView() -> size_t{
+    // The window start is aligned down, the view has to fit behind the alignment gap
+    return MAPPED_WINDOW_SIZE / 2;
+}
+
+auto CMappedFile::open(const std::string &path) -> bool{
+    close();
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+    if (m_file == INVALID_HANDLE_VALUE){
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file,&size)){
+        close();
+        return false;
+    }
+    m_size = size.QuadPart;
+    if (m_size){
+        m_mapping = CreateFileMappingA(m_file,NULL,PAGE_READONLY,0,0,NULL);
+        if (m_mapping == NULL){
+            close();
+            return false;
+        }
+    }
+#else
+    m_fd = ::open(path.c_str(),O_RDONLY);
+    if (m_fd < 0){
+        return false;
+    }
+    struct stat st;
+    if (fstat(m_fd,&st) != 0){
+        close();
+        return false;
+    }
+    m_size = st.st_size;
+#endif
+    return true;
+}
+
+auto CMappedFile::close() -> void{
+    unmap();
+#ifdef _WIN32
+    if (m_mapping != NULL){
+        CloseHandle(m_mapping);
+        m_mapping = NULL;
+    }
+    if (m_file != INVALID_HANDLE_VALUE){
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_fd >= 0){
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    m_size = 0;
+}
+
+auto CMappedFile::isOpen() const -> bool{
+#ifdef _WIN32
+    return m_file != INVALID_HANDLE_VALUE;
+#else
+    return m_fd >= 0;
+#endif
+}
+
+auto CMappedFile::getSize() const -> uint64_t{
+    return m_size;
+}
+
+auto CMappedFile::unmap() -> void{
+    if (m_window){
+#ifdef _WIN32
+        UnmapViewOfFile(m_window);
+#else
+        munmap(m_window,m_windowSize);
+#endif
+        m_window = nullptr;
+    }
+    m_windowOffset = 0;
+    m_windowSize = 0;
+}
+
+auto CMappedFile::view(uint64_t offset,size_t size) -> const uint8_t*{
+    if (!isOpen() || size > getMaxView() || offset + size > m_size){
+        return nullptr;
+    }
+    if (m_window && offset >= m_windowOffset && offset + size <= m_windowOffset + m_windowSize){
+        return m_window + (offset - m_windowOffset);
+    }
+    unmap();
+    uint64_t start = offset - offset % m_granularity;
+    size_t mapSize = m_size - start < MAPPED_WINDOW_SIZE ? m_size - start : MAPPED_WINDOW_SIZE;
+#ifdef _WIN32
+    auto ptr = MapViewOfFile(m_mapping,FILE_MAP_READ,(DWORD)(start >> 32),(DWORD)(start & 0xFFFFFFFF),mapSize);
+    if (ptr == NULL){
+        return nullptr;
+    }
+#else
+    auto ptr = mmap(nullptr,mapSize,PROT_READ,MAP_SHARED,m_fd,start);
+    if (ptr == MAP_FAILED){
+        return nullptr;
+    }
+    madvise(ptr,mapSize,MADV_SEQUENTIAL);
+#endif
+    m_window = (uint8_t*)ptr;
+    m_windowOffset = start;
+    m_windowSize = mapSize;
+    return m_window + (offset - m_windowOffset);
+}
+
+auto CMappedFile::willNeed(uint64_t offset,size_t size) -> void{
+#ifndef _WIN32
+    if (isOpen() && offset < m_size){
+        posix_fadvise(m_fd,offset,size,POSIX_FADV_WILLNEED);
+    }
+#else
+    (void)offset;
+    (void)size;
+#endif
+}
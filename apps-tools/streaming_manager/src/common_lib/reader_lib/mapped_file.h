@@ -0,0 +1,57 @@
+#ifndef READER_LIB_MAPPED_FILE_H
+#define READER_LIB_MAPPED_FILE_H
+
+#include <stdint.h>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/**
+ * Read only access to a file through a sliding memory map.
+ * 32 bit targets can not map multi-GB files at once, so only a window
+ * around the requested range is mapped. A pointer returned by view()
+ * is valid until the next call of view().
+ */
+
+class CMappedFile
+{
+    public:
+
+        CMappedFile();
+        ~CMappedFile();
+
+        auto open(const std::string &path) -> bool;
+        auto close() -> void;
+        auto isOpen() const -> bool;
+        auto getSize() const -> uint64_t;
+
+        // size must not exceed getMaxView()
+        auto view(uint64_t offset,size_t size) -> const uint8_t*;
+        static auto getMaxView() -> size_t;
+
+        // Asks the kernel to start reading the range into the page cache
+        auto willNeed(uint64_t offset,size_t size) -> void;
+
+    private:
+
+        CMappedFile(CMappedFile const&) = delete;
+        CMappedFile& operator=(CMappedFile const&) = delete;
+
+        auto unmap() -> void;
+
+#ifdef _WIN32
+        HANDLE   m_file;
+        HANDLE   m_mapping;
+#else
+        int      m_fd;
+#endif
+        uint64_t m_size;
+        uint64_t m_granularity;
+        uint8_t *m_window;
+        uint64_t m_windowOffset;
+        size_t   m_windowSize;
+};
+
+#endif
@@ -0,0 +1,491 @@
+#include <cstring>
+#include <map>
+#include "mapped_reader.h"
+#include "data_lib/neon_asm.h"
+#include "tdms_lib/data_type.h"
+
+#define READ_AHEAD_MS        100
+#define HALF_BLOCKS_DEFAULT  4
+#define HALF_BLOCKS_MIN      2
+#define HALF_BLOCKS_MAX      64
+
+#define TDMS_LEAD_IN_SIZE    28
+#define TDMS_TOC_META_DATA   (1 << 1)
+#define TDMS_TOC_NEW_OBJ_LIST (1 << 2)
+#define TDMS_TOC_RAW_DATA    (1 << 3)
+#define TDMS_TOC_INTERLEAVED (1 << 5)
+#define TDMS_TOC_BIG_ENDIAN  (1 << 6)
+#define TDMS_TOC_DAQMX       (1 << 7)
+#define TDMS_NO_RAW_DATA     0xFFFFFFFF
+#define TDMS_SAME_RAW_INDEX  0x00000000
+
+static const char *g_channelPath[2] = {"/'Group'/'ch1'","/'Group'/'ch2'"};
+
+template<typename T>
+static auto readValue(const uint8_t *buffer,size_t size,size_t &pos,T &value) -> bool{
+    if (pos + sizeof(T) > size) return false;
+    memcpy(&value,buffer + pos,sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+static auto readString(const uint8_t *buffer,size_t size,size_t &pos,std::string &value) -> bool{
+    uint32_t len = 0;
+    if (!readValue(buffer,size,pos,len) || pos + len > size) return false;
+    value.assign((const char*)buffer + pos,len);
+    pos += len;
+    return true;
+}
+
+CMappedReader::CMappedReader(CStreamSettings::DataFormat _fileType, std::string _filePath,CStreamSettings::DACRepeat _repeat,int32_t _rep_count,size_t _blockSize):
+    m_fileType(_fileType),
+    m_filePath(_filePath),
+    m_repeat(_repeat),
+    m_rep_count(_rep_count),
+    m_blockSize(_blockSize),
+    m_file(),
+    m_runs(),
+    m_samples{0,0},
+    m_present{false,false},
+    m_total(0),
+    m_cursor(),
+    m_passPos(0),
+    m_passesLeft(1),
+    m_halfBlocks(HALF_BLOCKS_DEFAULT),
+    m_half(),
+    m_readHalf(0),
+    m_thread(),
+    m_run(false),
+    m_mutex(),
+    m_cond()
+{
+}
+
+CMappedReader::~CMappedReader(){
+    stop();
+    m_file.close();
+}
+
+auto CMappedReader::open() -> IndexResult{
+    stop();
+    m_runs[0].clear();
+    m_runs[1].clear();
+    m_samples[0] = m_samples[1] = 0;
+    m_present[0] = m_present[1] = false;
+    m_total = 0;
+    if (!m_file.open(m_filePath)){
+        return IR_UNSUPPORTED;
+    }
+    IndexResult res = IR_UNSUPPORTED;
+    if (m_fileType == CStreamSettings::DataFormat::WAV){
+        res = indexWav();
+    }
+    if (m_fileType == CStreamSettings::DataFormat::TDMS){
+        res = indexTdms();
+    }
+    if (res != IR_OK){
+        m_file.close();
+        return res;
+    }
+    m_total = std::max(m_samples[0],m_samples[1]);
+    return IR_OK;
+}
+
+auto CMappedReader::isChannelPresent(int ch) -> bool{
+    return ch >= 0 && ch < 2 && m_present[ch];
+}
+
+auto CMappedReader::getChannelSize(int ch) -> uint64_t{
+    return isChannelPresent(ch) ? m_samples[ch] * 2 : 0;
+}
+
+auto CMappedReader::setSampleRate(uint64_t samplesPerSec) -> void{
+    uint64_t bytes = samplesPerSec * 2 * READ_AHEAD_MS / 1000;
+    uint64_t blocks = (bytes + m_blockSize - 1) / m_blockSize;
+    m_halfBlocks = std::min<uint64_t>(std::max<uint64_t>(blocks,HALF_BLOCKS_MIN),HALF_BLOCKS_MAX);
+}
+
+auto CMappedReader::indexWav() -> IndexResult{
+    auto size = m_file.getSize();
+    auto head = m_file.view(0,12);
+    if (!head || memcmp(head,"RIFF",4) != 0 || memcmp(head + 8,"WAVE",4) != 0){
+        return IR_UNSUPPORTED;
+    }
+    uint16_t format = 0;
+    uint16_t channels = 0;
+    uint16_t bits = 0;
+    bool     fmtFound = false;
+    uint64_t dataOffset = 0;
+    uint64_t dataSize = 0;
+    uint64_t pos = 12;
+    while(pos + 8 <= size){
+        auto chunk = m_file.view(pos,8);
+        if (!chunk) return IR_UNSUPPORTED;
+        uint32_t chunkSize = 0;
+        memcpy(&chunkSize,chunk + 4,4);
+        if (memcmp(chunk,"fmt ",4) == 0){
+            auto fmt = m_file.view(pos + 8,16);
+            if (!fmt) return IR_UNSUPPORTED;
+            memcpy(&format,fmt,2);
+            memcpy(&channels,fmt + 2,2);
+            memcpy(&bits,fmt + 14,2);
+            fmtFound = true;
+        }
+        if (memcmp(chunk,"data",4) == 0){
+            dataOffset = pos + 8;
+            // The size stays 0 or wrong if the writer did not finish the file
+            dataSize = (chunkSize == 0 || dataOffset + chunkSize > size) ? size - dataOffset : chunkSize;
+            break;
+        }
+        pos += 8 + (uint64_t)chunkSize + (chunkSize & 1);
+    }
+    if (!fmtFound || dataOffset == 0 || format != 1){
+        return IR_UNSUPPORTED;
+    }
+    if (bits != 16) return IR_WRONG_DATA_TYPE;
+    if (channels != 1 && channels != 2) return IR_MISSING_CHANNELS;
+    if (channels == 2 && dataSize % 4) return IR_DATA_NOT_EQUAL;
+    if (channels == 1 && dataSize % 2) return IR_WRONG_DATA_TYPE;
+
+    uint32_t stride = channels * 2;
+    for(int ch = 0; ch < channels; ch++){
+        Run run;
+        run.offset = dataOffset + ch * 2;
+        run.samples = dataSize / stride;
+        run.stride = stride;
+        m_runs[ch].push_back(run);
+        m_samples[ch] = run.samples;
+        m_present[ch] = true;
+    }
+    return IR_OK;
+}
+
+auto CMappedReader::indexTdms() -> IndexResult{
+    struct Object{
+        std::string     path;
+        TDMS::TDMSType  type = TDMS::TDMSType::Empty;
+        uint64_t        size = 0;
+        bool            raw = false;
+    };
+
+    auto size = m_file.getSize();
+    std::map<std::string,Object> prevIndex;
+    std::vector<Object> objects;
+    bool wrongType = false;
+    uint64_t pos = 0;
+
+    while(pos + TDMS_LEAD_IN_SIZE <= size){
+        auto lead = m_file.view(pos,TDMS_LEAD_IN_SIZE);
+        if (!lead || memcmp(lead,"TDSm",4) != 0){
+            if (pos == 0) return IR_UNSUPPORTED;
+            break;
+        }
+        uint32_t toc = 0;
+        int64_t  next = 0;
+        int64_t  rawOffset = 0;
+        memcpy(&toc,lead + 4,4);
+        memcpy(&next,lead + 12,8);
+        memcpy(&rawOffset,lead + 20,8);
+        if (toc & (TDMS_TOC_INTERLEAVED | TDMS_TOC_BIG_ENDIAN | TDMS_TOC_DAQMX)){
+            return IR_UNSUPPORTED;
+        }
+        uint64_t metaStart = pos + TDMS_LEAD_IN_SIZE;
+        uint64_t rawStart = metaStart + rawOffset;
+        // A segment which was not closed by the writer lasts to the end of file
+        uint64_t segEnd = (next < 0 || metaStart + next > size) ? size : metaStart + next;
+        if (rawStart > segEnd) break;
+
+        if (toc & TDMS_TOC_META_DATA){
+            if (rawStart - metaStart > CMappedFile::getMaxView()) return IR_UNSUPPORTED;
+            size_t metaSize = rawStart - metaStart;
+            auto meta = m_file.view(metaStart,metaSize);
+            if (!meta) return IR_UNSUPPORTED;
+            size_t p = 0;
+            uint32_t count = 0;
+            if (!readValue(meta,metaSize,p,count)) return IR_UNSUPPORTED;
+            // Without kTocNewObjList the list only updates the previous one. The index
+            // supports that only when every previous object is listed again in order,
+            // which is what the TDMS writer of the servers produces.
+            auto previous = std::move(objects);
+            bool incremental = !(toc & TDMS_TOC_NEW_OBJ_LIST) && !previous.empty();
+            if (incremental && count < previous.size()) return IR_UNSUPPORTED;
+            objects.clear();
+            for(uint32_t i = 0; i < count; i++){
+                Object obj;
+                uint32_t indexLen = 0;
+                if (!readString(meta,metaSize,p,obj.path) || !readValue(meta,metaSize,p,indexLen)) return IR_UNSUPPORTED;
+                if (indexLen == TDMS_SAME_RAW_INDEX){
+                    auto prev = prevIndex.find(obj.path);
+                    if (prev != prevIndex.end()) obj = prev->second;
+                }else if (indexLen != TDMS_NO_RAW_DATA){
+                    uint32_t type = 0;
+                    uint32_t dimension = 0;
+                    uint64_t values = 0;
+                    if (!readValue(meta,metaSize,p,type) || !readValue(meta,metaSize,p,dimension) || !readValue(meta,metaSize,p,values)) return IR_UNSUPPORTED;
+                    obj.type = (TDMS::TDMSType)type;
+                    obj.raw = true;
+                    if (indexLen == 28){
+                        if (!readValue(meta,metaSize,p,obj.size)) return IR_UNSUPPORTED;
+                    }else{
+                        obj.size = TDMS::DataType::GetArrayLength(obj.type,values);
+                    }
+                    prevIndex[obj.path] = obj;
+                }
+                uint32_t props = 0;
+                if (!readValue(meta,metaSize,p,props)) return IR_UNSUPPORTED;
+                for(uint32_t j = 0; j < props; j++){
+                    std::string name;
+                    uint32_t type = 0;
+                    if (!readString(meta,metaSize,p,name) || !readValue(meta,metaSize,p,type)) return IR_UNSUPPORTED;
+                    if ((TDMS::TDMSType)type == TDMS::TDMSType::String){
+                        std::string value;
+                        if (!readString(meta,metaSize,p,value)) return IR_UNSUPPORTED;
+                    }else{
+                        auto len = TDMS::DataType::GetLength((TDMS::TDMSType)type);
+                        if (len == 0 || p + len > metaSize) return IR_UNSUPPORTED;
+                        p += len;
+                    }
+                }
+                for(int ch = 0; ch < 2; ch++){
+                    if (obj.path == g_channelPath[ch]){
+                        m_present[ch] = true;
+                        if (obj.raw && obj.type != TDMS::TDMSType::Integer16 && obj.type != TDMS::TDMSType::UnsignedInteger16){
+                            wrongType = true;
+                        }
+                    }
+                }
+                if (incremental && i < previous.size() && previous[i].path != obj.path) return IR_UNSUPPORTED;
+                objects.push_back(obj);
+            }
+        }
+
+        if (toc & TDMS_TOC_RAW_DATA){
+            // The raw data may repeat the chunk of the objects several times, the
+            // runs would then interleave the channels, the stream readers handle it
+            uint64_t chunkSize = 0;
+            for(auto &obj : objects){
+                if (obj.raw) chunkSize += obj.size;
+            }
+            if (segEnd - rawStart > chunkSize) return IR_UNSUPPORTED;
+            uint64_t rawPos = rawStart;
+            for(auto &obj : objects){
+                if (!obj.raw) continue;
+                uint64_t objSize = rawPos + obj.size > segEnd ? segEnd - rawPos : obj.size;
+                for(int ch = 0; ch < 2; ch++){
+                    if (obj.path == g_channelPath[ch] && objSize >= 2){
+                        Run run;
+                        run.offset = rawPos;
+                        run.samples = objSize / 2;
+                        run.stride = 2;
+                        m_runs[ch].push_back(run);
+                        m_samples[ch] += run.samples;
+                    }
+                }
+                rawPos += objSize;
+            }
+        }
+
+        if (next < 0 || segEnd >= size) break;
+        pos = segEnd;
+    }
+
+    if (wrongType) return IR_WRONG_DATA_TYPE;
+    if (!m_present[0] && !m_present[1]) return IR_MISSING_CHANNELS;
+    if (m_samples[0] != 0 && m_samples[1] != 0 && m_samples[0] != m_samples[1]) return IR_DATA_NOT_EQUAL;
+    return IR_OK;
+}
+
+auto CMappedReader::start() -> void{
+    for(auto &half : m_half){
+        for(int ch = 0; ch < 2; ch++){
+            half.ch[ch].assign(m_present[ch] ? m_halfBlocks * m_blockSize : 0,0);
+        }
+        half.blocks = 0;
+        half.read = 0;
+        half.ready = false;
+        half.last = false;
+    }
+    m_cursor[0] = m_cursor[1] = Cursor();
+    m_passPos = 0;
+    m_passesLeft = 1;
+    if (m_repeat == CStreamSettings::DACRepeat::DAC_REP_ON){
+        m_passesLeft = std::max(m_rep_count,1);
+    }
+    if (m_repeat == CStreamSettings::DACRepeat::DAC_REP_INF){
+        m_passesLeft = -1;
+    }
+    m_readHalf = 0;
+    m_run = true;
+    m_thread = std::thread(&CMappedReader::prefetchWorker,this);
+}
+
+auto CMappedReader::stop() -> void{
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_run = false;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable()){
+        m_thread.join();
+    }
+}
+
+auto CMappedReader::reset() -> void{
+    stop();
+}
+
+auto CMappedReader::fill(int ch,uint8_t *dst,size_t samples) -> void{
+    auto &cursor = m_cursor[ch];
+    auto &runs = m_runs[ch];
+    while(samples){
+        if (cursor.run >= runs.size()){
+            // Channel is shorter than the other one
+            memset(dst,0,samples * 2);
+            return;
+        }
+        auto &run = runs[cursor.run];
+        if (run.samples == 0){
+            cursor.run++;
+            continue;
+        }
+        uint64_t take = std::min<uint64_t>(run.samples - cursor.pos,samples);
+        take = std::min<uint64_t>(take,CMappedFile::getMaxView() / run.stride);
+        size_t span = (take - 1) * run.stride + 2;
+        auto src = m_file.view(run.offset + cursor.pos * run.stride,span);
+        if (!src){
+            memset(dst,0,take * 2);
+        }else if (run.stride == 2){
+            memcpy_neon(dst,src,take * 2);
+        }else{
+            // WAV frames, every channel takes 16 bit out of the frame
+            for(uint64_t i = 0; i < take; i++){
+                memcpy(dst + i * 2,src + i * run.stride,2);
+            }
+        }
+        dst += take * 2;
+        samples -= take;
+        cursor.pos += take;
+        if (cursor.pos >= run.samples){
+            cursor.run++;
+            cursor.pos = 0;
+        }
+    }
+}
+
+auto CMappedReader::prefetch(int ch,uint64_t samples) -> void{
+    auto &cursor = m_cursor[ch];
+    auto &runs = m_runs[ch];
+    if (cursor.run < runs.size()){
+        auto &run = runs[cursor.run];
+        m_file.willNeed(run.offset + cursor.pos * run.stride,samples * run.stride);
+    }
+}
+
+auto CMappedReader::fillBlock(Half &half,size_t block) -> size_t{
+    size_t blockSamples = m_blockSize / 2;
+    size_t got = 0;
+    while(got < blockSamples){
+        uint64_t n = std::min<uint64_t>(blockSamples - got,m_total - m_passPos);
+        for(int ch = 0; ch < 2; ch++){
+            if (m_present[ch]){
+                fill(ch,half.ch[ch].data() + block * m_blockSize + got * 2,n);
+            }
+        }
+        got += n;
+        m_passPos += n;
+        if (m_passPos >= m_total){
+            if (m_passesLeft > 0) m_passesLeft--;
+            if (m_passesLeft == 0){
+                break;
+            }
+            m_cursor[0] = m_cursor[1] = Cursor();
+            m_passPos = 0;
+        }
+    }
+    return got;
+}
+
+auto CMappedReader::prefetchWorker() -> void{
+    int h = 0;
+    while(m_run){
+        auto &half = m_half[h];
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock,[&]{ return !half.ready || !m_run; });
+            if (!m_run) break;
+        }
+        half.blocks = 0;
+        half.read = 0;
+        half.last = false;
+        while(half.blocks < m_halfBlocks && !half.last){
+            auto got = fillBlock(half,half.blocks);
+            if (m_passesLeft == 0){
+                half.last = true;
+                if (got == 0) break;
+                for(int ch = 0; ch < 2; ch++){
+                    if (m_present[ch]){
+                        memset(half.ch[ch].data() + half.blocks * m_blockSize + got * 2,0,m_blockSize - got * 2);
+                    }
+                }
+            }
+            half.blocks++;
+        }
+        if (!half.last){
+            // Let the kernel read the next half while this one is played
+            for(int ch = 0; ch < 2; ch++){
+                if (m_present[ch]) prefetch(ch,m_halfBlocks * m_blockSize / 2);
+            }
+        }
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            half.ready = true;
+        }
+        m_cond.notify_all();
+        if (half.last) break;
+        h ^= 1;
+    }
+}
+
+auto CMappedReader::read(uint8_t *ch1,size_t *size_ch1, uint8_t *ch2,size_t *size_ch2) -> ReadResult{
+    *size_ch1 = 0;
+    *size_ch2 = 0;
+    if (m_total == 0){
+        return RR_EMPTY;
+    }
+    if (!m_thread.joinable()){
+        start();
+    }
+    auto &half = m_half[m_readHalf];
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock,[&]{ return half.ready || !m_run; });
+        if (!half.ready){
+            return RR_ENDED;
+        }
+    }
+    // The half belongs to the reader until it is marked free again
+    if (half.read < half.blocks){
+        uint8_t *dst[2] = {ch1,ch2};
+        size_t *size[2] = {size_ch1,size_ch2};
+        for(int ch = 0; ch < 2; ch++){
+            if (m_present[ch] && dst[ch]){
+                memcpy_neon(dst[ch],half.ch[ch].data() + half.read * m_blockSize,m_blockSize);
+                *size[ch] = m_blockSize;
+            }
+        }
+        half.read++;
+    }
+    if (half.read < half.blocks){
+        return RR_OK;
+    }
+    if (half.last){
+        return RR_ENDED;
+    }
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        half.ready = false;
+        m_readHalf ^= 1;
+    }
+    m_cond.notify_all();
+    return RR_OK;
+}
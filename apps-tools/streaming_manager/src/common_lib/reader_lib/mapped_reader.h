@@ -0,0 +1,109 @@
+#ifndef READER_LIB_MAPPED_READER_H
+#define READER_LIB_MAPPED_READER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+#include "mapped_file.h"
+#include "settings_lib/stream_settings.h"
+
+/**
+ * DAC playback source for WAV and TDMS files.
+ * The file is indexed once on open: every channel becomes a list of runs of
+ * 16 bit samples located directly in the file. A prefetch thread converts the
+ * runs through a memory map into two halves of ready DAC blocks, the caller
+ * copies blocks from one half while the other half is filled. Repeats wrap
+ * inside the prefetch thread, so a loop does not leave a gap.
+ */
+
+class CMappedReader
+{
+    public:
+
+        enum IndexResult{
+            IR_OK                    = 0,
+            IR_MISSING_CHANNELS      = 1,
+            IR_WRONG_DATA_TYPE       = 2,
+            IR_DATA_NOT_EQUAL        = 3,
+            IR_UNSUPPORTED           = 4   // use the stream readers
+        };
+
+        enum ReadResult{
+            RR_OK                    = 0,
+            RR_ENDED                 = 1,
+            RR_EMPTY                 = 2
+        };
+
+        CMappedReader(CStreamSettings::DataFormat _fileType, std::string _filePath,CStreamSettings::DACRepeat _repeat,int32_t _rep_count,size_t _blockSize);
+        ~CMappedReader();
+
+        auto open() -> IndexResult;
+        auto isChannelPresent(int ch) -> bool;
+        auto getChannelSize(int ch) -> uint64_t;
+
+        // Sizes the read ahead halves, must be called before the first read()
+        auto setSampleRate(uint64_t samplesPerSec) -> void;
+
+        // Fills one block per present channel, the last block is padded with zeros
+        auto read(uint8_t *ch1,size_t *size_ch1, uint8_t *ch2,size_t *size_ch2) -> ReadResult;
+        auto reset() -> void;
+
+    private:
+
+        struct Run{
+            uint64_t offset  = 0;
+            uint64_t samples = 0;
+            uint32_t stride  = 2;   // bytes from one sample of the channel to the next
+        };
+
+        struct Cursor{
+            size_t   run = 0;
+            uint64_t pos = 0;
+        };
+
+        struct Half{
+            std::vector<uint8_t> ch[2];
+            size_t blocks = 0;
+            size_t read   = 0;
+            bool   ready  = false;
+            bool   last   = false;
+        };
+
+        CMappedReader(CMappedReader const&) = delete;
+        CMappedReader& operator=(CMappedReader const&) = delete;
+
+        auto indexWav() -> IndexResult;
+        auto indexTdms() -> IndexResult;
+        auto start() -> void;
+        auto stop() -> void;
+        auto prefetchWorker() -> void;
+        auto fillBlock(Half &half,size_t block) -> size_t;
+        auto fill(int ch,uint8_t *dst,size_t samples) -> void;
+        auto prefetch(int ch,uint64_t samples) -> void;
+
+        CStreamSettings::DataFormat         m_fileType;
+        std::string                         m_filePath;
+        CStreamSettings::DACRepeat          m_repeat;
+        int32_t                             m_rep_count;
+        size_t                              m_blockSize;
+        CMappedFile                         m_file;
+        std::vector<Run>                    m_runs[2];
+        uint64_t                            m_samples[2];
+        bool                                m_present[2];
+        uint64_t                            m_total;        // samples of one pass
+        Cursor                              m_cursor[2];
+        uint64_t                            m_passPos;
+        int32_t                             m_passesLeft;   // < 0 repeats forever
+        size_t                              m_halfBlocks;
+        Half                                m_half[2];
+        int                                 m_readHalf;
+        std::thread                         m_thread;
+        std::atomic_bool                    m_run;
+        std::mutex                          m_mutex;
+        std::condition_variable             m_cond;
+};
+
+#endif
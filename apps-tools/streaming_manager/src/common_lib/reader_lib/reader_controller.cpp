@@ -20,14 +20,21 @@ CReaderController::CReaderController(CStreamSettings::DataFormat _fileType, std:
     m_checkEmptyFile(false),
     m_memoryCacheSize(memoryCacheSize),
     m_channel1Size(0),
-    m_channel2Size(0)
+    m_channel2Size(0),
+    m_useMemoryCache(false),
+    m_mappedReader(nullptr),
+    m_mappedResult(CMappedReader::IR_UNSUPPORTED)
 {
-    m_useMemoryCache = false;
-
     if (m_repeat == CStreamSettings::DACRepeat::DAC_REP_ON && m_rep_count == 0){
         m_rep_count = 1;
     }
 
+    // Files the index does not cover are read with the stream readers
+    if (openMapped()){
+        m_result = checkFile();
+        return;
+    }
+
     if (m_fileType == CStreamSettings::DataFormat::WAV){
         openWav();
     }
@@ -52,10 +59,28 @@ void CReaderController::TemperaryBuffer::deleteBuffer(){
 CReaderController::~CReaderController(){
     m_tempBuffer[0].deleteBuffer();
     m_tempBuffer[1].deleteBuffer();
+    if (m_mappedReader) delete m_mappedReader;
     if (m_wavReader) delete m_wavReader;
     if (m_tdmsFile) delete m_tdmsFile;
 }
 
+auto CReaderController::openMapped() -> bool{
+    try{
+        if (m_mappedReader) delete m_mappedReader;
+        m_mappedReader = new CMappedReader(m_fileType,m_filePath,m_repeat,m_rep_count,g_max_buff);
+        m_mappedResult = m_mappedReader->open();
+        if (m_mappedResult == CMappedReader::IR_UNSUPPORTED){
+            delete m_mappedReader;
+            m_mappedReader = nullptr;
+            return false;
+        }
+        return true;
+    } catch (const std::bad_alloc& e) {
+        std::cout << "[CReaderController]: Error Allocation failed: " << e.what() << '\n';
+    }
+    return false;
+}
+
 auto CReaderController::openWav() -> bool{
     try{
         if (m_fileType == CStreamSettings::DataFormat::WAV){
@@ -136,6 +161,16 @@ auto CReaderController::resetReadFromBuffer() -> bool{
 
 
 
+auto CReaderController::getMaxBufferSize() -> size_t{
+    return g_max_buff;
+}
+
+auto CReaderController::setSampleRate(uint64_t samplesPerSec) -> void{
+    if (m_mappedReader){
+        m_mappedReader->setSampleRate(samplesPerSec);
+    }
+}
+
 CReaderController::Ptr CReaderController::Create(CStreamSettings::DataFormat _fileType, std::string _filePath,CStreamSettings::DACRepeat _repeat,int32_t _rep_count,uint64_t memoryCacheSize){
     return std::make_shared<CReaderController>(_fileType, _filePath, _repeat,_rep_count,memoryCacheSize);
 }
@@ -151,26 +186,40 @@ auto CReaderController::writeFromTemp(uint8_t **buff,size_t max_size,size_t *wri
 
 
 auto CReaderController::getBufferPrepared(uint8_t **ch1,size_t *size_ch1, uint8_t **ch2,size_t *size_ch2) -> BufferResult{
+    *ch1 = m_channel1Present ? new uint8_t[g_max_buff] : nullptr;
+    *ch2 = m_channel2Present ? new uint8_t[g_max_buff] : nullptr;
+    auto res = getBufferPrepared(*ch1,size_ch1,*ch2,size_ch2);
+    if (*ch1 && *size_ch1 == 0){
+        delete [] *ch1;
+        *ch1 = nullptr;
+    }
+    if (*ch2 && *size_ch2 == 0){
+        delete [] *ch2;
+        *ch2 = nullptr;
+    }
+    return res;
+}
+
+auto CReaderController::getBufferPrepared(uint8_t *ch1_buf,size_t *size_ch1, uint8_t *ch2_buf,size_t *size_ch2) -> BufferResult{
     auto fillZero = [](uint8_t **ch,size_t *size){
-        if (*ch){
-            if (0 != *size){
-                memset((&(**ch) + *size),0,g_max_buff - *size);
-                *size = g_max_buff;
-            }else{
-                delete [] *ch;
-                *ch = nullptr;
-                *size = 0;
-            }
+        if (*ch && 0 != *size){
+            memset((&(**ch) + *size),0,g_max_buff - *size);
+            *size = g_max_buff;
         }
     };
     *size_ch1 = 0;
     *size_ch2 = 0;
-    if (m_channel1Present){
-        *ch1 = new uint8_t[g_max_buff];
-    }
-    if (m_channel2Present){
-        *ch2 = new uint8_t[g_max_buff];
+    uint8_t *ch1_ptr = m_channel1Present ? ch1_buf : nullptr;
+    uint8_t *ch2_ptr = m_channel2Present ? ch2_buf : nullptr;
+    if (m_mappedReader){
+        switch(m_mappedReader->read(ch1_ptr,size_ch1,ch2_ptr,size_ch2)){
+            case CMappedReader::RR_OK:    return BR_OK;
+            case CMappedReader::RR_EMPTY: return BR_EMPTY;
+            default:                      return BR_ENDED;
+        }
     }
+    uint8_t **ch1 = &ch1_ptr;
+    uint8_t **ch2 = &ch2_ptr;
     while(1) {
         if (*ch1){
             if (m_tempBuffer[0].size > 0 && !m_tempBuffer[0].isEnded()){
@@ -457,6 +506,9 @@ auto CReaderController::checkFile() -> OpenResult{
     m_channel2Present = false;
     m_channel1Size = 0;
     m_channel2Size = 0;
+    if (m_mappedReader){
+        return checkMappedFile();
+    }
     if (m_fileType == CStreamSettings::DataFormat::TDMS){
         return checkTDMSFile();
     }
@@ -466,6 +518,21 @@ auto CReaderController::checkFile() -> OpenResult{
     return OpenResult::OR_CLOSE;
 }
 
+auto CReaderController::checkMappedFile() -> OpenResult{
+    switch(m_mappedResult){
+        case CMappedReader::IR_OK: break;
+        case CMappedReader::IR_MISSING_CHANNELS: return OpenResult::OR_MISSING_CHANNELS;
+        case CMappedReader::IR_WRONG_DATA_TYPE:  return OpenResult::OR_WRONG_DATA_TYPE;
+        case CMappedReader::IR_DATA_NOT_EQUAL:   return OpenResult::OR_DATA_NOT_EQUAL;
+        default: return OpenResult::OR_CLOSE;
+    }
+    m_channel1Present = m_mappedReader->isChannelPresent(0);
+    m_channel2Present = m_mappedReader->isChannelPresent(1);
+    m_channel1Size = m_mappedReader->getChannelSize(0);
+    m_channel2Size = m_mappedReader->getChannelSize(1);
+    return OpenResult::OR_OK;
+}
+
 auto CReaderController::checkWavFile() -> OpenResult{
     if (m_wavReader){
         auto header = m_wavReader->getHeader();
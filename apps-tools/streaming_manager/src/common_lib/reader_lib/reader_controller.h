@@ -12,6 +12,7 @@
 #include "settings_lib/stream_settings.h"
 #include "wav_lib/wav_reader.h"
 #include "tdms_lib/file.h"
+#include "mapped_reader.h"
 
 
 /**
@@ -48,6 +49,11 @@ class CReaderController
         auto isOpen() -> CReaderController::OpenResult;
         auto checkFile() -> OpenResult;
         auto getBufferPrepared(uint8_t **ch1,size_t *size_ch1, uint8_t **ch2,size_t *size_ch2) -> BufferResult;
+        // Fills caller buffers of getMaxBufferSize() bytes, channels missing in the file get size 0
+        auto getBufferPrepared(uint8_t *ch1,size_t *size_ch1, uint8_t *ch2,size_t *size_ch2) -> BufferResult;
+        static auto getMaxBufferSize() -> size_t;
+        // DAC rate, sizes the read ahead of memory mapped files
+        auto setSampleRate(uint64_t samplesPerSec) -> void;
 
     private:
 
@@ -67,6 +73,8 @@ class CReaderController
         CReaderController(CReaderController const&) = delete;
         CReaderController& operator=(CReaderController const&) = delete;
 
+        auto openMapped() -> bool;
+        auto checkMappedFile() -> OpenResult;
         auto checkTDMSFile() -> OpenResult;
         auto checkWavFile() -> OpenResult;
         auto getBufferFull(uint8_t **ch1,size_t *size_ch1, uint8_t **ch2,size_t *size_ch2) -> void;
@@ -99,6 +107,8 @@ class CReaderController
         size_t                              m_channel1Size;
         size_t                              m_channel2Size;
         bool                                m_useMemoryCache;
+        CMappedReader                      *m_mappedReader;
+        CMappedReader::IndexResult          m_mappedResult;
 };
 
 #endif
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include "dac_settings.h"
 #include "json/json.h"
 
@@ -112,6 +113,78 @@ auto DacSettings::readFromFile(string _filename) -> std::vector<DacSettings> {
                 std::cerr << "[CDacSettings] Can't parse verbous value: " << obj["verbous"].toStyledString() << std::endl;
             }
 
+            // Optional, plays cached segments instead of streaming the file
+            if (obj.isMember("sequence") && obj["sequence"].isObject()){
+                auto seq = obj["sequence"];
+                if (seq.isMember("segments") && seq["segments"].isArray()){
+                    for(auto &item : seq["segments"]){
+                        SequenceSegment segment;
+                        if (item.isMember("id") && item["id"].isUInt()){
+                            segment.id = item["id"].asUInt();
+                        }else{
+                            std::cerr << "[CDacSettings] Can't parse segment id value: " << item["id"].toStyledString() << std::endl;
+                        }
+                        if (item.isMember("file") && item["file"].isString()){
+                            segment.file = item["file"].asString();
+                        }else{
+                            std::cerr << "[CDacSettings] Can't parse segment file value: " << item["file"].toStyledString() << std::endl;
+                        }
+                        if (item.isMember("file_type") && item["file_type"].isString()){
+                            auto value = item["file_type"].asString();
+                            if (value == "WAV"){
+                                segment.file_type = CStreamSettings::WAV;
+                            }
+
+                            if (value == "TDMS"){
+                                segment.file_type = CStreamSettings::TDMS;
+                            }
+                        }else{
+                            std::cerr << "[CDacSettings] Can't parse segment file_type value: " << item["file_type"].toStyledString() << std::endl;
+                        }
+                        s.seq_segments.push_back(segment);
+                    }
+                }else{
+                    std::cerr << "[CDacSettings] Can't parse sequence segments value: " << seq["segments"].toStyledString() << std::endl;
+                }
+
+                if (seq.isMember("steps") && seq["steps"].isArray()){
+                    for(auto &item : seq["steps"]){
+                        SequenceStep step;
+                        if (item.isMember("segment") && item["segment"].isUInt()){
+                            step.segment = item["segment"].asUInt();
+                        }else{
+                            std::cerr << "[CDacSettings] Can't parse step segment value: " << item["segment"].toStyledString() << std::endl;
+                        }
+                        if (item.isMember("repeat") && item["repeat"].isUInt()){
+                            step.repeat = item["repeat"].asUInt();
+                        }
+                        if (item.isMember("next") && item["next"].isInt()){
+                            step.next = item["next"].asInt();
+                        }
+                        if (item.isMember("loops") && item["loops"].isUInt()){
+                            step.loops = item["loops"].asUInt();
+                        }
+                        if (item.isMember("jump") && item["jump"].isInt()){
+                            step.jump = item["jump"].asInt();
+                        }
+                        s.seq_steps.push_back(step);
+                    }
+                }else{
+                    std::cerr << "[CDacSettings] Can't parse sequence steps value: " << seq["steps"].toStyledString() << std::endl;
+                }
+
+                if (seq.isMember("triggers") && seq["triggers"].isArray()){
+                    for(auto &item : seq["triggers"]){
+                        if (item.isUInt()){
+                            s.seq_triggers.push_back(item.asUInt());
+                        }else{
+                            std::cerr << "[CDacSettings] Can't parse trigger time value: " << item.toStyledString() << std::endl;
+                        }
+                    }
+                    std::sort(s.seq_triggers.begin(),s.seq_triggers.end());
+                }
+            }
+
             settings.push_back(s);
         }
     }
@@ -6,6 +6,21 @@
 #include "stream_settings.h"
 
 struct DacSettings {
+    // Segment of a sequenced playback, uploaded once to the board
+    struct SequenceSegment{
+        uint32_t                    id = 0;
+        std::string                 file = "";
+        CStreamSettings::DataFormat file_type = CStreamSettings::UNDEF;
+    };
+
+    struct SequenceStep{
+        uint32_t                    segment = 0;
+        uint32_t                    repeat = 1;     // 0 - until a trigger or stop
+        int32_t                     next = -1;      // -1 - following step
+        uint32_t                    loops = 0;      // 0 - next is always taken
+        int32_t                     jump = -1;      // step on trigger, -1 - none
+    };
+
     std::string                 host = "";
     std::string                 port = "";
     std::string                 config_port = "";
@@ -16,6 +31,9 @@ struct DacSettings {
     int64_t                     dac_memory = 0;
     int32_t                     dac_speed  = 0;
     bool                        verbous    = false;
+    std::vector<SequenceSegment> seq_segments;
+    std::vector<SequenceStep>   seq_steps;
+    std::vector<uint32_t>       seq_triggers;   // ms after the start, a trigger is sent at each
 
     static auto readFromFile(std::string _filename) -> std::vector<DacSettings>;
 };
@@ -37,10 +37,26 @@ CStreamSettings::CStreamSettings(){
     m_loopback_mode = LOOPBACKMode::DD;
     m_loopback_channels = LOOPBACKChannels::TWO;
 
+    for(int i = 0; i < 2; i++){
+        m_event_type[i] = EV_OFF;
+        m_event_level[i] = 0;
+        m_event_level2[i] = 0;
+    }
+    m_event_pre = 16384;
+    m_event_post = 16384;
+    m_event_holdoff = 0;
+    m_stats_rate = 0;
+    m_local_slots = 0;
+
     reset();
 }
 
 void CStreamSettings::reset(){
+    // Event keys are optional, a configuration without them records continuously
+    m_event_type[0] = EV_OFF;
+    m_event_type[1] = EV_OFF;
+    m_stats_rate = 0;
+    m_local_slots = 0;
     m_var_changed.clear();
     m_var_changed = { {"m_port",        false},
                       {"m_dac_file",    false},
@@ -145,6 +161,17 @@ auto CStreamSettings::copy(const CStreamSettings &src) -> void{
     m_loopback_mode  = src.m_loopback_mode;
     m_loopback_channels  = src.m_loopback_channels;
 
+    for(int i = 0; i < 2; i++){
+        m_event_type[i] = src.m_event_type[i];
+        m_event_level[i] = src.m_event_level[i];
+        m_event_level2[i] = src.m_event_level2[i];
+    }
+    m_event_pre = src.m_event_pre;
+    m_event_post = src.m_event_post;
+    m_event_holdoff = src.m_event_holdoff;
+    m_stats_rate = src.m_stats_rate;
+    m_local_slots = src.m_local_slots;
+
     m_var_changed  = src.m_var_changed;
 }
 
@@ -175,6 +202,17 @@ bool CStreamSettings::writeToFile(string _filename){
         adc_config["attenuator"] = getAttenuator();
         adc_config["calibration"] = getCalibration();
         adc_config["coupling"] = getAC_DC();
+        adc_config["event_ch1_type"] = getEventType(CH1);
+        adc_config["event_ch1_level"] = getEventLevel(CH1);
+        adc_config["event_ch1_level2"] = getEventLevel2(CH1);
+        adc_config["event_ch2_type"] = getEventType(CH2);
+        adc_config["event_ch2_level"] = getEventLevel(CH2);
+        adc_config["event_ch2_level2"] = getEventLevel2(CH2);
+        adc_config["event_pre"] = getEventPreSamples();
+        adc_config["event_post"] = getEventPostSamples();
+        adc_config["event_holdoff"] = getEventHoldoffSamples();
+        adc_config["stats_rate"] = getStatsRate();
+        adc_config["local_slots"] = getLocalSlots();
 
         dac_config["dac_file"] = getDACFile();
         dac_config["dac_file_type"] = getDACFileType();
@@ -229,6 +267,17 @@ auto CStreamSettings::getJson()-> std::string{
         adc_config["attenuator"] = getAttenuator();
         adc_config["calibration"] = getCalibration();
         adc_config["coupling"] = getAC_DC();
+        adc_config["event_ch1_type"] = getEventType(CH1);
+        adc_config["event_ch1_level"] = getEventLevel(CH1);
+        adc_config["event_ch1_level2"] = getEventLevel2(CH1);
+        adc_config["event_ch2_type"] = getEventType(CH2);
+        adc_config["event_ch2_level"] = getEventLevel(CH2);
+        adc_config["event_ch2_level2"] = getEventLevel2(CH2);
+        adc_config["event_pre"] = getEventPreSamples();
+        adc_config["event_post"] = getEventPostSamples();
+        adc_config["event_holdoff"] = getEventHoldoffSamples();
+        adc_config["stats_rate"] = getStatsRate();
+        adc_config["local_slots"] = getLocalSlots();
 
         dac_config["dac_file"] = getDACFile();
         dac_config["dac_file_type"] = getDACFileType();
@@ -359,6 +408,9 @@ auto CStreamSettings::String()-> std::string{
                 type = "Voltage";
         }
         str = str + "Data type:\t\t" + type  +" (In file mode)\n";
+        str = str + eventString();
+        str = str + "Statistics:\t\t" + (getStatsRate() ? std::to_string(getStatsRate()) + " Hz" : "OFF") + "\n";
+        str = str + "Local consumers:\t" + (getLocalSlots() ? std::to_string(getLocalSlots()) + " slots" : "OFF") + "\n";
 
         str = str + "\n******************** DAC  streaming ********************\n";
         std::string  dac_mode = "ERROR";
@@ -560,6 +612,9 @@ auto CStreamSettings::StringStreaming()-> std::string{
                 type = "Voltage";
         }
         str = str + "Data type:\t\t" + type  +" (In file mode)\n";
+        str = str + eventString();
+        str = str + "Statistics:\t\t" + (getStatsRate() ? std::to_string(getStatsRate()) + " Hz" : "OFF") + "\n";
+        str = str + "Local consumers:\t" + (getLocalSlots() ? std::to_string(getLocalSlots()) + " slots" : "OFF") + "\n";
         return str;
     }
     return "INCOMPLETE SETTING";
@@ -636,6 +691,28 @@ auto CStreamSettings::readFromFile(string _filename) -> bool {
         setAC_DC(static_cast<AC_DC>(adc_config["coupling"].asInt()));
     if (adc_config.isMember("resolution"))
         setResolution(static_cast<Resolution>(adc_config["resolution"].asInt()));
+    if (adc_config.isMember("event_ch1_type"))
+        setEventType(CH1,static_cast<EventType>(adc_config["event_ch1_type"].asInt()));
+    if (adc_config.isMember("event_ch1_level"))
+        setEventLevel(CH1,adc_config["event_ch1_level"].asInt());
+    if (adc_config.isMember("event_ch1_level2"))
+        setEventLevel2(CH1,adc_config["event_ch1_level2"].asInt());
+    if (adc_config.isMember("event_ch2_type"))
+        setEventType(CH2,static_cast<EventType>(adc_config["event_ch2_type"].asInt()));
+    if (adc_config.isMember("event_ch2_level"))
+        setEventLevel(CH2,adc_config["event_ch2_level"].asInt());
+    if (adc_config.isMember("event_ch2_level2"))
+        setEventLevel2(CH2,adc_config["event_ch2_level2"].asInt());
+    if (adc_config.isMember("event_pre"))
+        setEventPreSamples(adc_config["event_pre"].asUInt());
+    if (adc_config.isMember("event_post"))
+        setEventPostSamples(adc_config["event_post"].asUInt());
+    if (adc_config.isMember("event_holdoff"))
+        setEventHoldoffSamples(adc_config["event_holdoff"].asUInt());
+    if (adc_config.isMember("stats_rate"))
+        setStatsRate(adc_config["stats_rate"].asUInt());
+    if (adc_config.isMember("local_slots"))
+        setLocalSlots(adc_config["local_slots"].asUInt());
 
 
     if (dac_config.isMember("dac_file_type"))
@@ -876,6 +953,61 @@ auto CStreamSettings::setValue(std::string key,int64_t value) -> bool{
         setLoopbackChannels(static_cast<LOOPBACKChannels>(value));
         return true;
     }
+
+    if (key == "event_ch1_type") {
+        setEventType(CH1,static_cast<EventType>(value));
+        return true;
+    }
+
+    if (key == "event_ch1_level") {
+        setEventLevel(CH1,static_cast<int32_t>(value));
+        return true;
+    }
+
+    if (key == "event_ch1_level2") {
+        setEventLevel2(CH1,static_cast<int32_t>(value));
+        return true;
+    }
+
+    if (key == "event_ch2_type") {
+        setEventType(CH2,static_cast<EventType>(value));
+        return true;
+    }
+
+    if (key == "event_ch2_level") {
+        setEventLevel(CH2,static_cast<int32_t>(value));
+        return true;
+    }
+
+    if (key == "event_ch2_level2") {
+        setEventLevel2(CH2,static_cast<int32_t>(value));
+        return true;
+    }
+
+    if (key == "event_pre") {
+        setEventPreSamples(static_cast<uint32_t>(value));
+        return true;
+    }
+
+    if (key == "event_post") {
+        setEventPostSamples(static_cast<uint32_t>(value));
+        return true;
+    }
+
+    if (key == "event_holdoff") {
+        setEventHoldoffSamples(static_cast<uint32_t>(value));
+        return true;
+    }
+
+    if (key == "stats_rate") {
+        setStatsRate(static_cast<uint32_t>(value));
+        return true;
+    }
+
+    if (key == "local_slots") {
+        setLocalSlots(static_cast<uint32_t>(value));
+        return true;
+    }
     return false;
 }
 
@@ -1032,3 +1164,115 @@ auto CStreamSettings::setLoopbackChannels(LOOPBACKChannels channels) -> void{
     m_loopback_channels = channels;
     m_var_changed["m_loopback_channels"] = true; 
 }
+
+auto CStreamSettings::isEventMode() const -> bool{
+    return m_event_type[0] != EV_OFF || m_event_type[1] != EV_OFF;
+}
+
+auto CStreamSettings::getEventType(Channel ch) const -> EventType{
+    return ch == CH2 ? m_event_type[1] : m_event_type[0];
+}
+
+auto CStreamSettings::setEventType(Channel ch,EventType type) -> void{
+    m_event_type[ch == CH2 ? 1 : 0] = type;
+}
+
+auto CStreamSettings::getEventLevel(Channel ch) const -> int32_t{
+    return ch == CH2 ? m_event_level[1] : m_event_level[0];
+}
+
+auto CStreamSettings::setEventLevel(Channel ch,int32_t level) -> void{
+    m_event_level[ch == CH2 ? 1 : 0] = level;
+}
+
+auto CStreamSettings::getEventLevel2(Channel ch) const -> int32_t{
+    return ch == CH2 ? m_event_level2[1] : m_event_level2[0];
+}
+
+auto CStreamSettings::setEventLevel2(Channel ch,int32_t level) -> void{
+    m_event_level2[ch == CH2 ? 1 : 0] = level;
+}
+
+auto CStreamSettings::getEventPreSamples() const -> uint32_t{
+    return m_event_pre;
+}
+
+auto CStreamSettings::setEventPreSamples(uint32_t value) -> void{
+    m_event_pre = value;
+}
+
+auto CStreamSettings::getEventPostSamples() const -> uint32_t{
+    return m_event_post;
+}
+
+auto CStreamSettings::setEventPostSamples(uint32_t value) -> void{
+    m_event_post = value;
+}
+
+auto CStreamSettings::getEventHoldoffSamples() const -> uint32_t{
+    return m_event_holdoff;
+}
+
+auto CStreamSettings::setEventHoldoffSamples(uint32_t value) -> void{
+    m_event_holdoff = value;
+}
+
+auto CStreamSettings::getStatsRate() const -> uint32_t{
+    return m_stats_rate;
+}
+
+auto CStreamSettings::setStatsRate(uint32_t value) -> void{
+    m_stats_rate = value;
+}
+
+auto CStreamSettings::getLocalSlots() const -> uint32_t{
+    return m_local_slots;
+}
+
+auto CStreamSettings::setLocalSlots(uint32_t value) -> void{
+    m_local_slots = value;
+}
+
+auto CStreamSettings::eventString() -> std::string{
+    std::string str = "";
+    for(auto ch : {CH1,CH2}){
+        std::string type = "ERROR";
+        switch (getEventType(ch)) {
+            case EventType::EV_OFF:
+                type = "OFF";
+                break;
+            case EventType::EV_LEVEL:
+                type = "Level";
+                break;
+            case EventType::EV_EDGE_RISE:
+                type = "Rising edge";
+                break;
+            case EventType::EV_EDGE_FALL:
+                type = "Falling edge";
+                break;
+            case EventType::EV_WINDOW_OUT:
+                type = "Leave window";
+                break;
+            case EventType::EV_WINDOW_IN:
+                type = "Enter window";
+                break;
+            case EventType::EV_SLOPE:
+                type = "Slope";
+                break;
+        }
+        str = str + "Event CH" + std::to_string(ch) + ":\t\t" + type;
+        if (getEventType(ch) != EV_OFF){
+            str = str + " (" + std::to_string(getEventLevel(ch));
+            if (getEventType(ch) == EV_WINDOW_OUT || getEventType(ch) == EV_WINDOW_IN){
+                str = str + " .. " + std::to_string(getEventLevel2(ch));
+            }
+            str = str + ")";
+        }
+        str = str + "\n";
+    }
+    if (isEventMode()){
+        str = str + "Event window:\t\t" + std::to_string(getEventPreSamples()) + " / " + std::to_string(getEventPostSamples()) + " (Pre / post samples)\n";
+        str = str + "Event hold-off:\t\t" + std::to_string(getEventHoldoffSamples()) + " (Samples)\n";
+    }
+    return str;
+}
@@ -75,6 +75,16 @@ public:
         DD  = 0
     };
 
+    enum EventType{
+        EV_OFF         = 0,
+        EV_LEVEL       = 1,   // sample >= level
+        EV_EDGE_RISE   = 2,   // crossing level upward
+        EV_EDGE_FALL   = 3,   // crossing level downward
+        EV_WINDOW_OUT  = 4,   // sample leaves [level, level2]
+        EV_WINDOW_IN   = 5,   // sample enters [level, level2]
+        EV_SLOPE       = 6    // difference of neighbour samples reaches level, the sign selects the direction
+    };
+
     CStreamSettings();
     ~CStreamSettings();
     CStreamSettings (const CStreamSettings&);
@@ -147,12 +157,36 @@ public:
     auto getLoopbackChannels() const -> LOOPBACKChannels;
     auto setLoopbackChannels(LOOPBACKChannels channels) -> void;
 
+    // Event mode settings are optional, levels are raw ADC codes
+    auto isEventMode() const -> bool;
+    auto getEventType(Channel ch) const -> EventType;
+    auto setEventType(Channel ch,EventType type) -> void;
+    auto getEventLevel(Channel ch) const -> int32_t;
+    auto setEventLevel(Channel ch,int32_t level) -> void;
+    auto getEventLevel2(Channel ch) const -> int32_t;
+    auto setEventLevel2(Channel ch,int32_t level) -> void;
+    auto getEventPreSamples() const -> uint32_t;
+    auto setEventPreSamples(uint32_t value) -> void;
+    auto getEventPostSamples() const -> uint32_t;
+    auto setEventPostSamples(uint32_t value) -> void;
+    auto getEventHoldoffSamples() const -> uint32_t;
+    auto setEventHoldoffSamples(uint32_t value) -> void;
+
+    // Signal statistics reports per second, 0 - disabled. Optional as the event settings
+    auto getStatsRate() const -> uint32_t;
+    auto setStatsRate(uint32_t value) -> void;
+
+    // Packs kept in the shared memory ring for local consumers, 0 - disabled. Optional as the event settings
+    auto getLocalSlots() const -> uint32_t;
+    auto setLocalSlots(uint32_t value) -> void;
 
 private:
 
     CStreamSettings(CStreamSettings&&) = delete;
     CStreamSettings& operator=(CStreamSettings&&) = delete;
 
+    auto eventString() -> std::string;
+
     std::string     m_port;
     std::string     m_dac_file;
     Protocol        m_protocol;
@@ -181,6 +215,14 @@ private:
     LOOPBACKMode     m_loopback_mode;
     LOOPBACKChannels m_loopback_channels;
 
+    EventType        m_event_type[2];
+    int32_t          m_event_level[2];
+    int32_t          m_event_level2[2];
+    uint32_t         m_event_pre;
+    uint32_t         m_event_post;
+    uint32_t         m_event_holdoff;
+    uint32_t         m_stats_rate;
+    uint32_t         m_local_slots;
 
     std::map<std::string, bool> m_var_changed;
 };
@@ -26,8 +26,8 @@ CStreamingBufferCached::CStreamingBufferCached(uint32_t maxRamSize) :
 
 CStreamingBufferCached::~CStreamingBufferCached()
 {
+    notifyToDestory();
     std::lock_guard<std::mutex> lock(m_mtx);
-    notifyToDestory();    
     m_buffers.clear();
 }
 
@@ -70,7 +70,11 @@ auto CStreamingBufferCached::setMaxRamSize(uint64_t size) -> void{
 }
 
 auto CStreamingBufferCached::notifyToDestory() -> bool{
-    m_needDestroy = true;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_needDestroy = true;
+    }
+    m_cv.notify_all();
     return true;
 }
 
@@ -106,8 +110,11 @@ auto CStreamingBufferCached::getFreeBuffer(uint64_t fpga_lost) -> DataLib::CData
 }
 
 auto CStreamingBufferCached::unlockBufferWrite() -> void{
-    std::lock_guard<std::mutex> lock(m_mtx);
-    m_ringEnd = (m_ringEnd + 1) % m_ringSize;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_ringEnd = (m_ringEnd + 1) % m_ringSize;
+    }
+    m_cv.notify_all();
 }
 
 auto CStreamingBufferCached::unlockBufferRead() -> void{
@@ -122,4 +129,27 @@ auto CStreamingBufferCached::readBuffer() -> DataLib::CDataBuffersPack::Ptr{
         return pack;
     }
     return nullptr;
+}
+
+auto CStreamingBufferCached::readBuffer(uint32_t offset) -> DataLib::CDataBuffersPack::Ptr{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (m_ringSize && offset < (m_ringEnd + m_ringSize - m_ringStart) % m_ringSize){
+        return m_buffers[(m_ringStart + offset) % m_ringSize];
+    }
+    return nullptr;
+}
+
+auto CStreamingBufferCached::getFilledCount() -> uint32_t{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (!m_ringSize) return 0;
+    return (m_ringEnd + m_ringSize - m_ringStart) % m_ringSize;
+}
+
+auto CStreamingBufferCached::waitBuffer(uint32_t timeoutMs) -> bool{
+    std::unique_lock<std::mutex> lock(m_mtx);
+    return m_cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]{ return m_ringStart != m_ringEnd || m_needDestroy; }) && m_ringStart != m_ringEnd;
+}
+
+auto CStreamingBufferCached::getRingSize() -> uint32_t{
+    return m_ringSize;
 }
\ No newline at end of file
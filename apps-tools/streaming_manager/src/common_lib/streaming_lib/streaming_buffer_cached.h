@@ -2,6 +2,7 @@
 #define STREAMING_LIB_STREAMING_BUFFER_CACHED_H
 
 #include <mutex>
+#include <condition_variable>
 #include <list>
 #include <deque>
 #include <map>
@@ -31,6 +32,12 @@ public:
     auto unlockBufferWrite() -> void;
     auto unlockBufferRead() -> void;
     auto readBuffer() -> DataLib::CDataBuffersPack::Ptr;
+    // Filled pack behind the read position, the pack stays valid until it is unlocked for read
+    auto readBuffer(uint32_t offset) -> DataLib::CDataBuffersPack::Ptr;
+    auto getFilledCount() -> uint32_t;
+    // Blocks until a filled pack is available, the buffer is destroyed or the timeout expires
+    auto waitBuffer(uint32_t timeoutMs) -> bool;
+    auto getRingSize() -> uint32_t;
 
     auto getMaxRamSize() -> uint64_t;
     auto setMaxRamSize(uint64_t size) -> void;
@@ -62,6 +69,7 @@ private:
     bool     m_needDestroy;
     DataLib::CDataBuffersPack::Ptr m_dropedPack;
     std::mutex m_mtx;
+    std::condition_variable m_cv;
 };
 
 }
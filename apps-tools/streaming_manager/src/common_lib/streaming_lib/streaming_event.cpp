@@ -0,0 +1,208 @@
+#include <algorithm>
+#include "streaming_event.h"
+#include "data_lib/thread_cout.h"
+
+using namespace streaming_lib;
+
+auto CStreamingEventDetector::create(CStreamingBufferCached::Ptr buffer,uint32_t preSamples,uint32_t postSamples,uint32_t holdoffSamples) -> CStreamingEventDetector::Ptr{
+    return std::make_shared<CStreamingEventDetector>(buffer,preSamples,postSamples,holdoffSamples);
+}
+
+CStreamingEventDetector::CStreamingEventDetector(CStreamingBufferCached::Ptr buffer,uint32_t preSamples,uint32_t postSamples,uint32_t holdoffSamples) :
+    m_buffer(buffer),
+    m_pre(preSamples),
+    m_post(std::max<uint32_t>(postSamples,1)),
+    m_holdoff(holdoffSamples),
+    m_trigger(),
+    m_windows(),
+    m_scanned(0),
+    m_scanEnd(0),
+    m_armedFrom(0),
+    m_headPos(0),
+    m_eventsCount(0),
+    m_preChecked(false),
+    m_current(nullptr),
+    m_mtx()
+{
+}
+
+CStreamingEventDetector::~CStreamingEventDetector()
+{
+}
+
+auto CStreamingEventDetector::setChannel(DataLib::EDataBuffersPackChannel ch,CStreamSettings::EventType type,int32_t level,int32_t level2) -> void{
+    if (ch != DataLib::CH1 && ch != DataLib::CH2) return;
+    std::lock_guard<std::mutex> lock(m_mtx);
+    auto &trigger = m_trigger[ch];
+    trigger.type = type;
+    trigger.level = level;
+    trigger.level2 = level2;
+    trigger.prevValid = false;
+}
+
+auto CStreamingEventDetector::getEventsCount() -> uint64_t{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_eventsCount;
+}
+
+auto CStreamingEventDetector::check(Trigger &trigger,int32_t value) -> bool{
+    bool    valid = trigger.prevValid;
+    int32_t prev = trigger.prev;
+    trigger.prev = value;
+    trigger.prevValid = true;
+    auto inside = [&trigger](int32_t x){
+        return x >= std::min(trigger.level,trigger.level2) && x <= std::max(trigger.level,trigger.level2);
+    };
+    switch (trigger.type) {
+        case CStreamSettings::EV_LEVEL:
+            return value >= trigger.level;
+        case CStreamSettings::EV_EDGE_RISE:
+            return valid && prev < trigger.level && value >= trigger.level;
+        case CStreamSettings::EV_EDGE_FALL:
+            return valid && prev > trigger.level && value <= trigger.level;
+        case CStreamSettings::EV_WINDOW_OUT:
+            return valid && inside(prev) && !inside(value);
+        case CStreamSettings::EV_WINDOW_IN:
+            return valid && !inside(prev) && inside(value);
+        case CStreamSettings::EV_SLOPE:
+            if (!valid) return false;
+            return trigger.level >= 0 ? value - prev >= trigger.level : value - prev <= trigger.level;
+        default:
+            return false;
+    }
+}
+
+auto CStreamingEventDetector::addEvent(uint64_t index) -> void{
+    Window window;
+    window.id = ++m_eventsCount;
+    window.begin = index > m_pre ? index - m_pre : 0;
+    // Hold-off starts behind the previous window, so windows never overlap
+    window.begin = std::max(window.begin,m_armedFrom > m_holdoff ? m_armedFrom - m_holdoff : 0);
+    window.end = index + m_post;
+    m_armedFrom = window.end + m_holdoff;
+    m_windows.push_back(window);
+    eventNotify(window.id,index);
+}
+
+auto CStreamingEventDetector::scanPack(DataLib::CDataBuffersPack::Ptr pack) -> void{
+    uint64_t start = pack->getSampleIndex();
+    uint64_t samples = pack->getBuffersSamples();
+    if (!m_preChecked && samples){
+        // The history has to fit into the ring together with the packs being written
+        uint64_t maxPre = (m_buffer->getRingSize() / 2) * samples;
+        if (m_pre > maxPre){
+            aprintf(stderr,"[CStreamingEventDetector] Pre-trigger length is limited by the buffer to %llu samples\n",(unsigned long long)maxPre);
+            m_pre = maxPre;
+        }
+        m_preChecked = true;
+    }
+    if (start != m_scanEnd){
+        m_trigger[0].prevValid = false;
+        m_trigger[1].prevValid = false;
+    }
+
+    const uint8_t *data[2] = {nullptr,nullptr};
+    uint8_t bits[2] = {0,0};
+    for(int ch = 0; ch < 2; ch++){
+        auto buff = pack->getBuffer((DataLib::EDataBuffersPackChannel)ch);
+        if (m_trigger[ch].type != CStreamSettings::EV_OFF && buff && buff->getSamplesCount() >= samples){
+            data[ch] = buff->getBuffer().get();
+            bits[ch] = buff->getBitBySample();
+        }
+    }
+
+    for(uint64_t i = 0; i < samples; i++){
+        bool hit = false;
+        for(int ch = 0; ch < 2; ch++){
+            if (!data[ch]) continue;
+            int32_t value = bits[ch] > 8 ? reinterpret_cast<const int16_t*>(data[ch])[i] : reinterpret_cast<const int8_t*>(data[ch])[i];
+            hit |= check(m_trigger[ch],value);
+        }
+        if (hit && start + i >= m_armedFrom){
+            addEvent(start + i);
+        }
+    }
+    m_scanEnd = start + samples;
+}
+
+auto CStreamingEventDetector::scan() -> void{
+    auto filled = m_buffer->getFilledCount();
+    while(m_scanned < filled){
+        auto pack = m_buffer->readBuffer(m_scanned);
+        if (!pack) break;
+        scanPack(pack);
+        m_scanned++;
+    }
+}
+
+auto CStreamingEventDetector::createSlice(DataLib::CDataBuffersPack::Ptr head,const Window &window,uint64_t begin,uint64_t end,uint64_t lost) -> DataLib::CDataBuffersPack::Ptr{
+    auto slice = DataLib::CDataBuffersPack::Create();
+    uint64_t start = head->getSampleIndex();
+    for(int ch = (int)DataLib::CH1; ch <= (int)DataLib::CH4; ch++){
+        auto buff = head->getBuffer((DataLib::EDataBuffersPackChannel)ch);
+        if (!buff) continue;
+        uint64_t bytes = buff->getBitBySample() / 8;
+        // Points into the ring, the head stays locked until the slice is unlocked
+        auto data = std::shared_ptr<uint8_t[]>(buff->getBuffer(),buff->getBuffer().get() + (begin - start) * bytes);
+        auto part = DataLib::CDataBuffer::Create(data,(end - begin) * bytes,buff->getBitBySample());
+        part->setADCMode(buff->getADCMode());
+        uint64_t fpgaLost = std::min(buff->getLostSamples(DataLib::FPGA),lost);
+        part->setLostSamples(DataLib::FPGA,fpgaLost);
+        part->setLostSamples(DataLib::RP_INTERNAL_BUFFER,lost - fpgaLost);
+        slice->addBuffer((DataLib::EDataBuffersPackChannel)ch,part);
+    }
+    slice->setOSCRate(head->getOSCRate());
+    slice->setADCBits(head->getADCBits());
+    slice->setSampleIndex(begin);
+    slice->setEventId(window.id);
+    return slice;
+}
+
+auto CStreamingEventDetector::readBuffer() -> DataLib::CDataBuffersPack::Ptr{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (m_current){
+        return m_current;
+    }
+    scan();
+    while(m_scanned){
+        auto head = m_buffer->readBuffer();
+        if (!head) break;
+        uint64_t start = head->getSampleIndex();
+        uint64_t end = start + head->getBuffersSamples();
+        m_headPos = std::max(m_headPos,start);
+        while(!m_windows.empty() && m_windows.front().end <= m_headPos){
+            m_windows.pop_front();
+        }
+
+        if (!m_windows.empty() && m_windows.front().begin < end && m_headPos < end){
+            const auto &window = m_windows.front();
+            uint64_t sliceBegin = std::max(window.begin,m_headPos);
+            uint64_t sliceEnd = std::min(window.end,end);
+            uint64_t lost = 0;
+            if (sliceEnd == end && window.end > end){
+                // Samples dropped behind the head are known only from the index of the next pack
+                auto next = m_buffer->readBuffer(1);
+                if (!next || m_scanned < 2) break;
+                lost = std::min(std::max(next->getSampleIndex(),end),window.end) - end;
+            }
+            m_current = createSlice(head,window,sliceBegin,sliceEnd,lost);
+            m_headPos = sliceEnd;
+            return m_current;
+        }
+
+        // No future window can reach back into the head any more
+        if (end + m_pre <= std::max(m_scanEnd,m_armedFrom)){
+            m_buffer->unlockBufferRead();
+            m_scanned--;
+            m_headPos = end;
+            continue;
+        }
+        break;
+    }
+    return nullptr;
+}
+
+auto CStreamingEventDetector::unlockBufferRead() -> void{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_current = nullptr;
+}
@@ -0,0 +1,90 @@
+#ifndef STREAMING_LIB_STREAMING_EVENT_H
+#define STREAMING_LIB_STREAMING_EVENT_H
+
+#include <deque>
+#include <mutex>
+
+#include "data_lib/signal.hpp"
+#include "data_lib/buffers_pack.h"
+#include "settings_lib/stream_settings.h"
+#include "streaming_buffer_cached.h"
+
+namespace streaming_lib {
+
+/**
+ * Event triggered recording on top of the cached ring.
+ * Filled packs are scanned for the configured criteria and stay in the ring
+ * until no future event window can reach back into them, so the ring is the
+ * pre-trigger history. Only the samples inside event windows are passed to the
+ * sinks, as packs that point into the ring memory and carry the absolute
+ * sample index and the event id. The detector replaces the ring as the source
+ * of the file and network sinks and must be used from a single reader.
+ */
+
+class CStreamingEventDetector
+{
+public:
+
+    using Ptr = std::shared_ptr<CStreamingEventDetector>;
+
+    static auto create(CStreamingBufferCached::Ptr buffer,uint32_t preSamples,uint32_t postSamples,uint32_t holdoffSamples) -> Ptr;
+
+    CStreamingEventDetector(CStreamingBufferCached::Ptr buffer,uint32_t preSamples,uint32_t postSamples,uint32_t holdoffSamples);
+    ~CStreamingEventDetector();
+
+    // Levels are raw ADC codes, triggers of both channels are combined
+    auto setChannel(DataLib::EDataBuffersPackChannel ch,CStreamSettings::EventType type,int32_t level,int32_t level2) -> void;
+
+    auto readBuffer() -> DataLib::CDataBuffersPack::Ptr;
+    auto unlockBufferRead() -> void;
+    auto getEventsCount() -> uint64_t;
+
+    // Event id and the index of the trigger sample
+    sigslot::signal<uint64_t,uint64_t> eventNotify;
+
+private:
+
+    struct Trigger{
+        CStreamSettings::EventType type = CStreamSettings::EV_OFF;
+        int32_t level  = 0;
+        int32_t level2 = 0;
+        int32_t prev   = 0;
+        bool    prevValid = false;
+    };
+
+    struct Window{
+        uint64_t id    = 0;
+        uint64_t begin = 0;
+        uint64_t end   = 0;
+    };
+
+    CStreamingEventDetector(const CStreamingEventDetector &) = delete;
+    CStreamingEventDetector(CStreamingEventDetector &&) = delete;
+    CStreamingEventDetector& operator=(const CStreamingEventDetector&) =delete;
+    CStreamingEventDetector& operator=(const CStreamingEventDetector&&) =delete;
+
+    auto scan() -> void;
+    auto scanPack(DataLib::CDataBuffersPack::Ptr pack) -> void;
+    auto check(Trigger &trigger,int32_t value) -> bool;
+    auto addEvent(uint64_t index) -> void;
+    auto createSlice(DataLib::CDataBuffersPack::Ptr head,const Window &window,uint64_t begin,uint64_t end,uint64_t lost) -> DataLib::CDataBuffersPack::Ptr;
+
+    CStreamingBufferCached::Ptr         m_buffer;
+    uint64_t                            m_pre;
+    uint64_t                            m_post;
+    uint64_t                            m_holdoff;
+    Trigger                             m_trigger[2];
+    std::deque<Window>                  m_windows;
+    uint32_t                            m_scanned;      // packs behind the read position already scanned
+    uint64_t                            m_scanEnd;
+    uint64_t                            m_armedFrom;
+    uint64_t                            m_headPos;
+    uint64_t                            m_eventsCount;
+    bool                                m_preChecked;
+    DataLib::CDataBuffersPack::Ptr      m_current;
+    std::mutex                          m_mtx;
+};
+
+}
+
+#endif
@@ -373,6 +373,7 @@ auto CStreamingFile::passBuffers(DataLib::CDataBuffersPack::Ptr pack) -> int {
         }
     }
     m_fileLogger->addMetric(CFileLogger::EMetric::OSC_RATE,pack->getOSCRate());
+    m_fileLogger->addEvent(pack);
     m_fileLogger->addMetric(pack);
 
     if (m_samples){
@@ -3,6 +3,7 @@
 #include <fstream>
 #include <functional>
 #include <cstdlib>
+#include <cstring>
 #include <unistd.h>
 #include <signal.h>
 
@@ -21,11 +22,13 @@ CStreamingFPGA::CStreamingFPGA(uio_lib::COscilloscope::Ptr _osc, uint8_t _adc_bi
     mtx(),
     m_isRun(false),
     m_adc_bits(_adc_bits),
+    m_sampleIndex(0),
     m_BytesCount(0),
     m_testMode(false),
     m_verbMode(false),
     m_printDebugBuffer(false),
-    m_adcSettings()
+    m_adcSettings(),
+    m_localRing(nullptr)
 {
     m_passRate = 0;
     m_OscThreadRun = false;
@@ -106,6 +109,7 @@ void CStreamingFPGA::oscWorker(){
     long long int timeBegin = value.count();
 
     m_passRate = 0;
+    m_sampleIndex = 0;
 
     if (m_testMode) {
         m_testBuffer = new uint8_t[uio_lib::osc_buf_size];
@@ -218,11 +222,37 @@ void CStreamingFPGA::oscWorker(){
         return nullptr;
     }
 
+    // The index also advances over dropped packs, so consumers can place every pack in time
+    uint64_t samples = size;
+    if (!m_adcSettings.empty() && m_adcSettings.begin()->second.m_bits > 8){
+        samples = size / 2;
+    }
+    uint64_t sampleIndex = m_sampleIndex;
+    m_sampleIndex += samples + overFlow;
+
+    if (m_localRing){
+        CShmPackInfo info;
+        memset(&info,0,sizeof(info));
+        info.sampleIndex = sampleIndex;
+        info.oscRate = m_Osc_ch->getOSCRate();
+        info.lostFPGA = overFlow;
+        info.adcBits = m_adc_bits;
+        const uint8_t *data[STREAMING_SHM_CHANNELS] = {};
+        for(auto &s : m_adcSettings){
+            data[s.first] = s.first == DataLib::CH1 ? buffer_ch1 : buffer_ch2;
+            info.size[s.first] = size;
+            info.adcMode[s.first] = s.second.m_mode;
+        }
+        m_localRing->passChannels(info,data);
+    }
+
     auto pack = getBuffF(overFlow);
 
     if (pack){
         pack->setOSCRate(m_Osc_ch->getOSCRate());
         pack->setADCBits(m_adc_bits);
+        pack->setSampleIndex(sampleIndex);
+        pack->setEventId(0);
 
         if (m_adcSettings.find(DataLib::EDataBuffersPackChannel::CH1) != m_adcSettings.end()){
             auto settings = m_adcSettings.at(DataLib::EDataBuffersPackChannel::CH1);
@@ -254,6 +284,10 @@ auto CStreamingFPGA::setTestMode(bool mode) -> void{
     m_testMode = mode;
 }
 
+auto CStreamingFPGA::setLocalRing(CStreamingShm::Ptr ring) -> void{
+    m_localRing = ring;
+}
+
 auto CStreamingFPGA::setVerbousMode(bool mode) -> void{
     m_verbMode = mode;
 }
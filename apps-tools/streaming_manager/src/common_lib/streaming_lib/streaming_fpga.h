@@ -13,6 +13,7 @@
 #include "data_lib/buffer.h"
 #include "data_lib/buffers_pack.h"
 #include "data_lib/thread_cout.h"
+#include "streaming_shm.h"
 
 namespace streaming_lib {
 
@@ -37,6 +38,9 @@ public:
     auto setTestMode(bool mode) -> void;
     auto setVerbousMode(bool mode) -> void;
     auto setPrintDebugBuffer(bool mode) -> void;
+    // Every DMA buffer is published to the ring before it is copied into the cached buffer,
+    // so local consumers do not lose data when the network or the file sink falls behind
+    auto setLocalRing(CStreamingShm::Ptr ring) -> void;
 
     sigslot::signal<DataLib::CDataBuffersPack::Ptr> oscNotify;
     sigslot::signal<bool> isRunNotify;
@@ -66,6 +70,7 @@ private:
     
     uint64_t         m_passRate;
     uint8_t          m_adc_bits;
+    uint64_t         m_sampleIndex;
   
     uintmax_t        m_BytesCount;
     bool             m_testMode;
@@ -73,6 +78,7 @@ private:
     bool             m_printDebugBuffer;
 
     std::map<DataLib::EDataBuffersPackChannel,SADCsettings> m_adcSettings;
+    CStreamingShm::Ptr m_localRing;
 
     auto oscWorker() -> void;
     auto passCh() -> DataLib::CDataBuffersPack::Ptr;
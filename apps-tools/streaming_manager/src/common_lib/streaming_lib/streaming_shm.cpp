@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <new>
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysinfo.h>
+#include <sys/un.h>
+#include <linux/futex.h>
+
+#include "streaming_shm.h"
+#include "data_lib/neon_asm.h"
+#include "data_lib/thread_cout.h"
+
+#define SHM_HEADER_SIZE     4096
+#define SHM_ALIGN           64
+// The ring takes at most this much and never more than 1/SHM_FREE_RAM_PART of the free memory
+#define SHM_MAX_MEMORY      (8 * 1024 * 1024)
+#define SHM_FREE_RAM_PART   4
+#define SHM_MAX_CONSUMERS   16
+#define SHM_POLL_TIMEOUT    100
+
+using namespace streaming_lib;
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),"Futex word must be a plain 32 bit integer");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,"Ring counters are shared between processes");
+
+namespace {
+
+auto alignSize(size_t size) -> size_t{
+    return (size + SHM_ALIGN - 1) / SHM_ALIGN * SHM_ALIGN;
+}
+
+// The ring is shared between processes, so the futex calls are not private
+auto futexWake(std::atomic<uint32_t> *word) -> void{
+    syscall(SYS_futex,reinterpret_cast<uint32_t*>(word),FUTEX_WAKE,INT_MAX,nullptr,nullptr,0);
+}
+
+auto futexWait(const std::atomic<uint32_t> *word,uint32_t value,uint32_t timeoutMs) -> void{
+    timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000;
+    syscall(SYS_futex,reinterpret_cast<const uint32_t*>(word),FUTEX_WAIT,value,&timeout,nullptr,0);
+}
+
+auto memoryLimit() -> size_t{
+    struct sysinfo info;
+    if (sysinfo(&info) != 0) return SHM_MAX_MEMORY;
+    return std::min<size_t>(SHM_MAX_MEMORY,(uint64_t)info.freeram * info.mem_unit / SHM_FREE_RAM_PART);
+}
+
+auto socketAddress(const std::string &name,sockaddr_un &addr) -> socklen_t{
+    memset(&addr,0,sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    auto len = std::min(name.size(),sizeof(addr.sun_path) - 1);
+    // Abstract namespace, nothing is left in the file system after a crash
+    memcpy(addr.sun_path + 1,name.c_str(),len);
+    return offsetof(sockaddr_un,sun_path) + 1 + len;
+}
+
+}
+
+auto CStreamingShm::create(uint32_t slots,const std::string &name) -> CStreamingShm::Ptr{
+    return std::make_shared<CStreamingShm>(slots,name);
+}
+
+CStreamingShm::CStreamingShm(uint32_t slots,const std::string &name) :
+    m_slots(std::max<uint32_t>(slots,2)),
+    m_name(name),
+    m_channelsSize(),
+    m_fd(-1),
+    m_readFd(-1),
+    m_socket(-1),
+    m_memory(nullptr),
+    m_memorySize(0),
+    m_header(nullptr),
+    m_thread(),
+    m_mtx()
+{
+    m_consumers = 0;
+    m_threadRun = false;
+}
+
+CStreamingShm::~CStreamingShm(){
+    stop();
+}
+
+auto CStreamingShm::addChannel(DataLib::EDataBuffersPackChannel ch,size_t size,uint8_t bitBySample) -> void{
+    if (ch >= STREAMING_SHM_CHANNELS) return;
+    m_channelsSize[ch] = {size,bitBySample};
+}
+
+auto CStreamingShm::generateRing() -> bool{
+    size_t slotSize = alignSize(sizeof(CShmSlotHeader));
+    for(auto &s : m_channelsSize){
+        slotSize += alignSize(s.second.first);
+    }
+    m_memorySize = SHM_HEADER_SIZE + (size_t)m_slots * slotSize;
+    auto limit = memoryLimit();
+    if (m_memorySize > limit){
+        aprintf(stderr,"[CStreamingShm] Ring of %u slots needs %zu bytes, the limit is %zu bytes (%zu slots)\n",
+                m_slots,m_memorySize,limit,limit > SHM_HEADER_SIZE ? (limit - SHM_HEADER_SIZE) / slotSize : 0);
+        m_memorySize = 0;
+        return false;
+    }
+
+    m_fd = memfd_create("rpsa_adc_ring",MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (m_fd < 0 || ftruncate(m_fd,m_memorySize) != 0){
+        aprintf(stderr,"[CStreamingShm] Can't create shared memory: %s\n",strerror(errno));
+        return false;
+    }
+    // Consumers may not resize the ring under the mappings of the others
+    fcntl(m_fd,F_ADD_SEALS,F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+    auto mem = mmap(nullptr,m_memorySize,PROT_READ | PROT_WRITE,MAP_SHARED,m_fd,0);
+    if (mem == MAP_FAILED){
+        aprintf(stderr,"[CStreamingShm] Can't map shared memory: %s\n",strerror(errno));
+        return false;
+    }
+    m_memory = static_cast<uint8_t*>(mem);
+    // Consumers get a descriptor opened read only, so their mappings can't be writable
+    auto path = "/proc/self/fd/" + std::to_string(m_fd);
+    m_readFd = open(path.c_str(),O_RDONLY | O_CLOEXEC);
+    if (m_readFd < 0){
+        aprintf(stderr,"[CStreamingShm] Can't open shared memory for read: %s\n",strerror(errno));
+        return false;
+    }
+
+    m_header = new (m_memory) CShmRingHeader();
+    m_header->magic = STREAMING_SHM_MAGIC;
+    m_header->version = STREAMING_SHM_VERSION;
+    m_header->slotsCount = m_slots;
+    m_header->slotSize = slotSize;
+    m_header->slotsOffset = SHM_HEADER_SIZE;
+    uint32_t offset = alignSize(sizeof(CShmSlotHeader));
+    for(auto &s : m_channelsSize){
+        m_header->channelOffset[s.first] = offset;
+        m_header->channelSize[s.first] = s.second.first;
+        m_header->channelBits[s.first] = s.second.second;
+        offset += alignSize(s.second.first);
+    }
+    for(uint32_t i = 0; i < m_slots; i++){
+        new (m_memory + SHM_HEADER_SIZE + (size_t)i * slotSize) CShmSlotHeader();
+    }
+    m_header->notify = 0;
+    m_header->written = 0;
+    m_header->running = 1;
+    return true;
+}
+
+auto CStreamingShm::openSocket() -> bool{
+    m_socket = socket(AF_UNIX,SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK,0);
+    if (m_socket < 0){
+        aprintf(stderr,"[CStreamingShm] Can't create socket: %s\n",strerror(errno));
+        return false;
+    }
+    sockaddr_un addr;
+    auto len = socketAddress(m_name,addr);
+    if (bind(m_socket,reinterpret_cast<sockaddr*>(&addr),len) != 0 || ::listen(m_socket,SHM_MAX_CONSUMERS) != 0){
+        aprintf(stderr,"[CStreamingShm] Can't listen on %s: %s\n",m_name.c_str(),strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+auto CStreamingShm::run() -> bool{
+    if (m_threadRun) return true;
+    if (!generateRing() || !openSocket()){
+        release();
+        return false;
+    }
+    try{
+        m_threadRun = true;
+        m_thread = std::thread(&CStreamingShm::worker, this);
+    }
+    catch (const std::system_error &e)
+    {
+        m_threadRun = false;
+        aprintf(stderr,"Error: CStreamingShm::run() %s\n",e.what());
+        release();
+        return false;
+    }
+    return true;
+}
+
+auto CStreamingShm::stop() -> void{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if (m_header){
+            m_header->running.store(0,std::memory_order_release);
+            m_header->notify.fetch_add(1,std::memory_order_release);
+            futexWake(&m_header->notify);
+        }
+    }
+    m_threadRun = false;
+    if (m_thread.joinable()){
+        m_thread.join();
+    }
+    release();
+}
+
+auto CStreamingShm::release() -> void{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    // Mappings of the consumers keep the memory alive, they see the ring as stopped
+    if (m_memory){
+        munmap(m_memory,m_memorySize);
+    }
+    m_memory = nullptr;
+    m_header = nullptr;
+    for(auto fd : {&m_fd,&m_readFd,&m_socket}){
+        if (*fd >= 0){
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+auto CStreamingShm::getConsumersCount() -> uint32_t{
+    return m_consumers;
+}
+
+auto CStreamingShm::checkPeer(int socket) -> bool{
+    // The abstract socket is open to every process, only the server user, its group and root get the ring
+    ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(socket,SOL_SOCKET,SO_PEERCRED,&cred,&len) != 0 || len != sizeof(cred)){
+        aprintf(stderr,"[CStreamingShm] Can't get consumer credentials: %s\n",strerror(errno));
+        return false;
+    }
+    if (cred.uid == 0 || cred.uid == geteuid() || cred.gid == getegid()){
+        return true;
+    }
+    aprintf(stderr,"[CStreamingShm] Consumer pid %d uid %u is not allowed\n",cred.pid,cred.uid);
+    return false;
+}
+
+auto CStreamingShm::sendDescriptor(int socket) -> bool{
+    uint64_t size = m_memorySize;
+    iovec iov;
+    iov.iov_base = &size;
+    iov.iov_len = sizeof(size);
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control,0,sizeof(control));
+    msghdr msg;
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg),&m_readFd,sizeof(int));
+    return sendmsg(socket,&msg,MSG_NOSIGNAL) == sizeof(size);
+}
+
+auto CStreamingShm::worker() -> void{
+    // Open sockets tell how many consumers are mapped, nothing else is sent after the descriptor
+    std::vector<int> clients;
+    std::vector<pollfd> fds;
+    while(m_threadRun){
+        fds.clear();
+        fds.push_back({m_socket,POLLIN,0});
+        for(auto c : clients){
+            fds.push_back({c,POLLIN,0});
+        }
+        if (poll(fds.data(),fds.size(),SHM_POLL_TIMEOUT) <= 0) continue;
+
+        for(size_t i = fds.size() - 1; i > 0; i--){
+            if (!fds[i].revents) continue;
+            char buff[16];
+            if ((fds[i].revents & (POLLHUP | POLLERR)) || recv(fds[i].fd,buff,sizeof(buff),MSG_DONTWAIT) <= 0){
+                close(fds[i].fd);
+                clients.erase(clients.begin() + (i - 1));
+            }
+        }
+
+        if (fds[0].revents & POLLIN){
+            int c = accept4(m_socket,nullptr,nullptr,SOCK_CLOEXEC);
+            if (c >= 0){
+                if (clients.size() < SHM_MAX_CONSUMERS && checkPeer(c) && sendDescriptor(c)){
+                    clients.push_back(c);
+                }else{
+                    aprintf(stderr,"[CStreamingShm] Consumer is rejected\n");
+                    close(c);
+                }
+            }
+        }
+        m_consumers = clients.size();
+    }
+    for(auto c : clients){
+        close(c);
+    }
+    m_consumers = 0;
+}
+
+auto CStreamingShm::passBuffers(DataLib::CDataBuffersPack::Ptr pack) -> void{
+    if (!pack) return;
+    CShmPackInfo info;
+    memset(&info,0,sizeof(info));
+    info.sampleIndex = pack->getSampleIndex();
+    info.eventId = pack->getEventId();
+    info.oscRate = pack->getOSCRate();
+    info.adcBits = pack->getADCBits();
+    const uint8_t *data[STREAMING_SHM_CHANNELS] = {};
+    for(uint32_t ch = 0; ch < STREAMING_SHM_CHANNELS; ch++){
+        auto buff = pack->getBuffer((DataLib::EDataBuffersPackChannel)ch);
+        if (!buff) continue;
+        data[ch] = buff->getBuffer().get();
+        info.size[ch] = buff->getBufferLenght();
+        info.adcMode[ch] = buff->getADCMode();
+        info.lostFPGA = buff->getLostSamples(DataLib::FPGA);
+    }
+    passChannels(info,data);
+}
+
+auto CStreamingShm::passChannels(const CShmPackInfo &pack,const uint8_t * const *data) -> void{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (!m_header) return;
+    auto seq = m_header->written.load(std::memory_order_relaxed);
+    auto base = m_memory + m_header->slotsOffset + (seq % m_header->slotsCount) * m_header->slotSize;
+    auto slot = reinterpret_cast<CShmSlotHeader*>(base);
+    slot->stamp.store(seq * 2 + 1,std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto &info = slot->info;
+    info = pack;
+    for(uint32_t ch = 0; ch < STREAMING_SHM_CHANNELS; ch++){
+        if (!m_header->channelSize[ch] || !data[ch]){
+            info.size[ch] = 0;
+            continue;
+        }
+        info.size[ch] = std::min<uint32_t>(pack.size[ch],m_header->channelSize[ch]);
+        memcpy_neon(base + m_header->channelOffset[ch],data[ch],info.size[ch]);
+    }
+
+    slot->stamp.store(seq * 2 + 2,std::memory_order_release);
+    m_header->written.store(seq + 1,std::memory_order_release);
+    m_header->notify.fetch_add(1,std::memory_order_release);
+    // Consumers map the ring read only and can't announce that they wait, so the wake is unconditional.
+    // Without waiters it is a short syscall per pack.
+    futexWake(&m_header->notify);
+}
+
+
+auto CStreamingShmClient::create() -> CStreamingShmClient::Ptr{
+    return std::make_shared<CStreamingShmClient>();
+}
+
+CStreamingShmClient::CStreamingShmClient() :
+    m_socket(-1),
+    m_memory(nullptr),
+    m_header(nullptr),
+    m_next(0),
+    m_expectedIndex(0),
+    m_expectedValid(false),
+    m_lostSamples(0),
+    m_overruns(0),
+    m_current(nullptr),
+    m_currentSeq(0),
+    m_mtx()
+{
+}
+
+CStreamingShmClient::~CStreamingShmClient(){
+    disconnect();
+}
+
+auto CStreamingShmClient::connect(const std::string &name) -> bool{
+    disconnect();
+    std::lock_guard<std::mutex> lock(m_mtx);
+    int s = socket(AF_UNIX,SOCK_SEQPACKET | SOCK_CLOEXEC,0);
+    if (s < 0){
+        aprintf(stderr,"[CStreamingShmClient] Can't create socket: %s\n",strerror(errno));
+        return false;
+    }
+    sockaddr_un addr;
+    auto len = socketAddress(name,addr);
+    if (::connect(s,reinterpret_cast<sockaddr*>(&addr),len) != 0){
+        aprintf(stderr,"[CStreamingShmClient] Can't connect to %s: %s\n",name.c_str(),strerror(errno));
+        close(s);
+        return false;
+    }
+
+    uint64_t size = 0;
+    iovec iov;
+    iov.iov_base = &size;
+    iov.iov_len = sizeof(size);
+    char control[CMSG_SPACE(sizeof(int))];
+    msghdr msg;
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    int fd = -1;
+    if (recvmsg(s,&msg,MSG_CMSG_CLOEXEC) == sizeof(size)){
+        auto cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS){
+            memcpy(&fd,CMSG_DATA(cmsg),sizeof(int));
+        }
+    }
+    struct stat st;
+    if (fd < 0 || fstat(fd,&st) != 0 || (uint64_t)st.st_size < size || size < SHM_HEADER_SIZE){
+        aprintf(stderr,"[CStreamingShmClient] Server did not pass the ring\n");
+        if (fd >= 0) close(fd);
+        close(s);
+        return false;
+    }
+    auto mem = mmap(nullptr,size,PROT_READ,MAP_SHARED,fd,0);
+    close(fd);
+    if (mem == MAP_FAILED){
+        aprintf(stderr,"[CStreamingShmClient] Can't map the ring: %s\n",strerror(errno));
+        close(s);
+        return false;
+    }
+    // Packs returned to the user hold the mapping, it is unmapped after the last of them
+    m_memory = std::shared_ptr<uint8_t[]>(static_cast<uint8_t*>(mem),[size](uint8_t *p){ munmap(p,size); });
+    m_header = reinterpret_cast<const CShmRingHeader*>(mem);
+    if (m_header->magic != STREAMING_SHM_MAGIC || m_header->version != STREAMING_SHM_VERSION
+        || m_header->slotsCount < 2 || (uint64_t)m_header->slotsOffset + (uint64_t)m_header->slotsCount * m_header->slotSize > size){
+        aprintf(stderr,"[CStreamingShmClient] Unknown ring format\n");
+        m_memory = nullptr;
+        m_header = nullptr;
+        close(s);
+        return false;
+    }
+    m_socket = s;
+    // Reading starts with the next pack
+    m_next = m_header->written.load(std::memory_order_acquire);
+    m_expectedValid = false;
+    m_lostSamples = 0;
+    m_overruns = 0;
+    return true;
+}
+
+auto CStreamingShmClient::disconnect() -> void{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_current = nullptr;
+    m_header = nullptr;
+    m_memory = nullptr;
+    if (m_socket >= 0){
+        close(m_socket);
+        m_socket = -1;
+    }
+}
+
+auto CStreamingShmClient::isRunning() -> bool{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_header && m_header->running.load(std::memory_order_acquire);
+}
+
+auto CStreamingShmClient::slotAt(uint64_t seq) -> const CShmSlotHeader*{
+    return reinterpret_cast<const CShmSlotHeader*>(m_memory.get() + m_header->slotsOffset + (seq % m_header->slotsCount) * m_header->slotSize);
+}
+
+auto CStreamingShmClient::createPack(const CShmPackInfo &info,const CShmSlotHeader *slot) -> DataLib::CDataBuffersPack::Ptr{
+    auto pack = DataLib::CDataBuffersPack::Create();
+    uint64_t lost = m_expectedValid && info.sampleIndex > m_expectedIndex ? info.sampleIndex - m_expectedIndex : 0;
+    auto base = reinterpret_cast<uint8_t*>(const_cast<CShmSlotHeader*>(slot));
+    for(uint32_t ch = 0; ch < STREAMING_SHM_CHANNELS; ch++){
+        if (!info.size[ch] || info.size[ch] > m_header->channelSize[ch]) continue;
+        auto data = std::shared_ptr<uint8_t[]>(m_memory,base + m_header->channelOffset[ch]);
+        auto buff = DataLib::CDataBuffer::Create(data,info.size[ch],m_header->channelBits[ch]);
+        buff->setADCMode((DataLib::CDataBuffer::ADC_MODE)info.adcMode[ch]);
+        buff->setLostSamples(DataLib::FPGA,info.lostFPGA);
+        buff->setLostSamples(DataLib::RP_INTERNAL_BUFFER,lost);
+        pack->addBuffer((DataLib::EDataBuffersPackChannel)ch,buff);
+    }
+    pack->setOSCRate(info.oscRate);
+    pack->setADCBits(info.adcBits);
+    pack->setSampleIndex(info.sampleIndex);
+    pack->setEventId(info.eventId);
+    m_lostSamples += lost;
+    m_expectedIndex = info.sampleIndex + pack->getBuffersSamples() + info.lostFPGA;
+    m_expectedValid = true;
+    return pack;
+}
+
+auto CStreamingShmClient::readBuffer(uint32_t timeoutMs) -> DataLib::CDataBuffersPack::Ptr{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (!m_header) return nullptr;
+    if (m_current) return m_current;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while(true){
+        auto notify = m_header->notify.load(std::memory_order_acquire);
+        auto written = m_header->written.load(std::memory_order_acquire);
+        uint64_t slots = m_header->slotsCount;
+        // The slot of the oldest pack is already being reused, continue from the middle of the ring
+        if (written - m_next >= slots){
+            auto next = written - slots / 2;
+            m_overruns += next - m_next;
+            m_next = next;
+        }
+        while(m_next < written){
+            auto slot = slotAt(m_next);
+            auto stamp = m_next * 2 + 2;
+            if (slot->stamp.load(std::memory_order_acquire) == stamp){
+                CShmPackInfo info = slot->info;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot->stamp.load(std::memory_order_relaxed) == stamp){
+                    m_current = createPack(info,slot);
+                    m_currentSeq = m_next++;
+                    return m_current;
+                }
+            }
+            m_overruns++;
+            m_next++;
+        }
+        if (!m_header->running.load(std::memory_order_acquire)) return nullptr;
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) return nullptr;
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+        futexWait(&m_header->notify,notify,std::max<uint32_t>(left,1));
+    }
+}
+
+auto CStreamingShmClient::unlockBufferRead() -> bool{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (!m_current || !m_header) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bool valid = slotAt(m_currentSeq)->stamp.load(std::memory_order_relaxed) == m_currentSeq * 2 + 2;
+    if (!valid){
+        m_overruns++;
+        m_lostSamples += m_current->getBuffersSamples();
+    }
+    m_current = nullptr;
+    return valid;
+}
+
+auto CStreamingShmClient::getLostSamples() -> uint64_t{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_lostSamples;
+}
+
+auto CStreamingShmClient::getOverruns() -> uint64_t{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_overruns;
+}
@@ -0,0 +1,172 @@
+#ifndef STREAMING_LIB_STREAMING_SHM_H
+#define STREAMING_LIB_STREAMING_SHM_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <string>
+
+#include "data_lib/buffers_pack.h"
+
+// Abstract unix socket, the server passes the ring descriptor to consumers of its user or group
+#define STREAMING_SHM_SOCKET    "rpsa_adc_stream"
+#define STREAMING_SHM_MAGIC     0x52505348
+#define STREAMING_SHM_VERSION   1
+#define STREAMING_SHM_CHANNELS  4
+
+namespace streaming_lib {
+
+/**
+ * Layout of the shared memory. The ring header is followed by the slots, each
+ * slot is a CShmSlotHeader with the channel data at the offsets given in the
+ * ring header. A slot is valid while its stamp equals 2 * sequence + 2, the
+ * stamp is odd while the server writes into the slot.
+ */
+
+struct CShmRingHeader{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotsCount;
+    uint32_t slotSize;
+    uint32_t slotsOffset;
+    uint32_t channelOffset[STREAMING_SHM_CHANNELS];    // from the start of a slot
+    uint32_t channelSize[STREAMING_SHM_CHANNELS];      // 0 - channel is not streamed
+    uint8_t  channelBits[STREAMING_SHM_CHANNELS];
+    std::atomic<uint32_t> notify;                      // futex word, changes on every pack and on stop
+    std::atomic<uint32_t> running;
+    std::atomic<uint64_t> written;                     // packs published since start
+};
+
+struct CShmPackInfo{
+    uint64_t sampleIndex;
+    uint64_t eventId;
+    uint64_t oscRate;
+    uint64_t lostFPGA;                                 // samples dropped by the FPGA behind this pack
+    uint32_t size[STREAMING_SHM_CHANNELS];             // bytes, 0 - no data for the channel
+    uint8_t  adcMode[STREAMING_SHM_CHANNELS];
+    uint8_t  adcBits;
+};
+
+struct CShmSlotHeader{
+    std::atomic<uint64_t> stamp;
+    CShmPackInfo          info;
+};
+
+/**
+ * Publishes the ADC packs to processes on the board through a memfd ring.
+ * passBuffers() is called from the acquisition thread, it copies the pack into
+ * the next slot and wakes the waiting consumers with a futex. The server never
+ * waits for consumers: a consumer that is too slow finds its slots overwritten
+ * and accounts the skipped samples as lost. Consumers get a read-only
+ * descriptor, so they can not change the ring. The ring is limited to a few
+ * megabytes, run() fails if the requested slots do not fit.
+ */
+
+class CStreamingShm
+{
+public:
+
+    using Ptr = std::shared_ptr<CStreamingShm>;
+
+    static auto create(uint32_t slots,const std::string &name = STREAMING_SHM_SOCKET) -> Ptr;
+
+    CStreamingShm(uint32_t slots,const std::string &name);
+    ~CStreamingShm();
+
+    // Size is the largest buffer of the channel in bytes
+    auto addChannel(DataLib::EDataBuffersPackChannel ch,size_t size,uint8_t bitBySample) -> void;
+    auto run() -> bool;
+    auto stop() -> void;
+    auto passBuffers(DataLib::CDataBuffersPack::Ptr pack) -> void;
+    // Copies the channel data straight from the acquisition buffers, data is indexed by channel and may be null
+    auto passChannels(const CShmPackInfo &info,const uint8_t * const *data) -> void;
+    auto getConsumersCount() -> uint32_t;
+
+private:
+
+    CStreamingShm(const CStreamingShm &) = delete;
+    CStreamingShm(CStreamingShm &&) = delete;
+    CStreamingShm& operator=(const CStreamingShm&) =delete;
+    CStreamingShm& operator=(const CStreamingShm&&) =delete;
+
+    auto generateRing() -> bool;
+    auto openSocket() -> bool;
+    auto worker() -> void;
+    auto checkPeer(int socket) -> bool;
+    auto sendDescriptor(int socket) -> bool;
+    auto release() -> void;
+
+    uint32_t                        m_slots;
+    std::string                     m_name;
+    std::map<DataLib::EDataBuffersPackChannel,std::pair<size_t,uint8_t>> m_channelsSize;
+    int                             m_fd;
+    int                             m_readFd;
+    int                             m_socket;
+    uint8_t                        *m_memory;
+    size_t                          m_memorySize;
+    CShmRingHeader                 *m_header;
+    std::atomic<uint32_t>           m_consumers;
+    std::atomic_bool                m_threadRun;
+    std::thread                     m_thread;
+    std::mutex                      m_mtx;
+};
+
+/**
+ * Consumer side of the ring, used by processes on the board instead of the
+ * network client. readBuffer() returns packs that point into the read-only
+ * mapping, the data has to be used before unlockBufferRead(), which reports
+ * whether the server overwrote the slot in the meantime. Samples missing
+ * before a pack, whatever the reason, are set as RP_INTERNAL_BUFFER lost of
+ * that pack.
+ */
+
+class CStreamingShmClient
+{
+public:
+
+    using Ptr = std::shared_ptr<CStreamingShmClient>;
+
+    static auto create() -> Ptr;
+
+    CStreamingShmClient();
+    ~CStreamingShmClient();
+
+    auto connect(const std::string &name = STREAMING_SHM_SOCKET) -> bool;
+    auto disconnect() -> void;
+    auto isRunning() -> bool;
+
+    // Waits for the next pack, nullptr on timeout or when the server stopped
+    auto readBuffer(uint32_t timeoutMs) -> DataLib::CDataBuffersPack::Ptr;
+    // False if the pack was overwritten while it was read, its samples are then counted as lost
+    auto unlockBufferRead() -> bool;
+
+    auto getLostSamples() -> uint64_t;
+    auto getOverruns() -> uint64_t;
+
+private:
+
+    CStreamingShmClient(const CStreamingShmClient &) = delete;
+    CStreamingShmClient(CStreamingShmClient &&) = delete;
+    CStreamingShmClient& operator=(const CStreamingShmClient&) =delete;
+    CStreamingShmClient& operator=(const CStreamingShmClient&&) =delete;
+
+    auto slotAt(uint64_t seq) -> const CShmSlotHeader*;
+    auto createPack(const CShmPackInfo &info,const CShmSlotHeader *slot) -> DataLib::CDataBuffersPack::Ptr;
+
+    int                             m_socket;
+    std::shared_ptr<uint8_t[]>      m_memory;
+    const CShmRingHeader           *m_header;
+    uint64_t                        m_next;
+    uint64_t                        m_expectedIndex;
+    bool                            m_expectedValid;
+    uint64_t                        m_lostSamples;
+    uint64_t                        m_overruns;
+    DataLib::CDataBuffersPack::Ptr  m_current;
+    uint64_t                        m_currentSeq;
+    std::mutex                      m_mtx;
+};
+
+}
+
+#endif
@@ -0,0 +1,229 @@
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <pthread.h>
+
+#include "streaming_stats.h"
+#include "kiss_fftr.h"
+#include "data_lib/neon_asm.h"
+#include "data_lib/thread_cout.h"
+
+// Welch segments overlap by half, the spectrum is reduced to a fixed number of points
+#define STATS_FFT_SIZE          1024
+#define STATS_SPECTRUM_POINTS   128
+// Packs copied from the acquisition thread per report period
+#define STATS_MAX_PACKS         16
+#define STATS_MAX_RATE          10
+// Samples closer than 1/1024 of full scale to the range ends count as saturated
+#define STATS_SATURATION_SHIFT  10
+
+// The spectrum buffers are passed to kiss_fftr as they are
+static_assert(std::is_same<kiss_fft_scalar,double>::value,"kiss_fft is expected to be built with double samples");
+static_assert(sizeof(kiss_fft_cpx) == sizeof(std::complex<double>),"kiss_fft_cpx does not match std::complex");
+
+using namespace streaming_lib;
+
+auto CStreamingStats::create(uint32_t reportRate) -> CStreamingStats::Ptr{
+    return std::make_shared<CStreamingStats>(reportRate);
+}
+
+CStreamingStats::CStreamingStats(uint32_t reportRate) :
+    m_reportRate(std::min<uint32_t>(std::max<uint32_t>(reportRate,1),STATS_MAX_RATE)),
+    m_budget(0),
+    m_oscRate(0),
+    m_staging(),
+    m_acc(),
+    m_window(STATS_FFT_SIZE),
+    m_fftCfg(kiss_fftr_alloc(STATS_FFT_SIZE,0,NULL,NULL)),
+    m_fftIn(STATS_FFT_SIZE),
+    m_fftOut(STATS_FFT_SIZE / 2 + 1),
+    m_pending(false),
+    m_thread(),
+    m_mtx(),
+    m_cv()
+{
+    m_threadRun = false;
+    for(size_t i = 0; i < STATS_FFT_SIZE; i++){
+        m_window[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / STATS_FFT_SIZE);
+    }
+    for(auto &acc : m_acc){
+        acc.power.assign(STATS_FFT_SIZE / 2 + 1,0);
+    }
+}
+
+CStreamingStats::~CStreamingStats(){
+    stop();
+    kiss_fftr_free(m_fftCfg);
+}
+
+auto CStreamingStats::run() -> void{
+    if (m_threadRun) return;
+    try{
+        m_threadRun = true;
+        m_thread = std::thread(&CStreamingStats::worker, this);
+#ifdef RP_PLATFORM
+        // Only spare CPU time is used, the acquisition and the sinks always win
+        sched_param param;
+        param.sched_priority = 0;
+        pthread_setschedparam(m_thread.native_handle(), SCHED_IDLE, &param);
+#endif
+    }
+    catch (const std::system_error &e)
+    {
+        m_threadRun = false;
+        aprintf(stderr,"Error: CStreamingStats::run() %s\n",e.what());
+    }
+}
+
+auto CStreamingStats::stop() -> void{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_threadRun = false;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()){
+        m_thread.join();
+    }
+}
+
+auto CStreamingStats::passBuffers(DataLib::CDataBuffersPack::Ptr pack) -> void{
+    if (!pack || !m_threadRun) return;
+    std::unique_lock<std::mutex> lock(m_mtx,std::try_to_lock);
+    if (!lock.owns_lock() || m_pending || m_budget >= STATS_MAX_PACKS) return;
+    for(int ch = 0; ch < 2; ch++){
+        auto buff = pack->getBuffer((DataLib::EDataBuffersPackChannel)ch);
+        auto &staging = m_staging[ch];
+        staging.present = buff && buff->getSamplesCount();
+        if (!staging.present) continue;
+        staging.size = buff->getBufferLenght();
+        if (staging.data.size() < staging.size){
+            staging.data.resize(staging.size);
+        }
+        memcpy_neon(staging.data.data(),buff->getBuffer().get(),staging.size);
+        staging.bits = buff->getBitBySample();
+        staging.scale = buff->getADCMode() == DataLib::CDataBuffer::ATT_1_20 ? 20 : 1;
+    }
+    m_oscRate = pack->getOSCRate();
+    m_pending = true;
+    m_budget++;
+    lock.unlock();
+    m_cv.notify_one();
+}
+
+auto CStreamingStats::worker() -> void{
+    auto period = std::chrono::microseconds(1000000 / m_reportRate);
+    auto next = std::chrono::steady_clock::now() + period;
+    std::unique_lock<std::mutex> lock(m_mtx);
+    while(m_threadRun){
+        m_cv.wait_until(lock,next,[this]{ return m_pending || !m_threadRun; });
+        if (!m_threadRun) break;
+        if (m_pending){
+            // Staging is not touched by passBuffers() while a pack is pending
+            lock.unlock();
+            analyse(m_staging[0],m_acc[0]);
+            analyse(m_staging[1],m_acc[1]);
+            lock.lock();
+            m_pending = false;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next){
+            auto oscRate = m_oscRate;
+            m_budget = 0;
+            lock.unlock();
+            report(oscRate);
+            lock.lock();
+            next += period;
+            if (next < now){
+                next = now + period;
+            }
+        }
+    }
+}
+
+auto CStreamingStats::analyse(Staging &staging,Accumulator &acc) -> void{
+    if (!staging.present || staging.bits < 8) return;
+    size_t  bytes = staging.bits / 8;
+    size_t  samples = staging.size / bytes;
+    int32_t full = 1 << (staging.bits - 1);
+    int32_t margin = full >> STATS_SATURATION_SHIFT;
+    int32_t minCode = std::numeric_limits<int32_t>::max();
+    int32_t maxCode = std::numeric_limits<int32_t>::min();
+    double  sum = 0;
+    double  sumSq = 0;
+    uint64_t clipped = 0;
+    auto sample = [&staging](size_t i) -> int32_t {
+        return staging.bits > 8 ? reinterpret_cast<const int16_t*>(staging.data.data())[i] : reinterpret_cast<const int8_t*>(staging.data.data())[i];
+    };
+
+    for(size_t i = 0; i < samples; i++){
+        int32_t x = sample(i);
+        minCode = std::min(minCode,x);
+        maxCode = std::max(maxCode,x);
+        sum += x;
+        sumSq += (double)x * x;
+        if (x >= full - 1 - margin || x <= -full + margin){
+            clipped++;
+        }
+    }
+    if (!samples) return;
+
+    double volt = staging.scale / full;
+    if (acc.samples == 0){
+        acc.min = minCode * volt;
+        acc.max = maxCode * volt;
+    }else{
+        acc.min = std::min(acc.min,minCode * volt);
+        acc.max = std::max(acc.max,maxCode * volt);
+    }
+    acc.samples += samples;
+    acc.clipped += clipped;
+    acc.sum += sum * volt;
+    acc.sumSq += sumSq * volt * volt;
+
+    for(size_t start = 0; start + STATS_FFT_SIZE <= samples; start += STATS_FFT_SIZE / 2){
+        for(size_t i = 0; i < STATS_FFT_SIZE; i++){
+            m_fftIn[i] = (double)sample(start + i) / full * m_window[i];
+        }
+        kiss_fftr(m_fftCfg,m_fftIn.data(),reinterpret_cast<kiss_fft_cpx*>(m_fftOut.data()));
+        for(size_t k = 0; k < acc.power.size(); k++){
+            acc.power[k] += std::norm(m_fftOut[k]);
+        }
+        acc.segments++;
+    }
+}
+
+auto CStreamingStats::report(uint64_t oscRate) -> void{
+    for(int ch = 0; ch < 2; ch++){
+        auto &acc = m_acc[ch];
+        if (!acc.samples) continue;
+        ChannelStats stats;
+        stats.samples = acc.samples;
+        stats.clipped = acc.clipped;
+        stats.min = acc.min;
+        stats.max = acc.max;
+        stats.mean = acc.sum / acc.samples;
+        stats.rms = sqrt(acc.sumSq / acc.samples);
+        if (acc.segments){
+            // A full scale sine reads 0 dB, Hann window has the coherent gain 1/2
+            double norm = 16.0 / ((double)STATS_FFT_SIZE * STATS_FFT_SIZE * acc.segments);
+            // The Nyquist bin is left out, so the points split the band evenly
+            size_t bins = acc.power.size() - 1;
+            size_t group = std::max<size_t>(bins / STATS_SPECTRUM_POINTS,1);
+            for(size_t k = 0; k < bins; k += group){
+                // Peaks are kept, so a tone keeps its level in the reduced spectrum
+                double peak = *std::max_element(acc.power.begin() + k,acc.power.begin() + std::min(k + group,bins));
+                stats.spectrum.push_back(10.0 * log10(peak * norm + 1e-20));
+            }
+            stats.stepHz = (double)oscRate / STATS_FFT_SIZE * group;
+        }
+        statsNotify((DataLib::EDataBuffersPackChannel)ch,stats);
+        acc.samples = 0;
+        acc.clipped = 0;
+        acc.sum = 0;
+        acc.sumSq = 0;
+        acc.segments = 0;
+        std::fill(acc.power.begin(),acc.power.end(),0);
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef STREAMING_LIB_STREAMING_STATS_H
+#define STREAMING_LIB_STREAMING_STATS_H
+
+#include <atomic>
+#include <complex>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "data_lib/signal.hpp"
+#include "data_lib/buffers_pack.h"
+
+struct kiss_fftr_state;
+
+namespace streaming_lib {
+
+/**
+ * Low priority monitor of the ADC stream.
+ * passBuffers() is called from the acquisition thread and never waits: a pack
+ * is copied only when the worker is idle and the budget of the current report
+ * period is not used up, otherwise it is skipped. The worker computes min, max,
+ * mean, RMS and the saturation count in volts and a Welch spectrum in dBFS,
+ * and reports them a few times per second. The values describe the analysed
+ * packs, not the whole stream.
+ */
+
+class CStreamingStats
+{
+public:
+
+    struct ChannelStats{
+        uint64_t samples = 0;       // analysed samples
+        uint64_t clipped = 0;       // samples at the ends of the ADC range
+        double   min  = 0;
+        double   max  = 0;
+        double   mean = 0;
+        double   rms  = 0;
+        double   stepHz = 0;        // width of one spectrum point
+        std::vector<float> spectrum;
+    };
+
+    using Ptr = std::shared_ptr<CStreamingStats>;
+
+    static auto create(uint32_t reportRate) -> Ptr;
+
+    CStreamingStats(uint32_t reportRate);
+    ~CStreamingStats();
+
+    auto run() -> void;
+    auto stop() -> void;
+    auto passBuffers(DataLib::CDataBuffersPack::Ptr pack) -> void;
+
+    sigslot::signal<DataLib::EDataBuffersPackChannel,const ChannelStats&> statsNotify;
+
+private:
+
+    struct Accumulator{
+        uint64_t samples = 0;
+        uint64_t clipped = 0;
+        double   min = 0;
+        double   max = 0;
+        double   sum = 0;
+        double   sumSq = 0;
+        uint64_t segments = 0;
+        std::vector<double> power;
+    };
+
+    struct Staging{
+        std::vector<uint8_t> data;
+        size_t   size = 0;
+        uint8_t  bits = 0;
+        float    scale = 1;
+        bool     present = false;
+    };
+
+    CStreamingStats(const CStreamingStats &) = delete;
+    CStreamingStats(CStreamingStats &&) = delete;
+    CStreamingStats& operator=(const CStreamingStats&) =delete;
+    CStreamingStats& operator=(const CStreamingStats&&) =delete;
+
+    auto worker() -> void;
+    auto analyse(Staging &staging,Accumulator &acc) -> void;
+    auto report(uint64_t oscRate) -> void;
+
+    uint32_t                        m_reportRate;
+    uint32_t                        m_budget;       // packs taken in the current report period
+    uint64_t                        m_oscRate;
+    Staging                         m_staging[2];
+    Accumulator                     m_acc[2];
+    std::vector<double>             m_window;
+    kiss_fftr_state                *m_fftCfg;
+    std::vector<double>             m_fftIn;
+    std::vector<std::complex<double>> m_fftOut;
+    bool                            m_pending;
+    std::atomic_bool                m_threadRun;
+    std::thread                     m_thread;
+    std::mutex                      m_mtx;
+    std::condition_variable         m_cv;
+};
+
+}
+
+#endif
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <string>
 #include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include "generator.h"
@@ -251,6 +253,36 @@ auto CGenerator::write(uint8_t *_buffer1,uint8_t *_buffer2, size_t _size_ch1, si
     return ret;
 }
 
+auto CGenerator::isWriteReady() -> bool{
+    const std::lock_guard<std::mutex> lock(m_waitLock);
+    auto status = m_Map->ch_dma_status;
+    return m_BufferNumber[0] == 0 ? (status & 0x00030003) : (status & 0x000C000C);
+}
+
+auto CGenerator::isStarved() -> bool{
+    const std::lock_guard<std::mutex> lock(m_waitLock);
+    auto status = m_Map->ch_dma_status;
+    return (status & 0x00030003) && (status & 0x000C000C);
+}
+
+auto CGenerator::wait(uint32_t timeout_us) -> bool{
+    struct timespec ts = {(time_t)(timeout_us / 1000000), (long)(timeout_us % 1000000) * 1000};
+    int32_t cnt = 1;
+    ssize_t bytes = ::write(m_Fd, &cnt, sizeof(cnt)); // Unmask interrupt
+    if (bytes == sizeof(cnt)) {
+        struct pollfd pfd = {.fd = m_Fd, .events = POLLIN ,.revents = 0};
+        int rv = ppoll(&pfd, 1, &ts, nullptr);
+        if (rv >= 1) {
+            uint32_t info;
+            read(m_Fd, &info, sizeof(info));
+            return true;
+        }
+        return false;
+    }
+    // No interrupt for this UIO device
+    nanosleep(&ts, nullptr);
+    return false;
+}
 
 auto CGenerator::start() -> void{
     const std::lock_guard<std::mutex> lock(m_waitLock);
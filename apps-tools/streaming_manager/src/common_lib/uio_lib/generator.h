@@ -55,6 +55,12 @@ public:
     auto initSecond(uint8_t *_buffer1,uint8_t *_buffer2, size_t _size_ch1, size_t _size_ch2) -> bool;
     
     auto write(uint8_t *_buffer1,uint8_t *_buffer2, size_t _size_ch1, size_t _size_ch2) -> bool;
+    // Waits for the DMA interrupt of the generator, sleeps timeout_us when the interrupt is not available
+    auto wait(uint32_t timeout_us) -> bool;
+    // The half buffer which write() fills next was played
+    auto isWriteReady() -> bool;
+    // Both half buffers were played, the DAC is repeating old data
+    auto isStarved() -> bool;
     auto setCalibration(int32_t ch1_offset,float ch1_gain, int32_t ch2_offset, float ch2_gain) -> void;
     auto start() -> void;
     auto stop() -> void;
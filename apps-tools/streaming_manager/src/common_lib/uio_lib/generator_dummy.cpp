@@ -87,6 +87,18 @@ auto CGenerator::write(uint8_t *,uint8_t *, size_t, size_t) -> bool {
     return ret;
 }
 
+auto CGenerator::wait(uint32_t timeout_us) -> bool {
+    usleep(timeout_us);
+    return true;
+}
+
+auto CGenerator::isWriteReady() -> bool {
+    return true;
+}
+
+auto CGenerator::isStarved() -> bool {
+    return false;
+}
 
 auto CGenerator::start() -> void {}
 
@@ -3,6 +3,7 @@
 #include "dac_streaming.h"
 #include "dac_streaming_lib/dac_net_controller.h"
 #include "dac_streaming_lib/dac_streaming_manager.h"
+#include "reader_lib/mapped_reader.h"
 #include "settings_lib/dac_settings.h"
 #include "thread_cout.h"
 #include "config.h"
@@ -29,9 +30,41 @@ std::vector<std::thread>              dac_clients;
 auto stopDACStreaming() -> void;
 auto stopDACStreaming(std::string host) -> void;
 
+auto dac_runSequence(DacSettings conf) -> void;
 
+auto dac_connect(DacSettings &conf) -> bool{
+    g_dac_connected[conf.host] = false;
+    g_dac_asionet[conf.host] = std::make_shared<CDACAsioNetController>();
+    g_dac_asionet[conf.host]->connectedNotify.connect([=](std::string host){
+        const std::lock_guard<std::mutex> lock(g_dac_smutex);
+        aprintf(stdout,"%s CLIENT CONNECTED  %s\n",getTS(": ").c_str(),host.c_str());
+        g_dac_connected[host] = true;
+    });
+
+    g_dac_asionet[conf.host]->disconnectedNotify.connect([=](std::string host){
+        const std::lock_guard<std::mutex> lock(g_dac_smutex);
+        if (g_dac_connected[host])
+            aprintf(stdout,"%s CLIENT DISCONNECTED  %s\n",getTS(": ").c_str(),host.c_str());
+        g_dac_connected[host] = false;
+    });
+
+    g_dac_asionet[conf.host]->startAsioNet(net_lib::EMode::M_CLIENT,conf.host,conf.port != "" ? conf.port : "8903");
+
+    auto beginTime = std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::system_clock::now()).time_since_epoch().count();
+    auto curTime = beginTime;
+    while(!g_dac_connected[conf.host]){
+        if (curTime - beginTime >= 5000) break;
+        curTime = std::chrono::time_point_cast<std::chrono::milliseconds >(std::chrono::system_clock::now()).time_since_epoch().count();
+    }
+    return g_dac_connected[conf.host];
+}
 
 auto dac_runClient(DacSettings conf) -> void{
+    if (!conf.seq_steps.empty()){
+        dac_runSequence(conf);
+        return;
+    }
+
     std::chrono::system_clock::time_point timeNow = std::chrono::system_clock::now();
     g_dac_timeBegin[conf.host] = std::chrono::time_point_cast<std::chrono::milliseconds >(timeNow).time_since_epoch().count();
 
@@ -103,54 +136,30 @@ auto dac_runClient(DacSettings conf) -> void{
         g_dac_terminate[conf.host] = true;
     });
 
-    g_dac_connected[conf.host] = false;
-    g_dac_asionet[conf.host] = std::make_shared<CDACAsioNetController>();
-    g_dac_asionet[conf.host]->connectedNotify.connect([=](std::string host){
-        const std::lock_guard<std::mutex> lock(g_dac_smutex);
-        aprintf(stdout,"%s CLIENT CONNECTED  %s\n",getTS(": ").c_str(),host.c_str());
-        g_dac_connected[host] = true;
-    });
+    g_dac_manger[conf.host]->run();
 
-    g_dac_asionet[conf.host]->disconnectedNotify.connect([=](std::string host){
-        const std::lock_guard<std::mutex> lock(g_dac_smutex);
-        if (g_dac_connected[host])
-            aprintf(stdout,"%s CLIENT DISCONNECTED  %s\n",getTS(": ").c_str(),host.c_str());
-        g_dac_connected[host] = false;
-    });
-
-    g_dac_asionet[conf.host]->startAsioNet(net_lib::EMode::M_CLIENT,conf.host,conf.port != "" ? conf.port : "8903");
-
-    auto beginTime = std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::system_clock::now()).time_since_epoch().count();
-    auto curTime = beginTime;
-    while(!g_dac_connected[conf.host]){
-        if (curTime - beginTime >= 5000) break;
-        curTime = std::chrono::time_point_cast<std::chrono::milliseconds >(std::chrono::system_clock::now()).time_since_epoch().count();
-    }
-
-
-    if (g_dac_connected[conf.host]){
+    if (dac_connect(conf)){
         while(1){
             uint8_t *ch1 = nullptr;
             uint8_t *ch2 = nullptr;
             size_t size1 = 0;
             size_t size2 = 0;
-            auto res = g_dac_manger[conf.host]->getBuffer();
+            auto res = g_dac_manger[conf.host]->getBuffer(100000);
             if (!res.empty){
                 ch1 = res.ch1;
                 ch2 = res.ch2;
                 size1 = res.size_ch1;
                 size2 = res.size_ch2;
                 g_dac_asionet[conf.host]->sendBuffer(ch1,size1,ch2,size2);
+                g_dac_manger[conf.host]->releaseBuffer(res);
             }
             if (ch1){
                 g_dac_packCounter_ch1[conf.host]++;
                 g_dac_BytesCount[conf.host] += size1;
-                delete[](ch1);
             }
             if (ch2){
                 g_dac_packCounter_ch2[conf.host]++;
                 g_dac_BytesCount[conf.host] += size2;
-                delete[](ch2);
             }
 
             if (g_dac_terminate[conf.host]){
@@ -174,6 +183,10 @@ auto dac_runClient(DacSettings conf) -> void{
                     pref = " Mi";
                 }
                 aprintf(stdout,"%s\tHOST IP: %s: Bandwidth:\t%d %sB/s \tData count ch1:\t%d\tch2:\t%d\n",getTS(": ").c_str(),conf.host.c_str(),bw,pref.c_str(),g_dac_packCounter_ch1[conf.host],g_dac_packCounter_ch2[conf.host]);
+                auto flow = g_dac_asionet[conf.host]->getFlowStats();
+                if (flow.enabled){
+                    aprintf(stdout,"%s\tHOST IP: %s: Board buffer:\t%u/%u\tLatency:\t%.1f ms (max %.1f ms)\tCredit stalls:\t%llu (%.0f ms)\n",getTS(": ").c_str(),conf.host.c_str(),flow.filled,flow.capacity,flow.latency_ms,flow.latency_max_ms,(unsigned long long)flow.stalls,flow.stall_ms);
+                }
                 g_dac_BytesCount[conf.host]  = 0;
                 g_dac_timeBegin[conf.host] = value.count();
             }
@@ -183,6 +196,91 @@ auto dac_runClient(DacSettings conf) -> void{
     stopDACStreaming(conf.host);
 }
 
+auto dac_loadSegment(const DacSettings::SequenceSegment &segment,std::vector<uint8_t> &ch1,std::vector<uint8_t> &ch2) -> bool{
+    const size_t blockSize = 65536;
+    CMappedReader reader(segment.file_type,segment.file,CStreamSettings::DAC_REP_OFF,0,blockSize);
+    if (reader.open() != CMappedReader::IR_OK){
+        aprintf(stderr,"%s Can't load segment %d from %s\n",getTS(": ").c_str(),segment.id,segment.file.c_str());
+        return false;
+    }
+    uint64_t size = std::max(reader.getChannelSize(0),reader.getChannelSize(1));
+    // The last block is padded by the reader
+    uint64_t capacity = (size + blockSize - 1) / blockSize * blockSize;
+    ch1.assign(reader.isChannelPresent(0) ? capacity : 0,0);
+    ch2.assign(reader.isChannelPresent(1) ? capacity : 0,0);
+    uint64_t pos = 0;
+    while(pos < size){
+        size_t size1 = 0;
+        size_t size2 = 0;
+        auto res = reader.read(ch1.empty() ? nullptr : ch1.data() + pos,&size1,ch2.empty() ? nullptr : ch2.data() + pos,&size2);
+        if (size1 == 0 && size2 == 0) break;
+        pos += std::max(size1,size2);
+        if (res != CMappedReader::RR_OK) break;
+    }
+    if (pos < size){
+        aprintf(stderr,"%s Segment %d from %s is broken\n",getTS(": ").c_str(),segment.id,segment.file.c_str());
+        return false;
+    }
+    if (!ch1.empty()) ch1.resize(size);
+    if (!ch2.empty()) ch2.resize(size);
+    return size > 0;
+}
+
+auto dac_runSequence(DacSettings conf) -> void{
+    g_dac_terminate[conf.host] = false;
+    if (!dac_connect(conf)){
+        stopDACStreaming(conf.host);
+        return;
+    }
+    auto asionet = g_dac_asionet[conf.host];
+    for(auto &segment : conf.seq_segments){
+        std::vector<uint8_t> ch1;
+        std::vector<uint8_t> ch2;
+        if (!dac_loadSegment(segment,ch1,ch2) ||
+            !asionet->sendSegment(segment.id,ch1.data(),ch1.size(),ch2.data(),ch2.size())){
+            stopDACStreaming(conf.host);
+            return;
+        }
+        if (conf.verbous)
+            aprintf(stdout,"%s Segment %d uploaded: %s (%zu bytes per channel)\n",getTS(": ").c_str(),segment.id,segment.file.c_str(),std::max(ch1.size(),ch2.size()));
+    }
+    std::vector<CDACSequencer::Step> steps;
+    for(auto &item : conf.seq_steps){
+        CDACSequencer::Step step;
+        step.segment = item.segment;
+        step.repeat = item.repeat;
+        step.next = item.next;
+        step.loops = item.loops;
+        step.jump = item.jump;
+        steps.push_back(step);
+    }
+    if (!asionet->sendSequence(steps,true)){
+        stopDACStreaming(conf.host);
+        return;
+    }
+    aprintf(stdout,"%s\tHOST IP: %s: Sequence of %zu steps started\n",getTS(": ").c_str(),conf.host.c_str(),steps.size());
+    // The board plays on its own, the connection is kept for triggers and stop
+    auto begin = std::chrono::steady_clock::now();
+    size_t trigger = 0;
+    while(!g_dac_terminate[conf.host] && g_dac_connected[conf.host]){
+        auto wait = std::chrono::milliseconds(100);
+        if (trigger < conf.seq_triggers.size()){
+            auto at = begin + std::chrono::milliseconds(conf.seq_triggers[trigger]);
+            auto now = std::chrono::steady_clock::now();
+            if (now >= at){
+                if (!asionet->sendTrigger()) break;
+                if (conf.verbous)
+                    aprintf(stdout,"%s Trigger %zu sent\n",getTS(": ").c_str(),trigger);
+                trigger++;
+                continue;
+            }
+            wait = std::min(wait,std::chrono::duration_cast<std::chrono::milliseconds>(at - now) + std::chrono::milliseconds(1));
+        }
+        std::this_thread::sleep_for(wait);
+    }
+    stopDACStreaming(conf.host);
+}
+
 auto startDACStreaming(std::shared_ptr<ClientNetConfigManager> cl,std::string &conf) -> void{
     auto settings = DacSettings::readFromFile(conf);
     if (settings.size() > 0){
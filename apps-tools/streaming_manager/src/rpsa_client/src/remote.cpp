@@ -115,6 +115,11 @@ auto startStreaming(std::shared_ptr<ClientNetConfigManager> cl,std::list<std::st
         slaveHosts.remove(host);
     });
 
+    cl->serverLocalRingFailNofiy.connect([&](std::string host){
+        const std::lock_guard<std::mutex> lock(g_rmutex);
+        aprintf(stderr,"%s Warning: %s local consumers ring is not created, check local_slots\n",getTS(": ").c_str(),host.c_str());
+    });
+
     cl->serverStartedTCPNofiy.connect([&](std::string host){
         const std::lock_guard<std::mutex> lock(g_rmutex);
         if (g_roption.verbous)
@@ -406,6 +411,24 @@ auto stopDACStreaming(std::shared_ptr<ClientNetConfigManager> cl,std::list<std::
         rstop_counter--;
     });
 
+    cl->serverDacStatsNofiy.connect([&](std::string &host,std::string &key,uint32_t value){
+        const std::lock_guard<std::mutex> lock(g_rmutex);
+        if (g_roption.verbous)
+            aprintf(stdout,"%s DAC %s: %s = %u\n",getTS(": ").c_str(),host.c_str(),key.c_str(),value);
+    });
+
+    cl->serverAdcStatsNofiy.connect([&](std::string &host,std::string &key,double value){
+        const std::lock_guard<std::mutex> lock(g_rmutex);
+        if (g_roption.verbous)
+            aprintf(stdout,"%s ADC %s: %s = %g\n",getTS(": ").c_str(),host.c_str(),key.c_str(),value);
+    });
+
+    cl->serverAdcSpectrumNofiy.connect([&](std::string &host,std::string &key,std::string &value){
+        const std::lock_guard<std::mutex> lock(g_rmutex);
+        if (g_roption.verbous)
+            aprintf(stdout,"%s ADC %s: %s = %s\n",getTS(": ").c_str(),host.c_str(),key.c_str(),value.c_str());
+    });
+
     cl->serverDacStoppedSDDoneNofiy.connect([&](std::string host){
         const std::lock_guard<std::mutex> lock(g_rmutex);
         if (g_roption.verbous)
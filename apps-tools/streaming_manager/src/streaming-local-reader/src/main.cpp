@@ -0,0 +1,118 @@
+#include <signal.h>
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <chrono>
+#include <inttypes.h>
+#include "streaming_lib/streaming_shm.h"
+#include "data_lib/thread_cout.h"
+
+// Minimal consumer of the shared memory ring of the streaming server. It reads
+// every pack, prints the throughput, the ADC range and the lost samples once
+// per second and can be used as a template for processing on the board.
+
+#define READ_TIMEOUT    100
+
+std::atomic_bool g_exit(false);
+
+char* getCmdOption(char ** begin, char ** end, const std::string & option)
+{
+    char ** itr = std::find(begin, end, option);
+    if (itr != end && ++itr != end)
+    {
+        return *itr;
+    }
+    return 0;
+}
+
+bool cmdOptionExists(char** begin, char** end, const std::string& option)
+{
+    return std::find(begin, end, option) != end;
+}
+
+void UsingArgs(char const* progName){
+    std::cout << "Usage: " << progName << " [-n name][-t seconds]\n";
+    std::cout << "\t-n Socket name of the server ring, default " << STREAMING_SHM_SOCKET << "\n";
+    std::cout << "\t-t Stop after the given number of seconds\n";
+}
+
+void sigHandler (int){
+    g_exit = true;
+}
+
+int main(int argc, char* argv[])
+{
+    if (cmdOptionExists(argv, argv + argc, "-h")){
+        UsingArgs(argv[0]);
+        return 0;
+    }
+    std::string name = STREAMING_SHM_SOCKET;
+    if (auto n = getCmdOption(argv, argv + argc, "-n")){
+        name = n;
+    }
+    uint64_t duration = 0;
+    if (auto t = getCmdOption(argv, argv + argc, "-t")){
+        duration = strtoull(t, nullptr, 10);
+    }
+
+    signal(SIGINT, sigHandler);
+    signal(SIGTERM, sigHandler);
+
+    auto client = streaming_lib::CStreamingShmClient::create();
+    if (!client->connect(name)){
+        aprintf(stderr,"Can't connect to the streaming server, check that local_slots is set\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto last = start;
+    uint64_t packs = 0;
+    uint64_t samples = 0;
+    uint64_t lostFPGA = 0;
+    int32_t  minCode = std::numeric_limits<int32_t>::max();
+    int32_t  maxCode = std::numeric_limits<int32_t>::min();
+
+    while(!g_exit){
+        auto pack = client->readBuffer(READ_TIMEOUT);
+        if (pack){
+            // The data points into the ring, it has to be used before the pack is released
+            auto buff = pack->getBuffer(DataLib::CH1);
+            if (!buff) buff = pack->getBuffer(DataLib::CH2);
+            if (buff && buff->getSamplesCount()){
+                for(size_t i = 0; i < buff->getSamplesCount(); i++){
+                    int32_t x = buff->getBitBySample() > 8 ? reinterpret_cast<const int16_t*>(buff->getBuffer().get())[i]
+                                                           : reinterpret_cast<const int8_t*>(buff->getBuffer().get())[i];
+                    minCode = std::min(minCode,x);
+                    maxCode = std::max(maxCode,x);
+                }
+                samples += buff->getSamplesCount();
+                lostFPGA += buff->getLostSamples(DataLib::FPGA);
+            }
+            if (client->unlockBufferRead()){
+                packs++;
+            }
+        }else if (!client->isRunning()){
+            aprintf(stdout,"Streaming is stopped\n");
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last >= std::chrono::seconds(1)){
+            double sec = std::chrono::duration<double>(now - last).count();
+            aprintf(stdout,"Packs: %" PRIu64 " Samples/s: %.0f Range: [%d, %d] Lost FPGA: %" PRIu64 " Lost ring: %" PRIu64 " Overruns: %" PRIu64 "\n",
+                packs, samples / sec, packs ? minCode : 0, packs ? maxCode : 0, lostFPGA, client->getLostSamples(), client->getOverruns());
+            last = now;
+            packs = 0;
+            samples = 0;
+            minCode = std::numeric_limits<int32_t>::max();
+            maxCode = std::numeric_limits<int32_t>::min();
+        }
+        if (duration && now - start >= std::chrono::seconds(duration)){
+            break;
+        }
+    }
+    client->disconnect();
+    return 0;
+}
@@ -145,6 +145,11 @@ auto startDACServer(bool verbMode,bool testMode) -> void{
 
 		if (use_file == CStreamSettings::DAC_NET) {
 			g_dac_manger = CDACStreamingManager::Create(ip_addr_host,sock_port);
+			// A finite sequence stops the server once it was played
+			g_dac_manger->notifyStop.connect([](CDACStreamingManager::NotifyResult status)
+			{
+				stopDACNonBlocking(status);
+			});
         }
 
         if (use_file == CStreamSettings::DAC_FILE) {
@@ -165,12 +170,17 @@ auto startDACServer(bool verbMode,bool testMode) -> void{
 			{
 				stopDACNonBlocking(status);
             });
+            g_dac_manger->setReadAheadRate(dac_speed);
 		
 		}
 
         g_dac_app = std::make_shared<CDACStreamingApplication>(g_dac_manger, g_gen);
 		g_dac_app->setVerbousMode(g_dac_verbMode);
 		g_dac_app->setTestMode(testMode);
+		g_dac_app->statsNotify.connect([](uint64_t underruns,uint64_t lateBuffers){
+			if (g_serverDACNetConfig)
+				g_serverDACNetConfig->sendDACStats(underruns,lateBuffers);
+		});
 
 		g_dac_app->runNonBlock();
 		if (g_dac_manger->isLocalMode()){
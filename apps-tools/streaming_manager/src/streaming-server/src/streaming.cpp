@@ -16,6 +16,9 @@
 #include "streaming_lib/streaming_fpga.h"
 #include "streaming_lib/streaming_buffer_cached.h"
 #include "streaming_lib/streaming_file.h"
+#include "streaming_lib/streaming_event.h"
+#include "streaming_lib/streaming_stats.h"
+#include "streaming_lib/streaming_shm.h"
 
 #include "streaming_fpga.h"
 #include "streaming_buffer.h"
@@ -35,6 +38,9 @@ CStreamingFPGA::Ptr         g_s_fpga = nullptr;
 CStreamingBufferCached::Ptr g_s_buffer = nullptr;
 CStreamingNet::Ptr          g_s_net = nullptr;
 CStreamingFile::Ptr         g_s_file = nullptr;
+CStreamingEventDetector::Ptr g_s_events = nullptr;
+CStreamingStats::Ptr        g_s_stats = nullptr;
+CStreamingShm::Ptr          g_s_shm = nullptr;
 
 bool                                    g_verbMode = false;
 std::shared_ptr<ServerNetConfigManager> g_serverNetConfig = nullptr;
@@ -59,6 +65,9 @@ auto startServer(bool verbMode,bool testMode) -> void{
 
     g_s_file = nullptr;
     g_s_net = nullptr;
+    g_s_shm = nullptr;
+    g_s_stats = nullptr;
+    g_s_events = nullptr;
     g_s_buffer = nullptr;
     g_s_fpga = nullptr;
     g_osc = nullptr;
@@ -219,12 +228,28 @@ auto startServer(bool verbMode,bool testMode) -> void{
 
         g_s_buffer = streaming_lib::CStreamingBufferCached::create();
         auto g_s_buffer_w = std::weak_ptr<CStreamingBufferCached>(g_s_buffer);
+        auto eventMode = settings.isEventMode();
+        if (eventMode){
+            g_s_events = streaming_lib::CStreamingEventDetector::create(g_s_buffer,settings.getEventPreSamples(),settings.getEventPostSamples(),settings.getEventHoldoffSamples());
+            g_s_events->setChannel(DataLib::CH1,settings.getEventType(CStreamSettings::CH1),settings.getEventLevel(CStreamSettings::CH1),settings.getEventLevel2(CStreamSettings::CH1));
+            g_s_events->setChannel(DataLib::CH2,settings.getEventType(CStreamSettings::CH2),settings.getEventLevel(CStreamSettings::CH2),settings.getEventLevel2(CStreamSettings::CH2));
+            if (g_verbMode){
+                g_s_events->eventNotify.connect([](uint64_t id,uint64_t index){
+                    aprintf(stdout,"[Streaming] Event %llu at sample %llu\n",(unsigned long long)id,(unsigned long long)index);
+                });
+            }
+        }
+        auto g_s_events_w = std::weak_ptr<streaming_lib::CStreamingEventDetector>(g_s_events);
 
 		if (use_file == CStreamSettings::NET) {
             auto proto = protocol == CStreamSettings::TCP ? net_lib::EProtocol::P_TCP : net_lib::EProtocol::P_UDP;
             g_s_net = streaming_lib::CStreamingNet::create(ip_addr_host,sock_port,proto);
             
-            g_s_net->getBuffer = [g_s_buffer_w]() -> DataLib::CDataBuffersPack::Ptr{
+            g_s_net->getBuffer = [g_s_buffer_w,g_s_events_w,eventMode]() -> DataLib::CDataBuffersPack::Ptr{
+                if (eventMode){
+                    auto events = g_s_events_w.lock();
+                    return events ? events->readBuffer() : nullptr;
+                }
                 auto obj = g_s_buffer_w.lock();
                 if (obj) {
                     return obj->readBuffer();
@@ -232,7 +257,14 @@ auto startServer(bool verbMode,bool testMode) -> void{
                 return nullptr;
             };
 
-            g_s_net->unlockBufferF = [g_s_buffer_w](){
+            g_s_net->unlockBufferF = [g_s_buffer_w,g_s_events_w,eventMode](){
+				if (eventMode){
+					auto events = g_s_events_w.lock();
+					if (events){
+						events->unlockBufferRead();
+					}
+					return nullptr;
+				}
 				auto obj = g_s_buffer_w.lock();
 				if (obj){
 					obj->unlockBufferRead();
@@ -265,15 +297,20 @@ auto startServer(bool verbMode,bool testMode) -> void{
 		}
 
         g_s_fpga = std::make_shared<streaming_lib::CStreamingFPGA>(g_osc,16);
+        if (settings.getLocalSlots()){
+            g_s_shm = CStreamingShm::create(settings.getLocalSlots());
+        }
         uint8_t resolution_val = (resolution == CStreamSettings::BIT_8 ? 8 : 16);
         auto att = attenuator == CStreamSettings::A_1_1 ? DataLib::CDataBuffer::ATT_1_1 :  DataLib::CDataBuffer::ATT_1_20;
         if(channel == CStreamSettings::CH1 || channel == CStreamSettings::BOTH){
             g_s_fpga->addChannel(DataLib::CH1,att,resolution_val);
             g_s_buffer->addChannel(DataLib::CH1,uio_lib::osc_buf_size,resolution_val);
+            if (g_s_shm) g_s_shm->addChannel(DataLib::CH1,uio_lib::osc_buf_size,resolution_val);
         }
         if(channel == CStreamSettings::CH2 || channel == CStreamSettings::BOTH){
             g_s_fpga->addChannel(DataLib::CH2,att,resolution_val);
             g_s_buffer->addChannel(DataLib::CH2,uio_lib::osc_buf_size,resolution_val);
+            if (g_s_shm) g_s_shm->addChannel(DataLib::CH2,uio_lib::osc_buf_size,resolution_val);
         }
         g_s_buffer->generateBuffers();
         g_s_fpga->setVerbousMode(g_verbMode);
@@ -297,9 +334,18 @@ auto startServer(bool verbMode,bool testMode) -> void{
         };
 
         auto g_s_file_w = std::weak_ptr<CStreamingFile>(g_s_file);
-        g_s_fpga->oscNotify.connect([g_s_file_w,g_s_buffer_w](DataLib::CDataBuffersPack::Ptr) {
+        g_s_fpga->oscNotify.connect([g_s_file_w,g_s_buffer_w,g_s_events_w](DataLib::CDataBuffersPack::Ptr) {
             auto f_obj = g_s_file_w.lock();
 			auto b_obj = g_s_buffer_w.lock();
+			auto e_obj = g_s_events_w.lock();
+            if (f_obj && e_obj){
+				// Several event windows can end in the same pack
+				while(auto p = e_obj->readBuffer()){
+					f_obj->passBuffers(p);
+					e_obj->unlockBufferRead();
+				}
+				return;
+			}
             if (f_obj && b_obj){
 				auto p = b_obj->readBuffer();
 				if (p){
@@ -309,6 +355,35 @@ auto startServer(bool verbMode,bool testMode) -> void{
             }
         });
 
+        if (settings.getStatsRate()){
+            g_s_stats = streaming_lib::CStreamingStats::create(settings.getStatsRate());
+            auto g_s_stats_w = std::weak_ptr<CStreamingStats>(g_s_stats);
+            auto config_w = std::weak_ptr<ServerNetConfigManager>(g_serverNetConfig);
+            g_s_fpga->oscNotify.connect([g_s_stats_w](DataLib::CDataBuffersPack::Ptr pack) {
+                auto obj = g_s_stats_w.lock();
+                if (obj) obj->passBuffers(pack);
+            });
+            g_s_stats->statsNotify.connect([config_w](DataLib::EDataBuffersPackChannel ch,const CStreamingStats::ChannelStats &stats){
+                auto config = config_w.lock();
+                if (!config) return;
+                config->sendADCStats(ch + 1,stats.min,stats.max,stats.mean,stats.rms,stats.clipped,stats.samples);
+                if (!stats.spectrum.empty()){
+                    config->sendADCSpectrum(ch + 1,stats.stepHz,stats.spectrum);
+                }
+            });
+            g_s_stats->run();
+        }
+
+        if (g_s_shm){
+            // Local consumers get every DMA buffer, also in the event mode and when the sinks fall behind
+            if (g_s_shm->run()){
+                g_s_fpga->setLocalRing(g_s_shm);
+            }else{
+                g_s_shm = nullptr;
+                g_serverNetConfig->sendLocalRingFail();
+            }
+        }
+
 		char time_str[40];
     	struct tm *timenow;
     	time_t now = time(nullptr);
@@ -357,6 +432,10 @@ auto stopServer(ServerNetConfigManager::EStopReason reason) -> void{
         if (g_s_buffer) g_s_buffer->notifyToDestory();
         g_s_net = nullptr;
         g_s_file = nullptr;
+        if (g_s_shm) g_s_shm->stop();
+        g_s_shm = nullptr;
+        g_s_stats = nullptr;
+        g_s_events = nullptr;
         g_s_buffer = nullptr;
         g_s_fpga = nullptr;
 
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+
+#include "dac_streaming_lib/dac_net_controller.h"
+
+// Loopback check of the credit flow control: the client may never have more
+// packs in flight than the board advertised, every pack is acknowledged and
+// the board pool never overflows.
+
+#define TEST_PORT       "23122"
+#define TEST_PACKS      500
+#define TEST_POOL_COUNT 4
+#define TEST_BLOCK_SIZE 4096
+
+using namespace dac_streaming_lib;
+
+int main(int, char*[])
+{
+    std::atomic<int> errors(0);
+    auto pool = DataLib::CDACBufferPool::Create(TEST_POOL_COUNT,TEST_BLOCK_SIZE);
+    auto server = std::make_shared<CDACAsioNetController>();
+    server->setBufferPool(pool);
+    server->startAsioNet(net_lib::M_SERVER,"127.0.0.1",TEST_PORT);
+
+    // Generator, plays the blocks slower than the client sends them
+    std::atomic_bool run(true);
+    uint64_t expected = 0;
+    std::thread generator([&](){
+        while(run){
+            auto pack = server->getBuffer();
+            if (pack.empty){
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                continue;
+            }
+            if (pack.index != expected){
+                std::cerr << "Pack " << pack.index << " received, expected " << expected << "\n";
+                errors++;
+            }
+            expected = pack.index + 1;
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            pool->release(pack.block);
+        }
+    });
+
+    auto client = std::make_shared<CDACAsioNetController>();
+    client->startAsioNet(net_lib::M_CLIENT,"127.0.0.1",TEST_PORT);
+    for(int i = 0; i < 100 && !client->isConnected(); i++){
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!client->isConnected()){
+        std::cerr << "Client is not connected\n";
+        return 1;
+    }
+
+    std::vector<uint8_t> ch1(TEST_BLOCK_SIZE / 2,0x55);
+    std::vector<uint8_t> ch2(TEST_BLOCK_SIZE / 2,0xAA);
+    for(int i = 0; i < TEST_PACKS; i++){
+        if (!client->sendBuffer(ch1.data(),ch1.size(),ch2.data(),ch2.size())){
+            std::cerr << "Send failed at pack " << i << "\n";
+            errors++;
+            break;
+        }
+        auto stats = client->getFlowStats();
+        if (stats.enabled && stats.sent - stats.acked > TEST_POOL_COUNT){
+            std::cerr << "Window exceeded: sent " << stats.sent << " acked " << stats.acked << "\n";
+            errors++;
+        }
+        if (pool->getFilledCount() > TEST_POOL_COUNT){
+            std::cerr << "Pool overflow\n";
+            errors++;
+        }
+    }
+
+    // Every pack has to be acknowledged once the generator played it
+    CDACAsioNetController::FlowStats stats;
+    for(int i = 0; i < 200; i++){
+        stats = client->getFlowStats();
+        if (stats.acked == stats.sent) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!stats.enabled){
+        std::cerr << "Credits are not enabled\n";
+        errors++;
+    }
+    if (stats.sent != TEST_PACKS || stats.acked != stats.sent){
+        std::cerr << "Sent " << stats.sent << " acked " << stats.acked << "\n";
+        errors++;
+    }
+    std::cout << "Sent " << stats.sent << " acked " << stats.acked << " stalls " << stats.stalls
+              << " latency " << stats.latency_ms << " ms (max " << stats.latency_max_ms << " ms)\n";
+
+    client->stopAsioNet();
+    run = false;
+    generator.join();
+    pool->stop();
+    server->stopAsioNet();
+
+    if (expected != TEST_PACKS){
+        std::cerr << "Generator played " << expected << " packs\n";
+        errors++;
+    }
+    std::cout << (errors ? "FAIL\n" : "PASS\n");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include "reader_lib/mapped_reader.h"
+#include "tdms_lib/data_type.h"
+
+// Indexes hand written TDMS segments with the mapped reader. The layouts it
+// can not map have to be left to the stream readers.
+
+#define TDMS_NEW_OBJ_LIST (1 << 2)
+#define TDMS_META_RAW     ((1 << 1) | (1 << 3))
+#define FILE_NAME         "test_mapped.tdms"
+
+struct TDMSObj{
+    std::string path;
+    bool        raw;
+    uint64_t    count;
+};
+
+template<typename T>
+auto putValue(std::vector<uint8_t> &buf,T value) -> void{
+    buf.insert(buf.end(),(uint8_t*)&value,(uint8_t*)&value + sizeof(T));
+}
+
+auto putString(std::vector<uint8_t> &buf,const std::string &value) -> void{
+    putValue<uint32_t>(buf,value.size());
+    buf.insert(buf.end(),value.begin(),value.end());
+}
+
+// Appends a segment with the given object list, the raw chunk of the list is written chunks times
+auto putSegment(std::vector<uint8_t> &file,uint32_t toc,const std::vector<TDMSObj> &objs,int chunks) -> void{
+    std::vector<uint8_t> meta;
+    std::vector<uint8_t> raw;
+    putValue<uint32_t>(meta,objs.size());
+    for(auto &obj : objs){
+        putString(meta,obj.path);
+        if (obj.raw){
+            putValue<uint32_t>(meta,20);
+            putValue<uint32_t>(meta,(uint32_t)TDMS::TDMSType::Integer16);
+            putValue<uint32_t>(meta,1);
+            putValue<uint64_t>(meta,obj.count);
+        }else{
+            putValue<uint32_t>(meta,0xFFFFFFFF);
+        }
+        putValue<uint32_t>(meta,0);
+    }
+    for(int c = 0; c < chunks; c++){
+        for(auto &obj : objs){
+            if (!obj.raw) continue;
+            for(uint64_t i = 0; i < obj.count; i++) putValue<int16_t>(raw,(int16_t)(i + c));
+        }
+    }
+    file.insert(file.end(),{'T','D','S','m'});
+    putValue<uint32_t>(file,toc);
+    putValue<uint32_t>(file,4713);
+    putValue<uint64_t>(file,meta.size() + raw.size());
+    putValue<uint64_t>(file,meta.size());
+    file.insert(file.end(),meta.begin(),meta.end());
+    file.insert(file.end(),raw.begin(),raw.end());
+}
+
+auto report(const std::string &name,bool ok) -> bool{
+    std::cout << "Test " << name << (ok ? " [OK]\n" : " [FAIL]\n");
+    return ok;
+}
+
+auto checkIndex(const std::string &name,const std::vector<uint8_t> &file,CMappedReader::IndexResult expected,uint64_t ch1Size) -> bool{
+    {
+        std::ofstream out(FILE_NAME,std::ios::binary);
+        out.write((const char*)file.data(),file.size());
+    }
+    CMappedReader reader(CStreamSettings::DataFormat::TDMS,FILE_NAME,CStreamSettings::DACRepeat::DAC_REP_OFF,0,32 * 1024);
+    auto res = reader.open();
+    bool ok = res == expected && (res != CMappedReader::IR_OK || reader.getChannelSize(0) == ch1Size);
+    std::remove(FILE_NAME);
+    return report(name,ok);
+}
+
+const TDMSObj root = {"/",false,0};
+const TDMSObj group = {"/'Group'",false,0};
+const TDMSObj ch1 = {"/'Group'/'ch1'",true,100};
+const TDMSObj ch2 = {"/'Group'/'ch2'",true,100};
+
+auto checkNewObjectLists() -> bool{
+    std::vector<uint8_t> file;
+    putSegment(file,TDMS_META_RAW | TDMS_NEW_OBJ_LIST,{root,group,ch1,ch2},1);
+    putSegment(file,TDMS_META_RAW | TDMS_NEW_OBJ_LIST,{root,group,ch1,ch2},1);
+    return checkIndex("new object lists",file,CMappedReader::IR_OK,400);
+}
+
+auto checkRepeatedObjectLists() -> bool{
+    // The servers repeat the full list without kTocNewObjList
+    std::vector<uint8_t> file;
+    putSegment(file,TDMS_META_RAW,{root,group,ch1,ch2},1);
+    putSegment(file,TDMS_META_RAW,{root,group,ch1,ch2},1);
+    return checkIndex("repeated object lists",file,CMappedReader::IR_OK,400);
+}
+
+auto checkRawChunks() -> bool{
+    std::vector<uint8_t> file;
+    putSegment(file,TDMS_META_RAW | TDMS_NEW_OBJ_LIST,{root,group,ch1,ch2},3);
+    return checkIndex("several raw chunks",file,CMappedReader::IR_UNSUPPORTED,0);
+}
+
+auto checkIncrementalObjectList() -> bool{
+    std::vector<uint8_t> file;
+    putSegment(file,TDMS_META_RAW | TDMS_NEW_OBJ_LIST,{root,group,ch1,ch2},1);
+    putSegment(file,TDMS_META_RAW,{ch2},1);
+    return checkIndex("incremental object list",file,CMappedReader::IR_UNSUPPORTED,0);
+}
+
+int main(int, char*[])
+{
+    bool ok = true;
+    ok &= checkNewObjectLists();
+    ok &= checkRepeatedObjectLists();
+    ok &= checkRawChunks();
+    ok &= checkIncrementalObjectList();
+    std::cout << (ok ? "All done\n" : "Failed\n");
+    return ok ? 0 : 1;
+}
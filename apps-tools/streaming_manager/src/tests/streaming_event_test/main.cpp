@@ -0,0 +1,171 @@
+#include <iostream>
+#include <vector>
+#include <functional>
+
+#include "streaming_lib/streaming_event.h"
+
+// Feeds synthetic packs through the cached ring into the event detector and
+// checks the windows passed to the sinks.
+
+#define PACK_SAMPLES 1000
+#define RING_PACKS   64
+#define EDGE_LEVEL   1000
+#define EDGE_HIGH    2000
+
+using namespace streaming_lib;
+
+struct Slice{
+    uint64_t index;
+    uint64_t samples;
+    uint64_t eventId;
+    uint64_t lost;
+};
+
+struct Bench{
+    CStreamingBufferCached::Ptr     ring;
+    CStreamingEventDetector::Ptr    detector;
+    std::vector<uint64_t>           events;
+    std::vector<Slice>              slices;
+    uint64_t                        next = 0;
+
+    Bench(uint32_t pre,uint32_t post,uint32_t holdoff){
+        ring = CStreamingBufferCached::create(RING_PACKS * PACK_SAMPLES * sizeof(int16_t));
+        ring->addChannel(DataLib::CH1,PACK_SAMPLES * sizeof(int16_t),16);
+        ring->generateBuffers();
+        detector = CStreamingEventDetector::create(ring,pre,post,holdoff);
+        detector->setChannel(DataLib::CH1,CStreamSettings::EV_EDGE_RISE,EDGE_LEVEL,0);
+        detector->eventNotify.connect([this](uint64_t,uint64_t index){
+            events.push_back(index);
+        });
+    }
+
+    // Writes one pack, lost samples are skipped in front of it like the FPGA does
+    auto push(uint64_t lost,const std::function<int16_t(uint64_t)> &signal) -> void{
+        auto pack = ring->getFreeBuffer(lost);
+        if (!pack) return;
+        uint64_t index = next + lost;
+        pack->setSampleIndex(index);
+        auto buff = pack->getBuffer(DataLib::CH1);
+        buff->setLostSamples(DataLib::FPGA,lost);
+        buff->setLostSamples(DataLib::RP_INTERNAL_BUFFER,0);
+        auto data = reinterpret_cast<int16_t*>(buff->getBuffer().get());
+        for(uint64_t i = 0; i < PACK_SAMPLES; i++){
+            data[i] = signal(index + i);
+        }
+        ring->unlockBufferWrite();
+        next = index + PACK_SAMPLES;
+        drain();
+    }
+
+    auto drain() -> void{
+        while(auto pack = detector->readBuffer()){
+            auto buff = pack->getBuffer(DataLib::CH1);
+            slices.push_back({pack->getSampleIndex(),pack->getBuffersSamples(),pack->getEventId(),buff->getLostSamplesAll()});
+            detector->unlockBufferRead();
+        }
+    }
+};
+
+// Short pulses at the given sample indexes
+auto pulses(std::vector<uint64_t> at) -> std::function<int16_t(uint64_t)>{
+    return [at](uint64_t index) -> int16_t{
+        for(auto p : at){
+            if (index >= p && index < p + 10) return EDGE_HIGH;
+        }
+        return 0;
+    };
+}
+
+// Every window has to arrive in order and be covered without holes, lost samples included
+auto checkWindow(const Bench &bench,uint64_t id,uint64_t begin,uint64_t end,uint64_t lost) -> bool{
+    uint64_t pos = begin;
+    uint64_t lostSum = 0;
+    for(auto &slice : bench.slices){
+        if (slice.eventId != id) continue;
+        if (slice.index != pos) return false;
+        pos = slice.index + slice.samples + slice.lost;
+        lostSum += slice.lost;
+    }
+    return pos == end && lostSum == lost;
+}
+
+auto report(const char *name,bool ok) -> bool{
+    std::cout << "Test " << name << (ok ? " [OK]\n" : " [FAIL]\n");
+    return ok;
+}
+
+auto checkPackBoundary() -> bool{
+    bool ok = true;
+    // Edge on the last sample of a pack and on the first one of the next pack
+    for(uint64_t edge : {(uint64_t)PACK_SAMPLES * 3 - 1,(uint64_t)PACK_SAMPLES * 3}){
+        Bench bench(100,200,0);
+        for(int i = 0; i < 10; i++){
+            bench.push(0,pulses({edge}));
+        }
+        ok &= bench.events.size() == 1 && bench.events[0] == edge;
+        ok &= checkWindow(bench,1,edge - 100,edge + 200,0);
+    }
+    // Window which spans three packs
+    {
+        Bench bench(1500,1500,0);
+        for(int i = 0; i < 10; i++){
+            bench.push(0,pulses({4500}));
+        }
+        ok &= bench.events.size() == 1 && checkWindow(bench,1,3000,6000,0);
+    }
+    return report("trigger near pack boundary",ok);
+}
+
+auto checkHoldoff() -> bool{
+    Bench bench(100,200,500);
+    // 2300 is inside the window of 2000, 2600 inside its hold-off, 2800 behind it
+    for(int i = 0; i < 10; i++){
+        bench.push(0,pulses({2000,2300,2600,2800}));
+    }
+    bool ok = bench.events.size() == 2 && bench.events[0] == 2000 && bench.events[1] == 2800;
+    ok &= bench.detector->getEventsCount() == 2;
+    ok &= checkWindow(bench,1,1900,2200,0);
+    // The pre-trigger part stops at the hold-off behind the previous window
+    ok &= checkWindow(bench,2,2700,3000,0);
+    return report("hold-off suppression",ok);
+}
+
+auto checkLostSamples() -> bool{
+    bool ok = true;
+    // 300 samples are dropped behind the pack that holds the trigger
+    {
+        Bench bench(100,600,0);
+        for(int i = 0; i < 10; i++){
+            bench.push(i == 6 ? 300 : 0,pulses({5900}));
+        }
+        ok &= bench.events.size() == 1 && bench.events[0] == 5900;
+        ok &= checkWindow(bench,1,5800,6500,300);
+    }
+    // The gap is longer than the rest of the window
+    {
+        Bench bench(100,300,0);
+        for(int i = 0; i < 10; i++){
+            bench.push(i == 6 ? 5000 : 0,pulses({5900}));
+        }
+        ok &= bench.events.size() == 1 && checkWindow(bench,1,5800,6200,200);
+    }
+    // An edge is not detected across a gap, the value before the gap is unknown
+    {
+        Bench bench(100,300,0);
+        for(int i = 0; i < 10; i++){
+            bench.push(i == 6 ? 300 : 0,[](uint64_t index) -> int16_t{ return index >= 6000 ? EDGE_HIGH : 0; });
+        }
+        ok &= bench.events.empty() && bench.slices.empty();
+    }
+    return report("lost-sample gaps",ok);
+}
+
+int main(int, char*[])
+{
+    bool ok = true;
+    ok &= checkPackBoundary();
+    ok &= checkHoldoff();
+    ok &= checkLostSamples();
+    std::cout << (ok ? "All done\n" : "Failed\n");
+    return ok ? 0 : 1;
+}
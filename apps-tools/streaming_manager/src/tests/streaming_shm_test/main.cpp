@@ -0,0 +1,157 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#include "streaming_lib/streaming_shm.h"
+
+// Publishes synthetic packs into the shared memory ring and reads them back
+// with the client, checking the overrun and lost sample accounting.
+
+#define PACK_SAMPLES 1000
+#define RING_SLOTS   8
+#define SOCKET_NAME  "rpsa_adc_stream_test"
+
+using namespace streaming_lib;
+
+struct Bench{
+    CStreamingShm::Ptr          server;
+    CStreamingShmClient::Ptr    client;
+    uint64_t                    next = 0;
+
+    Bench(){
+        server = CStreamingShm::create(RING_SLOTS,SOCKET_NAME);
+        server->addChannel(DataLib::CH1,PACK_SAMPLES * sizeof(int16_t),16);
+        client = CStreamingShmClient::create();
+    }
+
+    auto start() -> bool{
+        return server->run() && client->connect(SOCKET_NAME);
+    }
+
+    // Publishes one pack, the FPGA lost samples follow it like in CStreamingFPGA::passCh()
+    auto push(uint64_t lost = 0) -> void{
+        std::shared_ptr<uint8_t[]> data(new uint8_t[PACK_SAMPLES * sizeof(int16_t)]);
+        auto samples = reinterpret_cast<int16_t*>(data.get());
+        uint64_t index = next;
+        for(uint64_t i = 0; i < PACK_SAMPLES; i++){
+            samples[i] = (index + i) & 0x7FFF;
+        }
+        auto buff = DataLib::CDataBuffer::Create(data,PACK_SAMPLES * sizeof(int16_t),16);
+        buff->setADCMode(DataLib::CDataBuffer::ATT_1_1);
+        buff->setLostSamples(DataLib::FPGA,lost);
+        auto pack = DataLib::CDataBuffersPack::Create();
+        pack->addBuffer(DataLib::CH1,buff);
+        pack->setSampleIndex(index);
+        server->passBuffers(pack);
+        next = index + PACK_SAMPLES + lost;
+    }
+
+    // Reads one pack and checks that its data belongs to the sample index
+    auto read(uint64_t &index,uint64_t &lost) -> bool{
+        auto pack = client->readBuffer(100);
+        if (!pack) return false;
+        index = pack->getSampleIndex();
+        auto buff = pack->getBuffer(DataLib::CH1);
+        lost = buff ? buff->getLostSamples(DataLib::RP_INTERNAL_BUFFER) : 0;
+        bool ok = buff && buff->getSamplesCount() == PACK_SAMPLES;
+        if (ok){
+            auto samples = reinterpret_cast<const int16_t*>(buff->getBuffer().get());
+            ok = samples[0] == (int16_t)(index & 0x7FFF) && samples[PACK_SAMPLES - 1] == (int16_t)((index + PACK_SAMPLES - 1) & 0x7FFF);
+        }
+        return client->unlockBufferRead() && ok;
+    }
+};
+
+auto report(const std::string &name,bool ok) -> bool{
+    std::cout << "Test " << name << (ok ? " [OK]\n" : " [FAIL]\n");
+    return ok;
+}
+
+auto checkOverrun() -> bool{
+    Bench bench;
+    bool ok = bench.start();
+    uint64_t index = 0;
+    uint64_t lost = 0;
+    bench.push();
+    ok &= bench.read(index,lost) && index == 0 && lost == 0;
+    // The reader falls more than the whole ring behind and restarts from the middle of it
+    for(int i = 0; i < 20; i++){
+        bench.push();
+    }
+    ok &= bench.read(index,lost);
+    ok &= index == (21 - RING_SLOTS / 2) * PACK_SAMPLES && lost == index - PACK_SAMPLES;
+    ok &= bench.client->getOverruns() == 20 - RING_SLOTS / 2;
+    ok &= bench.client->getLostSamples() == lost;
+    for(uint64_t expected = index + PACK_SAMPLES; expected < bench.next; expected += PACK_SAMPLES){
+        ok &= bench.read(index,lost) && index == expected && lost == 0;
+    }
+    ok &= bench.client->getOverruns() == 20 - RING_SLOTS / 2;
+    return report("overrun of a slow reader",ok);
+}
+
+auto checkOverwrite() -> bool{
+    Bench bench;
+    bool ok = bench.start();
+    bench.push();
+    auto pack = bench.client->readBuffer(100);
+    ok &= pack != nullptr;
+    // The slot of the held pack is reused before it is released
+    for(int i = 0; i < RING_SLOTS; i++){
+        bench.push();
+    }
+    ok &= !bench.client->unlockBufferRead();
+    ok &= bench.client->getOverruns() == 1 && bench.client->getLostSamples() == PACK_SAMPLES;
+    return report("slot overwritten while read",ok);
+}
+
+auto checkFPGALost() -> bool{
+    Bench bench;
+    bool ok = bench.start();
+    uint64_t index = 0;
+    uint64_t lost = 0;
+    bench.push(300);
+    bench.push();
+    ok &= bench.read(index,lost) && bench.read(index,lost);
+    // Samples dropped by the FPGA are already counted in the pack, the ring adds nothing
+    ok &= index == PACK_SAMPLES + 300 && lost == 0;
+    ok &= bench.client->getOverruns() == 0 && bench.client->getLostSamples() == 0;
+    return report("FPGA lost samples",ok);
+}
+
+auto checkWakeup() -> bool{
+    Bench bench;
+    bool ok = bench.start();
+    auto writer = std::thread([&bench](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        bench.push();
+    });
+    auto begin = std::chrono::steady_clock::now();
+    auto pack = bench.client->readBuffer(2000);
+    auto waited = std::chrono::steady_clock::now() - begin;
+    writer.join();
+    ok &= pack != nullptr && waited < std::chrono::milliseconds(1000);
+    ok &= bench.client->unlockBufferRead();
+    // Stop wakes the reader and the ring reports that it is not running
+    bench.server->stop();
+    ok &= bench.client->readBuffer(2000) == nullptr && !bench.client->isRunning();
+    return report("reader wakeup",ok);
+}
+
+auto checkMemoryLimit() -> bool{
+    auto server = CStreamingShm::create(100000,SOCKET_NAME);
+    server->addChannel(DataLib::CH1,PACK_SAMPLES * sizeof(int16_t),16);
+    // The ring is not shrunk to fit, the server reports the failure instead
+    return report("memory limit",!server->run());
+}
+
+int main(int, char*[])
+{
+    bool ok = true;
+    ok &= checkOverrun();
+    ok &= checkOverwrite();
+    ok &= checkFPGALost();
+    ok &= checkWakeup();
+    ok &= checkMemoryLimit();
+    std::cout << (ok ? "All done\n" : "Failed\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <cmath>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <map>
+#include <functional>
+
+#include "streaming_lib/streaming_stats.h"
+
+// Feeds a known sine and a clipped signal into the stats monitor and checks
+// the reported levels against the values expected from the signal.
+
+#define PACK_SAMPLES 4096
+#define OSC_RATE     125000000
+#define FFT_SIZE     1024
+#define TONE_BIN     64
+#define TONE_LEVEL   0.5
+#define CLIP_HIGH    10
+#define CLIP_LOW     5
+
+using namespace streaming_lib;
+
+auto createBuffer(const std::function<int16_t(size_t)> &signal) -> DataLib::CDataBuffer::Ptr{
+    std::shared_ptr<uint8_t[]> data(new uint8_t[PACK_SAMPLES * sizeof(int16_t)]);
+    auto samples = reinterpret_cast<int16_t*>(data.get());
+    for(size_t i = 0; i < PACK_SAMPLES; i++){
+        samples[i] = signal(i);
+    }
+    auto buff = DataLib::CDataBuffer::Create(data,PACK_SAMPLES * sizeof(int16_t),16);
+    buff->setADCMode(DataLib::CDataBuffer::ATT_1_1);
+    return buff;
+}
+
+auto report(const std::string &name,bool ok) -> bool{
+    std::cout << "Test " << name << (ok ? " [OK]\n" : " [FAIL]\n");
+    return ok;
+}
+
+int main(int, char*[])
+{
+    // The tone sits in the middle of an FFT bin, so the Hann window adds no scalloping loss
+    auto sine = createBuffer([](size_t i) -> int16_t {
+        return std::lround(TONE_LEVEL * 32767 * sin(2.0 * M_PI * TONE_BIN * i / FFT_SIZE));
+    });
+    auto clipped = createBuffer([](size_t i) -> int16_t {
+        if (i < CLIP_HIGH) return 32767;
+        if (i < CLIP_HIGH + CLIP_LOW) return -32768;
+        return 0;
+    });
+    auto pack = DataLib::CDataBuffersPack::Create();
+    pack->addBuffer(DataLib::CH1,sine);
+    pack->addBuffer(DataLib::CH2,clipped);
+    pack->setOSCRate(OSC_RATE);
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::map<DataLib::EDataBuffersPackChannel,CStreamingStats::ChannelStats> result;
+
+    auto stats = CStreamingStats::create(10);
+    stats->statsNotify.connect([&](DataLib::EDataBuffersPackChannel ch,const CStreamingStats::ChannelStats &s){
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!result.count(ch)) result[ch] = s;
+        cv.notify_all();
+    });
+    stats->run();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while(result.size() < 2 && std::chrono::steady_clock::now() < deadline){
+            lock.unlock();
+            stats->passBuffers(pack);
+            lock.lock();
+            cv.wait_for(lock,std::chrono::milliseconds(1));
+        }
+    }
+    stats->stop();
+
+    bool ok = report("reports for both channels",result.size() == 2);
+    if (ok){
+        auto &tone = result[DataLib::CH1];
+        double levelDb = 20.0 * log10(TONE_LEVEL);
+        size_t group = (FFT_SIZE / 2) / tone.spectrum.size();
+        size_t point = TONE_BIN / group;
+        bool peak = tone.spectrum.size() == 128 && fabs(tone.spectrum[point] - levelDb) < 0.05;
+        for(size_t k = 0; k < tone.spectrum.size(); k++){
+            // Away from the main lobe only the quantization noise is left
+            if (k + 2 < point || k > point + 2) peak &= tone.spectrum[k] < -90;
+        }
+        ok &= report("Welch scaling in dBFS",peak);
+        ok &= report("spectrum step",fabs(tone.stepHz - (double)OSC_RATE / FFT_SIZE * group) < 1e-6);
+        ok &= report("sine RMS",fabs(tone.rms - TONE_LEVEL / sqrt(2)) < 1e-3 && fabs(tone.mean) < 1e-3);
+        ok &= report("sine range",fabs(tone.max - TONE_LEVEL) < 1e-3 && fabs(tone.min + TONE_LEVEL) < 1e-3);
+
+        auto &clip = result[DataLib::CH2];
+        bool clipOk = clip.samples > 0 && clip.samples % PACK_SAMPLES == 0;
+        clipOk &= clip.clipped == clip.samples / PACK_SAMPLES * (CLIP_HIGH + CLIP_LOW);
+        clipOk &= clip.max == 32767.0 / 32768.0 && clip.min == -1.0;
+        ok &= report("clip counter",clipOk);
+        // A clean sine below full scale is never counted as saturated
+        ok &= report("no clipping on the sine",tone.clipped == 0);
+    }
+    std::cout << (ok ? "All done\n" : "Failed\n");
+    return ok ? 0 : 1;
+}
@@ -33,6 +33,9 @@
 #include "streaming_lib/streaming_fpga.h"
 #include "streaming_lib/streaming_buffer_cached.h"
 #include "streaming_lib/streaming_file.h"
+#include "streaming_lib/streaming_event.h"
+#include "streaming_lib/streaming_stats.h"
+#include "streaming_lib/streaming_shm.h"
 #include "dac_streaming_lib/dac_streaming_application.h"
 #include "dac_streaming_lib/dac_net_controller.h"
 #include "dac_streaming_lib/dac_streaming_manager.h"
@@ -148,6 +151,9 @@ streaming_lib::CStreamingFPGA::Ptr   		g_s_fpga = nullptr;
 streaming_lib::CStreamingBufferCached::Ptr 	g_s_buffer = nullptr;
 streaming_lib::CStreamingNet::Ptr    		g_s_net = nullptr;
 streaming_lib::CStreamingFile::Ptr   		g_s_file = nullptr;
+streaming_lib::CStreamingEventDetector::Ptr	g_s_events = nullptr;
+streaming_lib::CStreamingStats::Ptr			g_s_stats = nullptr;
+streaming_lib::CStreamingShm::Ptr			g_s_shm = nullptr;
 
 dac_streaming_lib::CDACStreamingApplication::Ptr g_dac_app = nullptr;
 dac_streaming_lib::CDACStreamingManager::Ptr     g_dac_manger = nullptr;
@@ -742,6 +748,9 @@ void startServer(bool testMode) {
 
         g_s_file = nullptr;
         g_s_net = nullptr;
+        g_s_shm = nullptr;
+        g_s_stats = nullptr;
+        g_s_events = nullptr;
         g_s_buffer = nullptr;
         g_s_fpga = nullptr;
         g_osc = nullptr;
@@ -882,12 +891,23 @@ void startServer(bool testMode) {
 
 		g_s_buffer = streaming_lib::CStreamingBufferCached::create();
 		auto g_s_buffer_w = std::weak_ptr<streaming_lib::CStreamingBufferCached>(g_s_buffer);
+        auto eventMode = settings.isEventMode();
+        if (eventMode){
+            g_s_events = streaming_lib::CStreamingEventDetector::create(g_s_buffer,settings.getEventPreSamples(),settings.getEventPostSamples(),settings.getEventHoldoffSamples());
+            g_s_events->setChannel(DataLib::CH1,settings.getEventType(CStreamSettings::CH1),settings.getEventLevel(CStreamSettings::CH1),settings.getEventLevel2(CStreamSettings::CH1));
+            g_s_events->setChannel(DataLib::CH2,settings.getEventType(CStreamSettings::CH2),settings.getEventLevel(CStreamSettings::CH2),settings.getEventLevel2(CStreamSettings::CH2));
+        }
+        auto g_s_events_w = std::weak_ptr<streaming_lib::CStreamingEventDetector>(g_s_events);
         if (use_file == CStreamSettings::NET) {
             auto proto = protocol == CStreamSettings::TCP ? net_lib::EProtocol::P_TCP : net_lib::EProtocol::P_UDP;
             g_s_net = streaming_lib::CStreamingNet::create(ip_addr_host,sock_port,proto);
             
             
-            g_s_net->getBuffer = [g_s_buffer_w]() -> DataLib::CDataBuffersPack::Ptr{
+            g_s_net->getBuffer = [g_s_buffer_w,g_s_events_w,eventMode]() -> DataLib::CDataBuffersPack::Ptr{
+                if (eventMode){
+                    auto events = g_s_events_w.lock();
+                    return events ? events->readBuffer() : nullptr;
+                }
                 auto obj = g_s_buffer_w.lock();
                 if (obj) {
                     return obj->readBuffer();
@@ -895,7 +915,14 @@ void startServer(bool testMode) {
                 return nullptr;
             };
 			
-			g_s_net->unlockBufferF = [g_s_buffer_w](){
+			g_s_net->unlockBufferF = [g_s_buffer_w,g_s_events_w,eventMode](){
+				if (eventMode){
+					auto events = g_s_events_w.lock();
+					if (events){
+						events->unlockBufferRead();
+					}
+					return nullptr;
+				}
 				auto obj = g_s_buffer_w.lock();
 				if (obj){
 					obj->unlockBufferRead();
@@ -929,16 +956,21 @@ void startServer(bool testMode) {
 
 
         g_s_fpga = std::make_shared<streaming_lib::CStreamingFPGA>(g_osc,16);
+        if (settings.getLocalSlots()){
+            g_s_shm = streaming_lib::CStreamingShm::create(settings.getLocalSlots());
+        }
         uint8_t resolution_val = (resolution == CStreamSettings::BIT_8 ? 8 : 16);
 		aprintf(stderr,"[Streaming] Set channels resolution %d\n",resolution_val);
         auto att = attenuator == CStreamSettings::A_1_1 ? DataLib::CDataBuffer::ATT_1_1 :  DataLib::CDataBuffer::ATT_1_20;
         if(channel == CStreamSettings::CH1 || channel == CStreamSettings::BOTH){
             g_s_fpga->addChannel(DataLib::CH1,att,resolution_val);
 			g_s_buffer->addChannel(DataLib::CH1,uio_lib::osc_buf_size, resolution_val);
+			if (g_s_shm) g_s_shm->addChannel(DataLib::CH1,uio_lib::osc_buf_size,resolution_val);
         }
         if(channel == CStreamSettings::CH2 || channel == CStreamSettings::BOTH){
             g_s_fpga->addChannel(DataLib::CH2,att,resolution_val);
 			g_s_buffer->addChannel(DataLib::CH2,uio_lib::osc_buf_size, resolution_val);
+			if (g_s_shm) g_s_shm->addChannel(DataLib::CH2,uio_lib::osc_buf_size,resolution_val);
         }
 		g_s_buffer->generateBuffers();
         g_s_fpga->setTestMode(testMode);
@@ -962,10 +994,19 @@ void startServer(bool testMode) {
 
         auto g_s_file_w = std::weak_ptr<streaming_lib::CStreamingFile>(g_s_file);
 		auto g_s_net_w = std::weak_ptr<streaming_lib::CStreamingNet>(g_s_net);
-        g_s_fpga->oscNotify.connect([g_s_net_w,g_s_file_w,rate,g_s_buffer_w](DataLib::CDataBuffersPack::Ptr pack) {
+        g_s_fpga->oscNotify.connect([g_s_net_w,g_s_file_w,rate,g_s_buffer_w,g_s_events_w](DataLib::CDataBuffersPack::Ptr pack) {
 
 			auto f_obj = g_s_file_w.lock();
 			auto b_obj = g_s_buffer_w.lock();
+			auto e_obj = g_s_events_w.lock();
+            if (f_obj && e_obj){
+				// Several event windows can end in the same pack
+				while(auto p = e_obj->readBuffer()){
+					f_obj->passBuffers(p);
+					e_obj->unlockBufferRead();
+				}
+				return;
+			}
             if (f_obj && b_obj){
 				auto p = b_obj->readBuffer();
 				if (p){
@@ -975,6 +1016,35 @@ void startServer(bool testMode) {
             }
         });
 
+        if (settings.getStatsRate()){
+            g_s_stats = streaming_lib::CStreamingStats::create(settings.getStatsRate());
+            auto g_s_stats_w = std::weak_ptr<streaming_lib::CStreamingStats>(g_s_stats);
+            auto config_w = std::weak_ptr<ServerNetConfigManager>(g_serverNetConfig);
+            g_s_fpga->oscNotify.connect([g_s_stats_w](DataLib::CDataBuffersPack::Ptr pack) {
+                auto obj = g_s_stats_w.lock();
+                if (obj) obj->passBuffers(pack);
+            });
+            g_s_stats->statsNotify.connect([config_w](DataLib::EDataBuffersPackChannel ch,const streaming_lib::CStreamingStats::ChannelStats &stats){
+                auto config = config_w.lock();
+                if (!config) return;
+                config->sendADCStats(ch + 1,stats.min,stats.max,stats.mean,stats.rms,stats.clipped,stats.samples);
+                if (!stats.spectrum.empty()){
+                    config->sendADCSpectrum(ch + 1,stats.stepHz,stats.spectrum);
+                }
+            });
+            g_s_stats->run();
+        }
+
+        if (g_s_shm){
+            // Local consumers get every DMA buffer, also in the event mode and when the sinks fall behind
+            if (g_s_shm->run()){
+                g_s_fpga->setLocalRing(g_s_shm);
+            }else{
+                g_s_shm = nullptr;
+                g_serverNetConfig->sendLocalRingFail();
+            }
+        }
+
         char time_str[40];
         struct tm *timenow;
         time_t now = time(nullptr);
@@ -1058,6 +1128,10 @@ void stopServer(ServerNetConfigManager::EStopReason x){
 		if (g_s_file) g_s_file->disableNotify();
 		g_s_net = nullptr;
         g_s_file = nullptr;
+        if (g_s_shm) g_s_shm->stop();
+        g_s_shm = nullptr;
+        g_s_stats = nullptr;
+        g_s_events = nullptr;
         g_s_buffer = nullptr;
         g_s_fpga = nullptr;
         aprintf(stderr,"[Streaming] Stop server\n");
@@ -1151,6 +1225,11 @@ auto startDACServer(bool testMode) -> void{
 
         if (use_file == CStreamSettings::DAC_NET) {
             g_dac_manger = dac_streaming_lib::CDACStreamingManager::Create(ip_addr_host,sock_port);
+            // A finite sequence stops the server once it was played
+            g_dac_manger->notifyStop.connect([](dac_streaming_lib::CDACStreamingManager::NotifyResult status)
+            {
+                stopDACNonBlocking(status);
+            });
         }
 
         if (use_file == CStreamSettings::DAC_FILE) {
@@ -1171,11 +1250,16 @@ auto startDACServer(bool testMode) -> void{
             {
                 stopDACNonBlocking(status);
             });
+            g_dac_manger->setReadAheadRate(dac_speed);
 
         }
 
         g_dac_app = std::make_shared<dac_streaming_lib::CDACStreamingApplication>(g_dac_manger, g_gen);
         g_dac_app->setTestMode(testMode);
+        g_dac_app->statsNotify.connect([](uint64_t underruns,uint64_t lateBuffers){
+            if (g_serverNetConfig)
+                g_serverNetConfig->sendDACStats(underruns,lateBuffers);
+        });
 
         g_dac_app->runNonBlock();
         if (g_dac_manger->isLocalMode()){
@@ -0,0 +1,342 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya DSP library benchmark suite.
+ *
+ * Measures the throughput of every shared kernel, the CDSP spectrum pipeline
+ * and the streaming Welch PSD. FFT entries are in transforms per second, the
+ * rest in million input samples per second. Results can be stored as a baseline on the
+ * target board and later checked against it, failing when any benchmark
+ * drops more than the allowed tolerance. The lock-in benchmarks can run on
+ * a buffer recorded from the bode or LCR tools instead of a synthetic tone.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C++ programming language.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "rp_dsp.h"
+#include "rp_psd.h"
+#include "rp_dsp_kernels.h"
+
+#define BENCH_CHANNELS   2
+#define BENCH_MAX_LENGTH (64 * 1024)
+#define BENCH_ADC_SPEED  125e6
+#define BENCH_SECONDS    0.5
+#define BENCH_TOLERANCE  10.0
+#define BENCH_LOCKIN_LENGTH 4096
+#define BENCH_LOCKIN_CYCLES 10.0
+
+using namespace rp_dsp_api;
+
+namespace {
+
+struct result_t {
+    std::string name;
+    double value;   // Million samples per second, or transforms per second for the FFT entries
+    const char *unit;
+};
+
+double g_seconds = BENCH_SECONDS;
+std::vector<result_t> g_results;
+volatile double g_sink = 0;
+
+// Runs func until the time budget is spent, samples is the input size of one call
+auto run(const std::string &name, uint64_t samples, std::function<void()> func, const char *unit = "MS/s", double div = 1e6) -> void {
+    uint64_t calls = 0;
+    double elapsed = 0;
+    auto begin = std::chrono::steady_clock::now();
+    while (elapsed < g_seconds) {
+        func();
+        calls++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+    double value = calls * samples / elapsed / div;
+    g_results.push_back({name, value, unit});
+    printf("%-28s %12.2f %s\n", name.c_str(), value, unit);
+}
+
+// Transforms per second, ffts is the number of FFTs done by one call
+auto runFFT(const std::string &name, uint64_t ffts, std::function<void()> func) -> void {
+    run(name, ffts, func, "FFT/s", 1);
+}
+
+auto saveBaseline(const char *file) -> int {
+    FILE *f = fopen(file, "w");
+    if (!f) {
+        fprintf(stderr, "Can't open %s\n", file);
+        return -1;
+    }
+    for (auto &r : g_results) {
+        fprintf(f, "%s %.3f\n", r.name.c_str(), r.value);
+    }
+    fclose(f);
+    return 0;
+}
+
+auto checkBaseline(const char *file, double tolerance) -> int {
+    FILE *f = fopen(file, "r");
+    if (!f) {
+        fprintf(stderr, "Can't open %s\n", file);
+        return -1;
+    }
+    std::map<std::string, double> baseline;
+    char name[128];
+    double value;
+    while (fscanf(f, "%127s %lf", name, &value) == 2) {
+        baseline[name] = value;
+    }
+    fclose(f);
+
+    int regressions = 0;
+    for (auto &r : g_results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end()) continue;
+        double change = (r.value - it->second) / it->second * 100.0;
+        if (change < -tolerance) {
+            fprintf(stderr, "REGRESSION %-28s %12.2f -> %12.2f %s (%.1f%%)\n", r.name.c_str(), it->second, r.value, r.unit, change);
+            regressions++;
+        }
+    }
+    return regressions ? -1 : 0;
+}
+
+// Recorded bode/LCR buffer: a line with the number of periods, then one "ch1 ch2" pair per line
+auto loadRecord(const char *file, std::vector<float> &ch1, std::vector<float> &ch2, double *cycles) -> int {
+    FILE *f = fopen(file, "r");
+    if (!f) {
+        fprintf(stderr, "Can't open %s\n", file);
+        return -1;
+    }
+    uint32_t n = 0;
+    float a, b;
+    if (fscanf(f, "%lf", cycles) != 1) {
+        fprintf(stderr, "Missing number of periods in %s\n", file);
+        fclose(f);
+        return -1;
+    }
+    while (n < BENCH_LOCKIN_LENGTH && fscanf(f, "%f %f", &a, &b) == 2) {
+        ch1[n] = a;
+        ch2[n] = b;
+        n++;
+    }
+    fclose(f);
+    if (n != BENCH_LOCKIN_LENGTH) {
+        fprintf(stderr, "%s has %u samples, %u needed\n", file, n, BENCH_LOCKIN_LENGTH);
+        return -1;
+    }
+    return 0;
+}
+
+// Per sample sin()/cos() with trapezoid integration, the way the bode and LCR tools used to demodulate
+auto lockinSinCos(const std::vector<float> &ch1, const std::vector<float> &ch2, double cycles) -> double {
+    const size_t n = ch1.size();
+    double i1 = 0, q1 = 0, i2 = 0, q2 = 0;
+    for (size_t i = 0; i < n; i++) {
+        const double a = 2 * M_PI * cycles * i / n;
+        const double k = (i == 0 || i == n - 1) ? 0.5 : 1.0;
+        i1 += k * ch1[i] * sin(a);
+        q1 += k * ch1[i] * sin(a + M_PI / 2);
+        i2 += k * ch2[i] * sin(a);
+        q2 += k * ch2[i] * sin(a + M_PI / 2);
+    }
+    return atan2(q1, i1) - atan2(q2, i2);
+}
+
+auto usage(const char *name) -> void {
+    fprintf(stderr,
+        "usage: %s [-t seconds] [-s baseline] [-c baseline] [-r percent] [-l record]\n"
+        "  -t  time spent on each benchmark (default: %.1f)\n"
+        "  -s  store results as a baseline\n"
+        "  -c  compare results against a baseline, exit code 1 on regression\n"
+        "  -r  allowed regression in percent (default: %.0f)\n"
+        "  -l  run the lock-in benchmarks on a recorded buffer of %u samples per channel\n",
+        name, BENCH_SECONDS, BENCH_TOLERANCE, BENCH_LOCKIN_LENGTH);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const char *save = NULL;
+    const char *check = NULL;
+    const char *record = NULL;
+    double tolerance = BENCH_TOLERANCE;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "ht:s:c:r:l:")) != -1) {
+        switch (opt) {
+            case 't': g_seconds = atof(optarg); break;
+            case 's': save = optarg; break;
+            case 'c': check = optarg; break;
+            case 'r': tolerance = atof(optarg); break;
+            case 'l': record = optarg; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    std::vector<double> signal(BENCH_MAX_LENGTH);
+    std::vector<double> window(BENCH_MAX_LENGTH);
+    std::vector<double> out(BENCH_MAX_LENGTH);
+    std::vector<float>  dec(BENCH_MAX_LENGTH);
+    for (uint32_t i = 0; i < BENCH_MAX_LENGTH; i++) {
+        signal[i] = sin(2 * M_PI * i * 0.01) + 0.001 * (rand() % 100);
+    }
+
+    // Shared kernels
+    for (uint32_t len = 1024; len <= BENCH_MAX_LENGTH; len *= 4) {
+        auto fft = rp_dsp_fftr_alloc(len);
+        runFFT("fft_" + std::to_string(len), 1, [&]() {
+            rp_dsp_fftr_mag(fft, signal.data(), out.data(), len / 2);
+        });
+        rp_dsp_fftr_free(fft);
+    }
+
+    rp_dsp_window(RP_DSP_WIN_HANNING, window.data(), BENCH_MAX_LENGTH, NULL);
+    run("apply_window", BENCH_MAX_LENGTH, [&]() {
+        rp_dsp_apply_window(signal.data(), window.data(), out.data(), BENCH_MAX_LENGTH);
+    });
+    run("decimate_power", BENCH_MAX_LENGTH, [&]() {
+        rp_dsp_decimate_power(signal.data(), BENCH_MAX_LENGTH, dec.data(), BENCH_MAX_LENGTH / 8, 1.0);
+    });
+    std::vector<float> fsignal(signal.begin(), signal.end());
+    std::vector<float> fwin(window.begin(), window.end());
+    std::vector<float> fout(BENCH_MAX_LENGTH);
+    run("apply_window_f", BENCH_MAX_LENGTH, [&]() {
+        rp_dsp_apply_window_f(fsignal.data(), fwin.data(), fout.data(), BENCH_MAX_LENGTH);
+    });
+    run("decimate_power_f", BENCH_MAX_LENGTH, [&]() {
+        rp_dsp_decimate_power_f(fsignal.data(), BENCH_MAX_LENGTH, dec.data(), BENCH_MAX_LENGTH / 8, 1.0f);
+    });
+    run("goertzel", BENCH_MAX_LENGTH, [&]() {
+        double re, im;
+        rp_dsp_goertzel(signal.data(), BENCH_MAX_LENGTH, 655.36, &re, &im);
+        g_sink += re + im;
+    });
+    run("iq_demod", BENCH_MAX_LENGTH, [&]() {
+        double amp, phase;
+        rp_dsp_iq_demod(signal.data(), BENCH_MAX_LENGTH, 655.36, &amp, &phase);
+        g_sink += amp + phase;
+    });
+    run("stats", BENCH_MAX_LENGTH, [&]() {
+        rp_dsp_stats_t stats;
+        rp_dsp_stats(signal.data(), BENCH_MAX_LENGTH, &stats);
+        g_sink += stats.rms;
+    });
+    run("stats_f", BENCH_MAX_LENGTH, [&]() {
+        rp_dsp_stats_t stats;
+        rp_dsp_stats_f(fsignal.data(), BENCH_MAX_LENGTH, &stats);
+        g_sink += stats.rms;
+    });
+
+    // Scope display path: 16k raw ADC words to 1024 min/max columns
+    std::vector<int32_t> raw(BENCH_MAX_LENGTH);
+    std::vector<int32_t> env_min(1024), env_max(1024);
+    std::vector<float> fenv_min(1024), fenv_max(1024);
+    for (uint32_t i = 0; i < BENCH_MAX_LENGTH; i++) {
+        raw[i] = (int32_t)(signal[i] * 8000) & 0x3FFF;
+    }
+    run("envelope", BENCH_MAX_LENGTH, [&]() {
+        rp_dsp_envelope(raw.data(), BENCH_MAX_LENGTH, 100, BENCH_MAX_LENGTH / 1024, 14,
+                        env_min.data(), env_max.data(), NULL, 1024);
+    });
+    run("envelope_f", BENCH_MAX_LENGTH, [&]() {
+        rp_dsp_envelope_f(fsignal.data(), BENCH_MAX_LENGTH, 100, BENCH_MAX_LENGTH / 1024,
+                          fenv_min.data(), fenv_max.data(), NULL, 1024);
+    });
+
+    // Bode/LCR point: both channels demodulated against one tone
+    std::vector<float> lock1(BENCH_LOCKIN_LENGTH), lock2(BENCH_LOCKIN_LENGTH);
+    std::vector<int16_t> lock1_raw(BENCH_LOCKIN_LENGTH), lock2_raw(BENCH_LOCKIN_LENGTH);
+    double cycles = BENCH_LOCKIN_CYCLES;
+    if (record && loadRecord(record, lock1, lock2, &cycles)) {
+        return EXIT_FAILURE;
+    }
+    if (!record) {
+        for (uint32_t i = 0; i < BENCH_LOCKIN_LENGTH; i++) {
+            const double a = 2 * M_PI * cycles * i / BENCH_LOCKIN_LENGTH;
+            lock1[i] = 0.5 * cos(a) + 0.001 * (rand() % 100);
+            lock2[i] = 0.2 * cos(a - 0.3) + 0.1 + 0.001 * (rand() % 100);
+        }
+    }
+    for (uint32_t i = 0; i < BENCH_LOCKIN_LENGTH; i++) {
+        lock1_raw[i] = (int16_t)(lock1[i] * 8191);
+        lock2_raw[i] = (int16_t)(lock2[i] * 8191);
+    }
+    run("lockin_2ch", BENCH_LOCKIN_LENGTH * 2, [&]() {
+        rp_dsp_lockin_t r1, r2;
+        rp_dsp_lockin(lock1.data(), lock2.data(), BENCH_LOCKIN_LENGTH, cycles, &r1, &r2);
+        g_sink += r1.phase - r2.phase;
+    });
+    run("lockin_i16_2ch", BENCH_LOCKIN_LENGTH * 2, [&]() {
+        rp_dsp_lockin_t r1, r2;
+        rp_dsp_lockin_i16(lock1_raw.data(), lock2_raw.data(), BENCH_LOCKIN_LENGTH, cycles, &r1, &r2);
+        g_sink += r1.phase - r2.phase;
+    });
+    run("lockin_sincos_2ch", BENCH_LOCKIN_LENGTH * 2, [&]() {
+        g_sink += lockinSinCos(lock1, lock2, cycles);
+    });
+
+    // Spectrum pipeline: window, FFT, decimation and dBm conversion, stage by stage and in one pass
+    CDSP dsp(BENCH_CHANNELS, BENCH_MAX_LENGTH, BENCH_ADC_SPEED);
+    auto data = dsp.createData();
+    if (!data) {
+        fprintf(stderr, "Can't allocate data\n");
+        return EXIT_FAILURE;
+    }
+    for (uint32_t ch = 0; ch < BENCH_CHANNELS; ch++) {
+        memcpy(data->in[ch], signal.data(), BENCH_MAX_LENGTH * sizeof(double));
+    }
+    for (uint32_t len = 1024; len <= BENCH_MAX_LENGTH; len *= 4) {
+        if (dsp.setSignalLength(len) || dsp.window_init(CDSP::HANNING) || dsp.fftInit()) {
+            fprintf(stderr, "Can't prepare length %u\n", len);
+            continue;
+        }
+        runFFT("cdsp_stages_" + std::to_string(len), BENCH_CHANNELS, [&]() {
+            data->reset();
+            dsp.windowFilter(data);
+            dsp.fft(data);
+            dsp.decimate(data, dsp.getOutSignalLength(), dsp.getOutSignalLength());
+            dsp.cnvToDBM(data, 1);
+        });
+        runFFT("cdsp_spectrum_" + std::to_string(len), BENCH_CHANNELS, [&]() {
+            dsp.spectrum(data, 1);
+        });
+    }
+
+    // Streaming Welch PSD
+    CPSD psd(BENCH_CHANNELS, BENCH_MAX_LENGTH);
+    psd.setSampleRate(BENCH_ADC_SPEED);
+    psd.setOverlap(0.5);
+    psd.setAveraging(CPSD::EXPONENTIAL, 16);
+    for (uint32_t len = 1024; len <= BENCH_MAX_LENGTH; len *= 4) {
+        if (psd.setSegmentLength(len) || psd.init()) {
+            fprintf(stderr, "Can't prepare segment %u\n", len);
+            continue;
+        }
+        run("welch_" + std::to_string(len), BENCH_MAX_LENGTH * BENCH_CHANNELS, [&]() {
+            psd.push(data->in, BENCH_MAX_LENGTH);
+        });
+    }
+    dsp.deleteData(data);
+
+    if (save && saveBaseline(save)) {
+        return EXIT_FAILURE;
+    }
+    if (check && checkBaseline(check, tolerance)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -25,6 +25,7 @@
 
 #include "rp_dsp.h"
 #include "kiss_fftr.h"
+#include "rp_dsp_kernels.h"
 
 #include "rp_math.h"
 
@@ -41,19 +42,6 @@
 /* Const - [W] -> [mW] */
 constexpr double g_w2mw = 1000;
 
-#define RP_SPECTR_HANN_AMP 0.8165 // Hann window power scaling (1/sqrt(sum(rcos.^2/N)))
-
-#define RP_BLACKMAN_A0 0.35875
-#define RP_BLACKMAN_A1 0.48829
-#define RP_BLACKMAN_A2 0.14128
-#define RP_BLACKMAN_A3 0.01168
-
-#define RP_FLATTOP_A0 0.21557895
-#define RP_FLATTOP_A1 0.41663158
-#define RP_FLATTOP_A2 0.277263158
-#define RP_FLATTOP_A3 0.083578947
-#define RP_FLATTOP_A4 0.006947368
-
 using namespace rp_dsp_api;
 
 template<typename T>
@@ -79,20 +67,6 @@ auto deleteArray(uint32_t count,T **arr) -> void {
     delete[] arr;
 }
 
-auto __zeroethOrderBessel( double x ) -> double {
-    const double eps = 0.000001;
-    double Value = 0;
-    double term = 1;
-    double m = 0;
-
-    while(term  > eps * Value){
-        Value += term;
-        ++m;
-        term *= (x * x) / (4 * m * m);
-    }   
-    return Value;
-}
-
 struct CDSP::Impl {
     uint32_t m_max_adc_buffer_size;
     uint32_t m_signal_length;
@@ -105,11 +79,30 @@ struct CDSP::Impl {
     bool     m_remove_DC = true;
     mode_t   m_mode = DBM;
     kiss_fft_cpx** m_kiss_fft_out = NULL;
-    kiss_fftr_cfg  m_kiss_fft_cfg = NULL;
+    std::map<uint32_t,kiss_fftr_cfg> m_kiss_fft_plans;   // FFT plans cached by signal length
+    std::mutex m_planMutex;
     std::mutex m_channelMutex;
     std::map<uint8_t,bool> m_channelState;
+
+    auto getPlan(uint32_t len) -> kiss_fftr_cfg;
+    auto decimateScale() -> double;
+    auto decimateChannel(const double *fft, float *out, uint32_t out_len, uint32_t step, double scale) -> void;
+    auto convertChannel(const float *in, float *out, uint32_t len) -> void;
 };
 
+auto CDSP::Impl::getPlan(uint32_t len) -> kiss_fftr_cfg {
+    std::lock_guard<std::mutex> lock(m_planMutex);
+    auto it = m_kiss_fft_plans.find(len);
+    if (it != m_kiss_fft_plans.end()) {
+        return it->second;
+    }
+    auto cfg = kiss_fftr_alloc(len, 0, NULL, NULL);
+    if (cfg) {
+        m_kiss_fft_plans[len] = cfg;
+    }
+    return cfg;
+}
+
 
 CDSP::CDSP(uint8_t max_channels,uint32_t max_adc_buffer,uint32_t adc_max_speed) {
     m_pimpl = new Impl();
@@ -124,7 +117,6 @@ CDSP::CDSP(uint8_t max_channels,uint32_t max_adc_buffer,uint32_t adc_max_speed)
     m_pimpl->m_remove_DC = true;
     m_pimpl->m_mode = DBM;
     m_pimpl->m_kiss_fft_out = NULL;
-    m_pimpl->m_kiss_fft_cfg = NULL;
     for(uint8_t i = 0 ;i < max_channels; i++){
         m_pimpl->m_channelState[i] = true;
     }
@@ -182,98 +174,33 @@ auto CDSP::getSignalMaxLength() -> uint32_t {
 }
 
 
+auto CDSP::makeWindow(window_mode_t mode, double *window, uint32_t len, double *sum) -> int {
+    return rp_dsp_window((rp_dsp_window_t)mode, window, len, sum);
+}
+
 int CDSP::window_init(CDSP::window_mode_t mode){
-    uint32_t i;
     m_pimpl->m_window_sum  = 0;
     m_pimpl->m_window_mode = mode;
-    window_clean();
-    
-    try{
-        m_pimpl->m_window = new double[getSignalMaxLength()];
-    } catch (const std::bad_alloc& e) {
-        fprintf(stderr, "rp_spectr_window_init() can not allocate mem\n");
-        return -1;
-    }
-    
-    switch(m_pimpl->m_window_mode) {
-        case HANNING:{
-            for(i = 0; i < getSignalLength(); i++) {
-                m_pimpl->m_window[i] = RP_SPECTR_HANN_AMP * 
-                (1 - cos(2*M_PI*i / (double)(getSignalLength()-1)));
-                m_pimpl->m_window_sum += m_pimpl->m_window[i];
-            }
-            break;
-        }
-        case RECTANGULAR:{
-           for(i = 0; i < getSignalLength(); i++) {
-                m_pimpl->m_window[i] = 1;
-                m_pimpl->m_window_sum += m_pimpl->m_window[i];
-            }
-            break;
-        }
-        case HAMMING:{
-            for(i = 0; i < getSignalLength(); i++) {
-                m_pimpl->m_window[i] = 0.54 - 
-                0.46 * cos(2*M_PI*i / (double)(getSignalLength()-1));
-                m_pimpl->m_window_sum += m_pimpl->m_window[i];
-            }
-            break;
-        }
-        case BLACKMAN_HARRIS:{
-            for(i = 0; i < getSignalLength(); i++) {
-                m_pimpl->m_window[i] = RP_BLACKMAN_A0 - 
-                               RP_BLACKMAN_A1 * cos(2*M_PI*i / (double)(getSignalLength()-1)) +
-                               RP_BLACKMAN_A2 * cos(4*M_PI*i / (double)(getSignalLength()-1)) -
-                               RP_BLACKMAN_A3 * cos(6*M_PI*i / (double)(getSignalLength()-1));
-                m_pimpl->m_window_sum += m_pimpl->m_window[i];
-            }
-            break;
-        }
-        case FLAT_TOP:{
-            for(i = 0; i < getSignalLength(); i++) {
-                m_pimpl->m_window[i] = RP_FLATTOP_A0 - 
-                               RP_FLATTOP_A1 * cos(2*M_PI*i / (double)(getSignalLength()-1)) +
-                               RP_FLATTOP_A2 * cos(4*M_PI*i / (double)(getSignalLength()-1)) -
-                               RP_FLATTOP_A3 * cos(6*M_PI*i / (double)(getSignalLength()-1)) +
-                               RP_FLATTOP_A4 * cos(8*M_PI*i / (double)(getSignalLength()-1));
-                m_pimpl->m_window_sum += m_pimpl->m_window[i];
-            }
-            break;
-        }
-        case KAISER_4:{
-            const double x = 1.0 / __zeroethOrderBessel(4);
-            const double y = (getSignalLength() - 1) / 2.0;
-
-            for(i = 0; i < getSignalLength(); i++) {
-                const double K = (i - y) / y;
-                const double arg = sqrt( 1.0 - (K * K) );
-                m_pimpl->m_window[i] = __zeroethOrderBessel( 4 * arg ) * x;
-                m_pimpl->m_window_sum += m_pimpl->m_window[i];
-            }
-            break;
-        }
 
-        case KAISER_8:{
-            const double x = 1.0 / __zeroethOrderBessel(8);
-            const double y = (getSignalLength() - 1) / 2.0;
-
-            for(i = 0; i < getSignalLength(); i++) {
-                const double K = (i - y) / y;
-                const double arg = sqrt( 1.0 - (K * K) );
-                m_pimpl->m_window[i] = __zeroethOrderBessel( 8 * arg ) * x;
-                m_pimpl->m_window_sum += m_pimpl->m_window[i];
-            }
-            break;
-        }
-        default:
-            window_clean();
+    // Sized for the longest signal, so length changes only recompute the coefficients
+    if (!m_pimpl->m_window) {
+        try{
+            m_pimpl->m_window = new double[getSignalMaxLength()];
+        } catch (const std::bad_alloc& e) {
+            fprintf(stderr, "rp_spectr_window_init() can not allocate mem\n");
             return -1;
+        }
+    }
+
+    if (makeWindow(mode, m_pimpl->m_window, getSignalLength(), &m_pimpl->m_window_sum)) {
+        window_clean();
+        return -1;
     }
     return 0;
 }
 
 auto CDSP::window_clean() -> int {
-    delete m_pimpl->m_window;
+    delete[] m_pimpl->m_window;
     m_pimpl->m_window = NULL;
     return 0;
 }
@@ -322,52 +249,48 @@ auto CDSP::prepareFreqVector(data_t *data, double f_s, float decimation) -> int
 
 
 auto CDSP::windowFilter(data_t *data) -> int {
-    uint32_t i,j;
     if (!data || !data->in || !data->filtred){
         fprintf(stderr, "windowFilter() data not initialized\n");
         return -1;
     }
 
-    for(j = 0; j < m_pimpl->m_max_channels; j++) {
-        for(i = 0; i < getSignalLength(); i++) {
-            data->filtred[j][i] = data->in[j][i] * m_pimpl->m_window[i];
-        }
+    for(uint32_t j = 0; j < m_pimpl->m_max_channels; j++) {
+        if (!m_pimpl->m_channelState[j]) continue;
+        rp_dsp_apply_window(data->in[j], m_pimpl->m_window, data->filtred[j], getSignalLength());
     }
     data->is_data_filtred = true;
     return 0;
 }
 
 auto CDSP::fftInit() -> int {
-    if(m_pimpl->m_kiss_fft_out || m_pimpl->m_kiss_fft_cfg) {
-        fftClean();
+    // Output buffers are sized for the longest signal and kept across length changes
+    if(!m_pimpl->m_kiss_fft_out) {
+        m_pimpl->m_kiss_fft_out = createArray<kiss_fft_cpx>(m_pimpl->m_max_channels, getOutSignalMaxLength() + 1);
+        if (!m_pimpl->m_kiss_fft_out) {
+            return -1;
+        }
     }
 
-    m_pimpl->m_kiss_fft_out  = new kiss_fft_cpx*[m_pimpl->m_max_channels];
-    for(uint32_t j = 0; j < m_pimpl->m_max_channels; j++) {
-        m_pimpl->m_kiss_fft_out[j] = new kiss_fft_cpx[getSignalLength()];
+    if (!m_pimpl->getPlan(getSignalLength())) {
+        fprintf(stderr, "fftInit() can not allocate FFT plan\n");
+        return -1;
     }
-
-    m_pimpl->m_kiss_fft_cfg = kiss_fftr_alloc(getSignalLength(), 0, NULL, NULL);
     return 0;
 }
 
 
 auto CDSP::fftClean() -> int {
-    kiss_fft_cleanup();
-    
     if(m_pimpl->m_kiss_fft_out) {    
-        for(uint32_t j = 0; j < m_pimpl->m_max_channels; j++) {
-            if (m_pimpl->m_kiss_fft_out[j])
-                delete[] m_pimpl->m_kiss_fft_out[j];
-        }
-        delete[] m_pimpl->m_kiss_fft_out;
+        deleteArray(m_pimpl->m_max_channels, m_pimpl->m_kiss_fft_out);
         m_pimpl->m_kiss_fft_out = NULL;
-
     }
-    if(m_pimpl->m_kiss_fft_cfg) {
-        free(m_pimpl->m_kiss_fft_cfg);
-        m_pimpl->m_kiss_fft_cfg = NULL;
+
+    std::lock_guard<std::mutex> lock(m_pimpl->m_planMutex);
+    for(auto &plan : m_pimpl->m_kiss_fft_plans) {
+        free(plan.second);
     }
+    m_pimpl->m_kiss_fft_plans.clear();
+    kiss_fft_cleanup();
     return 0;
 }
 
@@ -379,31 +302,77 @@ auto CDSP::fft(data_t *data) -> int {
         return -1;
     }
 
-    if(!m_pimpl->m_kiss_fft_out  || !m_pimpl->m_kiss_fft_cfg) {
+    if(!m_pimpl->m_kiss_fft_out) {
         fprintf(stderr, "rp_spect_fft not initialized");
         return -1;
     }
 
+    auto plan = m_pimpl->getPlan(getSignalLength());
+    if (!plan) {
+        fprintf(stderr, "rp_spect_fft can not allocate FFT plan");
+        return -1;
+    }
+
+    // Each channel is transformed and reduced to amplitudes while its spectrum is still in cache
+    const uint32_t out_len = getOutSignalLength();
     auto _in = data->is_data_filtred ? data->filtred : data->in;
     for(uint32_t j = 0; j < m_pimpl->m_max_channels; j++) {
         if (!m_pimpl->m_channelState[j]) continue;
-        kiss_fftr(m_pimpl->m_kiss_fft_cfg, (kiss_fft_scalar *)_in[j], m_pimpl->m_kiss_fft_out[j]);
+        kiss_fftr(plan, (kiss_fft_scalar *)_in[j], m_pimpl->m_kiss_fft_out[j]);
+        // FFT limited to fs/2, specter of amplitudes
+        rp_dsp_magnitude(m_pimpl->m_kiss_fft_out[j], data->fft[j], out_len);
     }
+    return 0;
+}
 
-    for(uint32_t j = 0; j < m_pimpl->m_max_channels; j++) {
-        if (!m_pimpl->m_channelState[j]) continue;
-        for(uint32_t i = 0; i < getOutSignalLength(); i++) {                     // FFT limited to fs/2, specter of amplitudes            
-            data->fft[j][i] = sqrtf_neon(pow(m_pimpl->m_kiss_fft_out[j][i].r, 2) +
-                            pow(m_pimpl->m_kiss_fft_out[j][i].i, 2));
+// Amplitude to output unit is x * scale for V and dBu, (x * scale)^2 for power in W
+auto CDSP::Impl::decimateScale() -> double {
+    float wsumf = 1.0 / (float)m_window_sum * 2.0;
+    if (m_mode == DBM) {
+        return (wsumf * wsumf) / 2.0 / m_imp;
+    }
+    if (m_mode == DBU) {
+        return wsumf / 1.414213562;
+    }
+    return wsumf;
+}
+
+auto CDSP::Impl::decimateChannel(const double *fft, float *out, uint32_t out_len, uint32_t step, double scale) -> void {
+    for(uint32_t i = 0, j = 0; i < out_len; i++, j += step) {
+        double sum = 0;
+        if (m_mode == DBM) {
+            // Summing the power expressed in Watts associated to each FFT bin
+            for(uint32_t k = j; k < j + step; k++) {
+                sum += fft[k] * fft[k];
+            }
+        } else {
+            for(uint32_t k = j; k < j + step; k++) {
+                sum += fft[k];
+            }
         }
+        out[i] = sum * scale / step;
+    }
+}
+
+auto CDSP::Impl::convertChannel(const float *in, float *out, uint32_t len) -> void {
+    switch (m_mode) {
+        case DBM:
+            // W -> mW -> dBm, -120 dBm instead of -Inf for log10(0.0)
+            rp_dsp_to_db(in, out, len, g_w2mw, 10, 1.0e-12, -120);
+            break;
+        case DBU:
+            // ( 20*log10( 0.686 / .775 ))
+            rp_dsp_to_db(in, out, len, 1 / 0.775, 20, 1.0e-12 / g_w2mw / 0.775, -120);
+            break;
+        default:
+            memcpy(out, in, len * sizeof(float));
+            break;
     }
-    return 0;
 }
 
 auto CDSP::decimate(data_t *data,uint32_t in_len, uint32_t out_len) -> int {
     std::lock_guard<std::mutex> lock(m_pimpl->m_channelMutex);
     uint32_t step;
-    uint32_t i, j;
 
     if (!data || !data->decimated || !data->fft){
         fprintf(stderr, "decimated() data not initialized\n");
@@ -413,43 +382,16 @@ auto CDSP::decimate(data_t *data,uint32_t in_len, uint32_t out_len) -> int {
     step = (uint32_t)round((float)in_len / (float)out_len);
     if(step < 1)
         step = 1;
-    
-    float wsumf = 1.0 / (float)m_pimpl->m_window_sum * 2.0;
 
-    for(uint32_t c = 0; c < m_pimpl->m_max_channels; c++) {
-        if (!m_pimpl->m_channelState[c]) continue; 
-        for(i = 0, j = 0; i < out_len; i++, j+=step) {
-            uint32_t k=j;
+    if (out_len > 0 && (out_len - 1) * step >= in_len) {
+        fprintf(stderr, "rp_spectr_decimate() index too high\n");
+        return -1;
+    }
 
-            if(j >= in_len) {
-                fprintf(stderr, "rp_spectr_decimate() index too high\n");
-                return -1;
-            }
-            data->decimated[c][i] = 0;
-
-            for(k=j; k < j+step; k++) {
-        
-                double ch_p = 0;
-                
-                //dBm                
-                if (getMode() == DBM){
-                    /* Conversion to power (Watts) */
-                    // V -> RMS -> power
-                    ch_p = pow((data->fft[c][k] * wsumf) / 1.414213562, 2) /m_pimpl->m_imp;
-                }
-                // V
-                if (getMode() == VOLT){
-                    ch_p = data->fft[c][k] * wsumf;
-                }
-                // dBu
-                if (getMode() == DBU){
-                    ch_p = data->fft[c][k] * wsumf / 1.414213562;
-                }
-        
-                data->decimated[c][i] += (double)ch_p;  // Summing the power expressed in Watts associated to each FFT bin
-            }
-            data->decimated[c][i] /= step;
-        }
+    const double scale = m_pimpl->decimateScale();
+    for(uint32_t c = 0; c < m_pimpl->m_max_channels; c++) {
+        if (!m_pimpl->m_channelState[c]) continue;
+        m_pimpl->decimateChannel(data->fft[c], data->decimated[c], out_len, step, scale);
     }
     return 0;
 }
@@ -460,12 +402,10 @@ auto CDSP::cnvToDBM(data_t *data,uint32_t  decimation) -> int {
         fprintf(stderr, "cnvToDBM() data not initialized\n");
         return -1;
     }
-    
-    double *max_pw = new double[m_pimpl->m_max_channels];
-    int *max_pw_idx = new int[m_pimpl->m_max_channels];
 
+    const uint32_t len = getOutSignalLength();
     float freq_smpl = (float)m_pimpl->m_adc_max_speed / (float)decimation;
-   
+
     if (m_pimpl->m_remove_DC) {
         for(uint32_t c = 0; c < m_pimpl->m_max_channels; c++) {
             data->converted[c][0] = data->converted[c][1] = data->decimated[c][2];
@@ -474,35 +414,14 @@ auto CDSP::cnvToDBM(data_t *data,uint32_t  decimation) -> int {
 
     for(uint32_t c = 0; c < m_pimpl->m_max_channels; c++) {
         if (!m_pimpl->m_channelState[c]) continue;
-        max_pw[c] =  -1e5;
-        max_pw_idx[c] = 0;
-        for(uint32_t i = 0; i < getOutSignalLength(); i++) {
-
-            /* Conversion to power (Watts) */
-
-            double ch_p = data->decimated[c][i];
-           
-            // Avoiding -Inf due to log10(0.0)
-            
-            if (ch_p * g_w2mw > 1.0e-12 )	
-                data->converted[c][i] = 10 * log10f_neon(ch_p * g_w2mw);  // W -> mW -> dBm
-            else	
-                data->converted[c][i] = 10 * log10f_neon(1.0e-12);
-            
-            
-            /* Find peaks */
-            if(data->converted[c][i] > max_pw[c]) {
-                max_pw[c]     = data->converted[c][i];
-                max_pw_idx[c] = i;
-            }
-        }
-        data->peak_power[c] = max_pw[c];
-        data->peak_freq[c] = ((float)max_pw_idx[c] / (float)getOutSignalLength() * freq_smpl  / 2);
-    }
-
-    delete[] max_pw;
-    delete[] max_pw_idx;
+        // W -> mW -> dBm, avoiding -Inf due to log10(0.0)
+        rp_dsp_to_db(data->decimated[c], data->converted[c], len, g_w2mw, 10, 1.0e-12, -120);
 
+        /* Find peaks */
+        uint32_t max_pw_idx = rp_dsp_max_index_f(data->converted[c], len);
+        data->peak_power[c] = data->converted[c][max_pw_idx];
+        data->peak_freq[c] = ((float)max_pw_idx / (float)len * freq_smpl  / 2);
+    }
     return 0;
 }
 
@@ -512,46 +431,36 @@ auto CDSP::cnvToDBMMaxValueRanged(data_t *data,uint32_t  decimation,uint32_t min
         fprintf(stderr, "cnvToDBM() data not initialized\n");
         return -1;
     }
-    
-    double *max_pw = new double[m_pimpl->m_max_channels];
-    int *max_pw_idx = new int[m_pimpl->m_max_channels];
+
+    const uint32_t len = getOutSignalLength();
     float freq_smpl = (float)m_pimpl->m_adc_max_speed / (float)decimation;
     if (m_pimpl->m_remove_DC) {
         for(uint32_t c = 0; c < m_pimpl->m_max_channels; c++) {
             data->converted[c][0] = data->converted[c][1] = data->decimated[c][2];
         }
-    }    
+    }
+
+    // Bins within [minFreq, maxFreq], the frequency grows with the index
+    uint32_t first = 0;
+    while (first < len && ((float)first / (float)len * freq_smpl  / 2) < minFreq) first++;
+    uint32_t last = first;
+    while (last < len && ((float)last / (float)len * freq_smpl  / 2) <= maxFreq) last++;
+
     for(uint32_t c = 0; c < m_pimpl->m_max_channels; c++) {
         if (!m_pimpl->m_channelState[c]) continue;
-        max_pw[c] =  -1e5;
-        max_pw_idx[c] = 0;
-        for(uint32_t i = 0; i < getOutSignalLength(); i++) {
-
-            /* Conversion to power (Watts) */
-
-            double ch_p = data->decimated[c][i];
-           
-            // Avoiding -Inf due to log10(0.0)
-            
-            if (ch_p * g_w2mw > 1.0e-12 )	
-                data->converted[c][i] = 10 * log10f_neon(ch_p * g_w2mw);  // W -> mW -> dBm
-            else	
-                data->converted[c][i] = 10 * log10f_neon(1.0e-12);
-            
-            auto currentFreq = ((float)i / (float)getOutSignalLength() * freq_smpl  / 2);
-            if (currentFreq < minFreq || currentFreq > maxFreq) continue;
-          
-            /* Find peaks */
-            if(data->converted[c][i] > max_pw[c]) {
-                max_pw[c]     = data->converted[c][i];
-                max_pw_idx[c] = i;
-            }
+        // W -> mW -> dBm, avoiding -Inf due to log10(0.0)
+        rp_dsp_to_db(data->decimated[c], data->converted[c], len, g_w2mw, 10, 1.0e-12, -120);
+
+        /* Find peaks */
+        float max_pw = -1e5;
+        uint32_t max_pw_idx = 0;
+        if (first < last) {
+            max_pw_idx = first + rp_dsp_max_index_f(data->converted[c] + first, last - first);
+            max_pw = data->converted[c][max_pw_idx];
         }
-        data->peak_power[c] = max_pw[c];
-        data->peak_freq[c] = ((float)max_pw_idx[c] / (float)getOutSignalLength() * freq_smpl  / 2) ;
+        data->peak_power[c] = max_pw;
+        data->peak_freq[c] = ((float)max_pw_idx / (float)len * freq_smpl  / 2) ;
     }
-    delete[] max_pw;
-    delete[] max_pw_idx;
     return 0;
 }
 
@@ -562,11 +471,8 @@ auto CDSP::cnvToMetric(data_t *data,uint32_t  decimation) -> int{
         fprintf(stderr, "cnvToDBM() data not initialized\n");
         return -1;
     }
-    uint32_t i;
-    
-    double *max_pw = new double[m_pimpl->m_max_channels];
-    int *max_pw_idx = new int[m_pimpl->m_max_channels];
-    
+
+    const uint32_t len = getOutSignalLength();
     float  freq_smpl = (float)m_pimpl->m_adc_max_speed / (float)decimation;
 
     if (m_pimpl->m_remove_DC) {
@@ -577,47 +483,57 @@ auto CDSP::cnvToMetric(data_t *data,uint32_t  decimation) -> int{
 
     for(uint32_t c = 0; c < m_pimpl->m_max_channels; c++) {
         if (!m_pimpl->m_channelState[c]) continue;
-        max_pw[c] = -10000;
-        max_pw_idx[c] = 0;
-        for(i = 0; i < getOutSignalLength(); i++) {
-
-            /* Conversion to power (Watts) */
-            if (getMode() == DBM){
-                double ch_p=data->decimated[c][i];
-                if (ch_p * g_w2mw > 1.0e-12 )	
-                    data->converted[c][i] = 10 * log10f_neon(ch_p * g_w2mw);  // W -> mW -> dBm
-                else	
-                    data->converted[c][i] = -120;
-            }
-
-            if (getMode() == VOLT){
-                data->converted[c][i] = data->decimated[c][i];
-            }
+        m_pimpl->convertChannel(data->decimated[c], data->converted[c], len);
 
-            if (getMode() == DBU){
-                double ch_p = data->decimated[c][i];
-                // ( 20*log10( 0.686 / .775 ))
-                if (ch_p * g_w2mw > 1.0e-12 )	
-                    data->converted[c][i] = 20 * log10f_neon(ch_p / 0.775);
-                else	
-                    data->converted[c][i] = -120;
-            }
+        /* Find peaks */
+        uint32_t max_pw_idx = rp_dsp_max_index_f(data->converted[c], len);
+        data->peak_power[c] = data->converted[c][max_pw_idx];
+        data->peak_freq[c] = ((float)max_pw_idx / (float)len * freq_smpl  / 2) ;
+    }
+    return 0;
+}
 
-            /* Find peaks */
-            if(data->converted[c][i] > max_pw[c]) {
-                max_pw[c]     = data->converted[c][i];
-                max_pw_idx[c] = i;
-            }
-        }
+auto CDSP::spectrum(data_t *data,uint32_t  decimation) -> int {
+    if (!data || !data->in || !data->filtred || !data->fft || !data->decimated || !data->converted || !data->peak_freq || !data->peak_power){
+        fprintf(stderr, "spectrum() data not initialized\n");
+        return -1;
+    }
 
+    if(!m_pimpl->m_kiss_fft_out) {
+        fprintf(stderr, "spectrum() FFT not initialized\n");
+        return -1;
+    }
 
-        data->peak_power[c] = max_pw[c];
-        data->peak_freq[c] = ((float)max_pw_idx[c] / (float)getOutSignalLength() * freq_smpl  / 2) ;
+    auto plan = m_pimpl->getPlan(getSignalLength());
+    if (!plan) {
+        fprintf(stderr, "spectrum() can not allocate FFT plan\n");
+        return -1;
     }
 
-    delete[] max_pw;
-    delete[] max_pw_idx;
+    std::lock_guard<std::mutex> lock(m_pimpl->m_channelMutex);
+    const uint32_t len = getSignalLength();
+    const uint32_t out_len = getOutSignalLength();
+    const double scale = m_pimpl->decimateScale();
+    const float freq_smpl = (float)m_pimpl->m_adc_max_speed / (float)decimation;
 
+    // Every channel goes from the window to the peak while its buffers are still in cache
+    for(uint32_t c = 0; c < m_pimpl->m_max_channels; c++) {
+        if (!m_pimpl->m_channelState[c]) continue;
+        const double *in = data->in[c];
+        if (m_pimpl->m_window) {
+            rp_dsp_apply_window(in, m_pimpl->m_window, data->filtred[c], len);
+            in = data->filtred[c];
+        }
+        kiss_fftr(plan, (const kiss_fft_scalar *)in, m_pimpl->m_kiss_fft_out[c]);
+        rp_dsp_magnitude(m_pimpl->m_kiss_fft_out[c], data->fft[c], out_len);
+        m_pimpl->decimateChannel(data->fft[c], data->decimated[c], out_len, 1, scale);
+        m_pimpl->convertChannel(data->decimated[c], data->converted[c], out_len);
+
+        uint32_t max_pw_idx = rp_dsp_max_index_f(data->converted[c], out_len);
+        data->peak_power[c] = data->converted[c][max_pw_idx];
+        data->peak_freq[c] = ((float)max_pw_idx / (float)out_len * freq_smpl  / 2);
+    }
+    data->is_data_filtred = m_pimpl->m_window != NULL;
     return 0;
 }
 
@@ -72,6 +72,9 @@ public:
     auto window_clean() -> int;
     auto getCurrentWindowMode() -> CDSP::window_mode_t;
 
+    // Fills window with len coefficients and returns their sum in sum
+    static auto makeWindow(window_mode_t mode, double *window, uint32_t len, double *sum) -> int;
+
     auto setImpedance(double value) -> void;
     auto getImpedance() -> double;
 
@@ -93,6 +96,9 @@ public:
     auto cnvToDBMMaxValueRanged(data_t *data,uint32_t  decimation,uint32_t minFreq,uint32_t maxFreq) -> int;
     auto cnvToMetric(data_t *data,uint32_t  decimation) -> int;
 
+    // windowFilter(), fft(), decimate() to the output length and cnvToMetric() of all channels in one pass
+    auto spectrum(data_t *data,uint32_t  decimation) -> int;
+
 private:
 
     CDSP(const CDSP &) = delete;
@@ -0,0 +1,880 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya DSP kernels shared by the DSP library and the applications.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "rp_dsp_kernels.h"
+#include "kiss_fftr.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define RP_DSP_NEON
+#endif
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+#define RP_SPECTR_HANN_AMP 0.8165 // Hann window power scaling (1/sqrt(sum(rcos.^2/N)))
+
+#define RP_BLACKMAN_A0 0.35875
+#define RP_BLACKMAN_A1 0.48829
+#define RP_BLACKMAN_A2 0.14128
+#define RP_BLACKMAN_A3 0.01168
+
+#define RP_FLATTOP_A0 0.21557895
+#define RP_FLATTOP_A1 0.41663158
+#define RP_FLATTOP_A2 0.277263158
+#define RP_FLATTOP_A3 0.083578947
+#define RP_FLATTOP_A4 0.006947368
+
+struct rp_dsp_fftr_s {
+    uint32_t      len;
+    kiss_fftr_cfg cfg;
+    kiss_fft_cpx *out;
+};
+
+static double zeroethOrderBessel(double x) {
+    const double eps = 0.000001;
+    double value = 0;
+    double term = 1;
+    double m = 0;
+
+    while(term > eps * value){
+        value += term;
+        ++m;
+        term *= (x * x) / (4 * m * m);
+    }
+    return value;
+}
+
+rp_dsp_fftr_t *rp_dsp_fftr_alloc(uint32_t len) {
+    if (len < 2 || (len & 1)) {
+        return NULL;
+    }
+    rp_dsp_fftr_t *fft = (rp_dsp_fftr_t *)calloc(1, sizeof(rp_dsp_fftr_t));
+    if (!fft) {
+        return NULL;
+    }
+    fft->len = len;
+    fft->cfg = kiss_fftr_alloc(len, 0, NULL, NULL);
+    fft->out = (kiss_fft_cpx *)malloc((len / 2 + 1) * sizeof(kiss_fft_cpx));
+    if (!fft->cfg || !fft->out) {
+        fprintf(stderr, "rp_dsp_fftr_alloc() can not allocate mem\n");
+        rp_dsp_fftr_free(fft);
+        return NULL;
+    }
+    return fft;
+}
+
+void rp_dsp_fftr_free(rp_dsp_fftr_t *fft) {
+    if (!fft) {
+        return;
+    }
+    kiss_fftr_free(fft->cfg);
+    free(fft->out);
+    free(fft);
+}
+
+uint32_t rp_dsp_fftr_len(const rp_dsp_fftr_t *fft) {
+    return fft ? fft->len : 0;
+}
+
+const kiss_fft_cpx *rp_dsp_fftr(rp_dsp_fftr_t *fft, const double *in) {
+    if (!fft || !in) {
+        return NULL;
+    }
+    kiss_fftr(fft->cfg, (const kiss_fft_scalar *)in, fft->out);
+    return fft->out;
+}
+
+int rp_dsp_fftr_mag(rp_dsp_fftr_t *fft, const double *in, double *mag, uint32_t bins) {
+    if (!fft || !mag || bins > fft->len / 2 + 1) {
+        return -1;
+    }
+    const kiss_fft_cpx *out = rp_dsp_fftr(fft, in);
+    if (!out) {
+        return -1;
+    }
+    rp_dsp_magnitude(out, mag, bins);
+    return 0;
+}
+
+int rp_dsp_window(rp_dsp_window_t mode, double *window, uint32_t len, double *sum) {
+    uint32_t i;
+    double s = 0;
+
+    if (!window || len < 2) {
+        return -1;
+    }
+
+    const double step = 2 * M_PI / (double)(len - 1);
+
+    switch(mode) {
+        case RP_DSP_WIN_HANNING:
+            for(i = 0; i < len; i++) {
+                window[i] = RP_SPECTR_HANN_AMP * (1 - cos(step * i));
+                s += window[i];
+            }
+            break;
+
+        case RP_DSP_WIN_RECTANGULAR:
+            for(i = 0; i < len; i++) {
+                window[i] = 1;
+            }
+            s = len;
+            break;
+
+        case RP_DSP_WIN_HAMMING:
+            for(i = 0; i < len; i++) {
+                window[i] = 0.54 - 0.46 * cos(step * i);
+                s += window[i];
+            }
+            break;
+
+        case RP_DSP_WIN_BLACKMAN_HARRIS:
+            for(i = 0; i < len; i++) {
+                window[i] = RP_BLACKMAN_A0 -
+                            RP_BLACKMAN_A1 * cos(step * i) +
+                            RP_BLACKMAN_A2 * cos(2 * step * i) -
+                            RP_BLACKMAN_A3 * cos(3 * step * i);
+                s += window[i];
+            }
+            break;
+
+        case RP_DSP_WIN_FLAT_TOP:
+            for(i = 0; i < len; i++) {
+                window[i] = RP_FLATTOP_A0 -
+                            RP_FLATTOP_A1 * cos(step * i) +
+                            RP_FLATTOP_A2 * cos(2 * step * i) -
+                            RP_FLATTOP_A3 * cos(3 * step * i) +
+                            RP_FLATTOP_A4 * cos(4 * step * i);
+                s += window[i];
+            }
+            break;
+
+        case RP_DSP_WIN_KAISER_4:
+        case RP_DSP_WIN_KAISER_8: {
+            const double beta = mode == RP_DSP_WIN_KAISER_4 ? 4 : 8;
+            const double x = 1.0 / zeroethOrderBessel(beta);
+            const double y = (len - 1) / 2.0;
+
+            for(i = 0; i < len; i++) {
+                const double K = (i - y) / y;
+                const double arg = sqrt(1.0 - (K * K));
+                window[i] = zeroethOrderBessel(beta * arg) * x;
+                s += window[i];
+            }
+            break;
+        }
+
+        default:
+            return -1;
+    }
+
+    if (sum) {
+        *sum = s;
+    }
+    return 0;
+}
+
+int rp_dsp_hann(double amp, double *window, uint32_t len) {
+    uint32_t i;
+
+    if (!window || len < 2) {
+        return -1;
+    }
+
+    const double step = 2 * M_PI / (double)(len - 1);
+    for(i = 0; i < len; i++) {
+        window[i] = amp * (1 - cos(step * i));
+    }
+    return 0;
+}
+
+void rp_dsp_apply_window(const double *in, const double *window, double *out, uint32_t len) {
+    uint32_t i;
+    for(i = 0; i < len; i++) {
+        out[i] = in[i] * window[i];
+    }
+}
+
+#ifdef RP_DSP_NEON
+static inline float hsumq(float32x4_t v) {
+    const float32x2_t p = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(p, p), 0);
+}
+
+/* sqrt(x) = x * rsqrt(x), the estimate refined by two Newton steps, zero stays zero */
+static inline float32x4_t sqrtq(float32x4_t x) {
+    float32x4_t e = vrsqrteq_f32(x);
+    e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(x, e), e));
+    e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(x, e), e));
+    return vbslq_f32(vceqq_f32(x, vdupq_n_f32(0)), x, vmulq_f32(x, e));
+}
+
+/* log10(x) of positive normal x: the exponent plus a polynomial of the mantissa in [1, 2) */
+static inline float32x4_t log10q(float32x4_t x) {
+    const int32x4_t bits = vreinterpretq_s32_f32(x);
+    const int32x4_t e = vsubq_s32(vshrq_n_s32(bits, 23), vdupq_n_s32(127));
+    const float32x4_t m = vreinterpretq_f32_s32(vsubq_s32(bits, vshlq_n_s32(e, 23)));
+    float32x4_t p = vdupq_n_f32(0.006135635201050f);
+    p = vmlaq_f32(vdupq_n_f32(-0.07176870463131f), p, m);
+    p = vmlaq_f32(vdupq_n_f32(0.366547581117400f), p, m);
+    p = vmlaq_f32(vdupq_n_f32(-1.07301643912502f), p, m);
+    p = vmlaq_f32(vdupq_n_f32(1.991005185100089f), p, m);
+    p = vmlaq_f32(vdupq_n_f32(-2.46980061535534f), p, m);
+    p = vmlaq_f32(vdupq_n_f32(2.247870219989470f), p, m);
+    p = vmlaq_f32(vdupq_n_f32(-0.99697286229624f), p, m);
+    return vmlaq_f32(p, vcvtq_f32_s32(e), vdupq_n_f32(0.3010299957f));
+}
+#endif
+
+void rp_dsp_apply_window_f(const float *in, const float *window, float *out, uint32_t len) {
+    uint32_t i = 0;
+#ifdef RP_DSP_NEON
+    for(; i + 4 <= len; i += 4) {
+        vst1q_f32(out + i, vmulq_f32(vld1q_f32(in + i), vld1q_f32(window + i)));
+    }
+#endif
+    for(; i < len; i++) {
+        out[i] = in[i] * window[i];
+    }
+}
+
+void rp_dsp_magnitude(const kiss_fft_cpx *in, double *out, uint32_t len) {
+    uint32_t i = 0;
+#ifdef RP_DSP_NEON
+    // The squares stay in double, the square root that VFP does not pipeline runs on four bins at once
+    float pw[4], mag[4];
+    for(; i + 4 <= len; i += 4) {
+        uint32_t k;
+        for(k = 0; k < 4; k++) {
+            pw[k] = (float)(in[i + k].r * in[i + k].r + in[i + k].i * in[i + k].i);
+        }
+        vst1q_f32(mag, sqrtq(vld1q_f32(pw)));
+        for(k = 0; k < 4; k++) {
+            out[i + k] = mag[k];
+        }
+    }
+#endif
+    for(; i < len; i++) {
+        out[i] = sqrt(in[i].r * in[i].r + in[i].i * in[i].i);
+    }
+}
+
+void rp_dsp_to_db(const float *in, float *out, uint32_t len, float scale, float mul, float min, float below) {
+    uint32_t i = 0;
+#ifdef RP_DSP_NEON
+    const float32x4_t vscale = vdupq_n_f32(scale), vmul = vdupq_n_f32(mul);
+    const float32x4_t vmin = vdupq_n_f32(min), vbelow = vdupq_n_f32(below);
+    for(; i + 4 <= len; i += 4) {
+        const float32x4_t x = vmulq_f32(vld1q_f32(in + i), vscale);
+        const float32x4_t db = vmulq_f32(log10q(x), vmul);
+        vst1q_f32(out + i, vbslq_f32(vcgtq_f32(x, vmin), db, vbelow));
+    }
+#endif
+    for(; i < len; i++) {
+        const float x = in[i] * scale;
+        out[i] = x > min ? mul * log10f(x) : below;
+    }
+}
+
+uint32_t rp_dsp_max_index(const double *in, uint32_t len) {
+    uint32_t i, idx = 0;
+    for(i = 1; i < len; i++) {
+        if (in[i] > in[idx]) {
+            idx = i;
+        }
+    }
+    return idx;
+}
+
+uint32_t rp_dsp_max_index_f(const float *in, uint32_t len) {
+    uint32_t i = 1, idx = 0;
+#ifdef RP_DSP_NEON
+    if (len >= 8) {
+        // Every lane keeps its first maximum, ties between lanes go to the lower index
+        const uint32_t start[4] = {0, 1, 2, 3};
+        float32x4_t vmax = vld1q_f32(in);
+        uint32x4_t vidx = vld1q_u32(start);
+        uint32x4_t cur = vidx;
+        const uint32x4_t four = vdupq_n_u32(4);
+        for(i = 4; i + 4 <= len; i += 4) {
+            const float32x4_t v = vld1q_f32(in + i);
+            const uint32x4_t gt = vcgtq_f32(v, vmax);
+            cur = vaddq_u32(cur, four);
+            vmax = vbslq_f32(gt, v, vmax);
+            vidx = vbslq_u32(gt, cur, vidx);
+        }
+        float lane_max[4];
+        uint32_t lane_idx[4], k;
+        vst1q_f32(lane_max, vmax);
+        vst1q_u32(lane_idx, vidx);
+        idx = lane_idx[0];
+        for(k = 1; k < 4; k++) {
+            if (lane_max[k] > in[idx] || (lane_max[k] == in[idx] && lane_idx[k] < idx)) {
+                idx = lane_idx[k];
+            }
+        }
+    }
+#endif
+    for(; i < len; i++) {
+        if (in[i] > in[idx]) {
+            idx = i;
+        }
+    }
+    return idx;
+}
+
+int rp_dsp_decimate_power(const double *in, uint32_t in_len, float *out, uint32_t out_len, double scale) {
+    uint32_t i, j, k, step;
+
+    if (!in || !out || out_len == 0) {
+        return -1;
+    }
+
+    step = (uint32_t)round((double)in_len / (double)out_len);
+    if (step < 1)
+        step = 1;
+
+    if ((uint64_t)(out_len - 1) * step >= in_len) {
+        fprintf(stderr, "rp_dsp_decimate_power() index too high\n");
+        return -1;
+    }
+
+    for(i = 0, j = 0; i < out_len; i++, j += step) {
+        const uint32_t end = j + step < in_len ? j + step : in_len;
+        double p = 0;
+        for(k = j; k < end; k++) {
+            p += in[k] * in[k];
+        }
+        out[i] = (float)(p * scale);
+    }
+    return 0;
+}
+
+/* Sum of squares of one run */
+static inline float sumSquaresF(const float *in, uint32_t len) {
+    uint32_t i = 0;
+    float p = 0;
+#ifdef RP_DSP_NEON
+    if (len >= 4) {
+        float32x4_t vp = vdupq_n_f32(0);
+        for(; i + 4 <= len; i += 4) {
+            const float32x4_t v = vld1q_f32(in + i);
+            vp = vmlaq_f32(vp, v, v);
+        }
+        p = hsumq(vp);
+    }
+#endif
+    for(; i < len; i++) {
+        p += in[i] * in[i];
+    }
+    return p;
+}
+
+int rp_dsp_decimate_power_f(const float *in, uint32_t in_len, float *out, uint32_t out_len, float scale) {
+    uint32_t i = 0, j, step;
+
+    if (!in || !out || out_len == 0) {
+        return -1;
+    }
+
+    step = (uint32_t)round((double)in_len / (double)out_len);
+    if (step < 1)
+        step = 1;
+
+    if ((uint64_t)(out_len - 1) * step >= in_len) {
+        fprintf(stderr, "rp_dsp_decimate_power_f() index too high\n");
+        return -1;
+    }
+
+    if (step == 1) {
+        // One bin per output, the outputs are vectorized instead of the runs
+#ifdef RP_DSP_NEON
+        const float32x4_t vscale = vdupq_n_f32(scale);
+        for(; i + 4 <= out_len; i += 4) {
+            const float32x4_t v = vld1q_f32(in + i);
+            vst1q_f32(out + i, vmulq_f32(vmulq_f32(v, v), vscale));
+        }
+#endif
+        for(; i < out_len; i++) {
+            out[i] = in[i] * in[i] * scale;
+        }
+        return 0;
+    }
+
+    for(i = 0, j = 0; i < out_len; i++, j += step) {
+        const uint32_t end = j + step < in_len ? j + step : in_len;
+        out[i] = sumSquaresF(in + j, end - j) * scale;
+    }
+    return 0;
+}
+
+void rp_dsp_goertzel(const double *in, uint32_t len, double cycles, double *re, double *im) {
+    uint32_t n;
+    const double w = 2 * M_PI * cycles / (double)len;
+    const double c = cos(w);
+    const double s = sin(w);
+    const double coeff = 2 * c;
+    double s1 = 0, s2 = 0;
+
+    for(n = 0; n < len; n++) {
+        const double s0 = in[n] + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+
+    // y = exp(j*w) * s[N-1] - s[N-2] is the DFT rotated by exp(j*w*N)
+    const double yr = c * s1 - s2;
+    const double yi = s * s1;
+    const double p = -w * (double)len;
+    const double cr = cos(p);
+    const double ci = sin(p);
+    *re = yr * cr - yi * ci;
+    *im = yr * ci + yi * cr;
+}
+
+void rp_dsp_iq_demod(const double *in, uint32_t len, double cycles, double *amp, double *phase) {
+    double re, im;
+    rp_dsp_goertzel(in, len, cycles, &re, &im);
+    *amp = sqrt(re * re + im * im) * 2 / len;
+    *phase = atan2(im, re);
+}
+
+void rp_dsp_stats(const double *in, uint32_t len, rp_dsp_stats_t *stats) {
+    uint32_t i;
+    double mn, mx, sum = 0, sum2 = 0;
+
+    if (!stats) {
+        return;
+    }
+    if (!in || len == 0) {
+        stats->min = stats->max = stats->mean = stats->rms = stats->std = 0;
+        return;
+    }
+
+    mn = mx = in[0];
+    for(i = 0; i < len; i++) {
+        const double v = in[i];
+        mn = v < mn ? v : mn;
+        mx = v > mx ? v : mx;
+        sum += v;
+        sum2 += v * v;
+    }
+
+    stats->min = mn;
+    stats->max = mx;
+    stats->mean = sum / len;
+    stats->rms = sqrt(sum2 / len);
+    const double var = sum2 / len - stats->mean * stats->mean;
+    stats->std = var > 0 ? sqrt(var) : 0;
+}
+
+/* Samples summed in single precision before they are added to the double totals */
+#define RP_DSP_STATS_BLOCK 256
+
+void rp_dsp_stats_f(const float *in, uint32_t len, rp_dsp_stats_t *stats) {
+    uint32_t i = 0;
+    float mn, mx;
+    double sum = 0, sum2 = 0;
+
+    if (!stats) {
+        return;
+    }
+    if (!in || len == 0) {
+        stats->min = stats->max = stats->mean = stats->rms = stats->std = 0;
+        return;
+    }
+
+    mn = mx = in[0];
+#ifdef RP_DSP_NEON
+    if (len >= 4) {
+        float32x4_t vlo = vdupq_n_f32(mn), vhi = vdupq_n_f32(mx);
+        float32x2_t p;
+        while (i + 4 <= len) {
+            const uint32_t end = len - i > RP_DSP_STATS_BLOCK ? i + RP_DSP_STATS_BLOCK : len;
+            float32x4_t vs = vdupq_n_f32(0), vs2 = vdupq_n_f32(0);
+            for(; i + 4 <= end; i += 4) {
+                const float32x4_t v = vld1q_f32(in + i);
+                vlo = vminq_f32(vlo, v);
+                vhi = vmaxq_f32(vhi, v);
+                vs = vaddq_f32(vs, v);
+                vs2 = vmlaq_f32(vs2, v, v);
+            }
+            sum += hsumq(vs);
+            sum2 += hsumq(vs2);
+        }
+        p = vmin_f32(vget_low_f32(vlo), vget_high_f32(vlo));
+        mn = vget_lane_f32(vpmin_f32(p, p), 0);
+        p = vmax_f32(vget_low_f32(vhi), vget_high_f32(vhi));
+        mx = vget_lane_f32(vpmax_f32(p, p), 0);
+    }
+#endif
+    for(; i < len; i++) {
+        const float v = in[i];
+        mn = v < mn ? v : mn;
+        mx = v > mx ? v : mx;
+        sum += v;
+        sum2 += (double)v * v;
+    }
+
+    stats->min = mn;
+    stats->max = mx;
+    stats->mean = sum / len;
+    stats->rms = sqrt(sum2 / len);
+    const double var = sum2 / len - stats->mean * stats->mean;
+    stats->std = var > 0 ? sqrt(var) : 0;
+}
+
+/* Min/max of one run, sum is NULL when the caller does not want the mean. The
+ * scalar loops are not vectorized by the -Os build, NEON does four samples per step. */
+static inline void envelopeRun(const int32_t *in, uint32_t len, uint32_t shift,
+                               int32_t *mn, int32_t *mx, int64_t *sum) {
+    uint32_t i = 0;
+    int32_t lo = *mn, hi = *mx;
+    int64_t s = 0;
+#ifdef RP_DSP_NEON
+    if (len >= 4) {
+        // Sign extension from bits: shift left, then arithmetic shift right
+        const int32x4_t up = vdupq_n_s32((int32_t)shift);
+        const int32x4_t down = vdupq_n_s32(-(int32_t)shift);
+        int32x4_t vlo = vdupq_n_s32(lo), vhi = vdupq_n_s32(hi);
+        int32x2_t p;
+        if (sum) {
+            int64x2_t vs = vdupq_n_s64(0);
+            for(; i + 4 <= len; i += 4) {
+                const int32x4_t v = vshlq_s32(vshlq_s32(vld1q_s32(in + i), up), down);
+                vlo = vminq_s32(vlo, v);
+                vhi = vmaxq_s32(vhi, v);
+                vs = vpadalq_s32(vs, v);
+            }
+            s = vgetq_lane_s64(vs, 0) + vgetq_lane_s64(vs, 1);
+        } else {
+            for(; i + 4 <= len; i += 4) {
+                const int32x4_t v = vshlq_s32(vshlq_s32(vld1q_s32(in + i), up), down);
+                vlo = vminq_s32(vlo, v);
+                vhi = vmaxq_s32(vhi, v);
+            }
+        }
+        p = vpmin_s32(vget_low_s32(vlo), vget_high_s32(vlo));
+        lo = vget_lane_s32(vpmin_s32(p, p), 0);
+        p = vpmax_s32(vget_low_s32(vhi), vget_high_s32(vhi));
+        hi = vget_lane_s32(vpmax_s32(p, p), 0);
+    }
+#endif
+    if (sum) {
+        for(; i < len; i++) {
+            const int32_t v = (int32_t)((uint32_t)in[i] << shift) >> shift;
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+            s += v;
+        }
+        *sum += s;
+    } else {
+        for(; i < len; i++) {
+            const int32_t v = (int32_t)((uint32_t)in[i] << shift) >> shift;
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+        }
+    }
+    *mn = lo;
+    *mx = hi;
+}
+
+int rp_dsp_envelope(const int32_t *buf, uint32_t buf_len, uint32_t start, uint32_t step, uint32_t bits,
+                    int32_t *min, int32_t *max, float *mean, uint32_t columns) {
+    uint32_t col, pos;
+    const uint32_t shift = 32 - bits;
+
+    if (!buf || !min || !max || buf_len == 0 || step == 0 || step > buf_len || bits == 0 || bits > 32) {
+        return -1;
+    }
+
+    pos = start % buf_len;
+    for(col = 0; col < columns; col++) {
+        int32_t lo = INT32_MAX, hi = INT32_MIN;
+        int64_t sum = 0;
+        // At most one wrap per column, so a column is one or two runs
+        const uint32_t first = buf_len - pos < step ? buf_len - pos : step;
+        envelopeRun(buf + pos, first, shift, &lo, &hi, mean ? &sum : NULL);
+        envelopeRun(buf, step - first, shift, &lo, &hi, mean ? &sum : NULL);
+        min[col] = lo;
+        max[col] = hi;
+        if (mean) {
+            mean[col] = (float)sum / step;
+        }
+        pos = (pos + step) % buf_len;
+    }
+    return 0;
+}
+
+static inline void envelopeRunF(const float *in, uint32_t len, float *mn, float *mx, float *sum) {
+    uint32_t i = 0;
+    float lo = *mn, hi = *mx, s = 0;
+#ifdef RP_DSP_NEON
+    if (len >= 4) {
+        float32x4_t vlo = vdupq_n_f32(lo), vhi = vdupq_n_f32(hi);
+        float32x2_t p;
+        if (sum) {
+            float32x4_t vs = vdupq_n_f32(0);
+            for(; i + 4 <= len; i += 4) {
+                const float32x4_t v = vld1q_f32(in + i);
+                vlo = vminq_f32(vlo, v);
+                vhi = vmaxq_f32(vhi, v);
+                vs = vaddq_f32(vs, v);
+            }
+            p = vadd_f32(vget_low_f32(vs), vget_high_f32(vs));
+            s = vget_lane_f32(vpadd_f32(p, p), 0);
+        } else {
+            for(; i + 4 <= len; i += 4) {
+                const float32x4_t v = vld1q_f32(in + i);
+                vlo = vminq_f32(vlo, v);
+                vhi = vmaxq_f32(vhi, v);
+            }
+        }
+        p = vmin_f32(vget_low_f32(vlo), vget_high_f32(vlo));
+        lo = vget_lane_f32(vpmin_f32(p, p), 0);
+        p = vmax_f32(vget_low_f32(vhi), vget_high_f32(vhi));
+        hi = vget_lane_f32(vpmax_f32(p, p), 0);
+    }
+#endif
+    if (sum) {
+        for(; i < len; i++) {
+            const float v = in[i];
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+            s += v;
+        }
+        *sum += s;
+    } else {
+        for(; i < len; i++) {
+            const float v = in[i];
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+        }
+    }
+    *mn = lo;
+    *mx = hi;
+}
+
+int rp_dsp_envelope_f(const float *buf, uint32_t buf_len, uint32_t start, uint32_t step,
+                      float *min, float *max, float *mean, uint32_t columns) {
+    uint32_t col, pos;
+
+    if (!buf || !min || !max || buf_len == 0 || step == 0 || step > buf_len) {
+        return -1;
+    }
+
+    pos = start % buf_len;
+    for(col = 0; col < columns; col++) {
+        float lo = INFINITY, hi = -INFINITY, sum = 0;
+        const uint32_t first = buf_len - pos < step ? buf_len - pos : step;
+        envelopeRunF(buf + pos, first, &lo, &hi, mean ? &sum : NULL);
+        envelopeRunF(buf, step - first, &lo, &hi, mean ? &sum : NULL);
+        min[col] = lo;
+        max[col] = hi;
+        if (mean) {
+            mean[col] = sum / step;
+        }
+        pos = (pos + step) % buf_len;
+    }
+    return 0;
+}
+
+/* Length of the precomputed reference table, the record is processed in blocks
+ * of this size and each block sum is rotated to the block start phase */
+#define RP_DSP_NCO_BLOCK 256
+
+typedef struct {
+    double sc;      // sum x[n] * cos(w*n)
+    double ss;      // sum x[n] * sin(w*n)
+    double sum;
+    float  min;
+    float  max;
+} lockinAcc_t;
+
+/* Sums of x*cos, x*sin and x over one block against the unrotated table */
+static inline void lockinBlock(const float *x, const float *bc, const float *bs, uint32_t len,
+                               float *sc, float *ss, float *sum, float *mn, float *mx) {
+    uint32_t i = 0;
+    float c = 0, s = 0, t = 0, lo = *mn, hi = *mx;
+#ifdef RP_DSP_NEON
+    float32x4_t vc = vdupq_n_f32(0), vs = vdupq_n_f32(0), vt = vdupq_n_f32(0);
+    float32x4_t vlo = vdupq_n_f32(lo), vhi = vdupq_n_f32(hi);
+    for(; i + 4 <= len; i += 4) {
+        const float32x4_t v = vld1q_f32(x + i);
+        vc = vmlaq_f32(vc, v, vld1q_f32(bc + i));
+        vs = vmlaq_f32(vs, v, vld1q_f32(bs + i));
+        vt = vaddq_f32(vt, v);
+        vlo = vminq_f32(vlo, v);
+        vhi = vmaxq_f32(vhi, v);
+    }
+    float32x2_t p;
+    p = vadd_f32(vget_low_f32(vc), vget_high_f32(vc));
+    c = vget_lane_f32(vpadd_f32(p, p), 0);
+    p = vadd_f32(vget_low_f32(vs), vget_high_f32(vs));
+    s = vget_lane_f32(vpadd_f32(p, p), 0);
+    p = vadd_f32(vget_low_f32(vt), vget_high_f32(vt));
+    t = vget_lane_f32(vpadd_f32(p, p), 0);
+    p = vmin_f32(vget_low_f32(vlo), vget_high_f32(vlo));
+    lo = vget_lane_f32(vpmin_f32(p, p), 0);
+    p = vmax_f32(vget_low_f32(vhi), vget_high_f32(vhi));
+    hi = vget_lane_f32(vpmax_f32(p, p), 0);
+#else
+    // Four independent partial sums keep the FPU pipeline busy
+    float c4[4] = {0, 0, 0, 0}, s4[4] = {0, 0, 0, 0}, t4[4] = {0, 0, 0, 0};
+    for(; i + 4 <= len; i += 4) {
+        uint32_t k;
+        for(k = 0; k < 4; k++) {
+            const float v = x[i + k];
+            c4[k] += v * bc[i + k];
+            s4[k] += v * bs[i + k];
+            t4[k] += v;
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+        }
+    }
+    c = (c4[0] + c4[1]) + (c4[2] + c4[3]);
+    s = (s4[0] + s4[1]) + (s4[2] + s4[3]);
+    t = (t4[0] + t4[1]) + (t4[2] + t4[3]);
+#endif
+    for(; i < len; i++) {
+        const float v = x[i];
+        c += v * bc[i];
+        s += v * bs[i];
+        t += v;
+        lo = v < lo ? v : lo;
+        hi = v > hi ? v : hi;
+    }
+    *sc = c;
+    *ss = s;
+    *sum = t;
+    *mn = lo;
+    *mx = hi;
+}
+
+static void lockinResult(const lockinAcc_t *acc, double ref_c, double ref_s, uint32_t len,
+                         rp_dsp_lockin_t *out) {
+    const double mean = acc->sum / len;
+    out->mean = mean;
+    out->re = 2.0 * (acc->sc - mean * ref_c) / len;
+    out->im = -2.0 * (acc->ss - mean * ref_s) / len;
+    out->amp = sqrt(out->re * out->re + out->im * out->im);
+    out->phase = atan2(out->im, out->re);
+    out->min = acc->min;
+    out->max = acc->max;
+}
+
+/* conv converts one block of the input to float, NULL when the input is float already */
+typedef const float *(*lockinConv_t)(const void *in, uint32_t offset, uint32_t len, float *tmp);
+
+static const float *lockinConvI16(const void *in, uint32_t offset, uint32_t len, float *tmp) {
+    const int16_t *x = (const int16_t *)in + offset;
+    uint32_t i = 0;
+#ifdef RP_DSP_NEON
+    for(; i + 8 <= len; i += 8) {
+        const int16x8_t v = vld1q_s16(x + i);
+        vst1q_f32(tmp + i, vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))));
+        vst1q_f32(tmp + i + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))));
+    }
+#endif
+    for(; i < len; i++) {
+        tmp[i] = x[i];
+    }
+    return tmp;
+}
+
+static int lockin(const void *ch1, const void *ch2, lockinConv_t conv, uint32_t len, double cycles,
+                  rp_dsp_lockin_t *out1, rp_dsp_lockin_t *out2) {
+    float bc[RP_DSP_NCO_BLOCK], bs[RP_DSP_NCO_BLOCK], tmp[RP_DSP_NCO_BLOCK];
+    const void *in[2] = {ch1, ch2};
+    rp_dsp_lockin_t *out[2] = {out1, out2};
+    lockinAcc_t acc[2];
+    uint32_t i, ch, n0;
+    const uint32_t chs = ch2 && out2 ? 2 : 1;
+
+    if (!ch1 || !out1 || len == 0) {
+        return -1;
+    }
+
+    // Reference table for one block, phase accumulated in double precision
+    const double w = 2 * M_PI * cycles / (double)len;
+    const double dr = cos(w), di = sin(w);
+    double cr = 1, ci = 0, tab_c = 0, tab_s = 0;
+    for(i = 0; i < RP_DSP_NCO_BLOCK; i++) {
+        bc[i] = (float)cr;
+        bs[i] = (float)ci;
+        const double t = cr * dr - ci * di;
+        ci = cr * di + ci * dr;
+        cr = t;
+    }
+    const double block_c = cr, block_s = ci;
+    for(i = 0; i < RP_DSP_NCO_BLOCK; i++) {
+        tab_c += bc[i];
+        tab_s += bs[i];
+    }
+
+    for(ch = 0; ch < chs; ch++) {
+        acc[ch].sc = acc[ch].ss = acc[ch].sum = 0;
+        acc[ch].min = INFINITY;
+        acc[ch].max = -INFINITY;
+    }
+
+    // Start phase of the current block and sums of the rotated reference itself
+    double ph_c = 1, ph_s = 0, ref_c = 0, ref_s = 0;
+    for(n0 = 0; n0 < len; n0 += RP_DSP_NCO_BLOCK) {
+        const uint32_t blen = len - n0 < RP_DSP_NCO_BLOCK ? len - n0 : RP_DSP_NCO_BLOCK;
+        double rc = tab_c, rs = tab_s;
+        if (blen != RP_DSP_NCO_BLOCK) {
+            rc = rs = 0;
+            for(i = 0; i < blen; i++) {
+                rc += bc[i];
+                rs += bs[i];
+            }
+        }
+        // cos(a + b) = cos a cos b - sin a sin b, sin(a + b) = sin a cos b + cos a sin b
+        ref_c += ph_c * rc - ph_s * rs;
+        ref_s += ph_s * rc + ph_c * rs;
+
+        for(ch = 0; ch < chs; ch++) {
+            float sc, ss, sum;
+            const float *x = conv ? conv(in[ch], n0, blen, tmp) : (const float *)in[ch] + n0;
+            lockinBlock(x, bc, bs, blen, &sc, &ss, &sum, &acc[ch].min, &acc[ch].max);
+            acc[ch].sc += ph_c * sc - ph_s * ss;
+            acc[ch].ss += ph_s * sc + ph_c * ss;
+            acc[ch].sum += sum;
+        }
+
+        const double t = ph_c * block_c - ph_s * block_s;
+        ph_s = ph_s * block_c + ph_c * block_s;
+        ph_c = t;
+    }
+
+    for(ch = 0; ch < chs; ch++) {
+        lockinResult(&acc[ch], ref_c, ref_s, len, out[ch]);
+    }
+    return 0;
+}
+
+int rp_dsp_lockin(const float *ch1, const float *ch2, uint32_t len, double cycles,
+                  rp_dsp_lockin_t *out1, rp_dsp_lockin_t *out2) {
+    return lockin(ch1, ch2, NULL, len, cycles, out1, out2);
+}
+
+int rp_dsp_lockin_i16(const int16_t *ch1, const int16_t *ch2, uint32_t len, double cycles,
+                      rp_dsp_lockin_t *out1, rp_dsp_lockin_t *out2) {
+    return lockin(ch1, ch2, lockinConvI16, len, cycles, out1, out2);
+}
@@ -0,0 +1,129 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya DSP kernels shared by the DSP library and the applications.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __RP_DSP_KERNELS_H__
+#define __RP_DSP_KERNELS_H__
+
+#include <stdint.h>
+
+#include "kiss_fft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Window types, values match rp_dsp_api::CDSP::window_mode_t */
+typedef enum {
+    RP_DSP_WIN_RECTANGULAR     = 0,
+    RP_DSP_WIN_HANNING         = 1,
+    RP_DSP_WIN_HAMMING         = 2,
+    RP_DSP_WIN_BLACKMAN_HARRIS = 3,
+    RP_DSP_WIN_FLAT_TOP        = 4,
+    RP_DSP_WIN_KAISER_4        = 5,
+    RP_DSP_WIN_KAISER_8        = 6
+} rp_dsp_window_t;
+
+typedef struct {
+    double min;
+    double max;
+    double mean;
+    double rms;
+    double std;
+} rp_dsp_stats_t;
+
+/* One channel demodulated against the reference tone, see rp_dsp_lockin() */
+typedef struct {
+    double re;      // 2/len * sum (x[n] - mean) * cos(w*n)
+    double im;      // -2/len * sum (x[n] - mean) * sin(w*n)
+    double amp;     // sqrt(re^2 + im^2)
+    double phase;   // atan2(im, re)
+    double mean;
+    float  min;
+    float  max;
+} rp_dsp_lockin_t;
+
+/* Real FFT of a fixed length, owns its plan and output buffer */
+typedef struct rp_dsp_fftr_s rp_dsp_fftr_t;
+
+rp_dsp_fftr_t *rp_dsp_fftr_alloc(uint32_t len);
+void rp_dsp_fftr_free(rp_dsp_fftr_t *fft);
+uint32_t rp_dsp_fftr_len(const rp_dsp_fftr_t *fft);
+
+/* Returns len/2+1 complex bins, valid until the next call on the same handle */
+const kiss_fft_cpx *rp_dsp_fftr(rp_dsp_fftr_t *fft, const double *in);
+
+/* FFT followed by |X| of the first bins outputs (bins <= len/2+1) */
+int rp_dsp_fftr_mag(rp_dsp_fftr_t *fft, const double *in, double *mag, uint32_t bins);
+
+/* Fills the window coefficients, returns their sum in sum (may be NULL) */
+int rp_dsp_window(rp_dsp_window_t mode, double *window, uint32_t len, double *sum);
+
+/* Hann window scaled by amp: amp * (1 - cos(2*pi*i/(len-1))) */
+int rp_dsp_hann(double amp, double *window, uint32_t len);
+
+void rp_dsp_apply_window(const double *in, const double *window, double *out, uint32_t len);
+void rp_dsp_apply_window_f(const float *in, const float *window, float *out, uint32_t len);
+/* |X| of every bin, NEON takes the square root in single precision */
+void rp_dsp_magnitude(const kiss_fft_cpx *in, double *out, uint32_t len);
+
+/* out[i] = mul * log10(in[i] * scale) where in[i] * scale > min, below elsewhere.
+ * NEON uses a polynomial log10, within 1e-4 dB of log10f(). */
+void rp_dsp_to_db(const float *in, float *out, uint32_t len, float scale, float mul, float min, float below);
+
+/* Index of the first maximum */
+uint32_t rp_dsp_max_index(const double *in, uint32_t len);
+uint32_t rp_dsp_max_index_f(const float *in, uint32_t len);
+
+/* Sums in[k]^2 * scale over round(in_len/out_len) consecutive bins per output */
+int rp_dsp_decimate_power(const double *in, uint32_t in_len, float *out, uint32_t out_len, double scale);
+int rp_dsp_decimate_power_f(const float *in, uint32_t in_len, float *out, uint32_t out_len, float scale);
+
+/* DFT of one frequency, cycles per record may be fractional: X = sum in[n] * exp(-j*2*pi*cycles*n/len) */
+void rp_dsp_goertzel(const double *in, uint32_t len, double cycles, double *re, double *im);
+
+/* Amplitude and phase of one tone: 2*|X|/len and arg(X) */
+void rp_dsp_iq_demod(const double *in, uint32_t len, double cycles, double *amp, double *phase);
+
+void rp_dsp_stats(const double *in, uint32_t len, rp_dsp_stats_t *stats);
+
+/* Same for float samples, sums are kept in double across blocks of single precision partial sums */
+void rp_dsp_stats_f(const float *in, uint32_t len, rp_dsp_stats_t *stats);
+
+/* Min/max envelope of raw ADC words in a circular buffer of buf_len samples.
+ * Column i covers step samples from start + i*step, words are sign extended from
+ * bits. Extremes are returned in counts so the caller converts only 2*columns
+ * values to volts. mean may be NULL, the sum is then skipped. */
+int rp_dsp_envelope(const int32_t *buf, uint32_t buf_len, uint32_t start, uint32_t step, uint32_t bits,
+                    int32_t *min, int32_t *max, float *mean, uint32_t columns);
+
+/* Same for samples already in volts, mean may be NULL */
+int rp_dsp_envelope_f(const float *buf, uint32_t buf_len, uint32_t start, uint32_t step,
+                      float *min, float *max, float *mean, uint32_t columns);
+
+/* Lock-in demodulation of one or two channels in a single pass, the reference
+ * makes cycles periods over len samples. The reference comes from a phase
+ * accumulated NCO table shared by both channels, no sin()/cos() per sample.
+ * The mean is removed analytically, so a DC offset does not leak into the
+ * result even when the record is not made of whole periods.
+ * ch2/out2 may be NULL. */
+int rp_dsp_lockin(const float *ch1, const float *ch2, uint32_t len, double cycles,
+                  rp_dsp_lockin_t *out1, rp_dsp_lockin_t *out2);
+
+/* Same for raw ADC samples, results are in counts */
+int rp_dsp_lockin_i16(const int16_t *ch1, const int16_t *ch2, uint32_t len, double cycles,
+                      rp_dsp_lockin_t *out1, rp_dsp_lockin_t *out2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,373 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya streaming power spectral density (Welch) and STFT.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C++ programming language.
+ */
+
+#include <new>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#include "rp_psd.h"
+#include "kiss_fftr.h"
+
+/* Const - [W] -> [mW] */
+constexpr double g_w2mw = 1000;
+/* Lowest reported power density, keeps log10 finite */
+constexpr double g_psd_floor = 1e-30;
+
+using namespace rp_dsp_api;
+
+struct CPSD::Impl {
+    uint8_t  m_max_channels;
+    uint32_t m_max_segment;
+    double   m_rate = 125e6;
+    uint32_t m_segment = 1024;
+    double   m_overlap = 0.5;
+    uint32_t m_hop = 512;
+    CDSP::window_mode_t m_window_mode = CDSP::HANNING;
+    average_t m_average = LINEAR;
+    uint32_t m_avg_segments = 8;
+    double   m_imp = 50;
+    stft_callback_t m_callback;
+
+    kiss_fftr_cfg m_plan = NULL;
+    double   m_scale = 0;                        // |X|^2 -> V^2/Hz for the current window
+    double   m_enbw = 1;                         // Equivalent noise bandwidth in bins
+    std::vector<double> m_window;
+    std::vector<kiss_fft_scalar> m_fft_in;
+    std::vector<kiss_fft_cpx> m_fft_out;
+    std::vector<std::vector<double>> m_staging;  // Segment being collected, per channel
+    uint32_t m_fill = 0;
+    std::vector<std::vector<float>>  m_row;      // Last STFT row
+    std::vector<const float*>        m_row_ptr;
+    std::vector<std::vector<double>> m_acc;      // Running average
+    uint32_t m_acc_count = 0;
+    uint64_t m_total = 0;
+
+    std::mutex m_resultMutex;
+    std::vector<std::vector<float>> m_result;    // Last published PSD
+    uint32_t m_result_count = 0;
+
+    auto bins() -> uint32_t { return m_segment / 2 + 1; }
+    auto processSegment() -> void;
+    auto publish() -> void;
+
+    template<typename T>
+    auto push(const T * const *data, uint32_t count, float scale) -> int;
+};
+
+auto CPSD::Impl::publish() -> void {
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    double k = (m_average == LINEAR && m_acc_count) ? 1.0 / m_acc_count : 1.0;
+    for(uint8_t ch = 0; ch < m_max_channels; ch++){
+        for(uint32_t i = 0; i < bins(); i++){
+            m_result[ch][i] = m_acc[ch][i] * k;
+        }
+    }
+    m_result_count = m_average == LINEAR ? m_acc_count : (m_average == NONE ? 1 : std::min<uint64_t>(m_total, m_avg_segments));
+}
+
+auto CPSD::Impl::processSegment() -> void {
+    const uint32_t n = bins();
+    const double alpha = 1.0 / m_avg_segments;
+    const bool first = m_acc_count == 0;
+
+    for(uint8_t ch = 0; ch < m_max_channels; ch++){
+        const double *src = m_staging[ch].data();
+        for(uint32_t i = 0; i < m_segment; i++){
+            m_fft_in[i] = src[i] * m_window[i];
+        }
+        kiss_fftr(m_plan, m_fft_in.data(), m_fft_out.data());
+
+        float  *row = m_row[ch].data();
+        double *acc = m_acc[ch].data();
+        for(uint32_t i = 0; i < n; i++){
+            // One-sided density, DC and Nyquist bins are not mirrored
+            double p = (m_fft_out[i].r * m_fft_out[i].r + m_fft_out[i].i * m_fft_out[i].i) * m_scale;
+            if (i != 0 && i != n - 1) p *= 2;
+            row[i] = p;
+            switch(m_average){
+                case NONE:        acc[i] = p; break;
+                case LINEAR:      acc[i] = first ? p : acc[i] + p; break;
+                case EXPONENTIAL: acc[i] = first ? p : acc[i] + alpha * (p - acc[i]); break;
+                case PEAK_HOLD:   acc[i] = first ? p : std::max(acc[i], p); break;
+            }
+        }
+    }
+
+    m_total++;
+    if (m_average == LINEAR) {
+        m_acc_count++;
+        if (m_acc_count >= m_avg_segments) {
+            publish();
+            m_acc_count = 0;
+        }
+    } else {
+        m_acc_count = 1;
+        publish();
+    }
+
+    if (m_callback) {
+        m_callback(m_row_ptr.data(), n, m_total);
+    }
+}
+
+template<typename T>
+auto CPSD::Impl::push(const T * const *data, uint32_t count, float scale) -> int {
+    if (!m_plan || !data) {
+        return -1;
+    }
+
+    uint32_t pos = 0;
+    while(pos < count){
+        uint32_t n = std::min(count - pos, m_segment - m_fill);
+        for(uint8_t ch = 0; ch < m_max_channels; ch++){
+            double *dst = m_staging[ch].data() + m_fill;
+            if (!data[ch]) {
+                memset(dst, 0, n * sizeof(double));
+                continue;
+            }
+            const T *src = data[ch] + pos;
+            for(uint32_t i = 0; i < n; i++){
+                dst[i] = src[i] * scale;
+            }
+        }
+        m_fill += n;
+        pos += n;
+
+        if (m_fill == m_segment) {
+            processSegment();
+            // Keep the overlapping tail as the head of the next segment
+            uint32_t keep = m_segment - m_hop;
+            for(uint8_t ch = 0; ch < m_max_channels; ch++){
+                memmove(m_staging[ch].data(), m_staging[ch].data() + m_hop, keep * sizeof(double));
+            }
+            m_fill = keep;
+        }
+    }
+    return 0;
+}
+
+
+CPSD::CPSD(uint8_t max_channels,uint32_t max_segment_length) {
+    m_pimpl = new Impl();
+    m_pimpl->m_max_channels = max_channels;
+    m_pimpl->m_max_segment = max_segment_length;
+    m_pimpl->m_segment = std::min<uint32_t>(m_pimpl->m_segment, max_segment_length);
+}
+
+CPSD::~CPSD(){
+    if (m_pimpl->m_plan) {
+        kiss_fftr_free(m_pimpl->m_plan);
+    }
+    delete m_pimpl;
+}
+
+auto CPSD::setSampleRate(double rate) -> void {
+    m_pimpl->m_rate = rate;
+}
+
+auto CPSD::getSampleRate() -> double {
+    return m_pimpl->m_rate;
+}
+
+auto CPSD::setSegmentLength(uint32_t len) -> int {
+    // kiss_fftr works on even lengths only
+    if (len < 4 || len > m_pimpl->m_max_segment || (len & 1)) {
+        return -1;
+    }
+    if (len == m_pimpl->m_segment) {
+        return 0;
+    }
+    const uint32_t old = m_pimpl->m_segment;
+    m_pimpl->m_segment = len;
+    // The buffers sized by init() have to follow, push() would write past the staging buffer
+    if (m_pimpl->m_plan && init()) {
+        m_pimpl->m_segment = old;
+        init();
+        return -1;
+    }
+    return 0;
+}
+
+auto CPSD::getSegmentLength() -> uint32_t {
+    return m_pimpl->m_segment;
+}
+
+auto CPSD::setOverlap(double overlap) -> int {
+    if (overlap < 0 || overlap >= 1) {
+        return -1;
+    }
+    m_pimpl->m_overlap = overlap;
+    return 0;
+}
+
+auto CPSD::getOverlap() -> double {
+    return m_pimpl->m_overlap;
+}
+
+auto CPSD::setWindow(CDSP::window_mode_t mode) -> int {
+    if (mode < CDSP::RECTANGULAR || mode > CDSP::KAISER_8) {
+        return -1;
+    }
+    m_pimpl->m_window_mode = mode;
+    return 0;
+}
+
+auto CPSD::getWindow() -> CDSP::window_mode_t {
+    return m_pimpl->m_window_mode;
+}
+
+auto CPSD::setAveraging(average_t mode, uint32_t segments) -> int {
+    if (mode < NONE || mode > PEAK_HOLD || segments == 0) {
+        return -1;
+    }
+    m_pimpl->m_average = mode;
+    m_pimpl->m_avg_segments = segments;
+    return 0;
+}
+
+auto CPSD::getAveraging() -> average_t {
+    return m_pimpl->m_average;
+}
+
+auto CPSD::setImpedance(double value) -> void {
+    m_pimpl->m_imp = value;
+}
+
+auto CPSD::getImpedance() -> double {
+    return m_pimpl->m_imp;
+}
+
+auto CPSD::setSTFTCallback(stft_callback_t callback) -> void {
+    m_pimpl->m_callback = callback;
+}
+
+auto CPSD::init() -> int {
+    auto p = m_pimpl;
+    const uint32_t len = p->m_segment;
+
+    if (p->m_plan) {
+        kiss_fftr_free(p->m_plan);
+        p->m_plan = NULL;
+    }
+
+    try{
+        p->m_window.resize(len);
+        p->m_fft_in.resize(len);
+        p->m_fft_out.resize(p->bins());
+        p->m_staging.assign(p->m_max_channels, std::vector<double>(len));
+        p->m_row.assign(p->m_max_channels, std::vector<float>(p->bins()));
+        p->m_acc.assign(p->m_max_channels, std::vector<double>(p->bins()));
+        p->m_result.assign(p->m_max_channels, std::vector<float>(p->bins()));
+    } catch (const std::bad_alloc& e) {
+        fprintf(stderr, "CPSD::init() can not allocate mem\n");
+        return -1;
+    }
+    p->m_row_ptr.clear();
+    for(auto &row : p->m_row){
+        p->m_row_ptr.push_back(row.data());
+    }
+
+    double sum = 0;
+    if (CDSP::makeWindow(p->m_window_mode, p->m_window.data(), len, &sum)) {
+        return -1;
+    }
+    double sum2 = 0;
+    for(uint32_t i = 0; i < len; i++){
+        sum2 += p->m_window[i] * p->m_window[i];
+    }
+    p->m_scale = 1.0 / (p->m_rate * sum2);
+    p->m_enbw = len * sum2 / (sum * sum);
+
+    p->m_hop = len - (uint32_t)round(len * p->m_overlap);
+    if (p->m_hop == 0) {
+        p->m_hop = 1;
+    }
+
+    p->m_plan = kiss_fftr_alloc(len, 0, NULL, NULL);
+    if (!p->m_plan) {
+        return -1;
+    }
+    reset();
+    return 0;
+}
+
+auto CPSD::reset() -> void {
+    auto p = m_pimpl;
+    p->m_fill = 0;
+    p->m_acc_count = 0;
+    p->m_total = 0;
+    std::lock_guard<std::mutex> lock(p->m_resultMutex);
+    for(auto &r : p->m_result){
+        std::fill(r.begin(), r.end(), 0);
+    }
+    p->m_result_count = 0;
+}
+
+auto CPSD::discardPending() -> void {
+    m_pimpl->m_fill = 0;
+}
+
+auto CPSD::push(const float * const *data, uint32_t count) -> int {
+    return m_pimpl->push(data, count, 1.0f);
+}
+
+auto CPSD::push(const double * const *data, uint32_t count) -> int {
+    return m_pimpl->push(data, count, 1.0f);
+}
+
+auto CPSD::push(const int16_t * const *data, uint32_t count, float scale) -> int {
+    return m_pimpl->push(data, count, scale);
+}
+
+auto CPSD::getBins() -> uint32_t {
+    return m_pimpl->bins();
+}
+
+auto CPSD::getBinWidth() -> double {
+    return m_pimpl->m_rate / m_pimpl->m_segment;
+}
+
+auto CPSD::getResolutionBandwidth() -> double {
+    return m_pimpl->m_enbw * getBinWidth();
+}
+
+auto CPSD::getSegmentsAveraged() -> uint32_t {
+    std::lock_guard<std::mutex> lock(m_pimpl->m_resultMutex);
+    return m_pimpl->m_result_count;
+}
+
+auto CPSD::getSegmentsTotal() -> uint64_t {
+    return m_pimpl->m_total;
+}
+
+auto CPSD::getPSD(uint8_t ch, float *out, uint32_t len) -> int {
+    auto p = m_pimpl;
+    if (ch >= p->m_max_channels || !out || len < p->bins() || p->m_result.empty()) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(p->m_resultMutex);
+    memcpy(out, p->m_result[ch].data(), p->bins() * sizeof(float));
+    return 0;
+}
+
+auto CPSD::getPSDdBm(uint8_t ch, float *out, uint32_t len) -> int {
+    if (getPSD(ch, out, len)) {
+        return -1;
+    }
+    const double k = g_w2mw / m_pimpl->m_imp;
+    for(uint32_t i = 0; i < m_pimpl->bins(); i++){
+        out[i] = 10 * log10(std::max<double>(out[i] * k, g_psd_floor));
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya streaming power spectral density (Welch) and STFT.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C++ programming language.
+ */
+
+#ifndef __RP_PSD_H__
+#define __RP_PSD_H__
+
+#include <stdint.h>
+#include <functional>
+
+#include "rp_dsp.h"
+
+namespace rp_dsp_api{
+
+/*
+ * Samples are pushed in arbitrary sized chunks, e.g. from the streaming
+ * buffers, and cut into overlapping windowed segments. Every segment
+ * produces one STFT row and is folded into the averaged PSD.
+ */
+class CPSD{
+
+public:
+
+    typedef enum{
+        NONE            = 0,    // Last segment only
+        LINEAR          = 1,    // Welch mean over the configured segment count
+        EXPONENTIAL     = 2,    // Running average with alpha = 1 / segments
+        PEAK_HOLD       = 3     // Maximum per bin
+    } average_t;
+
+    // Called for each processed segment with one-sided PSD rows [V^2/Hz], one per channel
+    typedef std::function<void(const float * const *psd, uint32_t bins, uint64_t segment)> stft_callback_t;
+
+    CPSD(uint8_t max_channels,uint32_t max_segment_length);
+    ~CPSD();
+
+    auto setSampleRate(double rate) -> void;
+    auto getSampleRate() -> double;
+    auto setSegmentLength(uint32_t len) -> int;
+    auto getSegmentLength() -> uint32_t;
+    auto setOverlap(double overlap) -> int;
+    auto getOverlap() -> double;
+    auto setWindow(CDSP::window_mode_t mode) -> int;
+    auto getWindow() -> CDSP::window_mode_t;
+    auto setAveraging(average_t mode, uint32_t segments) -> int;
+    auto getAveraging() -> average_t;
+    auto setImpedance(double value) -> void;
+    auto getImpedance() -> double;
+    auto setSTFTCallback(stft_callback_t callback) -> void;
+
+    // Applies the configuration, must be called after any setter above.
+    // setSegmentLength() after init() re-initializes by itself, dropping buffered samples and averages.
+    auto init() -> int;
+    // Drops buffered samples and accumulated averages
+    auto reset() -> void;
+    // Drops only the partially collected segment, used between non-contiguous blocks
+    auto discardPending() -> void;
+
+    // data holds one pointer per channel, count samples each
+    auto push(const float * const *data, uint32_t count) -> int;
+    auto push(const double * const *data, uint32_t count) -> int;
+    auto push(const int16_t * const *data, uint32_t count, float scale) -> int;
+
+    auto getBins() -> uint32_t;
+    auto getBinWidth() -> double;
+    // Equivalent noise bandwidth of the window times the bin width [Hz]
+    auto getResolutionBandwidth() -> double;
+    auto getSegmentsAveraged() -> uint32_t;
+    auto getSegmentsTotal() -> uint64_t;
+
+    // Copies the averaged PSD of a channel, len must be at least getBins()
+    auto getPSD(uint8_t ch, float *out, uint32_t len) -> int;
+    auto getPSDdBm(uint8_t ch, float *out, uint32_t len) -> int;
+
+private:
+
+    CPSD(const CPSD &) = delete;
+    CPSD(CPSD &&) = delete;
+    CPSD& operator=(const CPSD&) =delete;
+    CPSD& operator=(const CPSD&&) =delete;
+
+    struct Impl;
+    // Pointer to the internal implementation
+    Impl *m_pimpl;
+};
+
+}
+
+#endif
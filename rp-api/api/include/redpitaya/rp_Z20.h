@@ -313,6 +313,8 @@ typedef struct {
 
 /**
  * Initializes the library. It must be called first, before any other library method.
+ * If the RP_SIMULATION environment variable is set, the FPGA is simulated in process memory
+ * and the library can be used without a board (e.g. on a PC for profiling).
  * @return If the function is successful, the return value is RP_OK.
  * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
  */
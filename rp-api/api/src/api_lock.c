@@ -0,0 +1,167 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library subsystem locking implementation
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <grp.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rp_cross.h"
+#include "api_lock.h"
+
+/**
+ * Threads of a process are serialized with a process-local rwlock.
+ * Processes are serialized with POSIX record locks on one byte per subsystem
+ * of a shared lock file. Record locks are released by the kernel when
+ * a process dies, so a killed client never leaves the board locked.
+ *
+ * Record locks belong to the process, not to the thread, so the file lock
+ * is taken by the first reader and released by the last one.
+ */
+
+#define LOCK_FILE "/dev/shm/rp_api.lock"
+#define LOCK_FILE_MODE 0660
+#define LOCK_GROUP "rp"
+#define STATE_FILE "/dev/shm/rp_api_%s.state"
+
+static const char *state_names[LOCK_COUNT] = { "calib", "acq", "gen", "hk" };
+
+typedef struct lock_state_s {
+    pthread_rwlock_t rwlock;
+    pthread_mutex_t  readers_mutex;
+    int              readers;
+} lock_state_t;
+
+#define LOCK_STATE_INIT { PTHREAD_RWLOCK_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, 0 }
+
+static lock_state_t locks[LOCK_COUNT] = {
+    LOCK_STATE_INIT, // LOCK_CALIB
+    LOCK_STATE_INIT, // LOCK_ACQ
+    LOCK_STATE_INIT, // LOCK_GEN
+    LOCK_STATE_INIT  // LOCK_HK
+};
+
+static int lock_fd = -1;
+
+static void fileLock(lock_subsys_t subsys, short type) {
+    if (lock_fd == -1)
+        return;
+
+    struct flock fl = {
+        .l_type = type,
+        .l_whence = SEEK_SET,
+        .l_start = subsys,
+        .l_len = 1
+    };
+    while (fcntl(lock_fd, type == F_UNLCK ? F_SETLK : F_SETLKW, &fl) == -1 && errno == EINTR) {}
+}
+
+// Only the library group may use the lock and state files
+static void restrictAccess(int fd) {
+    struct group *gr = getgrnam(LOCK_GROUP);
+    if (gr != NULL && fchown(fd, -1, gr->gr_gid) != 0) {
+        // File created by another user keeps its group
+    }
+    fchmod(fd, LOCK_FILE_MODE);
+}
+
+int lock_Init() {
+    if (lock_fd != -1)
+        return RP_OK;
+
+    lock_fd = open(LOCK_FILE, O_RDWR | O_CREAT | O_CLOEXEC, LOCK_FILE_MODE);
+    if (lock_fd == -1) {
+        // Without the lock file only threads of this process are serialized
+        return RP_OK;
+    }
+    // Other users could hold the board forever
+    restrictAccess(lock_fd);
+    return RP_OK;
+}
+
+int lock_Release() {
+    if (lock_fd != -1) {
+        close(lock_fd);
+        lock_fd = -1;
+    }
+    return RP_OK;
+}
+
+void lock_Read(lock_subsys_t subsys) {
+    lock_state_t *l = &locks[subsys];
+    pthread_rwlock_rdlock(&l->rwlock);
+    pthread_mutex_lock(&l->readers_mutex);
+    if (l->readers++ == 0) {
+        fileLock(subsys, F_RDLCK);
+    }
+    pthread_mutex_unlock(&l->readers_mutex);
+}
+
+void lock_Write(lock_subsys_t subsys) {
+    lock_state_t *l = &locks[subsys];
+    pthread_rwlock_wrlock(&l->rwlock);
+    fileLock(subsys, F_WRLCK);
+}
+
+void lock_Unlock(lock_subsys_t subsys) {
+    lock_state_t *l = &locks[subsys];
+    pthread_mutex_lock(&l->readers_mutex);
+    if (l->readers > 0) {
+        // Shared lock held by this thread
+        if (--l->readers == 0) {
+            fileLock(subsys, F_UNLCK);
+        }
+    } else {
+        fileLock(subsys, F_UNLCK);
+    }
+    pthread_mutex_unlock(&l->readers_mutex);
+    pthread_rwlock_unlock(&l->rwlock);
+}
+
+void *lock_MapState(lock_subsys_t subsys, size_t size, bool *fresh) {
+    // Without the lock file the processes could not serialize access to the state
+    if (lock_fd == -1)
+        return NULL;
+
+    char path[64];
+    snprintf(path, sizeof(path), STATE_FILE, state_names[subsys]);
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, LOCK_FILE_MODE);
+    if (fd == -1)
+        return NULL;
+    restrictAccess(fd);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    *fresh = (size_t) st.st_size != size;
+    // A state of another layout is dropped, the new one starts zeroed
+    if (*fresh && (ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0)) {
+        close(fd);
+        return NULL;
+    }
+    void *state = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return state == MAP_FAILED ? NULL : state;
+}
+
+void lock_UnmapState(void *state, size_t size) {
+    if (state != NULL) {
+        munmap(state, size);
+    }
+}
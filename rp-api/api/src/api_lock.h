@@ -0,0 +1,74 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library subsystem locking interface
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef API_LOCK_H_
+#define API_LOCK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Each subsystem has its own lock, so for example acquisition readout
+ * does not wait for a generator update. Setters take an exclusive lock.
+ * Getters that read a single register or cached value do not lock, a 32 bit
+ * register read is atomic; only multi word reads (acquisition data,
+ * arbitrary waveform, filter coefficients) take a shared lock. Locks are held
+ * between threads of one process and between all processes that use the
+ * library. HK setters lock per call, rp_Reset() is a sequence of locked
+ * subsystem resets and is not atomic as a whole.
+ *
+ * Lock order when nesting: CALIB -> ACQ -> GEN -> HK.
+ *
+ * A subsystem can keep its state in a shared mapping, so every process works
+ * from the settings written by the others. The mapping is guarded by the lock
+ * of the subsystem and is only created when the lock file is available.
+ */
+typedef enum {
+    LOCK_CALIB = 0,
+    LOCK_ACQ   = 1,
+    LOCK_GEN   = 2,
+    LOCK_HK    = 3,
+    LOCK_COUNT
+} lock_subsys_t;
+
+#define LOCK_READ(SUBSYS, X) { \
+        lock_Read(SUBSYS); \
+        int lock_retval = (X); \
+        lock_Unlock(SUBSYS); \
+        return lock_retval; \
+}
+
+#define LOCK_WRITE(SUBSYS, X) { \
+        lock_Write(SUBSYS); \
+        int lock_retval = (X); \
+        lock_Unlock(SUBSYS); \
+        return lock_retval; \
+}
+
+int lock_Init();
+int lock_Release();
+
+void lock_Read(lock_subsys_t subsys);
+void lock_Write(lock_subsys_t subsys);
+void lock_Unlock(lock_subsys_t subsys);
+
+/**
+ * Maps the shared state of a subsystem, the caller holds its write lock.
+ * fresh is set when the mapping was created or had another size, the caller
+ * then initializes it. Returns NULL when the state can not be shared.
+ */
+void *lock_MapState(lock_subsys_t subsys, size_t size, bool *fresh);
+void lock_UnmapState(void *state, size_t size);
+
+#endif /* API_LOCK_H_ */
@@ -44,6 +44,11 @@ static const int  eeprom_calib_factory_off = 0x1c08;
 static rp_calib_params_t calib, failsafa_params;
 
 int calib_Init(){
+    if (cmn_IsSimulation()) {
+        // There is no EEPROM to read in simulation
+        calib = getDefualtCalib();
+        return RP_OK;
+    }
     calib_ReadParams(&calib,false);
     return RP_OK;
 }
@@ -13,17 +13,26 @@
  */
 
 #include <fcntl.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <stdio.h>
 #include <math.h>
 #include "common.h"
 #include "rp_cross.h"
+#include "sim.h"
 
 static int fd = 0;
+static bool simulation = false;
 
 int cmn_Init()
 {
+    if (getenv("RP_SIMULATION")) {
+        // Registers are emulated in process memory, /dev/uio/api is not needed
+        simulation = true;
+        return sim_Init();
+    }
+
     if (!fd) {
         if((fd = open("/dev/uio/api", O_RDWR | O_SYNC)) == -1) {
             return RP_EOMD;
@@ -34,6 +43,11 @@ int cmn_Init()
 
 int cmn_Release()
 {
+    if (simulation) {
+        simulation = false;
+        return sim_Release();
+    }
+
     if (fd) {
         if(close(fd) < 0) {
             return RP_ECMD;
@@ -43,8 +57,17 @@ int cmn_Release()
     return RP_OK;
 }
 
+bool cmn_IsSimulation()
+{
+    return simulation;
+}
+
 int cmn_Map(size_t size, size_t offset, void** mapped)
 {
+    if (simulation) {
+        return sim_Map(size, offset, mapped);
+    }
+
     if(fd == -1) {
         return RP_EMMD;
     }
@@ -62,6 +85,10 @@ int cmn_Map(size_t size, size_t offset, void** mapped)
 
 int cmn_Unmap(size_t size, void** mapped)
 {
+    if (simulation) {
+        return sim_Unmap(size, mapped);
+    }
+
     if(fd == -1) {
         return RP_EUMD;
     }
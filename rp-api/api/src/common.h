@@ -87,6 +87,7 @@ else { \
 
 int cmn_Init();
 int cmn_Release();
+bool cmn_IsSimulation();
 
 void cmn_DebugReg(const char* msg,uint32_t value);
 void cmn_DebugRegCh(const char* msg,int ch,uint32_t value);
@@ -17,6 +17,7 @@
 #include "common.h"
 #include "generate.h"
 #include "gen_handler.h"
+#include "api_lock.h"
 
 #ifdef Z20_250_12
 #include "rp-i2c-max7311-c.h"
@@ -26,38 +27,111 @@
     #define M_PI 3.14159265358979323846
 #endif
 
-// global variables
-// TODO: should be organized into a system status structure
-float         chA_amplitude            = 1,         chB_amplitude            = 1;
-float         chA_offset               = 0,         chB_offset               = 0;
-float         chA_dutyCycle            = 0,         chB_dutyCycle            = 0;
-float         chA_riseTime             = 1,         chB_riseTime             = 1;
-float         chA_fallTime             = 1,         chB_fallTime             = 1;
-float         chA_riseFallMin        = 0.1,         chB_riseFallMin        = 0.1;
-float         chA_riseFallMax       = 1000,         chB_riseFallMax       = 1000;
-float         chA_frequency               ,         chB_frequency               ;
-float         chA_sweepStartFrequency     ,         chB_sweepStartFrequency     ;
-float         chA_sweepEndFrequency       ,         chB_sweepEndFrequency       ;
-float         chA_phase                = 0,         chB_phase                = 0;
-int           chA_burstCount           = 1,         chB_burstCount           = 1;
-int           chA_burstRepetition      = 1,         chB_burstRepetition      = 1;
-uint32_t      chA_burstPeriod          = 0,         chB_burstPeriod          = 0;
-rp_waveform_t chA_waveform                ,         chB_waveform                ;
-rp_gen_sweep_mode_t  chA_sweepMode        ,         chB_sweepMode               ;
-rp_gen_sweep_dir_t   chA_sweepDir         ,         chB_sweepDir                ;
-uint32_t      chA_size     = DAC_BUFFER_SIZE,       chB_size     = DAC_BUFFER_SIZE;
-uint32_t      chA_arb_size = DAC_BUFFER_SIZE,       chB_arb_size = DAC_BUFFER_SIZE;
-rp_gen_mode_t chA_mode = RP_GEN_MODE_CONTINUOUS,    chB_mode = RP_GEN_MODE_CONTINUOUS;
-
-bool          chA_EnableTempProtection = 0, chB_EnableTempProtection = 0;
-bool          chA_LatchTempAlarm       = 0, chB_LatchTempAlarm       = 0;
-
+// Sine table for the phase-accumulator synthesis. The top SIN_LUT_BITS of the 32 bit
+// phase select the entry, the remaining bits are used for linear interpolation.
+#define SIN_LUT_BITS     12
+#define SIN_LUT_SIZE     (1 << SIN_LUT_BITS)
+#define SIN_LUT_FRAC     (32 - SIN_LUT_BITS)
+#define PHASE_FULL_TURN  4294967296.0 // 2^32
+
+// Generator settings are shared by all processes that use the library, so a
+// process synthesizes from the settings written by the others. The mapping is
+// guarded by LOCK_GEN; when it can not be created the state is process local.
+#define GEN_STATE_MAGIC  0x52504701 // "RPG" + layout version
+
+typedef struct gen_state_s {
+    uint32_t      magic;
+    float         chA_amplitude,            chB_amplitude;
+    float         chA_offset,               chB_offset;
+    float         chA_dutyCycle,            chB_dutyCycle;
+    float         chA_riseTime,             chB_riseTime;
+    float         chA_fallTime,             chB_fallTime;
+    float         chA_riseFallMin,          chB_riseFallMin;
+    float         chA_riseFallMax,          chB_riseFallMax;
+    float         chA_frequency,            chB_frequency;
+    float         chA_sweepStartFrequency,  chB_sweepStartFrequency;
+    float         chA_sweepEndFrequency,    chB_sweepEndFrequency;
+    float         chA_phase,                chB_phase;
+    int           chA_burstCount,           chB_burstCount;
+    int           chA_burstRepetition,      chB_burstRepetition;
+    uint32_t      chA_burstPeriod,          chB_burstPeriod;
+    rp_waveform_t chA_waveform,             chB_waveform;
+    rp_gen_sweep_mode_t chA_sweepMode,      chB_sweepMode;
+    rp_gen_sweep_dir_t  chA_sweepDir,       chB_sweepDir;
+    uint32_t      chA_size,                 chB_size;
+    uint32_t      chA_arb_size,             chB_arb_size;
+    rp_gen_mode_t chA_mode,                 chB_mode;
+    bool          chA_EnableTempProtection, chB_EnableTempProtection;
+    bool          chA_LatchTempAlarm,       chB_LatchTempAlarm;
 #ifdef Z20_250_12
-rp_gen_gain_t chA_gain                    , chB_gain                    ;
+    rp_gen_gain_t chA_gain,                 chB_gain;
 #endif
+    float         chA_arbitraryData[DAC_BUFFER_SIZE];
+    float         chB_arbitraryData[DAC_BUFFER_SIZE];
+} gen_state_t;
+
+static const gen_state_t gen_state_default = {
+    .magic = GEN_STATE_MAGIC,
+    .chA_amplitude = 1,         .chB_amplitude = 1,
+    .chA_riseTime = 1,          .chB_riseTime = 1,
+    .chA_fallTime = 1,          .chB_fallTime = 1,
+    .chA_riseFallMin = 0.1,     .chB_riseFallMin = 0.1,
+    .chA_riseFallMax = 1000,    .chB_riseFallMax = 1000,
+    .chA_burstCount = 1,        .chB_burstCount = 1,
+    .chA_burstRepetition = 1,   .chB_burstRepetition = 1,
+    .chA_size = DAC_BUFFER_SIZE,     .chB_size = DAC_BUFFER_SIZE,
+    .chA_arb_size = DAC_BUFFER_SIZE, .chB_arb_size = DAC_BUFFER_SIZE,
+    .chA_mode = RP_GEN_MODE_CONTINUOUS, .chB_mode = RP_GEN_MODE_CONTINUOUS
+};
+
+static gen_state_t  gen_state_local = gen_state_default;
+static gen_state_t *gen_state = &gen_state_local;
+
+static float sin_lut[SIN_LUT_SIZE + 1];
+static bool  sin_lut_ready = false;
+
+static void sinLutInit() {
+    if (sin_lut_ready) return;
+    for (int i = 0; i <= SIN_LUT_SIZE; i++) {
+        sin_lut[i] = (float) sin(2 * M_PI * (double) i / (double) SIN_LUT_SIZE);
+    }
+    sin_lut_ready = true;
+}
+
+static inline float sinLut(uint32_t phase) {
+    uint32_t idx = phase >> SIN_LUT_FRAC;
+    float frac = (float) (phase & ((1u << SIN_LUT_FRAC) - 1)) * (1.0f / (float) (1u << SIN_LUT_FRAC));
+    float a = sin_lut[idx];
+    return a + (sin_lut[idx + 1] - a) * frac;
+}
+
+// Converts phase in turns to the 32 bit fixed point phase accumulator format
+static inline uint32_t phaseFromTurns(double turns) {
+    turns -= floor(turns);
+    return (uint32_t) (uint64_t) (turns * PHASE_FULL_TURN);
+}
+
+int gen_Init() {
+    bool fresh = false;
+    gen_state_t *shared = (gen_state_t *) lock_MapState(LOCK_GEN, sizeof(gen_state_t), &fresh);
+    if (shared == NULL) {
+        return RP_OK;
+    }
+    if (fresh || shared->magic != GEN_STATE_MAGIC) {
+        *shared = gen_state_default;
+    }
+    gen_state = shared;
+    return RP_OK;
+}
 
-float chA_arbitraryData[DAC_BUFFER_SIZE];
-float chB_arbitraryData[DAC_BUFFER_SIZE];
+int gen_Release() {
+    if (gen_state != &gen_state_local) {
+        gen_state_local = *gen_state;
+        lock_UnmapState(gen_state, sizeof(gen_state_t));
+        gen_state = &gen_state_local;
+    }
+    return RP_OK;
+}
 
 int gen_SetDefaultValues() {
     gen_Disable(RP_CH_1);
@@ -136,19 +210,19 @@ int gen_checkAmplitudeAndOffset(float amplitude, float offset) {
 int gen_setAmplitude(rp_channel_t channel, float amplitude) {
     float offset;
     CHANNEL_ACTION(channel,
-            offset = chA_offset,
-            offset = chB_offset)
+            offset = gen_state->chA_offset,
+            offset = gen_state->chB_offset)
     gen_checkAmplitudeAndOffset(amplitude, offset);
 
     CHANNEL_ACTION(channel,
-            chA_amplitude = amplitude,
-            chB_amplitude = amplitude)
+            gen_state->chA_amplitude = amplitude,
+            gen_state->chB_amplitude = amplitude)
 
 #ifdef Z20_250_12
     rp_gen_gain_t gain;
         CHANNEL_ACTION(channel,
-            gain = chA_gain,
-            gain = chB_gain)
+            gain = gen_state->chA_gain,
+            gain = gen_state->chB_gain)
     return generate_setAmplitude(channel, gain , amplitude);
 #endif
 
@@ -159,11 +233,11 @@ int gen_setAmplitude(rp_channel_t channel, float amplitude) {
 
 int gen_getAmplitude(rp_channel_t channel, float *amplitude) {
     if (channel == RP_CH_1) {
-        *amplitude = chA_amplitude;
+        *amplitude = gen_state->chA_amplitude;
         return RP_OK;
     }
     if (channel == RP_CH_2) {
-        *amplitude = chB_amplitude;
+        *amplitude = gen_state->chB_amplitude;
         return RP_OK;
     }
     return RP_EPN;
@@ -172,19 +246,19 @@ int gen_getAmplitude(rp_channel_t channel, float *amplitude) {
 int gen_setOffset(rp_channel_t channel, float offset) {
     float amplitude;
     CHANNEL_ACTION(channel,
-            amplitude = chA_amplitude,
-            amplitude = chB_amplitude)
+            amplitude = gen_state->chA_amplitude,
+            amplitude = gen_state->chB_amplitude)
     gen_checkAmplitudeAndOffset(amplitude, offset);
 
     CHANNEL_ACTION(channel,
-            chA_offset = offset,
-            chB_offset = offset)
+            gen_state->chA_offset = offset,
+            gen_state->chB_offset = offset)
 
 #ifdef Z20_250_12
     rp_gen_gain_t gain;
         CHANNEL_ACTION(channel,
-            gain = chA_gain,
-            gain = chB_gain)
+            gain = gen_state->chA_gain,
+            gain = gen_state->chB_gain)
     return generate_setDCOffset(channel, gain , offset);
 #endif
 
@@ -195,11 +269,11 @@ int gen_setOffset(rp_channel_t channel, float offset) {
 
 int gen_getOffset(rp_channel_t channel, float *offset) {
     if (channel == RP_CH_1) {
-        *offset = chA_offset;
+        *offset = gen_state->chA_offset;
         return RP_OK;
     }
     if (channel == RP_CH_2) {
-        *offset = chB_offset;
+        *offset = gen_state->chB_offset;
         return RP_OK;
     }
     return RP_EPN;
@@ -207,20 +281,20 @@ int gen_getOffset(rp_channel_t channel, float *offset) {
 
 int gen_setRiseFallMin(rp_channel_t channel, float min) {
     if (channel == RP_CH_1) {
-        chA_riseFallMin = min;
-        if (chA_riseTime < chA_riseFallMin) {
-            chA_riseTime = chA_riseFallMin;
+        gen_state->chA_riseFallMin = min;
+        if (gen_state->chA_riseTime < gen_state->chA_riseFallMin) {
+            gen_state->chA_riseTime = gen_state->chA_riseFallMin;
         }
-        if (chA_fallTime < chA_riseFallMin) {
-            chA_fallTime = chA_riseFallMin;
+        if (gen_state->chA_fallTime < gen_state->chA_riseFallMin) {
+            gen_state->chA_fallTime = gen_state->chA_riseFallMin;
         }
     } else if (channel == RP_CH_2) {
-        chB_riseFallMin = min;
-        if (chB_riseTime < chB_riseFallMin) {
-            chB_riseTime = chB_riseFallMin;
+        gen_state->chB_riseFallMin = min;
+        if (gen_state->chB_riseTime < gen_state->chB_riseFallMin) {
+            gen_state->chB_riseTime = gen_state->chB_riseFallMin;
         }
-        if (chB_fallTime < chB_riseFallMin) {
-            chB_fallTime = chB_riseFallMin;
+        if (gen_state->chB_fallTime < gen_state->chB_riseFallMin) {
+            gen_state->chB_fallTime = gen_state->chB_riseFallMin;
         }
     } else {
         return RP_EPN;
@@ -230,27 +304,27 @@ int gen_setRiseFallMin(rp_channel_t channel, float min) {
 
 int gen_getRiseFallMin(rp_channel_t channel, float *min) {
     CHANNEL_ACTION(channel,
-            *min = chA_riseFallMin,
-            *min = chB_riseFallMin);
+            *min = gen_state->chA_riseFallMin,
+            *min = gen_state->chB_riseFallMin);
     return RP_OK;
 }
 
 int gen_setRiseFallMax(rp_channel_t channel, float max) {
     if (channel == RP_CH_1) {
-        chA_riseFallMax = max;
-        if (chA_riseTime > chA_riseFallMax) {
-            chA_riseTime = chA_riseFallMax;
+        gen_state->chA_riseFallMax = max;
+        if (gen_state->chA_riseTime > gen_state->chA_riseFallMax) {
+            gen_state->chA_riseTime = gen_state->chA_riseFallMax;
         }
-        if (chA_fallTime > chA_riseFallMax) {
-            chA_fallTime = chA_riseFallMax;
+        if (gen_state->chA_fallTime > gen_state->chA_riseFallMax) {
+            gen_state->chA_fallTime = gen_state->chA_riseFallMax;
         }
     } else if (channel == RP_CH_2) {
-        chB_riseFallMax = max;
-        if (chB_riseTime > chB_riseFallMax) {
-            chB_riseTime = chB_riseFallMax;
+        gen_state->chB_riseFallMax = max;
+        if (gen_state->chB_riseTime > gen_state->chB_riseFallMax) {
+            gen_state->chB_riseTime = gen_state->chB_riseFallMax;
         }
-        if (chB_fallTime > chB_riseFallMax) {
-            chB_fallTime = chB_riseFallMax;
+        if (gen_state->chB_fallTime > gen_state->chB_riseFallMax) {
+            gen_state->chB_fallTime = gen_state->chB_riseFallMax;
         }
     }
     return RP_OK;
@@ -258,8 +332,8 @@ int gen_setRiseFallMax(rp_channel_t channel, float max) {
 
 int gen_getRiseFallMax(rp_channel_t channel, float *max) {
     CHANNEL_ACTION(channel,
-            *max = chA_riseFallMax,
-            *max = chB_riseFallMax);
+            *max = gen_state->chA_riseFallMax,
+            *max = gen_state->chB_riseFallMax);
     return RP_OK;
 }
 
@@ -269,12 +343,12 @@ int gen_setFrequency(rp_channel_t channel, float frequency) {
     }
 
     if (channel == RP_CH_1) {
-        chA_frequency = frequency;
-        gen_setBurstPeriod(channel, chA_burstPeriod);
+        gen_state->chA_frequency = frequency;
+        gen_setBurstPeriod(channel, gen_state->chA_burstPeriod);
     }
     else if (channel == RP_CH_2) {
-        chB_frequency = frequency;
-        gen_setBurstPeriod(channel, chB_burstPeriod);
+        gen_state->chB_frequency = frequency;
+        gen_setBurstPeriod(channel, gen_state->chB_burstPeriod);
     }
     else {
         return RP_EPN;
@@ -291,10 +365,10 @@ int gen_setFrequencyDirect(rp_channel_t channel, float frequency){
         return RP_EOOR;
     }
     if (channel == RP_CH_1) {
-        chA_frequency = frequency;
+        gen_state->chA_frequency = frequency;
     }
     else if (channel == RP_CH_2) {
-        chB_frequency = frequency;
+        gen_state->chB_frequency = frequency;
     }
     else {
         return RP_EPN;
@@ -314,10 +388,10 @@ int gen_setSweepStartFrequency(rp_channel_t channel, float frequency){
         return RP_EOOR;
     }
      if (channel == RP_CH_1) {
-        chA_sweepStartFrequency = frequency;
+        gen_state->chA_sweepStartFrequency = frequency;
     }
     else if (channel == RP_CH_2) {
-        chB_sweepStartFrequency = frequency;
+        gen_state->chB_sweepStartFrequency = frequency;
     }
     else {
         return RP_EPN;
@@ -327,8 +401,8 @@ int gen_setSweepStartFrequency(rp_channel_t channel, float frequency){
 
 int gen_getSweepStartFrequency(rp_channel_t channel, float *frequency){
     CHANNEL_ACTION(channel,
-            *frequency = chA_sweepStartFrequency,
-            *frequency = chB_sweepStartFrequency)
+            *frequency = gen_state->chA_sweepStartFrequency,
+            *frequency = gen_state->chB_sweepStartFrequency)
     return RP_OK;
 }
 
@@ -337,10 +411,10 @@ int gen_setSweepEndFrequency(rp_channel_t channel, float frequency){
         return RP_EOOR;
     }
      if (channel == RP_CH_1) {
-        chA_sweepEndFrequency = frequency;
+        gen_state->chA_sweepEndFrequency = frequency;
     }
     else if (channel == RP_CH_2) {
-        chB_sweepEndFrequency = frequency;
+        gen_state->chB_sweepEndFrequency = frequency;
     }
     else {
         return RP_EPN;
@@ -350,8 +424,8 @@ int gen_setSweepEndFrequency(rp_channel_t channel, float frequency){
 
 int gen_getSweepEndFrequency(rp_channel_t channel, float *frequency){
     CHANNEL_ACTION(channel,
-            *frequency = chA_sweepEndFrequency,
-            *frequency = chB_sweepEndFrequency)
+            *frequency = gen_state->chA_sweepEndFrequency,
+            *frequency = gen_state->chB_sweepEndFrequency)
     return RP_OK;
 }
 
@@ -361,68 +435,68 @@ int gen_setPhase(rp_channel_t channel, float phase) {
         return RP_EOOR;
     }
     CHANNEL_ACTION(channel,
-            chA_phase = phase,
-            chB_phase = phase)
+            gen_state->chA_phase = phase,
+            gen_state->chB_phase = phase)
 
     return synthesize_signal(channel);
 }
 
 int gen_getPhase(rp_channel_t channel, float *phase) {
     CHANNEL_ACTION(channel,
-            *phase = chA_phase,
-            *phase = chB_phase)
+            *phase = gen_state->chA_phase,
+            *phase = gen_state->chB_phase)
     return RP_OK;
 }
 
 int gen_setWaveform(rp_channel_t channel, rp_waveform_t type) {
     CHANNEL_ACTION(channel,
-            chA_waveform = type,
-            chB_waveform = type)
+            gen_state->chA_waveform = type,
+            gen_state->chB_waveform = type)
     if (type == RP_WAVEFORM_ARBITRARY) {
         CHANNEL_ACTION(channel,
-                chA_size = chA_arb_size,
-                chB_size = chB_arb_size)
+                gen_state->chA_size = gen_state->chA_arb_size,
+                gen_state->chB_size = gen_state->chB_arb_size)
     }
     else{
         CHANNEL_ACTION(channel,
-                chA_size = DAC_BUFFER_SIZE,
-                chB_size = DAC_BUFFER_SIZE)
+                gen_state->chA_size = DAC_BUFFER_SIZE,
+                gen_state->chB_size = DAC_BUFFER_SIZE)
     }
     return synthesize_signal(channel);
 }
 
 int gen_getWaveform(rp_channel_t channel, rp_waveform_t *type) {
     CHANNEL_ACTION(channel,
-            *type = chA_waveform,
-            *type = chB_waveform)
+            *type = gen_state->chA_waveform,
+            *type = gen_state->chB_waveform)
     return RP_OK;
 }
 
 int gen_setSweepMode(rp_channel_t channel, rp_gen_sweep_mode_t mode) {
     CHANNEL_ACTION(channel,
-            chA_sweepMode = mode,
-            chB_sweepMode = mode)    
+            gen_state->chA_sweepMode = mode,
+            gen_state->chB_sweepMode = mode)    
     return synthesize_signal(channel);
 }
 
 int gen_getSweepMode(rp_channel_t channel, rp_gen_sweep_mode_t *mode) {
     CHANNEL_ACTION(channel,
-            *mode = chA_sweepMode,
-            *mode = chB_sweepMode)
+            *mode = gen_state->chA_sweepMode,
+            *mode = gen_state->chB_sweepMode)
     return RP_OK;
 }
 
 int gen_setSweepDir(rp_channel_t channel, rp_gen_sweep_dir_t mode){
     CHANNEL_ACTION(channel,
-            chA_sweepDir = mode,
-            chB_sweepDir = mode)    
+            gen_state->chA_sweepDir = mode,
+            gen_state->chB_sweepDir = mode)    
     return synthesize_signal(channel);
 }
 
 int gen_getSweepDir(rp_channel_t channel, rp_gen_sweep_dir_t *mode){
     CHANNEL_ACTION(channel,
-            *mode = chA_sweepDir,
-            *mode = chB_sweepDir)
+            *mode = gen_state->chA_sweepDir,
+            *mode = gen_state->chB_sweepDir)
     return RP_OK;
 }
 
@@ -443,8 +517,8 @@ int gen_setArbWaveform(rp_channel_t channel, float *data, uint32_t length) {
     // Save data
     float *pointer;
     CHANNEL_ACTION(channel,
-            pointer = chA_arbitraryData,
-            pointer = chB_arbitraryData)
+            pointer = gen_state->chA_arbitraryData,
+            pointer = gen_state->chB_arbitraryData)
     for(i = 0; i < length; i++) {
         pointer[i] = data[i];
     }
@@ -453,14 +527,14 @@ int gen_setArbWaveform(rp_channel_t channel, float *data, uint32_t length) {
     }
 
     if (channel == RP_CH_1) {
-        chA_arb_size = length;
-        if(chA_waveform==RP_WAVEFORM_ARBITRARY){
+        gen_state->chA_arb_size = length;
+        if(gen_state->chA_waveform==RP_WAVEFORM_ARBITRARY){
         	return synthesize_signal(channel);
         }
     }
     else if (channel == RP_CH_2) {
-    	chB_arb_size = length;
-        if(chB_waveform==RP_WAVEFORM_ARBITRARY){
+    	gen_state->chB_arb_size = length;
+        if(gen_state->chB_waveform==RP_WAVEFORM_ARBITRARY){
         	return synthesize_signal(channel);
         }
     }
@@ -475,12 +549,12 @@ int gen_getArbWaveform(rp_channel_t channel, float *data, uint32_t *length) {
     // If this data was not set, then this method will return incorrect data
     float *pointer;
     if (channel == RP_CH_1) {
-        *length = chA_arb_size;
-        pointer = chA_arbitraryData;
+        *length = gen_state->chA_arb_size;
+        pointer = gen_state->chA_arbitraryData;
     }
     else if (channel == RP_CH_2) {
-        *length = chB_arb_size;
-        pointer = chB_arbitraryData;
+        *length = gen_state->chB_arb_size;
+        pointer = gen_state->chB_arbitraryData;
     }
     else {
         return RP_EPN;
@@ -496,30 +570,30 @@ int gen_setDutyCycle(rp_channel_t channel, float ratio) {
         return RP_EOOR;
     }
     CHANNEL_ACTION(channel,
-            chA_dutyCycle = ratio,
-            chB_dutyCycle = ratio)
+            gen_state->chA_dutyCycle = ratio,
+            gen_state->chB_dutyCycle = ratio)
     return synthesize_signal(channel);
 }
 
 int gen_getDutyCycle(rp_channel_t channel, float *ratio) {
     CHANNEL_ACTION(channel,
-            *ratio = chA_dutyCycle,
-            *ratio = chB_dutyCycle)
+            *ratio = gen_state->chA_dutyCycle,
+            *ratio = gen_state->chB_dutyCycle)
     return RP_OK;
 }
 
 int gen_setRiseTime(rp_channel_t channel, float time) {
     if (channel == RP_CH_1) {
-        if (time < chA_riseFallMin || time > chA_riseFallMax) {
+        if (time < gen_state->chA_riseFallMin || time > gen_state->chA_riseFallMax) {
             return RP_EOOR;
         }
-        chA_riseTime = time;
+        gen_state->chA_riseTime = time;
     }
     else if (channel == RP_CH_2) {
-        if (time < chB_riseFallMin || time > chB_riseFallMax) {
+        if (time < gen_state->chB_riseFallMin || time > gen_state->chB_riseFallMax) {
             return RP_EOOR;
         }
-        chB_riseTime = time;
+        gen_state->chB_riseTime = time;
     }
     else {
         return RP_EPN;
@@ -529,22 +603,22 @@ int gen_setRiseTime(rp_channel_t channel, float time) {
 
 int gen_getRiseTime(rp_channel_t channel, float *time) {
     CHANNEL_ACTION(channel,
-                   *time = chA_riseTime,
-                   *time = chB_riseTime)
+                   *time = gen_state->chA_riseTime,
+                   *time = gen_state->chB_riseTime)
     return RP_OK;
 }
 
 int gen_setFallTime(rp_channel_t channel, float time) {
     if (channel == RP_CH_1) {
-        if (time < chA_riseFallMin || time > chA_riseFallMax) {
+        if (time < gen_state->chA_riseFallMin || time > gen_state->chA_riseFallMax) {
             return RP_EOOR;
         }
-        chA_fallTime = time;
+        gen_state->chA_fallTime = time;
     } else if (channel == RP_CH_2) {
-        if (time < chB_riseFallMin || time > chB_riseFallMax) {
+        if (time < gen_state->chB_riseFallMin || time > gen_state->chB_riseFallMax) {
             return RP_EOOR;
         }
-        chB_fallTime = time;
+        gen_state->chB_fallTime = time;
     } else {
         return RP_EPN;
     }
@@ -553,16 +627,16 @@ int gen_setFallTime(rp_channel_t channel, float time) {
 
 int gen_getFallTime(rp_channel_t channel, float *time) {
     CHANNEL_ACTION(channel,
-                   *time = chA_fallTime,
-                   *time = chB_fallTime)
+                   *time = gen_state->chA_fallTime,
+                   *time = gen_state->chB_fallTime)
     return RP_OK;
 }
 
 int gen_setGenMode(rp_channel_t channel, rp_gen_mode_t mode) {
     
     CHANNEL_ACTION(channel,
-            chA_mode = mode,
-            chB_mode = mode)
+            gen_state->chA_mode = mode,
+            gen_state->chB_mode = mode)
 
     if (mode == RP_GEN_MODE_CONTINUOUS) {
         generate_setGatedBurst(channel, 0);
@@ -572,9 +646,9 @@ int gen_setGenMode(rp_channel_t channel, rp_gen_mode_t mode) {
         return RP_OK;
     }
     else if (mode == RP_GEN_MODE_BURST) {
-        gen_setBurstCount(channel, channel == RP_CH_1 ? chA_burstCount : chB_burstCount);
-        gen_setBurstRepetitions(channel, channel == RP_CH_1 ? chA_burstRepetition : chB_burstRepetition);
-        gen_setBurstPeriod(channel, channel == RP_CH_1 ? chA_burstPeriod : chB_burstPeriod);
+        gen_setBurstCount(channel, channel == RP_CH_1 ? gen_state->chA_burstCount : gen_state->chB_burstCount);
+        gen_setBurstRepetitions(channel, channel == RP_CH_1 ? gen_state->chA_burstRepetition : gen_state->chB_burstRepetition);
+        gen_setBurstPeriod(channel, channel == RP_CH_1 ? gen_state->chA_burstPeriod : gen_state->chB_burstPeriod);
         return RP_OK;
     }
     else if (mode == RP_GEN_MODE_STREAM) {
@@ -587,25 +661,25 @@ int gen_setGenMode(rp_channel_t channel, rp_gen_mode_t mode) {
 
 int gen_getGenMode(rp_channel_t channel, rp_gen_mode_t *mode) {
     CHANNEL_ACTION(channel,
-            *mode = chA_mode,
-            *mode = chB_mode)
+            *mode = gen_state->chA_mode,
+            *mode = gen_state->chB_mode)
     return RP_OK;
 }
 
 int gen_setBurstCount(rp_channel_t channel, int num) {
     rp_gen_mode_t mode;
     CHANNEL_ACTION(channel,
-            mode = chA_mode,
-            mode = chB_mode)
+            mode = gen_state->chA_mode,
+            mode = gen_state->chB_mode)
 
     if (num < BURST_COUNT_MIN || num > BURST_COUNT_MAX) {
         return RP_EOOR;
     }
 
     CHANNEL_ACTION(channel,
-            chA_burstCount = num,
-            chB_burstCount = num)
-    gen_setBurstPeriod(channel, channel == RP_CH_1 ? chA_burstPeriod : chB_burstPeriod);
+            gen_state->chA_burstCount = num,
+            gen_state->chB_burstCount = num)
+    gen_setBurstPeriod(channel, channel == RP_CH_1 ? gen_state->chA_burstPeriod : gen_state->chB_burstPeriod);
     if (mode == RP_GEN_MODE_BURST){
         int ret = generate_setBurstCount(channel, (uint32_t) num);
         return ret;
@@ -615,8 +689,8 @@ int gen_setBurstCount(rp_channel_t channel, int num) {
 
 int gen_getBurstCount(rp_channel_t channel, int *num) {
     CHANNEL_ACTION(channel,
-            *num = chA_burstCount,
-            *num = chB_burstCount)
+            *num = gen_state->chA_burstCount,
+            *num = gen_state->chB_burstCount)
     return RP_OK;
 }
 
@@ -633,15 +707,15 @@ int gen_getBurstLastValue(rp_channel_t channel, float *amplitude){
 int gen_setBurstRepetitions(rp_channel_t channel, int repetitions) {
     rp_gen_mode_t mode;
     CHANNEL_ACTION(channel,
-            mode = chA_mode,
-            mode = chB_mode)
+            mode = gen_state->chA_mode,
+            mode = gen_state->chB_mode)
     
     if (repetitions < BURST_REPETITIONS_MIN || repetitions > BURST_REPETITIONS_MAX) {
         return RP_EOOR;
     }
     CHANNEL_ACTION(channel,
-            chA_burstRepetition = repetitions,
-            chB_burstRepetition = repetitions)
+            gen_state->chA_burstRepetition = repetitions,
+            gen_state->chB_burstRepetition = repetitions)
     if (mode == RP_GEN_MODE_BURST){ 
         int ret =  generate_setBurstRepetitions(channel, (uint32_t) (repetitions-1));
         return ret;
@@ -651,16 +725,16 @@ int gen_setBurstRepetitions(rp_channel_t channel, int repetitions) {
 
 int gen_getBurstRepetitions(rp_channel_t channel, int *repetitions) {
     CHANNEL_ACTION(channel,
-            *repetitions = chA_burstRepetition,
-            *repetitions = chB_burstRepetition)
+            *repetitions = gen_state->chA_burstRepetition,
+            *repetitions = gen_state->chB_burstRepetition)
     return RP_OK;
 }
 
 int gen_setBurstPeriod(rp_channel_t channel, uint32_t period) {
     rp_gen_mode_t mode;
     CHANNEL_ACTION(channel,
-            mode = chA_mode,
-            mode = chB_mode)
+            mode = gen_state->chA_mode,
+            mode = gen_state->chB_mode)
 
     if (period < BURST_PERIOD_MIN || period > BURST_PERIOD_MAX) {
         return RP_EOOR;
@@ -668,12 +742,12 @@ int gen_setBurstPeriod(rp_channel_t channel, uint32_t period) {
     int burstCount;
     int delay = 0;
     CHANNEL_ACTION(channel,
-            burstCount = chA_burstCount,
-            burstCount = chB_burstCount)
+            burstCount = gen_state->chA_burstCount,
+            burstCount = gen_state->chB_burstCount)
     double freq;
     CHANNEL_ACTION(channel,
-            freq = chA_frequency,
-            freq = chB_frequency)
+            freq = gen_state->chA_frequency,
+            freq = gen_state->chB_frequency)
 
     int sigLen = ((1.0 * MICRO) / freq ) * burstCount;
     // period = signal_time * burst_count + delay_time
@@ -684,8 +758,8 @@ int gen_setBurstPeriod(rp_channel_t channel, uint32_t period) {
     delay = period - sigLen;
 
     CHANNEL_ACTION(channel,
-                chA_burstPeriod = period,
-                chB_burstPeriod = period)
+                gen_state->chA_burstPeriod = period,
+                gen_state->chB_burstPeriod = period)
 
     if (mode == RP_GEN_MODE_BURST){ 
         int ret = generate_setBurstDelay(channel, (uint32_t) delay);
@@ -696,8 +770,8 @@ int gen_setBurstPeriod(rp_channel_t channel, uint32_t period) {
 
 int gen_getBurstPeriod(rp_channel_t channel, uint32_t *period) {
     CHANNEL_ACTION(channel,
-                   *period = chA_burstPeriod,
-                   *period = chB_burstPeriod)
+                   *period = gen_state->chA_burstPeriod,
+                   *period = gen_state->chB_burstPeriod)
     return RP_OK;
 }
 
@@ -766,6 +840,7 @@ int gen_SynchroniseSM() {
 
 int synthesize_signal(rp_channel_t channel) {
     float data[DAC_BUFFER_SIZE];
+    float *arb_data = NULL;
     rp_waveform_t waveform;
     rp_gen_sweep_mode_t sweep_mode;
     rp_gen_sweep_dir_t sweep_dir;
@@ -775,32 +850,32 @@ int synthesize_signal(rp_channel_t channel) {
     float  phaseRad = 0;
 
     if (channel == RP_CH_1) {
-        waveform = chA_waveform;
-        dutyCycle = chA_dutyCycle;
-        frequency = chA_frequency;
-        riseTime = chA_riseTime;
-        fallTime = chA_fallTime;
-        sweepStartFreq = chA_sweepStartFrequency;
-        sweepEndFreq = chA_sweepEndFrequency;
-        sweep_mode = chA_sweepMode;
-        sweep_dir = chA_sweepDir;
-        size = chA_size;
-        phase = (chA_phase * DAC_BUFFER_SIZE / 360.0);
-        phaseRad = chA_phase/180.0 *  M_PI;
+        waveform = gen_state->chA_waveform;
+        dutyCycle = gen_state->chA_dutyCycle;
+        frequency = gen_state->chA_frequency;
+        riseTime = gen_state->chA_riseTime;
+        fallTime = gen_state->chA_fallTime;
+        sweepStartFreq = gen_state->chA_sweepStartFrequency;
+        sweepEndFreq = gen_state->chA_sweepEndFrequency;
+        sweep_mode = gen_state->chA_sweepMode;
+        sweep_dir = gen_state->chA_sweepDir;
+        size = gen_state->chA_size;
+        phase = (gen_state->chA_phase * DAC_BUFFER_SIZE / 360.0);
+        phaseRad = gen_state->chA_phase/180.0 *  M_PI;
     }
     else if (channel == RP_CH_2) {
-        waveform = chB_waveform;
-        dutyCycle = chB_dutyCycle;
-        frequency = chB_frequency;
-        riseTime = chB_riseTime;
-        fallTime = chB_fallTime;
-        sweepStartFreq = chB_sweepStartFrequency;
-        sweepEndFreq = chB_sweepEndFrequency;
-        sweep_mode = chB_sweepMode;
-        sweep_dir = chB_sweepDir;
-        size = chB_size;
-        phase = (chB_phase * DAC_BUFFER_SIZE / 360.0);
-        phaseRad = chB_phase/180.0 *  M_PI;
+        waveform = gen_state->chB_waveform;
+        dutyCycle = gen_state->chB_dutyCycle;
+        frequency = gen_state->chB_frequency;
+        riseTime = gen_state->chB_riseTime;
+        fallTime = gen_state->chB_fallTime;
+        sweepStartFreq = gen_state->chB_sweepStartFrequency;
+        sweepEndFreq = gen_state->chB_sweepEndFrequency;
+        sweep_mode = gen_state->chB_sweepMode;
+        sweep_dir = gen_state->chB_sweepDir;
+        size = gen_state->chB_size;
+        phase = (gen_state->chB_phase * DAC_BUFFER_SIZE / 360.0);
+        phaseRad = gen_state->chB_phase/180.0 *  M_PI;
     }
     else{
         return RP_EPN;
@@ -817,39 +892,56 @@ int synthesize_signal(rp_channel_t channel) {
         case RP_WAVEFORM_DC       : synthesis_DC       (data,buf_size);                 break;
         case RP_WAVEFORM_DC_NEG   : synthesis_DC_NEG   (data,buf_size);                 break; 
         case RP_WAVEFORM_PWM      : synthesis_PWM      (dutyCycle, data,buf_size);      break;
-        case RP_WAVEFORM_ARBITRARY: synthesis_arbitrary(channel, data, &size);          break;
+        case RP_WAVEFORM_ARBITRARY: 
+            // Stored waveform is already normalized, so it is written out without an extra copy
+            // The stored length can change while the channel stays in ARBITRARY mode
+            CHANNEL_ACTION(channel,
+                arb_data = gen_state->chA_arbitraryData; size = gen_state->chA_size = gen_state->chA_arb_size,
+                arb_data = gen_state->chB_arbitraryData; size = gen_state->chB_size = gen_state->chB_arb_size)
+            break;
         case RP_WAVEFORM_SWEEP    : synthesis_sweep(frequency,sweepStartFreq,sweepEndFreq,phaseRad,sweep_mode,sweep_dir, data, buf_size);break;
         default:                    return RP_EIPV;
     }
     if (waveform != RP_WAVEFORM_ARBITRARY) size = buf_size;
-    return generate_writeData(channel, data, phase, size);
+    return generate_writeData(channel, arb_data ? arb_data : data, phase, size);
 }
 
 int synthesis_sin(float *data_out,uint16_t buffSize) {
-    for(int unsigned i = 0; i < DAC_BUFFER_SIZE; i++) {
-        data_out[i] = (float) (sin(2 * M_PI * (float) i / (float) buffSize));
+    sinLutInit();
+    uint32_t phase = 0;
+    uint32_t step = phaseFromTurns(1.0 / (double) buffSize);
+    for(int unsigned i = 0; i < DAC_BUFFER_SIZE; i++, phase += step) {
+        data_out[i] = sinLut(phase);
     }
     return RP_OK;
 }
 
 int synthesis_triangle(float *data_out,uint16_t buffSize) {
-    for(int unsigned i = 0; i < DAC_BUFFER_SIZE; i++) {
-        data_out[i] = (float) ((asin(sin(2 * M_PI * (float) i / (float) buffSize)) / M_PI * 2));
+    // Same shape as asin(sin(x)) * 2 / PI, built from the phase accumulator.
+    // Phase is shifted by a quarter turn so the waveform folds at the top bit.
+    const float norm = 4.0f / PHASE_FULL_TURN;
+    uint32_t phase = 0x40000000;
+    uint32_t step = phaseFromTurns(1.0 / (double) buffSize);
+    for(int unsigned i = 0; i < DAC_BUFFER_SIZE; i++, phase += step) {
+        uint32_t folded = (phase & 0x80000000) ? ~phase : phase;
+        data_out[i] = (float) folded * norm - 1.0f;
     }
     return RP_OK;
 }
 
 int synthesis_rampUp(float *data_out,uint16_t buffSize) {
+    const float step = 1.0f / (float) buffSize;
     data_out[DAC_BUFFER_SIZE -1] = 0;
     for(int unsigned i = 0; i < DAC_BUFFER_SIZE-1; i++) {
-        data_out[DAC_BUFFER_SIZE - i-2] = (float) (-1.0 * (acos(cos(M_PI * (float) i / (float) buffSize)) / M_PI - 1));
+        data_out[DAC_BUFFER_SIZE - i-2] = 1.0f - (float) i * step;
     }
     return RP_OK;
 }
 
 int synthesis_rampDown(float *data_out,uint16_t buffSize) {
+    const float step = 1.0f / (float) buffSize;
     for(int unsigned i = 0; i < DAC_BUFFER_SIZE; i++) {
-        data_out[i] = (float) (-1.0 * (acos(cos(M_PI * (float) i / (float) buffSize)) / M_PI - 1));
+        data_out[i] = 1.0f - (float) i * step;
     }
     return RP_OK;
 }
@@ -886,14 +978,14 @@ int synthesis_PWM(float ratio, float *data_out,uint16_t buffSize) {
 int synthesis_arbitrary(rp_channel_t channel, float *data_out, uint32_t * size) {
     float *pointer;
     CHANNEL_ACTION(channel,
-            pointer = chA_arbitraryData,
-            pointer = chB_arbitraryData)
+            pointer = gen_state->chA_arbitraryData,
+            pointer = gen_state->chB_arbitraryData)
     for (int unsigned i = 0; i < DAC_BUFFER_SIZE; i++) {
         data_out[i] = pointer[i];
     }
     CHANNEL_ACTION(channel,
-            *size = chA_arb_size,
-            *size = chB_arb_size)
+            *size = gen_state->chA_arb_size,
+            *size = gen_state->chB_arb_size)
     return RP_OK;
 }
 
@@ -935,8 +1027,10 @@ int synthesis_square_Z20_250(float frequency, float *data_out,uint16_t buffSize)
 
 int synthesis_sweep(float frequency,float frequency_start,float frequency_end,float phaseRad,rp_gen_sweep_mode_t mode,rp_gen_sweep_dir_t dir, float *data_out,uint16_t buffSize) {
 
+    sinLutInit();
     bool inverDir = false;
     float sign = 1;
+    double phaseTurns = phaseRad / (2 * M_PI);
     if (frequency_end < frequency_start){
         inverDir = true;
     }
@@ -958,7 +1052,7 @@ int synthesis_sweep(float frequency,float frequency_start,float frequency_end,fl
             freq = frequency_start  * exp(x *log(frequency_end/frequency_start));
         }        
         if (inverDir) x = 1 - x;
-        data_out[i] = sin(freq * 2 * M_PI * (x)/frequency + phaseRad) * sign;
+        data_out[i] = sinLut(phaseFromTurns(freq * x / frequency + phaseTurns)) * sign;
     }
     return RP_OK;
 }
@@ -978,8 +1072,8 @@ int triggerIfInternal(rp_channel_t channel) {
 
 int gen_setEnableTempProtection(rp_channel_t channel, bool enable) {
     CHANNEL_ACTION(channel,
-            chA_EnableTempProtection = enable,
-            chB_EnableTempProtection = enable)
+            gen_state->chA_EnableTempProtection = enable,
+            gen_state->chB_EnableTempProtection = enable)
     return generate_setEnableTempProtection(channel, enable);
 }
 
@@ -989,8 +1083,8 @@ int gen_getEnableTempProtection(rp_channel_t channel, bool *enable) {
 
 int gen_setLatchTempAlarm(rp_channel_t channel, bool status) {
     CHANNEL_ACTION(channel,
-            chA_LatchTempAlarm = status,
-            chB_LatchTempAlarm = status)
+            gen_state->chA_LatchTempAlarm = status,
+            gen_state->chB_LatchTempAlarm = status)
     return generate_setLatchTempAlarm(channel, status);
 }
 
@@ -1006,10 +1100,10 @@ int gen_setGainOut(rp_channel_t channel,rp_gen_gain_t mode){
     rp_gen_gain_t *gain = NULL;
 
     if (channel == RP_CH_1) {
-        gain = &chA_gain;
+        gain = &gen_state->chA_gain;
     }
     else {
-        gain = &chB_gain;
+        gain = &gen_state->chB_gain;
     }
 
     int ch = (channel == RP_CH_1 ? RP_MAX7311_OUT1 : RP_MAX7311_OUT2);
@@ -1022,17 +1116,17 @@ int gen_setGainOut(rp_channel_t channel,rp_gen_gain_t mode){
 
     float offset;
     CHANNEL_ACTION(channel,
-            offset = chA_offset,
-            offset = chB_offset)
+            offset = gen_state->chA_offset,
+            offset = gen_state->chB_offset)
     return gen_setOffset(channel,offset);
 }
 
 int gen_getGainOut(rp_channel_t channel,rp_gen_gain_t *status){
     if (channel == RP_CH_1) {
-        *status = chA_gain;
+        *status = gen_state->chA_gain;
     }
     else {
-        *status = chB_gain;
+        *status = gen_state->chB_gain;
     }
     return RP_OK;
 }
@@ -18,6 +18,9 @@
 
 #include "rp_cross.h"
 
+// Must be called with LOCK_GEN held for writing
+int gen_Init();
+int gen_Release();
 int gen_SetDefaultValues();
 int gen_Disable(rp_channel_t chanel);
 int gen_Enable(rp_channel_t chanel);
@@ -20,6 +20,7 @@
 #include "common.h"
 #include "generate.h"
 #include "calib.h"
+#include "neon_asm.h"
 
 static volatile generate_control_t *generate = NULL;
 static volatile int32_t *data_chA = NULL;
@@ -243,16 +244,16 @@ int generate_writeData(rp_channel_t channel, float *data, int32_t start, uint32_
             dataOut = data_chA,
             dataOut = data_chB)
 
-    volatile ch_properties_t *properties;
-    getChannelPropertiesAddress(&properties, channel);
     generate_setWrapCounter(channel, length);
 
-    //rp_calib_params_t calib = calib_GetParams();
-    int dc_offs = 0;//channel == RP_CH_1 ? calib.be_ch1_dc_offs: calib.be_ch2_dc_offs;
-    uint32_t amp_max = 0; //channel == RP_CH_1 ? calib.be_ch1_fs: calib.be_ch2_fs;
+    // The buffer is rotated by start samples. Instead of wrapping each index,
+    // it is written as two contiguous bursts: [start, DAC_BUFFER_SIZE) and [0, start).
     if (start < 0) start += DAC_BUFFER_SIZE;
-    for(int i = start; i < start + DAC_BUFFER_SIZE; i++) {
-        dataOut[i % DAC_BUFFER_SIZE] = cmn_CnvVToCnt(DATA_BIT_LENGTH, data[i-start] * AMPLITUDE_MAX , AMPLITUDE_MAX, false, amp_max, dc_offs, 0.0);
+    start %= DAC_BUFFER_SIZE;
+    uint32_t head = DAC_BUFFER_SIZE - start;
+    cnvNormToCnt_neon(dataOut + start, data, head, DATA_BIT_LENGTH);
+    if (start > 0) {
+        cnvNormToCnt_neon(dataOut, data + head, start, DATA_BIT_LENGTH);
     }
     return RP_OK;
 }
@@ -1,8 +1,13 @@
 #pragma GCC diagnostic ignored "-Wunused-function"
 
 #include <string.h>
+#include <math.h>
 #include "neon_asm.h"
 
+#ifdef ARCH_ARM
+#include <arm_neon.h>
+#endif
+
 void memcpy_neon(volatile void *dst, volatile const void *src, size_t n)
 {
 
@@ -24,3 +29,49 @@ asm volatile (
     memcpy((void*)dst,(void*)src,n);
 #endif // ARCH_ARM
 }
+
+void cnvNormToCnt_neon(volatile int32_t *dst, const float *src, size_t n, uint32_t field_len)
+{
+    const float   scale = (float)(1 << (field_len - 1));
+    const int32_t cnt_max = (1 << (field_len - 1)) - 1;
+    const int32_t cnt_min = -(1 << (field_len - 1));
+    const int32_t mask = (1 << field_len) - 1;
+    int32_t *out = (int32_t*)dst;
+    size_t i = 0;
+
+#ifdef ARCH_ARM
+    const float32x4_t v_one   = vdupq_n_f32(1.0f);
+    const float32x4_t v_m_one = vdupq_n_f32(-1.0f);
+    const float32x4_t v_scale = vdupq_n_f32(scale);
+    const uint32x4_t  v_half  = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+    const uint32x4_t  v_sign  = vdupq_n_u32(0x80000000);
+    const int32x4_t   v_max   = vdupq_n_s32(cnt_max);
+    const int32x4_t   v_min   = vdupq_n_s32(cnt_min);
+    const int32x4_t   v_mask  = vdupq_n_s32(mask);
+
+    for (; i + 8 <= n; i += 8) {
+        __builtin_prefetch(src + i + 64);
+        float32x4_t a = vld1q_f32(src + i);
+        float32x4_t b = vld1q_f32(src + i + 4);
+        a = vmulq_f32(vminq_f32(vmaxq_f32(a, v_m_one), v_one), v_scale);
+        b = vmulq_f32(vminq_f32(vmaxq_f32(b, v_m_one), v_one), v_scale);
+        // Round half away from zero, same as round()
+        a = vaddq_f32(a, vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(a), v_sign), v_half)));
+        b = vaddq_f32(b, vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(b), v_sign), v_half)));
+        int32x4_t ca = vminq_s32(vmaxq_s32(vcvtq_s32_f32(a), v_min), v_max);
+        int32x4_t cb = vminq_s32(vmaxq_s32(vcvtq_s32_f32(b), v_min), v_max);
+        vst1q_s32(out + i, vandq_s32(ca, v_mask));
+        vst1q_s32(out + i + 4, vandq_s32(cb, v_mask));
+    }
+#endif // ARCH_ARM
+
+    for (; i < n; i++) {
+        float v = src[i];
+        if (v > 1.0f) v = 1.0f;
+        else if (v < -1.0f) v = -1.0f;
+        int32_t cnt = (int32_t)roundf(v * scale);
+        if (cnt > cnt_max) cnt = cnt_max;
+        else if (cnt < cnt_min) cnt = cnt_min;
+        out[i] = cnt & mask;
+    }
+}
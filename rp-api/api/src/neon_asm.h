@@ -1,14 +1,23 @@
 #ifndef NEON_ASM_H_
 #define NEON_ASM_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 void memcpy_neon(volatile void *dst, volatile const void *src, size_t n);
 
+/**
+ * Converts normalized samples [-1.0 .. 1.0] to two's complement DAC counts of field_len bits.
+ * Samples out of range are saturated. Output is written as one contiguous burst.
+ */
+void cnvNormToCnt_neon(volatile int32_t *dst, const float *src, size_t n, uint32_t field_len);
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
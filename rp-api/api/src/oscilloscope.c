@@ -15,6 +15,7 @@
 #include "common.h"
 #include "oscilloscope.h"
 #include "rp_cross.h"
+#include "sim.h"
 // The FPGA register structure for oscilloscope
 static volatile osc_control_t *osc_reg = NULL;
 
@@ -38,6 +39,20 @@ static volatile uint32_t *osc_chd = NULL;
 
 #endif
 
+/**
+ * Advances the simulated ADC before any acquisition state is read back
+ */
+static void simUpdate()
+{
+    if (!cmn_IsSimulation())
+        return;
+    sim_OscUpdate(0, osc_reg, osc_cha, osc_chb);
+#if defined Z20_125_4CH
+    if (!emulate4Ch)
+        sim_OscUpdate(1, osc_reg_4ch, osc_chc, osc_chd);
+#endif
+}
+
 /**
  * general
  */
@@ -136,6 +151,7 @@ int osc_SetTriggerSource(uint32_t source)
 
 int osc_GetTriggerSource(uint32_t* source)
 {
+    simUpdate();
     return cmn_GetValue(&osc_reg->trig_source, source, TRIG_SRC_MASK);
 }
 
@@ -167,16 +183,19 @@ int osc_GetArmKeep(bool *state){
 }
 
 int osc_GetBufferFillState(bool *state){
+    simUpdate();
     return cmn_AreBitsSet(osc_reg->conf, 0x10 , FILL_STATE_MASK, state);
 }
 
 int osc_GetTriggerState(bool *received)
 {
+    simUpdate();
     return cmn_AreBitsSet(osc_reg->conf, (0x1 << 2), TRIG_ST_MCH_MASK, received);
 }
 
 int osc_GetPreTriggerCounter(uint32_t *value)
 {
+    simUpdate();
     return cmn_GetValue(&osc_reg->pre_trigger_counter, value, PRE_TRIGGER_COUNTER);
 }
 
@@ -437,11 +456,13 @@ int osc_GetEqFiltersChD(uint32_t* coef_aa, uint32_t* coef_bb, uint32_t* coef_kk,
  */
 int osc_GetWritePointer(uint32_t* pos)
 {
+    simUpdate();
     return cmn_GetValue(&osc_reg->wr_ptr_cur, pos, WRITE_POINTER_MASK);
 }
 
 int osc_GetWritePointerAtTrig(uint32_t* pos)
 {
+    simUpdate();
     return cmn_GetValue(&osc_reg->wr_ptr_trigger, pos, WRITE_POINTER_MASK);
 }
 
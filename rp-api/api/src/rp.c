@@ -22,6 +22,7 @@
 #include "acq_handler.h"
 #include "analog_mixed_signals.h"
 #include "calib.h"
+#include "api_lock.h"
 
 #if defined Z10 || defined Z20 || defined Z20_125 || defined Z20_250_12
 #include "generate.h"
@@ -43,6 +44,7 @@ int rp_Init()
 int rp_InitReset(bool reset)
 {
     cmn_Init();
+    lock_Init();
 
     calib_Init();
     hk_Init(reset);
@@ -50,6 +52,9 @@ int rp_InitReset(bool reset)
 
 #if defined Z10 || defined Z20 || defined Z20_125 || defined Z20_250_12
     generate_Init();
+    lock_Write(LOCK_GEN);
+    gen_Init();
+    lock_Unlock(LOCK_GEN);
 #endif
 
     osc_Init();
@@ -75,11 +80,15 @@ int rp_Release()
 {
     osc_Release();
 #if defined Z10 || defined Z20 || defined Z20_125 || defined Z20_250_12
+    lock_Write(LOCK_GEN);
+    gen_Release();
+    lock_Unlock(LOCK_GEN);
     generate_Release();
 #endif    
     ams_Release();
     hk_Release();
     calib_Release();
+    lock_Release();
     cmn_Release();
     g_api_state = false;
     return RP_OK;
@@ -137,55 +146,58 @@ const char* rp_GetError(int errorCode) {
 
 rp_calib_params_t rp_GetCalibrationSettings()
 {
-    return calib_GetParams();
+    lock_Read(LOCK_CALIB);
+    rp_calib_params_t params = calib_GetParams();
+    lock_Unlock(LOCK_CALIB);
+    return params;
 }
 
 int rp_CalibrateFrontEndOffset(rp_channel_t channel, rp_pinState_t gain, rp_calib_params_t* out_params) {
-    return calib_SetFrontEndOffset(channel, gain, out_params);
+    LOCK_WRITE(LOCK_CALIB, calib_SetFrontEndOffset(channel, gain, out_params));
 }
 
 int rp_CalibrateFrontEndScaleLV(rp_channel_t channel, float referentialVoltage, rp_calib_params_t* out_params) {
-    return calib_SetFrontEndScaleLV(channel, referentialVoltage, out_params);
+    LOCK_WRITE(LOCK_CALIB, calib_SetFrontEndScaleLV(channel, referentialVoltage, out_params));
 }
 
 int rp_CalibrateFrontEndScaleHV(rp_channel_t channel, float referentialVoltage, rp_calib_params_t* out_params) {
-    return calib_SetFrontEndScaleHV(channel, referentialVoltage, out_params);
+    LOCK_WRITE(LOCK_CALIB, calib_SetFrontEndScaleHV(channel, referentialVoltage, out_params));
 }
 
 #if defined Z10 || defined Z20 || defined Z20_125 || defined Z20_250_12
 
 int rp_CalibrateBackEndOffset(rp_channel_t channel) {
-    return calib_SetBackEndOffset(channel);
+    LOCK_WRITE(LOCK_CALIB, calib_SetBackEndOffset(channel));
 }
 
 int rp_CalibrateBackEndScale(rp_channel_t channel) {
-    return calib_SetBackEndScale(channel);
+    LOCK_WRITE(LOCK_CALIB, calib_SetBackEndScale(channel));
 }
 
 int rp_CalibrateBackEnd(rp_channel_t channel, rp_calib_params_t* out_params) {
-    return calib_CalibrateBackEnd(channel, out_params);
+    LOCK_WRITE(LOCK_CALIB, calib_CalibrateBackEnd(channel, out_params));
 }
 
 #endif
 
 int rp_CalibrationReset() {
-    return calib_Reset();
+    LOCK_WRITE(LOCK_CALIB, calib_Reset());
 }
 
 int rp_CalibrationFactoryReset() {
-    return calib_LoadFromFactoryZone();
+    LOCK_WRITE(LOCK_CALIB, calib_LoadFromFactoryZone());
 }
 
 int rp_CalibrationSetCachedParams() {
-    return calib_setCachedParams();
+    LOCK_WRITE(LOCK_CALIB, calib_setCachedParams());
 }
 
 int rp_CalibrationWriteParams(rp_calib_params_t calib_params) {
-    return calib_WriteParams(calib_params,false);
+    LOCK_WRITE(LOCK_CALIB, calib_WriteParams(calib_params,false));
 }
 
 int rp_CalibrationSetParams(rp_calib_params_t calib_params){
-    return calib_SetParams(calib_params);
+    LOCK_WRITE(LOCK_CALIB, calib_SetParams(calib_params));
 }
 
 rp_calib_params_t rp_GetDefaultCalibrationSettings(){
@@ -217,7 +229,9 @@ int rp_IdGetDNA(uint64_t *dna) {
  */
 
 int rp_LEDSetState(uint32_t state) {
+    lock_Write(LOCK_HK);
     iowrite32(state, &hk->led_control);
+    lock_Unlock(LOCK_HK);
     return RP_OK;
 }
 
@@ -231,7 +245,9 @@ int rp_LEDGetState(uint32_t *state) {
  */
 
 int rp_GPIOnSetDirection(uint32_t direction) {
+    lock_Write(LOCK_HK);
     iowrite32(direction, &hk->ex_cd_n);
+    lock_Unlock(LOCK_HK);
     return RP_OK;
 }
 
@@ -241,7 +257,9 @@ int rp_GPIOnGetDirection(uint32_t *direction) {
 }
 
 int rp_GPIOnSetState(uint32_t state) {
+    lock_Write(LOCK_HK);
     iowrite32(state, &hk->ex_co_n);
+    lock_Unlock(LOCK_HK);
     return RP_OK;
 }
 
@@ -251,7 +269,9 @@ int rp_GPIOnGetState(uint32_t *state) {
 }
 
 int rp_GPIOpSetDirection(uint32_t direction) {
+    lock_Write(LOCK_HK);
     iowrite32(direction, &hk->ex_cd_p);
+    lock_Unlock(LOCK_HK);
     return RP_OK;
 }
 
@@ -261,7 +281,9 @@ int rp_GPIOpGetDirection(uint32_t *direction) {
 }
 
 int rp_GPIOpSetState(uint32_t state) {
+    lock_Write(LOCK_HK);
     iowrite32(state, &hk->ex_co_p);
+    lock_Unlock(LOCK_HK);
     return RP_OK;
 }
 
@@ -275,16 +297,18 @@ int rp_GPIOpGetState(uint32_t *state) {
  */
 
 int rp_DpinReset() {
+    lock_Write(LOCK_HK);
     iowrite32(0, &hk->ex_cd_p);
     iowrite32(0, &hk->ex_cd_n);
     iowrite32(0, &hk->ex_co_p);
     iowrite32(0, &hk->ex_co_n);
     iowrite32(0, &hk->led_control);
     iowrite32(0, &hk->digital_loop);
+    lock_Unlock(LOCK_HK);
     return RP_OK;
 }
 
-int rp_DpinSetDirection(rp_dpin_t pin, rp_pinDirection_t direction) {
+static int dpin_SetDirection(rp_dpin_t pin, rp_pinDirection_t direction) {
     uint32_t tmp;
     if (pin < RP_DIO0_P) {
         // LEDS
@@ -304,6 +328,10 @@ int rp_DpinSetDirection(rp_dpin_t pin, rp_pinDirection_t direction) {
     return RP_OK;
 }
 
+int rp_DpinSetDirection(rp_dpin_t pin, rp_pinDirection_t direction) {
+    LOCK_WRITE(LOCK_HK, dpin_SetDirection(pin, direction));
+}
+
 int rp_DpinGetDirection(rp_dpin_t pin, rp_pinDirection_t* direction) {
     if (pin < RP_DIO0_P) {
         // LEDS
@@ -320,7 +348,7 @@ int rp_DpinGetDirection(rp_dpin_t pin, rp_pinDirection_t* direction) {
     return RP_OK;
 }
 
-int rp_DpinSetState(rp_dpin_t pin, rp_pinState_t state) {
+static int dpin_SetState(rp_dpin_t pin, rp_pinState_t state) {
     uint32_t tmp;
     rp_pinDirection_t direction;
     rp_DpinGetDirection(pin, &direction);
@@ -345,6 +373,10 @@ int rp_DpinSetState(rp_dpin_t pin, rp_pinState_t state) {
     return RP_OK;
 }
 
+int rp_DpinSetState(rp_dpin_t pin, rp_pinState_t state) {
+    LOCK_WRITE(LOCK_HK, dpin_SetState(pin, state));
+}
+
 int rp_DpinGetState(rp_dpin_t pin, rp_pinState_t* state) {
     if (pin < RP_DIO0_P) {
         // LEDS
@@ -367,7 +399,9 @@ int rp_DpinGetState(rp_dpin_t pin, rp_pinState_t* state) {
  */
 
 int rp_EnableDigitalLoop(bool enable) {
+    lock_Write(LOCK_HK);
     iowrite32((uint32_t) enable, &hk->digital_loop);
+    lock_Unlock(LOCK_HK);
     return RP_OK;
 }
 
@@ -483,7 +517,9 @@ int rp_AOpinSetValueRaw(int unsigned pin, uint32_t value) {
     if (value > ANALOG_OUT_MAX_VAL_INTEGER) {
         return RP_EOOR;
     }
+    lock_Write(LOCK_HK);
     iowrite32((value & ANALOG_OUT_MASK) << ANALOG_OUT_BITS, &ams->dac[pin]);
+    lock_Unlock(LOCK_HK);
     return RP_OK;
 }
 
@@ -521,7 +557,7 @@ int rp_AOpinGetRange(int unsigned pin, float* min_val,  float* max_val) {
 
 int rp_AcqSetArmKeep(bool enable)
 {
-    return acq_SetArmKeep(enable);
+    LOCK_WRITE(LOCK_ACQ, acq_SetArmKeep(enable));
 }
 
 int rp_AcqGetArmKeep(bool* state){
@@ -534,7 +570,7 @@ int rp_AcqGetBufferFillState(bool* state){
 
 int rp_AcqSetDecimation(rp_acq_decimation_t decimation)
 {
-    return acq_SetDecimation(decimation);
+    LOCK_WRITE(LOCK_ACQ, acq_SetDecimation(decimation));
 }
 
 int rp_AcqGetDecimation(rp_acq_decimation_t* decimation)
@@ -544,7 +580,7 @@ int rp_AcqGetDecimation(rp_acq_decimation_t* decimation)
 
 int rp_AcqSetDecimationFactor(uint32_t decimation)
 {
-    return acq_SetDecimationFactor(decimation);
+    LOCK_WRITE(LOCK_ACQ, acq_SetDecimationFactor(decimation));
 }
 
 int rp_AcqGetDecimationFactor(uint32_t* decimation)
@@ -558,7 +594,7 @@ int rp_AcqConvertFactorToDecimation(uint32_t factor,rp_acq_decimation_t* decimat
 
 int rp_AcqSetSamplingRate(rp_acq_sampling_rate_t sampling_rate)
 {
-    return acq_SetSamplingRate(sampling_rate);
+    LOCK_WRITE(LOCK_ACQ, acq_SetSamplingRate(sampling_rate));
 }
 
 int rp_AcqGetSamplingRate(rp_acq_sampling_rate_t* sampling_rate)
@@ -573,7 +609,7 @@ int rp_AcqGetSamplingRateHz(float* sampling_rate)
 
 int rp_AcqSetAveraging(bool enabled)
 {
-    return acq_SetAveraging(enabled);
+    LOCK_WRITE(LOCK_ACQ, acq_SetAveraging(enabled));
 }
 
 int rp_AcqGetAveraging(bool *enabled)
@@ -583,7 +619,7 @@ int rp_AcqGetAveraging(bool *enabled)
 
 int rp_AcqSetTriggerSrc(rp_acq_trig_src_t source)
 {
-    return acq_SetTriggerSrc(source);
+    LOCK_WRITE(LOCK_ACQ, acq_SetTriggerSrc(source));
 }
 
 int rp_AcqGetTriggerSrc(rp_acq_trig_src_t* source)
@@ -598,7 +634,7 @@ int rp_AcqGetTriggerState(rp_acq_trig_state_t* state)
 
 int rp_AcqSetTriggerDelay(int32_t decimated_data_num)
 {
-    return acq_SetTriggerDelay(decimated_data_num, false);
+    LOCK_WRITE(LOCK_ACQ, acq_SetTriggerDelay(decimated_data_num, false));
 }
 
 int rp_AcqGetTriggerDelay(int32_t* decimated_data_num)
@@ -608,7 +644,7 @@ int rp_AcqGetTriggerDelay(int32_t* decimated_data_num)
 
 int rp_AcqSetTriggerDelayNs(int64_t time_ns)
 {
-    return acq_SetTriggerDelayNs(time_ns, false);
+    LOCK_WRITE(LOCK_ACQ, acq_SetTriggerDelayNs(time_ns, false));
 }
 
 int rp_AcqGetTriggerDelayNs(int64_t* time_ns)
@@ -632,7 +668,7 @@ int rp_AcqGetGainV(rp_channel_t channel, float* voltage)
 
 int rp_AcqSetGain(rp_channel_t channel, rp_pinState_t state)
 {
-    return acq_SetGain(channel, state);
+    LOCK_WRITE(LOCK_ACQ, acq_SetGain(channel, state));
 }
 
 int rp_AcqGetTriggerLevel(rp_channel_trigger_t channel, float* voltage)
@@ -642,7 +678,7 @@ int rp_AcqGetTriggerLevel(rp_channel_trigger_t channel, float* voltage)
 
 int rp_AcqSetTriggerLevel(rp_channel_trigger_t channel, float voltage)
 {
-    return acq_SetTriggerLevel(channel, voltage);
+    LOCK_WRITE(LOCK_ACQ, acq_SetTriggerLevel(channel, voltage));
 }
 
 int rp_AcqGetTriggerHyst(float* voltage)
@@ -652,7 +688,7 @@ int rp_AcqGetTriggerHyst(float* voltage)
 
 int rp_AcqSetTriggerHyst(float voltage)
 {
-    return acq_SetTriggerHyst(voltage);
+    LOCK_WRITE(LOCK_ACQ, acq_SetTriggerHyst(voltage));
 }
 
 int rp_AcqGetWritePointer(uint32_t* pos)
@@ -667,21 +703,21 @@ int rp_AcqGetWritePointerAtTrig(uint32_t* pos)
 
 int rp_AcqStart()
 {
-    return acq_Start();
+    LOCK_WRITE(LOCK_ACQ, acq_Start());
 }
 
 int rp_AcqStop()
 {
-    return acq_Stop();
+    LOCK_WRITE(LOCK_ACQ, acq_Stop());
 }
 int rp_AcqReset()
 {
-    return acq_Reset();
+    LOCK_WRITE(LOCK_ACQ, acq_Reset());
 }
 
 int rp_AcqResetFpga()
 {
-    return acq_ResetFpga();
+    LOCK_WRITE(LOCK_ACQ, acq_ResetFpga());
 }
 
 uint32_t rp_AcqGetNormalizedDataPos(uint32_t pos)
@@ -691,32 +727,32 @@ uint32_t rp_AcqGetNormalizedDataPos(uint32_t pos)
 
 int rp_AcqGetDataPosRaw(rp_channel_t channel, uint32_t start_pos, uint32_t end_pos, int16_t* buffer, uint32_t* buffer_size)
 {
-    return acq_GetDataPosRaw(channel, start_pos, end_pos, buffer, buffer_size);
+    LOCK_READ(LOCK_ACQ, acq_GetDataPosRaw(channel, start_pos, end_pos, buffer, buffer_size));
 }
 
 int rp_AcqGetDataPosV(rp_channel_t channel, uint32_t start_pos, uint32_t end_pos, float* buffer, uint32_t* buffer_size)
 {
-    return acq_GetDataPosV(channel, start_pos, end_pos, buffer, buffer_size);
+    LOCK_READ(LOCK_ACQ, acq_GetDataPosV(channel, start_pos, end_pos, buffer, buffer_size));
 }
 
 int rp_AcqGetDataRaw(rp_channel_t channel,  uint32_t pos, uint32_t* size, int16_t* buffer)
 {    
-    return acq_GetDataRaw(channel, pos, size, buffer);
+    LOCK_READ(LOCK_ACQ, acq_GetDataRaw(channel, pos, size, buffer));
 }
 
 #if defined Z10 || defined Z20_125 || defined Z20 || defined Z20_250_12
 int rp_AcqGetDataRawV2(uint32_t pos, uint32_t* size, uint16_t* buffer, uint16_t* buffer2)
 {
-    return acq_GetDataRawV2(pos, size, buffer, buffer2);
+    LOCK_READ(LOCK_ACQ, acq_GetDataRawV2(pos, size, buffer, buffer2));
 }
 
 int rp_AcqGetDataV2(uint32_t pos, uint32_t* size, float* buffer1, float* buffer2)
 {
-    return acq_GetDataV2(pos, size, buffer1, buffer2);
+    LOCK_READ(LOCK_ACQ, acq_GetDataV2(pos, size, buffer1, buffer2));
 }
 
 int rp_AcqGetDataV2D(uint32_t pos, uint32_t* size, double* buffer1, double* buffer2){
-    return acq_GetDataV2D(pos, size, buffer1, buffer2);
+    LOCK_READ(LOCK_ACQ, acq_GetDataV2D(pos, size, buffer1, buffer2));
 }
 
 #endif
@@ -724,44 +760,44 @@ int rp_AcqGetDataV2D(uint32_t pos, uint32_t* size, double* buffer1, double* buff
 #if defined Z20_125_4CH
 int rp_AcqGetDataRawV2(uint32_t pos, uint32_t* size, uint16_t* buffer, uint16_t* buffer2, uint16_t* buffer3, uint16_t* buffer4)
 {
-    return acq_GetDataRawV2(pos, size, buffer, buffer2, buffer3, buffer4);
+    LOCK_READ(LOCK_ACQ, acq_GetDataRawV2(pos, size, buffer, buffer2, buffer3, buffer4));
 }
 
 int rp_AcqGetDataV2(uint32_t pos, uint32_t* size, float* buffer1, float* buffer2, float* buffer3, float* buffer4)
 {
-    return acq_GetDataV2(pos, size, buffer1, buffer2, buffer3, buffer4);
+    LOCK_READ(LOCK_ACQ, acq_GetDataV2(pos, size, buffer1, buffer2, buffer3, buffer4));
 }
 
 int rp_AcqGetDataV2D(uint32_t pos, uint32_t* size, double* buffer1, double* buffer2, double* buffer3, double* buffer4)
 {
-    return acq_GetDataV2D(pos, size, buffer1, buffer2, buffer3, buffer4);
+    LOCK_READ(LOCK_ACQ, acq_GetDataV2D(pos, size, buffer1, buffer2, buffer3, buffer4));
 }
 
 #endif
 
 int rp_AcqGetOldestDataRaw(rp_channel_t channel, uint32_t* size, int16_t* buffer)
 {
-    return acq_GetOldestDataRaw(channel, size, buffer);
+    LOCK_READ(LOCK_ACQ, acq_GetOldestDataRaw(channel, size, buffer));
 }
 
 int rp_AcqGetLatestDataRaw(rp_channel_t channel, uint32_t* size, int16_t* buffer)
 {
-    return acq_GetLatestDataRaw(channel, size, buffer);
+    LOCK_READ(LOCK_ACQ, acq_GetLatestDataRaw(channel, size, buffer));
 }
 
 int rp_AcqGetDataV(rp_channel_t channel, uint32_t pos, uint32_t* size, float* buffer)
 {
-    return acq_GetDataV(channel, pos, size, buffer);
+    LOCK_READ(LOCK_ACQ, acq_GetDataV(channel, pos, size, buffer));
 }
 
 int rp_AcqGetOldestDataV(rp_channel_t channel, uint32_t* size, float* buffer)
 {
-    return acq_GetOldestDataV(channel, size, buffer);
+    LOCK_READ(LOCK_ACQ, acq_GetOldestDataV(channel, size, buffer));
 }
 
 int rp_AcqGetLatestDataV(rp_channel_t channel, uint32_t* size, float* buffer)
 {
-    return acq_GetLatestDataV(channel, size, buffer);
+    LOCK_READ(LOCK_ACQ, acq_GetLatestDataV(channel, size, buffer));
 }
 
 int rp_AcqGetBufSize(uint32_t *size) {
@@ -770,7 +806,7 @@ int rp_AcqGetBufSize(uint32_t *size) {
 
 #ifdef Z20_250_12
 int rp_AcqSetAC_DC(rp_channel_t channel,rp_acq_ac_dc_mode_t mode){
-    return acq_SetAC_DC(channel,mode);
+    LOCK_WRITE(LOCK_ACQ, acq_SetAC_DC(channel,mode));
 }
 
 int rp_AcqGetAC_DC(rp_channel_t channel,rp_acq_ac_dc_mode_t *status){
@@ -780,11 +816,11 @@ int rp_AcqGetAC_DC(rp_channel_t channel,rp_acq_ac_dc_mode_t *status){
 
 #if defined Z10 || defined Z20_125 || defined Z20_125_4CH
 int rp_AcqUpdateAcqFilter(rp_channel_t channel){
-    return acq_UpdateAcqFilter(channel);
+    LOCK_WRITE(LOCK_ACQ, acq_UpdateAcqFilter(channel));
 }
 
 int rp_AcqGetFilterCalibValue(rp_channel_t channel,uint32_t* coef_aa, uint32_t* coef_bb, uint32_t* coef_kk, uint32_t* coef_pp){
-    return acq_GetFilterCalibValue( channel,coef_aa, coef_bb, coef_kk, coef_pp);
+    LOCK_READ(LOCK_ACQ, acq_GetFilterCalibValue( channel,coef_aa, coef_bb, coef_kk, coef_pp));
 }
 #endif
 
@@ -796,7 +832,7 @@ int rp_AcqGetFilterCalibValue(rp_channel_t channel,uint32_t* coef_aa, uint32_t*
 #if defined Z10 || defined Z20 || defined Z20_125
 
 int rp_GenBurstLastValue(rp_channel_t channel, float amlitude){
-    return gen_setBurstLastValue(channel,amlitude);
+    LOCK_WRITE(LOCK_GEN, gen_setBurstLastValue(channel,amlitude));
 }
 
 int rp_GenGetBurstLastValue(rp_channel_t channel, float *amlitude){
@@ -808,15 +844,15 @@ int rp_GenGetBurstLastValue(rp_channel_t channel, float *amlitude){
 #if defined Z10 || defined Z20 || defined Z20_125 || defined Z20_250_12
 
 int rp_GenReset() {
-    return gen_SetDefaultValues();
+    LOCK_WRITE(LOCK_GEN, gen_SetDefaultValues());
 }
 
 int rp_GenOutDisable(rp_channel_t channel) {
-    return gen_Disable(channel);
+    LOCK_WRITE(LOCK_GEN, gen_Disable(channel));
 }
 
 int rp_GenOutEnable(rp_channel_t channel) {
-    return gen_Enable(channel);
+    LOCK_WRITE(LOCK_GEN, gen_Enable(channel));
 }
 
 int rp_GenOutIsEnabled(rp_channel_t channel, bool *value) {
@@ -824,7 +860,7 @@ int rp_GenOutIsEnabled(rp_channel_t channel, bool *value) {
 }
 
 int rp_GenAmp(rp_channel_t channel, float amplitude) {
-    return gen_setAmplitude(channel, amplitude);
+    LOCK_WRITE(LOCK_GEN, gen_setAmplitude(channel, amplitude));
 }
 
 int rp_GenGetAmp(rp_channel_t channel, float *amplitude) {
@@ -832,7 +868,7 @@ int rp_GenGetAmp(rp_channel_t channel, float *amplitude) {
 }
 
 int rp_GenOffset(rp_channel_t channel, float offset) {
-    return gen_setOffset(channel, offset);
+    LOCK_WRITE(LOCK_GEN, gen_setOffset(channel, offset));
 }
 
 int rp_GenGetOffset(rp_channel_t channel, float *offset) {
@@ -840,11 +876,11 @@ int rp_GenGetOffset(rp_channel_t channel, float *offset) {
 }
 
 int rp_GenFreq(rp_channel_t channel, float frequency) {
-    return gen_setFrequency(channel, frequency);
+    LOCK_WRITE(LOCK_GEN, gen_setFrequency(channel, frequency));
 }
 
 int rp_GenFreqDirect(rp_channel_t channel, float frequency){
-    return gen_setFrequencyDirect(channel, frequency);
+    LOCK_WRITE(LOCK_GEN, gen_setFrequencyDirect(channel, frequency));
 }
 
 int rp_GenGetFreq(rp_channel_t channel, float *frequency) {
@@ -852,7 +888,7 @@ int rp_GenGetFreq(rp_channel_t channel, float *frequency) {
 }
 
 int rp_GenSweepStartFreq(rp_channel_t channel, float frequency){
-    return gen_setSweepStartFrequency(channel,frequency);
+    LOCK_WRITE(LOCK_GEN, gen_setSweepStartFrequency(channel,frequency));
 }
 
 int rp_GenGetSweepStartFreq(rp_channel_t channel, float *frequency){
@@ -860,7 +896,7 @@ int rp_GenGetSweepStartFreq(rp_channel_t channel, float *frequency){
 }
 
 int rp_GenSweepEndFreq(rp_channel_t channel, float frequency){
-    return gen_setSweepEndFrequency(channel,frequency);
+    LOCK_WRITE(LOCK_GEN, gen_setSweepEndFrequency(channel,frequency));
 }
 
 int rp_GenGetSweepEndFreq(rp_channel_t channel, float *frequency){
@@ -868,7 +904,7 @@ int rp_GenGetSweepEndFreq(rp_channel_t channel, float *frequency){
 }
 
 int rp_GenPhase(rp_channel_t channel, float phase) {
-    return gen_setPhase(channel, phase);
+    LOCK_WRITE(LOCK_GEN, gen_setPhase(channel, phase));
 }
 
 int rp_GenGetPhase(rp_channel_t channel, float *phase) {
@@ -876,7 +912,7 @@ int rp_GenGetPhase(rp_channel_t channel, float *phase) {
 }
 
 int rp_GenWaveform(rp_channel_t channel, rp_waveform_t type) {
-    return gen_setWaveform(channel, type);
+    LOCK_WRITE(LOCK_GEN, gen_setWaveform(channel, type));
 }
 
 int rp_GenGetWaveform(rp_channel_t channel, rp_waveform_t *type) {
@@ -884,7 +920,7 @@ int rp_GenGetWaveform(rp_channel_t channel, rp_waveform_t *type) {
 }
 
 int rp_GenSweepMode(rp_channel_t channel, rp_gen_sweep_mode_t mode){
-    return gen_setSweepMode(channel,mode);
+    LOCK_WRITE(LOCK_GEN, gen_setSweepMode(channel,mode));
 }
 
 int rp_GenGetSweepMode(rp_channel_t channel, rp_gen_sweep_mode_t *mode){
@@ -892,31 +928,31 @@ int rp_GenGetSweepMode(rp_channel_t channel, rp_gen_sweep_mode_t *mode){
 }
 
 int rp_GenSweepDir(rp_channel_t channel, rp_gen_sweep_dir_t mode){
-    return gen_setSweepDir(channel,mode);
+    LOCK_WRITE(LOCK_GEN, gen_setSweepDir(channel,mode));
 }
 
 int rp_GenGetSweepDir(rp_channel_t channel, rp_gen_sweep_dir_t *mode){
-    return gen_getSweepDir(channel,mode);    
+    return gen_getSweepDir(channel,mode);
 }
 
 int rp_GenArbWaveform(rp_channel_t channel, float *waveform, uint32_t length) {
-    return gen_setArbWaveform(channel, waveform, length);
+    LOCK_WRITE(LOCK_GEN, gen_setArbWaveform(channel, waveform, length));
 }
 
 int rp_GenGetArbWaveform(rp_channel_t channel, float *waveform, uint32_t *length) {
-    return gen_getArbWaveform(channel, waveform, length);
+    LOCK_READ(LOCK_GEN, gen_getArbWaveform(channel, waveform, length));
 }
 
 int rp_GenDutyCycle(rp_channel_t channel, float ratio) {
-    return gen_setDutyCycle(channel, ratio);
+    LOCK_WRITE(LOCK_GEN, gen_setDutyCycle(channel, ratio));
 }
 
 int rp_GenRiseTime(rp_channel_t channel, float time) {
-    return gen_setRiseTime(channel, time);
+    LOCK_WRITE(LOCK_GEN, gen_setRiseTime(channel, time));
 }
 
 int rp_GenFallTime(rp_channel_t channel, float time) {
-    return gen_setFallTime(channel, time);
+    LOCK_WRITE(LOCK_GEN, gen_setFallTime(channel, time));
 }
 
 int rp_GenGetDutyCycle(rp_channel_t channel, float *ratio) {
@@ -924,7 +960,7 @@ int rp_GenGetDutyCycle(rp_channel_t channel, float *ratio) {
 }
 
 int rp_GenMode(rp_channel_t channel, rp_gen_mode_t mode) {
-    return gen_setGenMode(channel, mode);
+    LOCK_WRITE(LOCK_GEN, gen_setGenMode(channel, mode));
 }
 
 int rp_GenGetMode(rp_channel_t channel, rp_gen_mode_t *mode) {
@@ -932,7 +968,7 @@ int rp_GenGetMode(rp_channel_t channel, rp_gen_mode_t *mode) {
 }
 
 int rp_GenBurstCount(rp_channel_t channel, int num) {
-    return gen_setBurstCount(channel, num);
+    LOCK_WRITE(LOCK_GEN, gen_setBurstCount(channel, num));
 }
 
 int rp_GenGetBurstCount(rp_channel_t channel, int *num) {
@@ -940,7 +976,7 @@ int rp_GenGetBurstCount(rp_channel_t channel, int *num) {
 }
 
 int rp_GenBurstRepetitions(rp_channel_t channel, int repetitions) {
-    return gen_setBurstRepetitions(channel, repetitions);
+    LOCK_WRITE(LOCK_GEN, gen_setBurstRepetitions(channel, repetitions));
 }
 
 int rp_GenGetBurstRepetitions(rp_channel_t channel, int *repetitions) {
@@ -948,7 +984,7 @@ int rp_GenGetBurstRepetitions(rp_channel_t channel, int *repetitions) {
 }
 
 int rp_GenBurstPeriod(rp_channel_t channel, uint32_t period) {
-    return gen_setBurstPeriod(channel, period);
+    LOCK_WRITE(LOCK_GEN, gen_setBurstPeriod(channel, period));
 }
 
 int rp_GenGetBurstPeriod(rp_channel_t channel, uint32_t *period) {
@@ -956,7 +992,7 @@ int rp_GenGetBurstPeriod(rp_channel_t channel, uint32_t *period) {
 }
 
 int rp_GenTriggerSource(rp_channel_t channel, rp_trig_src_t src) {
-    return gen_setTriggerSource(channel, src);
+    LOCK_WRITE(LOCK_GEN, gen_setTriggerSource(channel, src));
 }
 
 int rp_GenGetTriggerSource(rp_channel_t channel, rp_trig_src_t *src) {
@@ -968,19 +1004,19 @@ int rp_GenGetTriggerSource(rp_channel_t channel, rp_trig_src_t *src) {
 // }
 
 int rp_GenTriggerOnly(rp_channel_t channel){
-    return gen_TriggerOnly(channel);
+    LOCK_WRITE(LOCK_GEN, gen_TriggerOnly(channel));
 }
 
 int rp_GenSynchronise() {
-    return gen_TriggerSync();
+    LOCK_WRITE(LOCK_GEN, gen_TriggerSync());
 }
 
 int rp_GenResetTrigger(rp_channel_t channel){
-    return gen_Trigger(channel);
+    LOCK_WRITE(LOCK_GEN, gen_Trigger(channel));
 }
 
 int rp_GenOutEnableSync(bool enable){
-    return gen_EnableSync(enable);
+    LOCK_WRITE(LOCK_GEN, gen_EnableSync(enable));
 }
 
 #endif
@@ -988,7 +1024,7 @@ int rp_GenOutEnableSync(bool enable){
 #ifdef Z20_250_12
 
 int rp_SetEnableTempProtection(rp_channel_t channel, bool enable){
-    return gen_setEnableTempProtection(channel,enable);
+    LOCK_WRITE(LOCK_GEN, gen_setEnableTempProtection(channel,enable));
 }
 
 int rp_GetEnableTempProtection(rp_channel_t channel, bool *enable){
@@ -996,7 +1032,7 @@ int rp_GetEnableTempProtection(rp_channel_t channel, bool *enable){
 }
 
 int rp_SetLatchTempAlarm(rp_channel_t channel, bool status){
-    return gen_setLatchTempAlarm(channel,status);
+    LOCK_WRITE(LOCK_GEN, gen_setLatchTempAlarm(channel,status));
 }
 
 int rp_GetLatchTempAlarm(rp_channel_t channel, bool *status){
@@ -1012,7 +1048,7 @@ int rp_GetPllControlEnable(bool *enable){
 }
 
 int rp_SetPllControlEnable(bool enable){
-    return house_SetPllControlEnable(enable);
+    LOCK_WRITE(LOCK_HK, house_SetPllControlEnable(enable));
 }
 
 int rp_GetPllControlLocked(bool *status){
@@ -1020,7 +1056,7 @@ int rp_GetPllControlLocked(bool *status){
 }
 
 int rp_GenSetGainOut(rp_channel_t channel,rp_gen_gain_t mode){
-    return gen_setGainOut(channel,mode);
+    LOCK_WRITE(LOCK_GEN, gen_setGainOut(channel,mode));
 }
 
 int rp_GenGetGainOut(rp_channel_t channel,rp_gen_gain_t *status){
@@ -0,0 +1,281 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library FPGA simulation backend implementation
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "common.h"
+#include "rp_cross.h"
+#include "sim.h"
+
+#if !defined Z20_125_4CH
+#include "generate.h"
+#endif
+
+#define SIM_MAX_REGIONS 8
+#define SIM_OSC_BLOCKS  2
+
+// Register bits of osc_control_t.conf
+#define CONF_ARM        0x01
+#define CONF_RESET      0x02
+#define CONF_TRIGGERED  0x04
+#define CONF_ARM_KEEP   0x08
+#define CONF_FILLED     0x10
+
+typedef struct sim_region_s {
+    size_t offset;
+    size_t size;
+    void  *mem;
+} sim_region_t;
+
+typedef struct sim_osc_s {
+    bool     armed;
+    bool     triggered;
+    uint64_t last_ns;
+    uint64_t clock;         // ADC clock ticks since simulation start
+    uint64_t pending;       // ADC clock ticks not yet turned into decimated samples
+    uint32_t post_trigger;  // Samples left to write after trigger
+    int32_t  prev_a;
+    int32_t  prev_b;
+} sim_osc_t;
+
+static sim_region_t regions[SIM_MAX_REGIONS];
+static sim_osc_t    osc_state[SIM_OSC_BLOCKS];
+static int32_t      noise_amp = 0;
+static uint32_t     noise_seed = 0x12345678;
+
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void *findRegion(size_t offset) {
+    for (int i = 0; i < SIM_MAX_REGIONS; i++) {
+        if (regions[i].mem && regions[i].offset == offset)
+            return regions[i].mem;
+    }
+    return NULL;
+}
+
+static inline int32_t signExtend(uint32_t value, uint32_t bits) {
+    uint32_t m = 1u << (bits - 1);
+    value &= (1u << bits) - 1;
+    return (int32_t)(value ^ m) - (int32_t)m;
+}
+
+static inline int32_t noise() {
+    if (noise_amp == 0)
+        return 0;
+    // xorshift32
+    noise_seed ^= noise_seed << 13;
+    noise_seed ^= noise_seed >> 17;
+    noise_seed ^= noise_seed << 5;
+    return (int32_t)(noise_seed % (2 * noise_amp + 1)) - noise_amp;
+}
+
+int sim_Init() {
+    const char *n = getenv("RP_SIMULATION_NOISE");
+    noise_amp = n ? abs(atoi(n)) : 0;
+    memset(osc_state, 0, sizeof(osc_state));
+    return RP_OK;
+}
+
+int sim_Release() {
+    for (int i = 0; i < SIM_MAX_REGIONS; i++) {
+        if (regions[i].mem) {
+            munmap(regions[i].mem, regions[i].size);
+            regions[i].mem = NULL;
+        }
+    }
+    return RP_OK;
+}
+
+int sim_Map(size_t size, size_t offset, void** mapped) {
+    // Same FPGA block mapped twice shares memory, like on the board
+    void *mem = findRegion(offset);
+    if (mem) {
+        *mapped = mem;
+        return RP_OK;
+    }
+
+    for (int i = 0; i < SIM_MAX_REGIONS; i++) {
+        if (regions[i].mem == NULL) {
+            mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) {
+                return RP_EMMD;
+            }
+            regions[i].offset = offset;
+            regions[i].size = size;
+            regions[i].mem = mem;
+            *mapped = mem;
+            return RP_OK;
+        }
+    }
+    return RP_EMMD;
+}
+
+int sim_Unmap(size_t size, void** mapped) {
+    for (int i = 0; i < SIM_MAX_REGIONS; i++) {
+        if (regions[i].mem && regions[i].mem == *mapped) {
+            munmap(regions[i].mem, regions[i].size);
+            regions[i].mem = NULL;
+            *mapped = NULL;
+            return RP_OK;
+        }
+    }
+    return RP_EUMD;
+}
+
+/**
+ * Returns the generator output of one channel in ADC counts at the given clock tick.
+ * Bursts and sweeps are not modelled, the generator runs continuously.
+ */
+static int32_t genSample(rp_channel_t channel, uint64_t clock) {
+#if !defined Z20_125_4CH
+    volatile generate_control_t *gen = (volatile generate_control_t *)findRegion(GENERATE_BASE_ADDR);
+    if (!gen)
+        return 0;
+
+    volatile ch_properties_t *prop = channel == RP_CH_1 ? &gen->properties_chA : &gen->properties_chB;
+    bool disabled = channel == RP_CH_1 ? gen->AsetOutputTo0 : gen->BsetOutputTo0;
+    if (disabled)
+        return 0;
+
+    volatile int32_t *data = (volatile int32_t *)((char *)gen + (channel == RP_CH_1 ? CHA_DATA_OFFSET : CHB_DATA_OFFSET));
+    uint64_t wrap = (uint64_t)prop->counterWrap + 1;
+    uint64_t ptr = (prop->startOffset + (uint64_t)prop->counterStep * clock) % wrap;
+    uint32_t idx = (uint32_t)(ptr >> 16) % DAC_BUFFER_SIZE;
+
+    float norm = (float)signExtend(data[idx], DATA_BIT_LENGTH) / (float)(1 << (DATA_BIT_LENGTH - 1));
+    float scale = (float)prop->amplitudeScale / (float)(1 << (DATA_BIT_LENGTH - 1));
+    float offset = (float)signExtend(prop->amplitudeOffset, DATA_BIT_LENGTH) / (float)(1 << (DATA_BIT_LENGTH - 1));
+    return (int32_t)((norm * scale + offset) * (float)(1 << (ADC_BITS - 1)));
+#else
+    (void)(channel);
+    (void)(clock);
+    return 0;
+#endif
+}
+
+static inline int32_t adcSample(int block, rp_channel_t channel, uint64_t clock) {
+    int32_t v = (block == 0 ? genSample(channel, clock) : 0) + noise();
+    const int32_t max = (1 << (ADC_BITS - 1)) - 1;
+    const int32_t min = -(1 << (ADC_BITS - 1));
+    return v > max ? max : (v < min ? min : v);
+}
+
+static bool isTriggered(uint32_t source, int32_t prev_a, int32_t a, int32_t prev_b, int32_t b, int32_t thr_a, int32_t thr_b) {
+    switch (source) {
+        case RP_TRIG_SRC_CHA_PE: return prev_a < thr_a && a >= thr_a;
+        case RP_TRIG_SRC_CHA_NE: return prev_a > thr_a && a <= thr_a;
+        case RP_TRIG_SRC_CHB_PE: return prev_b < thr_b && b >= thr_b;
+        case RP_TRIG_SRC_CHB_NE: return prev_b > thr_b && b <= thr_b;
+        case RP_TRIG_SRC_DISABLED: return false;
+        // Immediate, external and AWG triggers fire right away
+        default: return true;
+    }
+}
+
+void sim_OscUpdate(int block, volatile osc_control_t *osc, volatile uint32_t *buf_a, volatile uint32_t *buf_b) {
+    if (block < 0 || block >= SIM_OSC_BLOCKS || !osc)
+        return;
+
+    sim_osc_t *s = &osc_state[block];
+    uint64_t now = nowNs();
+    if (s->last_ns == 0)
+        s->last_ns = now;
+
+    uint64_t ticks = (uint64_t)((double)(now - s->last_ns) * ADC_SAMPLE_RATE / 1e9);
+    s->last_ns = now;
+
+    if (osc->conf & CONF_RESET) {
+        osc->conf &= ~(CONF_RESET | CONF_TRIGGERED | CONF_FILLED);
+        osc->wr_ptr_cur = 0;
+        osc->wr_ptr_trigger = 0;
+        osc->pre_trigger_counter = 0;
+        s->armed = false;
+        s->triggered = false;
+    }
+
+    if (!(osc->conf & CONF_ARM)) {
+        s->armed = false;
+        s->clock += ticks;
+        return;
+    }
+
+    if (!s->armed) {
+        s->armed = true;
+        s->triggered = false;
+        osc->pre_trigger_counter = 0;
+        osc->conf &= ~(CONF_TRIGGERED | CONF_FILLED);
+    }
+
+    uint32_t dec = osc->data_dec & DATA_DEC_MASK;
+    if (dec == 0) dec = 1;
+    s->pending += ticks;
+    uint64_t samples = s->pending / dec;
+    s->pending %= dec;
+
+    // Anything older than two buffers is overwritten anyway, unless the trigger is still pending
+    uint64_t max_samples = 2 * ADC_BUFFER_SIZE + (uint64_t)osc->trigger_delay;
+    if (samples > max_samples) {
+        s->clock += (samples - max_samples) * dec;
+        samples = max_samples;
+    }
+
+    int32_t thr_a = signExtend(osc->cha_thr, ADC_REG_BITS);
+    int32_t thr_b = signExtend(osc->chb_thr, ADC_REG_BITS);
+    uint32_t wp = osc->wr_ptr_cur & WRITE_POINTER_MASK;
+
+    for (uint64_t i = 0; i < samples; i++, s->clock += dec) {
+        int32_t a = adcSample(block, RP_CH_1, s->clock);
+        int32_t b = adcSample(block, RP_CH_2, s->clock);
+        buf_a[wp] = (uint32_t)a & ADC_REG_BITS_MASK;
+        buf_b[wp] = (uint32_t)b & ADC_REG_BITS_MASK;
+
+        if (!s->triggered) {
+            osc->pre_trigger_counter++;
+            if (isTriggered(osc->trig_source & TRIG_SRC_MASK, s->prev_a, a, s->prev_b, b, thr_a, thr_b)) {
+                s->triggered = true;
+                s->post_trigger = osc->trigger_delay;
+                osc->wr_ptr_trigger = wp;
+                osc->trig_source = RP_TRIG_SRC_DISABLED;
+                osc->conf |= CONF_TRIGGERED;
+            }
+        }
+        s->prev_a = a;
+        s->prev_b = b;
+
+        wp = (wp + 1) % ADC_BUFFER_SIZE;
+
+        if (s->triggered) {
+            if (s->post_trigger > 0) {
+                s->post_trigger--;
+                if (s->post_trigger == 0)
+                    osc->conf |= CONF_FILLED;
+            } else if (!(osc->conf & CONF_ARM_KEEP)) {
+                // Acquisition is complete, the buffer stays frozen until the next arm
+                osc->conf |= CONF_FILLED;
+                osc->conf &= ~CONF_ARM;
+                s->armed = false;
+                s->clock += (samples - i) * dec;
+                break;
+            }
+        }
+    }
+    osc->wr_ptr_cur = wp;
+}
@@ -0,0 +1,43 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library FPGA simulation backend interface
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "oscilloscope.h"
+
+/**
+ * Simulation is enabled by setting the RP_SIMULATION environment variable
+ * before rp_Init. Register maps are then backed by process memory and
+ * the ADC buffers are filled in software with the signal of the generator
+ * (OUT1 -> IN1, OUT2 -> IN2 loopback), following the trigger and write
+ * pointer behaviour of the FPGA. RP_SIMULATION_NOISE adds uniform noise
+ * with the given amplitude in ADC counts.
+ */
+
+int sim_Init();
+int sim_Release();
+
+int sim_Map(size_t size, size_t offset, void** mapped);
+int sim_Unmap(size_t size, void** mapped);
+
+/**
+ * Advances the simulated acquisition of one oscilloscope block up to the current time.
+ * @param block 0 for channels A/B, 1 for channels C/D
+ */
+void sim_OscUpdate(int block, volatile osc_control_t *osc, volatile uint32_t *buf_a, volatile uint32_t *buf_b);
+
+#endif /* SIM_H_ */
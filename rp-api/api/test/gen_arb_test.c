@@ -0,0 +1,60 @@
+/**
+ * @brief Arbitrary waveform length test, runs on the simulation backend
+ *
+ * A second waveform of a different length is loaded while the channel is
+ * already in ARBITRARY mode, the generator must follow the new length.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "rp.h"
+#include "common.h"
+#include "generate.h"
+
+#define CHECK(expr) \
+    if (!(expr)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+        return 1; \
+    }
+
+static float waveform[DAC_BUFFER_SIZE];
+
+static int loadAndCheck(volatile generate_control_t *gen, volatile int32_t *data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        waveform[i] = 0.5;
+    }
+    CHECK(rp_GenArbWaveform(RP_CH_1, waveform, length) == RP_OK);
+    CHECK(gen->properties_chA.counterWrap == 65536 * length - 1);
+    CHECK(data[length - 1] != 0);
+    if (length < DAC_BUFFER_SIZE) {
+        CHECK(data[length] == 0);
+    }
+    uint32_t stored = 0;
+    CHECK(rp_GenGetArbWaveform(RP_CH_1, waveform, &stored) == RP_OK);
+    CHECK(stored == length);
+    return 0;
+}
+
+int main() {
+    setenv("RP_SIMULATION", "1", 1);
+    CHECK(rp_Init() == RP_OK);
+
+    void *mapped = NULL;
+    CHECK(cmn_Map(GENERATE_BASE_SIZE, GENERATE_BASE_ADDR, &mapped) == RP_OK);
+    volatile generate_control_t *gen = (volatile generate_control_t *) mapped;
+    volatile int32_t *data = (volatile int32_t *) ((char *) mapped + CHA_DATA_OFFSET);
+
+    CHECK(rp_GenWaveform(RP_CH_1, RP_WAVEFORM_ARBITRARY) == RP_OK);
+    CHECK(rp_GenPhase(RP_CH_1, 0) == RP_OK);
+    if (loadAndCheck(gen, data, 1000)) return 1;
+    if (loadAndCheck(gen, data, 500)) return 1;
+    if (loadAndCheck(gen, data, DAC_BUFFER_SIZE)) return 1;
+
+    // Leaving ARBITRARY mode restores the full buffer
+    CHECK(rp_GenWaveform(RP_CH_1, RP_WAVEFORM_SINE) == RP_OK);
+    CHECK(gen->properties_chA.counterWrap == 65536 * DAC_BUFFER_SIZE - 1);
+
+    rp_Release();
+    printf("gen_arb_test: OK\n");
+    return 0;
+}
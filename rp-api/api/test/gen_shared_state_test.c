@@ -0,0 +1,63 @@
+/**
+ * @brief Shared generator state test, runs on the simulation backend
+ *
+ * A second process that initializes the library without a reset must see
+ * the generator settings of the first one, and the first one must see the
+ * settings written by the second.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "rp.h"
+
+#define CHECK(expr) \
+    if (!(expr)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+        return 1; \
+    }
+
+#define EQUAL(a, b) (fabs((a) - (b)) < 1e-6)
+
+static int secondProcess() {
+    // Start over like an independent client of the board
+    rp_Release();
+    CHECK(rp_InitReset(false) == RP_OK);
+    float value = 0;
+    CHECK(rp_GenGetAmp(RP_CH_1, &value) == RP_OK && EQUAL(value, 0.3));
+    CHECK(rp_GenGetOffset(RP_CH_1, &value) == RP_OK && EQUAL(value, 0.1));
+    CHECK(rp_GenFreq(RP_CH_1, 2000) == RP_OK);
+    CHECK(rp_GenPhase(RP_CH_1, 45) == RP_OK);
+    CHECK(rp_GenAmp(RP_CH_2, 0.2) == RP_OK);
+    rp_Release();
+    return 0;
+}
+
+int main() {
+    setenv("RP_SIMULATION", "1", 1);
+    CHECK(rp_Init() == RP_OK);
+    CHECK(rp_GenAmp(RP_CH_1, 0.3) == RP_OK);
+    CHECK(rp_GenOffset(RP_CH_1, 0.1) == RP_OK);
+
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        _exit(secondProcess());
+    }
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    float value = 0;
+    // The simulated registers are private to each process, only the settings are shared
+    CHECK(rp_GenGetPhase(RP_CH_1, &value) == RP_OK && EQUAL(value, 45));
+    CHECK(rp_GenGetAmp(RP_CH_2, &value) == RP_OK && EQUAL(value, 0.2));
+    // The other process synthesized from the amplitude of this one and kept it
+    CHECK(rp_GenGetAmp(RP_CH_1, &value) == RP_OK && EQUAL(value, 0.3));
+
+    rp_Release();
+    printf("gen_shared_state_test: OK\n");
+    return 0;
+}
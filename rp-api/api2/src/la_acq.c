@@ -305,6 +305,12 @@ int rp_LaAcqGetRLEStatus(rp_handle_uio_t *handle, uint32_t * current, uint32_t *
     }
 }
 
+int rp_LaAcqGetRLECurrent(rp_handle_uio_t *handle, uint32_t * current) {
+    rp_la_acq_regset_t *regset = (rp_la_acq_regset_t *) handle->regset;
+    *current = ioread32(&regset->sts_cur);
+    return RP_OK;
+}
+
 /** Data buffer pointers */
 /*
 int rp_LaAcqGetDataPointers(rp_handle_uio_t *handle, rp_data_ptrs_regset_t * a_reg) {
@@ -122,6 +122,7 @@ int rp_LaAcqGetPolarity(rp_handle_uio_t *handle, uint32_t * a_reg);
 int rp_LaAcqEnableRLE(rp_handle_uio_t *handle);
 int rp_LaAcqDisableRLE(rp_handle_uio_t *handle);
 int rp_LaAcqGetRLEStatus(rp_handle_uio_t *handle, uint32_t * current, uint32_t * last, bool * buf_ovfl);
+int rp_LaAcqGetRLECurrent(rp_handle_uio_t *handle, uint32_t * current);
 int rp_LaAcqIsRLE(rp_handle_uio_t *handle, bool * state);
 
 uint32_t rp_LaAcqBufLenInSamples(rp_handle_uio_t *handle);
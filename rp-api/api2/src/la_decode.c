@@ -0,0 +1,482 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library Logic analyzer RLE expander and protocol decoders
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LA_NEON
+#endif
+
+#include "common.h"
+#include "la_decode.h"
+
+/** UART/I2C/1-Wire protocol states */
+#define LA_IDLE      0
+#define LA_BITS      1
+#define LA_ADDRESS   2
+#define LA_PRESENCE  3
+
+/** 1-Wire slot timing [us] */
+#define LA_1WIRE_RESET_US    408.0  ///< 480 us minus tolerance
+#define LA_1WIRE_PRESENCE_US 60.0
+#define LA_1WIRE_ONE_US      15.0   ///< shorter low pulses are ones
+
+/**
+ * Index of the first word at or after i whose masked inputs differ from last,
+ * the lengths of the skipped runs are added to time.
+ */
+static uint32_t la_skip(const uint16_t *w, uint32_t i, uint32_t words, uint8_t last, uint8_t mask, uint64_t *time) {
+#ifdef LA_NEON
+    const uint16x8_t vmask = vdupq_n_u16(mask);
+    const uint16x8_t vlast = vdupq_n_u16(last & mask);
+    for (; i + 8 <= words; i += 8) {
+        uint16x8_t v = vld1q_u16(w + i);
+        uint16x8_t eq = vceqq_u16(vandq_u16(v, vmask), vlast);
+        uint64x2_t eq2 = vreinterpretq_u64_u16(eq);
+        if ((vgetq_lane_u64(eq2, 0) & vgetq_lane_u64(eq2, 1)) != UINT64_MAX) {
+            break;
+        }
+        uint32x4_t len = vpaddlq_u16(vshrq_n_u16(v, 8));
+        uint64x2_t len2 = vpaddlq_u32(len);
+        *time += vgetq_lane_u64(len2, 0) + vgetq_lane_u64(len2, 1) + 8;
+    }
+#endif
+    for (; i < words; i++) {
+        if ((w[i] ^ last) & mask) {
+            break;
+        }
+        *time += RP_LA_RLE_LENGTH(w[i]);
+    }
+    return i;
+}
+
+int rp_LaRleSamples(const int16_t *rle, uint32_t words, uint64_t *samples) {
+    const uint16_t *w = (const uint16_t *) rle;
+    uint64_t sum = words;
+    uint32_t i = 0;
+
+    if (rle == NULL || samples == NULL) {
+        return RP_EIPV;
+    }
+#ifdef LA_NEON
+    while (i + 8 <= words) {
+        // every lane grows by at most 2*255 per block, fold before it can wrap
+        uint32_t end = i + 8 * 65536;
+        uint32x4_t acc = vdupq_n_u32(0);
+        if (end > words || end < i) {
+            end = words;
+        }
+        for (; i + 8 <= end; i += 8) {
+            acc = vpadalq_u16(acc, vshrq_n_u16(vld1q_u16(w + i), 8));
+        }
+        uint64x2_t acc2 = vpaddlq_u32(acc);
+        sum += vgetq_lane_u64(acc2, 0) + vgetq_lane_u64(acc2, 1);
+    }
+#endif
+    for (; i < words; i++) {
+        sum += w[i] >> 8;
+    }
+    *samples = sum;
+    return RP_OK;
+}
+
+int rp_LaRleExpand(const int16_t *rle, uint32_t words, uint8_t *out, uint32_t out_len, uint32_t *written) {
+    const uint16_t *w = (const uint16_t *) rle;
+    uint32_t pos = 0;
+    uint32_t i;
+
+    if (rle == NULL || out == NULL) {
+        return RP_EIPV;
+    }
+
+    for (i = 0; i < words && pos < out_len; i++) {
+        uint8_t v = RP_LA_RLE_VALUE(w[i]);
+        uint32_t len = RP_LA_RLE_LENGTH(w[i]);
+        uint32_t room = out_len - pos;
+        uint8_t *p = out + pos;
+
+        if (len > room) {
+            len = room;
+        }
+        pos += len;
+
+        if (room < ((len + 15) & ~15u)) {
+            memset(p, v, len);
+            continue;
+        }
+        // whole 16 byte stores, the overhang is overwritten by the next run
+#ifdef LA_NEON
+        const uint8x16_t fill = vdupq_n_u8(v);
+        for (uint32_t k = 0; k < len; k += 16) {
+            vst1q_u8(p + k, fill);
+        }
+#else
+        const uint64_t fill = v * 0x0101010101010101ull;
+        for (uint32_t k = 0; k < len; k += 16) {
+            memcpy(p + k, &fill, 8);
+            memcpy(p + k + 8, &fill, 8);
+        }
+#endif
+    }
+
+    if (written) {
+        *written = pos;
+    }
+    return i < words ? RP_BTS : RP_OK;
+}
+
+int rp_LaRleEdges(const int16_t *rle, uint32_t words, uint8_t mask, uint64_t *time, uint8_t *last,
+                  rp_la_edge_t *edges, uint32_t max, uint32_t *count, uint32_t *consumed) {
+    const uint16_t *w = (const uint16_t *) rle;
+    uint32_t n = 0;
+    uint32_t i = 0;
+
+    if (rle == NULL || time == NULL || last == NULL || edges == NULL || count == NULL) {
+        return RP_EIPV;
+    }
+
+    if (*time == 0 && words > 0) {
+        *last = RP_LA_RLE_VALUE(w[0]);
+    }
+
+    while (n < max) {
+        i = la_skip(w, i, words, *last, mask, time);
+        if (i == words) {
+            break;
+        }
+        edges[n].sample = *time;
+        edges[n].prev = i > 0 ? RP_LA_RLE_VALUE(w[i - 1]) : *last;
+        edges[n].value = RP_LA_RLE_VALUE(w[i]);
+        *last = edges[n].value;
+        *time += RP_LA_RLE_LENGTH(w[i]);
+        n++;
+        i++;
+    }
+
+    if (i == words && words > 0) {
+        *last = RP_LA_RLE_VALUE(w[words - 1]);
+    }
+    *count = n;
+    if (consumed) {
+        *consumed = i;
+    }
+    return RP_OK;
+}
+
+static void la_emit(rp_la_decoder_t *dec, rp_la_event_type_t type, uint64_t start, uint64_t end,
+                    uint32_t data, uint32_t data2, uint32_t flags) {
+    rp_la_event_t ev;
+    ev.start = start;
+    ev.end = end;
+    ev.type = type;
+    ev.data = data;
+    ev.data2 = data2;
+    ev.flags = flags;
+    dec->cb(&ev, dec->ctx);
+}
+
+/** UART */
+
+static inline uint32_t la_uart_level(const rp_la_decoder_t *dec, uint8_t value) {
+    return ((value >> dec->cfg.uart.rx) & 1) ^ (dec->cfg.uart.invert ? 1 : 0);
+}
+
+/** Samples every pending bit before sample until, the line held level since the last edge */
+static void la_uart_advance(rp_la_decoder_t *dec, uint64_t until) {
+    const rp_la_uart_cfg_t *cfg = &dec->cfg.uart;
+    const uint32_t level = la_uart_level(dec, dec->last);
+    const uint32_t data_end = cfg->data_bits + (cfg->parity ? 1 : 0);
+
+    while (dec->state == LA_BITS && dec->next < (double) until) {
+        uint32_t k = dec->bit++;
+
+        if (k == 0) {
+            // start bit must still be low in its middle
+            if (level) {
+                dec->state = LA_IDLE;
+            }
+        } else if (k <= cfg->data_bits) {
+            dec->data |= level << (k - 1);
+        } else if (k <= data_end) {
+            uint32_t ones = __builtin_popcount(dec->data) + level;
+            if ((cfg->parity == 1) != (ones & 1)) {
+                dec->flags |= RP_LA_EV_PARITY_ERR;
+            }
+        } else {
+            if (!level) {
+                dec->flags |= RP_LA_EV_FRAMING_ERR;
+            }
+            if (k == data_end + cfg->stop_bits) {
+                la_emit(dec, RP_LA_EV_DATA, dec->start, (uint64_t) dec->next, dec->data, 0, dec->flags);
+                dec->state = LA_IDLE;
+            }
+        }
+        dec->next += cfg->samples_per_bit;
+    }
+}
+
+static void la_uart_edge(rp_la_decoder_t *dec, uint64_t t, uint8_t value) {
+    la_uart_advance(dec, t);
+    if (dec->state == LA_IDLE && la_uart_level(dec, dec->last) && !la_uart_level(dec, value)) {
+        dec->state = LA_BITS;
+        dec->start = t;
+        dec->bit = 0;
+        dec->data = 0;
+        dec->flags = 0;
+        dec->next = t + dec->cfg.uart.samples_per_bit / 2;
+    }
+}
+
+/** SPI */
+
+static void la_spi_edge(rp_la_decoder_t *dec, uint64_t t, uint8_t value) {
+    const rp_la_spi_cfg_t *cfg = &dec->cfg.spi;
+    const uint8_t prev = dec->last;
+
+    if (cfg->use_cs) {
+        bool was = ((prev >> cfg->cs) & 1) == cfg->cs_active_high;
+        bool is = ((value >> cfg->cs) & 1) == cfg->cs_active_high;
+        if (was != is) {
+            // a partial word is dropped when the slave is deselected
+            dec->bit = 0;
+            dec->data = 0;
+            dec->data2 = 0;
+        }
+        if (!is) {
+            return;
+        }
+    }
+
+    uint32_t clk_prev = (prev >> cfg->clk) & 1;
+    uint32_t clk = (value >> cfg->clk) & 1;
+    if (clk == clk_prev) {
+        return;
+    }
+
+    bool leading = clk != cfg->cpol;
+    if (leading != (cfg->cpha == 0)) {
+        return;
+    }
+
+    // data lines are stable across the sampling edge, take them from before it
+    uint32_t mosi = (prev >> cfg->mosi) & 1;
+    uint32_t miso = (prev >> cfg->miso) & 1;
+    if (dec->bit == 0) {
+        dec->start = t;
+    }
+    if (cfg->lsb_first) {
+        dec->data |= mosi << dec->bit;
+        dec->data2 |= miso << dec->bit;
+    } else {
+        dec->data = (dec->data << 1) | mosi;
+        dec->data2 = (dec->data2 << 1) | miso;
+    }
+    if (++dec->bit == cfg->bits) {
+        la_emit(dec, RP_LA_EV_DATA, dec->start, t, dec->data, dec->data2, 0);
+        dec->bit = 0;
+        dec->data = 0;
+        dec->data2 = 0;
+    }
+}
+
+/** I2C */
+
+static void la_i2c_edge(rp_la_decoder_t *dec, uint64_t t, uint8_t value) {
+    const rp_la_i2c_cfg_t *cfg = &dec->cfg.i2c;
+    uint32_t scl_prev = (dec->last >> cfg->scl) & 1;
+    uint32_t scl = (value >> cfg->scl) & 1;
+    uint32_t sda_prev = (dec->last >> cfg->sda) & 1;
+    uint32_t sda = (value >> cfg->sda) & 1;
+
+    if (scl_prev && scl) {
+        if (sda_prev && !sda) {
+            la_emit(dec, RP_LA_EV_START, t, t, 0, 0, 0);
+            dec->state = LA_ADDRESS;
+            dec->bit = 0;
+            dec->data = 0;
+        } else if (!sda_prev && sda) {
+            la_emit(dec, RP_LA_EV_STOP, t, t, 0, 0, 0);
+            dec->state = LA_IDLE;
+        }
+        return;
+    }
+
+    if (scl_prev || !scl || dec->state == LA_IDLE) {
+        return;
+    }
+
+    // SCL rising edge: 8 data bits MSB first, then the acknowledge
+    if (dec->bit < 8) {
+        if (dec->bit == 0) {
+            dec->start = t;
+            dec->data = 0;
+        }
+        dec->data = (dec->data << 1) | sda;
+        dec->bit++;
+        return;
+    }
+
+    uint32_t flags = sda ? RP_LA_EV_NACK : 0;
+    if (dec->state == LA_ADDRESS) {
+        flags |= RP_LA_EV_ADDRESS;
+    }
+    la_emit(dec, RP_LA_EV_DATA, dec->start, t, dec->data, 0, flags);
+    dec->state = LA_BITS;
+    dec->bit = 0;
+}
+
+/** 1-Wire */
+
+static void la_1wire_edge(rp_la_decoder_t *dec, uint64_t t, uint8_t value) {
+    uint32_t line = (value >> dec->cfg.onewire.line) & 1;
+
+    if (!line) {
+        dec->low = t;
+        return;
+    }
+
+    uint64_t low = t - dec->low;
+    if (low >= dec->limits[0]) {
+        la_emit(dec, RP_LA_EV_RESET, dec->low, t, 0, 0, 0);
+        dec->state = LA_PRESENCE;
+        dec->bit = 0;
+        dec->data = 0;
+        return;
+    }
+    if (dec->state == LA_PRESENCE && low >= dec->limits[1]) {
+        la_emit(dec, RP_LA_EV_PRESENCE, dec->low, t, 0, 0, 0);
+        dec->state = LA_BITS;
+        return;
+    }
+
+    // write and read slots, LSB first
+    dec->state = LA_BITS;
+    if (dec->bit == 0) {
+        dec->start = dec->low;
+    }
+    dec->data |= (uint32_t)(low < dec->limits[2]) << dec->bit;
+    if (++dec->bit == 8) {
+        la_emit(dec, RP_LA_EV_DATA, dec->start, t, dec->data, 0, 0);
+        dec->bit = 0;
+        dec->data = 0;
+    }
+}
+
+int rp_LaDecoderInit(rp_la_decoder_t *dec, rp_la_protocol_t protocol, const void *cfg, rp_la_event_cb_t cb, void *ctx) {
+    if (dec == NULL || cfg == NULL || cb == NULL) {
+        return RP_EIPV;
+    }
+
+    memset(dec, 0, sizeof(*dec));
+    dec->protocol = protocol;
+    dec->cb = cb;
+    dec->ctx = ctx;
+
+    switch (protocol) {
+        case RP_LA_UART: {
+            const rp_la_uart_cfg_t *c = (const rp_la_uart_cfg_t *) cfg;
+            if (c->rx > 7 || c->samples_per_bit < 1.0 || c->data_bits < 5 || c->data_bits > 9 ||
+                c->parity > 2 || c->stop_bits < 1 || c->stop_bits > 2) {
+                return RP_EIPV;
+            }
+            dec->cfg.uart = *c;
+            dec->mask = 1 << c->rx;
+            break;
+        }
+        case RP_LA_SPI: {
+            const rp_la_spi_cfg_t *c = (const rp_la_spi_cfg_t *) cfg;
+            if (c->clk > 7 || c->mosi > 7 || c->miso > 7 || (c->use_cs && c->cs > 7) ||
+                c->cpol > 1 || c->cpha > 1 || c->bits < 1 || c->bits > 32) {
+                return RP_EIPV;
+            }
+            dec->cfg.spi = *c;
+            dec->mask = (1 << c->clk) | (c->use_cs ? 1 << c->cs : 0);
+            break;
+        }
+        case RP_LA_I2C: {
+            const rp_la_i2c_cfg_t *c = (const rp_la_i2c_cfg_t *) cfg;
+            if (c->scl > 7 || c->sda > 7 || c->scl == c->sda) {
+                return RP_EIPV;
+            }
+            dec->cfg.i2c = *c;
+            dec->mask = (1 << c->scl) | (1 << c->sda);
+            break;
+        }
+        case RP_LA_1WIRE: {
+            const rp_la_1wire_cfg_t *c = (const rp_la_1wire_cfg_t *) cfg;
+            if (c->line > 7 || c->sample_rate <= 0) {
+                return RP_EIPV;
+            }
+            dec->cfg.onewire = *c;
+            dec->mask = 1 << c->line;
+            dec->limits[0] = LA_1WIRE_RESET_US * 1e-6 * c->sample_rate;
+            dec->limits[1] = LA_1WIRE_PRESENCE_US * 1e-6 * c->sample_rate;
+            dec->limits[2] = LA_1WIRE_ONE_US * 1e-6 * c->sample_rate;
+            break;
+        }
+        default:
+            return RP_EIPV;
+    }
+    return RP_OK;
+}
+
+int rp_LaDecoderFeed(rp_la_decoder_t *dec, const int16_t *rle, uint32_t words) {
+    const uint16_t *w = (const uint16_t *) rle;
+    uint32_t i = 0;
+
+    if (dec == NULL || rle == NULL) {
+        return RP_EIPV;
+    }
+    if (words == 0) {
+        return RP_OK;
+    }
+
+    if (!dec->started) {
+        dec->last = RP_LA_RLE_VALUE(w[0]);
+        dec->started = true;
+    }
+
+    // runs which only change inputs outside the mask (SPI data lines) are
+    // skipped, last is reloaded from the preceding word so they are not lost
+    for (;;) {
+        i = la_skip(w, i, words, dec->last, dec->mask, &dec->time);
+        if (i == words) {
+            break;
+        }
+
+        uint8_t value = RP_LA_RLE_VALUE(w[i]);
+        if (i > 0) {
+            dec->last = RP_LA_RLE_VALUE(w[i - 1]);
+        }
+        switch (dec->protocol) {
+            case RP_LA_UART:  la_uart_edge(dec, dec->time, value);  break;
+            case RP_LA_SPI:   la_spi_edge(dec, dec->time, value);   break;
+            case RP_LA_I2C:   la_i2c_edge(dec, dec->time, value);   break;
+            case RP_LA_1WIRE: la_1wire_edge(dec, dec->time, value); break;
+        }
+        dec->last = value;
+        dec->time += RP_LA_RLE_LENGTH(w[i]);
+        i++;
+    }
+    dec->last = RP_LA_RLE_VALUE(w[words - 1]);
+
+    // bits sampled before the end of this block do not wait for the next edge
+    if (dec->protocol == RP_LA_UART) {
+        la_uart_advance(dec, dec->time);
+    }
+    return RP_OK;
+}
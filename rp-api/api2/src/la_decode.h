@@ -0,0 +1,148 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library Logic analyzer RLE expander and protocol decoders
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+// With RLE enabled (rp_LaAcqEnableRLE) every 16 bit word of the acquisition
+// buffer holds one run: [15:8] run length - 1, [7:0] sampled inputs.
+// The decoders below work on the runs directly, their cost depends on the
+// number of transitions on the decoded lines and not on the number of samples.
+
+#ifndef __LA_DECODE_H
+#define __LA_DECODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "common.h"
+
+#define RP_LA_RLE_VALUE(w)  ((uint8_t)(w))
+#define RP_LA_RLE_LENGTH(w) ((uint32_t)(((uint16_t)(w)) >> 8) + 1)
+
+/** Transition of the selected inputs */
+typedef struct {
+    uint64_t sample;  ///< sample index of the first sample with the new value
+    uint8_t  value;   ///< inputs after the transition
+    uint8_t  prev;    ///< inputs before the transition
+} rp_la_edge_t;
+
+typedef enum {
+    RP_LA_UART  = 0,
+    RP_LA_SPI   = 1,
+    RP_LA_I2C   = 2,
+    RP_LA_1WIRE = 3
+} rp_la_protocol_t;
+
+typedef enum {
+    RP_LA_EV_DATA     = 0,  ///< one word, see data, data2 and flags
+    RP_LA_EV_START    = 1,  ///< I2C start or repeated start
+    RP_LA_EV_STOP     = 2,  ///< I2C stop
+    RP_LA_EV_RESET    = 3,  ///< 1-Wire reset pulse
+    RP_LA_EV_PRESENCE = 4   ///< 1-Wire presence pulse
+} rp_la_event_type_t;
+
+/** event flags */
+#define RP_LA_EV_FRAMING_ERR (1<<0) ///< UART stop bit was low
+#define RP_LA_EV_PARITY_ERR  (1<<1) ///< UART parity mismatch
+#define RP_LA_EV_ADDRESS     (1<<2) ///< I2C address byte (R/W in bit 0)
+#define RP_LA_EV_NACK        (1<<3) ///< I2C byte was not acknowledged
+
+typedef struct {
+    uint64_t           start;  ///< first sample of the event
+    uint64_t           end;    ///< last sample of the event
+    rp_la_event_type_t type;
+    uint32_t           data;   ///< UART/I2C/1-Wire byte, SPI MOSI word
+    uint32_t           data2;  ///< SPI MISO word
+    uint32_t           flags;
+} rp_la_event_t;
+
+typedef void (*rp_la_event_cb_t)(const rp_la_event_t *event, void *ctx);
+
+/** input numbers are bit positions [0-7] in the sampled value */
+typedef struct {
+    uint8_t  rx;
+    double   samples_per_bit;  ///< sample rate / baud rate
+    uint8_t  data_bits;        ///< 5 - 9
+    uint8_t  parity;           ///< 0 - none, 1 - odd, 2 - even
+    uint8_t  stop_bits;        ///< 1 - 2
+    bool     invert;
+} rp_la_uart_cfg_t;
+
+typedef struct {
+    uint8_t  clk;
+    uint8_t  mosi;
+    uint8_t  miso;
+    uint8_t  cs;
+    bool     use_cs;
+    bool     cs_active_high;
+    uint8_t  cpol;
+    uint8_t  cpha;
+    uint8_t  bits;             ///< 1 - 32
+    bool     lsb_first;
+} rp_la_spi_cfg_t;
+
+typedef struct {
+    uint8_t  scl;
+    uint8_t  sda;
+} rp_la_i2c_cfg_t;
+
+typedef struct {
+    uint8_t  line;
+    double   sample_rate;      ///< [Hz], used for the slot timing
+} rp_la_1wire_cfg_t;
+
+/** Streaming decoder, feed it consecutive RLE blocks of one capture */
+typedef struct {
+    rp_la_protocol_t protocol;
+    union {
+        rp_la_uart_cfg_t  uart;
+        rp_la_spi_cfg_t   spi;
+        rp_la_i2c_cfg_t   i2c;
+        rp_la_1wire_cfg_t onewire;
+    } cfg;
+    uint8_t          mask;     ///< inputs whose transitions drive the protocol
+    uint8_t          last;     ///< inputs of the run before the current one
+    bool             started;
+    uint64_t         time;     ///< sample index after the last fed run
+    // protocol state
+    uint32_t         state;
+    uint32_t         bit;
+    uint32_t         data;
+    uint32_t         data2;
+    uint32_t         flags;
+    uint64_t         start;    ///< first sample of the current word
+    uint64_t         low;      ///< 1-Wire: start of the current low pulse
+    double           next;     ///< UART: next bit sampling point
+    uint64_t         limits[3];///< 1-Wire: reset, presence and one-bit pulse lengths in samples
+    rp_la_event_cb_t cb;
+    void            *ctx;
+} rp_la_decoder_t;
+
+/** Total number of samples in words runs */
+int rp_LaRleSamples(const int16_t *rle, uint32_t words, uint64_t *samples);
+
+/** Expands runs to one byte per sample, returns RP_BTS when out_len was too short */
+int rp_LaRleExpand(const int16_t *rle, uint32_t words, uint8_t *out, uint32_t out_len, uint32_t *written);
+
+/**
+ * Collects transitions of the inputs in mask without expanding the runs.
+ * time and last carry the position and the inputs between calls, last is
+ * set from the first run when time is 0. Stops when max edges were found,
+ * consumed tells how many words were processed.
+ */
+int rp_LaRleEdges(const int16_t *rle, uint32_t words, uint8_t mask, uint64_t *time, uint8_t *last,
+                  rp_la_edge_t *edges, uint32_t max, uint32_t *count, uint32_t *consumed);
+
+int rp_LaDecoderInit(rp_la_decoder_t *dec, rp_la_protocol_t protocol, const void *cfg, rp_la_event_cb_t cb, void *ctx);
+int rp_LaDecoderFeed(rp_la_decoder_t *dec, const int16_t *rle, uint32_t words);
+
+#endif // __LA_DECODE_H
@@ -0,0 +1,395 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library Logic analyzer continuous RLE streaming
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "common.h"
+#include "la_acq.h"
+#include "la_stream.h"
+
+#include "rp_dma.h"
+
+/** Pack IDs and layout of the ADC streaming server (streaming_manager net_lib) */
+static const uint8_t c_id_pack[16]     = {0xFF,0xFF,0xFF,0xFF,0xA0,0xA0,0xA0,0xA0,0xFF,0xFF,0xFF,0xFF,0xA0,0xA0,0xA0,0xA0};
+static const uint8_t c_id_pack_end[16] = {0xFF,0xFF,0xFF,0xFF,0x50,0x50,0x50,0x50,0xFF,0xFF,0xFF,0xFF,0x50,0x50,0x50,0x50};
+static const uint8_t c_id_buffer[16]   = {0xFF,0xFF,0xFF,0xFF,0x0A,0x0A,0x0A,0x0A,0xFF,0xFF,0xFF,0xFF,0x0A,0x0A,0x0A,0x0A};
+
+#define LA_PACK_BEGIN_LEN  (16 + 5 * sizeof(uint64_t))
+#define LA_PACK_BUFFER_LEN (16 + 9 * sizeof(uint64_t))
+#define LA_PACK_END_LEN    (16 + 2 * sizeof(uint64_t))
+
+#define LA_CHANNEL_CH1     0
+#define LA_ADC_MODE_1_1    1
+#define LA_WORD_BITS       16
+
+typedef struct {
+    int16_t  *data;
+    uint32_t  words;
+    uint64_t  lost_fpga;
+    uint64_t  lost_internal;
+} la_block_t;
+
+static struct {
+    rp_handle_uio_t *handle;
+    int              fd;
+    bool             running;
+    bool             stop;
+    double           rate;
+    rp_dma_ring_t    dma;
+    uint32_t         seg_words;
+    la_block_t      *ring;
+    uint32_t         ring_len;
+    uint32_t         head;       ///< next block the reader fills
+    uint32_t         tail;       ///< next block the writer sends
+    uint32_t         used;
+    bool             reader_done;
+    pthread_t        reader;
+    pthread_t        writer;
+    pthread_mutex_t  lock;
+    pthread_cond_t   cond;
+    rp_la_stream_stats_t stats;
+} la_stream = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+/** Returns the block the reader fills next, or NULL when the ring is full and the words are counted as lost */
+static la_block_t *la_stream_reserve(uint32_t words, uint64_t *lost_internal) {
+    la_block_t *b = NULL;
+    pthread_mutex_lock(&la_stream.lock);
+    if (la_stream.used == la_stream.ring_len) {
+        *lost_internal += words;
+        la_stream.stats.lost_internal += words;
+    } else {
+        b = &la_stream.ring[la_stream.head];
+    }
+    pthread_mutex_unlock(&la_stream.lock);
+    return b;
+}
+
+/** Hands a filled block to the writer together with the samples lost before it */
+static void la_stream_commit(la_block_t *b, uint32_t words, uint64_t *lost_fpga, uint64_t *lost_internal) {
+    b->words = words;
+    b->lost_fpga = *lost_fpga;
+    b->lost_internal = *lost_internal;
+    *lost_fpga = 0;
+    *lost_internal = 0;
+
+    pthread_mutex_lock(&la_stream.lock);
+    la_stream.head = (la_stream.head + 1) % la_stream.ring_len;
+    la_stream.used++;
+    pthread_cond_broadcast(&la_stream.cond);
+    pthread_mutex_unlock(&la_stream.lock);
+}
+
+/** Queues words from a DMA segment, or counts them as lost when the ring is full */
+static void la_stream_push(const int16_t *src, uint32_t words, uint64_t *lost_fpga, uint64_t *lost_internal) {
+    la_block_t *b = la_stream_reserve(words, lost_internal);
+    if (!b) {
+        return;
+    }
+    if (words) {
+        memcpy(b->data, src, words * sizeof(int16_t));
+    }
+    la_stream_commit(b, words, lost_fpga, lost_internal);
+}
+
+static void *la_stream_reader(void *arg) {
+    (void) arg;
+    uint64_t lost_fpga = 0, lost_internal = 0;
+    uint64_t overruns, reported = 0;
+    uint32_t base, cur, seg;
+    int err = 0;
+
+    rp_LaAcqGetRLECurrent(la_stream.handle, &base);
+    rp_DmaRingReset(&la_stream.dma);
+    rp_LaAcqRunAcq(la_stream.handle);
+
+    for (;;) {
+        bool stop;
+        pthread_mutex_lock(&la_stream.lock);
+        stop = la_stream.stop;
+        pthread_mutex_unlock(&la_stream.lock);
+
+        // after a stop only the segments which are complete already are read
+        if (rp_DmaRingWait(la_stream.handle, &la_stream.dma, stop ? 0 : RP_LA_STREAM_WAIT_MS, &seg, &overruns) != RP_OK) {
+            err = EIO;
+            break;
+        }
+
+        // the DMA refilled segments which were not read yet
+        if (overruns > reported) {
+            uint64_t skip = (overruns - reported) * la_stream.seg_words;
+            lost_fpga += skip;
+            pthread_mutex_lock(&la_stream.lock);
+            la_stream.stats.lost_fpga += skip;
+            pthread_mutex_unlock(&la_stream.lock);
+            reported = overruns;
+        }
+
+        if (seg != RP_DMA_NO_SGMNT) {
+            uint32_t words = la_stream.seg_words;
+            la_block_t *b = la_stream_reserve(words, &lost_internal);
+            if (!b) {
+                rp_DmaRingRelease(&la_stream.dma);
+                continue;
+            }
+            memcpy(b->data, RP_DMA_SGMNT(&la_stream.dma, seg), words * sizeof(int16_t));
+
+            // the DMA may have wrapped onto the segment during the copy, torn data is not sent
+            bool intact;
+            if (rp_DmaRingReleaseCopy(la_stream.handle, &la_stream.dma, &intact, &overruns) != RP_OK) {
+                err = EIO;
+                break;
+            }
+            if (!intact) {
+                lost_internal += words;
+                pthread_mutex_lock(&la_stream.lock);
+                la_stream.stats.lost_internal += words;
+                pthread_mutex_unlock(&la_stream.lock);
+                reported++;
+                continue;
+            }
+            la_stream_commit(b, words, &lost_fpga, &lost_internal);
+            continue;
+        }
+        if (stop) {
+            break;
+        }
+    }
+
+    rp_LaAcqStopAcq(la_stream.handle);
+
+    // the partially filled segment after the last completed one, the write counter wraps
+    rp_LaAcqGetRLECurrent(la_stream.handle, &cur);
+    uint32_t tail = (cur - base) - (uint32_t) (la_stream.dma.completed * la_stream.seg_words);
+    if (err || tail >= la_stream.seg_words) {
+        tail = 0;
+    }
+    if (tail || lost_fpga || lost_internal) {
+        uint32_t seg_tail = la_stream.dma.completed % la_stream.dma.sgmnt_cnt;
+        la_stream_push((const int16_t *) RP_DMA_SGMNT(&la_stream.dma, seg_tail), tail, &lost_fpga, &lost_internal);
+    }
+
+    pthread_mutex_lock(&la_stream.lock);
+    if (err) {
+        la_stream.stats.error = err;
+    }
+    la_stream.reader_done = true;
+    pthread_cond_broadcast(&la_stream.cond);
+    pthread_mutex_unlock(&la_stream.lock);
+    return NULL;
+}
+
+/** Writes all iovecs, continues after partial writes */
+static int la_stream_writev(int fd, struct iovec *iov, int cnt) {
+    while (cnt > 0) {
+        ssize_t n = writev(fd, iov, cnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        while (cnt > 0 && (size_t) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (uint8_t *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+static void *la_stream_writer(void *arg) {
+    (void) arg;
+    uint64_t id = 0;
+    uint64_t begin[LA_PACK_BEGIN_LEN / 8];
+    uint64_t buffer[LA_PACK_BUFFER_LEN / 8];
+    uint64_t end[LA_PACK_END_LEN / 8];
+
+    memcpy(begin, c_id_pack, 16);
+    memcpy(buffer, c_id_buffer, 16);
+    memcpy(end, c_id_pack_end, 16);
+
+    for (;;) {
+        pthread_mutex_lock(&la_stream.lock);
+        while (la_stream.used == 0 && !la_stream.reader_done) {
+            pthread_cond_wait(&la_stream.cond, &la_stream.lock);
+        }
+        if (la_stream.used == 0) {
+            pthread_mutex_unlock(&la_stream.lock);
+            break;
+        }
+        la_block_t *b = &la_stream.ring[la_stream.tail];
+        pthread_mutex_unlock(&la_stream.lock);
+
+        uint64_t bytes = b->words * sizeof(int16_t);
+
+        begin[2] = LA_PACK_BEGIN_LEN;
+        begin[3] = id;
+        begin[4] = (uint64_t) la_stream.rate;
+        begin[5] = LA_WORD_BITS;
+        begin[6] = bytes;
+
+        buffer[2] = LA_PACK_BUFFER_LEN + bytes;
+        buffer[3] = id;
+        buffer[4] = 0;
+        buffer[5] = LA_CHANNEL_CH1;
+        buffer[6] = LA_ADC_MODE_1_1;
+        buffer[7] = LA_WORD_BITS;
+        buffer[8] = bytes;
+        buffer[9] = b->lost_fpga;
+        buffer[10] = b->lost_internal;
+
+        end[2] = LA_PACK_END_LEN;
+        end[3] = id;
+
+        struct iovec iov[4] = {
+            { begin, LA_PACK_BEGIN_LEN },
+            { buffer, LA_PACK_BUFFER_LEN },
+            { b->data, bytes },
+            { end, LA_PACK_END_LEN }
+        };
+        int err = la_stream_writev(la_stream.fd, iov, 4);
+
+        pthread_mutex_lock(&la_stream.lock);
+        la_stream.tail = (la_stream.tail + 1) % la_stream.ring_len;
+        la_stream.used--;
+        if (err) {
+            // keep draining so the reader accounts everything as lost
+            la_stream.stats.error = err;
+            la_stream.stats.lost_internal += b->words;
+        } else {
+            la_stream.stats.blocks++;
+            la_stream.stats.words += b->words;
+            la_stream.stats.bytes += LA_PACK_BEGIN_LEN + LA_PACK_BUFFER_LEN + bytes + LA_PACK_END_LEN;
+        }
+        pthread_cond_broadcast(&la_stream.cond);
+        pthread_mutex_unlock(&la_stream.lock);
+        id++;
+    }
+    return NULL;
+}
+
+static void la_stream_free(void) {
+    if (la_stream.ring) {
+        for (uint32_t i = 0; i < la_stream.ring_len; i++) {
+            free(la_stream.ring[i].data);
+        }
+        free(la_stream.ring);
+        la_stream.ring = NULL;
+    }
+    rp_DmaRingClose(la_stream.handle, &la_stream.dma);
+}
+
+int rp_LaStreamStart(rp_handle_uio_t *handle, int fd, const rp_la_stream_cfg_t *cfg) {
+    if (handle == NULL || cfg == NULL || fd < 0 || cfg->decimation < 1 || la_stream.running) {
+        return RP_EIPV;
+    }
+
+    memset(&la_stream.stats, 0, sizeof(la_stream.stats));
+    la_stream.handle = handle;
+    la_stream.fd = fd;
+    la_stream.stop = false;
+    la_stream.reader_done = false;
+    la_stream.rate = 125e6 / cfg->decimation;
+    la_stream.ring_len = cfg->ring_blocks ? cfg->ring_blocks : RP_LA_STREAM_RING_BLOCKS;
+    la_stream.head = la_stream.tail = la_stream.used = 0;
+
+    // continuous RLE acquisition, started by the reader once it has the counter base
+    rp_LaAcqStopAcq(handle);
+    rp_LaAcqReset(handle);
+
+    // RLE words come at a data dependent rate, missed completions are found from the write counter
+    int status = rp_DmaRingOpen(handle, &la_stream.dma, RP_SGMNT_CNT, handle->dma_size / RP_SGMNT_CNT, 0);
+    if (status != RP_OK) {
+        return status;
+    }
+    rp_DmaRingSetPosition(handle, &la_stream.dma, rp_LaAcqGetRLECurrent, sizeof(int16_t));
+    la_stream.seg_words = la_stream.dma.sgmnt_size / sizeof(int16_t);
+
+    la_stream.ring = (la_block_t *) calloc(la_stream.ring_len, sizeof(la_block_t));
+    if (la_stream.ring == NULL) {
+        la_stream_free();
+        return RP_EOOR;
+    }
+    for (uint32_t i = 0; i < la_stream.ring_len; i++) {
+        la_stream.ring[i].data = (int16_t *) malloc(la_stream.seg_words * sizeof(int16_t));
+        if (la_stream.ring[i].data == NULL) {
+            la_stream_free();
+            return RP_EOOR;
+        }
+    }
+
+    rp_la_decimation_regset_t dec = { .dec = cfg->decimation - 1 };
+    rp_LaAcqSetDecimation(handle, dec);
+    rp_LaAcqEnableRLE(handle);
+    rp_LaAcqGlobalTrigSet(handle, RP_TRG_ALL_MASK);
+    rp_LaAcqSetConfig(handle, RP_LA_ACQ_CFG_CONT_MASK | RP_LA_ACQ_CFG_AUTO_MASK);
+
+    if (pthread_create(&la_stream.writer, NULL, la_stream_writer, NULL) != 0) {
+        la_stream_free();
+        return RP_EOOR;
+    }
+    if (pthread_create(&la_stream.reader, NULL, la_stream_reader, NULL) != 0) {
+        pthread_mutex_lock(&la_stream.lock);
+        la_stream.reader_done = true;
+        pthread_cond_broadcast(&la_stream.cond);
+        pthread_mutex_unlock(&la_stream.lock);
+        pthread_join(la_stream.writer, NULL);
+        la_stream_free();
+        return RP_EOOR;
+    }
+
+    la_stream.running = true;
+    return RP_OK;
+}
+
+int rp_LaStreamStop(rp_handle_uio_t *handle) {
+    if (!la_stream.running || handle != la_stream.handle) {
+        return RP_EIPV;
+    }
+
+    pthread_mutex_lock(&la_stream.lock);
+    la_stream.stop = true;
+    pthread_mutex_unlock(&la_stream.lock);
+
+    pthread_join(la_stream.reader, NULL);
+    pthread_join(la_stream.writer, NULL);
+    rp_LaAcqSetConfig(handle, 0);
+    la_stream_free();
+    la_stream.running = false;
+    return RP_OK;
+}
+
+int rp_LaStreamGetStats(rp_la_stream_stats_t *stats) {
+    if (stats == NULL) {
+        return RP_EIPV;
+    }
+    pthread_mutex_lock(&la_stream.lock);
+    *stats = la_stream.stats;
+    pthread_mutex_unlock(&la_stream.lock);
+    return RP_OK;
+}
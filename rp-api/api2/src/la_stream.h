@@ -0,0 +1,62 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library Logic analyzer continuous RLE streaming
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+// The acquisition runs in continuous RLE mode while the DMA cycles through its
+// RX segments. Every filled segment is copied into a ring of blocks and a writer
+// thread sends the blocks to a file or socket descriptor framed like the ADC
+// streaming server packs (begin pack, one CH1 buffer pack, end pack), so the
+// same clients and converters can read them. Buffer packs carry 16 bit RLE
+// words, see la_decode.h.
+//
+// Lost data is counted in RLE words and reported in the buffer pack that
+// follows the gap: FPGA when the DMA overwrote a segment before it was read,
+// RP_INTERNAL_BUFFER when the ring was full because the writer is too slow.
+
+#ifndef __LA_STREAM_H
+#define __LA_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "common.h"
+
+#define RP_LA_STREAM_RING_BLOCKS 16      ///< default ring size in DMA segments
+#define RP_LA_STREAM_WAIT_MS     100     ///< longest wait for a DMA segment, bounds the stop latency
+
+typedef struct {
+    uint32_t decimation;   ///< sample rate = 125 MS/s / decimation
+    uint32_t ring_blocks;  ///< 0 - RP_LA_STREAM_RING_BLOCKS
+} rp_la_stream_cfg_t;
+
+typedef struct {
+    uint64_t blocks;         ///< blocks written
+    uint64_t words;          ///< RLE words written
+    uint64_t bytes;          ///< bytes written including the framing
+    uint64_t lost_fpga;      ///< RLE words overwritten in the DMA buffer
+    uint64_t lost_internal;  ///< RLE words dropped because the ring was full
+    int      error;          ///< errno of the failed write, 0 while streaming works
+} rp_la_stream_stats_t;
+
+/**
+ * Starts a continuous RLE capture which is written to fd until rp_LaStreamStop().
+ * handle must be opened with rp_LaAcqOpen(), fd stays owned by the caller.
+ */
+int rp_LaStreamStart(rp_handle_uio_t *handle, int fd, const rp_la_stream_cfg_t *cfg);
+
+/** Stops the capture, writes the partially filled segment and joins the threads */
+int rp_LaStreamStop(rp_handle_uio_t *handle);
+
+int rp_LaStreamGetStats(rp_la_stream_stats_t *stats);
+
+#endif // __LA_STREAM_H
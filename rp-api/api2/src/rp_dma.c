@@ -1,5 +1,9 @@
 
+#define _DEFAULT_SOURCE
+
 #include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
@@ -17,9 +21,6 @@
 #include "rp_dma.h"
 
 
-#define RP_SGMNT_CNT 8 // 240/RP_SGMNT_CNT must be int
-#define RP_SGMNT_SIZE (256*1024)
-
 int rp_DmaOpen(const char *dev, rp_handle_uio_t *handle) {
     // make a copy of the device path
     handle->dma_dev = (char*) malloc((strlen(dev)+1) * sizeof(char));
@@ -31,10 +32,7 @@ int rp_DmaOpen(const char *dev, rp_handle_uio_t *handle) {
         return -1;
     }
     // TODO: check for max. memory size..
-    handle->dma_size=RP_SGMNT_CNT*RP_SGMNT_SIZE;
-    rp_SetSgmntC(handle,RP_SGMNT_CNT);
-    rp_SetSgmntS(handle,RP_SGMNT_SIZE);
-    return RP_OK;
+    return rp_DmaSetGeometry(handle, RP_SGMNT_CNT, RP_SGMNT_SIZE);
 }
 
 int rp_DmaCtrl(rp_handle_uio_t *handle, RP_DMA_CTRL ctrl) {
@@ -62,7 +60,8 @@ int rp_SetSgmntS(rp_handle_uio_t *handle, unsigned long no) {
 }
 
 int rp_DmaRead(rp_handle_uio_t *handle) {
-    int s = read(handle->dma_fd, NULL, 1);
+    char buf;
+    int s = read(handle->dma_fd, &buf, 1);
     if (s<0) {
       printf("read error\n");
       return -1;
@@ -79,3 +78,174 @@ int rp_DmaClose(rp_handle_uio_t *handle) {
     free(handle->dma_dev);
     return RP_OK;
 }
+
+int rp_DmaSetGeometry(rp_handle_uio_t *handle, uint32_t sgmnt_cnt, uint32_t sgmnt_size) {
+    long page = sysconf(_SC_PAGESIZE);
+    if (sgmnt_cnt < 2 || sgmnt_size == 0 || sgmnt_size > RP_SGMNT_SIZE_MAX || sgmnt_size % page
+        || (uint64_t) sgmnt_cnt * sgmnt_size > RP_DMA_SIZE_MAX) {
+        return RP_EOOR;
+    }
+    rp_SetSgmntC(handle, sgmnt_cnt);
+    rp_SetSgmntS(handle, sgmnt_size);
+    handle->dma_size = (size_t) sgmnt_cnt * sgmnt_size;
+    return RP_OK;
+}
+
+static double rp_DmaNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int rp_DmaRingOpen(rp_handle_uio_t *handle, rp_dma_ring_t *ring, uint32_t sgmnt_cnt, uint32_t sgmnt_size, double byte_rate) {
+    int status = rp_DmaSetGeometry(handle, sgmnt_cnt, sgmnt_size);
+    if (status != RP_OK) {
+        return status;
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->mem = (uint8_t *) mmap(NULL, handle->dma_size, PROT_READ | PROT_WRITE, MAP_SHARED, handle->dma_fd, 0);
+    if (ring->mem == MAP_FAILED) {
+        ring->mem = NULL;
+        return RP_EMMD;
+    }
+    ring->sgmnt_cnt = sgmnt_cnt;
+    ring->sgmnt_size = sgmnt_size;
+    ring->sgmnt_period = byte_rate > 0 ? sgmnt_size / byte_rate : 0;
+    return RP_OK;
+}
+
+int rp_DmaRingClose(rp_handle_uio_t *handle, rp_dma_ring_t *ring) {
+    if (ring->mem) {
+        if (munmap(ring->mem, (size_t) ring->sgmnt_cnt * ring->sgmnt_size) == -1) {
+            return RP_EUMD;
+        }
+        ring->mem = NULL;
+    }
+    (void) handle;
+    return RP_OK;
+}
+
+int rp_DmaRingSetPosition(rp_handle_uio_t *handle, rp_dma_ring_t *ring, rp_dma_pos_t pos, uint32_t unit_bytes) {
+    if (pos != NULL && unit_bytes == 0) {
+        return RP_EIPV;
+    }
+    ring->pos = pos;
+    ring->pos_handle = handle;
+    ring->pos_unit = unit_bytes;
+    return RP_OK;
+}
+
+int rp_DmaRingReset(rp_dma_ring_t *ring) {
+    ring->reads = 0;
+    ring->completed = 0;
+    ring->released = 0;
+    ring->overruns = 0;
+    ring->pos_bytes = 0;
+    if (ring->pos) {
+        ring->pos(ring->pos_handle, &ring->pos_last);
+    }
+    ring->start = rp_DmaNow();
+    return RP_OK;
+}
+
+int rp_DmaRingStart(rp_handle_uio_t *handle, rp_dma_ring_t *ring) {
+    rp_DmaRingReset(ring);
+    return rp_DmaCtrl(handle, RP_DMA_CYCLIC);
+}
+
+int rp_DmaRingStop(rp_handle_uio_t *handle, rp_dma_ring_t *ring) {
+    (void) ring;
+    return rp_DmaCtrl(handle, RP_DMA_STOP_RX);
+}
+
+/** Waits up to timeout_ms for a completion, then reads every completion the driver has queued */
+static int rp_DmaRingDrain(rp_handle_uio_t *handle, rp_dma_ring_t *ring, int timeout_ms) {
+    struct pollfd pfd = { .fd = handle->dma_fd, .events = POLLIN };
+    int ready = poll(&pfd, 1, timeout_ms);
+    while (ready > 0) {
+        if (rp_DmaRead(handle) != RP_OK) {
+            return RP_EOOR;
+        }
+        ring->reads++;
+        ready = poll(&pfd, 1, 0);
+    }
+    return ready < 0 ? RP_EOOR : RP_OK;
+}
+
+/** Counts completed segments and drops the ones the DMA is overwriting */
+static void rp_DmaRingUpdate(rp_dma_ring_t *ring) {
+    uint64_t done = ring->reads;
+
+    if (ring->pos) {
+        uint32_t cur;
+        if (ring->pos(ring->pos_handle, &cur) == RP_OK) {
+            ring->pos_bytes += (uint64_t) (uint32_t) (cur - ring->pos_last) * ring->pos_unit;
+            ring->pos_last = cur;
+        }
+        if (ring->pos_bytes / ring->sgmnt_size > done) {
+            done = ring->pos_bytes / ring->sgmnt_size;
+        }
+    } else if (ring->sgmnt_period > 0) {
+        // one segment of slack for the start latency and clock jitter
+        double expected = (rp_DmaNow() - ring->start) / ring->sgmnt_period - 1;
+        if (expected > done) {
+            done = (uint64_t) expected;
+        }
+    }
+    if (done > ring->completed) {
+        ring->completed = done;
+    }
+
+    // the DMA is writing the segment after the last completed one
+    uint64_t held = ring->completed - ring->released;
+    if (held > ring->sgmnt_cnt - 1) {
+        uint64_t lost = held - (ring->sgmnt_cnt - 1);
+        ring->released += lost;
+        ring->overruns += lost;
+    }
+}
+
+int rp_DmaRingWait(rp_handle_uio_t *handle, rp_dma_ring_t *ring, int timeout_ms, uint32_t *segment, uint64_t *overruns) {
+    // completions are consumed on every call, also while the caller holds segments
+    if (rp_DmaRingDrain(handle, ring, 0) != RP_OK) {
+        return RP_EOOR;
+    }
+    rp_DmaRingUpdate(ring);
+
+    if (ring->completed == ring->released) {
+        if (rp_DmaRingDrain(handle, ring, timeout_ms) != RP_OK) {
+            return RP_EOOR;
+        }
+        rp_DmaRingUpdate(ring);
+    }
+    *segment = ring->completed == ring->released ? RP_DMA_NO_SGMNT : ring->released % ring->sgmnt_cnt;
+    *overruns = ring->overruns;
+    return RP_OK;
+}
+
+int rp_DmaRingRelease(rp_dma_ring_t *ring) {
+    if (ring->released == ring->completed) {
+        return RP_EOOR;
+    }
+    ring->released++;
+    return RP_OK;
+}
+
+int rp_DmaRingReleaseCopy(rp_handle_uio_t *handle, rp_dma_ring_t *ring, bool *intact, uint64_t *overruns) {
+    uint64_t copied = ring->released;
+    if (copied == ring->completed) {
+        return RP_EOOR;
+    }
+    if (rp_DmaRingDrain(handle, ring, 0) != RP_OK) {
+        return RP_EOOR;
+    }
+    rp_DmaRingUpdate(ring);
+
+    // an overrun drops the oldest segments first, the copied one included
+    *intact = ring->released == copied;
+    if (*intact) {
+        ring->released++;
+    }
+    *overruns = ring->overruns;
+    return RP_OK;
+}
@@ -18,6 +18,15 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define RP_SGMNT_CNT 8 // 240/RP_SGMNT_CNT must be int
+#define RP_SGMNT_SIZE (256*1024)
+
+// limits of the reserved RX memory, see rpdma.h
+#define RP_SGMNT_SIZE_MAX 0x400000
+#define RP_DMA_SIZE_MAX   0x2000000
+
+#define RP_DMA_NO_SGMNT   UINT32_MAX   ///< rp_DmaRingWait() timed out
+
 typedef enum {
     RP_DMA_SINGLE,
     RP_DMA_CYCLIC,
@@ -31,4 +40,70 @@ int rp_SetSgmntS(rp_handle_uio_t *handle, unsigned long no);
 int rp_DmaRead(rp_handle_uio_t *handle);
 int rp_DmaClose(rp_handle_uio_t *handle);
 
+/** Sets segment count and size [bytes] of the cyclic RX buffer, updates handle->dma_size */
+int rp_DmaSetGeometry(rp_handle_uio_t *handle, uint32_t sgmnt_cnt, uint32_t sgmnt_size);
+
+/** Reads the free running write counter of the DMA source, e.g. rp_LaAcqGetRLECurrent() */
+typedef int (*rp_dma_pos_t)(rp_handle_uio_t *handle, uint32_t *pos);
+
+/**
+ * Mapped cyclic RX buffer. The driver read() returns once per completed
+ * segment, the ring turns that into segment indexes. Segments between
+ * released and completed belong to the caller until rp_DmaRingRelease().
+ * A segment is counted as overrun when the DMA wraps onto it before it was
+ * released. The driver has no completion counter, so completions it did not
+ * report are found from the write counter of the source when one is set with
+ * rp_DmaRingSetPosition(), otherwise estimated from the time since the start
+ * when sgmnt_period is set.
+ */
+typedef struct {
+    uint8_t  *mem;
+    uint32_t  sgmnt_cnt;
+    uint32_t  sgmnt_size;
+    double    sgmnt_period;  ///< [s] time to fill one segment, 0 disables the time estimate
+    rp_dma_pos_t      pos;   ///< write counter of the source, NULL - none
+    rp_handle_uio_t  *pos_handle;
+    uint32_t  pos_unit;      ///< bytes per counter step
+    uint32_t  pos_last;      ///< counter at the last update
+    uint64_t  pos_bytes;     ///< bytes written since the start
+    uint64_t  reads;         ///< completions reported by the driver
+    uint64_t  completed;     ///< segments filled by the DMA
+    uint64_t  released;      ///< segments handed back or dropped
+    uint64_t  overruns;      ///< segments lost
+    double    start;         ///< [s] time of rp_DmaRingReset()
+} rp_dma_ring_t;
+
+#define RP_DMA_SGMNT(ring, i) ((ring)->mem + (size_t)(i) * (ring)->sgmnt_size)
+
+/** Sets the geometry and maps the whole buffer, byte_rate of the source enables gap detection (0 - off) */
+int rp_DmaRingOpen(rp_handle_uio_t *handle, rp_dma_ring_t *ring, uint32_t sgmnt_cnt, uint32_t sgmnt_size, double byte_rate);
+int rp_DmaRingClose(rp_handle_uio_t *handle, rp_dma_ring_t *ring);
+
+/** Uses the write counter of the source to count completed segments, unit_bytes per counter step */
+int rp_DmaRingSetPosition(rp_handle_uio_t *handle, rp_dma_ring_t *ring, rp_dma_pos_t pos, uint32_t unit_bytes);
+
+/** Clears the counters, use when cyclic RX is started elsewhere (rp_LaAcqRunAcq) */
+int rp_DmaRingReset(rp_dma_ring_t *ring);
+/** Clears the counters and starts cyclic RX */
+int rp_DmaRingStart(rp_handle_uio_t *handle, rp_dma_ring_t *ring);
+int rp_DmaRingStop(rp_handle_uio_t *handle, rp_dma_ring_t *ring);
+
+/**
+ * Returns the oldest ready segment, waits up to timeout_ms (-1 forever) when
+ * the caller has none. segment is RP_DMA_NO_SGMNT on timeout, overruns is the
+ * total number of lost segments. handle->dma_fd can also be added to an
+ * epoll set, call this when it is readable.
+ */
+int rp_DmaRingWait(rp_handle_uio_t *handle, rp_dma_ring_t *ring, int timeout_ms, uint32_t *segment, uint64_t *overruns);
+
+/** Gives the oldest ready segment back to the DMA */
+int rp_DmaRingRelease(rp_dma_ring_t *ring);
+
+/**
+ * Gives the oldest ready segment back after the caller copied it out. The
+ * completions are counted first, intact is false when the DMA wrapped onto
+ * the segment during the copy; it is then counted in overruns already.
+ */
+int rp_DmaRingReleaseCopy(rp_handle_uio_t *handle, rp_dma_ring_t *ring, bool *intact, uint64_t *overruns);
+
 #endif // _RP_DMA_H_
@@ -0,0 +1,342 @@
+/**
+ * Replays RLE logic analyzer captures through the expander and the protocol
+ * decoders and reports their throughput.
+ *
+ * Without -f synthetic UART, SPI, I2C and 1-Wire captures are generated, the
+ * decoded words are checked against the generated ones. With -f a raw dump of
+ * the RLE acquisition buffer (16 bit words) is replayed through the decoder
+ * chosen with -p.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "rp2.h"
+#include "la_decode.h"
+
+#define SAMPLE_RATE 125e6
+#define WORDS       2000
+
+typedef struct {
+    int16_t *buf;
+    uint32_t n;
+    uint32_t cap;
+    uint8_t  cur;
+    uint64_t pending;
+    double   time;     ///< exact time, runs are rounded to whole samples
+    uint64_t emitted;
+} capture_t;
+
+typedef struct {
+    uint32_t events;
+    uint32_t words;
+    uint32_t errors;
+    const uint32_t *expected;
+    uint32_t expected_len;
+} check_t;
+
+static void cap_flush(capture_t *c) {
+    while (c->pending > 0) {
+        uint32_t len = c->pending > 256 ? 256 : c->pending;
+        if (c->n == c->cap) {
+            c->cap = c->cap ? c->cap * 2 : 4096;
+            c->buf = realloc(c->buf, c->cap * sizeof(int16_t));
+        }
+        c->buf[c->n++] = (int16_t)(((len - 1) << 8) | c->cur);
+        c->pending -= len;
+    }
+}
+
+/** Holds value for duration samples, fractional durations are carried over */
+static void cap_add(capture_t *c, uint8_t value, double duration) {
+    c->time += duration;
+    uint64_t end = (uint64_t)(c->time + 0.5);
+    uint64_t len = end - c->emitted;
+    c->emitted = end;
+    if (len == 0) {
+        return;
+    }
+    if (value != c->cur) {
+        cap_flush(c);
+        c->cur = value;
+    }
+    c->pending += len;
+}
+
+static void cap_done(capture_t *c) {
+    cap_flush(c);
+}
+
+static void gen_uart(capture_t *c, const rp_la_uart_cfg_t *cfg, uint32_t *data, uint32_t n) {
+    const uint8_t idle = 1 << cfg->rx;
+    cap_add(c, idle, 100);
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t parity = 0;
+        cap_add(c, 0, cfg->samples_per_bit);
+        for (uint32_t b = 0; b < cfg->data_bits; b++) {
+            uint32_t bit = (data[i] >> b) & 1;
+            parity ^= bit;
+            cap_add(c, bit ? idle : 0, cfg->samples_per_bit);
+        }
+        cap_add(c, idle, cfg->samples_per_bit * cfg->stop_bits + (rand() % 4) * cfg->samples_per_bit);
+    }
+    cap_done(c);
+}
+
+static void gen_spi(capture_t *c, const rp_la_spi_cfg_t *cfg, uint32_t *mosi, uint32_t *miso, uint32_t n) {
+    const double half = 4;
+    const uint8_t cs_idle = 1 << cfg->cs;
+    cap_add(c, cs_idle, 100);
+    for (uint32_t i = 0; i < n; i += 4) {
+        // 4 words per chip select
+        cap_add(c, 0, half);
+        for (uint32_t k = i; k < i + 4 && k < n; k++) {
+            for (int b = cfg->bits - 1; b >= 0; b--) {
+                uint8_t v = (((mosi[k] >> b) & 1) << cfg->mosi) | (((miso[k] >> b) & 1) << cfg->miso);
+                cap_add(c, v, half);
+                cap_add(c, v | (1 << cfg->clk), half);
+            }
+        }
+        cap_add(c, 0, half);
+        cap_add(c, cs_idle, 20);
+    }
+    cap_done(c);
+}
+
+static void gen_i2c(capture_t *c, const rp_la_i2c_cfg_t *cfg, uint32_t *data, uint32_t n) {
+    const double half = 50;
+    const uint8_t scl = 1 << cfg->scl, sda = 1 << cfg->sda;
+    cap_add(c, scl | sda, 200);
+    for (uint32_t i = 0; i < n; i += 5) {
+        cap_add(c, scl, half);           // start
+        for (uint32_t k = i; k < i + 5 && k < n; k++) {
+            for (int b = 8; b >= 0; b--) {
+                // the 9th bit is the acknowledge, always given
+                uint8_t d = (b > 0 && ((data[k] >> (b - 1)) & 1)) ? sda : 0;
+                cap_add(c, d, half);
+                cap_add(c, d | scl, half);
+                cap_add(c, d, half / 2);
+            }
+        }
+        cap_add(c, 0, half);
+        cap_add(c, scl, half);
+        cap_add(c, scl | sda, 200);      // stop
+    }
+    cap_done(c);
+}
+
+static void gen_1wire(capture_t *c, const rp_la_1wire_cfg_t *cfg, uint32_t *data, uint32_t n) {
+    const double us = cfg->sample_rate * 1e-6;
+    const uint8_t high = 1 << cfg->line;
+    cap_add(c, high, 100 * us);
+    for (uint32_t i = 0; i < n; i += 8) {
+        cap_add(c, 0, 480 * us);          // reset
+        cap_add(c, high, 70 * us);
+        cap_add(c, 0, 120 * us);          // presence
+        cap_add(c, high, 290 * us);
+        for (uint32_t k = i; k < i + 8 && k < n; k++) {
+            for (int b = 0; b < 8; b++) {
+                double low = ((data[k] >> b) & 1) ? 6 : 60;
+                cap_add(c, 0, low * us);
+                cap_add(c, high, (70 - low) * us);
+            }
+        }
+    }
+    cap_done(c);
+}
+
+static void on_event(const rp_la_event_t *ev, void *ctx) {
+    check_t *chk = (check_t *) ctx;
+    chk->events++;
+    if (ev->type != RP_LA_EV_DATA) {
+        return;
+    }
+    if (chk->expected) {
+        uint32_t got = ev->data;
+        if (chk->words >= chk->expected_len || got != chk->expected[chk->words]) {
+            chk->errors++;
+        }
+    }
+    if (ev->flags & (RP_LA_EV_FRAMING_ERR | RP_LA_EV_PARITY_ERR | RP_LA_EV_NACK)) {
+        chk->errors++;
+    }
+    chk->words++;
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/** Decodes the capture repeats times in blocks of block words */
+static int replay(const char *name, rp_la_protocol_t protocol, const void *cfg, const capture_t *c,
+                  const uint32_t *expected, uint32_t expected_len, int repeats) {
+    rp_la_decoder_t dec;
+    check_t chk;
+    uint64_t samples;
+    const uint32_t block = 4096;
+    double t0, t;
+
+    rp_LaRleSamples(c->buf, c->n, &samples);
+
+    t0 = now();
+    for (int r = 0; r < repeats; r++) {
+        memset(&chk, 0, sizeof(chk));
+        chk.expected = expected;
+        chk.expected_len = expected_len;
+        if (rp_LaDecoderInit(&dec, protocol, cfg, on_event, &chk) != RP_OK) {
+            fprintf(stderr, "%s: invalid decoder settings\n", name);
+            return -1;
+        }
+        for (uint32_t i = 0; i < c->n; i += block) {
+            rp_LaDecoderFeed(&dec, c->buf + i, c->n - i < block ? c->n - i : block);
+        }
+    }
+    t = (now() - t0) / repeats;
+
+    printf("%-8s %9u words %11llu samples %6u words decoded %8.1f Mwords/s %9.1f MS/s",
+           name, c->n, (unsigned long long) samples, chk.words, c->n / t * 1e-6, samples / t * 1e-6);
+    if (expected) {
+        bool ok = chk.errors == 0 && chk.words == expected_len;
+        printf("  %s\n", ok ? "ok" : "MISMATCH");
+        return ok ? 0 : -1;
+    }
+    printf("\n");
+    return 0;
+}
+
+static void bench_expand(const capture_t *c, int repeats) {
+    uint64_t samples;
+    uint32_t written;
+    rp_la_edge_t edges[256];
+    double t0, t;
+
+    rp_LaRleSamples(c->buf, c->n, &samples);
+    uint8_t *out = malloc(samples);
+
+    t0 = now();
+    for (int r = 0; r < repeats; r++) {
+        rp_LaRleSamples(c->buf, c->n, &samples);
+    }
+    t = (now() - t0) / repeats;
+    printf("samples  %9u words %8.1f Mwords/s\n", c->n, c->n / t * 1e-6);
+
+    t0 = now();
+    for (int r = 0; r < repeats; r++) {
+        rp_LaRleExpand(c->buf, c->n, out, samples, &written);
+    }
+    t = (now() - t0) / repeats;
+    printf("expand   %9u words %11llu samples %8.1f MS/s\n", c->n, (unsigned long long) written, written / t * 1e-6);
+
+    t0 = now();
+    for (int r = 0; r < repeats; r++) {
+        uint64_t time = 0;
+        uint8_t last = 0;
+        uint32_t count, consumed, pos = 0;
+        while (pos < c->n) {
+            rp_LaRleEdges(c->buf + pos, c->n - pos, 0x01, &time, &last, edges, 256, &count, &consumed);
+            pos += consumed;
+        }
+    }
+    t = (now() - t0) / repeats;
+    printf("edges    %9u words %8.1f Mwords/s\n", c->n, c->n / t * 1e-6);
+
+    free(out);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [-n repeats] [-f capture -p uart|spi|i2c|1wire [-r sample rate] [-b baud]]\n"
+            "  capture is a raw dump of the RLE buffer. Inputs: UART rx=0; SPI clk=0 mosi=1\n"
+            "  miso=2 cs=3 (active low, mode 0, 8 bit MSB first); I2C scl=0 sda=1; 1-Wire line=0.\n",
+            name);
+}
+
+int main(int argc, char **argv) {
+    rp_la_uart_cfg_t uart = { .rx = 0, .samples_per_bit = SAMPLE_RATE / 115200, .data_bits = 8, .parity = 0, .stop_bits = 1 };
+    rp_la_spi_cfg_t spi = { .clk = 0, .mosi = 1, .miso = 2, .cs = 3, .use_cs = true, .bits = 8 };
+    rp_la_i2c_cfg_t i2c = { .scl = 0, .sda = 1 };
+    rp_la_1wire_cfg_t onewire = { .line = 0, .sample_rate = SAMPLE_RATE / 64 };
+    const char *file = NULL, *proto = "uart";
+    double rate = SAMPLE_RATE, baud = 115200;
+    int repeats = 10;
+    int opt, ret = 0;
+
+    while ((opt = getopt(argc, argv, "n:f:p:r:b:h")) != -1) {
+        switch (opt) {
+            case 'n': repeats = atoi(optarg); break;
+            case 'f': file = optarg; break;
+            case 'p': proto = optarg; break;
+            case 'r': rate = atof(optarg); break;
+            case 'b': baud = atof(optarg); break;
+            default: usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (repeats < 1) {
+        repeats = 1;
+    }
+
+    if (file) {
+        capture_t c = { 0 };
+        FILE *f = fopen(file, "rb");
+        if (f == NULL) {
+            perror(file);
+            return EXIT_FAILURE;
+        }
+        fseek(f, 0, SEEK_END);
+        c.n = ftell(f) / sizeof(int16_t);
+        fseek(f, 0, SEEK_SET);
+        c.buf = malloc(c.n * sizeof(int16_t));
+        if (fread(c.buf, sizeof(int16_t), c.n, f) != c.n) {
+            fprintf(stderr, "%s: short read\n", file);
+            fclose(f);
+            return EXIT_FAILURE;
+        }
+        fclose(f);
+
+        uart.samples_per_bit = rate / baud;
+        onewire.sample_rate = rate;
+        bench_expand(&c, repeats);
+        if (!strcmp(proto, "uart"))       ret = replay("uart", RP_LA_UART, &uart, &c, NULL, 0, repeats);
+        else if (!strcmp(proto, "spi"))   ret = replay("spi", RP_LA_SPI, &spi, &c, NULL, 0, repeats);
+        else if (!strcmp(proto, "i2c"))   ret = replay("i2c", RP_LA_I2C, &i2c, &c, NULL, 0, repeats);
+        else if (!strcmp(proto, "1wire")) ret = replay("1wire", RP_LA_1WIRE, &onewire, &c, NULL, 0, repeats);
+        else { usage(argv[0]); ret = -1; }
+        free(c.buf);
+        return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    uint32_t *data = malloc(WORDS * sizeof(uint32_t));
+    uint32_t *data2 = malloc(WORDS * sizeof(uint32_t));
+    srand(1);
+    for (uint32_t i = 0; i < WORDS; i++) {
+        data[i] = rand() & 0xff;
+        data2[i] = rand() & 0xff;
+    }
+
+    capture_t c_uart = { 0 }, c_spi = { 0 }, c_i2c = { 0 }, c_1wire = { 0 };
+    gen_uart(&c_uart, &uart, data, WORDS);
+    gen_spi(&c_spi, &spi, data, data2, WORDS);
+    gen_i2c(&c_i2c, &i2c, data, WORDS);
+    gen_1wire(&c_1wire, &onewire, data, WORDS);
+
+    bench_expand(&c_uart, repeats);
+    ret |= replay("uart", RP_LA_UART, &uart, &c_uart, data, WORDS, repeats);
+    ret |= replay("spi", RP_LA_SPI, &spi, &c_spi, data, WORDS, repeats);
+    ret |= replay("i2c", RP_LA_I2C, &i2c, &c_i2c, data, WORDS, repeats);
+    ret |= replay("1wire", RP_LA_1WIRE, &onewire, &c_1wire, data, WORDS, repeats);
+
+    free(c_uart.buf);
+    free(c_spi.buf);
+    free(c_i2c.buf);
+    free(c_1wire.buf);
+    free(data);
+    free(data2);
+    return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
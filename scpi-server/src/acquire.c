@@ -15,6 +15,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <arpa/inet.h>
 
 #include "acquire.h"
 #include "common.h"
@@ -22,8 +23,22 @@
 #include "scpi/parser.h"
 #include "scpi/units.h"
 
+#define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
 
-rp_scpi_acq_unit_t unit     = RP_SCPI_VOLTS;        // default value
+static void    *readout_buffer = NULL;    // Acquired data, sent to the client from here
+static uint32_t readout_size = 0;
+
+/* Data units are chosen per client, the startup reset runs without a client */
+static rp_scpi_acq_unit_t getUnit(scpi_t *context) {
+    rp_scpi_conn_t *conn = (rp_scpi_conn_t *)context->user_context;
+    return conn ? conn->acq_unit : RP_SCPI_VOLTS;
+}
+
+static void setUnit(scpi_t *context, rp_scpi_acq_unit_t value) {
+    rp_scpi_conn_t *conn = (rp_scpi_conn_t *)context->user_context;
+    if (conn)
+        conn->acq_unit = value;
+}
 
 /* These structures are a direct API mirror 
 and should not be altered! */
@@ -170,7 +185,7 @@ scpi_result_t RP_AcqReset(scpi_t *context) {
         return SCPI_RES_ERR;
     }
 
-    unit = RP_SCPI_VOLTS;
+    setUnit(context, RP_SCPI_VOLTS);
     context->binary_output = false;
 
     RP_LOG(LOG_INFO, "*ACQ:RST Successful reset  Red Pitaya acquire.\n");
@@ -646,8 +661,8 @@ scpi_result_t RP_AcqScpiDataUnits(scpi_t *context) {
         return SCPI_RES_ERR;
     }
 
-    /* Set global units for acq scpi */
-    unit = choice;
+    /* Set units of this client */
+    setUnit(context, choice);
 
     RP_LOG(LOG_INFO, "*ACQ:DATA:UNITS Successfully set scpi units.\n");
     return SCPI_RES_OK;
@@ -657,7 +672,7 @@ scpi_result_t RP_AcqScpiDataUnitsQ(scpi_t *context){
 
     const char *units;
 
-    if(!SCPI_ChoiceToName(scpi_RpUnits, unit, &units)){
+    if(!SCPI_ChoiceToName(scpi_RpUnits, getUnit(context), &units)){
         RP_LOG(LOG_ERR, "*ACQ:DATA:UNITS? Failed to get data units.\n");
         return SCPI_RES_ERR;
     }
@@ -668,9 +683,48 @@ scpi_result_t RP_AcqScpiDataUnitsQ(scpi_t *context){
     return SCPI_RES_OK;
 }
 
+/* Readout buffer holds one full ADC buffer of floats, allocated on first use */
+static void* getReadoutBuffer(uint32_t *size) {
+    if (!readout_buffer) {
+        rp_AcqGetBufSize(&readout_size);
+        readout_buffer = malloc(readout_size * sizeof(float));
+        if (!readout_buffer) {
+            readout_size = 0;
+        }
+    }
+    *size = readout_size;
+    return readout_buffer;
+}
+
+/* Sends acquired data, as a binary block in network byte order or as an ASCII list */
+static scpi_result_t sendReadout(scpi_t *context, uint32_t size) {
+    if (context->binary_output) {
+        if (getUnit(context) == RP_SCPI_VOLTS) {
+            uint32_t *data = (uint32_t *)readout_buffer;
+            for (uint32_t i = 0; i < size; i++)
+                data[i] = htonl(data[i]);
+            size *= sizeof(float);
+        } else {
+            uint16_t *data = (uint16_t *)readout_buffer;
+            for (uint32_t i = 0; i < size; i++)
+                data[i] = htons(data[i]);
+            size *= sizeof(int16_t);
+        }
+
+        if (RP_ConnWriteBlock((rp_scpi_conn_t *)context->user_context, readout_buffer, size) != 0) {
+            return SCPI_RES_ERR;
+        }
+    } else if (getUnit(context) == RP_SCPI_VOLTS) {
+        SCPI_ResultBufferFloat(context, (float *)readout_buffer, size);
+    } else {
+        SCPI_ResultBufferInt16(context, (int16_t *)readout_buffer, size);
+    }
+    return SCPI_RES_OK;
+}
+
 scpi_result_t RP_AcqDataPosQ(scpi_t *context) {
     
-    uint32_t start, end;
+    uint32_t start, end, size;
     int result;
 
     rp_channel_t channel;
@@ -690,28 +744,31 @@ scpi_result_t RP_AcqDataPosQ(scpi_t *context) {
         return SCPI_RES_ERR;
     }
 
-    uint32_t size = end - start;
-    if(unit == RP_SCPI_VOLTS){
-        float buffer[size];
-        result = rp_AcqGetDataPosV(channel, start, end, buffer, &size);
+    void *buffer = getReadoutBuffer(&size);
+    if (!buffer) {
+        RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA:STA:END? Failed to allocate readout buffer.\n");
+        return SCPI_RES_ERR;
+    }
+
+    if(getUnit(context) == RP_SCPI_VOLTS){
+        result = rp_AcqGetDataPosV(channel, start, end, (float *)buffer, &size);
         
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA:STA:END? Failed to get data in volts: %s\n", rp_GetError(result));
             return SCPI_RES_ERR;
         }
-        
-        SCPI_ResultBufferFloat(context, buffer, size);
-
     }else{
-        int16_t buffer[size];
-        result = rp_AcqGetDataPosRaw(channel, start, end, buffer, &size);
+        result = rp_AcqGetDataPosRaw(channel, start, end, (int16_t *)buffer, &size);
         
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA:STA:END? Failed to get raw data: %s\n", rp_GetError(result));
             return SCPI_RES_ERR;
         }
+    }
 
-        SCPI_ResultBufferInt16(context, buffer, size);
+    if (sendReadout(context, size) != SCPI_RES_OK) {
+        RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA:STA:END? Failed to send data to client.\n");
+        return SCPI_RES_ERR;
     }
 
     RP_LOG(LOG_INFO, "*ACQ:SOUR#:DATA:STA:END? Successfully returned data to client.\n");
@@ -720,7 +777,7 @@ scpi_result_t RP_AcqDataPosQ(scpi_t *context) {
 
 scpi_result_t RP_AcqDataQ(scpi_t *context) {
 
-    uint32_t start, size;
+    uint32_t start, size, size_buff;
     int result;
 
     rp_channel_t channel;
@@ -741,29 +798,32 @@ scpi_result_t RP_AcqDataQ(scpi_t *context) {
         return SCPI_RES_ERR;
     }
 
-    uint32_t size_buff;
-    rp_AcqGetBufSize(&size_buff);
-    if(unit == RP_SCPI_VOLTS){
-        float buffer[size_buff - start];
-        result = rp_AcqGetDataV(channel, start, &size, buffer);
+    void *buffer = getReadoutBuffer(&size_buff);
+    if (!buffer) {
+        RP_LOG(LOG_ERR, "*ACQ:SOUR<n>:DATA:STA:N? Failed to allocate readout buffer.\n");
+        return SCPI_RES_ERR;
+    }
+
+    size = MIN(size, size_buff);
+    if(getUnit(context) == RP_SCPI_VOLTS){
+        result = rp_AcqGetDataV(channel, start, &size, (float *)buffer);
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR<n>:DATA:STA:N? Failed to get "
             "data in volts: %s\n", rp_GetError(result));
             return SCPI_RES_ERR;
         }
-
-        SCPI_ResultBufferFloat(context, buffer, size);
-
     }else{
-        int16_t buffer[size_buff - start];
-        result = rp_AcqGetDataRaw(channel, start, &size, buffer);
+        result = rp_AcqGetDataRaw(channel, start, &size, (int16_t *)buffer);
 
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR<n>:DATA:STA:N? Failed to get raw data: %s\n", rp_GetError(result));
             return SCPI_RES_ERR;
         }
+    }
 
-        SCPI_ResultBufferInt16(context, buffer, size);
+    if (sendReadout(context, size) != SCPI_RES_OK) {
+        RP_LOG(LOG_ERR, "*ACQ:SOUR<n>:DATA:STA:N? Failed to send data to client.\n");
+        return SCPI_RES_ERR;
     }
 
     RP_LOG(LOG_INFO, "*ACQ:SOUR<n>:DATA:STA:N? Successfully returned data.\n");
@@ -781,27 +841,30 @@ scpi_result_t RP_AcqDataOldestAllQ(scpi_t *context) {
         return SCPI_RES_ERR;
     }
     
-    rp_AcqGetBufSize(&size);
-    if(unit == RP_SCPI_VOLTS){
-        float buffer[size];
-        result = rp_AcqGetOldestDataV(channel, &size, buffer);
+    void *buffer = getReadoutBuffer(&size);
+    if (!buffer) {
+        RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA? Failed to allocate readout buffer.\n");
+        return SCPI_RES_ERR;
+    }
+
+    if(getUnit(context) == RP_SCPI_VOLTS){
+        result = rp_AcqGetOldestDataV(channel, &size, (float *)buffer);
 
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA? Failed to get data in volt: %s\n", rp_GetError(result));
             return SCPI_RES_ERR;
         }
-
-        SCPI_ResultBufferFloat(context, buffer, size);
-
     }else{
-        int16_t buffer[size];
-        result = rp_AcqGetOldestDataRaw(channel, &size, buffer);
+        result = rp_AcqGetOldestDataRaw(channel, &size, (int16_t *)buffer);
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA? Failed to get raw data: %s\n", rp_GetError(result));
             return SCPI_RES_ERR;
         }
+    }
 
-        SCPI_ResultBufferInt16(context, buffer, size);
+    if (sendReadout(context, size) != SCPI_RES_OK) {
+        RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA? Failed to send data to client.\n");
+        return SCPI_RES_ERR;
     }
 
     RP_LOG(LOG_INFO, "*ACQ:SOUR#:DATA? Successfully returned data.\n");
@@ -810,7 +873,7 @@ scpi_result_t RP_AcqDataOldestAllQ(scpi_t *context) {
 
 scpi_result_t RP_AcqOldestDataQ(scpi_t *context) {
     
-    uint32_t size;
+    uint32_t size, size_buff;
     int result;
 
     rp_channel_t channel;
@@ -824,9 +887,15 @@ scpi_result_t RP_AcqOldestDataQ(scpi_t *context) {
         return SCPI_RES_ERR;
     }
 
-    if(unit == RP_SCPI_VOLTS){
-        float buffer[size];
-        result = rp_AcqGetOldestDataV(channel, &size, buffer);
+    void *buffer = getReadoutBuffer(&size_buff);
+    if (!buffer) {
+        RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA:OLD:N? Failed to allocate readout buffer.\n");
+        return SCPI_RES_ERR;
+    }
+
+    size = MIN(size, size_buff);
+    if(getUnit(context) == RP_SCPI_VOLTS){
+        result = rp_AcqGetOldestDataV(channel, &size, (float *)buffer);
 
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA:OLD:N? Failed to get data in "
@@ -834,18 +903,17 @@ scpi_result_t RP_AcqOldestDataQ(scpi_t *context) {
 
             return SCPI_RES_ERR;
         }
-
-        SCPI_ResultBufferFloat(context, buffer, size);
-
     }else{
-        int16_t buffer[size];
-        result = rp_AcqGetOldestDataRaw(channel, &size, buffer);
+        result = rp_AcqGetOldestDataRaw(channel, &size, (int16_t *)buffer);
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA:OLD:N? Failed to get raw data: %s\n", rp_GetError(result));
             return SCPI_RES_ERR;
         }
+    }
 
-        SCPI_ResultBufferInt16(context, buffer, size);
+    if (sendReadout(context, size) != SCPI_RES_OK) {
+        RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA:OLD:N? Failed to send data to client.\n");
+        return SCPI_RES_ERR;
     }
 
     RP_LOG(LOG_INFO, "*ACQ:SOUR#:DATA:OLD:N? Successfully returned data to client.");
@@ -854,7 +922,7 @@ scpi_result_t RP_AcqOldestDataQ(scpi_t *context) {
 
 scpi_result_t RP_AcqLatestDataQ(scpi_t *context) {
     
-    uint32_t size;
+    uint32_t size, size_buff;
     int result;
 
     rp_channel_t channel;
@@ -868,27 +936,34 @@ scpi_result_t RP_AcqLatestDataQ(scpi_t *context) {
         return SCPI_RES_ERR;
     }
 
-    if(unit == RP_SCPI_VOLTS){
-        float buffer[size];
-        result = rp_AcqGetLatestDataV(channel, &size, buffer);
+    void *buffer = getReadoutBuffer(&size_buff);
+    if (!buffer) {
+        RP_LOG(LOG_ERR, "*ACQ:SOUR<n>:DATA:LAT:N? Failed to allocate readout buffer.\n");
+        return SCPI_RES_ERR;
+    }
+
+    size = MIN(size, size_buff);
+    if(getUnit(context) == RP_SCPI_VOLTS){
+        result = rp_AcqGetLatestDataV(channel, &size, (float *)buffer);
 
         if(result != RP_OK){
             RP_LOG(LOG_INFO, "*ACQ:SOUR<n>:DATA:LAT:N? Failed to "
                 " get data in volt: %s\n", rp_GetError(result));
             return SCPI_RES_ERR;
         }
-
-        SCPI_ResultBufferFloat(context, buffer, size);
     }else{
-        int16_t buffer[size];
-        result = rp_AcqGetLatestDataRaw(channel, &size, buffer);
+        result = rp_AcqGetLatestDataRaw(channel, &size, (int16_t *)buffer);
 
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR<n>:DATA:LAT:N? Failed to "
                 "get raw data: %s\n", rp_GetError(result));
+            return SCPI_RES_ERR;
         }
+    }
 
-        SCPI_ResultBufferInt16(context, buffer, size);
+    if (sendReadout(context, size) != SCPI_RES_OK) {
+        RP_LOG(LOG_ERR, "*ACQ:SOUR<n>:DATA:LAT:N? Failed to send data to client.\n");
+        return SCPI_RES_ERR;
     }
 
     RP_LOG(LOG_INFO, "*ACQ:SOUR<n>:DATA:LAT:N? Successfully returned data to client.\n");
@@ -13,8 +13,20 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include "common.h"
+#include "scpi-commands.h"
+#include "scpi/error.h"
+
+#define CONN_IN_SIZE        (64 * 1024)
+#define CONN_OUT_SIZE       (64 * 1024)
+#define CONN_OUT_MAX        (16 * 1024 * 1024)  // Output kept for a client that does not read it
 
 const scpi_choice_def_t scpi_RpLogMode[] = {
     {"OFF", RP_SCPI_LOG_OFF},
@@ -65,8 +77,172 @@ void RP_LOG(int mode, const char * format,...){
     va_list args;
     va_start (args, format);
     if (getLogMode() == RP_SCPI_LOG_SYSLOG) 
-        syslog(mode, format, args);
+        vsyslog(mode, format, args);
     if (getLogMode() == RP_SCPI_LOG_CONSOLE) 
         vfprintf(stdout, format, args);
     va_end (args);
 }
+
+rp_scpi_conn_t* RP_ConnCreate(int fd) {
+    rp_scpi_conn_t *conn = calloc(1, sizeof(rp_scpi_conn_t));
+    if (!conn)
+        return NULL;
+
+    conn->fd = fd;
+    conn->in_size = CONN_IN_SIZE;
+    conn->in = malloc(conn->in_size);
+    conn->out_size = CONN_OUT_SIZE;
+    conn->out = malloc(conn->out_size);
+
+    // Command list, interface, units and idn are shared, format, registers and input buffer are per client
+    conn->scpi = scpi_context;
+    conn->scpi.user_context = conn;
+    conn->scpi.binary_output = false;
+    conn->scpi.registers = conn->scpi_regs;
+    conn->scpi.buffer.data = malloc(scpi_context.buffer.length);
+    conn->scpi.buffer.position = 0;
+    conn->acq_unit = RP_SCPI_VOLTS;
+
+    if (!conn->in || !conn->out || !conn->scpi.buffer.data) {
+        RP_ConnDestroy(conn);
+        return NULL;
+    }
+    return conn;
+}
+
+void RP_ConnDestroy(rp_scpi_conn_t *conn) {
+    if (!conn)
+        return;
+    free(conn->in);
+    free(conn->out);
+    free(conn->scpi.buffer.data);
+    free(conn);
+}
+
+/* Makes room for len more bytes of output. A client that does not read its responses is dropped at CONN_OUT_MAX. */
+static int reserveOut(rp_scpi_conn_t *conn, size_t len) {
+    if (conn->out_len + len <= conn->out_size)
+        return 0;
+
+    size_t size = conn->out_size;
+    while (size < conn->out_len + len)
+        size *= 2;
+    char *out = size <= CONN_OUT_MAX ? realloc(conn->out, size) : NULL;
+    if (!out) {
+        RP_LOG(LOG_ERR, "Failed to queue %zu bytes of output, %zu are not sent yet\n", len, conn->out_len);
+        conn->failed = 1;
+        return -1;
+    }
+    conn->out = out;
+    conn->out_size = size;
+    return 0;
+}
+
+/* Sends what the socket takes without waiting. Returns the number of bytes sent or -1 on error. */
+static ssize_t sendSome(int fd, struct iovec *iov, int iovcnt) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    while (true) {
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent >= 0)
+            return sent;
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+        RP_LOG(LOG_ERR, "Failed to write into the socket (%s)\n", strerror(errno));
+        return -1;
+    }
+}
+
+/* Queues a response. The queue is sent once all pipelined commands are processed and then whenever the socket has room. */
+size_t RP_ConnWrite(rp_scpi_conn_t *conn, const char *data, size_t len) {
+    if (conn->failed || reserveOut(conn, len) != 0)
+        return 0;
+
+    memcpy(conn->out + conn->out_len, data, len);
+    conn->out_len += len;
+    return len;
+}
+
+/* Sends as much of the queued output as the socket takes. Returns 0 while the connection is usable. */
+int RP_ConnFlush(rp_scpi_conn_t *conn) {
+    if (conn->failed)
+        return -1;
+    if (conn->out_len == 0)
+        return 0;
+
+    struct iovec iov = { .iov_base = conn->out, .iov_len = conn->out_len };
+    ssize_t sent = sendSome(conn->fd, &iov, 1);
+    if (sent < 0)
+        return -1;
+
+    conn->out_len -= sent;
+    if (sent > 0 && conn->out_len > 0)
+        memmove(conn->out, conn->out + sent, conn->out_len);
+    return 0;
+}
+
+/* Sends queued responses followed by an IEEE 488.2 definite length block. The data is only copied when the socket does not take it all. */
+int RP_ConnWriteBlock(rp_scpi_conn_t *conn, const void *data, size_t len) {
+    if (conn->failed)
+        return -1;
+
+    char len_str[24];
+    char header[32];
+    int digits = snprintf(len_str, sizeof(len_str), "%zu", len);
+    int header_len = snprintf(header, sizeof(header), "#%d%s", digits, len_str);
+
+    struct iovec iov[4] = {
+        { .iov_base = conn->out,      .iov_len = conn->out_len },
+        { .iov_base = header,         .iov_len = header_len },
+        { .iov_base = (void *)data,   .iov_len = len },
+        { .iov_base = "\r\n",         .iov_len = 2 },
+    };
+    ssize_t sent = sendSome(conn->fd, iov, 4);
+    if (sent < 0) {
+        conn->failed = 1;
+        return -1;
+    }
+
+    // The rest of the queued output moves to the front, the rest of the block is queued after it
+    for (int i = 0; i < 4; i++) {
+        size_t n = (size_t)sent < iov[i].iov_len ? (size_t)sent : iov[i].iov_len;
+        iov[i].iov_base = (char *)iov[i].iov_base + n;
+        iov[i].iov_len -= n;
+        sent -= n;
+    }
+    if (iov[0].iov_len > 0 && iov[0].iov_base != conn->out)
+        memmove(conn->out, iov[0].iov_base, iov[0].iov_len);
+    conn->out_len = iov[0].iov_len;
+
+    for (int i = 1; i < 4; i++) {
+        if (iov[i].iov_len > 0 && RP_ConnWrite(conn, iov[i].iov_base, iov[i].iov_len) == 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Adds an error to the queue of the client, a full queue ends with a queue overflow error like in the parser. */
+void RP_ConnErrorPush(rp_scpi_conn_t *conn, int16_t err) {
+    if (conn->errors_count == CONN_ERROR_QUEUE) {
+        conn->errors[(conn->errors_first + CONN_ERROR_QUEUE - 1) % CONN_ERROR_QUEUE] = SCPI_ERROR_QUEUE_OVERFLOW;
+        return;
+    }
+    conn->errors[(conn->errors_first + conn->errors_count) % CONN_ERROR_QUEUE] = err;
+    conn->errors_count++;
+}
+
+/* Returns the oldest error of the client or 0 when there is none. */
+int16_t RP_ConnErrorPop(rp_scpi_conn_t *conn) {
+    if (conn->errors_count == 0)
+        return 0;
+
+    int16_t err = conn->errors[conn->errors_first];
+    conn->errors_first = (conn->errors_first + 1) % CONN_ERROR_QUEUE;
+    conn->errors_count--;
+    return err;
+}
@@ -16,9 +16,12 @@
 #define COMMON_H_
 
 #include <syslog.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "scpi/parser.h"
 #include "rp.h"
+#include "acquire.h"
 
 
 typedef enum {
@@ -28,6 +31,28 @@ typedef enum {
 } rp_scpi_log;
 
 
+#define CONN_ERROR_QUEUE    16  // Errors kept per client, like the error queue of the parser
+
+/* Client connection. Every client has its own parser context, user_context of it points back to the connection. */
+typedef struct {
+    int     fd;
+    uint32_t events;    // Events watched on the socket
+    char   *in;         // Received data not yet parsed
+    size_t  in_len;
+    size_t  in_size;
+    char   *out;        // Responses waiting to be sent, the socket is not blocked on
+    size_t  out_len;
+    size_t  out_size;
+    int     failed;     // Output could not be queued, the connection has to be closed
+    int16_t errors[CONN_ERROR_QUEUE];  // The parser has one error queue for all contexts
+    size_t  errors_first;
+    size_t  errors_count;
+    scpi_t  scpi;
+    scpi_reg_val_t      scpi_regs[SCPI_REG_COUNT];
+    rp_scpi_acq_unit_t  acq_unit;
+} rp_scpi_conn_t;
+
+
 #define SCPI_CMD_NUM 	1
 
 #define RP_F_NAME(X) X
@@ -40,5 +65,13 @@ scpi_result_t RP_SetLogMode(scpi_t *context);
 
 void RP_LOG(int mode,const char * format, ...);
 
+rp_scpi_conn_t* RP_ConnCreate(int fd);
+void RP_ConnDestroy(rp_scpi_conn_t *conn);
+size_t RP_ConnWrite(rp_scpi_conn_t *conn, const char *data, size_t len);
+int RP_ConnFlush(rp_scpi_conn_t *conn);
+int RP_ConnWriteBlock(rp_scpi_conn_t *conn, const void *data, size_t len);
+void RP_ConnErrorPush(rp_scpi_conn_t *conn, int16_t err);
+int16_t RP_ConnErrorPop(rp_scpi_conn_t *conn);
+
 
 #endif /* COMMON_H_ */
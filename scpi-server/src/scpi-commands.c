@@ -28,6 +28,10 @@
 #include "i2c.h"
 #include "acquire.h"
 
+#ifdef SCPI_STREAMING
+#include "stream.h"
+#endif
+
 #ifndef Z20_125_4CH
 #include "generate.h"
 #endif
@@ -44,27 +48,12 @@ bool RST_executed = FALSE;
  * Interface general commands
  */
 size_t SCPI_Write(scpi_t * context, const char * data, size_t len) {
-
-    size_t total = 0;
-    if (context->user_context != NULL) {
-        int fd = *(int *)(context->user_context);
-        while (len > 0) {
-            size_t written =  write(fd, data, len);
-            if (written < 0) {
-                syslog(LOG_ERR,
-                    "Failed to write into the socket. Should send %zu bytes. Could send only %zu bytes",
-                    len, written);
-                return total;
-            }
-
-            len -= written;
-            data += written;
-            total += written;
-        }
-    }
-    return total;
+    if (context->user_context == NULL)
+        return 0;
+    return RP_ConnWrite((rp_scpi_conn_t *)context->user_context, data, len);
 }
 
+/* Responses are sent by the server after the whole received batch is parsed */
 scpi_result_t SCPI_Flush(scpi_t * context) {
     return SCPI_RES_OK;
 }
@@ -72,10 +61,33 @@ scpi_result_t SCPI_Flush(scpi_t * context) {
 int SCPI_Error(scpi_t * context, int_fast16_t err) {
     const char error[] = "ERR!\r\n";
     syslog(LOG_ERR, "**ERROR: %d, \"%s\"", (int32_t) err, SCPI_ErrorTranslate(err));
+    if (context->user_context != NULL)
+        RP_ConnErrorPush((rp_scpi_conn_t *)context->user_context, err);
     SCPI_Write(context, error, strlen(error));
     return 0;
 }
 
+/* The error queue of the parser is shared by all clients, the error commands use the queue of the connection */
+static scpi_result_t RP_SystemErrorNextQ(scpi_t * context) {
+    int16_t err = context->user_context ? RP_ConnErrorPop((rp_scpi_conn_t *)context->user_context) : 0;
+    SCPI_ResultInt32(context, err);
+    SCPI_ResultText(context, SCPI_ErrorTranslate(err));
+    return SCPI_RES_OK;
+}
+
+static scpi_result_t RP_SystemErrorCountQ(scpi_t * context) {
+    rp_scpi_conn_t *conn = (rp_scpi_conn_t *)context->user_context;
+    SCPI_ResultInt32(context, conn ? conn->errors_count : 0);
+    return SCPI_RES_OK;
+}
+
+static scpi_result_t RP_CoreCls(scpi_t * context) {
+    rp_scpi_conn_t *conn = (rp_scpi_conn_t *)context->user_context;
+    if (conn)
+        conn->errors_count = 0;
+    return SCPI_CoreCls(context);
+}
+
 scpi_result_t SCPI_Control(scpi_t * context, scpi_ctrl_name_t ctrl, scpi_reg_val_t val) {
     if (SCPI_CTRL_SRQ == ctrl) {
         syslog(LOG_ERR, "**SRQ not implemented");
@@ -104,7 +116,7 @@ scpi_result_t SCPI_SystemCommTcpipControlQ(scpi_t * context) {
 
 static const scpi_command_t scpi_commands[] = {
     /* IEEE Mandated Commands (SCPI std V1999.0 4.1.1) */
-    { .pattern = "*CLS" , .callback = SCPI_CoreCls,},
+    { .pattern = "*CLS" , .callback = RP_CoreCls,},
     { .pattern = "*ESE" , .callback = SCPI_CoreEse,},
     { .pattern = "*ESE?", .callback = SCPI_CoreEseQ,},
     { .pattern = "*ESR?", .callback = SCPI_CoreEsrQ,},
@@ -119,8 +131,8 @@ static const scpi_command_t scpi_commands[] = {
     { .pattern = "*WAI" , .callback = SCPI_CoreWai,},
 
     /* Required SCPI commands (SCPI std V1999.0 4.2.1) */
-    {.pattern = "SYSTem:ERRor[:NEXT]?", .callback = SCPI_SystemErrorNextQ,},
-    {.pattern = "SYSTem:ERRor:COUNt?",  .callback = SCPI_SystemErrorCountQ,},
+    {.pattern = "SYSTem:ERRor[:NEXT]?", .callback = RP_SystemErrorNextQ,},
+    {.pattern = "SYSTem:ERRor:COUNt?",  .callback = RP_SystemErrorCountQ,},
     {.pattern = "SYSTem:VERSion?",      .callback = SCPI_SystemVersionQ,},
 
     {.pattern = "STATus:QUEStionable[:EVENt]?", .callback = SCPI_StatusQuestionableEventQ,},
@@ -183,6 +195,22 @@ static const scpi_command_t scpi_commands[] = {
     {.pattern = "ACQ:SOUR#:DATA?", .callback            = RP_AcqDataOldestAllQ,},
     {.pattern = "ACQ:SOUR#:DATA:LAT:N?", .callback      = RP_AcqLatestDataQ,},
     {.pattern = "ACQ:BUF:SIZE?", .callback              = RP_AcqBufferSizeQ,},
+#ifdef SCPI_STREAMING
+    {.pattern = "ACQ:STREAM:CHannels", .callback        = RP_AcqStreamChannels,},
+    {.pattern = "ACQ:STREAM:CHannels?", .callback       = RP_AcqStreamChannelsQ,},
+    {.pattern = "ACQ:STREAM:DECimation", .callback      = RP_AcqStreamDecimation,},
+    {.pattern = "ACQ:STREAM:DECimation?", .callback     = RP_AcqStreamDecimationQ,},
+    {.pattern = "ACQ:STREAM:RESolution", .callback      = RP_AcqStreamResolution,},
+    {.pattern = "ACQ:STREAM:RESolution?", .callback     = RP_AcqStreamResolutionQ,},
+    {.pattern = "ACQ:STREAM:PORT", .callback            = RP_AcqStreamPort,},
+    {.pattern = "ACQ:STREAM:PORT?", .callback           = RP_AcqStreamPortQ,},
+    {.pattern = "ACQ:STREAM:SAMPles", .callback         = RP_AcqStreamSamples,},
+    {.pattern = "ACQ:STREAM:SAMPles?", .callback        = RP_AcqStreamSamplesQ,},
+    {.pattern = "ACQ:STREAM:START", .callback           = RP_AcqStreamStart,},
+    {.pattern = "ACQ:STREAM:STOP", .callback            = RP_AcqStreamStop,},
+    {.pattern = "ACQ:STREAM:STATE?", .callback          = RP_AcqStreamStateQ,},
+    {.pattern = "ACQ:STREAM:LOST?", .callback           = RP_AcqStreamLostQ,},
+#endif
 #ifdef Z20_250_12
     {.pattern = "ACQ:SOUR#:COUP", .callback             = RP_AcqAC_DC,},
     {.pattern = "ACQ:SOUR#:COUP?", .callback            = RP_AcqAC_DCQ,},
@@ -316,7 +344,7 @@ static char scpi_input_buffer[SCPI_INPUT_BUFFER_LENGTH];
 
 static scpi_reg_val_t scpi_regs[SCPI_REG_COUNT];
 
-
+/* Template of the client contexts, every connection gets a copy with its own buffer and registers */
 scpi_t scpi_context = {
     .cmdlist = scpi_commands,
     .buffer = {
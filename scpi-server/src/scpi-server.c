@@ -18,8 +18,11 @@
 #include <string.h>
 
 #include <netinet/in.h>
-#include <sys/prctl.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include <signal.h>
 #include <unistd.h>
@@ -32,25 +35,25 @@
 #include "rp.h"
 #include "api_cmd.h"
 
+#ifdef SCPI_STREAMING
+#include "stream.h"
+#endif
+
 #define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
 #define MAX(X, Y) (((X) > (Y)) ? (X) : (Y))
 
 #define LISTEN_BACKLOG 50
 #define LISTEN_PORT 5000
-#define MAX_BUFF_SIZE 1024
+#define MAX_CLIENTS 16
+#define MAX_EVENTS (MAX_CLIENTS + 1)
+#define RECV_CHUNK 16384
+#define CONN_IN_MAX (1024 * 1024)  // Received data kept per client, a longer unterminated command drops the client
+#define SOCKET_BUFF_SIZE (512 * 1024)
+#define LOG_RATE_LIMIT 20   // Logged commands per second, the rest are counted
 
 static bool app_exit = false;
 static char delimiter[] = "\r\n";
-
-
-static void handleCloseChildEvents()
-{
-    struct sigaction sigchld_action = {
-            .sa_handler = SIG_DFL,
-            .sa_flags = SA_NOCLDWAIT
-    };
-    sigaction(SIGCHLD, &sigchld_action, NULL);
-}
+static rp_scpi_conn_t *clients[MAX_CLIENTS];
 
 
 static void termSignalHandler(int signum)
@@ -67,6 +70,9 @@ static void installTermSignalHandler()
     action.sa_handler = termSignalHandler;
     sigaction(SIGTERM, &action, NULL);
     sigaction(SIGINT, &action, NULL);
+
+    // Closed clients are reported by send, not by a signal
+    signal(SIGPIPE, SIG_IGN);
 }
 
 /**
@@ -104,6 +110,29 @@ static size_t getNextCommand(const char* buffer, size_t bufferLen)
 }
 
 void LogMessage(char *m, size_t len) {
+    static time_t window = 0;
+    static int logged = 0;
+    static int suppressed = 0;
+
+    if (getLogMode() == RP_SCPI_LOG_OFF)
+        return;
+
+    time_t now = time(NULL);
+    if (now != window) {
+        if (suppressed > 0) {
+            RP_LOG(LOG_INFO, "Suppressed logging of %d commands\n", suppressed);
+        }
+        window = now;
+        logged = 0;
+        suppressed = 0;
+    }
+
+    if (logged >= LOG_RATE_LIMIT) {
+        suppressed++;
+        return;
+    }
+    logged++;
+
     const size_t buff_len = 50;
     char buff[buff_len];
 
@@ -114,95 +143,204 @@ void LogMessage(char *m, size_t len) {
     RP_LOG(LOG_INFO, "Processing command: %s\n", buff);
 }
 
-/**
- * This is main method of every child process. Here communication with client is handled.
- * @param connfd The communication port
- * @return
- */
-static int handleConnection(int connfd) {
-    int read_size;
-
-    size_t message_len = MAX_BUFF_SIZE;
-    char *message_buff = malloc(message_len);
-    char buffer[MAX_BUFF_SIZE];
-    size_t msg_end = 0;
-
-    installTermSignalHandler();
-
-    prctl( 1, SIGTERM );
-
-    RP_LOG(LOG_INFO, "Waiting for first client request.");
-    int buf = 1024 * 16;
-    if (setsockopt(connfd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(int)) == -1) {
+static void setSocketBuffers(int fd)
+{
+    int buf = SOCKET_BUFF_SIZE;
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(int)) == -1) {
         RP_LOG(LOG_ERR, "Error setting socket opts: %s\n", strerror(errno));
     }
 
-    buf = 1024 * 16;
-    if (setsockopt(connfd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(int)) == -1) {
+    buf = SOCKET_BUFF_SIZE;
+    if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(int)) == -1) {
         RP_LOG(LOG_ERR, "Error setting socket opts: %s\n", strerror(errno));
     }
-    //Receive a message from client
-    while( (read_size = recv(connfd , buffer , MAX_BUFF_SIZE , 0)) > 0 )
-    {
-        if (app_exit) {
-            break;
+}
+
+static int setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static void closeConnection(int epollfd, rp_scpi_conn_t *conn)
+{
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i] == conn) {
+            clients[i] = NULL;
         }
+    }
+
+    epoll_ctl(epollfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    RP_ConnDestroy(conn);
+}
 
-        // First make sure that message buffer is large enough
-        while (msg_end + read_size >= message_len) {
-            message_len *= 2;
-            message_buff = realloc(message_buff, message_len);
+static void acceptConnections(int epollfd, int listenfd)
+{
+    while (true) {
+        struct sockaddr_in cliaddr;
+        socklen_t clilen = sizeof(cliaddr);
+
+        int connfd = accept(listenfd, (struct sockaddr *)&cliaddr, &clilen);
+        if (connfd == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                RP_LOG(LOG_ERR, "Failed to accept connection (%s)", strerror(errno));
+            }
+            return;
         }
 
-        // Copy read buffer into message buffer
-        memcpy(message_buff + msg_end, buffer, read_size);
-        msg_end += read_size;
+        int slot = -1;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i] == NULL) {
+                slot = i;
+                break;
+            }
+        }
 
-        // Now try to parse each command out
-        char *m = message_buff;
-        size_t pos = -1;
-        while ((pos = getNextCommand(m, msg_end)) != -1) {
+        if (slot == -1) {
+            RP_LOG(LOG_ERR, "Too many clients, rejecting ip %s.", inet_ntoa(cliaddr.sin_addr));
+            close(connfd);
+            continue;
+        }
 
-            // Log out message
-            LogMessage(m, pos);
+        int flag = 1;
+        setNonBlocking(connfd);
+        setsockopt(connfd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(int));
+        setSocketBuffers(connfd);
 
-            //Parse the message and return response
-            SCPI_Input(&scpi_context, m, pos);
-            m += pos;
-            msg_end -= pos;
+        rp_scpi_conn_t *conn = RP_ConnCreate(connfd);
+        if (!conn) {
+            RP_LOG(LOG_ERR, "Failed to allocate connection buffers.");
+            close(connfd);
+            continue;
         }
 
-        // Move the rest of the message to the beginning of the buffer
-        if (message_buff != m && msg_end > 0) {
-            memmove(message_buff, m, msg_end);
+        conn->events = EPOLLIN | EPOLLRDHUP;
+        struct epoll_event ev = { .events = conn->events, .data.ptr = conn };
+        if (epoll_ctl(epollfd, EPOLL_CTL_ADD, connfd, &ev) == -1) {
+            RP_LOG(LOG_ERR, "Failed to watch connection (%s)", strerror(errno));
+            close(connfd);
+            RP_ConnDestroy(conn);
+            continue;
         }
 
-        RP_LOG(LOG_INFO, "Waiting for next client request.\n");
+        clients[slot] = conn;
+        RP_LOG(LOG_INFO, "Connection with client ip %s established.", inet_ntoa(cliaddr.sin_addr));
     }
+}
 
-    free(message_buff);
+/**
+ * Reads everything available from the client and executes all complete commands.
+ * Responses of pipelined commands are queued and sent together at the end, what the
+ * socket does not take stays queued for watchConnection.
+ * @param conn  Client connection
+ * @return 0 while the client stays connected, 1 when the connection should be closed.
+ */
+static int handleConnection(rp_scpi_conn_t *conn) {
+    int result = 0;
+
+    // Receive everything the client sent so far, up to CONN_IN_MAX, the rest is read on the next event
+    while (true) {
+        if (conn->in_size - conn->in_len < RECV_CHUNK) {
+            if (conn->in_size * 2 > CONN_IN_MAX) {
+                break;
+            }
+            char *in = realloc(conn->in, conn->in_size * 2);
+            if (!in) {
+                RP_LOG(LOG_ERR, "Failed to grow receive buffer.");
+                return 1;
+            }
+            conn->in = in;
+            conn->in_size *= 2;
+        }
 
-    RP_LOG(LOG_INFO, "Closing client connection...");
+        ssize_t read_size = recv(conn->fd, conn->in + conn->in_len, conn->in_size - conn->in_len, 0);
+        if (read_size > 0) {
+            conn->in_len += read_size;
+            continue;
+        }
 
-    if(read_size == 0)
-    {
-        RP_LOG(LOG_INFO, "Client is disconnected");
+        if (read_size == 0) {
+            RP_LOG(LOG_INFO, "Client is disconnected");
+            result = 1;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            RP_LOG(LOG_ERR, "Receive message failed (%s)", strerror(errno));
+            result = 1;
+        }
+        break;
+    }
+
+    // Now try to parse each command out
+    char *m = conn->in;
+    size_t pos = -1;
+    while (!app_exit && (pos = getNextCommand(m, conn->in_len)) != -1) {
+
+        // Log out message
+        LogMessage(m, pos);
+
+        //Parse the message and return response
+        SCPI_Input(&conn->scpi, m, pos);
+        m += pos;
+        conn->in_len -= pos;
+    }
+
+    // Move the rest of the message to the beginning of the buffer
+    if (conn->in != m && conn->in_len > 0) {
+        memmove(conn->in, m, conn->in_len);
+    }
+
+    // A command that does not fit into the parser buffer will never be terminated
+    if (conn->in_len >= (size_t)scpi_context.buffer.length || conn->in_len > CONN_IN_MAX - RECV_CHUNK) {
+        RP_LOG(LOG_ERR, "Client sent %zu bytes without a command terminator, closing the connection.", conn->in_len);
+        result = 1;
+    }
+
+    // Errors are reported from the queue of the connection, the queue of the parser is only kept from filling up
+    SCPI_ErrorClear(&conn->scpi);
+
+    if (RP_ConnFlush(conn) != 0) {
+        result = 1;
+    }
+
+    return result;
+}
+
+/**
+ * Watches the client for output room while responses are queued and for commands once they are sent.
+ * New commands are not read before the responses of the previous ones are sent.
+ * @param epollfd  Event loop
+ * @param conn     Client connection
+ * @return 0 on success, 1 when the connection should be closed.
+ */
+static int watchConnection(int epollfd, rp_scpi_conn_t *conn) {
+    uint32_t events = conn->out_len > 0 ? EPOLLOUT : EPOLLIN | EPOLLRDHUP;
+    if (events == conn->events) {
         return 0;
     }
-    else if(read_size == -1)
-    {
-        RP_LOG(LOG_ERR, "Receive message failed (%s)", strerror(errno));
-        perror("Receive message failed");
+
+    struct epoll_event ev = { .events = events, .data.ptr = conn };
+    if (epoll_ctl(epollfd, EPOLL_CTL_MOD, conn->fd, &ev) == -1) {
+        RP_LOG(LOG_ERR, "Failed to watch connection (%s)", strerror(errno));
         return 1;
     }
+    conn->events = events;
     return 0;
 }
 
 
 /**
  * Main daemon entrance point. Opens a socket and listens for any incoming connection.
- * When client connects, if forks the conversation into a new socket and the daemon (parent process)
- * waits for another connection. It can handle multiple connections simultaneously.
+ * All clients are served from a single event loop. Commands of one client are executed
+ * in the order they arrive, commands of different clients are interleaved per received batch.
+ * Every client has its own parser context, so data format, units and registers do not leak
+ * between connections, the error queue included. Commands run to completion on the loop, so
+ * UART, SPI and I2C transfers hold the other clients until they return. Responses are never
+ * waited for, a client with a full socket buffer keeps them queued until it reads them.
  * @param argc  not used
  * @param argv  not used
  * @return
@@ -218,13 +356,10 @@ int main(int argc, char *argv[])
 
     installTermSignalHandler();
 
-    int listenfd = 0, connfd = 0;
+    int listenfd = 0, epollfd = 0;
+    int exit_code = EXIT_SUCCESS;
     struct sockaddr_in serv_addr;
 
-    // Handle close child events
-    handleCloseChildEvents();
-
-
     int result = rp_Init();
     if (result != RP_OK) {
         RP_LOG(LOG_ERR, "Failed to initialize RP APP library: %s", rp_GetError(result));
@@ -239,7 +374,7 @@ int main(int argc, char *argv[])
 
 
 
-    // user_context will be pointer to socket
+    // Template context, it is only used directly for the startup reset
     scpi_context.user_context = NULL;
     scpi_context.binary_output = false;
     SCPI_Init(&scpi_context);
@@ -259,15 +394,12 @@ int main(int argc, char *argv[])
     serv_addr.sin_family = AF_INET;
     serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
     serv_addr.sin_port = htons(LISTEN_PORT);
-    int buf = 1024 * 16;
-    if (setsockopt(listenfd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(int)) == -1) {
-        RP_LOG(LOG_ERR, "Error setting socket opts: %s\n", strerror(errno));
-    }
 
-    buf = 1024 * 16;
-    if (setsockopt(listenfd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(int)) == -1) {
-        RP_LOG(LOG_ERR, "Error setting socket opts: %s\n", strerror(errno));
-    }
+    int reuse = 1;
+    setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(int));
+
+    // Accepted sockets inherit buffer sizes, TCP window is negotiated before accept returns
+    setSocketBuffers(listenfd);
 
     if (bind(listenfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == -1)
     {
@@ -283,56 +415,72 @@ int main(int argc, char *argv[])
         return (EXIT_FAILURE);
     }
 
-    RP_LOG(LOG_INFO, "Server is listening on port %d\n", LISTEN_PORT);
+    setNonBlocking(listenfd);
 
-    // Socket is opened and listening on port. Now we can accept connections
-    while(1)
+    epollfd = epoll_create1(0);
+    if (epollfd == -1)
     {
-        struct sockaddr_in cliaddr;
-        socklen_t clilen;
-        clilen = sizeof(cliaddr);
+        RP_LOG(LOG_ERR, "Failed to create epoll instance (%s)", strerror(errno));
+        perror("Failed to create epoll instance");
+        return (EXIT_FAILURE);
+    }
 
-        connfd = accept(listenfd, (struct sockaddr *)&cliaddr, &clilen);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, listenfd, &ev) == -1)
+    {
+        RP_LOG(LOG_ERR, "Failed to watch the socket (%s)", strerror(errno));
+        perror("Failed to watch the socket");
+        return (EXIT_FAILURE);
+    }
 
-        if (app_exit == true) {
-            break;
-        }
+    RP_LOG(LOG_INFO, "Server is listening on port %d\n", LISTEN_PORT);
 
-        if (connfd == -1) {
-            RP_LOG(LOG_ERR, "Failed to accept connection (%s)", strerror(errno));
-            perror("Failed to accept connection\n");
-            return (EXIT_FAILURE);
+    // Socket is opened and listening on port. Now we can serve connections
+    struct epoll_event events[MAX_EVENTS];
+    while(!app_exit)
+    {
+        int n = epoll_wait(epollfd, events, MAX_EVENTS, -1);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            RP_LOG(LOG_ERR, "Failed to wait for events (%s)", strerror(errno));
+            exit_code = EXIT_FAILURE;
+            break;
         }
 
-        // Fork a child process, which will talk to the client
-        if (!fork()) {
-
-            RP_LOG(LOG_INFO, "Connection with client ip %s established.", inet_ntoa(cliaddr.sin_addr));
-
-            // this is the child process
-            close(listenfd); // child doesn't need the listener
-
-            scpi_context.user_context = &connfd;
-
-            result = handleConnection(connfd);
-
-            close(connfd);
-
-            RP_LOG(LOG_INFO, "Closing connection with client ip %s.", inet_ntoa(cliaddr.sin_addr));
+        for (int i = 0; i < n && !app_exit; i++) {
+            rp_scpi_conn_t *conn = events[i].data.ptr;
+            if (conn == NULL) {
+                acceptConnections(epollfd, listenfd);
+                continue;
+            }
 
-            if (result == 0) {
-                return(EXIT_SUCCESS);
+            int failed = (events[i].events & EPOLLOUT) ? RP_ConnFlush(conn) != 0 : handleConnection(conn);
+            if (!failed) {
+                failed = watchConnection(epollfd, conn);
             }
-            else {
-                return(EXIT_FAILURE);
+
+            if (failed || (events[i].events & (EPOLLERR | EPOLLHUP))) {
+                RP_LOG(LOG_INFO, "Closing client connection...");
+                closeConnection(epollfd, conn);
             }
         }
+    }
 
-        close(connfd);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i]) {
+            closeConnection(epollfd, clients[i]);
+        }
     }
 
+    close(epollfd);
     close(listenfd);
 
+#ifdef SCPI_STREAMING
+    RP_AcqStreamRelease();
+#endif
+
     result = rp_Release();
     if (result != RP_OK) {
         RP_LOG(LOG_ERR, "Failed to release RP App library: %s", rp_GetError(result));
@@ -343,5 +491,5 @@ int main(int argc, char *argv[])
 
     closelog ();
 
-    return (EXIT_SUCCESS);
+    return exit_code;
 }
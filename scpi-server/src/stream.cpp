@@ -0,0 +1,415 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya Scpi server streaming acquisition SCPI commands implementation
+ *
+ * The stream is served by the DMA streaming core from streaming_manager (streaming_lib).
+ * Data is pushed on a separate TCP port in the same framed format used by rpsa_client,
+ * every pack carries a sequence number and the count of samples lost in the FPGA or in
+ * the internal buffer.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C++ programming language.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "uio_lib/oscilloscope.h"
+#include "net_lib/asio_net.h"
+#include "streaming_lib/streaming_fpga.h"
+#include "streaming_lib/streaming_buffer_cached.h"
+
+extern "C" {
+#include "common.h"
+}
+#include "stream.h"
+
+#include "scpi/parser.h"
+
+#define STREAM_DEFAULT_PORT     8900
+#define STREAM_TCP_SPLIT        (32 * 1024)
+#define STREAM_RAM_SIZE         (1024 * 1024 * 16)
+#define STREAM_CONNECT_POLL     10000   // us between checks for a data client
+#define STREAM_READ_WAIT        100     // ms to wait for a pack before the connection is checked again
+
+using namespace streaming_lib;
+
+typedef enum {
+    RP_STREAM_CH1,
+    RP_STREAM_CH2,
+    RP_STREAM_BOTH
+} rp_scpi_stream_ch_t;
+
+const scpi_choice_def_t scpi_RpStreamChannels[] = {
+    {"CH1",  RP_STREAM_CH1},
+    {"CH2",  RP_STREAM_CH2},
+    {"BOTH", RP_STREAM_BOTH},
+    SCPI_CHOICE_LIST_END
+};
+
+const scpi_choice_def_t scpi_RpStreamResolution[] = {
+    {"BIT_8",  8},
+    {"BIT_16", 16},
+    SCPI_CHOICE_LIST_END
+};
+
+static struct {
+    int32_t  channels = RP_STREAM_BOTH;
+    uint32_t decimation = 64;
+    int32_t  resolution = 16;
+    uint32_t port = STREAM_DEFAULT_PORT;
+    uint64_t samples = 0;              // Samples per channel before the stream stops, 0 is continuous
+} g_settings;
+
+static std::mutex                   g_mtx;
+static uio_lib::COscilloscope::Ptr  g_osc = nullptr;
+static CStreamingFPGA::Ptr          g_fpga = nullptr;
+static CStreamingBufferCached::Ptr  g_buffer = nullptr;
+static net_lib::CAsioNet::Ptr       g_net = nullptr;
+static std::thread                  g_sender;
+static std::atomic_bool             g_senderRun(false);
+static std::atomic_bool             g_isRun(false);
+static std::atomic<uint64_t>        g_lost(0);
+
+
+/* Waits for the data client, then moves packs from the cache to the socket until stopped */
+static auto senderWorker() -> void {
+    uint64_t index = 0;
+    uint64_t sent = 0;
+
+    while (g_senderRun && !g_net->isConnected()) {
+        usleep(STREAM_CONNECT_POLL);
+    }
+
+    if (g_senderRun) {
+        // The FPGA is started only now so the client gets the stream from the first sample
+        g_fpga->runNonBlock();
+    }
+
+    while (g_senderRun) {
+        if (!g_net->isConnected()) {
+            RP_LOG(LOG_INFO, "ACQ:STREAM Data client disconnected.\n");
+            break;
+        }
+
+        auto pack = g_buffer->readBuffer();
+        if (!pack) {
+            g_buffer->waitBuffer(STREAM_READ_WAIT);
+            continue;
+        }
+
+        auto packs = net_lib::buildPack(index++, pack, STREAM_TCP_SPLIT);
+        for (auto &buff : packs) {
+            g_net->sendSyncData(buff);
+        }
+
+        for (int ch = DataLib::CH1; ch <= DataLib::CH2; ch++) {
+            auto buff = pack->getBuffer((DataLib::EDataBuffersPackChannel)ch);
+            if (buff) {
+                g_lost += buff->getLostSamplesAll();
+                break;
+            }
+        }
+        sent += pack->getBuffersSamples();
+        g_buffer->unlockBufferRead();
+
+        if (g_settings.samples && sent >= g_settings.samples) {
+            RP_LOG(LOG_INFO, "ACQ:STREAM Sample limit reached.\n");
+            break;
+        }
+    }
+
+    g_fpga->stop();
+    g_isRun = false;
+}
+
+/* Must be called with g_mtx held */
+static auto streamStop() -> void {
+    g_senderRun = false;
+    if (g_sender.joinable()) {
+        g_sender.join();
+    }
+
+    if (g_buffer) g_buffer->notifyToDestory();
+    g_fpga = nullptr;
+    if (g_net) g_net->stop();
+    g_net = nullptr;
+    g_buffer = nullptr;
+    g_osc = nullptr;
+    g_isRun = false;
+}
+
+/* Must be called with g_mtx held */
+static auto streamStart() -> bool {
+    uint8_t bits = g_settings.resolution;
+
+#ifdef STREAMING_SLAVE
+    auto isMaster = false;
+#else
+    auto isMaster = true;
+#endif
+
+#ifdef RP_PLATFORM
+    for (auto &uio : uio_lib::GetUioList()) {
+        if (uio.nodeName == "rp_oscilloscope") {
+            g_osc = uio_lib::COscilloscope::create(uio, g_settings.decimation, isMaster, ADC_SAMPLE_RATE);
+            break;
+        }
+    }
+#else
+    uio_lib::UioT uio_t;
+    g_osc = uio_lib::COscilloscope::create(uio_t, g_settings.decimation, isMaster, ADC_SAMPLE_RATE);
+#endif
+
+    if (!g_osc) {
+        RP_LOG(LOG_ERR, "ACQ:STREAM:START Streaming FPGA image is not loaded.\n");
+        return false;
+    }
+
+    // Raw ADC counts, calibration is left to the client
+    g_osc->setCalibration(0, 1, 0, 1);
+    g_osc->setFilterBypass(true);
+    g_osc->set8BitMode(bits == 8);
+
+    g_buffer = CStreamingBufferCached::create(STREAM_RAM_SIZE);
+    g_fpga = std::make_shared<CStreamingFPGA>(g_osc, 16);
+
+    if (g_settings.channels == RP_STREAM_CH1 || g_settings.channels == RP_STREAM_BOTH) {
+        g_fpga->addChannel(DataLib::CH1, DataLib::CDataBuffer::ATT_1_1, bits);
+        g_buffer->addChannel(DataLib::CH1, uio_lib::osc_buf_size, bits);
+    }
+    if (g_settings.channels == RP_STREAM_CH2 || g_settings.channels == RP_STREAM_BOTH) {
+        g_fpga->addChannel(DataLib::CH2, DataLib::CDataBuffer::ATT_1_1, bits);
+        g_buffer->addChannel(DataLib::CH2, uio_lib::osc_buf_size, bits);
+    }
+    g_buffer->generateBuffers();
+
+    auto weak_buffer = std::weak_ptr<CStreamingBufferCached>(g_buffer);
+    g_fpga->getBuffF = [weak_buffer](uint64_t lostFPGA) -> DataLib::CDataBuffersPack::Ptr {
+        auto obj = weak_buffer.lock();
+        return obj ? obj->getFreeBuffer(lostFPGA) : nullptr;
+    };
+    g_fpga->unlockBuffF = [weak_buffer]() {
+        auto obj = weak_buffer.lock();
+        if (obj) {
+            obj->unlockBufferWrite();
+        }
+    };
+
+    g_net = net_lib::CAsioNet::create(net_lib::EMode::M_SERVER, net_lib::EProtocol::P_TCP, "0.0.0.0", std::to_string(g_settings.port));
+    g_net->start();
+
+    g_lost = 0;
+    g_isRun = true;
+    g_senderRun = true;
+    g_sender = std::thread(senderWorker);
+    return true;
+}
+
+void RP_AcqStreamRelease() {
+    std::lock_guard<std::mutex> lock(g_mtx);
+    try {
+        streamStop();
+    } catch (std::exception &e) {
+        RP_LOG(LOG_ERR, "ACQ:STREAM Failed to release stream: %s\n", e.what());
+    }
+}
+
+/* Settings can't change under a running stream */
+static auto isConfigurable(const char *cmd) -> bool {
+    if (g_isRun) {
+        RP_LOG(LOG_ERR, "%s Stream is running.\n", cmd);
+        return false;
+    }
+    return true;
+}
+
+scpi_result_t RP_AcqStreamChannels(scpi_t *context) {
+    int32_t choice;
+
+    if (!SCPI_ParamChoice(context, scpi_RpStreamChannels, &choice, true)) {
+        RP_LOG(LOG_ERR, "*ACQ:STREAM:CH is missing first parameter.\n");
+        return SCPI_RES_ERR;
+    }
+
+    if (!isConfigurable("*ACQ:STREAM:CH")) {
+        return SCPI_RES_ERR;
+    }
+
+    g_settings.channels = choice;
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:CH Successfully set channels.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamChannelsQ(scpi_t *context) {
+    const char *name;
+
+    if (!SCPI_ChoiceToName(scpi_RpStreamChannels, g_settings.channels, &name)) {
+        RP_LOG(LOG_ERR, "*ACQ:STREAM:CH? Failed to get channels.\n");
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultMnemonic(context, name);
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:CH? Successfully returned channels.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamDecimation(scpi_t *context) {
+    uint32_t value;
+
+    if (!SCPI_ParamUInt32(context, &value, true)) {
+        RP_LOG(LOG_ERR, "*ACQ:STREAM:DEC is missing first parameter.\n");
+        return SCPI_RES_ERR;
+    }
+
+    if (value == 0) {
+        RP_LOG(LOG_ERR, "*ACQ:STREAM:DEC Decimation must be positive.\n");
+        return SCPI_RES_ERR;
+    }
+
+    if (!isConfigurable("*ACQ:STREAM:DEC")) {
+        return SCPI_RES_ERR;
+    }
+
+    g_settings.decimation = value;
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:DEC Successfully set decimation.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamDecimationQ(scpi_t *context) {
+    SCPI_ResultUInt32Base(context, g_settings.decimation, 10);
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:DEC? Successfully returned decimation.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamResolution(scpi_t *context) {
+    int32_t choice;
+
+    if (!SCPI_ParamChoice(context, scpi_RpStreamResolution, &choice, true)) {
+        RP_LOG(LOG_ERR, "*ACQ:STREAM:RES is missing first parameter.\n");
+        return SCPI_RES_ERR;
+    }
+
+    if (!isConfigurable("*ACQ:STREAM:RES")) {
+        return SCPI_RES_ERR;
+    }
+
+    g_settings.resolution = choice;
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:RES Successfully set resolution.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamResolutionQ(scpi_t *context) {
+    const char *name;
+
+    if (!SCPI_ChoiceToName(scpi_RpStreamResolution, g_settings.resolution, &name)) {
+        RP_LOG(LOG_ERR, "*ACQ:STREAM:RES? Failed to get resolution.\n");
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultMnemonic(context, name);
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:RES? Successfully returned resolution.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamPort(scpi_t *context) {
+    uint32_t value;
+
+    if (!SCPI_ParamUInt32(context, &value, true)) {
+        RP_LOG(LOG_ERR, "*ACQ:STREAM:PORT is missing first parameter.\n");
+        return SCPI_RES_ERR;
+    }
+
+    if (value == 0 || value > 65535) {
+        RP_LOG(LOG_ERR, "*ACQ:STREAM:PORT Invalid port.\n");
+        return SCPI_RES_ERR;
+    }
+
+    if (!isConfigurable("*ACQ:STREAM:PORT")) {
+        return SCPI_RES_ERR;
+    }
+
+    g_settings.port = value;
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:PORT Successfully set port.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamPortQ(scpi_t *context) {
+    SCPI_ResultUInt32Base(context, g_settings.port, 10);
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:PORT? Successfully returned port.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamSamples(scpi_t *context) {
+    uint32_t value;
+
+    if (!SCPI_ParamUInt32(context, &value, true)) {
+        RP_LOG(LOG_ERR, "*ACQ:STREAM:SAMP is missing first parameter.\n");
+        return SCPI_RES_ERR;
+    }
+
+    if (!isConfigurable("*ACQ:STREAM:SAMP")) {
+        return SCPI_RES_ERR;
+    }
+
+    g_settings.samples = value;
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:SAMP Successfully set sample limit.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamSamplesQ(scpi_t *context) {
+    SCPI_ResultUInt32Base(context, (uint32_t)g_settings.samples, 10);
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:SAMP? Successfully returned sample limit.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamStart(scpi_t *context) {
+    std::lock_guard<std::mutex> lock(g_mtx);
+    try {
+        // A finished segment still holds its resources, drop them first
+        streamStop();
+        if (!streamStart()) {
+            streamStop();
+            return SCPI_RES_ERR;
+        }
+    } catch (std::exception &e) {
+        RP_LOG(LOG_ERR, "*ACQ:STREAM:START Failed to start stream: %s\n", e.what());
+        streamStop();
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:START Successfully started stream on port %u.\n", g_settings.port);
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamStop(scpi_t *context) {
+    std::lock_guard<std::mutex> lock(g_mtx);
+    try {
+        streamStop();
+    } catch (std::exception &e) {
+        RP_LOG(LOG_ERR, "*ACQ:STREAM:STOP Failed to stop stream: %s\n", e.what());
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:STOP Successfully stopped stream.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamStateQ(scpi_t *context) {
+    SCPI_ResultMnemonic(context, g_isRun ? "ON" : "OFF");
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:STATE? Successfully returned state.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqStreamLostQ(scpi_t *context) {
+    SCPI_ResultUInt32Base(context, (uint32_t)g_lost, 10);
+    RP_LOG(LOG_INFO, "*ACQ:STREAM:LOST? Successfully returned lost samples.\n");
+    return SCPI_RES_OK;
+}
@@ -0,0 +1,46 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya Scpi server streaming acquisition SCPI commands interface
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include "scpi/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+scpi_result_t RP_AcqStreamChannels(scpi_t *context);
+scpi_result_t RP_AcqStreamChannelsQ(scpi_t *context);
+scpi_result_t RP_AcqStreamDecimation(scpi_t *context);
+scpi_result_t RP_AcqStreamDecimationQ(scpi_t *context);
+scpi_result_t RP_AcqStreamResolution(scpi_t *context);
+scpi_result_t RP_AcqStreamResolutionQ(scpi_t *context);
+scpi_result_t RP_AcqStreamPort(scpi_t *context);
+scpi_result_t RP_AcqStreamPortQ(scpi_t *context);
+scpi_result_t RP_AcqStreamSamples(scpi_t *context);
+scpi_result_t RP_AcqStreamSamplesQ(scpi_t *context);
+scpi_result_t RP_AcqStreamStart(scpi_t *context);
+scpi_result_t RP_AcqStreamStop(scpi_t *context);
+scpi_result_t RP_AcqStreamStateQ(scpi_t *context);
+scpi_result_t RP_AcqStreamLostQ(scpi_t *context);
+
+void RP_AcqStreamRelease();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_H_ */